@@ -0,0 +1,93 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*
+ * Converts an Open Inventor or VRML file to a chunked binary file,
+ * where the self-contained subgraphs are stored as separately loadable
+ * chunks (see SoChunkedFile and SoLazySeparator). The result can be
+ * read by any Coin application using SoDB::readAll().
+ *
+ * Build the example using this command:
+ *
+ *   coin-config --build ivchunk ivchunk.cpp
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoChunkedFile.h>
+#include <Inventor/SoInteraction.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodekits/SoNodeKit.h>
+
+int
+main(int argc, char ** argv)
+{
+  SoDB::init();
+  SoNodeKit::init();
+  SoInteraction::init();
+
+  if (argc < 3 || argc > 5) {
+    fprintf(stdout, "Usage: %s infile outfile [chunksize] [nocompress]\n", argv[0]);
+    return 0;
+  }
+
+  const int chunksize = (argc > 3) ? atoi(argv[3]) : 65536;
+  const SbBool compress = (argc > 4) ? FALSE : TRUE;
+
+  SoInput in;
+  if (!in.openFile(argv[1])) {
+    fprintf(stderr, "error: could not open file '%s'\n", argv[1]);
+    return -1;
+  }
+
+  SoSeparator * scene = SoDB::readAll(&in);
+  if (!scene) {
+    fprintf(stderr, "error: could not read file '%s'\n", argv[1]);
+    return -1;
+  }
+  in.closeFile();
+  scene->ref();
+
+  if (!SoChunkedFile::write(scene, argv[2], compress, chunksize)) {
+    fprintf(stderr, "error: could not write file '%s'\n", argv[2]);
+    scene->unref();
+    return -1;
+  }
+  fprintf(stdout, "%s: %d chunks\n", argv[2], SoChunkedFile::getNumChunks(argv[2]));
+
+  scene->unref();
+  return 0;
+}
@@ -45,6 +45,11 @@ typedef SbBool SbImageReadImageCB(const SbString &, SbImage *, void *);
 
 class COIN_DLL_API SbImage {
 public:
+  enum ResizeFilter {
+    BOX,
+    LANCZOS
+  };
+
   SbImage(void);
   SbImage(const unsigned char * bytes,
           const SbVec2s & size, const int bytesperpixel);
@@ -65,6 +70,9 @@ public:
   unsigned char * getValue(SbVec3s & size, int & bytesperpixel) const;
   SbVec3s getSize(void) const;
 
+  SbBool resize(const SbVec2s & newsize, const ResizeFilter filter = LANCZOS);
+  SbBool resize(const SbVec3s & newsize, const ResizeFilter filter = LANCZOS);
+
   SbBool readFile(const SbString & filename,
                   const SbString * const * searchdirectories = NULL,
                   const int numdirectories = 0);
@@ -42,9 +42,11 @@
 
 #include <cstdio>
 
+class SbTime;
 class SoBase;
 class SoGLRenderAction;
 class SoNode;
+class SoNodeList;
 class SoPath;
 
 // This shouldn't strictly be necessary, but the OSF1/cxx compiler
@@ -52,6 +54,9 @@ class SoPath;
 // SoExtSelectionP" statement in the class definition.
 class SoOffscreenRendererP;
 
+typedef void SoOffscreenBatchCB(void * userdata,
+                                class SoOffscreenRenderer * renderer,
+                                const int view, const SbTime & rendertime);
 
 class COIN_DLL_API SoOffscreenRenderer {
 public:
@@ -78,6 +83,8 @@ public:
   SoGLRenderAction * getGLRenderAction(void) const;
   SbBool render(SoNode * scene);
   SbBool render(SoPath * scene);
+  SbBool renderToRGB(SoNode * scene, const char * filename);
+  SbBool renderToRGB(SoPath * scene, const char * filename);
   unsigned char * getBuffer(void) const;
   const void * const & getDC(void) const;
 
@@ -97,9 +104,32 @@ public:
                             SbString & description);
   SbBool writeToFile(const SbString & filename, const SbName & filetypeextension) const;
 
+  void setRGBCompression(const SbBool enable);
+  SbBool getRGBCompression(void) const;
+
+  SbBool scheduleWriteToRGB(const char * filename);
+  SbBool scheduleWriteToPostScript(const char * filename);
+  SbBool scheduleWriteToPostScript(const char * filename, const SbVec2f & printsize);
+  SbBool scheduleWriteToFile(const SbString & filename, const SbName & filetypeextension);
+  SbBool waitForScheduledWrites(void);
+
+  void setNumWriteThreads(const int num);
+  int getNumWriteThreads(void) const;
+  void setMaxScheduledWrites(const int num);
+  int getMaxScheduledWrites(void) const;
+
   void setPbufferEnable(SbBool enable);
   SbBool getPbufferEnable(void) const;
 
+  void setNumRenderThreads(const int num);
+  int getNumRenderThreads(void) const;
+
+  SbBool renderBatch(SoNode * scene, const SoNodeList & cameras,
+                     SoOffscreenBatchCB * callback, void * userdata);
+  SbBool renderBatch(SoNode * scene, const SoNodeList & cameras,
+                     const SbList <SbViewportRegion> & regions,
+                     SoOffscreenBatchCB * callback, void * userdata);
+
 private:
   friend class SoOffscreenRendererP;
   class SoOffscreenRendererP * pimpl;
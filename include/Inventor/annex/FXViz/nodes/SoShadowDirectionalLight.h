@@ -37,6 +37,7 @@
 #include <Inventor/nodes/SoDirectionalLight.h>
 #include <Inventor/fields/SoSFNode.h>
 #include <Inventor/fields/SoSFFloat.h>
+#include <Inventor/fields/SoSFInt32.h>
 #include <Inventor/fields/SoSFVec3f.h>
 
 class COIN_DLL_API SoShadowDirectionalLight : public SoDirectionalLight {
@@ -54,6 +55,8 @@ public:
   SoSFFloat maxShadowDistance;
   SoSFVec3f bboxCenter;
   SoSFVec3f bboxSize;
+  SoSFInt32 numCascades;
+  SoSFFloat cascadeSplitWeight;
 
 protected:
   virtual ~SoShadowDirectionalLight();
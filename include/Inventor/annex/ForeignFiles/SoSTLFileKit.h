@@ -79,6 +79,7 @@ public:
 
   SbBool canReadScene(void) const;
   SbBool readScene(SoNode * scene);
+  SbBool writeScene(SoNode * scene, const char * filename);
   virtual SoSeparator *convert();
 
 protected:
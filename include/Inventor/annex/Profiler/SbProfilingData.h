@@ -48,6 +48,7 @@ class SbProfilingDataP;
 typedef void * SbProfilingNodeKey; // void since it should not be dereferenced
 typedef int16_t SbProfilingNodeTypeKey;
 typedef const char * SbProfilingNodeNameKey;
+typedef const char * SbProfilingCounterKey;
 
 class COIN_DLL_API SbProfilingData {
 public:
@@ -121,6 +122,12 @@ public:
   void getStatsForName(SbProfilingNodeNameKey name,
                        SbTime & total, SbTime & max, uint32_t & count) const;
 
+  // named counters for work that is not tied to one node
+  void addCounter(const SbName & counter, SbTime time, uint32_t count = 1);
+  void getCountersKeyList(SbList<SbProfilingCounterKey> & keys_out) const;
+  void getCounter(SbProfilingCounterKey counter,
+                  SbTime & total, SbTime & max, uint32_t & count) const;
+
   // statistics management
   void reset(void);
 
@@ -45,6 +45,11 @@ public:
   static SbBool isOverlayActive(void);
   static SbBool isConsoleActive(void);
 
+  static void setNumExportFrames(int numframes);
+  static int getNumExportFrames(void);
+  static SbBool writeChromeTrace(const char * filename);
+  static SbBool writeCollapsedStacks(const char * filename);
+
 }; // SoProfiler
 
 #endif // !COIN_SOPROFILER_H
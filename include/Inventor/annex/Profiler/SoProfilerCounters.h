@@ -0,0 +1,67 @@
+#ifndef COIN_SOPROFILERCOUNTERS_H
+#define COIN_SOPROFILERCOUNTERS_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include <Inventor/SbBasic.h>
+#include <Inventor/system/inttypes.h>
+
+class COIN_DLL_API SoProfilerCounters {
+public:
+  enum Counter {
+    FRAMES,
+    NODES_TRAVERSED,
+    SEPARATORS_CULLED,
+    CACHE_HITS,
+    CACHE_MISSES,
+    VBO_UPLOADS,
+    TEXTURE_UPLOADS,
+    STATE_PUSHES,
+    NOTIFICATIONS,
+    NUM_COUNTERS
+  };
+
+  static void enable(SbBool enable = TRUE);
+  static SbBool isEnabled(void);
+
+  static uint64_t get(Counter counter);
+  static const char * getName(Counter counter);
+  static void reset(void);
+
+  static void setDumpInterval(double seconds);
+  static double getDumpInterval(void);
+  static void dump(void);
+
+}; // SoProfilerCounters
+
+#endif // !COIN_SOPROFILERCOUNTERS_H
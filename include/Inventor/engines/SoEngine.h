@@ -95,6 +95,9 @@ private:
   // needed for handling connections from SoEngineOutput
   friend class SoEngineOutput;
   void setDirty(void);
+
+  // needed for collecting dirty engines in SoEngineScheduler
+  friend class SoEngineSchedulerP;
 };
 
 #if !defined(COIN_INTERNAL)
@@ -72,6 +72,15 @@ public:
   SbBool exceededChangeLimit(void);
   static int setChangeLimit(const int limit);
 
+  SbBool setTileFile(const char * filename,
+                     const Wrap wraps = REPEAT,
+                     const Wrap wrapt = REPEAT,
+                     const float quality = 0.5f);
+  static SbBool isTileFile(const char * filename);
+  static SbBool writeTileFile(const char * filename, const SbImage & image,
+                              const int tilesize = 256);
+  static int setTileCacheSize(const int megabytes);
+
   // will return NULL to avoid that SoGLTextureImageElement will
   // update the texture state.
   virtual SoGLDisplayList * getGLDisplayList(SoState * state);
@@ -49,6 +49,7 @@
 class SoGLDisplayList;
 class SoState;
 class SbImage;
+class SbMatrix;
 
 class COIN_DLL_API SoGLImage {
 public:
@@ -192,11 +193,24 @@ public:
 
   void setEndFrameCallback(void (*cb)(void *), void * closure);
   int getNumFramesSinceUsed(void) const;
+  SoGLDisplayList * getAtlasGLDisplayList(SoState * state, SbMatrix & transform);
 
 public:
   static void initClass(void);
   static void setResizeCallback(SoGLImageResizeCB * f, void * closure);
 
+  static void setTextureStreaming(const SbBool onoff);
+  static SbBool isTextureStreaming(void);
+  static void setUploadBudget(const uint32_t bytesperframe);
+  static uint32_t getUploadBudget(void);
+  static uint32_t getNumUploadBytes(void);
+  static int getUploadQueueLength(void);
+  static int getUploadQueueLength(const uint32_t contextid);
+
+  static void setTextureAtlas(const SbBool onoff);
+  static SbBool isTextureAtlas(void);
+  static uint32_t getNumAtlasBindsSaved(void);
+
 private:
   static void registerImage(SoGLImage * image);
   static void unregisterImage(SoGLImage * image);
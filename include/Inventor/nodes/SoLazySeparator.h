@@ -0,0 +1,84 @@
+#ifndef COIN_SOLAZYSEPARATOR_H
+#define COIN_SOLAZYSEPARATOR_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include <Inventor/nodes/SoSubNode.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/fields/SoSFInt32.h>
+#include <Inventor/fields/SoSFBox3f.h>
+#include <Inventor/SbString.h>
+
+class SoLazySeparatorP;
+
+class COIN_DLL_API SoLazySeparator : public SoSeparator {
+  typedef SoSeparator inherited;
+
+  SO_NODE_HEADER(SoLazySeparator);
+
+public:
+  static void initClass(void);
+  SoLazySeparator(void);
+
+  SoSFInt32 chunk;
+  SoSFBox3f boundingBox;
+
+  virtual void doAction(SoAction * action);
+  virtual void callback(SoCallbackAction * action);
+  virtual void GLRenderBelowPath(SoGLRenderAction * action);
+  virtual void getBoundingBox(SoGetBoundingBoxAction * action);
+  virtual void rayPick(SoRayPickAction * action);
+  virtual void getPrimitiveCount(SoGetPrimitiveCountAction * action);
+  virtual void write(SoWriteAction * action);
+
+  virtual void copyContents(const SoFieldContainer * from,
+                            SbBool copyconnections);
+
+  void setContainerName(const SbString & filename);
+  const SbString & getContainerName(void) const;
+
+  SbBool isLoaded(void) const;
+  SbBool load(void);
+  void unload(void);
+
+protected:
+  virtual ~SoLazySeparator();
+
+  virtual SbBool readInstance(SoInput * in, unsigned short flags);
+
+private:
+  SoLazySeparatorP * pimpl;
+  friend class SoLazySeparatorP;
+};
+
+#endif // !COIN_SOLAZYSEPARATOR_H
@@ -170,5 +170,7 @@
 #include <Inventor/nodes/SoCacheHint.h>
 #include <Inventor/nodes/SoDepthBuffer.h>
 #include <Inventor/nodes/SoAlphaTest.h>
+#include <Inventor/nodes/SoLazySeparator.h>
+#include <Inventor/nodes/SoPagedGroup.h>
 
 #endif // !COIN_SONODES_H
@@ -0,0 +1,95 @@
+#ifndef COIN_SOPAGEDGROUP_H
+#define COIN_SOPAGEDGROUP_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include <Inventor/nodes/SoSubNode.h>
+#include <Inventor/fields/SoMFString.h>
+#include <Inventor/fields/SoMFInt32.h>
+#include <Inventor/fields/SoMFVec3f.h>
+#include <Inventor/fields/SoSFFloat.h>
+
+class SoPagedGroupP;
+
+class COIN_DLL_API SoPagedGroup : public SoNode {
+  typedef SoNode inherited;
+
+  SO_NODE_HEADER(SoPagedGroup);
+
+public:
+  static void initClass(void);
+  SoPagedGroup(void);
+
+  SoMFString fileName;
+  SoMFInt32 chunk;
+  SoMFVec3f bboxCenter;
+  SoMFVec3f bboxSize;
+  SoSFFloat screenSizeThreshold;
+
+  virtual void doAction(SoAction * action);
+  virtual void callback(SoCallbackAction * action);
+  virtual void GLRender(SoGLRenderAction * action);
+  virtual void getBoundingBox(SoGetBoundingBoxAction * action);
+  virtual void getMatrix(SoGetMatrixAction * action);
+  virtual void handleEvent(SoHandleEventAction * action);
+  virtual void pick(SoPickAction * action);
+  virtual void getPrimitiveCount(SoGetPrimitiveCountAction * action);
+  virtual void audioRender(SoAudioRenderAction * action);
+  virtual void search(SoSearchAction * action);
+
+  virtual SoChildList * getChildren(void) const;
+  virtual void copyContents(const SoFieldContainer * from,
+                            SbBool copyconnections);
+
+  int getNumItems(void) const;
+  SbBool isResident(int item) const;
+  SbBool load(int item);
+  void unload(int item);
+
+  static void setMemoryBudget(size_t bytes);
+  static size_t getMemoryBudget(void);
+  static size_t getResidentBytes(void);
+  static int getNumPendingLoads(void);
+  static float getEvictionsPerSecond(void);
+
+protected:
+  virtual ~SoPagedGroup();
+  virtual void notify(SoNotList * nl);
+  virtual SbBool readInstance(SoInput * in, unsigned short flags);
+
+private:
+  SoPagedGroupP * pimpl;
+  friend class SoPagedGroupP;
+};
+
+#endif // !COIN_SOPAGEDGROUP_H
@@ -571,6 +571,9 @@ SoAction::apply(SoNode * root)
       assert(elt);
       SbProfilingData & data = elt->getProfilingData();
       data.setActionStopTime(SbTime::getTimeOfDay());
+      if (SoProfilerP::isExportActive()) {
+        SoProfilerP::recordExportFrame(data);
+      }
     }
 
     if (SoProfiler::isOverlayActive() &&
@@ -1348,7 +1351,7 @@ SoAction::switchToNodeTraversal(SoNode * node)
   PRIVATE(this)->appliedcode = SoAction::NODE;
   PRIVATE(this)->applieddata.node = node;
   this->currentpathcode = SoAction::NO_PATH;
-  this->currentpath.truncate(0);
+  this->currentpath.setHead(node);
 
   this->traverse(node);
 
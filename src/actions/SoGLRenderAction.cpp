@@ -105,6 +105,7 @@
 #include <Inventor/lists/SoPathList.h>
 #include <Inventor/misc/SoState.h>
 #include <Inventor/misc/SoGLDriverDatabase.h>
+#include <Inventor/misc/SoGLImage.h>
 #include <Inventor/nodes/SoGroup.h>
 #include <Inventor/nodes/SoNode.h>
 #include <Inventor/nodes/SoSeparator.h>
@@ -128,6 +129,7 @@
 
 #include <Inventor/annex/Profiler/nodes/SoProfilerStats.h>
 #include "profiler/SoProfilerP.h"
+#include "profiler/SoProfilerCountersP.h"
 
 #ifdef HAVE_NODEKITS
 #include <Inventor/annex/Profiler/nodekits/SoProfilerTopKit.h>
@@ -1128,6 +1130,14 @@ void
 SoGLRenderAction::endTraversal(SoNode * node)
 {
   inherited::endTraversal(node);
+  if (!PRIVATE(this)->isrendering &&
+      (SoGLImage::getUploadQueueLength(PRIVATE(this)->cachecontext) > 0)) {
+    // redraw until the streamed textures of this context are uploaded
+    node->touch();
+  }
+  if (SoProfilerCountersP::enabled && !PRIVATE(this)->isrendering) {
+    SoProfilerCountersP::endFrame();
+  }
   if (SoProfilerP::shouldContinuousRender()) {
     float delay = SoProfilerP::getContinuousRenderDelay();
     if (delay == 0.0f) {
@@ -1720,6 +1730,9 @@ SoGLRenderActionP::render(SoNode * node)
                                FALSE, !this->isDirectRendering(state));
   SoGLRenderPassElement::set(state, 0);
 
+  // upload the next part of streamed textures
+  SoGLImage::beginFrame(state);
+
   this->precblist.invokeCallbacks(static_cast<void *>(this->action));
 
   if (this->action->getNumPasses() > 1 && this->internal_multipass) {
@@ -81,6 +81,7 @@
 #include <Inventor/threads/SbRWMutex.h>
 #endif // COIN_THREADSAFE
 
+#include "base/SbImageResize.h"
 #include "glue/simage_wrapper.h"
 #include "coindefs.h"
 
@@ -674,6 +675,80 @@ SbImage::getSize(void) const
   return PRIVATE(this)->size;
 }
 
+/*!
+  \enum SbImage::ResizeFilter
+
+  The filters available for resize().
+*/
+/*!
+  \var SbImage::ResizeFilter SbImage::BOX
+
+  Averages the covered pixels when an image is made smaller, and
+  picks the nearest pixel when it is made larger. Fast, and used for
+  mipmap generation.
+*/
+/*!
+  \var SbImage::ResizeFilter SbImage::LANCZOS
+
+  A three-lobed Lanczos filter. Sharper results than BOX, at about
+  three times the cost.
+*/
+
+/*!
+  Convenience 2D version of resize().
+
+  \since Coin 4.0
+*/
+SbBool
+SbImage::resize(const SbVec2s & newsize, const ResizeFilter filter)
+{
+  return this->resize(SbVec3s(newsize[0], newsize[1], 0), filter);
+}
+
+/*!
+  Resamples the image to \a newsize with \a filter. Returns \c FALSE,
+  and leaves the image unchanged, if the image is empty, has more
+  than four bytes per pixel, or if \a newsize has a zero
+  component. For 2D images, the z component of \a newsize is ignored.
+
+  Large images are resampled with several threads. The number of
+  threads can be set with the environment variable
+  COIN_IMAGE_RESIZE_NUM_THREADS, and defaults to the number of
+  processors.
+
+  \since Coin 4.0
+*/
+SbBool
+SbImage::resize(const SbVec3s & newsize, const ResizeFilter filter)
+{
+  SbVec3s size;
+  int bpp;
+  const unsigned char * bytes = this->getValue(size, bpp); // finish scheduled reads
+  const SbBool is3d = size[2] != 0;
+  if (!bytes || bpp < 1 || bpp > 4 || size[0] <= 0 || size[1] <= 0) return FALSE;
+  if (newsize[0] <= 0 || newsize[1] <= 0 || (is3d && newsize[2] <= 0)) return FALSE;
+
+  const SbVec3s targetsize(newsize[0], newsize[1], is3d ? newsize[2] : 0);
+  if (targetsize == size) return TRUE;
+
+  const size_t buffersize =
+    size_t(targetsize[0]) * size_t(targetsize[1]) *
+    size_t(is3d ? targetsize[2] : 1) * size_t(bpp);
+  // keep the buffer aligned, as in setValue()
+  unsigned char * newbytes = new unsigned char[((buffersize + 3) / 4) * 4];
+  SbImageResize::resize(bytes, size[0], size[1], size[2], bpp, newbytes,
+                        targetsize[0], targetsize[1], targetsize[2],
+                        (filter == BOX) ? SbImageResize::BOX : SbImageResize::LANCZOS);
+
+  PRIVATE(this)->writeLock();
+  PRIVATE(this)->freeData();
+  PRIVATE(this)->bytes = newbytes;
+  PRIVATE(this)->datatype = SbImageP::INTERNAL_DATA;
+  PRIVATE(this)->size = targetsize;
+  PRIVATE(this)->writeUnlock();
+  return TRUE;
+}
+
 /*!
   Add a callback which will be called whenever Coin wants to read an
   image file.  The callback should return TRUE if it was able to
@@ -752,5 +827,54 @@ BOOST_AUTO_TEST_CASE(copyConstruct)
   }
 
 }
+
+BOOST_AUTO_TEST_CASE(resize)
+{
+  SbVec3s size;
+  int nc;
+
+  // a constant image stays constant
+  SbImage constant;
+  constant.setValue(SbVec2s(64, 32), 4, NULL);
+  unsigned char * bytes = constant.getValue(size, nc);
+  for (int i = 0; i < 64 * 32 * 4; i++) bytes[i] = (unsigned char) (200 + i % 4);
+  BOOST_CHECK_MESSAGE(constant.resize(SbVec2s(17, 9)), "resize failed");
+  bytes = constant.getValue(size, nc);
+  BOOST_CHECK_MESSAGE(size == SbVec3s(17, 9, 0) && nc == 4, "wrong size");
+  SbBool ok = TRUE;
+  for (int i = 0; i < 17 * 9 * 4; i++) ok = ok && bytes[i] == 200 + i % 4;
+  BOOST_CHECK_MESSAGE(ok, "constant image changed when resized");
+
+  // halving with a box filter averages 2x2 pixels, rounding to nearest
+  SbImage gray;
+  gray.setValue(SbVec2s(32, 2), 1, NULL);
+  bytes = gray.getValue(size, nc);
+  for (int i = 0; i < 64; i++) bytes[i] = (unsigned char) ((i * 37) % 256);
+  unsigned char expected[16];
+  for (int x = 0; x < 16; x++) {
+    expected[x] = (unsigned char)
+      ((bytes[x*2] + bytes[x*2+1] + bytes[32+x*2] + bytes[32+x*2+1] + 2) >> 2);
+  }
+  BOOST_CHECK_MESSAGE(gray.resize(SbVec2s(16, 1), SbImage::BOX), "resize failed");
+  bytes = gray.getValue(size, nc);
+  ok = TRUE;
+  for (int x = 0; x < 16; x++) ok = ok && bytes[x] == expected[x];
+  BOOST_CHECK_MESSAGE(ok, "wrong box filtered values");
+
+  // 3D images are filtered along z too
+  SbImage volume;
+  volume.setValue(SbVec3s(4, 4, 4), 2, NULL);
+  bytes = volume.getValue(size, nc);
+  for (int i = 0; i < 4 * 4 * 4 * 2; i++) bytes[i] = (unsigned char) ((i / 32) * 10);
+  BOOST_CHECK_MESSAGE(volume.resize(SbVec3s(2, 2, 2), SbImage::BOX), "resize failed");
+  bytes = volume.getValue(size, nc);
+  BOOST_CHECK_MESSAGE(size == SbVec3s(2, 2, 2), "wrong 3D size");
+  ok = TRUE;
+  for (int i = 0; i < 2 * 2 * 2 * 2; i++) ok = ok && bytes[i] == ((i < 8) ? 5 : 25);
+  BOOST_CHECK_MESSAGE(ok, "wrong 3D box filtered values");
+
+  SbImage empty;
+  BOOST_CHECK_MESSAGE(!empty.resize(SbVec2s(4, 4)), "resized an empty image");
+}
 #endif //COIN_TEST_SUITE
 
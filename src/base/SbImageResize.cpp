@@ -0,0 +1,577 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+// Image resampling for SbImage::resize() and SoGLImage.
+//
+// Resizing is separable: one pass for each dimension that changes,
+// with precomputed filter weights for each output pixel. The passes
+// go through 8-bit images, and the vertical and depth passes, which
+// combine whole rows or slices, are vectorized with SSE2 when
+// available. Large images are split across threads.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include "base/SbImageResize.h"
+#include "base/SbParallel.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define COIN_SBIMAGERESIZE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// *************************************************************************
+
+// Don't bother starting threads for images with fewer output bytes
+// than this.
+static const size_t IMAGERESIZE_MIN_PARALLEL = 256 * 1024;
+
+// Returns the number of threads to use, which can be overridden with
+// the environment variable COIN_IMAGE_RESIZE_NUM_THREADS.
+static int
+imageresize_num_threads(void)
+{
+  static int num = -1;
+  if (num < 0) num = SbParallel::getNumThreads("COIN_IMAGE_RESIZE_NUM_THREADS");
+  return num;
+}
+
+static int
+imageresize_num_tasks(const size_t numbytes, const int numitems)
+{
+  if (numbytes < IMAGERESIZE_MIN_PARALLEL) return 1;
+  const int num = imageresize_num_threads();
+  return (num < numitems) ? num : numitems;
+}
+
+// *************************************************************************
+
+static inline unsigned char
+imageresize_clamp(const float val)
+{
+  if (val <= 0.0f) return 0;
+  if (val >= 255.0f) return 255;
+  return (unsigned char) (val + 0.5f);
+}
+
+static double
+imageresize_sinc(double x)
+{
+  if (x == 0.0) return 1.0;
+  x *= M_PI;
+  return sin(x) / x;
+}
+
+static double
+imageresize_filter(const SbImageResize::Filter filter, const double x)
+{
+  if (filter == SbImageResize::BOX) {
+    return (x >= -0.5 && x < 0.5) ? 1.0 : 0.0;
+  }
+  if (x <= -3.0 || x >= 3.0) return 0.0;
+  return imageresize_sinc(x) * imageresize_sinc(x / 3.0);
+}
+
+// The filter weights for one dimension: the first source index and
+// number of taps for each output index, and maxtaps weights each.
+class imageresize_coeffs {
+public:
+  imageresize_coeffs(const int insize, const int outsize,
+                     const SbImageResize::Filter filter)
+  {
+    const double scale = double(insize) / double(outsize);
+    const double filterscale = (scale > 1.0) ? scale : 1.0;
+    const double support =
+      ((filter == SbImageResize::LANCZOS) ? 3.0 : 0.5) * filterscale;
+
+    this->maxtaps = int(ceil(support)) * 2 + 1;
+    this->bounds = new int[outsize * 2];
+    this->weights = new float[outsize * this->maxtaps];
+
+    for (int i = 0; i < outsize; i++) {
+      const double center = (i + 0.5) * scale;
+      int first = int(center - support + 0.5);
+      int last = int(center + support + 0.5);
+      if (first < 0) first = 0;
+      if (last > insize) last = insize;
+
+      float * w = this->weights + i * this->maxtaps;
+      double sum = 0.0;
+      int n = last - first;
+      assert(n <= this->maxtaps);
+      for (int j = 0; j < n; j++) {
+        const double v =
+          imageresize_filter(filter, (first + j + 0.5 - center) / filterscale);
+        w[j] = float(v);
+        sum += v;
+      }
+      if (sum == 0.0) {
+        // can only happen at the edges, use the nearest pixel
+        first = int(center);
+        if (first > insize - 1) first = insize - 1;
+        n = 1;
+        w[0] = 1.0f;
+      }
+      else {
+        for (int j = 0; j < n; j++) w[j] = float(w[j] / sum);
+        // skip zero weights at the ends (box filter)
+        while (n > 1 && w[n-1] == 0.0f) n--;
+        while (n > 1 && w[0] == 0.0f) {
+          for (int j = 1; j < n; j++) w[j-1] = w[j];
+          first++;
+          n--;
+        }
+      }
+      this->bounds[i*2] = first;
+      this->bounds[i*2+1] = n;
+    }
+  }
+  ~imageresize_coeffs() {
+    delete[] this->bounds;
+    delete[] this->weights;
+  }
+
+  int * bounds;
+  float * weights;
+  int maxtaps;
+};
+
+// Resamples rows [row0, row1) horizontally.
+static void
+imageresize_horizontal(const unsigned char * src, const int width,
+                       unsigned char * dst, const int newwidth, const int nc,
+                       const imageresize_coeffs & c,
+                       const int row0, const int row1)
+{
+  for (int row = row0; row < row1; row++) {
+    const unsigned char * s = src + size_t(row) * width * nc;
+    unsigned char * d = dst + size_t(row) * newwidth * nc;
+    for (int x = 0; x < newwidth; x++) {
+      const unsigned char * p = s + c.bounds[x*2] * nc;
+      const int n = c.bounds[x*2+1];
+      const float * w = c.weights + x * c.maxtaps;
+#ifdef COIN_SBIMAGERESIZE_SSE2
+      if (nc == 4) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128 acc = _mm_setzero_ps();
+        for (int k = 0; k < n; k++) {
+          int32_t pixel;
+          memcpy(&pixel, p + k * 4, 4);
+          __m128i v = _mm_cvtsi32_si128(pixel);
+          v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(v, zero), zero);
+          acc = _mm_add_ps(acc, _mm_mul_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(w[k])));
+        }
+        __m128i v = _mm_cvtps_epi32(acc);
+        v = _mm_packs_epi32(v, v);
+        v = _mm_packus_epi16(v, v);
+        const int32_t pixel = _mm_cvtsi128_si32(v);
+        memcpy(d + x * 4, &pixel, 4);
+        continue;
+      }
+#endif // COIN_SBIMAGERESIZE_SSE2
+      float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+      for (int k = 0; k < n; k++) {
+        for (int ch = 0; ch < nc; ch++) acc[ch] += w[k] * p[k * nc + ch];
+      }
+      for (int ch = 0; ch < nc; ch++) d[x * nc + ch] = imageresize_clamp(acc[ch]);
+    }
+  }
+}
+
+// Combines lines of linesize bytes: output line i, in [out0, out1), is
+// the weighted sum of the source lines given by the coefficients. Only
+// bytes [x0, x1) of each line are computed.
+static void
+imageresize_lines(const unsigned char * src, const size_t linesize,
+                  unsigned char * dst, const imageresize_coeffs & c,
+                  const int out0, const int out1,
+                  const size_t x0, const size_t x1)
+{
+  for (int i = out0; i < out1; i++) {
+    const unsigned char * s = src + size_t(c.bounds[i*2]) * linesize;
+    const int n = c.bounds[i*2+1];
+    const float * w = c.weights + i * c.maxtaps;
+    unsigned char * d = dst + size_t(i) * linesize;
+    size_t x = x0;
+#ifdef COIN_SBIMAGERESIZE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= x1; x += 16) {
+      __m128 a0 = _mm_setzero_ps();
+      __m128 a1 = _mm_setzero_ps();
+      __m128 a2 = _mm_setzero_ps();
+      __m128 a3 = _mm_setzero_ps();
+      for (int k = 0; k < n; k++) {
+        const __m128 wk = _mm_set1_ps(w[k]);
+        const __m128i v = _mm_loadu_si128((const __m128i *) (s + k * linesize + x));
+        const __m128i lo = _mm_unpacklo_epi8(v, zero);
+        const __m128i hi = _mm_unpackhi_epi8(v, zero);
+        a0 = _mm_add_ps(a0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), wk));
+        a1 = _mm_add_ps(a1, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), wk));
+        a2 = _mm_add_ps(a2, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), wk));
+        a3 = _mm_add_ps(a3, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), wk));
+      }
+      const __m128i lo = _mm_packs_epi32(_mm_cvtps_epi32(a0), _mm_cvtps_epi32(a1));
+      const __m128i hi = _mm_packs_epi32(_mm_cvtps_epi32(a2), _mm_cvtps_epi32(a3));
+      _mm_storeu_si128((__m128i *) (d + x), _mm_packus_epi16(lo, hi));
+    }
+#endif // COIN_SBIMAGERESIZE_SSE2
+    for (; x < x1; x++) {
+      float acc = 0.0f;
+      for (int k = 0; k < n; k++) acc += w[k] * s[k * linesize + x];
+      d[x] = imageresize_clamp(acc);
+    }
+  }
+}
+
+// *************************************************************************
+
+enum imageresize_passtype {
+  IMAGERESIZE_HORIZONTAL,
+  IMAGERESIZE_VERTICAL,
+  IMAGERESIZE_DEPTH
+};
+
+struct imageresize_pass {
+  imageresize_passtype type;
+  const unsigned char * src;
+  unsigned char * dst;
+  int width, height, depth; // source size
+  int newsize;              // output size in this pass' dimension
+  int nc;
+  const imageresize_coeffs * coeffs;
+};
+
+static void
+imageresize_pass_task(void * closure, int task, int numtasks)
+{
+  const imageresize_pass * pass = (const imageresize_pass *) closure;
+  const int nc = pass->nc;
+  int begin, end;
+
+  switch (pass->type) {
+  case IMAGERESIZE_HORIZONTAL:
+    SbParallel::getRange(pass->height * pass->depth, task, numtasks, begin, end);
+    imageresize_horizontal(pass->src, pass->width, pass->dst, pass->newsize,
+                           nc, *pass->coeffs, begin, end);
+    break;
+  case IMAGERESIZE_VERTICAL:
+    {
+      // split the output rows of all slices
+      const size_t linesize = size_t(pass->width) * nc;
+      SbParallel::getRange(pass->newsize * pass->depth, task, numtasks, begin, end);
+      for (int z = begin / pass->newsize; z * pass->newsize < end; z++) {
+        const int first = z * pass->newsize;
+        const int out0 = (begin > first) ? begin - first : 0;
+        const int out1 = (end < first + pass->newsize) ? end - first : pass->newsize;
+        imageresize_lines(pass->src + size_t(z) * pass->height * linesize, linesize,
+                          pass->dst + size_t(z) * pass->newsize * linesize,
+                          *pass->coeffs, out0, out1, 0, linesize);
+      }
+    }
+    break;
+  case IMAGERESIZE_DEPTH:
+    {
+      // split each slice in 16 byte aligned ranges
+      const size_t linesize = size_t(pass->width) * pass->height * nc;
+      const int numblocks = int((linesize + 15) / 16);
+      SbParallel::getRange(numblocks, task, numtasks, begin, end);
+      size_t x1 = size_t(end) * 16;
+      if (x1 > linesize) x1 = linesize;
+      imageresize_lines(pass->src, linesize, pass->dst, *pass->coeffs,
+                        0, pass->newsize, size_t(begin) * 16, x1);
+    }
+    break;
+  }
+}
+
+// *************************************************************************
+
+// Averages numrows source rows, and pairs of pixels in them when xpair
+// is set, into one row of newwidth pixels.
+static void
+imageresize_halve_row(const unsigned char * const * rows, const int numrows,
+                      const SbBool xpair, const int newwidth, const int nc,
+                      const int shift, unsigned char * dst)
+{
+  const int round = 1 << (shift - 1);
+  int x = 0;
+
+#ifdef COIN_SBIMAGERESIZE_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i roundv = _mm_set1_epi16(short(round));
+  const __m128i shiftv = _mm_cvtsi32_si128(shift);
+  // The sums are at most 8 * 255, so 16 bits is enough. Each output
+  // vector is stored after the source bytes it covers have been read,
+  // and behind any source bytes still to be read, so halving in place
+  // is safe.
+  if (xpair && nc == 4) {
+    for (; x + 4 <= newwidth; x += 4) {
+      __m128i s0 = zero, s1 = zero, s2 = zero, s3 = zero;
+      for (int r = 0; r < numrows; r++) {
+        const __m128i a = _mm_loadu_si128((const __m128i *) (rows[r] + x * 8));
+        const __m128i b = _mm_loadu_si128((const __m128i *) (rows[r] + x * 8 + 16));
+        s0 = _mm_add_epi16(s0, _mm_unpacklo_epi8(a, zero));
+        s1 = _mm_add_epi16(s1, _mm_unpackhi_epi8(a, zero));
+        s2 = _mm_add_epi16(s2, _mm_unpacklo_epi8(b, zero));
+        s3 = _mm_add_epi16(s3, _mm_unpackhi_epi8(b, zero));
+      }
+      // each 64-bit half is one pixel, add even and odd pixels
+      __m128i p01 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1), _mm_unpackhi_epi64(s0, s1));
+      __m128i p23 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3), _mm_unpackhi_epi64(s2, s3));
+      p01 = _mm_srl_epi16(_mm_add_epi16(p01, roundv), shiftv);
+      p23 = _mm_srl_epi16(_mm_add_epi16(p23, roundv), shiftv);
+      _mm_storeu_si128((__m128i *) (dst + x * 4), _mm_packus_epi16(p01, p23));
+    }
+  }
+  else if (xpair && nc == 2) {
+    for (; x + 8 <= newwidth; x += 8) {
+      __m128i s0 = zero, s1 = zero, s2 = zero, s3 = zero;
+      for (int r = 0; r < numrows; r++) {
+        const __m128i a = _mm_loadu_si128((const __m128i *) (rows[r] + x * 4));
+        const __m128i b = _mm_loadu_si128((const __m128i *) (rows[r] + x * 4 + 16));
+        s0 = _mm_add_epi16(s0, _mm_unpacklo_epi8(a, zero));
+        s1 = _mm_add_epi16(s1, _mm_unpackhi_epi8(a, zero));
+        s2 = _mm_add_epi16(s2, _mm_unpacklo_epi8(b, zero));
+        s3 = _mm_add_epi16(s3, _mm_unpackhi_epi8(b, zero));
+      }
+      // each 32-bit lane is one pixel, gather even and odd pixels
+      s0 = _mm_shuffle_epi32(s0, _MM_SHUFFLE(3, 1, 2, 0));
+      s1 = _mm_shuffle_epi32(s1, _MM_SHUFFLE(3, 1, 2, 0));
+      s2 = _mm_shuffle_epi32(s2, _MM_SHUFFLE(3, 1, 2, 0));
+      s3 = _mm_shuffle_epi32(s3, _MM_SHUFFLE(3, 1, 2, 0));
+      __m128i p0 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1), _mm_unpackhi_epi64(s0, s1));
+      __m128i p1 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3), _mm_unpackhi_epi64(s2, s3));
+      p0 = _mm_srl_epi16(_mm_add_epi16(p0, roundv), shiftv);
+      p1 = _mm_srl_epi16(_mm_add_epi16(p1, roundv), shiftv);
+      _mm_storeu_si128((__m128i *) (dst + x * 2), _mm_packus_epi16(p0, p1));
+    }
+  }
+  else if (xpair && nc == 1) {
+    const __m128i ones = _mm_set1_epi16(1);
+    for (; x + 8 <= newwidth; x += 8) {
+      __m128i s0 = zero, s1 = zero;
+      for (int r = 0; r < numrows; r++) {
+        const __m128i a = _mm_loadu_si128((const __m128i *) (rows[r] + x * 2));
+        s0 = _mm_add_epi16(s0, _mm_unpacklo_epi8(a, zero));
+        s1 = _mm_add_epi16(s1, _mm_unpackhi_epi8(a, zero));
+      }
+      __m128i p = _mm_packs_epi32(_mm_madd_epi16(s0, ones), _mm_madd_epi16(s1, ones));
+      p = _mm_srl_epi16(_mm_add_epi16(p, roundv), shiftv);
+      _mm_storel_epi64((__m128i *) (dst + x), _mm_packus_epi16(p, zero));
+    }
+  }
+#endif // COIN_SBIMAGERESIZE_SSE2
+
+  if (xpair && numrows == 2) { // the common 2D case
+    const unsigned char * r0 = rows[0] + x * nc * 2;
+    const unsigned char * r1 = rows[1] + x * nc * 2;
+    unsigned char * d = dst + x * nc;
+    for (; x < newwidth; x++) {
+      for (int ch = 0; ch < nc; ch++) {
+        *d++ = (unsigned char) ((r0[0] + r0[nc] + r1[0] + r1[nc] + round) >> shift);
+        r0++; r1++;
+      }
+      r0 += nc; r1 += nc;
+    }
+    return;
+  }
+
+  const int step = xpair ? nc * 2 : nc;
+  for (; x < newwidth; x++) {
+    for (int ch = 0; ch < nc; ch++) {
+      int sum = 0;
+      for (int r = 0; r < numrows; r++) {
+        const unsigned char * p = rows[r] + x * step + ch;
+        sum += p[0];
+        if (xpair) sum += p[nc];
+      }
+      dst[x * nc + ch] = (unsigned char) ((sum + round) >> shift);
+    }
+  }
+}
+
+struct imageresize_halving {
+  const unsigned char * src;
+  unsigned char * dst;
+  int width, height, depth;
+  int newwidth, newheight, newdepth;
+  int nc;
+};
+
+static void
+imageresize_halve_task(void * closure, int task, int numtasks)
+{
+  const imageresize_halving * h = (const imageresize_halving *) closure;
+  const size_t rowsize = size_t(h->width) * h->nc;
+  const size_t slicesize = rowsize * h->height;
+  const SbBool xpair = h->width > 1;
+  const int ystep = (h->height > 1) ? 2 : 1;
+  const int zstep = (h->depth > 1) ? 2 : 1;
+  const int numrows = ystep * zstep;
+  const int shift = (xpair ? 1 : 0) + (ystep - 1) + (zstep - 1);
+
+  int begin, end;
+  SbParallel::getRange(h->newheight * h->newdepth, task, numtasks, begin, end);
+  for (int i = begin; i < end; i++) {
+    const int y = i % h->newheight;
+    const int z = i / h->newheight;
+    const unsigned char * rows[4];
+    const unsigned char * row = h->src + size_t(z * zstep) * slicesize + size_t(y * ystep) * rowsize;
+    int n = 0;
+    rows[n++] = row;
+    if (ystep > 1) rows[n++] = row + rowsize;
+    if (zstep > 1) {
+      rows[n++] = row + slicesize;
+      if (ystep > 1) rows[n++] = row + slicesize + rowsize;
+    }
+    imageresize_halve_row(rows, numrows, xpair, h->newwidth, h->nc, shift,
+                          h->dst + size_t(i) * h->newwidth * h->nc);
+  }
+}
+
+// *************************************************************************
+
+void
+SbImageResize::halve(const unsigned char * src,
+                     const int width, const int height, const int depth,
+                     const int nc, unsigned char * dst)
+{
+  imageresize_halving h;
+  h.src = src;
+  h.dst = dst;
+  h.width = width;
+  h.height = height;
+  h.depth = (depth < 1) ? 1 : depth;
+  h.newwidth = (width > 1) ? width >> 1 : 1;
+  h.newheight = (height > 1) ? height >> 1 : 1;
+  h.newdepth = (h.depth > 1) ? h.depth >> 1 : 1;
+  h.nc = nc;
+  assert(width > 1 || height > 1 || h.depth > 1);
+  assert(nc >= 1 && nc <= 4);
+
+  const size_t numbytes = size_t(h.newwidth) * h.newheight * h.newdepth * nc;
+  const size_t srcbytes = size_t(width) * height * h.depth * nc;
+  // rows are written behind the rows still to be read, but only when
+  // they are processed in order
+  const SbBool overlap = (dst < src + srcbytes) && (src < dst + numbytes);
+  const int numtasks =
+    overlap ? 1 : imageresize_num_tasks(numbytes, h.newheight * h.newdepth);
+  SbParallel::run(imageresize_halve_task, &h, numtasks);
+}
+
+void
+SbImageResize::resize(const unsigned char * src,
+                      const int width, const int height, const int depthin,
+                      const int nc, unsigned char * dst,
+                      const int newwidth, const int newheight,
+                      const int newdepthin, const Filter filter)
+{
+  assert(nc >= 1 && nc <= 4);
+  assert(width > 0 && height > 0 && newwidth > 0 && newheight > 0);
+  const int depth = (depthin < 1) ? 1 : depthin;
+  const int newdepth = (newdepthin < 1) ? 1 : newdepthin;
+  const size_t numbytes = size_t(newwidth) * newheight * newdepth * nc;
+
+  if (width == newwidth && height == newheight && depth == newdepth) {
+    (void) memcpy(dst, src, numbytes);
+    return;
+  }
+  // a box filter halving the image is the same as a mipmap step
+  if (filter == BOX &&
+      (width == newwidth * 2 || (width == 1 && newwidth == 1)) &&
+      (height == newheight * 2 || (height == 1 && newheight == 1)) &&
+      (depth == newdepth * 2 || (depth == 1 && newdepth == 1))) {
+    SbImageResize::halve(src, width, height, depth, nc, dst);
+    return;
+  }
+
+  const int numpasses =
+    (width != newwidth ? 1 : 0) + (height != newheight ? 1 : 0) +
+    (depth != newdepth ? 1 : 0);
+  unsigned char * tmp[2] = { NULL, NULL };
+
+  imageresize_pass pass;
+  pass.src = src;
+  pass.nc = nc;
+  pass.width = width;
+  pass.height = height;
+  pass.depth = depth;
+  int passnum = 0;
+
+  for (int dim = 0; dim < 3; dim++) {
+    const int insize = (dim == 0) ? pass.width : ((dim == 1) ? pass.height : pass.depth);
+    const int outsize = (dim == 0) ? newwidth : ((dim == 1) ? newheight : newdepth);
+    if (insize == outsize) continue;
+
+    const int w = (dim == 0) ? outsize : pass.width;
+    const int h = (dim == 1) ? outsize : pass.height;
+    const int d = (dim == 2) ? outsize : pass.depth;
+    const size_t outbytes = size_t(w) * h * d * nc;
+    passnum++;
+    if (passnum == numpasses) {
+      pass.dst = dst;
+    }
+    else {
+      tmp[passnum - 1] = new unsigned char[outbytes];
+      pass.dst = tmp[passnum - 1];
+    }
+
+    imageresize_coeffs coeffs(insize, outsize, filter);
+    pass.type = (dim == 0) ? IMAGERESIZE_HORIZONTAL : ((dim == 1) ? IMAGERESIZE_VERTICAL : IMAGERESIZE_DEPTH);
+    pass.newsize = outsize;
+    pass.coeffs = &coeffs;
+
+    int numitems;
+    switch (pass.type) {
+    case IMAGERESIZE_HORIZONTAL: numitems = pass.height * pass.depth; break;
+    case IMAGERESIZE_VERTICAL: numitems = outsize * pass.depth; break;
+    default: numitems = int((size_t(pass.width) * pass.height * nc + 15) / 16); break;
+    }
+    SbParallel::run(imageresize_pass_task, &pass,
+                    imageresize_num_tasks(outbytes, numitems));
+
+    if (passnum > 1) {
+      delete[] tmp[passnum - 2];
+      tmp[passnum - 2] = NULL;
+    }
+    pass.src = pass.dst;
+    pass.width = w;
+    pass.height = h;
+    pass.depth = d;
+  }
+}
@@ -0,0 +1,70 @@
+#ifndef COIN_SBIMAGERESIZE_H
+#define COIN_SBIMAGERESIZE_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+// *************************************************************************
+
+#include <Inventor/SbBasic.h>
+
+// Resampling and mipmap kernels for images with 1-4 components of 8
+// bits each, used by SbImage::resize() and SoGLImage. A depth of 0 or
+// 1 means a 2D image.
+class SbImageResize {
+public:
+  enum Filter {
+    BOX,    // area average when downscaling, nearest when upscaling
+    LANCZOS // three-lobed Lanczos
+  };
+
+  static void resize(const unsigned char * src,
+                     const int width, const int height, const int depth,
+                     const int nc, unsigned char * dst,
+                     const int newwidth, const int newheight,
+                     const int newdepth, const Filter filter);
+
+  // Averages 2x2 (2x2x2 for 3D) pixels into one, for the next mipmap
+  // level. Dimensions of size 1 are kept, and odd dimensions are
+  // rounded down. dst may be the same buffer as src.
+  static void halve(const unsigned char * src,
+                    const int width, const int height, const int depth,
+                    const int nc, unsigned char * dst);
+};
+
+// *************************************************************************
+
+#endif // !COIN_SBIMAGERESIZE_H
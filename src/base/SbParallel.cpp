@@ -0,0 +1,136 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include "base/SbParallel.h"
+
+#include <cassert>
+#include <cstdlib>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif // HAVE_UNISTD_H
+#ifdef HAVE_WINDOWS_H
+#include <windows.h>
+#endif // HAVE_WINDOWS_H
+
+#include <Inventor/C/tidbits.h>
+#include <Inventor/system/inttypes.h>
+
+#ifdef HAVE_THREADS
+#include <Inventor/C/threads/thread.h>
+#endif // HAVE_THREADS
+
+// *************************************************************************
+
+struct sbparallel_task {
+  SbParallel::TaskFunc * func;
+  void * closure;
+  int task;
+  int numtasks;
+};
+
+#ifdef HAVE_THREADS
+static void *
+sbparallel_task_entry(void * closure)
+{
+  sbparallel_task * task = (sbparallel_task *) closure;
+  task->func(task->closure, task->task, task->numtasks);
+  return NULL;
+}
+#endif // HAVE_THREADS
+
+// *************************************************************************
+
+int
+SbParallel::getNumThreads(const char * envvar)
+{
+  int num = 1;
+#ifdef HAVE_THREADS
+  const char * env = envvar ? coin_getenv(envvar) : NULL;
+  if (env) {
+    num = atoi(env);
+  }
+  else {
+#if defined(HAVE_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+    num = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#elif defined(HAVE_WINDOWS_H)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    num = (int) info.dwNumberOfProcessors;
+#endif
+  }
+  if (num < 1) num = 1;
+  if (num > SbParallel::MAX_THREADS) num = SbParallel::MAX_THREADS;
+#endif // HAVE_THREADS
+  return num;
+}
+
+void
+SbParallel::run(TaskFunc * func, void * closure, const int numtasks)
+{
+  assert(numtasks >= 1 && numtasks <= SbParallel::MAX_THREADS);
+#ifdef HAVE_THREADS
+  if (numtasks > 1) {
+    sbparallel_task tasks[SbParallel::MAX_THREADS];
+    cc_thread * threads[SbParallel::MAX_THREADS];
+    int i;
+    for (i = 1; i < numtasks; i++) {
+      tasks[i].func = func;
+      tasks[i].closure = closure;
+      tasks[i].task = i;
+      tasks[i].numtasks = numtasks;
+      threads[i] = cc_thread_construct(sbparallel_task_entry, &tasks[i]);
+      if (threads[i] == NULL) func(closure, i, numtasks);
+    }
+    func(closure, 0, numtasks);
+    for (i = 1; i < numtasks; i++) {
+      if (threads[i] == NULL) continue;
+      (void) cc_thread_join(threads[i], NULL);
+      cc_thread_destruct(threads[i]);
+    }
+    return;
+  }
+#endif // HAVE_THREADS
+  for (int i = 0; i < numtasks; i++) func(closure, i, numtasks);
+}
+
+void
+SbParallel::getRange(const int num, const int task, const int numtasks,
+                     int & begin, int & end)
+{
+  begin = int((int64_t(num) * task) / numtasks);
+  end = int((int64_t(num) * (task + 1)) / numtasks);
+}
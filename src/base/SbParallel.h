@@ -0,0 +1,70 @@
+#ifndef COIN_SBPARALLEL_H
+#define COIN_SBPARALLEL_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+// *************************************************************************
+
+#include <Inventor/SbBasic.h>
+
+// Splits data-parallel jobs (image resizing, STL parsing, calculator
+// programs, hidden line removal) across short-lived threads. Without
+// thread support, the tasks run one after the other on the calling
+// thread.
+class SbParallel {
+public:
+  enum { MAX_THREADS = 32 };
+
+  typedef void TaskFunc(void * closure, int task, int numtasks);
+
+  // Returns the number of threads to split a job in: the value of the
+  // environment variable envvar when it is set, the number of
+  // processors otherwise, clamped to [1, MAX_THREADS].
+  static int getNumThreads(const char * envvar);
+
+  // Calls func for task 0 to numtasks-1, in parallel when possible.
+  // The calling thread runs task 0.
+  static void run(TaskFunc * func, void * closure, const int numtasks);
+
+  // Splits [0, num) into numtasks contiguous ranges.
+  static void getRange(const int num, const int task, const int numtasks,
+                       int & begin, int & end);
+};
+
+// *************************************************************************
+
+#endif // !COIN_SBPARALLEL_H
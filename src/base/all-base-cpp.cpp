@@ -49,12 +49,14 @@
 #include "SbDict.cpp"
 #include "SbHeap.cpp"
 #include "SbImage.cpp"
+#include "SbImageResize.cpp"
 #include "SbLine.cpp"
 #include "SbDPLine.cpp"
 #include "SbMatrix.cpp"
 #include "SbDPMatrix.cpp"
 #include "SbName.cpp"
 #include "SbOctTree.cpp"
+#include "SbParallel.cpp"
 #include "SbPlane.cpp"
 #include "SbDPPlane.cpp"
 #include "SbRotation.cpp"
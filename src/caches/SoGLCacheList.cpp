@@ -58,6 +58,7 @@
 #include "tidbitsp.h"
 #include "glue/glp.h"
 #include "rendering/SoGL.h"
+#include "profiler/SoProfilerCountersP.h"
 
 // *************************************************************************
 
@@ -180,7 +181,10 @@ SoGLCacheList::call(SoGLRenderAction * action)
 {
   // do a quick return if there are no caches in the list
   int n = PRIVATE(this)->itemlist.getLength();
-  if (n == 0) return FALSE;
+  if (n == 0) {
+    SoProfilerCountersP::count(SoProfilerCounters::CACHE_MISSES);
+    return FALSE;
+  }
 
   int i;
   SoState * state = action->getState();
@@ -204,6 +208,7 @@ SoGLCacheList::call(SoGLRenderAction * action)
         SoGLLazyElement::postCacheCall(state, cache->getPostLazyState());
         cache->unref(state);
         PRIVATE(this)->numused++;
+        SoProfilerCountersP::count(SoProfilerCounters::CACHE_HITS);
 
 #if COIN_DEBUG
         // The GL error test is default disabled for this optimized
@@ -447,6 +452,7 @@ SoGLCacheList::call(SoGLRenderAction * action)
     }
   }
 #endif // debug
+  SoProfilerCountersP::count(SoProfilerCounters::CACHE_MISSES);
   return FALSE;
 }
 
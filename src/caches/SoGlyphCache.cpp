@@ -45,15 +45,38 @@
 #include <Inventor/elements/SoFontNameElement.h>
 #include <Inventor/elements/SoFontSizeElement.h>
 #include <Inventor/elements/SoComplexityElement.h>
+#include <Inventor/elements/SoCacheElement.h>
+#include <Inventor/elements/SoGLCacheContextElement.h>
+#include <Inventor/elements/SoGLVBOElement.h>
 #include <Inventor/errors/SoDebugError.h>
+#include <Inventor/misc/SoGLDriverDatabase.h>
+#include <Inventor/system/gl.h>
 
 #include "tidbitsp.h"
+#include "rendering/SoGL.h"
+#include "rendering/SoGLGlyphAtlas.h"
+#include "rendering/SoVBO.h"
+
+// the quads using one glyph atlas page
+class SoGlyphCacheAtlasGroup {
+public:
+  SbBool mono;
+  int page;
+  SbList <float> vertices; // x, y, s, t for each vertex
+  int first, count; // in SoGlyphCacheP::atlasvertices
+};
 
 class SoGlyphCacheP {
 public:
   SbList <cc_glyph2d*> glyphlist2d;
   SbList <cc_glyph3d*> glyphlist3d;
   cc_font_specification * fontspec;
+
+  SbList <SoGlyphCacheAtlasGroup *> atlasgroups;
+  SbList <float> atlasvertices;
+  SoVBO * atlasvbo;
+
+  void mergeAtlasGroups(void);
 };
 
 #define PRIVATE(obj) ((obj)->pimpl)
@@ -63,6 +86,7 @@ SoGlyphCache::SoGlyphCache(SoState * state)
 {
   PRIVATE(this) = new SoGlyphCacheP;
   PRIVATE(this)->fontspec = NULL;
+  PRIVATE(this)->atlasvbo = NULL;
 
 #if COIN_DEBUG
   if (coin_debug_caching_level() > 0) {
@@ -91,6 +115,11 @@ SoGlyphCache::~SoGlyphCache()
   for (i = 0; i < PRIVATE(this)->glyphlist3d.getLength(); i++) {
     cc_glyph3d_unref(PRIVATE(this)->glyphlist3d[i]);
   }
+  for (i = 0; i < PRIVATE(this)->atlasgroups.getLength(); i++) {
+    SoGLGlyphAtlas::unrefPage(PRIVATE(this)->atlasgroups[i]->page);
+    delete PRIVATE(this)->atlasgroups[i];
+  }
+  delete PRIVATE(this)->atlasvbo;
   delete PRIVATE(this);
 }
 
@@ -115,6 +144,155 @@ SoGlyphCache::addGlyph(cc_glyph3d * glyph)
   PRIVATE(this)->glyphlist3d.append(glyph);
 }
 
+/*
+  Add a quad that renders a glyph from a SoGLGlyphAtlas page. x, y,
+  width and height are in screen pixels, relative to the text
+  position, and pagex and pagey is the position of the glyph in the
+  page. The cache takes over the page reference returned by
+  SoGLGlyphAtlas::addGlyph(), and keeps one reference for each page
+  it uses.
+*/
+void
+SoGlyphCache::addAtlasQuad(const SbBool mono, const int page,
+                           const int x, const int y, const int width, const int height,
+                           const int pagex, const int pagey)
+{
+  SoGlyphCacheAtlasGroup * group = NULL;
+  for (int i = 0; i < PRIVATE(this)->atlasgroups.getLength(); i++) {
+    SoGlyphCacheAtlasGroup * g = PRIVATE(this)->atlasgroups[i];
+    if (g->mono == mono && g->page == page) {
+      group = g;
+      break;
+    }
+  }
+  if (group) {
+    SoGLGlyphAtlas::unrefPage(page);
+  }
+  else {
+    group = new SoGlyphCacheAtlasGroup;
+    group->mono = mono;
+    group->page = page;
+    group->first = group->count = 0;
+    PRIVATE(this)->atlasgroups.append(group);
+  }
+
+  const float scale = 1.0f / float(SoGLGlyphAtlas::getPageSize());
+  const float x0[4] = { float(x), float(x + width), float(x + width), float(x) };
+  const float y0[4] = { float(y), float(y), float(y + height), float(y + height) };
+  const float s0[4] = { float(pagex), float(pagex + width), float(pagex + width), float(pagex) };
+  const float t0[4] = { float(pagey), float(pagey), float(pagey + height), float(pagey + height) };
+  for (int i = 0; i < 4; i++) {
+    group->vertices.append(x0[i]);
+    group->vertices.append(y0[i]);
+    group->vertices.append(s0[i] * scale);
+    group->vertices.append(t0[i] * scale);
+  }
+}
+
+/*
+  Returns TRUE if there are atlas quads for mono or gray level glyphs.
+*/
+SbBool
+SoGlyphCache::hasAtlasQuads(const SbBool mono) const
+{
+  for (int i = 0; i < PRIVATE(this)->atlasgroups.getLength(); i++) {
+    if (PRIVATE(this)->atlasgroups[i]->mono == mono) return TRUE;
+  }
+  return FALSE;
+}
+
+// Moves the vertices of all groups into one array, so that they can
+// be stored in one VBO.
+void
+SoGlyphCacheP::mergeAtlasGroups(void)
+{
+  for (int i = 0; i < this->atlasgroups.getLength(); i++) {
+    SoGlyphCacheAtlasGroup * group = this->atlasgroups[i];
+    group->first = this->atlasvertices.getLength() / 4;
+    group->count = group->vertices.getLength() / 4;
+    for (int j = 0; j < group->vertices.getLength(); j++) {
+      this->atlasvertices.append(group->vertices[j]);
+    }
+    group->vertices.truncate(0, TRUE);
+  }
+}
+
+/*
+  Renders the atlas quads for mono or gray level glyphs, with one
+  draw call for each atlas page. The caller sets up the texture
+  environment and the transformation of the quads.
+*/
+void
+SoGlyphCache::renderAtlasQuads(SoState * state, const SbBool mono)
+{
+  if (PRIVATE(this)->atlasvertices.getLength() == 0) {
+    PRIVATE(this)->mergeAtlasGroups();
+  }
+  const int numvertices = PRIVATE(this)->atlasvertices.getLength() / 4;
+  if (numvertices == 0) return;
+
+  const uint32_t contextid = SoGLCacheContextElement::get(state);
+  const cc_glglue * glue = cc_glglue_instance(static_cast<int>(contextid));
+
+  const SbBool renderasvbo =
+    PRIVATE(this)->atlasvbo ||
+    SoGLVBOElement::shouldCreateVBO(state, numvertices);
+  const SbBool renderasarrays = renderasvbo ||
+    SoGLDriverDatabase::isSupported(glue, SO_GL_VERTEX_ARRAY);
+
+  const float * vertices = PRIVATE(this)->atlasvertices.getArrayPtr();
+  const GLvoid * vertexptr = vertices;
+  const GLvoid * texcoordptr = vertices + 2;
+  if (renderasvbo) {
+    if (!SoGLDriverDatabase::isSupported(glue, SO_GL_VBO_IN_DISPLAYLIST)) {
+      SoCacheElement::invalidate(state);
+      SoGLCacheContextElement::shouldAutoCache(state,
+                                               SoGLCacheContextElement::DONT_AUTO_CACHE);
+    }
+    if (PRIVATE(this)->atlasvbo == NULL) {
+      PRIVATE(this)->atlasvbo = new SoVBO;
+      PRIVATE(this)->atlasvbo->setBufferData(vertices,
+                                             numvertices * 4 * sizeof(float));
+    }
+    PRIVATE(this)->atlasvbo->bindBuffer(contextid);
+    vertexptr = NULL;
+    texcoordptr = reinterpret_cast<const GLvoid *>(2 * sizeof(float));
+  }
+  if (renderasarrays) {
+    cc_glglue_glVertexPointer(glue, 2, GL_FLOAT, 4 * sizeof(float), vertexptr);
+    cc_glglue_glTexCoordPointer(glue, 2, GL_FLOAT, 4 * sizeof(float), texcoordptr);
+    cc_glglue_glEnableClientState(glue, GL_VERTEX_ARRAY);
+    cc_glglue_glEnableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+  }
+
+  for (int i = 0; i < PRIVATE(this)->atlasgroups.getLength(); i++) {
+    const SoGlyphCacheAtlasGroup * group = PRIVATE(this)->atlasgroups[i];
+    if (group->mono != mono) continue;
+    SoGLGlyphAtlas::bindPage(state, group->page);
+    if (renderasarrays) {
+      cc_glglue_glDrawArrays(glue, GL_QUADS, group->first, group->count);
+    }
+    else {
+      // fall back to immediate mode rendering
+      const float * v = vertices + group->first * 4;
+      glBegin(GL_QUADS);
+      for (int j = 0; j < group->count; j++, v += 4) {
+        glTexCoord2f(v[2], v[3]);
+        glVertex2f(v[0], v[1]);
+      }
+      glEnd();
+    }
+  }
+
+  if (renderasarrays) {
+    cc_glglue_glDisableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+    cc_glglue_glDisableClientState(glue, GL_VERTEX_ARRAY);
+  }
+  if (renderasvbo) {
+    cc_glglue_glBindBuffer(glue, GL_ARRAY_BUFFER, 0); // Reset VBO binding
+  }
+}
+
 /*!
   Read and store current font specification. Will create cache dependencies
   since some elements are read. We can't read the font specification in the
@@ -65,6 +65,12 @@ public:
   void addGlyph(cc_glyph2d * glyph);
   void addGlyph(cc_glyph3d * glyph);
 
+  void addAtlasQuad(const SbBool mono, const int page,
+                    const int x, const int y, const int width, const int height,
+                    const int pagex, const int pagey);
+  SbBool hasAtlasQuads(const SbBool mono) const;
+  void renderAtlasQuads(SoState * state, const SbBool mono);
+
 private:
   friend class SoGlyphCacheP;
   SoGlyphCacheP * pimpl;
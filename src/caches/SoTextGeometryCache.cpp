@@ -0,0 +1,393 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoTextGeometryCache SoTextGeometryCache.h
+  The SoTextGeometryCache class stores triangulated SoText3 geometry.
+
+  \internal
+*/
+
+#include "caches/SoTextGeometryCache.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <cassert>
+#include <cstdlib>
+
+#include <Inventor/C/glue/gl.h>
+#include <Inventor/elements/SoCacheElement.h>
+#include <Inventor/elements/SoGLCacheContextElement.h>
+#include <Inventor/elements/SoGLVBOElement.h>
+#include <Inventor/misc/SoGLDriverDatabase.h>
+#include <Inventor/misc/SoState.h>
+#include <Inventor/system/gl.h>
+
+#ifdef COIN_THREADSAFE
+#include <Inventor/threads/SbMutex.h>
+#endif // COIN_THREADSAFE
+
+#include "tidbitsp.h"
+#include "misc/SbFlatHash.h"
+#include "rendering/SoGL.h"
+#include "rendering/SoVBO.h"
+#include "rendering/SoVertexArrayIndexer.h"
+
+// *************************************************************************
+
+// the number of floats for each vertex: texcoord, normal and vertex
+#define TEXTGEOM_VERTEX_SIZE 8
+
+typedef SbFlatHash<SbString, SoTextGeometryCache *> textgeom_map;
+
+static textgeom_map * textgeom_store = NULL;
+static size_t textgeom_memory = 0;
+static size_t textgeom_maxsize = 0;
+static SoTextGeometryCache * textgeom_unusedhead = NULL;
+static SoTextGeometryCache * textgeom_unusedtail = NULL;
+
+#ifdef COIN_THREADSAFE
+static SbMutex * textgeom_mutex = NULL;
+#define LOCK_TEXTGEOM if (textgeom_mutex) textgeom_mutex->lock()
+#define UNLOCK_TEXTGEOM if (textgeom_mutex) textgeom_mutex->unlock()
+#else // COIN_THREADSAFE
+#define LOCK_TEXTGEOM
+#define UNLOCK_TEXTGEOM
+#endif // !COIN_THREADSAFE
+
+// *************************************************************************
+
+SoTextGeometryCache::SoTextGeometryCache(const SbString & keyarg)
+  : key(keyarg),
+    refcount(0),
+    instore(FALSE),
+    indexer(new SoVertexArrayIndexer),
+    vbo(NULL),
+    prevunused(NULL),
+    nextunused(NULL)
+{
+}
+
+SoTextGeometryCache::~SoTextGeometryCache()
+{
+  delete this->indexer;
+  delete this->vbo;
+}
+
+void
+SoTextGeometryCache::initClass(void)
+{
+#ifdef COIN_THREADSAFE
+  textgeom_mutex = new SbMutex;
+#endif // COIN_THREADSAFE
+  textgeom_store = new textgeom_map;
+  if (textgeom_maxsize == 0) {
+    const char * env = coin_getenv("COIN_TEXT3_GEOMETRY_CACHE_SIZE");
+    const int mb = env ? atoi(env) : 0;
+    textgeom_maxsize = size_t(mb > 0 ? mb : 32) * 1024 * 1024;
+  }
+  coin_atexit((coin_atexit_f *) SoTextGeometryCache::cleanup, CC_ATEXIT_NORMAL);
+}
+
+// The nodes may still hold references, so only the unused geometry
+// is freed.
+void
+SoTextGeometryCache::cleanup(void)
+{
+  SoTextGeometryCache * geometry = textgeom_unusedhead;
+  while (geometry) {
+    SoTextGeometryCache * next = geometry->nextunused;
+    delete geometry;
+    geometry = next;
+  }
+  textgeom_unusedhead = textgeom_unusedtail = NULL;
+  for (textgeom_map::const_iterator it = textgeom_store->const_begin();
+       it != textgeom_store->const_end(); ++it) {
+    it->obj->instore = FALSE;
+  }
+  delete textgeom_store;
+  textgeom_store = NULL;
+  textgeom_memory = 0;
+  textgeom_maxsize = 0;
+#ifdef COIN_THREADSAFE
+  delete textgeom_mutex;
+  textgeom_mutex = NULL;
+#endif // COIN_THREADSAFE
+}
+
+SoTextGeometryCache *
+SoTextGeometryCache::find(const SbString & key)
+{
+  LOCK_TEXTGEOM;
+  SoTextGeometryCache * geometry = NULL;
+  if (textgeom_store && textgeom_store->get(key, geometry)) {
+    geometry->ref();
+  }
+  UNLOCK_TEXTGEOM;
+  return geometry;
+}
+
+SoTextGeometryCache *
+SoTextGeometryCache::create(const SbString & key)
+{
+  SoTextGeometryCache * geometry = new SoTextGeometryCache(key);
+  geometry->refcount = 1;
+  return geometry;
+}
+
+int
+SoTextGeometryCache::addVertex(const SbVec3f & v, const SbVec3f & n,
+                               const SbVec2f & texcoord)
+{
+  const int idx = this->vertices.getLength() / TEXTGEOM_VERTEX_SIZE;
+  this->vertices.append(texcoord[0]);
+  this->vertices.append(texcoord[1]);
+  this->vertices.append(n[0]);
+  this->vertices.append(n[1]);
+  this->vertices.append(n[2]);
+  this->vertices.append(v[0]);
+  this->vertices.append(v[1]);
+  this->vertices.append(v[2]);
+  return idx;
+}
+
+void
+SoTextGeometryCache::addTriangle(const int v0, const int v1, const int v2)
+{
+  this->indexer->addTriangle(v0, v1, v2);
+}
+
+/*
+  Stores the geometry, so that find() returns it for its key. Unused
+  geometry is freed if the cache becomes too large.
+*/
+void
+SoTextGeometryCache::close(void)
+{
+  this->vertices.fit();
+  this->indexer->close();
+
+  LOCK_TEXTGEOM;
+  SoTextGeometryCache * old = NULL;
+  if (textgeom_store && !textgeom_store->get(this->key, old)) {
+    textgeom_store->put(this->key, this);
+    this->instore = TRUE;
+    textgeom_memory += this->getSize();
+    SoTextGeometryCache::evict();
+  }
+  UNLOCK_TEXTGEOM;
+}
+
+int
+SoTextGeometryCache::getNumVertices(void) const
+{
+  return this->vertices.getLength() / TEXTGEOM_VERTEX_SIZE;
+}
+
+int
+SoTextGeometryCache::getNumTriangles(void) const
+{
+  return this->indexer->getNumIndices() / 3;
+}
+
+size_t
+SoTextGeometryCache::getSize(void) const
+{
+  return sizeof(SoTextGeometryCache) + sizeof(SoVertexArrayIndexer) +
+    this->key.getLength() +
+    this->vertices.getLength() * sizeof(float) +
+    this->indexer->getNumIndices() * sizeof(GLint);
+}
+
+// Called with the mutex held.
+void
+SoTextGeometryCache::ref(void)
+{
+  if (this->refcount++ == 0 && this->instore) {
+    // remove from the list of unused geometry
+    if (this->prevunused) this->prevunused->nextunused = this->nextunused;
+    else textgeom_unusedhead = this->nextunused;
+    if (this->nextunused) this->nextunused->prevunused = this->prevunused;
+    else textgeom_unusedtail = this->prevunused;
+    this->prevunused = this->nextunused = NULL;
+  }
+}
+
+void
+SoTextGeometryCache::unref(void)
+{
+  LOCK_TEXTGEOM;
+  assert(this->refcount > 0);
+  if (--this->refcount == 0) {
+    if (this->instore) {
+      this->prevunused = textgeom_unusedtail;
+      this->nextunused = NULL;
+      if (textgeom_unusedtail) textgeom_unusedtail->nextunused = this;
+      else textgeom_unusedhead = this;
+      textgeom_unusedtail = this;
+      SoTextGeometryCache::evict();
+    }
+    else {
+      delete this;
+    }
+  }
+  UNLOCK_TEXTGEOM;
+}
+
+// Frees unused geometry until the cache is within its limit. Called
+// with the mutex held.
+void
+SoTextGeometryCache::evict(void)
+{
+  while (textgeom_memory > textgeom_maxsize && textgeom_unusedhead) {
+    SoTextGeometryCache * geometry = textgeom_unusedhead;
+    textgeom_unusedhead = geometry->nextunused;
+    if (textgeom_unusedhead) textgeom_unusedhead->prevunused = NULL;
+    else textgeom_unusedtail = NULL;
+    textgeom_store->erase(geometry->key);
+    textgeom_memory -= geometry->getSize();
+    delete geometry;
+  }
+}
+
+void
+SoTextGeometryCache::render(SoState * state, const SbBool texture)
+{
+  const int numvertices = this->getNumVertices();
+  if (this->getNumTriangles() == 0) return;
+
+  const uint32_t contextid = SoGLCacheContextElement::get(state);
+  const cc_glglue * glue = cc_glglue_instance(static_cast<int>(contextid));
+  const float * data = this->vertices.getArrayPtr();
+  const GLsizei stride = TEXTGEOM_VERTEX_SIZE * sizeof(float);
+
+  // the VBOs are created and bound per context, and the geometry
+  // can be shared by nodes rendered from different threads
+  LOCK_TEXTGEOM;
+  const SbBool renderasvbo =
+    this->vbo || SoGLVBOElement::shouldCreateVBO(state, numvertices);
+
+  if (renderasvbo || SoGLDriverDatabase::isSupported(glue, SO_GL_VERTEX_ARRAY)) {
+    const char * base = reinterpret_cast<const char *>(data);
+    if (renderasvbo) {
+      if (!SoGLDriverDatabase::isSupported(glue, SO_GL_VBO_IN_DISPLAYLIST)) {
+        SoCacheElement::invalidate(state);
+        SoGLCacheContextElement::shouldAutoCache(state,
+                                                 SoGLCacheContextElement::DONT_AUTO_CACHE);
+      }
+      if (this->vbo == NULL) {
+        this->vbo = new SoVBO;
+        this->vbo->setBufferData(data, this->vertices.getLength() * sizeof(float));
+      }
+      this->vbo->bindBuffer(contextid);
+      base = NULL;
+    }
+    if (texture) {
+      cc_glglue_glTexCoordPointer(glue, 2, GL_FLOAT, stride, base);
+      cc_glglue_glEnableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+    }
+    cc_glglue_glNormalPointer(glue, GL_FLOAT, stride, base + 2 * sizeof(float));
+    cc_glglue_glEnableClientState(glue, GL_NORMAL_ARRAY);
+    cc_glglue_glVertexPointer(glue, 3, GL_FLOAT, stride, base + 5 * sizeof(float));
+    cc_glglue_glEnableClientState(glue, GL_VERTEX_ARRAY);
+
+    this->indexer->render(glue, renderasvbo, contextid);
+
+    if (texture) cc_glglue_glDisableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+    cc_glglue_glDisableClientState(glue, GL_NORMAL_ARRAY);
+    cc_glglue_glDisableClientState(glue, GL_VERTEX_ARRAY);
+    if (renderasvbo) {
+      cc_glglue_glBindBuffer(glue, GL_ARRAY_BUFFER, 0); // Reset VBO binding
+    }
+  }
+  else {
+    // fall back to immediate mode rendering
+    const GLint * indices = this->indexer->getIndices();
+    const int numindices = this->indexer->getNumIndices();
+    glBegin(GL_TRIANGLES);
+    for (int i = 0; i < numindices; i++) {
+      const float * v = data + indices[i] * TEXTGEOM_VERTEX_SIZE;
+      if (texture) glTexCoord2fv(v);
+      glNormal3fv(v + 2);
+      glVertex3fv(v + 5);
+    }
+    glEnd();
+  }
+  UNLOCK_TEXTGEOM;
+}
+
+/*
+  Sets the limit for the memory used by unused geometry.
+*/
+void
+SoTextGeometryCache::setMaxSize(const size_t bytes)
+{
+  LOCK_TEXTGEOM;
+  textgeom_maxsize = bytes;
+  if (textgeom_store) SoTextGeometryCache::evict();
+  UNLOCK_TEXTGEOM;
+}
+
+size_t
+SoTextGeometryCache::getMaxSize(void)
+{
+  return textgeom_maxsize;
+}
+
+/*
+  Returns the number of bytes used by the stored geometry, including
+  the geometry that is in use.
+*/
+size_t
+SoTextGeometryCache::getMemoryUsage(void)
+{
+  LOCK_TEXTGEOM;
+  const size_t bytes = textgeom_memory;
+  UNLOCK_TEXTGEOM;
+  return bytes;
+}
+
+// Returns the number of keys with stored geometry, used or not.
+int
+SoTextGeometryCache::getNumEntries(void)
+{
+  LOCK_TEXTGEOM;
+  const int num = textgeom_store ? int(textgeom_store->getNumElements()) : 0;
+  UNLOCK_TEXTGEOM;
+  return num;
+}
+
+#undef LOCK_TEXTGEOM
+#undef UNLOCK_TEXTGEOM
+#undef TEXTGEOM_VERTEX_SIZE
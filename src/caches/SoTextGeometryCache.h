@@ -0,0 +1,113 @@
+#ifndef COIN_SOTEXTGEOMETRYCACHE_H
+#define COIN_SOTEXTGEOMETRYCACHE_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+// *************************************************************************
+
+#include <cstddef>
+
+#include <Inventor/SbString.h>
+#include <Inventor/SbVec2f.h>
+#include <Inventor/SbVec3f.h>
+#include <Inventor/lists/SbList.h>
+
+class SoState;
+class SoVBO;
+class SoVertexArrayIndexer;
+
+// Triangulated geometry for one part of an SoText3 node, shared by
+// all nodes that render the same strings with the same font, profile
+// and layout. The key identifies the geometry, and is created by the
+// node.
+//
+// Geometry that is no longer used by any node is kept until the total
+// size of the cached geometry exceeds getMaxSize(), and is then freed
+// in least recently used order. Geometry that is in use is never
+// freed, so the memory usage can exceed the limit if the scene graph
+// has more text than that.
+class SoTextGeometryCache {
+public:
+  // Returns the geometry stored for key, ref'ed, or NULL.
+  static SoTextGeometryCache * find(const SbString & key);
+  // Returns new, ref'ed geometry for key. Add the vertices and
+  // triangles, and call close() to store it.
+  static SoTextGeometryCache * create(const SbString & key);
+
+  int addVertex(const SbVec3f & v, const SbVec3f & n, const SbVec2f & texcoord);
+  void addTriangle(const int v0, const int v1, const int v2);
+  void close(void);
+
+  const SbString & getKey(void) const { return this->key; }
+  int getNumVertices(void) const;
+  int getNumTriangles(void) const;
+
+  // Renders the triangles with normals, and with texture coordinates
+  // if texture is TRUE.
+  void render(SoState * state, const SbBool texture);
+
+  void unref(void);
+
+  static void setMaxSize(const size_t bytes);
+  static size_t getMaxSize(void);
+  static size_t getMemoryUsage(void);
+  static int getNumEntries(void);
+
+  static void initClass(void);
+
+private:
+  SoTextGeometryCache(const SbString & key);
+  ~SoTextGeometryCache();
+  void ref(void);
+  size_t getSize(void) const;
+  static void evict(void);
+  static void cleanup(void);
+
+  SbString key;
+  int refcount;
+  SbBool instore; // FALSE if another thread stored the key first
+  SbList <float> vertices; // texcoord, normal and vertex for each vertex
+  SoVertexArrayIndexer * indexer;
+  SoVBO * vbo;
+  // the list of unused geometry, least recently used first
+  SoTextGeometryCache * prevunused;
+  SoTextGeometryCache * nextunused;
+};
+
+// *************************************************************************
+
+#endif // !COIN_SOTEXTGEOMETRYCACHE_H
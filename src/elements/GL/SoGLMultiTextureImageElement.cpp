@@ -49,12 +49,14 @@
 #include <Inventor/elements/SoGLCacheContextElement.h>
 #include <Inventor/elements/SoGLDisplayList.h>
 #include <Inventor/elements/SoTextureCombineElement.h>
+#include <Inventor/elements/SoMultiTextureMatrixElement.h>
 #include <Inventor/elements/SoShapeStyleElement.h>
 #include <Inventor/elements/SoGLShaderProgramElement.h>
 #include <Inventor/actions/SoGLRenderAction.h>
 #include <Inventor/misc/SoGLImage.h>
 #include <Inventor/misc/SoGLBigImage.h>
 #include <Inventor/SbImage.h>
+#include <Inventor/SbMatrix.h>
 #include <Inventor/C/tidbits.h>
 #include <Inventor/lists/SbList.h>
 
@@ -68,6 +70,7 @@
 
 #include "shaders/SoGLShaderProgram.h"
 #include "rendering/SoGL.h" // GL wrapper.
+#include "rendering/SoGLTextureAtlas.h"
 
 // *************************************************************************
 
@@ -327,7 +330,10 @@ SoGLMultiTextureImageElement::updateGL(const int unit)
 
     const UnitData & ud = this->getUnitData(unit);
     SoState * state = PRIVATE(this)->state;
-    SoGLDisplayList * dl = glud.glimage->getGLDisplayList(state);
+    SbMatrix atlasmatrix;
+    SoGLDisplayList * dl = glud.glimage->getAtlasGLDisplayList(state, atlasmatrix);
+    const SbBool atlas = dl != NULL;
+    if (!atlas) dl = glud.glimage->getGLDisplayList(state);
 
     // tag image (for GLImage LRU cache).
     SoGLImage::tagImage(state, glud.glimage);
@@ -362,7 +368,15 @@ SoGLMultiTextureImageElement::updateGL(const int unit)
       SoTextureCombineElement::apply(state, unit);
     }
     if (dl) {
-      dl->call(state);
+      if (atlas) SoGLTextureAtlas::bind(state, dl);
+      else dl->call(state);
+    }
+    // textures in atlases need the texture matrix to address their
+    // part of the atlas
+    if (atlas || SoGLTextureAtlas::isInUse()) {
+      SoGLTextureAtlas::loadTextureMatrix(PRIVATE(this)->cachecontext, unit,
+                                          SoMultiTextureMatrixElement::get(state, unit),
+                                          atlas ? &atlasmatrix : NULL);
     }
     cc_glglue_glActiveTexture(glue, (GLenum) GL_TEXTURE0);
 
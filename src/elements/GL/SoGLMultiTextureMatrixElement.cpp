@@ -53,6 +53,8 @@
 
 #include <Inventor/system/gl.h>
 
+#include "rendering/SoGLTextureAtlas.h"
+
 SO_ELEMENT_SOURCE(SoGLMultiTextureMatrixElement);
 
 /*!
@@ -154,14 +156,25 @@ SoGLMultiTextureMatrixElement::updategl(const int unit) const
   if (unit != 0) {
     cc_glglue_glActiveTexture(glue, (GLenum) (int(GL_TEXTURE0) + unit));
   }
-  glMatrixMode(GL_TEXTURE);
-  if (unit < this->getNumUnits()) {
-    glLoadMatrixf(this->getUnitData(unit).textureMatrix[0]);
+  SbMatrix atlasmatrix;
+  if (SoGLTextureAtlas::getUnitTransform(this->cachecontext, unit, atlasmatrix)) {
+    // the texture is in an atlas
+    SoGLTextureAtlas::loadTextureMatrix(this->cachecontext, unit,
+                                        (unit < this->getNumUnits()) ?
+                                        this->getUnitData(unit).textureMatrix :
+                                        SbMatrix::identity(),
+                                        &atlasmatrix);
   }
   else {
-    glLoadIdentity();
+    glMatrixMode(GL_TEXTURE);
+    if (unit < this->getNumUnits()) {
+      glLoadMatrixf(this->getUnitData(unit).textureMatrix[0]);
+    }
+    else {
+      glLoadIdentity();
+    }
+    glMatrixMode(GL_MODELVIEW);
   }
-  glMatrixMode(GL_MODELVIEW);
   if (unit != 0) {
     cc_glglue_glActiveTexture(glue, (GLenum) GL_TEXTURE0);
   }
@@ -198,6 +198,14 @@
 
   \endcode
 
+  When the expressions change, they are compiled into a register
+  program which evaluates all the input field values in a few tight
+  loops, instead of evaluating the expressions once for each value.
+  Expressions using \e rand() are evaluated value by value, since the
+  random numbers must be drawn in the same order. Large inputs can
+  be split across several threads by setting the environment variable
+  COIN_CALCULATOR_NUM_THREADS. The results are the same in all cases.
+
   In the example, the color of the Cube is a function of the intensity
   of the DirectionalLight, even though the Cube is rendered without
   lighting because of the BASE_COLOR LightModel.
@@ -209,15 +217,22 @@
 #include "SbBasicP.h"
 
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 
-#include <Inventor/lists/SoEngineOutputList.h>
-
-#if COIN_DEBUG
+#include <Inventor/C/tidbits.h>
 #include <Inventor/errors/SoDebugError.h>
-#endif // COIN_DEBUG
+#include <Inventor/lists/SoEngineOutputList.h>
 
+#include "base/SbParallel.h"
 #include "engines/evaluator.h"
 #include "engines/SoSubEngineP.h"
+#include "threads/threadsutilp.h"
+#include "tidbitsp.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
 
 /*!
   \var SoMFFloat SoCalculator::a
@@ -320,8 +335,82 @@
   (SoMFVec3f) Output value with result from the calculations.
 */
 
+// *************************************************************************
+
+// Don't split inputs smaller than this across threads.
+static const int CALCULATOR_MIN_ELEMENTS_PER_THREAD = 16384;
+static const int CALCULATOR_MAX_THREADS = 16;
+
+// The expression parser keeps its state in globals, and calculators
+// may be evaluated from several threads by SoEngineScheduler.
+static void * calculator_parsemutex = NULL;
+
+static void
+calculator_cleanup(void)
+{
+  CC_MUTEX_DESTRUCT(calculator_parsemutex);
+}
+
+// Returns the number of threads to evaluate large inputs with, from
+// the environment variable COIN_CALCULATOR_NUM_THREADS.
+static int
+calculator_num_threads(void)
+{
+  static int num = -1;
+  if (num < 0) {
+    num = 1;
+#ifdef HAVE_THREADS
+    const char * env = coin_getenv("COIN_CALCULATOR_NUM_THREADS");
+    if (env) num = SbClamp(atoi(env), 1, CALCULATOR_MAX_THREADS);
+#endif // HAVE_THREADS
+  }
+  return num;
+}
+
+// Set COIN_CALCULATOR_INTERPRET=1 to always evaluate the expression
+// trees, for debugging.
+static SbBool
+calculator_interpret(void)
+{
+  static int interpret = -1;
+  if (interpret < 0) {
+    const char * env = coin_getenv("COIN_CALCULATOR_INTERPRET");
+    interpret = (env && atoi(env) > 0) ? 1 : 0;
+  }
+  return interpret ? TRUE : FALSE;
+}
+
+// The inputs, outputs and temporary registers of one evaluation of a
+// compiled program.
+struct SoCalculatorRun {
+  const so_eval_program * program;
+  int num;
+  const float * inflt[8];
+  int infltnum[8];
+  const SbVec3f * invec[8];
+  int invecnum[8];
+  float * outflt[4];
+  SbVec3f * outvec[4];
+  float tmp[SO_EVAL_NUM_TMP_SLOTS];     // values before the first element
+  float lasttmp[SO_EVAL_NUM_TMP_SLOTS]; // values after the last element
+};
+
 class SoCalculatorP {
 public:
+  SoCalculatorP(void)
+    : program(NULL), outbuffer(NULL), outbuffersize(0),
+      slots(NULL), slotssize(0) { }
+  ~SoCalculatorP() {
+    free(this->outbuffer);
+    free(this->slots);
+  }
+
+  static SbBool growBuffer(float *& buffer, size_t & size, size_t num);
+
+  void runProgram(int numthreads);
+  static void runRange(SoCalculatorRun * run, float * slots, int start, int end);
+  static void runTask(void * closure, int task, int numtasks);
+
   float ta_th[8];
   SbVec3f tA_tH[8];
 
@@ -330,8 +419,142 @@ public:
   float oa_od[4];
   SbVec3f oA_oD[4];
   SbList <struct so_eval_node*> evaluatorList;
+
+  so_eval_program * program;
+  SoCalculatorRun run;
+  float * outbuffer;
+  size_t outbuffersize;
+  float * slots;
+  size_t slotssize;
+};
+
+// Reallocates buffer if it holds less than num floats. Returns FALSE,
+// and keeps the old buffer, if it could not be reallocated.
+SbBool
+SoCalculatorP::growBuffer(float *& buffer, size_t & size, size_t num)
+{
+  if (num > size) {
+    float * newbuffer = static_cast<float *>(malloc(num * sizeof(float)));
+    if (newbuffer == NULL) return FALSE;
+    free(buffer);
+    buffer = newbuffer;
+    size = num;
+  }
+  return TRUE;
+}
+
+// Evaluates the elements [start, end) of a run, in blocks.
+void
+SoCalculatorP::runRange(SoCalculatorRun * run, float * slots, int start, int end)
+{
+  const so_eval_program * program = run->program;
+  const int blocksize = program->sequential ? 1 : SO_EVAL_BLOCKSIZE;
+  int i, k;
+
+  // temporary registers start out with the value after the previous
+  // element. Unless the program is sequential, the registers read
+  // before they are written have the same value for all elements
+  for (i = 0; i < SO_EVAL_NUM_TMP_SLOTS; i++) {
+    if (program->tmpreadfirst[i] || program->sequential) {
+      float * d = slots + (SO_EVAL_SLOT_TMP_FLT + i) * SO_EVAL_BLOCKSIZE;
+      for (k = 0; k < blocksize; k++) d[k] = run->tmp[i];
+    }
+  }
+
+  for (int block = start; block < end; block += blocksize) {
+    const int n = SbMin(blocksize, end - block);
+
+    // load inputs, repeating the last value of short fields
+    for (i = 0; i < 8; i++) {
+      if (!program->inused[i]) continue;
+      float * d = slots + (SO_EVAL_SLOT_IN_FLT + i) * SO_EVAL_BLOCKSIZE;
+      const int num = run->infltnum[i];
+      const float * values = run->inflt[i];
+      if (block + n <= num) {
+        memcpy(d, values + block, n * sizeof(float));
+      }
+      else {
+        for (k = 0; k < n; k++) d[k] = num ? values[SbMin(block + k, num - 1)] : 0.0f;
+      }
+    }
+    for (i = 0; i < 8; i++) {
+      if (!program->inused[i + 8]) continue;
+      float * d = slots + (SO_EVAL_SLOT_IN_VEC + i * 3) * SO_EVAL_BLOCKSIZE;
+      const int num = run->invecnum[i];
+      const SbVec3f * values = run->invec[i];
+      for (k = 0; k < n; k++) {
+        const int idx = SbMin(block + k, num - 1);
+        const float * v = num ? values[idx].getValue() : NULL;
+        d[k] = v ? v[0] : 0.0f;
+        d[k + SO_EVAL_BLOCKSIZE] = v ? v[1] : 0.0f;
+        d[k + 2 * SO_EVAL_BLOCKSIZE] = v ? v[2] : 0.0f;
+      }
+    }
+
+    so_eval_program_run(program, slots, n);
+
+    for (i = 0; i < 4; i++) {
+      if (!program->outused[i]) continue;
+      memcpy(run->outflt[i] + block,
+             slots + (SO_EVAL_SLOT_OUT_FLT + i) * SO_EVAL_BLOCKSIZE,
+             n * sizeof(float));
+    }
+    for (i = 0; i < 4; i++) {
+      if (!program->outused[i + 4]) continue;
+      const float * s = slots + (SO_EVAL_SLOT_OUT_VEC + i * 3) * SO_EVAL_BLOCKSIZE;
+      SbVec3f * out = run->outvec[i] + block;
+      for (k = 0; k < n; k++) {
+        out[k].setValue(s[k], s[k + SO_EVAL_BLOCKSIZE], s[k + 2 * SO_EVAL_BLOCKSIZE]);
+      }
+    }
+
+    if (block + n == run->num) {
+      for (i = 0; i < SO_EVAL_NUM_TMP_SLOTS; i++) {
+        run->lasttmp[i] = slots[(SO_EVAL_SLOT_TMP_FLT + i) * SO_EVAL_BLOCKSIZE + n - 1];
+      }
+    }
+  }
+}
+
+struct SoCalculatorTask {
+  SoCalculatorRun * run;
+  float * slots; // the registers of all the tasks, one after the other
 };
 
+void
+SoCalculatorP::runTask(void * closure, int task, int numtasks)
+{
+  SoCalculatorTask * t = static_cast<SoCalculatorTask *>(closure);
+  SoCalculatorRun * run = t->run;
+
+  // split in whole blocks
+  const int numblocks = (run->num + SO_EVAL_BLOCKSIZE - 1) / SO_EVAL_BLOCKSIZE;
+  int start, end;
+  SbParallel::getRange(numblocks, task, numtasks, start, end);
+  start = SbMin(run->num, start * SO_EVAL_BLOCKSIZE);
+  end = SbMin(run->num, end * SO_EVAL_BLOCKSIZE);
+
+  SoCalculatorP::runRange(run, t->slots + task * run->program->numslots * SO_EVAL_BLOCKSIZE,
+                          start, end);
+}
+
+// Evaluates the compiled program for all elements set up in
+// this->run. this->slots has room for the registers of numthreads
+// threads.
+void
+SoCalculatorP::runProgram(int numthreads)
+{
+  if (numthreads > 1) {
+    SoCalculatorTask task;
+    task.run = &this->run;
+    task.slots = this->slots;
+    SbParallel::run(SoCalculatorP::runTask, &task, numthreads);
+  }
+  else {
+    SoCalculatorP::runRange(&this->run, this->slots, 0, this->run.num);
+  }
+}
+
 #define PRIVATE(thisp) (thisp->pimpl)
 #define THISP(POINTER) static_cast<SoCalculator *>(POINTER)
 
@@ -389,6 +612,7 @@ SoCalculator::~SoCalculator(void)
   for (int i = 0; i < PRIVATE(this)->evaluatorList.getLength(); i++) {
     so_eval_delete(PRIVATE(this)->evaluatorList[i]);
   }
+  so_eval_program_delete(PRIVATE(this)->program);
   delete PRIVATE(this);
 }
 
@@ -399,6 +623,8 @@ void
 SoCalculator::initClass(void)
 {
   SO_ENGINE_INTERNAL_INIT_CLASS(SoCalculator);
+  CC_MUTEX_CONSTRUCT(calculator_parsemutex);
+  coin_atexit((coin_atexit_f *)calculator_cleanup, CC_ATEXIT_NORMAL);
 }
 
 // Documented in superclass.
@@ -411,6 +637,7 @@ SoCalculator::evaluate(void)
       this->expression[0].getLength() == 0) return;
 
   if (PRIVATE(this)->evaluatorList.getLength() == 0) {
+    CC_MUTEX_LOCK(calculator_parsemutex);
     for (i = 0; i < this->expression.getNum(); i++) {
       const SbString &s = this->expression[i];
       if (s.getLength()) {
@@ -424,6 +651,12 @@ SoCalculator::evaluate(void)
       }
       else PRIVATE(this)->evaluatorList.append(NULL);
     }
+    CC_MUTEX_UNLOCK(calculator_parsemutex);
+    if (!calculator_interpret()) {
+      PRIVATE(this)->program =
+        so_eval_compile(const_cast<so_eval_node **>(PRIVATE(this)->evaluatorList.getArrayPtr()),
+                        PRIVATE(this)->evaluatorList.getLength());
+    }
   }
 
 
@@ -455,6 +688,13 @@ SoCalculator::evaluate(void)
   }
   if (maxnum == 0) maxnum = 1; // in case only temporary registers were used
 
+  // the compiled program sets the number of values itself, after it
+  // has allocated its buffers
+  if (PRIVATE(this)->program) {
+    this->evaluateProgram(maxnum);
+    return;
+  }
+
   if (outused[0]) { SO_ENGINE_OUTPUT(oa, SoMFFloat, setNum(maxnum)); }
   if (outused[1]) { SO_ENGINE_OUTPUT(ob, SoMFFloat, setNum(maxnum)); }
   if (outused[2]) { SO_ENGINE_OUTPUT(oc, SoMFFloat, setNum(maxnum)); }
@@ -487,6 +727,114 @@ SoCalculator::evaluate(void)
   }
 }
 
+// evaluates the compiled expressions for all field indices
+void
+SoCalculator::evaluateProgram(const int num)
+{
+  const so_eval_program * program = PRIVATE(this)->program;
+  SoCalculatorRun & run = PRIVATE(this)->run;
+  int i;
+
+  run.program = program;
+  run.num = num;
+
+  char fieldname[2];
+  fieldname[1] = 0;
+  for (i = 0; i < 8; i++) {
+    fieldname[0] = 'a' + i;
+    SoMFFloat * field = coin_assert_cast<SoMFFloat *>(this->getField(fieldname));
+    run.inflt[i] = field->getValues(0);
+    run.infltnum[i] = field->getNum();
+    fieldname[0] = 'A' + i;
+    SoMFVec3f * vfield = coin_assert_cast<SoMFVec3f *>(this->getField(fieldname));
+    run.invec[i] = vfield->getValues(0);
+    run.invecnum[i] = vfield->getNum();
+  }
+  for (i = 0; i < 8; i++) {
+    run.tmp[i] = PRIVATE(this)->ta_th[i];
+    run.tmp[8 + i * 3] = PRIVATE(this)->tA_tH[i][0];
+    run.tmp[8 + i * 3 + 1] = PRIVATE(this)->tA_tH[i][1];
+    run.tmp[8 + i * 3 + 2] = PRIVATE(this)->tA_tH[i][2];
+  }
+
+  // results are collected in one buffer, with room for all outputs
+  int numout = 0;
+  for (i = 0; i < 8; i++) {
+    if (program->outused[i]) numout += (i < 4) ? 1 : 3;
+  }
+  int numthreads = calculator_num_threads();
+  numthreads = SbMax(1, SbMin(numthreads, num / CALCULATOR_MIN_ELEMENTS_PER_THREAD));
+  if (program->sequential) numthreads = 1;
+  // each thread has its own registers. The outputs are left as they
+  // are if there is no memory for these buffers
+  if (!SoCalculatorP::growBuffer(PRIVATE(this)->outbuffer, PRIVATE(this)->outbuffersize,
+                                 size_t(numout) * num) ||
+      !SoCalculatorP::growBuffer(PRIVATE(this)->slots, PRIVATE(this)->slotssize,
+                                 size_t(numthreads) * program->numslots * SO_EVAL_BLOCKSIZE)) {
+    SoDebugError::post("SoCalculator::evaluate",
+                       "out of memory evaluating %d elements.", num);
+    return;
+  }
+  float * out = PRIVATE(this)->outbuffer;
+  for (i = 0; i < 8; i++) {
+    if (!program->outused[i]) continue;
+    if (i < 4) {
+      run.outflt[i] = out;
+      out += num;
+    }
+    else {
+      run.outvec[i - 4] = reinterpret_cast<SbVec3f *>(out);
+      out += 3 * num;
+    }
+  }
+
+  PRIVATE(this)->runProgram(numthreads);
+
+  // only registers written by the program have new values
+  for (i = 0; i < 8; i++) {
+    if (program->tmpwritten[i]) PRIVATE(this)->ta_th[i] = run.lasttmp[i];
+    for (int j = 0; j < 3; j++) {
+      if (program->tmpwritten[8 + i * 3 + j]) {
+        PRIVATE(this)->tA_tH[i][j] = run.lasttmp[8 + i * 3 + j];
+      }
+    }
+  }
+
+  if (program->outused[0]) {
+    SO_ENGINE_OUTPUT(oa, SoMFFloat, setNum(num));
+    SO_ENGINE_OUTPUT(oa, SoMFFloat, setValues(0, num, run.outflt[0]));
+  }
+  if (program->outused[1]) {
+    SO_ENGINE_OUTPUT(ob, SoMFFloat, setNum(num));
+    SO_ENGINE_OUTPUT(ob, SoMFFloat, setValues(0, num, run.outflt[1]));
+  }
+  if (program->outused[2]) {
+    SO_ENGINE_OUTPUT(oc, SoMFFloat, setNum(num));
+    SO_ENGINE_OUTPUT(oc, SoMFFloat, setValues(0, num, run.outflt[2]));
+  }
+  if (program->outused[3]) {
+    SO_ENGINE_OUTPUT(od, SoMFFloat, setNum(num));
+    SO_ENGINE_OUTPUT(od, SoMFFloat, setValues(0, num, run.outflt[3]));
+  }
+
+  if (program->outused[4]) {
+    SO_ENGINE_OUTPUT(oA, SoMFVec3f, setNum(num));
+    SO_ENGINE_OUTPUT(oA, SoMFVec3f, setValues(0, num, run.outvec[0]));
+  }
+  if (program->outused[5]) {
+    SO_ENGINE_OUTPUT(oB, SoMFVec3f, setNum(num));
+    SO_ENGINE_OUTPUT(oB, SoMFVec3f, setValues(0, num, run.outvec[1]));
+  }
+  if (program->outused[6]) {
+    SO_ENGINE_OUTPUT(oC, SoMFVec3f, setNum(num));
+    SO_ENGINE_OUTPUT(oC, SoMFVec3f, setValues(0, num, run.outvec[2]));
+  }
+  if (program->outused[7]) {
+    SO_ENGINE_OUTPUT(oD, SoMFVec3f, setNum(num));
+    SO_ENGINE_OUTPUT(oD, SoMFVec3f, setValues(0, num, run.outvec[3]));
+  }
+}
+
 // "extern C" wrapper and C-function typedefs are needed with the
 // OSF1/cxx compiler (probably a bug in the compiler, but it doesn't
 // seem to hurt to do this anyway).
@@ -611,6 +959,8 @@ SoCalculator::inputChanged(SoField *which)
       so_eval_delete(PRIVATE(this)->evaluatorList[i]);
     }
     PRIVATE(this)->evaluatorList.truncate(0);
+    so_eval_program_delete(PRIVATE(this)->program);
+    PRIVATE(this)->program = NULL;
   }
 }
 
@@ -713,3 +1063,50 @@ SoCalculator::writefieldcb(const char *fieldname, float *data,
 
 #undef THISP
 #undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/engines/SoCalculator.h>
+#include <Inventor/fields/SoMFFloat.h>
+#include <Inventor/fields/SoMFVec3f.h>
+
+BOOST_AUTO_TEST_CASE(evaluateLargeInputs)
+{
+  const int num = 1000;
+  SoCalculator * calc = new SoCalculator;
+  calc->ref();
+
+  calc->a.setNum(num);
+  float * a = calc->a.startEditing();
+  for (int i = 0; i < num; i++) a[i] = float(i);
+  calc->a.finishEditing();
+  calc->b.setValue(0.5f); // shorter inputs repeat their last value
+  calc->expression.set1Value(0, "oa = a > 10 ? a * b : -a; ta = ta + 1; ob = ta");
+  calc->expression.set1Value(1, "oA = vec3f(oa, a, 0) / b");
+
+  SoMFFloat oa, ob;
+  SoMFVec3f oA;
+  oa.connectFrom(&calc->oa);
+  ob.connectFrom(&calc->ob);
+  oA.connectFrom(&calc->oA);
+  BOOST_REQUIRE_EQUAL(oa.getNum(), num);
+  BOOST_REQUIRE_EQUAL(ob.getNum(), num);
+  BOOST_REQUIRE_EQUAL(oA.getNum(), num);
+  BOOST_CHECK_EQUAL(oa[5], -5.0f);
+  BOOST_CHECK_EQUAL(oa[500], 250.0f);
+  BOOST_CHECK(oA[500] == SbVec3f(500.0f, 1000.0f, 0.0f));
+
+  // temporary registers keep their value from one value to the next
+  BOOST_CHECK_EQUAL(ob[0], 1.0f);
+  BOOST_CHECK_EQUAL(ob[num - 1], float(num));
+
+  // the outputs shrink with the inputs
+  calc->a.setNum(3);
+  BOOST_CHECK_EQUAL(oa.getNum(), 3);
+  BOOST_CHECK_EQUAL(oA.getNum(), 3);
+  BOOST_CHECK_EQUAL(oa[2], -2.0f);
+
+  calc->unref();
+}
+
+#endif // COIN_TEST_SUITE
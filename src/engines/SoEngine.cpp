@@ -73,6 +73,7 @@
 #include "config.h"
 #endif // HAVE_CONFIG_H
 #include "coindefs.h" // COIN_STUB()
+#include "engines/SoEngineSchedulerP.h"
 #ifdef COIN_THREADSAFE
 #include "threads/recmutexp.h"
 #endif // COIN_THREADSAFE
@@ -111,6 +112,7 @@ SoEngine::~SoEngine()
 #if COIN_DEBUG && 0 // debug
   SoDebugError::postInfo("SoEngine::~SoEngine", "%p", this);
 #endif // debug
+  if (this->flags & SoEngineSchedulerP::FLAG_ISSCHEDULED) SoEngineSchedulerP::engineDestructed(this);
 }
 
 // Overrides SoBase::destroy().
@@ -165,6 +167,7 @@ SoEngine::initClass(void)
     SoType::createType(SoFieldContainer::getClassTypeId(), SbName("Engine"));
 
   SoEngine::initClasses();
+  SoEngineSchedulerP::init();
 }
 
 /*!
@@ -319,10 +322,19 @@ SoEngine::notify(SoNotList * nl)
 
   this->flags |= FLAG_ISNOTIFYING;
 
+  // While an engine waits to be evaluated by SoEngineScheduler, its
+  // slaves are only notified once. A network with fan-in and fan-out
+  // would otherwise notify each engine once per path from the changed
+  // field.
+  const SbBool slavesnotified =
+    SoEngineSchedulerP::enabled &&
+    (this->flags & SoEngineSchedulerP::FLAG_ISSCHEDULED) && (this->flags & SoEngineSchedulerP::FLAG_SLAVESNOTIFIED);
+
   // The notification invocation could stem from a value change in
   // whatever this engine is connected to, so we need to be evaluated
   // on the next attempted read on our output(s).
   this->flags |= FLAG_ISDIRTY;
+  if (SoEngineSchedulerP::enabled) SoEngineSchedulerP::engineDirtied(this);
 
   // Call inputChanged() only if we're being notified through one of
   // the engine's fields (lastrec == CONTAINER, set in
@@ -334,6 +346,11 @@ SoEngine::notify(SoNotList * nl)
     this->inputChanged(nl->getLastField());
   }
 
+  if (slavesnotified) {
+    this->flags &= ~FLAG_ISNOTIFYING;
+    return;
+  }
+
   // add ourself to the notification list
   SoNotRec rec(createNotRec());
   rec.setType(SoNotRec::ENGINE);
@@ -342,8 +359,16 @@ SoEngine::notify(SoNotList * nl)
   // Notify the slave fields connected to our engine outputs.
   const SoEngineOutputData * outputs = this->getOutputData();
   int numoutputs = outputs->getNumOutputs();
-  for (int i = 0; i < numoutputs; i++)
-    outputs->getOutput(this, i)->touchSlaves(nl, this->isNotifyEnabled());
+  SbBool allenabled = TRUE;
+  for (int i = 0; i < numoutputs; i++) {
+    SoEngineOutput * output = outputs->getOutput(this, i);
+    output->touchSlaves(nl, this->isNotifyEnabled());
+    if (!output->isEnabled()) allenabled = FALSE;
+  }
+  // outputs that are enabled later must still notify their slaves
+  if ((this->flags & SoEngineSchedulerP::FLAG_ISSCHEDULED) && allenabled && this->isNotifyEnabled()) {
+    this->flags |= SoEngineSchedulerP::FLAG_SLAVESNOTIFIED;
+  }
 
   this->flags &= ~FLAG_ISNOTIFYING;
 
@@ -371,7 +396,10 @@ SoEngine::evaluateWrapper(void)
 
   if(!(this->flags & FLAG_ISDIRTY)) { return; }
 
-  this->flags &= ~FLAG_ISDIRTY;
+  this->flags &= ~(FLAG_ISDIRTY | SoEngineSchedulerP::FLAG_SLAVESNOTIFIED);
+  if (SoEngineSchedulerP::enabled && !SoEngineSchedulerP::running) {
+    SoEngineSchedulerP::numlazy++;
+  }
 
   int i, n = outputs->getNumOutputs();
   for (i = 0; i < n; i++) {
@@ -551,4 +579,5 @@ void
 SoEngine::setDirty(void)
 {
   this->flags |= FLAG_ISDIRTY;
+  if (SoEngineSchedulerP::enabled) SoEngineSchedulerP::engineDirtied(this);
 }
@@ -0,0 +1,723 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoEngineScheduler SoEngineScheduler.h Inventor/engines/SoEngineScheduler.h
+  \brief The SoEngineScheduler class evaluates dirty engines in dependency order.
+
+  \ingroup coin_engines
+
+  Engines are normally evaluated on demand, when a field connected to
+  one of their outputs is read. For large engine networks with much
+  fan-in and fan-out, the same connections are then walked many times
+  per frame, from whichever fields happen to be read first.
+
+  When the scheduler is enabled, engines are collected as they are
+  marked dirty by notification. evaluateDirtyEngines() then sorts the
+  collected engines topologically on their input connections and
+  evaluates each of them exactly once, upstream engines first, so that
+  reading the engines' outputs afterwards is just a field read.
+  SoRenderManager calls evaluateDirtyEngines() at the start of each
+  frame while the scheduler is enabled, and an application can call it
+  any time it is about to read many engine outputs.
+
+  Engines that don't depend on each other (one "level" of the sorted
+  network) can be evaluated in parallel, see setNumThreads(). This
+  requires that the engines' evaluate() methods only read their own
+  inputs and write their own outputs, which holds for all the built-in
+  engines except SoComputeBoundingBox, SoTexture2Convert and the field
+  converters. Those are always evaluated from the calling thread.
+
+  While an engine is collected and waiting for
+  evaluateDirtyEngines(), it notifies the fields connected to its
+  outputs only once, instead of once for every path from the changed
+  field. This changes the number of notifications downstream fields
+  and sensors get, but not the values read from them. Engines that
+  are not collected, and all engines after the scheduler is disabled,
+  notify on every change as before.
+
+  Engine evaluation itself is unchanged, so engines that are dirtied
+  after evaluateDirtyEngines() are still evaluated on demand.
+
+  The scheduler can also be enabled by setting the environment
+  variable COIN_ENGINE_SCHEDULER to 1, and the number of threads with
+  COIN_ENGINE_SCHEDULER_NUM_THREADS.
+
+  \since Coin 4.0
+*/
+
+// *************************************************************************
+
+#include <Inventor/engines/SoEngineScheduler.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <cstdlib>
+
+#include <Inventor/C/tidbits.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/engines/SoComputeBoundingBox.h>
+#include <Inventor/engines/SoEngine.h>
+#include <Inventor/engines/SoEngineOutput.h>
+#include <Inventor/engines/SoFieldConverter.h>
+#include <Inventor/engines/SoNodeEngine.h>
+#include <Inventor/engines/SoTexture2Convert.h>
+#include <Inventor/fields/SoField.h>
+#include <Inventor/lists/SoEngineOutputList.h>
+#include <Inventor/lists/SoFieldList.h>
+
+#ifdef HAVE_THREADS
+#include <Inventor/C/threads/thread.h>
+#include <Inventor/C/threads/wpool.h>
+#endif // HAVE_THREADS
+
+#include "engines/SoEngineSchedulerP.h"
+#include "misc/SbFlatHash.h"
+#include "misc/SoDBP.h"
+#include "tidbitsp.h"
+
+// *************************************************************************
+
+typedef SbFlatHash<const SoBase *, int> SoEngineSchedulerIndexMap;
+
+SbBool SoEngineSchedulerP::enabled = FALSE;
+SbBool SoEngineSchedulerP::running = FALSE;
+int SoEngineSchedulerP::numlazy = 0;
+thread_local SbBool SoEngineSchedulerP::evaluating = FALSE;
+
+static SbList<SoEngine *> * scheduler_dirty = NULL;
+static SoEngineSchedulerIndexMap * scheduler_dirtyindex = NULL;
+static int scheduler_numthreads = 1;
+static int scheduler_numevaluations = 0;
+static int scheduler_numparallel = 0;
+static int scheduler_numlevels = 0;
+
+#ifdef HAVE_THREADS
+static cc_wpool * scheduler_pool = NULL;
+#endif // HAVE_THREADS
+
+// *************************************************************************
+
+void
+SoEngineSchedulerP::init(void)
+{
+  scheduler_dirty = new SbList<SoEngine *>;
+  scheduler_dirtyindex = new SoEngineSchedulerIndexMap;
+
+  const char * env = coin_getenv("COIN_ENGINE_SCHEDULER_NUM_THREADS");
+  if (env && atoi(env) > 0) scheduler_numthreads = atoi(env);
+  env = coin_getenv("COIN_ENGINE_SCHEDULER");
+  if (env && atoi(env) > 0) SoEngineSchedulerP::enabled = TRUE;
+
+  coin_atexit((coin_atexit_f *)SoEngineSchedulerP::cleanup, CC_ATEXIT_NORMAL);
+}
+
+void
+SoEngineSchedulerP::cleanup(void)
+{
+  SoEngineSchedulerP::clearDirtyEngines();
+  SoEngineSchedulerP::enabled = FALSE;
+  delete scheduler_dirty;
+  scheduler_dirty = NULL;
+  delete scheduler_dirtyindex;
+  scheduler_dirtyindex = NULL;
+#ifdef HAVE_THREADS
+  if (scheduler_pool) cc_wpool_destruct(scheduler_pool);
+  scheduler_pool = NULL;
+#endif // HAVE_THREADS
+  scheduler_numthreads = 1;
+}
+
+void
+SoEngineSchedulerP::engineDirtied(SoEngine * engine)
+{
+  if (engine->flags & SoEngineSchedulerP::FLAG_ISSCHEDULED) return;
+  engine->flags |= SoEngineSchedulerP::FLAG_ISSCHEDULED;
+  scheduler_dirtyindex->put(engine, scheduler_dirty->getLength());
+  scheduler_dirty->append(engine);
+}
+
+void
+SoEngineSchedulerP::engineDestructed(SoEngine * engine)
+{
+  int idx;
+  if (scheduler_dirtyindex->get(engine, idx)) {
+    (*scheduler_dirty)[idx] = NULL;
+    scheduler_dirtyindex->erase(engine);
+  }
+}
+
+void
+SoEngineSchedulerP::clearDirtyEngines(void)
+{
+  if (!scheduler_dirty) return;
+  for (int i = 0; i < scheduler_dirty->getLength(); i++) {
+    SoEngine * engine = (*scheduler_dirty)[i];
+    // slaves of engines no longer waiting for the scheduler must be
+    // notified on every change again
+    if (engine) {
+      engine->flags &= ~(SoEngineSchedulerP::FLAG_ISSCHEDULED |
+                         SoEngineSchedulerP::FLAG_SLAVESNOTIFIED);
+    }
+  }
+  scheduler_dirty->truncate(0);
+  scheduler_dirtyindex->clear();
+}
+
+SbBool
+SoEngineSchedulerP::isDirty(const SoEngine * engine)
+{
+  return (engine->flags & SoEngine::FLAG_ISDIRTY) != 0;
+}
+
+// *************************************************************************
+
+// Adds an edge to each scheduled engine that \a field depends on,
+// following field-to-field connections and the inputs of node
+// engines, which are not scheduled themselves.
+static void
+scheduler_collect_edges(const SoField * field, const int self,
+                        const SoEngineSchedulerIndexMap & index,
+                        SbList<const SoField *> & visited,
+                        SbList<int> & edges)
+{
+  if (visited.find(field) >= 0) return;
+  visited.append(field);
+
+  SoEngineOutput * output;
+  if (field->getConnectedEngine(output)) {
+    if (output->isNodeEngineOutput()) {
+      SoFieldList inputs;
+      output->getNodeContainer()->getFields(inputs);
+      for (int i = 0; i < inputs.getLength(); i++) {
+        scheduler_collect_edges(inputs[i], self, index, visited, edges);
+      }
+    }
+    else {
+      int idx;
+      if (index.get(output->getContainer(), idx) && idx != self) {
+        edges.append(idx);
+        edges.append(self);
+      }
+    }
+  }
+  SoField * master;
+  if (field->getConnectedField(master)) {
+    scheduler_collect_edges(master, self, index, visited, edges);
+  }
+}
+
+static SbBool
+scheduler_can_run_parallel(const SoEngine * engine)
+{
+  // these either traverse the scene graph or go through SoInput and
+  // SoOutput, which are not safe to run from multiple threads
+  return
+    !engine->isOfType(SoComputeBoundingBox::getClassTypeId()) &&
+    !engine->isOfType(SoTexture2Convert::getClassTypeId()) &&
+    !engine->isOfType(SoFieldConverter::getClassTypeId());
+}
+
+#ifdef HAVE_THREADS
+
+struct SoEngineSchedulerRange {
+  SoEngine * const * engines;
+  int start, end;
+};
+
+static void
+scheduler_evaluate_range(void * closure)
+{
+  SoEngineSchedulerRange * range = static_cast<SoEngineSchedulerRange *>(closure);
+  SoEngineSchedulerP::evaluating = TRUE;
+  for (int i = range->start; i < range->end; i++) {
+    range->engines[i]->evaluateWrapper();
+  }
+  SoEngineSchedulerP::evaluating = FALSE;
+}
+
+#endif // HAVE_THREADS
+
+void
+SoEngineSchedulerP::evaluateLevel(const SbList<SoEngine *> & engines,
+                                  const SbList<int> & level)
+{
+  SbList<SoEngine *> parallel;
+  SbList<SbBool> inparallel;
+  int i;
+  for (i = 0; i < level.getLength(); i++) inparallel.append(FALSE);
+
+#ifdef HAVE_THREADS
+  if (scheduler_numthreads > 1 && level.getLength() > 1 &&
+      cc_thread_implementation() != CC_NO_THREADS) {
+    // Two engines of a level may still write to the same field, if
+    // it has more than one master. Those are evaluated serially.
+    SbFlatHash<size_t, int> written; // field address -> 1
+    for (i = 0; i < level.getLength(); i++) {
+      SoEngine * engine = engines[level[i]];
+      if (!SoEngineSchedulerP::isDirty(engine) ||
+          !scheduler_can_run_parallel(engine)) continue;
+
+      SbBool conflict = FALSE;
+      SoEngineOutputList outputs;
+      engine->getOutputs(outputs);
+      for (int j = 0; j < outputs.getLength() && !conflict; j++) {
+        for (int k = 0; k < outputs[j]->getNumConnections(); k++) {
+          int dummy;
+          if (written.get(reinterpret_cast<size_t>((*outputs[j])[k]), dummy)) {
+            conflict = TRUE;
+            break;
+          }
+        }
+      }
+      if (conflict) continue;
+      for (int j = 0; j < outputs.getLength(); j++) {
+        for (int k = 0; k < outputs[j]->getNumConnections(); k++) {
+          written.put(reinterpret_cast<size_t>((*outputs[j])[k]), 1);
+        }
+      }
+      parallel.append(engine);
+      inparallel[i] = TRUE;
+    }
+    if (parallel.getLength() < 2) {
+      parallel.truncate(0);
+      for (i = 0; i < level.getLength(); i++) inparallel[i] = FALSE;
+    }
+  }
+#endif // HAVE_THREADS
+
+  for (i = 0; i < level.getLength(); i++) {
+    SoEngine * engine = engines[level[i]];
+    if (!SoEngineSchedulerP::isDirty(engine)) continue;
+    if (inparallel[i]) continue;
+    engine->evaluateWrapper();
+    scheduler_numevaluations++;
+  }
+
+#ifdef HAVE_THREADS
+  if (parallel.getLength() == 0) return;
+
+  // Read all inputs first, so the threads don't evaluate field
+  // connections. This may still evaluate engines that were not
+  // collected (e.g. field converters), which is fine from here.
+  for (i = 0; i < parallel.getLength(); i++) {
+    SoFieldList inputs;
+    parallel[i]->getFields(inputs);
+    for (int j = 0; j < inputs.getLength(); j++) inputs[j]->evaluate();
+  }
+
+  const int numthreads = SbMin(scheduler_numthreads, parallel.getLength());
+  if (!scheduler_pool) {
+    scheduler_pool = cc_wpool_construct(numthreads - 1);
+  }
+  else if (cc_wpool_get_num_workers(scheduler_pool) < numthreads - 1) {
+    cc_wpool_set_num_workers(scheduler_pool, numthreads - 1);
+  }
+
+  SbList<SoEngineSchedulerRange> ranges;
+  for (i = 0; i < numthreads; i++) {
+    SoEngineSchedulerRange range;
+    range.engines = parallel.getArrayPtr();
+    range.start = int(parallel.getLength() * (long) i / numthreads);
+    range.end = int(parallel.getLength() * (long) (i + 1) / numthreads);
+    ranges.append(range);
+  }
+
+  // The engines' outputs write their slave fields with notification
+  // disabled (see SoEngineOutput::prepareToWrite()), so the writes
+  // skip SoDB::startNotify() on the threads evaluating the ranges.
+  // The slaves were notified when the engines were dirtied, which
+  // leaves only the end of notification to be done, once, from this
+  // thread.
+  cc_wpool_begin(scheduler_pool, numthreads - 1);
+  for (i = 1; i < numthreads; i++) {
+    cc_wpool_start_worker(scheduler_pool, scheduler_evaluate_range, &ranges[i]);
+  }
+  cc_wpool_end(scheduler_pool);
+  scheduler_evaluate_range(&ranges[0]);
+  cc_wpool_wait_all(scheduler_pool);
+
+  SoDB::startNotify();
+  SoDB::endNotify();
+
+  scheduler_numevaluations += parallel.getLength();
+  scheduler_numparallel += parallel.getLength();
+#endif // HAVE_THREADS
+}
+
+int
+SoEngineSchedulerP::evaluateDirtyEngines(void)
+{
+  scheduler_numevaluations = 0;
+  scheduler_numparallel = 0;
+  scheduler_numlevels = 0;
+  SoEngineSchedulerP::numlazy = 0;
+  if (SoEngineSchedulerP::running || !scheduler_dirty) return 0;
+
+  // Take over the collected engines. Engines dirtied while we
+  // evaluate are collected for the next call.
+  SbList<SoEngine *> engines;
+  int i;
+  for (i = 0; i < scheduler_dirty->getLength(); i++) {
+    SoEngine * engine = (*scheduler_dirty)[i];
+    if (engine && SoEngineSchedulerP::isDirty(engine)) {
+      engine->ref();
+      engines.append(engine);
+    }
+  }
+  SoEngineSchedulerP::clearDirtyEngines();
+  const int num = engines.getLength();
+  if (num == 0) return 0;
+
+  SoEngineSchedulerP::running = TRUE;
+
+  SoEngineSchedulerIndexMap index;
+  for (i = 0; i < num; i++) index.put(engines[i], i);
+
+  // edges are stored as (from, to) pairs
+  SbList<int> edges;
+  SbList<const SoField *> visited;
+  for (i = 0; i < num; i++) {
+    SoFieldList inputs;
+    engines[i]->getFields(inputs);
+    for (int j = 0; j < inputs.getLength(); j++) {
+      visited.truncate(0);
+      scheduler_collect_edges(inputs[j], i, index, visited, edges);
+    }
+  }
+
+  const int numedges = edges.getLength() / 2;
+  int * indegree = new int[num];
+  int * first = new int[num + 1];
+  int * successors = new int[numedges > 0 ? numedges : 1];
+  for (i = 0; i <= num; i++) first[i] = 0;
+  for (i = 0; i < num; i++) indegree[i] = 0;
+  for (i = 0; i < numedges; i++) {
+    first[edges[i*2] + 1]++;
+    indegree[edges[i*2+1]]++;
+  }
+  for (i = 0; i < num; i++) first[i+1] += first[i];
+  int * fill = new int[num];
+  for (i = 0; i < num; i++) fill[i] = first[i];
+  for (i = 0; i < numedges; i++) {
+    successors[fill[edges[i*2]]++] = edges[i*2+1];
+  }
+  delete[] fill;
+
+  // Kahn's algorithm, one level at a time
+  SbList<int> level, next;
+  for (i = 0; i < num; i++) {
+    if (indegree[i] == 0) level.append(i);
+  }
+  while (level.getLength()) {
+    SoEngineSchedulerP::evaluateLevel(engines, level);
+    scheduler_numlevels++;
+    next.truncate(0);
+    for (i = 0; i < level.getLength(); i++) {
+      const int from = level[i];
+      for (int j = first[from]; j < first[from + 1]; j++) {
+        if (--indegree[successors[j]] == 0) next.append(successors[j]);
+      }
+    }
+    level = next;
+  }
+
+  // engines in connection loops are left to evaluate on demand, as
+  // they would without the scheduler
+  for (i = 0; i < num; i++) {
+    if (indegree[i] > 0 && SoEngineSchedulerP::isDirty(engines[i])) {
+      engines[i]->evaluateWrapper();
+      scheduler_numevaluations++;
+    }
+  }
+
+  delete[] indegree;
+  delete[] first;
+  delete[] successors;
+
+  SoEngineSchedulerP::running = FALSE;
+  for (i = 0; i < num; i++) engines[i]->unrefNoDelete();
+  return scheduler_numevaluations;
+}
+
+// *************************************************************************
+
+/*!
+  Enables or disables the scheduler. Engines are only collected while
+  the scheduler is enabled.
+*/
+void
+SoEngineScheduler::setEnabled(const SbBool onoff)
+{
+  if (!onoff) SoEngineSchedulerP::clearDirtyEngines();
+  SoEngineSchedulerP::enabled = onoff;
+}
+
+/*!
+  Returns whether the scheduler is enabled.
+*/
+SbBool
+SoEngineScheduler::isEnabled(void)
+{
+  return SoEngineSchedulerP::enabled;
+}
+
+/*!
+  Sets the number of threads used for evaluating independent engines,
+  including the calling thread. The default is 1, which evaluates all
+  engines from the calling thread.
+*/
+void
+SoEngineScheduler::setNumThreads(const int num)
+{
+  scheduler_numthreads = SbMax(num, 1);
+}
+
+/*!
+  Returns the number of threads used for evaluating engines.
+*/
+int
+SoEngineScheduler::getNumThreads(void)
+{
+  return scheduler_numthreads;
+}
+
+/*!
+  Returns the number of engines collected since the last call to
+  evaluateDirtyEngines(). Engines that have been evaluated on demand
+  since they were collected are included.
+*/
+int
+SoEngineScheduler::getNumDirtyEngines(void)
+{
+  return scheduler_dirtyindex ? int(scheduler_dirtyindex->getNumElements()) : 0;
+}
+
+/*!
+  Evaluates the collected dirty engines in dependency order, and
+  returns the number of engines evaluated. Engines that have already
+  been evaluated on demand are skipped.
+*/
+int
+SoEngineScheduler::evaluateDirtyEngines(void)
+{
+  return SoEngineSchedulerP::evaluateDirtyEngines();
+}
+
+/*!
+  Returns the number of engines evaluated by the last call to
+  evaluateDirtyEngines().
+*/
+int
+SoEngineScheduler::getNumEvaluations(void)
+{
+  return scheduler_numevaluations;
+}
+
+/*!
+  Returns how many of the engines evaluated by the last call to
+  evaluateDirtyEngines() were evaluated from worker threads.
+*/
+int
+SoEngineScheduler::getNumParallelEvaluations(void)
+{
+  return scheduler_numparallel;
+}
+
+/*!
+  Returns the number of levels, i.e. the length of the longest chain
+  of dependent engines, in the last call to evaluateDirtyEngines().
+*/
+int
+SoEngineScheduler::getNumLevels(void)
+{
+  return scheduler_numlevels;
+}
+
+/*!
+  Returns the number of engines evaluated on demand, outside the
+  scheduler, since the last call to evaluateDirtyEngines(). For a
+  frame rendered right after evaluateDirtyEngines(), this should be
+  (close to) zero.
+*/
+int
+SoEngineScheduler::getNumLazyEvaluations(void)
+{
+  return SoEngineSchedulerP::numlazy;
+}
+
+// *************************************************************************
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/engines/SoCalculator.h>
+#include <Inventor/engines/SoCompose.h>
+#include <Inventor/fields/SoMFFloat.h>
+#include <Inventor/nodes/SoTranslation.h>
+#include <Inventor/sensors/SoNodeSensor.h>
+
+static void
+scheduler_count_cb(void * data, SoSensor *)
+{
+  (*static_cast<int *>(data))++;
+}
+
+BOOST_AUTO_TEST_CASE(evaluateDiamondNetwork)
+{
+  SoEngineScheduler::setEnabled(TRUE);
+
+  // top -> (left, right) -> bottom
+  SoCalculator * top = new SoCalculator;
+  SoCalculator * left = new SoCalculator;
+  SoCalculator * right = new SoCalculator;
+  SoCalculator * bottom = new SoCalculator;
+  top->ref();
+  bottom->ref(); // result has no container, so it doesn't ref bottom
+  top->expression = "oa = a + 1";
+  left->expression = "oa = a * 2";
+  right->expression = "oa = a * 3";
+  bottom->expression = "oa = a + b";
+  left->a.connectFrom(&top->oa);
+  right->a.connectFrom(&top->oa);
+  bottom->a.connectFrom(&left->oa);
+  bottom->b.connectFrom(&right->oa);
+
+  SoMFFloat result;
+  result.connectFrom(&bottom->oa);
+  BOOST_CHECK_EQUAL(result[0], 5.0f);
+
+  top->a = 1.0f;
+  BOOST_CHECK_EQUAL(SoEngineScheduler::getNumDirtyEngines(), 4);
+  BOOST_CHECK_EQUAL(SoEngineScheduler::evaluateDirtyEngines(), 4);
+  BOOST_CHECK_EQUAL(SoEngineScheduler::getNumLevels(), 3);
+  BOOST_CHECK_EQUAL(SoEngineScheduler::getNumDirtyEngines(), 0);
+  BOOST_CHECK_EQUAL(result[0], 10.0f);
+  BOOST_CHECK_EQUAL(SoEngineScheduler::getNumLazyEvaluations(), 0);
+
+  // left and right may be evaluated in parallel
+  SoEngineScheduler::setNumThreads(2);
+  top->a = 2.0f;
+  BOOST_CHECK_EQUAL(SoEngineScheduler::evaluateDirtyEngines(), 4);
+  BOOST_CHECK_EQUAL(result[0], 15.0f);
+  BOOST_CHECK_EQUAL(SoEngineScheduler::getNumLazyEvaluations(), 0);
+
+  // engines dirtied after the scheduler ran are still evaluated on demand
+  top->a = 3.0f;
+  BOOST_CHECK_EQUAL(result[0], 20.0f);
+  BOOST_CHECK_EQUAL(SoEngineScheduler::getNumLazyEvaluations(), 4);
+
+  result.disconnect();
+  bottom->unref();
+  top->unref();
+  SoEngineScheduler::setNumThreads(1);
+  SoEngineScheduler::setEnabled(FALSE);
+}
+
+BOOST_AUTO_TEST_CASE(evaluateParallelLevel)
+{
+  // Also run this with COIN_THREADSAFE: the worker threads' writes
+  // must not wait for the notification lock.
+  SoEngineScheduler::setEnabled(TRUE);
+  SoEngineScheduler::setNumThreads(4);
+
+  const int num = 32;
+  SoCalculator * top = new SoCalculator;
+  top->ref();
+  top->expression = "oa = a + 1";
+  SoCalculator * calc[num];
+  SoMFFloat results[num];
+  int i;
+  for (i = 0; i < num; i++) {
+    calc[i] = new SoCalculator;
+    calc[i]->ref();
+    calc[i]->expression = "oa = a * 2";
+    calc[i]->a.connectFrom(&top->oa);
+    results[i].connectFrom(&calc[i]->oa);
+  }
+  SoEngineScheduler::evaluateDirtyEngines();
+
+  for (int frame = 1; frame <= 3; frame++) {
+    top->a = float(frame);
+    BOOST_CHECK_EQUAL(SoEngineScheduler::evaluateDirtyEngines(), num + 1);
+    BOOST_CHECK_EQUAL(SoEngineScheduler::getNumLevels(), 2);
+    for (i = 0; i < num; i++) {
+      BOOST_CHECK_EQUAL(results[i][0], float((frame + 1) * 2));
+    }
+    BOOST_CHECK_EQUAL(SoEngineScheduler::getNumLazyEvaluations(), 0);
+  }
+
+  for (i = 0; i < num; i++) {
+    results[i].disconnect();
+    calc[i]->unref();
+  }
+  top->unref();
+  SoEngineScheduler::setNumThreads(1);
+  SoEngineScheduler::setEnabled(FALSE);
+}
+
+BOOST_AUTO_TEST_CASE(notifySlavesOnce)
+{
+  SoComposeVec3f * compose = new SoComposeVec3f;
+  SoTranslation * translation = new SoTranslation;
+  translation->ref();
+  translation->translation.connectFrom(&compose->vector);
+
+  int triggered = 0;
+  SoNodeSensor sensor(scheduler_count_cb, &triggered);
+  sensor.setPriority(0);
+  sensor.attach(translation);
+
+  // the slaves are notified once while the engine waits for the
+  // scheduler
+  SoEngineScheduler::setEnabled(TRUE);
+  compose->x = 1.0f;
+  compose->x = 2.0f;
+  BOOST_CHECK_EQUAL(triggered, 1);
+  // the engine and the MF to SF field converter
+  BOOST_CHECK_EQUAL(SoEngineScheduler::evaluateDirtyEngines(), 2);
+  BOOST_CHECK_EQUAL(translation->translation.getValue()[0], 2.0f);
+
+  // and on every change when it isn't waiting anymore
+  compose->x = 3.0f;
+  SoEngineScheduler::setEnabled(FALSE);
+  compose->x = 4.0f;
+  compose->x = 5.0f;
+  BOOST_CHECK_EQUAL(triggered, 4);
+  BOOST_CHECK_EQUAL(translation->translation.getValue()[0], 5.0f);
+
+  sensor.detach();
+  translation->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -0,0 +1,81 @@
+#ifndef COIN_SOENGINESCHEDULERP_H
+#define COIN_SOENGINESCHEDULERP_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/SbBasic.h>
+#include <Inventor/lists/SbList.h>
+
+class SoEngine;
+
+// *************************************************************************
+
+// The hooks SoEngine uses to tell SoEngineScheduler about dirty and
+// destructed engines. The flags are tested inline so engines pay
+// nothing extra while the scheduler is disabled.
+class SoEngineSchedulerP {
+public:
+  static void init(void);
+  static void cleanup(void);
+
+  static void engineDirtied(SoEngine * engine);
+  static void engineDestructed(SoEngine * engine);
+
+  static void clearDirtyEngines(void);
+  static int evaluateDirtyEngines(void);
+  static void evaluateLevel(const SbList<SoEngine *> & engines,
+                            const SbList<int> & level);
+  static SbBool isDirty(const SoEngine * engine);
+
+  // bits in SoEngine::flags, above the ones SoEngine uses itself
+  enum EngineFlags {
+    FLAG_ISSCHEDULED = (1 << 2),
+    FLAG_SLAVESNOTIFIED = (1 << 3)
+  };
+
+  static SbBool enabled;
+  static SbBool running;
+  static int numlazy;
+
+  // set on each thread while it evaluates engines of a level in
+  // parallel with other threads
+  static thread_local SbBool evaluating;
+};
+
+// *************************************************************************
+
+#endif // !COIN_SOENGINESCHEDULERP_H
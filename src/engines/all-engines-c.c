@@ -31,4 +31,5 @@
 \**************************************************************************/
 
 #include "evaluator.c"
+#include "evaluator_compile.c"
 #include "evaluator_tab.c"
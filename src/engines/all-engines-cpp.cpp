@@ -50,6 +50,7 @@
 #include "SoElapsedTime.cpp"
 #include "SoEngine.cpp"
 #include "SoEngineOutput.cpp"
+#include "SoEngineScheduler.cpp"
 #include "SoFieldConverter.cpp"
 #include "SoGate.cpp"
 #include "SoInterpolate.cpp"
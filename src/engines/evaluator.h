@@ -108,6 +108,64 @@ extern "C" {
   so_eval_node *so_eval_create_reg_comp(const char *regname, int index);
   so_eval_node *so_eval_create_flt_val(float val);
 
+/*
+ * The expressions can also be compiled into a flat register program
+ * (see evaluator_compile.c), which evaluates a block of up to
+ * SO_EVAL_BLOCKSIZE elements for each instruction. Each register slot
+ * holds one float per element, and vectors use three consecutive
+ * slots. The caller loads the input registers, runs the program and
+ * reads the output registers.
+ */
+
+#define SO_EVAL_BLOCKSIZE 256
+
+/* register slots */
+enum {
+  SO_EVAL_SLOT_IN_FLT = 0,   /* a-h */
+  SO_EVAL_SLOT_IN_VEC = 8,   /* A-H */
+  SO_EVAL_SLOT_TMP_FLT = 32, /* ta-th */
+  SO_EVAL_SLOT_TMP_VEC = 40, /* tA-tH */
+  SO_EVAL_SLOT_OUT_FLT = 64, /* oa-od */
+  SO_EVAL_SLOT_OUT_VEC = 68, /* oA-oD */
+  SO_EVAL_NUM_REG_SLOTS = 80
+};
+
+#define SO_EVAL_NUM_TMP_SLOTS (SO_EVAL_SLOT_OUT_FLT - SO_EVAL_SLOT_TMP_FLT)
+
+  typedef struct {
+    int op;
+    int dst;
+    int src[3];
+    float value;
+  } so_eval_instruction;
+
+  typedef struct {
+    so_eval_instruction *instructions;
+    int numinstructions;
+    int numslots;
+    /* used registers, same layout as in SoCalculator::findUsed() */
+    char inused[16];
+    char outused[8];
+    /* temporary register slots read before they are written in an
+       element, and slots written */
+    char tmpreadfirst[SO_EVAL_NUM_TMP_SLOTS];
+    char tmpwritten[SO_EVAL_NUM_TMP_SLOTS];
+    /* set if a temporary register carries a value from one element
+       to the next, so elements must be evaluated one at a time */
+    int sequential;
+  } so_eval_program;
+
+  /* compile the expressions, in order. Returns NULL if the
+     expressions can not be compiled (e.g. if they use rand(), which
+     must be called in the same order as for so_eval_evaluate()) */
+  so_eval_program *so_eval_compile(so_eval_node **nodes, int numnodes);
+
+  void so_eval_program_delete(so_eval_program *program);
+
+  /* evaluates num elements. slots must hold program->numslots *
+     SO_EVAL_BLOCKSIZE floats. The output registers are cleared first */
+  void so_eval_program_run(const so_eval_program *program, float *slots, int num);
+
 
 /* node ids */
 enum {
@@ -0,0 +1,617 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*
+ * Compiles so_eval_node trees into a flat list of instructions
+ * working on blocks of elements, so SoCalculator can evaluate large
+ * multi-field inputs without traversing the tree and calling back
+ * for every register access of every element.
+ *
+ * Every instruction performs the same float operations as the
+ * corresponding case in so_eval_traverse(), so the results are
+ * identical. Both branches of a conditional are evaluated and the
+ * result is selected per element, which is equivalent since the
+ * functions have no side effects (expressions using rand() are not
+ * compiled).
+ */
+
+#include "engines/evaluator.h"
+#include <Inventor/C/basic.h>
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h> /* FLT_EPSILON */
+
+/* instruction opcodes */
+enum {
+  OP_CONST,
+  OP_MOV,
+  OP_ADD,
+  OP_SUB,
+  OP_MUL,
+  OP_DIV,
+  OP_FMOD,
+  OP_NEG,
+  OP_AND,
+  OP_OR,
+  OP_NOT,
+  OP_LEQ,
+  OP_GEQ,
+  OP_EQ,
+  OP_NEQ,
+  OP_LT,
+  OP_GT,
+  OP_COS,
+  OP_SIN,
+  OP_TAN,
+  OP_ACOS,
+  OP_ASIN,
+  OP_ATAN,
+  OP_ATAN2,
+  OP_COSH,
+  OP_SINH,
+  OP_TANH,
+  OP_SQRT,
+  OP_EXP,
+  OP_LOG,
+  OP_LOG10,
+  OP_CEIL,
+  OP_FLOOR,
+  OP_FABS,
+  OP_POW,
+  OP_TEST_FLT,
+  OP_TEST_VEC,
+  OP_SELECT,
+  OP_LEN,
+  OP_NORMALIZE
+};
+
+typedef struct {
+  so_eval_program *program;
+  int maxinstructions;
+  int error;
+} program_compiler;
+
+/*
+ * returns the first slot of the register named regname, or -1.
+ */
+static int
+program_reg_slot(const char *regname)
+{
+  char c = regname[0];
+  if (c == 't' || c == 'o') {
+    char r = regname[1];
+    if (r >= 'a' && r <= 'h' && (c == 't' || r <= 'd')) {
+      return (c == 't' ? SO_EVAL_SLOT_TMP_FLT : SO_EVAL_SLOT_OUT_FLT) + (r - 'a');
+    }
+    if (r >= 'A' && r <= 'H' && (c == 't' || r <= 'D')) {
+      return (c == 't' ? SO_EVAL_SLOT_TMP_VEC : SO_EVAL_SLOT_OUT_VEC) + (r - 'A') * 3;
+    }
+    return -1;
+  }
+  if (c >= 'a' && c <= 'h') return SO_EVAL_SLOT_IN_FLT + (c - 'a');
+  if (c >= 'A' && c <= 'H') return SO_EVAL_SLOT_IN_VEC + (c - 'A') * 3;
+  return -1;
+}
+
+static int
+program_new_slots(program_compiler *c, int num)
+{
+  int slot = c->program->numslots;
+  c->program->numslots += num;
+  return slot;
+}
+
+static void
+program_emit(program_compiler *c, int op, int dst, int src0, int src1, int src2)
+{
+  so_eval_program *program = c->program;
+  so_eval_instruction *ins;
+  if (program->numinstructions == c->maxinstructions) {
+    c->maxinstructions = c->maxinstructions ? c->maxinstructions * 2 : 64;
+    program->instructions = (so_eval_instruction *)
+      realloc(program->instructions, c->maxinstructions * sizeof(so_eval_instruction));
+  }
+  ins = &program->instructions[program->numinstructions++];
+  ins->op = op;
+  ins->dst = dst;
+  ins->src[0] = src0;
+  ins->src[1] = src1;
+  ins->src[2] = src2;
+  ins->value = 0.0f;
+}
+
+/*
+ * marks register slots as read, and notes temporary registers read
+ * before they are written in an element.
+ */
+static void
+program_read(program_compiler *c, int slot, int num)
+{
+  int i;
+  for (i = 0; i < num; i++) {
+    int s = slot + i;
+    if (s >= SO_EVAL_SLOT_TMP_FLT && s < SO_EVAL_SLOT_OUT_FLT) {
+      s -= SO_EVAL_SLOT_TMP_FLT;
+      if (!c->program->tmpwritten[s]) c->program->tmpreadfirst[s] = 1;
+    }
+  }
+}
+
+static void
+program_write(program_compiler *c, int slot, int num)
+{
+  int i;
+  for (i = 0; i < num; i++) {
+    int s = slot + i;
+    if (s >= SO_EVAL_SLOT_TMP_FLT && s < SO_EVAL_SLOT_OUT_FLT) {
+      c->program->tmpwritten[s - SO_EVAL_SLOT_TMP_FLT] = 1;
+    }
+  }
+}
+
+static int
+program_unary(program_compiler *c, int op, int src)
+{
+  int dst = program_new_slots(c, 1);
+  program_emit(c, op, dst, src, -1, -1);
+  return dst;
+}
+
+static int
+program_binary(program_compiler *c, int op, int src0, int src1)
+{
+  int dst = program_new_slots(c, 1);
+  program_emit(c, op, dst, src0, src1, -1);
+  return dst;
+}
+
+/*
+ * compiles a node, returning the first slot of the result (three
+ * slots for vectors), or -1 on error.
+ */
+static int
+program_compile_node(program_compiler *c, so_eval_node *node)
+{
+  int s0, s1, s2, dst, i;
+
+  if (node == NULL || c->error) return -1;
+
+  /* statements */
+  switch (node->id) {
+  case ID_SEPARATOR:
+    if (node->child1) (void) program_compile_node(c, node->child1);
+    if (node->child2) (void) program_compile_node(c, node->child2);
+    return -1;
+  case ID_ASSIGN_FLT:
+  case ID_ASSIGN_VEC:
+    s0 = program_compile_node(c, node->child2);
+    dst = program_reg_slot(node->child1->regname);
+    if (s0 < 0 || dst < SO_EVAL_SLOT_TMP_FLT) {
+      c->error = 1;
+      return -1;
+    }
+    if (node->id == ID_ASSIGN_VEC) {
+      for (i = 0; i < 3; i++) program_emit(c, OP_MOV, dst + i, s0 + i, -1, -1);
+      program_write(c, dst, 3);
+    }
+    else {
+      if (node->child1->id == ID_VEC_REG_COMP) {
+        if (node->child1->regidx < 0 || node->child1->regidx > 2) {
+          c->error = 1;
+          return -1;
+        }
+        dst += node->child1->regidx;
+      }
+      program_emit(c, OP_MOV, dst, s0, -1, -1);
+      program_write(c, dst, 1);
+    }
+    if (dst >= SO_EVAL_SLOT_OUT_VEC) {
+      c->program->outused[4 + (dst - SO_EVAL_SLOT_OUT_VEC) / 3] = 1;
+    }
+    else if (dst >= SO_EVAL_SLOT_OUT_FLT) {
+      c->program->outused[dst - SO_EVAL_SLOT_OUT_FLT] = 1;
+    }
+    return -1;
+  default:
+    break;
+  }
+
+  /* register reads */
+  switch (node->id) {
+  case ID_FLT_REG:
+  case ID_VEC_REG:
+  case ID_VEC_REG_COMP:
+    s0 = program_reg_slot(node->regname);
+    if (s0 < 0) {
+      c->error = 1;
+      return -1;
+    }
+    if (s0 < SO_EVAL_SLOT_TMP_FLT) {
+      c->program->inused[s0 < SO_EVAL_SLOT_IN_VEC ? s0 :
+                         8 + (s0 - SO_EVAL_SLOT_IN_VEC) / 3] = 1;
+    }
+    if (node->id == ID_VEC_REG) {
+      program_read(c, s0, 3);
+      return s0;
+    }
+    if (node->id == ID_VEC_REG_COMP) {
+      if (node->regidx < 0 || node->regidx > 2) {
+        c->error = 1;
+        return -1;
+      }
+      s0 += node->regidx;
+    }
+    program_read(c, s0, 1);
+    return s0;
+  case ID_VALUE:
+    dst = program_new_slots(c, 1);
+    program_emit(c, OP_CONST, dst, -1, -1, -1);
+    c->program->instructions[c->program->numinstructions - 1].value = node->value;
+    return dst;
+  case ID_RAND:
+    /* must be called once per element in the tree's order */
+    c->error = 1;
+    return -1;
+  default:
+    break;
+  }
+
+  s0 = s1 = s2 = -1;
+  if (node->child1 && (s0 = program_compile_node(c, node->child1)) < 0) return -1;
+  if (node->child2 && (s1 = program_compile_node(c, node->child2)) < 0) return -1;
+  if (node->child3 && (s2 = program_compile_node(c, node->child3)) < 0) return -1;
+
+  switch (node->id) {
+  case ID_ADD: return program_binary(c, OP_ADD, s0, s1);
+  case ID_SUB: return program_binary(c, OP_SUB, s0, s1);
+  case ID_MUL: return program_binary(c, OP_MUL, s0, s1);
+  case ID_DIV: return program_binary(c, OP_DIV, s0, s1);
+  case ID_FMOD: return program_binary(c, OP_FMOD, s0, s1);
+  case ID_NEG: return program_unary(c, OP_NEG, s0);
+  case ID_AND: return program_binary(c, OP_AND, s0, s1);
+  case ID_OR: return program_binary(c, OP_OR, s0, s1);
+  case ID_NOT: return program_unary(c, OP_NOT, s0);
+  /* for vectors, so_eval_traverse() compares the first component */
+  case ID_LEQ: return program_binary(c, OP_LEQ, s0, s1);
+  case ID_GEQ: return program_binary(c, OP_GEQ, s0, s1);
+  case ID_EQ: return program_binary(c, OP_EQ, s0, s1);
+  case ID_NEQ: return program_binary(c, OP_NEQ, s0, s1);
+  case ID_LT: return program_binary(c, OP_LT, s0, s1);
+  case ID_GT: return program_binary(c, OP_GT, s0, s1);
+  case ID_COS: return program_unary(c, OP_COS, s0);
+  case ID_SIN: return program_unary(c, OP_SIN, s0);
+  case ID_TAN: return program_unary(c, OP_TAN, s0);
+  case ID_ACOS: return program_unary(c, OP_ACOS, s0);
+  case ID_ASIN: return program_unary(c, OP_ASIN, s0);
+  case ID_ATAN: return program_unary(c, OP_ATAN, s0);
+  case ID_ATAN2: return program_binary(c, OP_ATAN2, s0, s1);
+  case ID_COSH: return program_unary(c, OP_COSH, s0);
+  case ID_SINH: return program_unary(c, OP_SINH, s0);
+  case ID_TANH: return program_unary(c, OP_TANH, s0);
+  case ID_SQRT: return program_unary(c, OP_SQRT, s0);
+  case ID_EXP: return program_unary(c, OP_EXP, s0);
+  case ID_LOG: return program_unary(c, OP_LOG, s0);
+  case ID_LOG10: return program_unary(c, OP_LOG10, s0);
+  case ID_CEIL: return program_unary(c, OP_CEIL, s0);
+  case ID_FLOOR: return program_unary(c, OP_FLOOR, s0);
+  case ID_FABS: return program_unary(c, OP_FABS, s0);
+  case ID_POW: return program_binary(c, OP_POW, s0, s1);
+  case ID_TEST_FLT: return program_unary(c, OP_TEST_FLT, s0);
+  case ID_TEST_VEC: return program_unary(c, OP_TEST_VEC, s0);
+  case ID_FLT_COND:
+    dst = program_new_slots(c, 1);
+    program_emit(c, OP_SELECT, dst, s0, s1, s2);
+    return dst;
+  case ID_LEN: return program_unary(c, OP_LEN, s0);
+  case ID_DOT:
+    /* v0[0]*v1[0] + v0[1]*v1[1] + v0[2]*v1[2], in that order */
+    dst = program_binary(c, OP_MUL, s0, s1);
+    dst = program_binary(c, OP_ADD, dst, program_binary(c, OP_MUL, s0 + 1, s1 + 1));
+    return program_binary(c, OP_ADD, dst, program_binary(c, OP_MUL, s0 + 2, s1 + 2));
+  default:
+    break;
+  }
+
+  /* vector results */
+  dst = program_new_slots(c, 3);
+  switch (node->id) {
+  case ID_ADD_VEC:
+  case ID_SUB_VEC:
+    for (i = 0; i < 3; i++) {
+      program_emit(c, node->id == ID_ADD_VEC ? OP_ADD : OP_SUB,
+                   dst + i, s0 + i, s1 + i, -1);
+    }
+    break;
+  case ID_NEG_VEC:
+    for (i = 0; i < 3; i++) program_emit(c, OP_NEG, dst + i, s0 + i, -1, -1);
+    break;
+  case ID_MUL_VEC_FLT:
+    for (i = 0; i < 3; i++) program_emit(c, OP_MUL, dst + i, s0 + i, s1, -1);
+    break;
+  case ID_DIV_VEC_FLT:
+    /* same as OP_DIV, dividing by FLT_EPSILON instead of zero */
+    for (i = 0; i < 3; i++) program_emit(c, OP_DIV, dst + i, s0 + i, s1, -1);
+    break;
+  case ID_CROSS:
+    for (i = 0; i < 3; i++) {
+      int a = (i + 1) % 3, b = (i + 2) % 3;
+      program_emit(c, OP_SUB, dst + i,
+                   program_binary(c, OP_MUL, s0 + a, s1 + b),
+                   program_binary(c, OP_MUL, s0 + b, s1 + a), -1);
+    }
+    break;
+  case ID_NORMALIZE:
+    program_emit(c, OP_NORMALIZE, dst, s0, -1, -1);
+    break;
+  case ID_VEC3F:
+    program_emit(c, OP_MOV, dst, s0, -1, -1);
+    program_emit(c, OP_MOV, dst + 1, s1, -1, -1);
+    program_emit(c, OP_MOV, dst + 2, s2, -1, -1);
+    break;
+  case ID_VEC_COND:
+    for (i = 0; i < 3; i++) program_emit(c, OP_SELECT, dst + i, s0, s1 + i, s2 + i);
+    break;
+  default:
+    assert(0 && "unknown node id");
+    c->error = 1;
+    return -1;
+  }
+  return dst;
+}
+
+so_eval_program *
+so_eval_compile(so_eval_node **nodes, int numnodes)
+{
+  program_compiler c;
+  int i;
+  so_eval_program *program = (so_eval_program *) malloc(sizeof(so_eval_program));
+  memset(program, 0, sizeof(so_eval_program));
+  program->numslots = SO_EVAL_NUM_REG_SLOTS;
+
+  c.program = program;
+  c.maxinstructions = 0;
+  c.error = 0;
+  for (i = 0; i < numnodes && !c.error; i++) {
+    (void) program_compile_node(&c, nodes[i]);
+  }
+  if (c.error) {
+    so_eval_program_delete(program);
+    return NULL;
+  }
+  for (i = 0; i < SO_EVAL_NUM_TMP_SLOTS; i++) {
+    if (program->tmpreadfirst[i] && program->tmpwritten[i]) program->sequential = 1;
+  }
+  return program;
+}
+
+void
+so_eval_program_delete(so_eval_program *program)
+{
+  if (program) {
+    free(program->instructions);
+    free(program);
+  }
+}
+
+void
+so_eval_program_run(const so_eval_program *program, float *slots, int num)
+{
+  int i, k;
+  const so_eval_instruction *ins = program->instructions;
+
+  assert(num >= 0 && num <= SO_EVAL_BLOCKSIZE);
+
+  /* output registers are cleared for every element */
+  for (i = SO_EVAL_SLOT_OUT_FLT; i < SO_EVAL_NUM_REG_SLOTS; i++) {
+    memset(slots + i * SO_EVAL_BLOCKSIZE, 0, num * sizeof(float));
+  }
+
+  for (i = 0; i < program->numinstructions; i++, ins++) {
+    float *d = slots + ins->dst * SO_EVAL_BLOCKSIZE;
+    const float *a = slots + ins->src[0] * SO_EVAL_BLOCKSIZE;
+    const float *b = slots + ins->src[1] * SO_EVAL_BLOCKSIZE;
+    const float *c = slots + ins->src[2] * SO_EVAL_BLOCKSIZE;
+
+    switch (ins->op) {
+    case OP_CONST:
+      for (k = 0; k < num; k++) d[k] = ins->value;
+      break;
+    case OP_MOV:
+      for (k = 0; k < num; k++) d[k] = a[k];
+      break;
+    case OP_ADD:
+      for (k = 0; k < num; k++) d[k] = a[k] + b[k];
+      break;
+    case OP_SUB:
+      for (k = 0; k < num; k++) d[k] = a[k] - b[k];
+      break;
+    case OP_MUL:
+      for (k = 0; k < num; k++) d[k] = a[k] * b[k];
+      break;
+    case OP_DIV:
+      for (k = 0; k < num; k++) {
+        d[k] = b[k] == 0.0f ? a[k] / FLT_EPSILON : a[k] / b[k];
+      }
+      break;
+    case OP_FMOD:
+      for (k = 0; k < num; k++) {
+        d[k] = b[k] != 0.0f ? (float) fmod(a[k], b[k]) : 0.0f;
+      }
+      break;
+    case OP_NEG:
+      for (k = 0; k < num; k++) d[k] = - a[k];
+      break;
+    case OP_AND:
+      for (k = 0; k < num; k++) d[k] = (a[k] != 0.0f && b[k] != 0.0f) ? 1.0f : 0.0f;
+      break;
+    case OP_OR:
+      for (k = 0; k < num; k++) d[k] = (a[k] != 0.0f || b[k] != 0.0f) ? 1.0f : 0.0f;
+      break;
+    case OP_NOT:
+      for (k = 0; k < num; k++) d[k] = a[k] == 0.0f ? 1.0f : 0.0f;
+      break;
+    case OP_LEQ:
+      for (k = 0; k < num; k++) d[k] = a[k] <= b[k] ? 1.0f : 0.0f;
+      break;
+    case OP_GEQ:
+      for (k = 0; k < num; k++) d[k] = a[k] >= b[k] ? 1.0f : 0.0f;
+      break;
+    case OP_EQ:
+      for (k = 0; k < num; k++) d[k] = a[k] == b[k] ? 1.0f : 0.0f;
+      break;
+    case OP_NEQ:
+      for (k = 0; k < num; k++) d[k] = a[k] != b[k] ? 1.0f : 0.0f;
+      break;
+    case OP_LT:
+      for (k = 0; k < num; k++) d[k] = a[k] < b[k] ? 1.0f : 0.0f;
+      break;
+    case OP_GT:
+      for (k = 0; k < num; k++) d[k] = a[k] > b[k] ? 1.0f : 0.0f;
+      break;
+    case OP_COS:
+      for (k = 0; k < num; k++) d[k] = (float) cos(a[k]);
+      break;
+    case OP_SIN:
+      for (k = 0; k < num; k++) d[k] = (float) sin(a[k]);
+      break;
+    case OP_TAN:
+      for (k = 0; k < num; k++) d[k] = (float) tan(a[k]);
+      break;
+    case OP_ACOS:
+      for (k = 0; k < num; k++) {
+        float v = a[k] <= -1.0f ? -1.0f : (a[k] >= 1.0f ? 1.0f : a[k]);
+        d[k] = (float) acos(v);
+      }
+      break;
+    case OP_ASIN:
+      for (k = 0; k < num; k++) {
+        float v = a[k] <= -1.0f ? -1.0f : (a[k] >= 1.0f ? 1.0f : a[k]);
+        d[k] = (float) asin(v);
+      }
+      break;
+    case OP_ATAN:
+      for (k = 0; k < num; k++) d[k] = (float) atan(a[k]);
+      break;
+    case OP_ATAN2:
+      for (k = 0; k < num; k++) {
+        if (b[k] == 0.0) {
+          d[k] = (float) (a[k] >= 0.0f ? M_PI * 0.5 : - M_PI * 0.5);
+        }
+        else {
+          d[k] = (float) atan2(a[k], b[k]);
+        }
+      }
+      break;
+    case OP_COSH:
+      for (k = 0; k < num; k++) d[k] = (float) cosh(a[k]);
+      break;
+    case OP_SINH:
+      for (k = 0; k < num; k++) d[k] = (float) sinh(a[k]);
+      break;
+    case OP_TANH:
+      for (k = 0; k < num; k++) d[k] = (float) tanh(a[k]);
+      break;
+    case OP_SQRT:
+      for (k = 0; k < num; k++) d[k] = a[k] > 0.0f ? (float) sqrt(a[k]) : 0.0f;
+      break;
+    case OP_EXP:
+      for (k = 0; k < num; k++) d[k] = (float) exp(a[k]);
+      break;
+    case OP_LOG:
+      for (k = 0; k < num; k++) d[k] = a[k] <= 0.0f ? -128.0f : (float) log(a[k]);
+      break;
+    case OP_LOG10:
+      for (k = 0; k < num; k++) d[k] = a[k] <= 0.0f ? -38.0f : (float) log10(a[k]);
+      break;
+    case OP_CEIL:
+      for (k = 0; k < num; k++) d[k] = (float) ceil(a[k]);
+      break;
+    case OP_FLOOR:
+      for (k = 0; k < num; k++) d[k] = (float) floor(a[k]);
+      break;
+    case OP_FABS:
+      for (k = 0; k < num; k++) d[k] = (float) fabs(a[k]);
+      break;
+    case OP_POW:
+      for (k = 0; k < num; k++) {
+        if (a[k] == 0.0f) d[k] = 0.0f;
+        else if (a[k] > 0.0f) d[k] = (float) pow(a[k], b[k]);
+        else d[k] = (float) pow(a[k], floor(b[k] + 0.5));
+      }
+      break;
+    case OP_TEST_FLT:
+      for (k = 0; k < num; k++) d[k] = a[k] != 0.0f ? 1.0f : 0.0f;
+      break;
+    case OP_TEST_VEC:
+      {
+        const float *a1 = a + SO_EVAL_BLOCKSIZE, *a2 = a1 + SO_EVAL_BLOCKSIZE;
+        for (k = 0; k < num; k++) {
+          d[k] = (a[k] != 0.0f || a1[k] != 0.0f || a2[k] != 0.0f) ? 1.0f : 0.0f;
+        }
+      }
+      break;
+    case OP_SELECT:
+      for (k = 0; k < num; k++) d[k] = a[k] != 0.0f ? b[k] : c[k];
+      break;
+    case OP_LEN:
+      {
+        const float *a1 = a + SO_EVAL_BLOCKSIZE, *a2 = a1 + SO_EVAL_BLOCKSIZE;
+        for (k = 0; k < num; k++) {
+          d[k] = (float) sqrt(a[k]*a[k] + a1[k]*a1[k] + a2[k]*a2[k]);
+        }
+      }
+      break;
+    case OP_NORMALIZE:
+      {
+        const float *a1 = a + SO_EVAL_BLOCKSIZE, *a2 = a1 + SO_EVAL_BLOCKSIZE;
+        float *d1 = d + SO_EVAL_BLOCKSIZE, *d2 = d1 + SO_EVAL_BLOCKSIZE;
+        for (k = 0; k < num; k++) {
+          float len = (float) sqrt(a[k]*a[k] + a1[k]*a1[k] + a2[k]*a2[k]);
+          if (len > 0.0f) {
+            d[k] = a[k] / len;
+            d1[k] = a1[k] / len;
+            d2[k] = a2[k] / len;
+          }
+          else {
+            d[k] = d1[k] = d2[k] = 0.0f;
+          }
+        }
+      }
+      break;
+    default:
+      assert(0 && "unknown opcode");
+      break;
+    }
+  }
+}
@@ -132,6 +132,7 @@
 #endif // HAVE_CONFIG_H
 #include "SbBasicP.h"
 #include "engines/SoConvertAll.h"
+#include "engines/SoEngineSchedulerP.h"
 #include "fields/SoGlobalField.h"
 #include "io/SoWriterefCounter.h"
 #include "misc/SoConfigSettings.h"
@@ -2534,7 +2535,13 @@ SoField::valueChanged(SbBool resetdefault)
   if (this->changeStatusBits(FLAG_READONLY, TRUE)) {
     this->setDirty(FALSE);
     if (resetdefault) this->setDefault(FALSE);
-    if (this->container) this->startNotify();
+    // SoEngineScheduler writes engine outputs from worker threads with
+    // notification disabled on the slaves, which then must not enter
+    // the global notification in SoDB::startNotify()
+    if (this->container &&
+        (!SoEngineSchedulerP::evaluating || this->isNotifyEnabled())) {
+      this->startNotify();
+    }
     this->clearStatusBits(FLAG_READONLY);
   }
 }
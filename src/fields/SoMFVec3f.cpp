@@ -178,4 +178,48 @@ BOOST_AUTO_TEST_CASE(initialized)
   BOOST_CHECK_EQUAL(field.getNum(), 0);
 }
 
+#include <cstdlib>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoOutput.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+
+// The bulk binary writer must produce something the (value by value)
+// binary reader understands.
+BOOST_AUTO_TEST_CASE(binaryRoundTrip)
+{
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->ref();
+  const int num = 5000;
+  coords->point.setNum(num);
+  SbVec3f * v = coords->point.startEditing();
+  for (int i = 0; i < num; i++) { v[i].setValue(float(i), -float(i), 0.25f * i); }
+  coords->point.finishEditing();
+
+  SoOutput out;
+  out.setBinary(TRUE);
+  out.setBuffer(malloc(1024), 1024, realloc);
+  SoWriteAction wa(&out);
+  wa.apply(coords);
+
+  void * buf;
+  size_t size;
+  BOOST_REQUIRE(out.getBuffer(buf, size));
+
+  SoInput in;
+  in.setBuffer(buf, size);
+  SoNode * node = NULL;
+  BOOST_REQUIRE(SoDB::read(&in, node) && node);
+  node->ref();
+  BOOST_REQUIRE(node->isOfType(SoCoordinate3::getClassTypeId()));
+  const SoMFVec3f & point = static_cast<SoCoordinate3 *>(node)->point;
+  BOOST_REQUIRE_EQUAL(point.getNum(), num);
+  BOOST_CHECK(point == coords->point);
+
+  node->unref();
+  coords->unref();
+  free(buf);
+}
+
 #endif // COIN_TEST_SUITE
@@ -252,6 +252,15 @@
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/errors/SoReadError.h>
 #include <Inventor/fields/SoSubField.h>
+#include <Inventor/fields/SoMFColor.h>
+#include <Inventor/fields/SoMFDouble.h>
+#include <Inventor/fields/SoMFFloat.h>
+#include <Inventor/fields/SoMFInt32.h>
+#include <Inventor/fields/SoMFUInt32.h>
+#include <Inventor/fields/SoMFVec2f.h>
+#include <Inventor/fields/SoMFVec3d.h>
+#include <Inventor/fields/SoMFVec3f.h>
+#include <Inventor/fields/SoMFVec4f.h>
 
 #include "threads/threadsutilp.h"
 #include "tidbitsp.h"
@@ -612,6 +621,29 @@ SoMField::readBinaryValues(SoInput * in, int numarg)
   return TRUE;
 }
 
+// Returns the number of 4- or 8-byte components per value for the
+// built-in multi-value fields where write1Value() in binary mode just
+// writes each component through SoOutput::write(int/float/double),
+// and 0 for all other fields. Only exact type matches are accepted,
+// since a subclass may have overridden write1Value().
+static int
+somfield_get_bulk_components(const SoType & type, size_t & compsize)
+{
+  compsize = sizeof(float);
+  if ((type == SoMFFloat::getClassTypeId()) ||
+      (type == SoMFInt32::getClassTypeId()) ||
+      (type == SoMFUInt32::getClassTypeId())) { return 1; }
+  if (type == SoMFVec2f::getClassTypeId()) { return 2; }
+  if ((type == SoMFVec3f::getClassTypeId()) ||
+      (type == SoMFColor::getClassTypeId())) { return 3; }
+  if (type == SoMFVec4f::getClassTypeId()) { return 4; }
+
+  compsize = sizeof(double);
+  if (type == SoMFDouble::getClassTypeId()) { return 1; }
+  if (type == SoMFVec3d::getClassTypeId()) { return 3; }
+  return 0;
+}
+
 /*!
   Write all values of field to \a out in binary format.
 */
@@ -622,7 +654,31 @@ SoMField::writeBinaryValues(SoOutput * out) const
 
   const int count = this->getNum();
   out->write(count);
-  for (int i=0; i < count; i++) this->write1Value(out, i);
+
+  size_t compsize;
+  const int numcomp = somfield_get_bulk_components(this->getTypeId(), compsize);
+  if (numcomp == 0) {
+    for (int i=0; i < count; i++) this->write1Value(out, i);
+    return;
+  }
+
+  // The binary format of these fields is the value array itself, so
+  // hand it to SoOutput in large blocks instead of making a (virtual)
+  // write1Value() call per value. Blocks are bounded to keep the
+  // length argument within range for huge fields.
+  const unsigned char * values = static_cast<const unsigned char *>
+    (const_cast<SoMField *>(this)->valuesPtr());
+  const int blocksize = 1024 * 1024;
+  for (int i = 0; i < count; i += blocksize) {
+    const int n = SbMin(blocksize, count - i) * numcomp;
+    const unsigned char * p = values + size_t(i) * numcomp * compsize;
+    if (compsize == sizeof(int32_t)) {
+      out->writeBinaryArray(reinterpret_cast<const int32_t *>(p), n);
+    }
+    else {
+      out->writeBinaryArray(reinterpret_cast<const double *>(p), n);
+    }
+  }
 }
 
 // Number of values written to each line during export to ASCII format
@@ -37,6 +37,7 @@
 #include <cstdio>
 
 #include <Inventor/C/base/string.h>
+#include <Inventor/C/threads/rwmutex.h>
 
 #include "base/dict.h"
 #include "threads/threadsutilp.h"
@@ -66,13 +67,24 @@ struct cc_glyph2d {
   SbBool mono;
 };
 
-static cc_dict * glyph2d_fonthash = NULL;
-static SbBool glyph2d_initialized = FALSE;
-
 /*
-  Mutex lock for the static ang global font hash
+  The glyphs are stored in a number of shards, picked from the font
+  specification, so that threads rendering text with different fonts
+  don't wait for each other. Each shard has a dictionary with a list
+  of glyphs for each character, protected by a read-write mutex, so
+  that threads looking up glyphs that already exist in the same shard
+  only need exclusive access while updating the reference counts.
 */
-static void * glyph2d_fonthash_lock = NULL;
+#define GLYPH2D_NUM_SHARDS 16
+
+struct glyph2d_shard {
+  cc_dict * fonthash;
+  cc_rwmutex * fonthash_lock;
+  void * refcount_lock;
+};
+
+static glyph2d_shard glyph2d_shards[GLYPH2D_NUM_SHARDS];
+static SbBool glyph2d_initialized = FALSE;
 
 /* Set '#if 1' to enable debug output to stderr for tracking mutex locking. */
 #if 0
@@ -86,81 +98,126 @@ static void * glyph2d_fonthash_lock = NULL;
     (void)fprintf(stderr, "glyph2d mutex unlock in %s\n", __func__); \
     CC_MUTEX_UNLOCK(m); \
   } while (0)
+#define GLYPH2D_READ_LOCK(m) \
+  do { \
+    (void)fprintf(stderr, "glyph2d read lock in %s\n", __func__); \
+    (void)cc_rwmutex_read_lock(m); \
+  } while (0)
+#define GLYPH2D_READ_UNLOCK(m) \
+  do { \
+    (void)fprintf(stderr, "glyph2d read unlock in %s\n", __func__); \
+    (void)cc_rwmutex_read_unlock(m); \
+  } while (0)
+#define GLYPH2D_WRITE_LOCK(m) \
+  do { \
+    (void)fprintf(stderr, "glyph2d write lock in %s\n", __func__); \
+    (void)cc_rwmutex_write_lock(m); \
+  } while (0)
+#define GLYPH2D_WRITE_UNLOCK(m) \
+  do { \
+    (void)fprintf(stderr, "glyph2d write unlock in %s\n", __func__); \
+    (void)cc_rwmutex_write_unlock(m); \
+  } while (0)
 #else
 #define GLYPH2D_MUTEX_LOCK(m) CC_MUTEX_LOCK(m)
 #define GLYPH2D_MUTEX_UNLOCK(m) CC_MUTEX_UNLOCK(m)
+#define GLYPH2D_READ_LOCK(m) (void)cc_rwmutex_read_lock(m)
+#define GLYPH2D_READ_UNLOCK(m) (void)cc_rwmutex_read_unlock(m)
+#define GLYPH2D_WRITE_LOCK(m) (void)cc_rwmutex_write_lock(m)
+#define GLYPH2D_WRITE_UNLOCK(m) (void)cc_rwmutex_write_unlock(m)
 #endif
 
 static void
 cc_glyph2d_cleanup(void)
 {
-  CC_MUTEX_DESTRUCT(glyph2d_fonthash_lock);
-  cc_dict_destruct(glyph2d_fonthash);
-  glyph2d_fonthash = NULL;
+  for (int i = 0; i < GLYPH2D_NUM_SHARDS; i++) {
+    glyph2d_shard * shard = &glyph2d_shards[i];
+    cc_rwmutex_destruct(shard->fonthash_lock);
+    CC_MUTEX_DESTRUCT(shard->refcount_lock);
+    cc_dict_destruct(shard->fonthash);
+    shard->fonthash_lock = NULL;
+    shard->refcount_lock = NULL;
+    shard->fonthash = NULL;
+  }
   glyph2d_initialized = FALSE;
 }
 
 static void
 cc_glyph2d_initialize()
 {
-  CC_MUTEX_CONSTRUCT(glyph2d_fonthash_lock);
-  GLYPH2D_MUTEX_LOCK(glyph2d_fonthash_lock);
-  
+  CC_GLOBAL_LOCK;
+
   if (glyph2d_initialized) {
-    GLYPH2D_MUTEX_UNLOCK(glyph2d_fonthash_lock);
+    CC_GLOBAL_UNLOCK;
     return;
   }
-  glyph2d_initialized = TRUE;
-  
-  glyph2d_fonthash = cc_dict_construct(15, 0.75);
+
+  for (int i = 0; i < GLYPH2D_NUM_SHARDS; i++) {
+    glyph2d_shard * shard = &glyph2d_shards[i];
+    shard->fonthash = cc_dict_construct(15, 0.75);
+    shard->fonthash_lock = cc_rwmutex_construct();
+    shard->refcount_lock = static_cast<void *>(cc_mutex_construct());
+  }
 
   /* +1, so it happens before the underlying font abstraction layer
      cleans itself up: */
   coin_atexit((coin_atexit_f*) cc_glyph2d_cleanup, CC_ATEXIT_FONT_SUBSYSTEM_HIGHPRIORITY);
-  
-  GLYPH2D_MUTEX_UNLOCK(glyph2d_fonthash_lock);
+
+  glyph2d_initialized = TRUE;
+  CC_GLOBAL_UNLOCK;
 }
 
-cc_glyph2d * 
-cc_glyph2d_ref(uint32_t character, const cc_font_specification * spec, float angle)
+/* Returns the shard for the glyphs of a font. Hashes the same fields
+   as glyph2d_specmatch() compares. */
+static glyph2d_shard *
+glyph2d_getshard(const cc_font_specification * spec)
+{
+  uint32_t hash = cc_string_hash(&spec->name);
+  hash = hash * 31 + cc_string_hash(&spec->style);
+  hash = hash * 31 + uint32_t(int(spec->size));
+  return &glyph2d_shards[(hash ^ (hash >> 16)) % GLYPH2D_NUM_SHARDS];
+}
+
+/* Returns the glyph for a character in a shard, or NULL. Called with
+   the shard locked for reading or writing. */
+static cc_glyph2d *
+glyph2d_find(glyph2d_shard * shard, uint32_t character,
+             const cc_font_specification * spec)
+{
+  void * val;
+  if (cc_dict_get(shard->fonthash, (uintptr_t)character, &val)) {
+    cc_list * glyphlist = (cc_list *) val;
+    for (int i = 0; i < cc_list_get_length(glyphlist); ++i) {
+      cc_glyph2d * glyph = (cc_glyph2d *) cc_list_get(glyphlist, i);
+      if (glyph2d_specmatch(spec, glyph->c.fontspec)) return glyph;
+    }
+  }
+  return NULL;
+}
+
+/* Creates a glyph and adds it to a shard. Called with the shard
+   locked for writing. */
+static cc_glyph2d *
+glyph2d_create(glyph2d_shard * shard, uint32_t character,
+               const cc_font_specification * spec, float angle)
 {
   void * val;
   cc_glyph2d * glyph;
   int fontidx;
   int glyphidx;
-  int i;
   struct cc_font_bitmap * bm;
   cc_font_specification * newspec;
   cc_string * fonttoload;
   cc_list * glyphlist;
 
-
-  /* because this function is the entry point for glyph2d, the mutex
-     is initialized here. */
-  if (glyph2d_fonthash_lock == NULL) 
-    cc_glyph2d_initialize();
-  
-  assert(spec);
-
-  GLYPH2D_MUTEX_LOCK(glyph2d_fonthash_lock);
-
-  /* Has the glyph been created before? */
-  if (cc_dict_get(glyph2d_fonthash, (uintptr_t)character, &val)) {
+  if (cc_dict_get(shard->fonthash, (uintptr_t)character, &val)) {
     glyphlist = (cc_list *) val;
-    for (i = 0; i < cc_list_get_length(glyphlist); ++i) {
-      glyph = (cc_glyph2d *) cc_list_get(glyphlist, i);
-      if (glyph2d_specmatch(spec, glyph->c.fontspec)) {
-        GLYPH2D_MUTEX_UNLOCK(glyph2d_fonthash_lock);
-        glyph->c.refcount++;
-        return glyph;
-      }
-    }    
-  } 
+  }
   else {
     /* No glyphlist for this character is found. Create one and
        add it to the hashtable. */
     glyphlist = cc_list_construct();
-    cc_dict_put(glyph2d_fonthash, (uintptr_t)character, glyphlist);
+    cc_dict_put(shard->fonthash, (uintptr_t)character, glyphlist);
   }
 
   assert(glyphlist);
@@ -232,15 +289,80 @@ cc_glyph2d_ref(uint32_t character, const cc_font_specification * spec, float ang
   
   /* Store newly created glyph in the list for this character */
   cc_list_append(glyphlist, glyph);
-  
-  GLYPH2D_MUTEX_UNLOCK(glyph2d_fonthash_lock);
   return glyph;
 }
 
+cc_glyph2d * 
+cc_glyph2d_ref(uint32_t character, const cc_font_specification * spec, float angle)
+{
+  cc_glyph2d * glyph;
+  cc_glyph2d_ref_string(&character, 1, spec, angle, &glyph);
+  return glyph;
+}
+
+/*
+  Refs the glyphs for num characters in the same font, and stores
+  them in glyphs. Equivalent to calling cc_glyph2d_ref() for each
+  character, but only locks the glyph cache once for the characters
+  that have been used before, and once more for the rest.
+*/
+void
+cc_glyph2d_ref_string(const uint32_t * characters, int num,
+                      const cc_font_specification * spec, float angle,
+                      cc_glyph2d ** glyphs)
+{
+  int i, missing = 0;
+
+  /* because this function is the entry point for glyph2d, the
+     glyph cache is initialized here. */
+  if (!glyph2d_initialized) 
+    cc_glyph2d_initialize();
+  
+  assert(spec);
+
+  glyph2d_shard * shard = glyph2d_getshard(spec);
+
+  /* Look up the glyphs that have been created before. Several
+     threads can do this at the same time, but must take turns
+     updating the reference counts. */
+  GLYPH2D_READ_LOCK(shard->fonthash_lock);
+  for (i = 0; i < num; i++) {
+    glyphs[i] = glyph2d_find(shard, characters[i], spec);
+    if (glyphs[i] == NULL) missing++;
+  }
+  if (missing < num) {
+    GLYPH2D_MUTEX_LOCK(shard->refcount_lock);
+    for (i = 0; i < num; i++) {
+      if (glyphs[i]) glyphs[i]->c.refcount++;
+    }
+    GLYPH2D_MUTEX_UNLOCK(shard->refcount_lock);
+  }
+  GLYPH2D_READ_UNLOCK(shard->fonthash_lock);
+
+  if (missing == 0) return;
+
+  /* Create the rest. Another thread may have created some of them
+     since the lookup above, and a character may occur more than once
+     in the string. */
+  GLYPH2D_WRITE_LOCK(shard->fonthash_lock);
+  for (i = 0; i < num; i++) {
+    if (glyphs[i]) continue;
+    glyphs[i] = glyph2d_find(shard, characters[i], spec);
+    if (glyphs[i]) glyphs[i]->c.refcount++;
+    else glyphs[i] = glyph2d_create(shard, characters[i], spec, angle);
+  }
+  GLYPH2D_WRITE_UNLOCK(shard->fonthash_lock);
+}
+
 void
 cc_glyph2d_unref(cc_glyph2d * glyph)
 {
-  cc_glyph_unref(glyph2d_fonthash, &(glyph->c), NULL);
+  glyph2d_shard * shard = glyph2d_getshard(glyph->c.fontspec);
+  /* Exclusive access, since the glyph is removed from the shard if
+     this was the last reference. */
+  GLYPH2D_WRITE_LOCK(shard->fonthash_lock);
+  cc_glyph_unref(shard->fonthash, &(glyph->c), NULL);
+  GLYPH2D_WRITE_UNLOCK(shard->fonthash_lock);
 }
 
 static SbBool 
@@ -297,3 +419,91 @@ cc_glyph2d_getmono(const cc_glyph2d * g)
 
 #undef GLYPH2D_MUTEX_LOCK
 #undef GLYPH2D_MUTEX_UNLOCK
+#undef GLYPH2D_READ_LOCK
+#undef GLYPH2D_READ_UNLOCK
+#undef GLYPH2D_WRITE_LOCK
+#undef GLYPH2D_WRITE_UNLOCK
+
+#ifdef COIN_TEST_SUITE
+
+#include "base/SbParallel.h"
+#include "fonts/fontspec.h"
+#include "fonts/glyph2d.h"
+
+namespace {
+
+const int NUM_SIZES = 32;
+const int NUM_CHARACTERS = 5;
+const uint32_t characters[NUM_CHARACTERS] = { 'H', 'e', 'l', 'l', 'o' };
+
+struct glyph2d_lookup {
+  cc_font_specification specs[NUM_SIZES];
+  cc_glyph2d * expected[NUM_SIZES][NUM_CHARACTERS];
+  int numwrong[SbParallel::MAX_THREADS];
+};
+
+// Looks up the glyphs of all the fonts a number of times, and counts
+// the glyphs that aren't the ones the main thread got.
+void
+glyph2d_lookup_task(void * closure, int task, int)
+{
+  glyph2d_lookup * lookup = static_cast<glyph2d_lookup *>(closure);
+  for (int round = 0; round < 50; round++) {
+    for (int i = 0; i < NUM_SIZES; i++) {
+      cc_glyph2d * glyphs[NUM_CHARACTERS];
+      cc_glyph2d_ref_string(characters, NUM_CHARACTERS, &lookup->specs[i], 0.0f, glyphs);
+      for (int j = 0; j < NUM_CHARACTERS; j++) {
+        if (glyphs[j] != lookup->expected[i][j]) lookup->numwrong[task]++;
+        cc_glyph2d_unref(glyphs[j]);
+      }
+    }
+  }
+}
+
+} // namespace
+
+// Fonts of different sizes are spread over the shards. Looking up a
+// glyph with an equal font specification, or one that only differs in
+// the fraction of the size, finds the same glyph, from any thread.
+BOOST_AUTO_TEST_CASE(shardedLookup)
+{
+  glyph2d_lookup lookup;
+  int i, j;
+  for (i = 0; i < NUM_SIZES; i++) {
+    cc_fontspec_construct(&lookup.specs[i], "defaultFont", float(8 + i), 0.0f);
+    cc_glyph2d_ref_string(characters, NUM_CHARACTERS, &lookup.specs[i], 0.0f,
+                          lookup.expected[i]);
+  }
+
+  int numwrong = 0, numshared = 0;
+  for (i = 0; i < NUM_SIZES; i++) {
+    // the same character twice in a string is the same glyph
+    if (lookup.expected[i][2] != lookup.expected[i][3]) numwrong++;
+    for (j = 0; j < NUM_CHARACTERS; j++) {
+      cc_font_specification spec;
+      cc_fontspec_construct(&spec, "defaultFont", float(8 + i) + 0.5f, 0.0f);
+      cc_glyph2d * glyph = cc_glyph2d_ref(characters[j], &spec, 0.0f);
+      if (glyph != lookup.expected[i][j]) numwrong++;
+      cc_glyph2d_unref(glyph);
+      cc_fontspec_clean(&spec);
+      // a glyph of another size is another glyph
+      if (i > 0 && lookup.expected[i][j] == lookup.expected[i - 1][j]) numshared++;
+    }
+  }
+  BOOST_CHECK_MESSAGE(numwrong == 0, numwrong << " lookups found another glyph");
+  BOOST_CHECK_MESSAGE(numshared == 0, numshared << " glyphs are shared by two sizes");
+
+  const int numtasks = 8;
+  for (i = 0; i < numtasks; i++) lookup.numwrong[i] = 0;
+  SbParallel::run(glyph2d_lookup_task, &lookup, numtasks);
+  numwrong = 0;
+  for (i = 0; i < numtasks; i++) numwrong += lookup.numwrong[i];
+  BOOST_CHECK_MESSAGE(numwrong == 0, numwrong << " concurrent lookups found another glyph");
+
+  for (i = 0; i < NUM_SIZES; i++) {
+    for (j = 0; j < NUM_CHARACTERS; j++) cc_glyph2d_unref(lookup.expected[i][j]);
+    cc_fontspec_clean(&lookup.specs[i]);
+  }
+}
+
+#endif // COIN_TEST_SUITE
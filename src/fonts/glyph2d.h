@@ -48,6 +48,9 @@ extern "C" {
   typedef struct cc_glyph2d cc_glyph2d;
 
   cc_glyph2d * cc_glyph2d_ref(uint32_t character, const cc_font_specification * spec, float angle);
+  void cc_glyph2d_ref_string(const uint32_t * characters, int num,
+                             const cc_font_specification * spec, float angle,
+                             cc_glyph2d ** glyphs);
   void cc_glyph2d_unref(cc_glyph2d * glyph);
 
   void cc_glyph2d_getadvance(const cc_glyph2d * g, int * x, int * y);
@@ -40,6 +40,7 @@
 #include <Inventor/C/basic.h>
 #include <Inventor/C/base/list.h>
 #include <Inventor/C/base/string.h>
+#include <Inventor/C/threads/rwmutex.h>
 
 #include "tidbitsp.h"
 #include "base/dict.h"
@@ -70,14 +71,23 @@ struct cc_glyph3d {
 
 /* ********************************************************************** */
 
-static cc_dict * glyph3d_fonthash = NULL;
+/*
+  The glyphs are sharded on the font specification, like the 2D
+  glyphs. See glyph2d.cpp.
+*/
+#define GLYPH3D_NUM_SHARDS 16
+
+struct glyph3d_shard {
+  cc_dict * fonthash;
+  cc_rwmutex * fonthash_lock;
+  void * refcount_lock;
+};
+
+static glyph3d_shard glyph3d_shards[GLYPH3D_NUM_SHARDS];
 static int glyph3d_spaceglyphindices[] = { -1, -1 };
 static float glyph3d_spaceglyphvertices[] = { 0, 0 };
 static SbBool glyph3d_initialized = FALSE;
 
-/* Mutex lock for the static ang global font hash */
-static void * glyph3d_fonthash_lock = NULL;
-
 /* Because the 3D glyphs are normalized when generated, a standard
    fontsize is used for all glyphs. This also prevent Windows from
    quantizing advancement and kerning values for very small fontsizes
@@ -99,43 +109,120 @@ static unsigned int glyph3d_standardfontsize = 50;
     (void)fprintf(stderr, "glyph3d mutex unlock in %s\n", __func__); \
     CC_MUTEX_UNLOCK(m); \
   } while (0)
+#define GLYPH3D_READ_LOCK(m) \
+  do { \
+    (void)fprintf(stderr, "glyph3d read lock in %s\n", __func__); \
+    (void)cc_rwmutex_read_lock(m); \
+  } while (0)
+#define GLYPH3D_READ_UNLOCK(m) \
+  do { \
+    (void)fprintf(stderr, "glyph3d read unlock in %s\n", __func__); \
+    (void)cc_rwmutex_read_unlock(m); \
+  } while (0)
+#define GLYPH3D_WRITE_LOCK(m) \
+  do { \
+    (void)fprintf(stderr, "glyph3d write lock in %s\n", __func__); \
+    (void)cc_rwmutex_write_lock(m); \
+  } while (0)
+#define GLYPH3D_WRITE_UNLOCK(m) \
+  do { \
+    (void)fprintf(stderr, "glyph3d write unlock in %s\n", __func__); \
+    (void)cc_rwmutex_write_unlock(m); \
+  } while (0)
 #else
 #define GLYPH3D_MUTEX_LOCK(m) CC_MUTEX_LOCK(m)
 #define GLYPH3D_MUTEX_UNLOCK(m) CC_MUTEX_UNLOCK(m)
+#define GLYPH3D_READ_LOCK(m) (void)cc_rwmutex_read_lock(m)
+#define GLYPH3D_READ_UNLOCK(m) (void)cc_rwmutex_read_unlock(m)
+#define GLYPH3D_WRITE_LOCK(m) (void)cc_rwmutex_write_lock(m)
+#define GLYPH3D_WRITE_UNLOCK(m) (void)cc_rwmutex_write_unlock(m)
 #endif
 
 static void
 cc_glyph3d_cleanup(void)
 {
-  CC_MUTEX_DESTRUCT(glyph3d_fonthash_lock);
-  cc_dict_destruct(glyph3d_fonthash);
-  glyph3d_fonthash = NULL;
+  for (int i = 0; i < GLYPH3D_NUM_SHARDS; i++) {
+    glyph3d_shard * shard = &glyph3d_shards[i];
+    cc_rwmutex_destruct(shard->fonthash_lock);
+    CC_MUTEX_DESTRUCT(shard->refcount_lock);
+    cc_dict_destruct(shard->fonthash);
+    shard->fonthash_lock = NULL;
+    shard->refcount_lock = NULL;
+    shard->fonthash = NULL;
+  }
   glyph3d_initialized = FALSE;
 }
 
 static void
 cc_glyph3d_initialize()
 {
-  CC_MUTEX_CONSTRUCT(glyph3d_fonthash_lock);
-  GLYPH3D_MUTEX_LOCK(glyph3d_fonthash_lock);
-  
+  CC_GLOBAL_LOCK;
+
   if (glyph3d_initialized) {
-    GLYPH3D_MUTEX_UNLOCK(glyph3d_fonthash_lock);
+    CC_GLOBAL_UNLOCK;
     return;
   }
-  glyph3d_initialized = TRUE;
-  
-  glyph3d_fonthash = cc_dict_construct(15, 0.75);
+
+  for (int i = 0; i < GLYPH3D_NUM_SHARDS; i++) {
+    glyph3d_shard * shard = &glyph3d_shards[i];
+    shard->fonthash = cc_dict_construct(15, 0.75);
+    shard->fonthash_lock = cc_rwmutex_construct();
+    shard->refcount_lock = static_cast<void *>(cc_mutex_construct());
+  }
 
   /* +1, so it happens before the underlying font abstraction layer
      cleans itself up: */
   coin_atexit((coin_atexit_f*) cc_glyph3d_cleanup, CC_ATEXIT_FONT_SUBSYSTEM_HIGHPRIORITY);
 
-  GLYPH3D_MUTEX_UNLOCK(glyph3d_fonthash_lock);  
+  glyph3d_initialized = TRUE;
+  CC_GLOBAL_UNLOCK;
 }
 
-cc_glyph3d *
-cc_glyph3d_ref(uint32_t character, const cc_font_specification * spec)
+/* Reducing precision of the complexity variable. This is done to
+   prevent the user from flooding the memory with generated glyphs
+   which might be more or less identical */
+static int
+glyph3d_complexitylevel(float complexity)
+{
+  /* Clamp values to [0...1] */
+  if (complexity > 1.0f) complexity = 1.0f;
+  if (complexity < 0.0f) complexity = 0.0f;
+  return (int) (complexity * 10.0f);
+}
+
+/* Returns the shard for the glyphs of a font. Hashes the same fields
+   as glyph3d_specmatch() compares. */
+static glyph3d_shard *
+glyph3d_getshard(const cc_font_specification * spec)
+{
+  uint32_t hash = cc_string_hash(&spec->name);
+  hash = hash * 31 + cc_string_hash(&spec->style);
+  hash = hash * 31 + uint32_t(glyph3d_complexitylevel(spec->complexity));
+  return &glyph3d_shards[(hash ^ (hash >> 16)) % GLYPH3D_NUM_SHARDS];
+}
+
+/* Returns the glyph for a character in a shard, or NULL. Called with
+   the shard locked for reading or writing. */
+static cc_glyph3d *
+glyph3d_find(glyph3d_shard * shard, uint32_t character,
+             const cc_font_specification * spec)
+{
+  void * val;
+  if (cc_dict_get(shard->fonthash, (uintptr_t)character, &val)) {
+    cc_list * glyphlist = (cc_list *) val;
+    for (int i = 0; i < cc_list_get_length(glyphlist); ++i) {
+      cc_glyph3d * glyph = (cc_glyph3d *) cc_list_get(glyphlist, i);
+      if (glyph3d_specmatch(spec, glyph->c.fontspec)) return glyph;
+    }
+  }
+  return NULL;
+}
+
+/* Creates a glyph and adds it to a shard. Called with the shard
+   locked for writing. */
+static cc_glyph3d *
+glyph3d_create(glyph3d_shard * shard, uint32_t character,
+               const cc_font_specification * spec)
 {
   cc_glyph3d * glyph;
   int glyphidx;
@@ -145,32 +232,13 @@ cc_glyph3d_ref(uint32_t character, const cc_font_specification * spec)
   cc_string * fonttoload;
   cc_list * glyphlist = NULL;
 
-  /* because this function is the entry point for glyph3d, the mutex
-     is initialized here. */
-  if (glyph3d_fonthash_lock == NULL) 
-    cc_glyph3d_initialize();
-  
-  assert(spec);
-
-  GLYPH3D_MUTEX_LOCK(glyph3d_fonthash_lock);
-
-  /* Has the glyph been created before? */
-  if (cc_dict_get(glyph3d_fonthash, (uintptr_t)character, &val)) {
-    int i;
+  if (cc_dict_get(shard->fonthash, (uintptr_t)character, &val)) {
     glyphlist = (cc_list *) val;
-    for (i=0;i<cc_list_get_length(glyphlist);++i) {
-      glyph = (cc_glyph3d *) cc_list_get(glyphlist, i);
-      if (glyph3d_specmatch(spec, glyph->c.fontspec)) {
-        GLYPH3D_MUTEX_UNLOCK(glyph3d_fonthash_lock);
-        glyph->c.refcount++;
-        return glyph;
-      }
-    }    
   } else {
     /* No glyphlist for this character is found. Create one and
        add it to the hashtable. */
     glyphlist = cc_list_construct();
-    cc_dict_put(glyph3d_fonthash, (uintptr_t)character, glyphlist);
+    cc_dict_put(shard->fonthash, (uintptr_t)character, glyphlist);
   }
 
   assert(glyphlist);
@@ -249,10 +317,63 @@ cc_glyph3d_ref(uint32_t character, const cc_font_specification * spec)
   /* Store newly created glyph in the list for this character */
   cc_list_append(glyphlist, glyph);
 
-  GLYPH3D_MUTEX_UNLOCK(glyph3d_fonthash_lock);
   return glyph;
 }
 
+cc_glyph3d *
+cc_glyph3d_ref(uint32_t character, const cc_font_specification * spec)
+{
+  cc_glyph3d * glyph;
+  cc_glyph3d_ref_string(&character, 1, spec, &glyph);
+  return glyph;
+}
+
+/*
+  Refs the glyphs for num characters in the same font, and stores
+  them in glyphs. See cc_glyph2d_ref_string().
+*/
+void
+cc_glyph3d_ref_string(const uint32_t * characters, int num,
+                      const cc_font_specification * spec,
+                      cc_glyph3d ** glyphs)
+{
+  int i, missing = 0;
+
+  /* because this function is the entry point for glyph3d, the
+     glyph cache is initialized here. */
+  if (!glyph3d_initialized) 
+    cc_glyph3d_initialize();
+  
+  assert(spec);
+
+  glyph3d_shard * shard = glyph3d_getshard(spec);
+
+  GLYPH3D_READ_LOCK(shard->fonthash_lock);
+  for (i = 0; i < num; i++) {
+    glyphs[i] = glyph3d_find(shard, characters[i], spec);
+    if (glyphs[i] == NULL) missing++;
+  }
+  if (missing < num) {
+    GLYPH3D_MUTEX_LOCK(shard->refcount_lock);
+    for (i = 0; i < num; i++) {
+      if (glyphs[i]) glyphs[i]->c.refcount++;
+    }
+    GLYPH3D_MUTEX_UNLOCK(shard->refcount_lock);
+  }
+  GLYPH3D_READ_UNLOCK(shard->fonthash_lock);
+
+  if (missing == 0) return;
+
+  GLYPH3D_WRITE_LOCK(shard->fonthash_lock);
+  for (i = 0; i < num; i++) {
+    if (glyphs[i]) continue;
+    glyphs[i] = glyph3d_find(shard, characters[i], spec);
+    if (glyphs[i]) glyphs[i]->c.refcount++;
+    else glyphs[i] = glyph3d_create(shard, characters[i], spec);
+  }
+  GLYPH3D_WRITE_UNLOCK(shard->fonthash_lock);
+}
+
 static void
 finalize_glyph3d(cc_glyph * g)
 {
@@ -263,7 +384,10 @@ finalize_glyph3d(cc_glyph * g)
 void 
 cc_glyph3d_unref(cc_glyph3d * glyph)
 {
-  cc_glyph_unref(glyph3d_fonthash, &(glyph->c), finalize_glyph3d);
+  glyph3d_shard * shard = glyph3d_getshard(glyph->c.fontspec);
+  GLYPH3D_WRITE_LOCK(shard->fonthash_lock);
+  cc_glyph_unref(shard->fonthash, &(glyph->c), finalize_glyph3d);
+  GLYPH3D_WRITE_UNLOCK(shard->fonthash_lock);
 }
 
 const float *
@@ -410,30 +534,13 @@ static SbBool
 glyph3d_specmatch(const cc_font_specification * spec1,
                   const cc_font_specification * spec2)
 {
-  float c1, c2;
-  int temp1,temp2;
-  
   assert(spec1);
   assert(spec2);
   
-  /* Reducing precision of the complexity variable. This is done to
-     prevent the user from flooding the memory with generated glyphs
-     which might be more or less identical */
-  c1 = spec1->complexity;
-  c2 = spec2->complexity;
-  
-  /* Clamp values to [0...1] */
-  if (c1 > 1.0f) c1 = 1.0f;
-  if (c1 < 0.0f) c1 = 0.0f;
-  if (c2 > 1.0f) c2 = 1.0f;
-  if (c2 < 0.0f) c2 = 0.0f;
-  
-  temp1 = (int) (c1 * 10.0f);
-  temp2 = (int) (c2 * 10.0f);
-  
   if ((!cc_string_compare(&spec1->name, &spec2->name)) &&
       (!cc_string_compare(&spec1->style, &spec2->style)) &&
-      (temp1 == temp2)) {
+      (glyph3d_complexitylevel(spec1->complexity) ==
+       glyph3d_complexitylevel(spec2->complexity))) {
     /* No need to compare size for 3D fonts */
     return TRUE;
   }
@@ -443,3 +550,91 @@ glyph3d_specmatch(const cc_font_specification * spec1,
 
 #undef GLYPH3D_MUTEX_LOCK
 #undef GLYPH3D_MUTEX_UNLOCK
+#undef GLYPH3D_READ_LOCK
+#undef GLYPH3D_READ_UNLOCK
+#undef GLYPH3D_WRITE_LOCK
+#undef GLYPH3D_WRITE_UNLOCK
+
+#ifdef COIN_TEST_SUITE
+
+#include "base/SbParallel.h"
+#include "fonts/fontspec.h"
+#include "fonts/glyph3d.h"
+
+namespace {
+
+const int NUM_LEVELS = 11;
+const int NUM_CHARACTERS = 5;
+const uint32_t characters[NUM_CHARACTERS] = { 'H', 'e', 'l', 'l', 'o' };
+
+struct glyph3d_lookup {
+  cc_font_specification specs[NUM_LEVELS];
+  cc_glyph3d * expected[NUM_LEVELS][NUM_CHARACTERS];
+  int numwrong[SbParallel::MAX_THREADS];
+};
+
+// Looks up the glyphs of all the complexity levels a number of times,
+// and counts the glyphs that aren't the ones the main thread got.
+void
+glyph3d_lookup_task(void * closure, int task, int)
+{
+  glyph3d_lookup * lookup = static_cast<glyph3d_lookup *>(closure);
+  for (int round = 0; round < 50; round++) {
+    for (int i = 0; i < NUM_LEVELS; i++) {
+      cc_glyph3d * glyphs[NUM_CHARACTERS];
+      cc_glyph3d_ref_string(characters, NUM_CHARACTERS, &lookup->specs[i], glyphs);
+      for (int j = 0; j < NUM_CHARACTERS; j++) {
+        if (glyphs[j] != lookup->expected[i][j]) lookup->numwrong[task]++;
+        cc_glyph3d_unref(glyphs[j]);
+      }
+    }
+  }
+}
+
+} // namespace
+
+// The complexity levels are spread over the shards. Looking up a
+// glyph with a font specification of the same complexity level finds
+// the same glyph, whatever the size, from any thread.
+BOOST_AUTO_TEST_CASE(shardedLookup)
+{
+  glyph3d_lookup lookup;
+  int i, j;
+  for (i = 0; i < NUM_LEVELS; i++) {
+    cc_fontspec_construct(&lookup.specs[i], "defaultFont", 10.0f, (i + 0.2f) / 10.0f);
+    cc_glyph3d_ref_string(characters, NUM_CHARACTERS, &lookup.specs[i],
+                          lookup.expected[i]);
+  }
+
+  int numwrong = 0, numshared = 0;
+  for (i = 0; i < NUM_LEVELS; i++) {
+    // the same character twice in a string is the same glyph
+    if (lookup.expected[i][2] != lookup.expected[i][3]) numwrong++;
+    for (j = 0; j < NUM_CHARACTERS; j++) {
+      cc_font_specification spec;
+      cc_fontspec_construct(&spec, "defaultFont", 20.0f, (i + 0.8f) / 10.0f);
+      cc_glyph3d * glyph = cc_glyph3d_ref(characters[j], &spec);
+      if (glyph != lookup.expected[i][j]) numwrong++;
+      cc_glyph3d_unref(glyph);
+      cc_fontspec_clean(&spec);
+      // a glyph of another complexity level is another glyph
+      if (i > 0 && lookup.expected[i][j] == lookup.expected[i - 1][j]) numshared++;
+    }
+  }
+  BOOST_CHECK_MESSAGE(numwrong == 0, numwrong << " lookups found another glyph");
+  BOOST_CHECK_MESSAGE(numshared == 0, numshared << " glyphs are shared by two levels");
+
+  const int numtasks = 8;
+  for (i = 0; i < numtasks; i++) lookup.numwrong[i] = 0;
+  SbParallel::run(glyph3d_lookup_task, &lookup, numtasks);
+  numwrong = 0;
+  for (i = 0; i < numtasks; i++) numwrong += lookup.numwrong[i];
+  BOOST_CHECK_MESSAGE(numwrong == 0, numwrong << " concurrent lookups found another glyph");
+
+  for (i = 0; i < NUM_LEVELS; i++) {
+    for (j = 0; j < NUM_CHARACTERS; j++) cc_glyph3d_unref(lookup.expected[i][j]);
+    cc_fontspec_clean(&lookup.specs[i]);
+  }
+}
+
+#endif // COIN_TEST_SUITE
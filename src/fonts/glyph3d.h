@@ -49,6 +49,9 @@ extern "C" {
 
   cc_glyph3d * cc_glyph3d_ref(uint32_t character,
                               const cc_font_specification * spec);
+  void cc_glyph3d_ref_string(const uint32_t * characters, int num,
+                             const cc_font_specification * spec,
+                             cc_glyph3d ** glyphs);
   void cc_glyph3d_unref(cc_glyph3d * glyph);
 
   const float * cc_glyph3d_getcoords(const cc_glyph3d * g);
@@ -59,6 +59,7 @@
 
 #include "steel.h"
 #include "nodekits/SoSubKitP.h"
+#include "foreignfiles/SoSTLFileKit_Stream.h"
 
 
 #if 0
@@ -101,8 +102,37 @@ public:
   int numsharedvertices;
   int numsharednormals;
   int numredundantfacets;
+
+  SbBool buildModel(SoSTLFacets & facets, SoCoordinate3 * coordinates,
+                    SoNormal * normals, SoIndexedFaceSet * faceset);
 }; // SoSTLFileKitP
 
+// Replaces the model with the indexed mesh of the given facets.
+SbBool
+SoSTLFileKitP::buildModel(SoSTLFacets & facets, SoCoordinate3 * coordinates,
+                          SoNormal * normals, SoIndexedFaceSet * faceset)
+{
+  SoSTLMeshStats stats;
+  if (!SoSTLFileKit_Stream::buildMesh(facets, coordinates, normals, faceset,
+                                      facets.binary ? this->data : NULL,
+                                      stats)) {
+    return FALSE;
+  }
+  this->numfacets = stats.numfacets;
+  this->numvertices = stats.numvertices;
+  this->numnormals = stats.numnormals;
+  this->numsharedvertices = stats.numsharedvertices;
+  this->numsharednormals = stats.numsharednormals;
+  this->numredundantfacets = stats.numredundantfacets;
+  return TRUE;
+}
+
+// Closure for SoSTLFileKit::put_facet_cb().
+struct SoSTLFileKitWriteData {
+  SoSTLFileKit_Writer * writer;
+  SbBool worldspace;
+};
+
 // *************************************************************************
 
 /*!
@@ -260,16 +290,15 @@ SoSTLFileKit::readFile(const char * filename)
 
   this->reset();
 
-  stl_reader * reader = stl_reader_create(filename);
-  if ( !reader ) {
-    SoDebugError::postInfo("SoSTLFileKit::readFile",
-                           "unable to create STL reader for '%s'.",
-                           filename);
+  SoSTLFacets facets;
+  SbString error;
+  if (!SoSTLFileKit_Stream::read(filename, facets, error)) {
+    SoDebugError::post("SoSTLFileKit::readFile",
+                       "error '%s' after %d facets, reading '%s'.",
+                       error.getString(), facets.num, filename);
     return FALSE;
   }
 
-  SbBool binary = (stl_reader_flags(reader) & STL_BINARY) ? TRUE : FALSE;
-
   SoShapeHints * hints =
     SO_GET_ANY_PART(this, "shapehints", SoShapeHints);
   hints->vertexOrdering.setValue(SoShapeHints::UNKNOWN_ORDERING);
@@ -278,84 +307,33 @@ SoSTLFileKit::readFile(const char * filename)
   hints->shapeType.setValue(SoShapeHints::SOLID);
   hints->faceType.setValue(SoShapeHints::UNKNOWN_FACE_TYPE);
 
-  SoNormalBinding * normalbinding =
-    SO_GET_ANY_PART(this, "normalbinding", SoNormalBinding);
-  normalbinding->value = SoNormalBinding::PER_FACE_INDEXED;
-
-  stl_facet * facet = stl_facet_create();
-  SbBool loop = TRUE, success = TRUE;
-  while ( loop ) {
-    const int peekval = stl_reader_peek(reader);
-    if ( peekval == STL_BEGIN ) {
-      // FIXME: implement proper action
-    } else if ( peekval == STL_INIT_INFO ) {
-      // FIXME: set info
-    } else if ( peekval == STL_EXIT_INFO ) {
-      // FIXME: implement proper action
-    } else if ( peekval == STL_END ) {
-      loop = FALSE;
-    } else if ( peekval == STL_FACET ) {
-      stl_real x, y, z;
-      stl_reader_fill_facet(reader, facet);
-      stl_facet_get_normal(facet, &x, &y, &z);
-      SbVec3f normal((float) x, (float) y, (float) z);
-      stl_facet_get_vertex1(facet, &x, &y, &z);
-      SbVec3f vertex1((float) x, (float) y, (float) z);
-      stl_facet_get_vertex2(facet, &x, &y, &z);
-      SbVec3f vertex2((float) x, (float) y, (float) z);
-      stl_facet_get_vertex3(facet, &x, &y, &z);
-      SbVec3f vertex3((float) x, (float) y, (float) z);
-      if ( normal.length() == 0.0f ) { // auto-calculate
-        SbVec3f v1(vertex2-vertex1);
-        SbVec3f v2(vertex3-vertex1);
-        normal = v1.cross(v2);
-        float len = normal.length();
-        if ( len > 0 ) normal /= len;
-      }
-      unsigned int data = stl_facet_get_padding(facet);
-
-      SbBool added = this->addFacet(vertex1, vertex2, vertex3, normal);
-
-#if defined(COIN_EXTRA_DEBUG) || 1
-      if ( added && binary ) {
-        // binary contains padding, which might be colorization
-        // colorization is not implemented yet, so therefore some debug
-        // output comes here so colorized models can be detected.
-        PRIVATE(this)->data->append((uint16_t) data);
-        if ( data != 0 ) {
-          fprintf(stderr, "facet %5d - data: %04x\n", PRIVATE(this)->numfacets - 1, data);
-        }
-      }
-#endif // COIN_EXTRA_DEBUG
-    } else if ( peekval == STL_ERROR ) {
-      SoDebugError::post("SoSTLFileKit::readFile",
-                         "error '%s' after %d facets, line %d.",
-                         stl_reader_get_error(reader),
-                         PRIVATE(this)->numfacets,
-                         stl_reader_get_line_number(reader));
-      loop = FALSE;
-      success = FALSE;
-      if (strcmp(stl_reader_get_error(reader), "premature end of file") == 0) {
-        // this one we will accept though - models with missing
-        // end-indicator have been found...
-        success = TRUE;
-      }
+  if (!PRIVATE(this)->buildModel(facets,
+                                 SO_GET_ANY_PART(this, "coordinates", SoCoordinate3),
+                                 SO_GET_ANY_PART(this, "normals", SoNormal),
+                                 SO_GET_ANY_PART(this, "facets", SoIndexedFaceSet))) {
+    SoDebugError::post("SoSTLFileKit::readFile",
+                       "out of memory building model of %d facets.",
+                       facets.num);
+    this->reset();
+    return FALSE;
+  }
+  this->info.setValue(facets.info);
+
+  // binary files contain padding, which might be colorization.
+  // colorization is not implemented yet, so therefore some debug
+  // output comes here so colorized models can be detected.
+  for (int i = 0; i < PRIVATE(this)->data->getLength(); i++) {
+    if ((*PRIVATE(this)->data)[i] != 0) {
+      SoDebugError::postInfo("SoSTLFileKit::readFile",
+                             "facet %d has attribute data %04x, "
+                             "colorization is not supported.",
+                             i, (*PRIVATE(this)->data)[i]);
+      break;
     }
   }
 
-  // done - no need for the BSP trees to contain data any more
-  PRIVATE(this)->points->clear();
-  PRIVATE(this)->normals->clear();
-
-  stl_facet_destroy(facet);
-  stl_reader_destroy(reader);
-
-  if ( !success ) {
-    this->reset();
-  } else {
-    this->organizeModel();
-  }
-  return success;
+  this->organizeModel();
+  return TRUE;
 }
 
 // doc in inherited class
@@ -377,21 +355,67 @@ SoSTLFileKit::readScene(SoNode * scene)
 {
   this->reset();
 
+  SoSTLFacets facets;
   scene->ref();
   SoCallbackAction cba;
-  cba.addTriangleCallback(SoType::fromName("SoNode"), add_facet_cb, this);
+  cba.addTriangleCallback(SoType::fromName("SoNode"), add_facet_cb, &facets);
   cba.apply(scene);
   scene->unrefNoDelete();
 
-  // no need for the BSP trees to contain data any more
-  PRIVATE(this)->points->clear();
-  PRIVATE(this)->normals->clear();
-
+  if (!PRIVATE(this)->buildModel(facets,
+                                 SO_GET_ANY_PART(this, "coordinates", SoCoordinate3),
+                                 SO_GET_ANY_PART(this, "normals", SoNormal),
+                                 SO_GET_ANY_PART(this, "facets", SoIndexedFaceSet))) {
+    this->reset();
+    return FALSE;
+  }
   this->organizeModel();
 
   return TRUE;
 }
 
+/*!
+  Writes all triangles in \a scene, in world space, directly to the
+  STL file \a filename without building an SoSTLFileKit model first.
+  The \a binary and \a info fields of this kit decide the format and
+  header of the file.
+
+  Returns FALSE if the file could not be written.
+
+  \sa writeFile, readScene
+  \since Coin 4.0
+*/
+
+SbBool
+SoSTLFileKit::writeScene(SoNode * scene, const char * filename)
+{
+  assert(scene); assert(filename);
+
+  SoSTLFileKit_Writer writer;
+  if (!writer.open(filename, this->binary.getValue(), this->info.getValue())) {
+    SoDebugError::post("SoSTLFileKit::writeScene",
+                       "unable to open '%s' for writing.", filename);
+    return FALSE;
+  }
+
+  SoSTLFileKitWriteData data;
+  data.writer = &writer;
+  data.worldspace = TRUE;
+
+  scene->ref();
+  SoCallbackAction cba;
+  cba.addTriangleCallback(SoNode::getClassTypeId(), put_facet_cb, &data);
+  cba.apply(scene);
+  scene->unrefNoDelete();
+
+  if (!writer.close()) {
+    SoDebugError::post("SoSTLFileKit::writeScene",
+                       "error writing '%s'.", filename);
+    return FALSE;
+  }
+  return TRUE;
+}
+
 SoSeparator *
 SoSTLFileKit::convert()
 {
@@ -473,40 +497,23 @@ SoSTLFileKit::canWriteFile(const char * filename) const
 SbBool
 SoSTLFileKit::writeFile(const char * filename)
 {
-  unsigned int flags = 0;
-  if ( this->binary.getValue() ) {
-    flags |= STL_BINARY;
-    // set up flags for colorization if wanted
-  }
-
-  stl_writer * writer = stl_writer_create(filename, flags);
-  if ( !writer ) {
+  SoSTLFileKit_Writer writer;
+  if (!writer.open(filename, this->binary.getValue(), this->info.getValue())) {
     return FALSE;
   }
 
-  stl_facet * facet = stl_facet_create();
-  assert(facet);
-  stl_writer_set_facet(writer, facet);
-
-  SbString infostring = this->info.getValue();
-  if ( infostring.getLength() > 0 ) {
-    if ( stl_writer_set_info(writer, infostring.getString()) != STL_OK ) {
-      SoDebugError::post("SoSTLFileKit::writeFile",
-                         "error: '%s'",
-                         stl_writer_get_error(writer));
-      return FALSE;
-    }
-  }
+  // the model is already in the coordinate system of the file
+  SoSTLFileKitWriteData data;
+  data.writer = &writer;
+  data.worldspace = FALSE;
 
   this->ref();
   SoCallbackAction cba;
-  cba.addTriangleCallback(SoNode::getClassTypeId(), put_facet_cb, writer);
+  cba.addTriangleCallback(SoNode::getClassTypeId(), put_facet_cb, &data);
   cba.apply(this);
   this->unrefNoDelete();
 
-  stl_writer_destroy(writer);
-
-  return TRUE;
+  return writer.close();
 }
 
 // *************************************************************************
@@ -701,8 +708,8 @@ SoSTLFileKit::organizeModel(void)
 }
 
 /*!
-  Helper callback for readScene(), calling addFacet() for each
-  triangle in the provided scene graph.
+  Helper callback for readScene(), collecting each triangle in the
+  provided scene graph.
 
   \sa readScene
 */
@@ -715,8 +722,8 @@ SoSTLFileKit::add_facet_cb(void * closure,
                            const SoPrimitiveVertex * v3)
 {
   assert(closure); assert(v1); assert(v2); assert(v3);
-  SoSTLFileKit * filekit = (SoSTLFileKit *) closure;
-  
+  SoSTLFacets * facets = (SoSTLFacets *) closure;
+
   const SbMatrix & mm = action->getModelMatrix();
 
   // move the points into world space
@@ -736,45 +743,140 @@ SoSTLFileKit::add_facet_cb(void * closure,
   SbVec3f normal(vec1.cross(vec2));
   (void) normal.normalize();
 
-  filekit->addFacet(vertex1, vertex2, vertex3, normal);
+  facets->append(vertex1, vertex2, vertex3, normal);
 }
 
 /*!
-  Helper callback for writeFile(), writing each triangle in the STL
-  model to the STL file.
+  Helper callback for writeFile() and writeScene(), writing each
+  triangle to the STL file.
 
-  \sa writeFile
+  \sa writeFile, writeScene
 */
 
 void
 SoSTLFileKit::put_facet_cb(void * closure,
-                           SoCallbackAction * COIN_UNUSED_ARG(action),
+                           SoCallbackAction * action,
                            const SoPrimitiveVertex * v1,
                            const SoPrimitiveVertex * v2,
                            const SoPrimitiveVertex * v3)
 {
   assert(closure); assert(v1); assert(v2); assert(v3);
-  stl_writer * writer = (stl_writer *) closure;
+  SoSTLFileKitWriteData * data = (SoSTLFileKitWriteData *) closure;
 
   SbVec3f vertex1(v1->getPoint());
   SbVec3f vertex2(v2->getPoint());
   SbVec3f vertex3(v3->getPoint());
 
+  if (data->worldspace) {
+    const SbMatrix & mm = action->getModelMatrix();
+    mm.multVecMatrix(vertex1, vertex1);
+    mm.multVecMatrix(vertex2, vertex2);
+    mm.multVecMatrix(vertex3, vertex3);
+    // flip ordering if the current shape is CW
+    if (action->getVertexOrdering() == SoShapeHints::CLOCKWISE) {
+      SbVec3f tmp = vertex2;
+      vertex2 = vertex3;
+      vertex3 = tmp;
+    }
+  }
+
   SbVec3f vec1(vertex2-vertex1);
   SbVec3f vec2(vertex3-vertex1);
   SbVec3f normal(vec1.cross(vec2));
   (void) normal.normalize();
 
-  stl_facet * facet = stl_writer_get_facet(writer);
-  assert(facet);
-  stl_facet_set_vertex1(facet, vertex1[0], vertex1[1], vertex1[2]);
-  stl_facet_set_vertex2(facet, vertex2[0], vertex2[1], vertex2[2]);
-  stl_facet_set_vertex3(facet, vertex3[0], vertex3[1], vertex3[2]);
-  stl_facet_set_normal(facet, normal[0], normal[1], normal[2]);
-  stl_facet_set_padding(facet, 0);
-
-  stl_writer_put_facet(writer, facet);
+  data->writer->putFacet(vertex1, vertex2, vertex3, normal);
 }
 
 #undef PRIVATE
 #endif // HAVE_NODEKITS
+
+#ifdef COIN_TEST_SUITE
+
+#include <cstdio>
+#include <Inventor/SoFullPath.h>
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/annex/ForeignFiles/SoSTLFileKit.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoNormal.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+static SoNode *
+find_part(SoNode * kit, SoType type)
+{
+  SoSearchAction sa;
+  sa.setType(type);
+  sa.setSearchingAll(TRUE);
+  sa.apply(kit);
+  SoFullPath * path = static_cast<SoFullPath *>(sa.getPath());
+  return path ? path->getTail() : NULL;
+}
+
+BOOST_AUTO_TEST_CASE(writeAndReadScene)
+{
+  static const char filename[] = "SoSTLFileKit_test.stl";
+
+  const SbBool searchingchildren = SoBaseKit::isSearchingChildren();
+  SoBaseKit::setSearchingChildren(TRUE);
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoTranslation * translation = new SoTranslation;
+  translation->translation.setValue(1.0f, 1.0f, 1.0f);
+  root->addChild(translation);
+  root->addChild(new SoCube);
+
+  for (int binary = 0; binary < 2; binary++) {
+    SoSTLFileKit * writer = new SoSTLFileKit;
+    writer->ref();
+    writer->binary = binary ? TRUE : FALSE;
+    writer->info = "cube";
+    BOOST_CHECK(writer->writeScene(root, filename));
+    writer->unref();
+
+    if (binary) {
+      // padding after the facets must be ignored
+      FILE * fp = fopen(filename, "ab");
+      BOOST_REQUIRE(fp != NULL);
+      const char padding[16] = { 0 };
+      BOOST_CHECK_EQUAL(fwrite(padding, 1, sizeof(padding), fp), sizeof(padding));
+      fclose(fp);
+    }
+
+    SoSTLFileKit * reader = new SoSTLFileKit;
+    reader->ref();
+    BOOST_CHECK(SoSTLFileKit::identify(filename));
+    BOOST_REQUIRE(reader->readFile(filename));
+    BOOST_CHECK(reader->info.getValue() == "cube");
+
+    // the 36 corners of the 12 triangles share the 8 cube vertices,
+    // and triangles on the same side share a normal
+    SoCoordinate3 * coordinates =
+      static_cast<SoCoordinate3 *>(find_part(reader, SoCoordinate3::getClassTypeId()));
+    SoNormal * normals =
+      static_cast<SoNormal *>(find_part(reader, SoNormal::getClassTypeId()));
+    SoIndexedFaceSet * facets =
+      static_cast<SoIndexedFaceSet *>(find_part(reader, SoIndexedFaceSet::getClassTypeId()));
+    BOOST_REQUIRE(coordinates && normals && facets);
+    BOOST_CHECK_EQUAL(facets->coordIndex.getNum(), 12 * 4);
+    BOOST_CHECK_EQUAL(facets->normalIndex.getNum(), 12);
+    BOOST_CHECK_EQUAL(coordinates->point.getNum(), 8);
+    BOOST_CHECK_EQUAL(normals->vector.getNum(), 6);
+
+    // the translation is applied to the written vertices
+    for (int i = 0; i < coordinates->point.getNum(); i++) {
+      const SbVec3f & p = coordinates->point[i];
+      BOOST_CHECK(p[0] >= 0.0f && p[1] >= 0.0f && p[2] >= 0.0f);
+    }
+    reader->unref();
+  }
+
+  root->unref();
+  (void) remove(filename);
+  SoBaseKit::setSearchingChildren(searchingchildren);
+}
+
+#endif // COIN_TEST_SUITE
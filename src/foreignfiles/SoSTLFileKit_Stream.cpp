@@ -0,0 +1,988 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+// Streaming STL import and export for SoSTLFileKit.
+//
+// Files are memory mapped (where available) and parsed straight into
+// flat arrays: binary files in parallel, ASCII files with a hand
+// written tokenizer. Vertices and normals are then deduplicated with
+// a hash table over the exact coordinate values. With several
+// threads, the values are first partitioned on the high bits of their
+// hash, so each thread deduplicates its own partitions without
+// locking. The resulting indices are the same as when facets are
+// added one by one: a new index is assigned at the first use.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include "foreignfiles/SoSTLFileKit_Stream.h"
+#include "base/SbParallel.h"
+
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif // HAVE_UNISTD_H
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif // HAVE_SYS_MMAN_H
+
+#include <Inventor/C/tidbits.h>
+#include <Inventor/SbVec3f.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoNormal.h>
+
+// *************************************************************************
+
+// Don't bother starting threads for fewer items than this.
+static const int STLSTREAM_MIN_PARALLEL = 65536;
+static const size_t STLSTREAM_BUFFERSIZE = 1024 * 1024;
+
+// Returns the number of threads to use, which can be overridden with
+// the environment variable COIN_STL_NUM_THREADS.
+static int
+stlstream_num_threads(void)
+{
+  static int num = -1;
+  if (num < 0) num = SbParallel::getNumThreads("COIN_STL_NUM_THREADS");
+  return num;
+}
+
+static int
+stlstream_num_tasks(const int numitems)
+{
+  return (numitems < STLSTREAM_MIN_PARALLEL) ? 1 : stlstream_num_threads();
+}
+
+// *************************************************************************
+
+static inline float
+stlstream_get_float(const unsigned char * ptr)
+{
+  // STL files are little endian
+  const uint32_t bits =
+    uint32_t(ptr[0]) | (uint32_t(ptr[1]) << 8) |
+    (uint32_t(ptr[2]) << 16) | (uint32_t(ptr[3]) << 24);
+  float val;
+  memcpy(&val, &bits, sizeof(float));
+  return val;
+}
+
+static inline unsigned char *
+stlstream_put_float(unsigned char * ptr, const float val)
+{
+  uint32_t bits;
+  memcpy(&bits, &val, sizeof(float));
+  ptr[0] = (unsigned char) (bits & 0xff);
+  ptr[1] = (unsigned char) ((bits >> 8) & 0xff);
+  ptr[2] = (unsigned char) ((bits >> 16) & 0xff);
+  ptr[3] = (unsigned char) ((bits >> 24) & 0xff);
+  return ptr + 4;
+}
+
+// *************************************************************************
+
+// The contents of a file, memory mapped if possible.
+class SoSTLMappedFile {
+public:
+  SoSTLMappedFile(void) : data(NULL), size(0), mapped(FALSE) { }
+  ~SoSTLMappedFile() { this->unmap(); }
+
+  SbBool map(const char * filename);
+  void unmap(void);
+
+  const unsigned char * data;
+  size_t size;
+
+private:
+  SbBool mapped;
+};
+
+SbBool
+SoSTLMappedFile::map(const char * filename)
+{
+#ifdef HAVE_SYS_MMAN_H
+  const int fd = ::open(filename, O_RDONLY);
+  if (fd < 0) return FALSE;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void * ptr = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (ptr != MAP_FAILED) {
+      this->data = (const unsigned char *) ptr;
+      this->size = (size_t) st.st_size;
+      this->mapped = TRUE;
+    }
+  }
+  ::close(fd);
+  if (this->mapped) return TRUE;
+#endif // HAVE_SYS_MMAN_H
+
+  FILE * fp = fopen(filename, "rb");
+  if (fp == NULL) return FALSE;
+  long length = -1;
+  if (fseek(fp, 0, SEEK_END) == 0) length = ftell(fp);
+  unsigned char * buffer = NULL;
+  if (length > 0 && fseek(fp, 0, SEEK_SET) == 0) {
+    buffer = (unsigned char *) malloc((size_t) length);
+    if (buffer && fread(buffer, 1, (size_t) length, fp) != (size_t) length) {
+      free(buffer);
+      buffer = NULL;
+    }
+  }
+  fclose(fp);
+  if (buffer == NULL) return FALSE;
+  this->data = buffer;
+  this->size = (size_t) length;
+  return TRUE;
+}
+
+void
+SoSTLMappedFile::unmap(void)
+{
+  if (this->data == NULL) return;
+#ifdef HAVE_SYS_MMAN_H
+  if (this->mapped) {
+    munmap((void *) this->data, this->size);
+  }
+  else
+#endif // HAVE_SYS_MMAN_H
+  {
+    free((void *) this->data);
+  }
+  this->data = NULL;
+  this->size = 0;
+  this->mapped = FALSE;
+}
+
+// *************************************************************************
+
+SoSTLFacets::SoSTLFacets(void)
+  : positions(NULL), normals(NULL), attributes(NULL),
+    num(0), capacity(0), binary(FALSE)
+{
+}
+
+SoSTLFacets::~SoSTLFacets()
+{
+  this->reset();
+}
+
+void
+SoSTLFacets::reset(void)
+{
+  free(this->positions);
+  free(this->normals);
+  free(this->attributes);
+  this->positions = NULL;
+  this->normals = NULL;
+  this->attributes = NULL;
+  this->num = 0;
+  this->capacity = 0;
+  this->info.makeEmpty();
+  this->binary = FALSE;
+}
+
+// Sets the number of facets, keeping the values of the existing ones.
+SbBool
+SoSTLFacets::resize(const int newnum)
+{
+  if (newnum > this->capacity) {
+    float * p = (float *) realloc(this->positions, size_t(newnum) * 9 * sizeof(float));
+    if (p) this->positions = p;
+    float * n = (float *) realloc(this->normals, size_t(newnum) * 3 * sizeof(float));
+    if (n) this->normals = n;
+    uint16_t * a = (uint16_t *) realloc(this->attributes, size_t(newnum) * sizeof(uint16_t));
+    if (a) this->attributes = a;
+    if (!p || !n || !a) return FALSE;
+    this->capacity = newnum;
+  }
+  this->num = newnum;
+  return TRUE;
+}
+
+void
+SoSTLFacets::append(const SbVec3f & v1, const SbVec3f & v2, const SbVec3f & v3,
+                    const SbVec3f & normal)
+{
+  const int idx = this->num;
+  if (idx == this->capacity) {
+    const int oldnum = this->num;
+    if (!this->resize(this->capacity ? this->capacity * 2 : 1024)) return;
+    this->num = oldnum;
+  }
+  float * p = this->positions + idx * 9;
+  p[0] = v1[0]; p[1] = v1[1]; p[2] = v1[2];
+  p[3] = v2[0]; p[4] = v2[1]; p[5] = v2[2];
+  p[6] = v3[0]; p[7] = v3[1]; p[8] = v3[2];
+  float * n = this->normals + idx * 3;
+  n[0] = normal[0]; n[1] = normal[1]; n[2] = normal[2];
+  this->attributes[idx] = 0;
+  this->num = idx + 1;
+}
+
+// *************************************************************************
+
+struct stlstream_binary_job {
+  const unsigned char * data;
+  SoSTLFacets * facets;
+};
+
+static void
+stlstream_parse_binary(void * closure, int task, int numtasks)
+{
+  stlstream_binary_job * job = (stlstream_binary_job *) closure;
+  SoSTLFacets * facets = job->facets;
+  int begin, end;
+  SbParallel::getRange(facets->num, task, numtasks, begin, end);
+
+  for (int i = begin; i < end; i++) {
+    // normal, three vertices and a 16-bit attribute
+    const unsigned char * ptr = job->data + 84 + size_t(i) * 50;
+    float * n = facets->normals + size_t(i) * 3;
+    float * p = facets->positions + size_t(i) * 9;
+    for (int j = 0; j < 3; j++) n[j] = stlstream_get_float(ptr + j * 4);
+    for (int j = 0; j < 9; j++) p[j] = stlstream_get_float(ptr + 12 + j * 4);
+    facets->attributes[i] = uint16_t(ptr[48] | (ptr[49] << 8));
+  }
+}
+
+// *************************************************************************
+
+struct stlstream_cursor {
+  const char * ptr;
+  const char * end;
+  int line;
+};
+
+static void
+stlstream_skip_space(stlstream_cursor & c)
+{
+  while (c.ptr < c.end && isspace((unsigned char) *c.ptr)) {
+    if (*c.ptr == '\n') c.line++;
+    c.ptr++;
+  }
+}
+
+// Returns the length of the next whitespace separated token, 0 at end
+// of file.
+static int
+stlstream_token(stlstream_cursor & c, const char *& token)
+{
+  stlstream_skip_space(c);
+  token = c.ptr;
+  while (c.ptr < c.end && !isspace((unsigned char) *c.ptr)) c.ptr++;
+  return int(c.ptr - token);
+}
+
+static SbBool
+stlstream_is_keyword(const char * token, const int len, const char * keyword)
+{
+  int i;
+  for (i = 0; i < len; i++) {
+    if (keyword[i] == '\0' ||
+        tolower((unsigned char) token[i]) != keyword[i]) return FALSE;
+  }
+  return keyword[i] == '\0';
+}
+
+// Returns the rest of the current line, without surrounding whitespace.
+static SbString
+stlstream_rest_of_line(stlstream_cursor & c)
+{
+  while (c.ptr < c.end && (*c.ptr == ' ' || *c.ptr == '\t')) c.ptr++;
+  const char * start = c.ptr;
+  while (c.ptr < c.end && *c.ptr != '\n' && *c.ptr != '\r') c.ptr++;
+  const char * last = c.ptr;
+  while (last > start && isspace((unsigned char) last[-1])) last--;
+  return SbString(start, 0, int(last - start) - 1);
+}
+
+static SbBool
+stlstream_parse_float(stlstream_cursor & c, float & val)
+{
+  static const double pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  stlstream_skip_space(c);
+  const char * p = c.ptr;
+  const char * end = c.end;
+
+  SbBool negative = FALSE;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    p++;
+  }
+
+  uint64_t mantissa = 0;
+  int numdigits = 0; // significant digits in mantissa
+  int exponent = 0;
+  SbBool anydigits = FALSE;
+  for (; p < end && isdigit((unsigned char) *p); p++) {
+    anydigits = TRUE;
+    if (numdigits < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      if (mantissa) numdigits++;
+    }
+    else {
+      exponent++;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (p++; p < end && isdigit((unsigned char) *p); p++) {
+      anydigits = TRUE;
+      if (numdigits < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        if (mantissa) numdigits++;
+        exponent--;
+      }
+    }
+  }
+  if (!anydigits) return FALSE;
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char * q = p + 1;
+    SbBool negexp = FALSE;
+    if (q < end && (*q == '-' || *q == '+')) {
+      negexp = (*q == '-');
+      q++;
+    }
+    int e = 0;
+    SbBool anyexpdigits = FALSE;
+    for (; q < end && isdigit((unsigned char) *q); q++) {
+      anyexpdigits = TRUE;
+      if (e < 10000) e = e * 10 + (*q - '0');
+    }
+    if (!anyexpdigits) return FALSE;
+    exponent += negexp ? -e : e;
+    p = q;
+  }
+  if (p < end && !isspace((unsigned char) *p)) return FALSE;
+
+  double d = double(mantissa);
+  if (mantissa != 0 && exponent != 0) {
+    if (exponent > 0 && exponent <= 22) d *= pow10[exponent];
+    else if (exponent < 0 && exponent >= -22) d /= pow10[-exponent];
+    else d *= pow(10.0, exponent);
+  }
+  val = float(negative ? -d : d);
+  c.ptr = p;
+  return TRUE;
+}
+
+static SbBool
+stlstream_parse_ascii(const SoSTLMappedFile & file, SoSTLFacets & facets,
+                      SbString & error)
+{
+  stlstream_cursor c;
+  c.ptr = (const char *) file.data;
+  c.end = c.ptr + file.size;
+  c.line = 1;
+
+  const char * token;
+  int len = stlstream_token(c, token);
+  if (!stlstream_is_keyword(token, len, "solid")) {
+    error = "not an STL file";
+    return FALSE;
+  }
+  facets.info = stlstream_rest_of_line(c);
+
+  // ASCII facets take up at least ~200 bytes
+  const int oldnum = facets.num;
+  if (facets.resize(int(file.size / 256) + 1)) facets.num = oldnum;
+
+  SbVec3f vertices[3];
+  SbVec3f normal(0.0f, 0.0f, 0.0f);
+  int numvertices = 0;
+  while ((len = stlstream_token(c, token)) > 0) {
+    if (stlstream_is_keyword(token, len, "vertex")) {
+      if (numvertices == 3) {
+        error = "vertex data error";
+        return FALSE;
+      }
+      SbVec3f & v = vertices[numvertices++];
+      if (!stlstream_parse_float(c, v[0]) ||
+          !stlstream_parse_float(c, v[1]) ||
+          !stlstream_parse_float(c, v[2])) {
+        error = "invalid vertex";
+        return FALSE;
+      }
+    }
+    else if (stlstream_is_keyword(token, len, "facet")) {
+      len = stlstream_token(c, token);
+      if (!stlstream_is_keyword(token, len, "normal") ||
+          !stlstream_parse_float(c, normal[0]) ||
+          !stlstream_parse_float(c, normal[1]) ||
+          !stlstream_parse_float(c, normal[2])) {
+        error = "invalid facet normal";
+        return FALSE;
+      }
+      numvertices = 0;
+    }
+    else if (stlstream_is_keyword(token, len, "endfacet")) {
+      if (numvertices != 3) {
+        error = "vertex data error";
+        return FALSE;
+      }
+      facets.append(vertices[0], vertices[1], vertices[2], normal);
+    }
+    else if (stlstream_is_keyword(token, len, "outer")) {
+      len = stlstream_token(c, token);
+      if (!stlstream_is_keyword(token, len, "loop")) {
+        error = "expected 'loop'";
+        return FALSE;
+      }
+    }
+    else if (stlstream_is_keyword(token, len, "loop") ||
+             stlstream_is_keyword(token, len, "endloop")) {
+      // nothing to do
+    }
+    else if (stlstream_is_keyword(token, len, "endsolid") ||
+             stlstream_is_keyword(token, len, "end") ||
+             stlstream_is_keyword(token, len, "solid")) {
+      // name of the (next) solid
+      (void) stlstream_rest_of_line(c);
+    }
+    else {
+      error.sprintf("unexpected '%s' at line %d",
+                    SbString(token, 0, len - 1).getString(), c.line);
+      return FALSE;
+    }
+  }
+  // a missing "endsolid" is accepted, models without it have been found
+  return TRUE;
+}
+
+/*!
+  Reads all facets of the binary or ASCII STL file \a filename into
+  \a facets. Returns \c FALSE and sets \a error on failure.
+*/
+SbBool
+SoSTLFileKit_Stream::read(const char * filename, SoSTLFacets & facets,
+                          SbString & error)
+{
+  facets.reset();
+
+  SoSTLMappedFile file;
+  if (!file.map(filename)) {
+    error = "unable to open file";
+    return FALSE;
+  }
+
+  // binary files have an 80 byte header, a 32-bit facet count and 50
+  // bytes per facet. Some writers pad the file, so trailing bytes are
+  // ignored. (The count read from an ASCII file is far too large for
+  // the facets to fit.)
+  if (file.size >= 84) {
+    const uint64_t count =
+      uint64_t(file.data[80]) | (uint64_t(file.data[81]) << 8) |
+      (uint64_t(file.data[82]) << 16) | (uint64_t(file.data[83]) << 24);
+    if (84 + count * 50 <= uint64_t(file.size) && count <= 0x7fffffff / 9) {
+      if (!facets.resize(int(count))) {
+        error = "out of memory";
+        return FALSE;
+      }
+      facets.binary = TRUE;
+      int len = 0;
+      while (len < 80 && file.data[len] != '\0') len++;
+      facets.info = SbString((const char *) file.data, 0, len - 1);
+      while (facets.info.getLength() > 0 &&
+             isspace((unsigned char) facets.info[facets.info.getLength() - 1])) {
+        facets.info = facets.info.getSubString(0, facets.info.getLength() - 2);
+      }
+
+      stlstream_binary_job job;
+      job.data = file.data;
+      job.facets = &facets;
+      SbParallel::run(stlstream_parse_binary, &job, stlstream_num_tasks(facets.num));
+      return TRUE;
+    }
+  }
+
+  return stlstream_parse_ascii(file, facets, error);
+}
+
+// *************************************************************************
+
+// Hash of the exact coordinate values, with -0 and 0 hashing equal
+// since they compare equal.
+static inline uint32_t
+stlstream_float_bits(const float val)
+{
+  if (val == 0.0f) return 0;
+  uint32_t bits;
+  memcpy(&bits, &val, sizeof(float));
+  return bits;
+}
+
+static inline uint32_t
+stlstream_hash(const float * v)
+{
+  uint32_t h = stlstream_float_bits(v[0]) * 0x9e3779b1u;
+  h = (h << 13) | (h >> 19);
+  h ^= stlstream_float_bits(v[1]) * 0x85ebca77u;
+  h = (h << 13) | (h >> 19);
+  h ^= stlstream_float_bits(v[2]) * 0xc2b2ae3du;
+  // MurmurHash3 finalizer
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+// Finds the first occurrence of each of num 3-component values. On
+// return, first[i] is the index of the first value equal to value i.
+struct stlstream_dedup_job {
+  const float * values;
+  int num;
+  uint32_t * hashes;
+  int32_t * first;
+  int32_t * perm;
+  int numparts;
+  int partshift;
+  int * offsets;   // numtasks * numparts
+  int * partstart; // numparts + 1
+};
+
+static void
+stlstream_hash_task(void * closure, int task, int numtasks)
+{
+  stlstream_dedup_job * job = (stlstream_dedup_job *) closure;
+  int begin, end;
+  SbParallel::getRange(job->num, task, numtasks, begin, end);
+  for (int i = begin; i < end; i++) {
+    job->hashes[i] = stlstream_hash(job->values + size_t(i) * 3);
+  }
+}
+
+static void
+stlstream_count_task(void * closure, int task, int numtasks)
+{
+  stlstream_dedup_job * job = (stlstream_dedup_job *) closure;
+  int * counts = job->offsets + task * job->numparts;
+  int begin, end;
+  SbParallel::getRange(job->num, task, numtasks, begin, end);
+  for (int i = begin; i < end; i++) {
+    counts[job->hashes[i] >> job->partshift]++;
+  }
+}
+
+static void
+stlstream_scatter_task(void * closure, int task, int numtasks)
+{
+  stlstream_dedup_job * job = (stlstream_dedup_job *) closure;
+  int * offsets = job->offsets + task * job->numparts;
+  int begin, end;
+  SbParallel::getRange(job->num, task, numtasks, begin, end);
+  for (int i = begin; i < end; i++) {
+    job->perm[offsets[job->hashes[i] >> job->partshift]++] = i;
+  }
+}
+
+// Deduplicates the values indices[0..count-1] (or 0..count-1 if
+// indices is NULL), which must be in increasing order, with a linear
+// probing table of value indices.
+static void
+stlstream_dedup_range(stlstream_dedup_job * job, const int32_t * indices,
+                      const int count)
+{
+  unsigned int size = 16;
+  while (size < unsigned(count / 2)) size <<= 1;
+  int32_t * table = (int32_t *) malloc(size * sizeof(int32_t));
+  memset(table, 0xff, size * sizeof(int32_t));
+  unsigned int mask = size - 1;
+  unsigned int numunique = 0;
+
+  for (int i = 0; i < count; i++) {
+    const int32_t idx = indices ? indices[i] : i;
+    const uint32_t h = job->hashes[idx];
+    const float * v = job->values + size_t(idx) * 3;
+    unsigned int slot = h & mask;
+    for (;;) {
+      const int32_t e = table[slot];
+      if (e < 0) {
+        table[slot] = idx;
+        job->first[idx] = idx;
+        numunique++;
+        break;
+      }
+      if (job->hashes[e] == h) {
+        const float * w = job->values + size_t(e) * 3;
+        if (v[0] == w[0] && v[1] == w[1] && v[2] == w[2]) {
+          job->first[idx] = e;
+          break;
+        }
+      }
+      slot = (slot + 1) & mask;
+    }
+
+    // keep the table at most half full
+    if (numunique * 2 > size) {
+      const unsigned int newsize = size * 2;
+      int32_t * newtable = (int32_t *) malloc(newsize * sizeof(int32_t));
+      memset(newtable, 0xff, newsize * sizeof(int32_t));
+      const unsigned int newmask = newsize - 1;
+      for (unsigned int j = 0; j < size; j++) {
+        const int32_t e = table[j];
+        if (e < 0) continue;
+        unsigned int s = job->hashes[e] & newmask;
+        while (newtable[s] >= 0) s = (s + 1) & newmask;
+        newtable[s] = e;
+      }
+      free(table);
+      table = newtable;
+      size = newsize;
+      mask = newmask;
+    }
+  }
+  free(table);
+}
+
+static void
+stlstream_dedup_task(void * closure, int task, int numtasks)
+{
+  stlstream_dedup_job * job = (stlstream_dedup_job *) closure;
+  for (int part = task; part < job->numparts; part += numtasks) {
+    const int start = job->partstart[part];
+    stlstream_dedup_range(job, job->perm + start, job->partstart[part + 1] - start);
+  }
+}
+
+static void
+stlstream_dedup(const float * values, const int num, int32_t * first)
+{
+  stlstream_dedup_job job;
+  job.values = values;
+  job.num = num;
+  job.first = first;
+  job.hashes = (uint32_t *) malloc(size_t(num > 0 ? num : 1) * sizeof(uint32_t));
+
+  const int numtasks = stlstream_num_tasks(num);
+  SbParallel::run(stlstream_hash_task, &job, numtasks);
+
+  if (numtasks == 1) {
+    stlstream_dedup_range(&job, NULL, num);
+    free(job.hashes);
+    return;
+  }
+
+  // partition on the high bits of the hash, stable within each
+  // partition so the first occurrence is found first
+  int bits = 0;
+  while ((1 << bits) < numtasks * 8) bits++;
+  job.numparts = 1 << bits;
+  job.partshift = 32 - bits;
+  job.offsets = (int *) calloc(size_t(numtasks) * job.numparts, sizeof(int));
+  job.partstart = (int *) malloc((job.numparts + 1) * sizeof(int));
+  job.perm = (int32_t *) malloc(size_t(num) * sizeof(int32_t));
+
+  SbParallel::run(stlstream_count_task, &job, numtasks);
+  int offset = 0;
+  for (int part = 0; part < job.numparts; part++) {
+    job.partstart[part] = offset;
+    for (int task = 0; task < numtasks; task++) {
+      int & count = job.offsets[task * job.numparts + part];
+      const int tmp = count;
+      count = offset;
+      offset += tmp;
+    }
+  }
+  job.partstart[job.numparts] = offset;
+  assert(offset == num);
+
+  SbParallel::run(stlstream_scatter_task, &job, numtasks);
+  SbParallel::run(stlstream_dedup_task, &job, numtasks);
+
+  free(job.perm);
+  free(job.partstart);
+  free(job.offsets);
+  free(job.hashes);
+}
+
+// Calculates the normals of facets which have a zero length normal.
+static void
+stlstream_normals_task(void * closure, int task, int numtasks)
+{
+  SoSTLFacets * facets = (SoSTLFacets *) closure;
+  int begin, end;
+  SbParallel::getRange(facets->num, task, numtasks, begin, end);
+  for (int i = begin; i < end; i++) {
+    float * n = facets->normals + size_t(i) * 3;
+    if (n[0] != 0.0f || n[1] != 0.0f || n[2] != 0.0f) continue;
+    const float * p = facets->positions + size_t(i) * 9;
+    const SbVec3f v1(p[0], p[1], p[2]);
+    SbVec3f normal = (SbVec3f(p[3], p[4], p[5]) - v1).cross(SbVec3f(p[6], p[7], p[8]) - v1);
+    const float len = normal.length();
+    if (len > 0.0f) normal /= len;
+    n[0] = normal[0]; n[1] = normal[1]; n[2] = normal[2];
+  }
+}
+
+/*!
+  Builds an indexed mesh from \a facets, sharing equal vertices and
+  normals, and dropping facets where two vertices are equal. The
+  attribute value of each kept facet is appended to \a attributes,
+  if not \c NULL.
+*/
+SbBool
+SoSTLFileKit_Stream::buildMesh(SoSTLFacets & facets,
+                               SoCoordinate3 * coordinates,
+                               SoNormal * normals,
+                               SoIndexedFaceSet * faceset,
+                               SbList<uint16_t> * attributes,
+                               SoSTLMeshStats & stats)
+{
+  const int numfacets = facets.num;
+  const int numpositions = numfacets * 3;
+
+  memset(&stats, 0, sizeof(SoSTLMeshStats));
+
+  SbParallel::run(stlstream_normals_task, &facets, stlstream_num_tasks(numfacets));
+
+  int32_t * firstvertex = (int32_t *) malloc(size_t(numpositions + 1) * sizeof(int32_t));
+  int32_t * firstnormal = (int32_t *) malloc(size_t(numfacets + 1) * sizeof(int32_t));
+  if (!firstvertex || !firstnormal) {
+    free(firstvertex);
+    free(firstnormal);
+    return FALSE;
+  }
+  stlstream_dedup(facets.positions, numpositions, firstvertex);
+  stlstream_dedup(facets.normals, numfacets, firstnormal);
+
+  // Number vertices and normals in the order of first use by a kept
+  // facet. The index of the first occurrence of a value is mapped to
+  // its final index, in place, since later entries only refer back
+  // to first occurrences.
+  faceset->coordIndex.setNum(numfacets * 4);
+  faceset->normalIndex.setNum(numfacets);
+  int32_t * coordindex = faceset->coordIndex.startEditing();
+  int32_t * normalindex = faceset->normalIndex.startEditing();
+
+  int32_t * vertexid = (int32_t *) malloc(size_t(numpositions + 1) * sizeof(int32_t));
+  int32_t * normalid = (int32_t *) malloc(size_t(numfacets + 1) * sizeof(int32_t));
+  memset(vertexid, 0xff, size_t(numpositions) * sizeof(int32_t));
+  memset(normalid, 0xff, size_t(numfacets) * sizeof(int32_t));
+
+  if (attributes) attributes->truncate(0);
+
+  int kept = 0;
+  for (int i = 0; i < numfacets; i++) {
+    const int32_t a = firstvertex[i * 3];
+    const int32_t b = firstvertex[i * 3 + 1];
+    const int32_t c = firstvertex[i * 3 + 2];
+    if (a == b || a == c || b == c) {
+      stats.numredundantfacets++;
+      continue;
+    }
+    const int32_t v[3] = { a, b, c };
+    for (int j = 0; j < 3; j++) {
+      if (vertexid[v[j]] < 0) vertexid[v[j]] = stats.numvertices++;
+      else stats.numsharedvertices++;
+      coordindex[kept * 4 + j] = vertexid[v[j]];
+    }
+    coordindex[kept * 4 + 3] = -1;
+
+    const int32_t n = firstnormal[i];
+    if (normalid[n] < 0) normalid[n] = stats.numnormals++;
+    else stats.numsharednormals++;
+    normalindex[kept] = normalid[n];
+
+    if (attributes) attributes->append(facets.attributes[i]);
+    kept++;
+  }
+  faceset->coordIndex.finishEditing();
+  faceset->normalIndex.finishEditing();
+  faceset->coordIndex.setNum(kept * 4);
+  faceset->normalIndex.setNum(kept);
+  stats.numfacets = kept;
+
+  coordinates->point.setNum(stats.numvertices);
+  SbVec3f * points = coordinates->point.startEditing();
+  for (int i = 0; i < numpositions; i++) {
+    if (vertexid[i] >= 0) {
+      const float * p = facets.positions + size_t(i) * 3;
+      points[vertexid[i]].setValue(p[0], p[1], p[2]);
+    }
+  }
+  coordinates->point.finishEditing();
+
+  normals->vector.setNum(stats.numnormals);
+  SbVec3f * vectors = normals->vector.startEditing();
+  for (int i = 0; i < numfacets; i++) {
+    if (normalid[i] >= 0) {
+      const float * n = facets.normals + size_t(i) * 3;
+      vectors[normalid[i]].setValue(n[0], n[1], n[2]);
+    }
+  }
+  normals->vector.finishEditing();
+
+  free(vertexid);
+  free(normalid);
+  free(firstvertex);
+  free(firstnormal);
+  return TRUE;
+}
+
+// *************************************************************************
+
+SoSTLFileKit_Writer::SoSTLFileKit_Writer(void)
+  : fp(NULL), binary(FALSE), ok(FALSE), numfacets(0), buffer(NULL), used(0)
+{
+}
+
+SoSTLFileKit_Writer::~SoSTLFileKit_Writer()
+{
+  if (this->fp) (void) this->close();
+}
+
+/*!
+  Opens \a filename and writes the file header.
+*/
+SbBool
+SoSTLFileKit_Writer::open(const char * filename, SbBool binaryarg,
+                          const SbString & info)
+{
+  assert(this->fp == NULL);
+  this->fp = fopen(filename, binaryarg ? "wb" : "w");
+  if (this->fp == NULL) return FALSE;
+
+  this->binary = binaryarg;
+  this->ok = TRUE;
+  this->numfacets = 0;
+  this->buffer = (char *) malloc(STLSTREAM_BUFFERSIZE);
+  this->used = 0;
+
+  if (this->binary) {
+    // the facet count is written by close()
+    memset(this->buffer, 0, 84);
+    if (info.getLength() < 80) memcpy(this->buffer, info.getString(), info.getLength());
+    this->used = 84;
+  }
+  else if (info.getLength() > 0) {
+    this->used = coin_snprintf(this->buffer, 1024, "solid %s\n",
+                               info.getSubString(0, 1000).getString());
+  }
+  else {
+    this->used = coin_snprintf(this->buffer, 1024, "solid\n");
+  }
+  return TRUE;
+}
+
+void
+SoSTLFileKit_Writer::flush(void)
+{
+  if (this->used > 0 &&
+      fwrite(this->buffer, 1, this->used, this->fp) != this->used) {
+    this->ok = FALSE;
+  }
+  this->used = 0;
+}
+
+void
+SoSTLFileKit_Writer::putFacet(const SbVec3f & v1, const SbVec3f & v2,
+                              const SbVec3f & v3, const SbVec3f & normal)
+{
+  if (this->binary) {
+    if (this->used + 50 > STLSTREAM_BUFFERSIZE) this->flush();
+    unsigned char * ptr = (unsigned char *) this->buffer + this->used;
+    ptr = stlstream_put_float(ptr, normal[0]);
+    ptr = stlstream_put_float(ptr, normal[1]);
+    ptr = stlstream_put_float(ptr, normal[2]);
+    for (int i = 0; i < 3; i++) ptr = stlstream_put_float(ptr, v1[i]);
+    for (int i = 0; i < 3; i++) ptr = stlstream_put_float(ptr, v2[i]);
+    for (int i = 0; i < 3; i++) ptr = stlstream_put_float(ptr, v3[i]);
+    ptr[0] = ptr[1] = 0; // attribute
+    this->used += 50;
+  }
+  else {
+    // a facet is at most ~400 characters with %g
+    if (this->used + 512 > STLSTREAM_BUFFERSIZE) this->flush();
+    this->used +=
+      coin_snprintf(this->buffer + this->used, 512,
+                    "  facet normal %g %g %g\n"
+                    "    outer loop\n"
+                    "      vertex %g %g %g\n"
+                    "      vertex %g %g %g\n"
+                    "      vertex %g %g %g\n"
+                    "    endloop\n"
+                    "  endfacet\n",
+                    normal[0], normal[1], normal[2],
+                    v1[0], v1[1], v1[2],
+                    v2[0], v2[1], v2[2],
+                    v3[0], v3[1], v3[2]);
+  }
+  this->numfacets++;
+}
+
+/*!
+  Finishes and closes the file. Returns \c FALSE if anything could
+  not be written.
+*/
+SbBool
+SoSTLFileKit_Writer::close(void)
+{
+  assert(this->fp);
+  if (!this->binary) {
+    if (this->used + 16 > STLSTREAM_BUFFERSIZE) this->flush();
+    this->used += coin_snprintf(this->buffer + this->used, 16, "endsolid\n");
+  }
+  this->flush();
+
+  if (this->binary) {
+    unsigned char count[4];
+    count[0] = (unsigned char) (this->numfacets & 0xff);
+    count[1] = (unsigned char) ((this->numfacets >> 8) & 0xff);
+    count[2] = (unsigned char) ((this->numfacets >> 16) & 0xff);
+    count[3] = (unsigned char) ((this->numfacets >> 24) & 0xff);
+    if (fseek(this->fp, 80, SEEK_SET) != 0 ||
+        fwrite(count, 4, 1, this->fp) != 1) {
+      this->ok = FALSE;
+    }
+  }
+  if (fclose(this->fp) != 0) this->ok = FALSE;
+  this->fp = NULL;
+  free(this->buffer);
+  this->buffer = NULL;
+  return this->ok;
+}
@@ -0,0 +1,127 @@
+#ifndef COIN_SOSTLFILEKIT_STREAM_H
+#define COIN_SOSTLFILEKIT_STREAM_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+// *************************************************************************
+
+#include <cstdio>
+
+#include <Inventor/SbString.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/system/inttypes.h>
+
+class SbVec3f;
+class SoCoordinate3;
+class SoIndexedFaceSet;
+class SoNormal;
+
+// *************************************************************************
+
+// A triangle soup, as read from an STL file or collected from a scene
+// graph, with the values of each facet stored contiguously.
+class SoSTLFacets {
+public:
+  SoSTLFacets(void);
+  ~SoSTLFacets();
+
+  void reset(void);
+  SbBool resize(const int num);
+  void append(const SbVec3f & v1, const SbVec3f & v2, const SbVec3f & v3,
+              const SbVec3f & normal);
+
+  float * positions;     // 9 per facet
+  float * normals;       // 3 per facet
+  uint16_t * attributes; // 1 per facet, from binary files
+  int num;
+  int capacity;
+
+  SbString info;
+  SbBool binary;
+};
+
+// Statistics from SoSTLFileKit_Stream::buildMesh().
+struct SoSTLMeshStats {
+  int numfacets;
+  int numvertices;
+  int numnormals;
+  int numsharedvertices;
+  int numsharednormals;
+  int numredundantfacets;
+};
+
+class SoSTLFileKit_Stream {
+public:
+  static SbBool read(const char * filename, SoSTLFacets & facets,
+                     SbString & error);
+
+  static SbBool buildMesh(SoSTLFacets & facets,
+                          SoCoordinate3 * coordinates,
+                          SoNormal * normals,
+                          SoIndexedFaceSet * faceset,
+                          SbList<uint16_t> * attributes,
+                          SoSTLMeshStats & stats);
+};
+
+// Writes STL facets through a buffer. For binary files, the number of
+// facets in the header is filled in by close().
+class SoSTLFileKit_Writer {
+public:
+  SoSTLFileKit_Writer(void);
+  ~SoSTLFileKit_Writer();
+
+  SbBool open(const char * filename, SbBool binary, const SbString & info);
+  void putFacet(const SbVec3f & v1, const SbVec3f & v2, const SbVec3f & v3,
+                const SbVec3f & normal);
+  SbBool close(void);
+
+  uint32_t getNumFacets(void) const { return this->numfacets; }
+
+private:
+  void flush(void);
+
+  FILE * fp;
+  SbBool binary;
+  SbBool ok;
+  uint32_t numfacets;
+  char * buffer;
+  size_t used;
+};
+
+// *************************************************************************
+
+#endif // !COIN_SOSTLFILEKIT_STREAM_H
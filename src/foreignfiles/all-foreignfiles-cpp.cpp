@@ -38,6 +38,7 @@
 
 #include "SoForeignFileKit.cpp"
 #include "SoSTLFileKit.cpp"
+#include "SoSTLFileKit_Stream.cpp"
 #include "steel-wrapper.cpp"
 
 #endif // HAVE_NODEKITS
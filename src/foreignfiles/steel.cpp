@@ -2697,6 +2697,7 @@ stl_reader_create(const char * filename)
   stl_reader * reader;
   int id;
   long length;
+  unsigned long count;
   unsigned char bytes[4];
   assert(filename != NULL);
   reader = (stl_reader *) malloc(sizeof(stl_reader));
@@ -2732,11 +2733,13 @@ stl_reader_create(const char * filename)
     length = ftell(reader->file);
     readok &= !fseek(reader->file, 80, SEEK_SET);
     readok &= fread(bytes, 4, 1, reader->file);
-    reader->facets_total =
-      (bytes[3] << 24) | (bytes[2] << 16) | (bytes[1] << 8) | bytes[0];
-    if ( (84 + (reader->facets_total * 50)) != length ) {
+    count = ((unsigned long) bytes[3] << 24) |
+      (bytes[2] << 16) | (bytes[1] << 8) | bytes[0];
+    /* trailing bytes after the facets are ignored */
+    if ( !readok || (length < 84) || (count > (unsigned long) (length - 84) / 50) ) {
       break; /* not a binary stl file */
     }
+    reader->facets_total = (int) count;
     reader->flags |= STL_BINARY;
     readok &= !fseek(reader->file, 0, SEEK_SET);
     reader->info = static_cast<char *>(malloc(81));
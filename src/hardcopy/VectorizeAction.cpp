@@ -344,10 +344,11 @@ SoVectorizeAction::beginViewport(const SbVec2f & start, const SbVec2f & size,
 void
 SoVectorizeAction::endViewport(void)
 {
-  if (PRIVATE(this)->itemlist.getLength()) {
-    PRIVATE(this)->outputItems();
-    PRIVATE(this)->reset();
-  }
+  // items may already have been printed or moved to disk during
+  // traversal, so there can be annotations or sorted runs left even
+  // when the item list is empty
+  PRIVATE(this)->outputItems();
+  PRIVATE(this)->reset();
 }
 
 /*!
@@ -711,20 +712,46 @@ SoVectorizeAction::getLineJoinsStyle(void) const
 }
 
 /*!
-  Not implemented yet. Provided for TGS OIV compatibility.
+  Sets how hidden lines and surfaces are handled. The default is
+  HLHSR_PAINTER.
+
+  NO_HLHSR prints the geometry in traversal order. The geometry of
+  each shape is written to the output as soon as the shape has been
+  traversed, so very large scenes can be exported using little
+  memory.
+
+  HLHSR_SIMPLE_PAINTER and HLHSR_PAINTER sort the geometry on depth,
+  and print it back to front. When there is much geometry, sorted
+  chunks of it are written to temporary files, and merged when
+  printed. The environment variable COIN_VECTORIZE_SORT_CHUNK_SIZE
+  sets the number of items in each chunk (262144 by default).
+
+  HLHSR_PAINTER_SURFACE_REMOVAL also removes triangles that are
+  completely hidden behind another single triangle, and the hidden
+  parts of lines and points.
+
+  HIDDEN_LINES_REMOVAL prints the edges of filled polygons as lines,
+  and removes the parts of all lines and points that are hidden by
+  the polygons. The polygons themselves are not printed. This is
+  useful for technical drawings.
+
+  \since Coin 4.0
 */
 void
-SoVectorizeAction::setHLHSRMode(HLHSRMode COIN_UNUSED_ARG(mode))
+SoVectorizeAction::setHLHSRMode(HLHSRMode mode)
 {
+  PRIVATE(this)->hlhsrmode = mode;
 }
 
 /*!
-  Not implemented yet. Provided for TGS OIV compatibility.
+  Returns how hidden lines and surfaces are handled.
+
+  \sa setHLHSRMode()
 */
 SoVectorizeAction::HLHSRMode
 SoVectorizeAction::getHLHSRMode(void) const
 {
-  return HLHSR_PAINTER;
+  return PRIVATE(this)->hlhsrmode;
 }
 
 /*!
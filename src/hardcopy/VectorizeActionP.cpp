@@ -35,6 +35,7 @@
 //
 
 #include "VectorizeActionP.h"
+#include "VectorizeHiddenLines.h"
 #include "coindefs.h"
 #include <Inventor/elements/SoViewingMatrixElement.h>
 #include <Inventor/elements/SoProjectionMatrixElement.h>
@@ -64,8 +65,10 @@
 #include <Inventor/caches/SoBoundingBoxCache.h>
 #include <Inventor/elements/SoClipPlaneElement.h>
 #include <Inventor/SbClip.h>
+#include <Inventor/C/tidbits.h>
 
 #include <cstdlib>
+#include <climits>
 
 #define PUBLIC(obj) ((obj)->publ)
 
@@ -127,7 +130,13 @@ SoVectorizeActionP::SoVectorizeActionP(SoVectorizeAction * p)
   this->nominalwidth = 0.35f;
   this->pixelimagesize = 0.35f;
   this->pointstyle = SoVectorizeAction::CIRCLE;
+  this->hlhsrmode = SoVectorizeAction::HLHSR_PAINTER;
   this->annotationidx = 0;
+
+  // the number of items to sort in memory before moving them to disk
+  this->sortchunksize = 262144;
+  const char * env = coin_getenv("COIN_VECTORIZE_SORT_CHUNK_SIZE");
+  if (env && atoi(env) > 0) this->sortchunksize = atoi(env);
 }
 
 //
@@ -161,6 +170,7 @@ SoVectorizeActionP::reset(void)
     delete this->annotationlist[i];
   }
   this->annotationlist.truncate(0);
+  this->sortruns.clear();
   this->bsp.clear();
 }
 
@@ -189,10 +199,12 @@ SoVectorizeActionP::add_point(vertexdata * vd, SoState * state)
   
   SbVec3f v;
   this->shapeprojmatrix.multVecMatrix(vd->point, v);
+  const float z = v[2];
   v[2] = 0.0f;
 
   SbVec3f wv;
   SoVectorizePoint * point = new SoVectorizePoint;
+  point->z = z;
 
   SbColor4f c;
   c.setPackedValue(vd->diffuse);
@@ -239,14 +251,15 @@ SoVectorizeActionP::add_line(vertexdata * vd0, vertexdata * vd1, SoState * state
     }
   }
 
+  SbVec3f wv[2];
+  SoVectorizeLine * line = new SoVectorizeLine;
+
   for (i = 0; i < 2; i++) {
     this->shapeprojmatrix.multVecMatrix(vd[i]->point, v[i]);
+    line->z[i] = v[i][2];
     v[i][2] = 0.0f;
   }
 
-  SbVec3f wv[2];
-  SoVectorizeLine * line = new SoVectorizeLine;
-
   float accdist = 0.0f;
   SbColor4f c;
 
@@ -326,39 +339,8 @@ SoVectorizeActionP::triangle_cb(void * userdata,
 
   SoState * state = action->getState();
 
-  // need to do some extra work when in line mode, since we don't want
-  // to tessellate a polygon into triangles, but draw the polygon as
-  // one line loop.
   if (thisp->drawstyle == SoDrawStyleElement::LINES) {
-    const SoDetail * detail = v1->getDetail();
-    // it's not required to have a detail instance per vertex, so
-    // check if we actually have one before testing the type
-    if (detail && (detail->getTypeId() == SoFaceDetail::getClassTypeId())) {
-      
-      const SoFaceDetail * face = (const SoFaceDetail*) detail;
-      int idx = face->getFaceIndex();
-      if (idx != thisp->prevfaceindex) { // a new face has arrived
-        thisp->prevfaceindex = idx;
-        int numv = face->getNumPoints();
-        if (numv) {
-          vertexdata * v0 = thisp->create_vertexdata(face->getPoint(0), state);
-          vertexdata * prev = v0;
-          for (i = 1; i < numv; i++) {
-            vertexdata * v = thisp->create_vertexdata(face->getPoint(i), state);
-            thisp->add_line(prev, v, state);
-            prev = v;
-          }
-          thisp->add_line(prev, v0, state);
-        }
-      }
-    }
-    else {
-      // fall back to just sending the three triangle edges
-      line_segment_cb(userdata, action, v1, v2);
-      line_segment_cb(userdata, action, v2, v3);
-      line_segment_cb(userdata, action, v3, v1);
-      thisp->prevfaceindex = -1;
-    }
+    thisp->add_outline(action, v1, v2, v3);
     return;
   }
   if (thisp->drawstyle == SoDrawStyleElement::POINTS) {
@@ -368,11 +350,19 @@ SoVectorizeActionP::triangle_cb(void * userdata,
     return;
   }
 
+  // with hidden line removal, the edges of filled polygons are drawn
+  // as lines, and the triangles are only used to hide other lines
+  if (thisp->hlhsrmode == SoVectorizeAction::HIDDEN_LINES_REMOVAL) {
+    thisp->add_outline(action, v1, v2, v3);
+    thisp->curr_vertexdata_index = 0;
+  }
+
   // FIXME: use growable arrays. This assumes a maximum of 8 clipping
   // planes (which is usually the maximum number in OpenGL...)
   vertexdata * vd[9+8];
   SbVec3f v[9+8];
   SbVec3f wv[9+8];
+  float z[9+8];
   vd[0] = thisp->create_vertexdata(v1, state);
   vd[1] = thisp->create_vertexdata(v2, state);
   vd[2] = thisp->create_vertexdata(v3, state);
@@ -404,6 +394,7 @@ SoVectorizeActionP::triangle_cb(void * userdata,
     c.setPackedValue(vd[i]->diffuse);
     thisp->shapetoworldmatrix.multVecMatrix(vd[i]->point, wv[i]);
     thisp->shapeprojmatrix.multVecMatrix(vd[i]->point, v[i]);
+    z[i] = v[i][2];
     v[i][2] = 0.0f;
 
     if (thisp->phong) {
@@ -432,11 +423,13 @@ SoVectorizeActionP::triangle_cb(void * userdata,
     float accdist = 0.0f;
     tri->vidx[0] = thisp->bsp.addPoint(v[0]);
     tri->col[0] = vd[0]->diffuse;
+    tri->z[0] = z[0];
     accdist += thisp->cameraplane.getDistance(wv[0]);
     
     for (int j = 1; j < 3; j++) {
       tri->vidx[j] = thisp->bsp.addPoint(v[i+j]);
       tri->col[j] = vd[i+j]->diffuse;
+      tri->z[j] = z[i+j];
       accdist += thisp->cameraplane.getDistance(wv[i+j]);
     }
     tri->depth = accdist / 3.0f;
@@ -444,6 +437,49 @@ SoVectorizeActionP::triangle_cb(void * userdata,
   }
 }
 
+//
+// Adds the outline of the polygon that the triangle is part of as
+// lines. We don't want to tessellate a polygon into triangles when
+// drawing lines, but draw the polygon as one line loop.
+//
+void
+SoVectorizeActionP::add_outline(SoCallbackAction * action,
+                                const SoPrimitiveVertex * v1,
+                                const SoPrimitiveVertex * v2,
+                                const SoPrimitiveVertex * v3)
+{
+  SoState * state = action->getState();
+  const SoDetail * detail = v1->getDetail();
+  // it's not required to have a detail instance per vertex, so
+  // check if we actually have one before testing the type
+  if (detail && (detail->getTypeId() == SoFaceDetail::getClassTypeId())) {
+
+    const SoFaceDetail * face = (const SoFaceDetail*) detail;
+    int idx = face->getFaceIndex();
+    if (idx != this->prevfaceindex) { // a new face has arrived
+      this->prevfaceindex = idx;
+      int numv = face->getNumPoints();
+      if (numv) {
+        vertexdata * v0 = this->create_vertexdata(face->getPoint(0), state);
+        vertexdata * prev = v0;
+        for (int i = 1; i < numv; i++) {
+          vertexdata * v = this->create_vertexdata(face->getPoint(i), state);
+          this->add_line(prev, v, state);
+          prev = v;
+        }
+        this->add_line(prev, v0, state);
+      }
+    }
+  }
+  else {
+    // fall back to just sending the three triangle edges
+    line_segment_cb(this, action, v1, v2);
+    line_segment_cb(this, action, v2, v3);
+    line_segment_cb(this, action, v3, v1);
+    this->prevfaceindex = -1;
+  }
+}
+
 //
 // callback for the SoImage node.
 //
@@ -724,16 +760,19 @@ SoVectorizeActionP::pre_shape_cb(void * userdata,
 }
 
 //
-// Callback which is called after a shape has been traversed.  We just
-// use it to pop the state (we push in the pre callback).
+// Callback which is called after a shape has been traversed. We use
+// it to pop the state (we push in the pre callback), and to flush the
+// items of the shape when possible.
 //
 SoCallbackAction::Response
-SoVectorizeActionP::post_shape_cb(void * COIN_UNUSED_ARG(userdata),
+SoVectorizeActionP::post_shape_cb(void * userdata,
                                   SoCallbackAction * action,
                                   const SoNode * COIN_UNUSED_ARG(node))
 {
+  SoVectorizeActionP * thisp = (SoVectorizeActionP*) userdata;
   SoState * state = action->getState();
   state->pop();
+  thisp->flushItems();
   return SoCallbackAction::CONTINUE;
 }
 
@@ -782,21 +821,232 @@ qsort_compare(const void * q0, const void * q1)
 }
 
 //
-// Will sort and output items (painter's algorithm). FIXME: implement
-// a better algorithm for hidden surface handling.
+// Callback for qsort(). Will sort lines on their end points.
 //
+static int
+qsort_compare_line(const void * q0, const void * q1)
+{
+  const SoVectorizeLine * l0 = *((SoVectorizeLine**) q0);
+  const SoVectorizeLine * l1 = *((SoVectorizeLine**) q1);
+
+  const int a0 = SbMin(l0->vidx[0], l0->vidx[1]);
+  const int a1 = SbMin(l1->vidx[0], l1->vidx[1]);
+  if (a0 != a1) return (a0 < a1) ? -1 : 1;
+  const int b0 = SbMax(l0->vidx[0], l0->vidx[1]);
+  const int b1 = SbMax(l1->vidx[0], l1->vidx[1]);
+  if (b0 != b1) return (b0 < b1) ? -1 : 1;
+  return 0;
+}
 
 extern "C" {
 typedef int qsort_cmp(const void *, const void *);
 }
 
+// returns TRUE if the two lines will look the same
+static SbBool
+same_line(const SoVectorizeLine * l0, const SoVectorizeLine * l1)
+{
+  if (l0->width != l1->width || l0->pattern != l1->pattern) return FALSE;
+  if (l0->vidx[0] == l1->vidx[0]) {
+    return l0->col[0] == l1->col[0] && l0->col[1] == l1->col[1];
+  }
+  return l0->col[0] == l1->col[1] && l0->col[1] == l1->col[0];
+}
+
+//
+// Removes lines that are drawn more than once, like the edges that
+// are shared by two polygons.
+//
+void
+SoVectorizeActionP::remove_duplicate_lines(void)
+{
+  int i, j, n = this->itemlist.getLength();
+  SbList <SoVectorizeLine*> lines;
+  for (i = 0; i < n; i++) {
+    if (this->itemlist[i]->type == SoVectorizeItem::LINE) {
+      lines.append((SoVectorizeLine*) this->itemlist[i]);
+    }
+  }
+  const int numlines = lines.getLength();
+  if (numlines < 2) return;
+
+  SoVectorizeLine ** ptr = (SoVectorizeLine**) lines.getArrayPtr();
+  qsort(ptr, numlines, sizeof(void*), (qsort_cmp *) qsort_compare_line);
+
+  // duplicates are marked by setting the type to UNDEFINED
+  int runstart = 0;
+  for (i = 1; i < numlines; i++) {
+    if (qsort_compare_line(&ptr[runstart], &ptr[i]) != 0) {
+      runstart = i;
+      continue;
+    }
+    for (j = runstart; j < i; j++) {
+      if (ptr[j]->type == SoVectorizeItem::LINE && same_line(ptr[j], ptr[i])) {
+        ptr[i]->type = SoVectorizeItem::UNDEFINED;
+        break;
+      }
+    }
+  }
+
+  j = 0;
+  for (i = 0; i < n; i++) {
+    SoVectorizeItem * item = this->itemlist[i];
+    if (item->type == SoVectorizeItem::UNDEFINED) delete item;
+    else this->itemlist[j++] = item;
+  }
+  this->itemlist.truncate(j);
+}
+
+// interpolates between two packed colors
+static uint32_t
+lerp_color(const uint32_t c0, const uint32_t c1, const float t)
+{
+  if (c0 == c1) return c0;
+  SbColor4f col0, col1;
+  col0.setPackedValue(c0);
+  col1.setPackedValue(c1);
+  return (col0 * (1.0f - t) + col1 * t).getPackedValue();
+}
+
+//
+// Removes the hidden parts of lines and points, and with
+// HLHSR_PAINTER_SURFACE_REMOVAL also the hidden triangles. With
+// HIDDEN_LINES_REMOVAL, triangles are only used to hide other items,
+// and are removed.
+//
+void
+SoVectorizeActionP::remove_hidden_items(void)
+{
+  const SbBool surfaces =
+    this->hlhsrmode == SoVectorizeAction::HLHSR_PAINTER_SURFACE_REMOVAL;
+
+  int i, j, n = this->itemlist.getLength();
+  SoVectorizeHiddenLines hiddenlines;
+  SbList <SoVectorizeItem*> testitems;
+  SbList <SoVectorizeItem*> otheritems;
+  SbList <SoVectorizeItem*> occluders;
+  for (i = 0; i < n; i++) {
+    SoVectorizeItem * item = this->itemlist[i];
+    switch (item->type) {
+    case SoVectorizeItem::TRIANGLE:
+      {
+        SoVectorizeTriangle * tri = (SoVectorizeTriangle*) item;
+        SbVec3f v[3];
+        for (j = 0; j < 3; j++) {
+          v[j] = this->bsp.getPoint(tri->vidx[j]);
+          v[j][2] = tri->z[j];
+        }
+        hiddenlines.addOccluder(v[0], v[1], v[2]);
+        if (surfaces) testitems.append(item);
+        else occluders.append(item);
+      }
+      break;
+    case SoVectorizeItem::LINE:
+    case SoVectorizeItem::POINT:
+      testitems.append(item);
+      break;
+    default:
+      otheritems.append(item);
+      break;
+    }
+  }
+  hiddenlines.build();
+
+  const int numtest = testitems.getLength();
+  int * first = new int[numtest];
+  int * count = new int[numtest];
+  SbList <float> parts;
+  hiddenlines.findVisibleParts(this->bsp, testitems.getArrayPtr(), numtest,
+                               parts, first, count);
+  for (i = 0; i < occluders.getLength(); i++) {
+    delete occluders[i];
+  }
+
+  // triangles are kept first, so that they are printed before the lines
+  this->itemlist.truncate(0);
+  for (i = 0; i < numtest; i++) {
+    SoVectorizeItem * item = testitems[i];
+    if (item->type != SoVectorizeItem::TRIANGLE) continue;
+    if (count[i]) this->itemlist.append(item);
+    else delete item;
+    testitems[i] = NULL;
+  }
+  for (i = 0; i < otheritems.getLength(); i++) {
+    this->itemlist.append(otheritems[i]);
+  }
+  for (i = 0; i < numtest; i++) {
+    SoVectorizeItem * item = testitems[i];
+    if (item == NULL) continue; // a triangle
+    if (count[i] == 0) {
+      delete item;
+      continue;
+    }
+    const float * part = parts.getArrayPtr() + first[i] * 2;
+    if (item->type == SoVectorizeItem::POINT ||
+        (count[i] == 1 && part[0] == 0.0f && part[1] == 1.0f)) {
+      this->itemlist.append(item);
+      continue;
+    }
+    // replace the line with its visible parts
+    SoVectorizeLine * line = (SoVectorizeLine*) item;
+    const SbVec3f v0 = this->bsp.getPoint(line->vidx[0]);
+    const SbVec3f v1 = this->bsp.getPoint(line->vidx[1]);
+    for (j = 0; j < count[i]; j++) {
+      SoVectorizeLine * newline = new SoVectorizeLine;
+      for (int k = 0; k < 2; k++) {
+        const float t = part[j * 2 + k];
+        newline->vidx[k] = this->bsp.addPoint(v0 + (v1 - v0) * t);
+        newline->col[k] = lerp_color(line->col[0], line->col[1], t);
+        newline->z[k] = line->z[0] + (line->z[1] - line->z[0]) * t;
+      }
+      newline->depth = line->depth;
+      newline->width = line->width;
+      newline->pattern = line->pattern;
+      this->itemlist.append(newline);
+    }
+    delete line;
+  }
+  delete[] first;
+  delete[] count;
+}
+
+//
+// Will sort and output items (painter's algorithm), after removing
+// hidden items for the HLHSR modes that do so.
+//
 void
 SoVectorizeActionP::outputItems(void)
 {
+  const SoVectorizeAction::HLHSRMode mode = this->hlhsrmode;
+  const SbBool removehidden =
+    mode == SoVectorizeAction::HLHSR_PAINTER_SURFACE_REMOVAL ||
+    mode == SoVectorizeAction::HIDDEN_LINES_REMOVAL;
+  if (removehidden) {
+    this->remove_duplicate_lines();
+    this->remove_hidden_items();
+  }
+
   int i, n = this->itemlist.getLength();
-  if (n) {
+  if (this->sortruns.getNumRuns()) {
+    this->merge_sorted_runs();
+  }
+  else if (n) {
     SoVectorizeItem ** ptr = (SoVectorizeItem**) this->itemlist.getArrayPtr();
-    qsort(ptr, n, sizeof(void*), (qsort_cmp *) qsort_compare);
+    if (removehidden) {
+      // what's left of the lines and points is visible, and is
+      // printed on top of the triangles, text and images
+      int numsurfaces = 0;
+      while (numsurfaces < n &&
+             ptr[numsurfaces]->type != SoVectorizeItem::LINE &&
+             ptr[numsurfaces]->type != SoVectorizeItem::POINT) {
+        numsurfaces++;
+      }
+      qsort(ptr, numsurfaces, sizeof(void*), (qsort_cmp *) qsort_compare);
+      qsort(ptr + numsurfaces, n - numsurfaces, sizeof(void*), (qsort_cmp *) qsort_compare);
+    }
+    else if (mode != SoVectorizeAction::NO_HLHSR) {
+      qsort(ptr, n, sizeof(void*), (qsort_cmp *) qsort_compare);
+    }
     
     for (i = 0; i < n; i++) {
       PUBLIC(this)->printItem(ptr[i]);
@@ -811,6 +1061,129 @@ SoVectorizeActionP::outputItems(void)
   }
 }
 
+//
+// Called after each shape. Prints the items right away when they
+// don't need to be sorted, and moves a sorted run of items to disk
+// when there are too many to keep in memory.
+//
+void
+SoVectorizeActionP::flushItems(void)
+{
+  const int n = this->itemlist.getLength();
+  if (n == 0) return;
+
+  SoVectorizeItem ** ptr = (SoVectorizeItem**) this->itemlist.getArrayPtr();
+  int i;
+  switch (this->hlhsrmode) {
+  case SoVectorizeAction::NO_HLHSR:
+    for (i = 0; i < n; i++) {
+      PUBLIC(this)->printItem(ptr[i]);
+    }
+    break;
+  case SoVectorizeAction::HLHSR_SIMPLE_PAINTER:
+  case SoVectorizeAction::HLHSR_PAINTER:
+    if (n < this->sortchunksize) return;
+    qsort(ptr, n, sizeof(void*), (qsort_cmp *) qsort_compare);
+    if (!this->sortruns.addRun(ptr, n, this->bsp)) {
+      // keep everything in memory from now on
+      this->sortchunksize = INT_MAX;
+      return;
+    }
+    break;
+  default:
+    // hidden line and surface removal needs all the items at once
+    return;
+  }
+  for (i = 0; i < n; i++) {
+    delete ptr[i];
+  }
+  this->itemlist.truncate(0);
+  // annotation items are printed last, and still need their coordinates
+  if (this->annotationlist.getLength() == 0) this->bsp.clear();
+}
+
+//
+// Returns the number of BSP tree indices used by item, and sets vidx
+// to point to them.
+//
+static int
+get_vertex_indices(SoVectorizeItem * item, int *& vidx)
+{
+  switch (item->type) {
+  case SoVectorizeItem::POINT:
+    vidx = &((SoVectorizePoint*) item)->vidx;
+    return 1;
+  case SoVectorizeItem::LINE:
+    vidx = ((SoVectorizeLine*) item)->vidx;
+    return 2;
+  case SoVectorizeItem::TRIANGLE:
+    vidx = ((SoVectorizeTriangle*) item)->vidx;
+    return 3;
+  default:
+    vidx = NULL;
+    return 0;
+  }
+}
+
+//
+// Prints the items that have been moved to disk, and the items that
+// are still in memory, in depth order.
+//
+void
+SoVectorizeActionP::merge_sorted_runs(void)
+{
+  int i, j, n = this->itemlist.getLength();
+  if (n) {
+    // write the last items as a run too, so that the BSP tree can be
+    // reused while merging
+    SoVectorizeItem ** ptr = (SoVectorizeItem**) this->itemlist.getArrayPtr();
+    qsort(ptr, n, sizeof(void*), (qsort_cmp *) qsort_compare);
+    if (!this->sortruns.addRun(ptr, n, this->bsp)) {
+      // not much else to do than to print these first
+      for (i = 0; i < n; i++) {
+        PUBLIC(this)->printItem(ptr[i]);
+      }
+    }
+    for (i = 0; i < n; i++) {
+      delete ptr[i];
+    }
+    this->itemlist.truncate(0);
+  }
+
+  // the annotation items need their coordinates put back into the
+  // BSP tree after merging
+  SbList <SbVec3f> annotationpoints;
+  int * vidx;
+  n = this->annotationlist.getLength();
+  for (i = 0; i < n; i++) {
+    const int numv = get_vertex_indices(this->annotationlist[i], vidx);
+    for (j = 0; j < numv; j++) {
+      annotationpoints.append(this->bsp.getPoint(vidx[j]));
+    }
+  }
+
+  this->sortruns.merge(this->bsp, print_sorted_item_cb, this);
+  this->sortruns.clear();
+
+  int k = 0;
+  for (i = 0; i < n; i++) {
+    const int numv = get_vertex_indices(this->annotationlist[i], vidx);
+    for (j = 0; j < numv; j++) {
+      vidx[j] = this->bsp.addPoint(annotationpoints[k++]);
+    }
+  }
+}
+
+//
+// Called by SoVectorizeExternalSort::merge() for each item.
+//
+void
+SoVectorizeActionP::print_sorted_item_cb(void * closure, const SoVectorizeItem * item)
+{
+  SoVectorizeActionP * thisp = (SoVectorizeActionP*) closure;
+  PUBLIC(thisp)->printItem(item);
+}
+
 //
 // The OpenGL shading model
 //
@@ -46,6 +46,7 @@
 #include <Inventor/SbVec2s.h>
 #include <Inventor/SbImage.h>
 #include "VectorizeItems.h"
+#include "VectorizeExternalSort.h"
 
 class SbClip;
 class SoPointDetail;
@@ -84,6 +85,7 @@ public:
   float nominalwidth;
   float pixelimagesize;
   SoVectorizeAction::PointStyle pointstyle;
+  SoVectorizeAction::HLHSRMode hlhsrmode;
 
   SbBool testInside(SoState * state,
                     const SbVec3f & p0, 
@@ -98,6 +100,7 @@ public:
   void addImage(SoVectorizeImage * image);
   
   void outputItems(void);
+  void flushItems(void);
   void reset(void);
 
 private:
@@ -115,6 +118,19 @@ private:
   vertexdata * create_vertexdata(const SoPointDetail * pd, SoState * state);
   void add_line(vertexdata * vd0, vertexdata * vd1, SoState * state);
   void add_point(vertexdata * vd, SoState * state);
+  void add_outline(SoCallbackAction * action,
+                   const SoPrimitiveVertex * v1,
+                   const SoPrimitiveVertex * v2,
+                   const SoPrimitiveVertex * v3);
+  void remove_duplicate_lines(void);
+  void remove_hidden_items(void);
+  void merge_sorted_runs(void);
+
+  // sorted runs of items that have been moved to disk, and the
+  // number of items to keep in memory before writing a new run
+  SoVectorizeExternalSort sortruns;
+  int sortchunksize;
+  static void print_sorted_item_cb(void * closure, const SoVectorizeItem * item);
   
   SbBool clip_line(vertexdata * v0, vertexdata * v1, const SbPlane & plane);
 
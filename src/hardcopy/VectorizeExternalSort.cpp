@@ -0,0 +1,592 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+// External memory depth sorting for SoVectorizeAction.
+//
+// Each run is a temporary file with the items of one sorted chunk,
+// stored with their coordinates instead of indices into the BSP
+// tree. When printing, one item at a time is read from each run, and
+// the first of them in depth order is printed. Only the items being
+// merged, and the coordinates of the items printed since the BSP tree
+// was last cleared, are kept in memory.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include "hardcopy/VectorizeExternalSort.h"
+
+#include <cstring>
+
+#include <Inventor/SbBSPTree.h>
+#include <Inventor/SbName.h>
+#include <Inventor/SbString.h>
+#include <Inventor/errors/SoDebugError.h>
+
+#include "hardcopy/VectorizeItems.h"
+
+// the BSP tree is cleared when it grows beyond this many points
+static const int EXTERNALSORT_MAX_BSP_POINTS = 16384;
+// buffer size for each run file
+static const size_t EXTERNALSORT_BUFFER_SIZE = 65536;
+
+// an item read back from a run, and its coordinates
+struct externalsort_item {
+  SoVectorizeItem * item;
+  SbVec3f v[3];
+};
+
+static void
+externalsort_write(FILE * fp, const void * data, const size_t size)
+{
+  (void) fwrite(data, 1, size, fp);
+}
+
+static SbBool
+externalsort_read(FILE * fp, void * data, const size_t size)
+{
+  return fread(data, 1, size, fp) == size;
+}
+
+static void
+externalsort_write_string(FILE * fp, const char * str)
+{
+  const int32_t len = (int32_t) strlen(str);
+  externalsort_write(fp, &len, sizeof(len));
+  externalsort_write(fp, str, len);
+}
+
+static SbBool
+externalsort_read_string(FILE * fp, SbString & str)
+{
+  int32_t len;
+  if (!externalsort_read(fp, &len, sizeof(len)) || len < 0) return FALSE;
+  char buf[256];
+  char * ptr = len < 256 ? buf : new char[len + 1];
+  SbBool ok = externalsort_read(fp, ptr, len);
+  ptr[len] = 0;
+  str = ptr;
+  if (ptr != buf) delete[] ptr;
+  return ok;
+}
+
+static void
+externalsort_delete_item(SoVectorizeItem * item)
+{
+  switch (item->type) {
+  case SoVectorizeItem::POINT: delete (SoVectorizePoint*) item; break;
+  case SoVectorizeItem::LINE: delete (SoVectorizeLine*) item; break;
+  case SoVectorizeItem::TRIANGLE: delete (SoVectorizeTriangle*) item; break;
+  case SoVectorizeItem::TEXT: delete (SoVectorizeText*) item; break;
+  case SoVectorizeItem::IMAGE: delete (SoVectorizeImage*) item; break;
+  default: delete item; break;
+  }
+}
+
+static void
+externalsort_write_item(FILE * fp, const SoVectorizeItem * item,
+                        const SbBSPTree & bsp)
+{
+  const int32_t type = item->type;
+  externalsort_write(fp, &type, sizeof(type));
+  externalsort_write(fp, &item->depth, sizeof(item->depth));
+
+  switch (item->type) {
+  case SoVectorizeItem::POINT:
+    {
+      const SoVectorizePoint * point = (const SoVectorizePoint*) item;
+      const SbVec3f v = bsp.getPoint(point->vidx);
+      externalsort_write(fp, &v, sizeof(v));
+      externalsort_write(fp, &point->size, sizeof(point->size));
+      externalsort_write(fp, &point->col, sizeof(point->col));
+      externalsort_write(fp, &point->z, sizeof(point->z));
+    }
+    break;
+  case SoVectorizeItem::LINE:
+    {
+      const SoVectorizeLine * line = (const SoVectorizeLine*) item;
+      for (int i = 0; i < 2; i++) {
+        const SbVec3f v = bsp.getPoint(line->vidx[i]);
+        externalsort_write(fp, &v, sizeof(v));
+      }
+      externalsort_write(fp, line->col, sizeof(line->col));
+      externalsort_write(fp, &line->pattern, sizeof(line->pattern));
+      externalsort_write(fp, &line->width, sizeof(line->width));
+      externalsort_write(fp, line->z, sizeof(line->z));
+    }
+    break;
+  case SoVectorizeItem::TRIANGLE:
+    {
+      const SoVectorizeTriangle * tri = (const SoVectorizeTriangle*) item;
+      for (int i = 0; i < 3; i++) {
+        const SbVec3f v = bsp.getPoint(tri->vidx[i]);
+        externalsort_write(fp, &v, sizeof(v));
+      }
+      externalsort_write(fp, tri->col, sizeof(tri->col));
+      externalsort_write(fp, tri->z, sizeof(tri->z));
+    }
+    break;
+  case SoVectorizeItem::TEXT:
+    {
+      const SoVectorizeText * text = (const SoVectorizeText*) item;
+      const int32_t justification = text->justification;
+      externalsort_write_string(fp, text->fontname.getString());
+      externalsort_write(fp, &text->fontsize, sizeof(text->fontsize));
+      externalsort_write_string(fp, text->string.getString());
+      externalsort_write(fp, &text->pos, sizeof(text->pos));
+      externalsort_write(fp, &text->col, sizeof(text->col));
+      externalsort_write(fp, &justification, sizeof(justification));
+    }
+    break;
+  case SoVectorizeItem::IMAGE:
+    {
+      // the image data is owned by the scene graph, just like when
+      // the item is kept in memory
+      const SoVectorizeImage * image = (const SoVectorizeImage*) item;
+      externalsort_write(fp, &image->pos, sizeof(image->pos));
+      externalsort_write(fp, &image->size, sizeof(image->size));
+      externalsort_write(fp, &image->image, sizeof(image->image));
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+// reads the next item from fp, returns FALSE at the end of the run
+static SbBool
+externalsort_read_item(FILE * fp, externalsort_item & e)
+{
+  int32_t type;
+  float depth;
+  e.item = NULL;
+  if (!externalsort_read(fp, &type, sizeof(type)) ||
+      !externalsort_read(fp, &depth, sizeof(depth))) return FALSE;
+
+  SbBool ok = TRUE;
+  switch (type) {
+  case SoVectorizeItem::POINT:
+    {
+      SoVectorizePoint * point = new SoVectorizePoint;
+      e.item = point;
+      ok =
+        externalsort_read(fp, &e.v[0], sizeof(e.v[0])) &&
+        externalsort_read(fp, &point->size, sizeof(point->size)) &&
+        externalsort_read(fp, &point->col, sizeof(point->col)) &&
+        externalsort_read(fp, &point->z, sizeof(point->z));
+    }
+    break;
+  case SoVectorizeItem::LINE:
+    {
+      SoVectorizeLine * line = new SoVectorizeLine;
+      e.item = line;
+      ok =
+        externalsort_read(fp, e.v, sizeof(SbVec3f) * 2) &&
+        externalsort_read(fp, line->col, sizeof(line->col)) &&
+        externalsort_read(fp, &line->pattern, sizeof(line->pattern)) &&
+        externalsort_read(fp, &line->width, sizeof(line->width)) &&
+        externalsort_read(fp, line->z, sizeof(line->z));
+    }
+    break;
+  case SoVectorizeItem::TRIANGLE:
+    {
+      SoVectorizeTriangle * tri = new SoVectorizeTriangle;
+      e.item = tri;
+      ok =
+        externalsort_read(fp, e.v, sizeof(SbVec3f) * 3) &&
+        externalsort_read(fp, tri->col, sizeof(tri->col)) &&
+        externalsort_read(fp, tri->z, sizeof(tri->z));
+    }
+    break;
+  case SoVectorizeItem::TEXT:
+    {
+      SoVectorizeText * text = new SoVectorizeText;
+      e.item = text;
+      SbString fontname;
+      int32_t justification = SoVectorizeText::LEFT;
+      ok =
+        externalsort_read_string(fp, fontname) &&
+        externalsort_read(fp, &text->fontsize, sizeof(text->fontsize)) &&
+        externalsort_read_string(fp, text->string) &&
+        externalsort_read(fp, &text->pos, sizeof(text->pos)) &&
+        externalsort_read(fp, &text->col, sizeof(text->col)) &&
+        externalsort_read(fp, &justification, sizeof(justification));
+      text->fontname = SbName(fontname.getString());
+      text->justification = (SoVectorizeText::Justification) justification;
+    }
+    break;
+  case SoVectorizeItem::IMAGE:
+    {
+      SoVectorizeImage * image = new SoVectorizeImage;
+      e.item = image;
+      ok =
+        externalsort_read(fp, &image->pos, sizeof(image->pos)) &&
+        externalsort_read(fp, &image->size, sizeof(image->size)) &&
+        externalsort_read(fp, &image->image, sizeof(image->image));
+    }
+    break;
+  default:
+    ok = FALSE;
+    break;
+  }
+  if (!ok) {
+    if (e.item) externalsort_delete_item(e.item);
+    e.item = NULL;
+    return FALSE;
+  }
+  e.item->depth = depth;
+  return TRUE;
+}
+
+// adds the coordinates of an item read back from a run to bsp
+static void
+externalsort_add_points(externalsort_item & e, SbBSPTree & bsp)
+{
+  switch (e.item->type) {
+  case SoVectorizeItem::POINT:
+    ((SoVectorizePoint*) e.item)->vidx = bsp.addPoint(e.v[0]);
+    break;
+  case SoVectorizeItem::LINE:
+    for (int i = 0; i < 2; i++) {
+      ((SoVectorizeLine*) e.item)->vidx[i] = bsp.addPoint(e.v[i]);
+    }
+    break;
+  case SoVectorizeItem::TRIANGLE:
+    for (int i = 0; i < 3; i++) {
+      ((SoVectorizeTriangle*) e.item)->vidx[i] = bsp.addPoint(e.v[i]);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+SoVectorizeExternalSort::SoVectorizeExternalSort(void)
+{
+}
+
+SoVectorizeExternalSort::~SoVectorizeExternalSort()
+{
+  this->clear();
+}
+
+SbBool
+SoVectorizeExternalSort::addRun(SoVectorizeItem * const * items,
+                                const int numitems,
+                                const SbBSPTree & bsp)
+{
+  FILE * fp = tmpfile();
+  if (fp == NULL) {
+    SoDebugError::postWarning("SoVectorizeExternalSort::addRun",
+                              "Unable to create a temporary file. "
+                              "Keeping all items in memory.");
+    return FALSE;
+  }
+  (void) setvbuf(fp, NULL, _IOFBF, EXTERNALSORT_BUFFER_SIZE);
+
+  for (int i = 0; i < numitems; i++) {
+    externalsort_write_item(fp, items[i], bsp);
+  }
+  if (fflush(fp) != 0 || ferror(fp)) {
+    SoDebugError::postWarning("SoVectorizeExternalSort::addRun",
+                              "Unable to write to a temporary file. "
+                              "Keeping all items in memory.");
+    fclose(fp);
+    return FALSE;
+  }
+  this->runs.append(fp);
+  return TRUE;
+}
+
+void
+SoVectorizeExternalSort::merge(SbBSPTree & bsp, print_cb * cb, void * closure)
+{
+  const int numruns = this->runs.getLength();
+  if (numruns == 0) return;
+
+  externalsort_item * heads = new externalsort_item[numruns];
+  int i;
+  for (i = 0; i < numruns; i++) {
+    rewind(this->runs[i]);
+    (void) externalsort_read_item(this->runs[i], heads[i]);
+  }
+  bsp.clear();
+
+  for (;;) {
+    // the number of runs is small, so a linear search for the
+    // deepest item is fast enough
+    int next = -1;
+    for (i = 0; i < numruns; i++) {
+      if (heads[i].item &&
+          (next < 0 || heads[i].item->depth < heads[next].item->depth)) {
+        next = i;
+      }
+    }
+    if (next < 0) break;
+
+    if (bsp.numPoints() > EXTERNALSORT_MAX_BSP_POINTS) bsp.clear();
+    externalsort_add_points(heads[next], bsp);
+    cb(closure, heads[next].item);
+    externalsort_delete_item(heads[next].item);
+    (void) externalsort_read_item(this->runs[next], heads[next]);
+  }
+  delete[] heads;
+  bsp.clear();
+}
+
+void
+SoVectorizeExternalSort::clear(void)
+{
+  for (int i = 0; i < this->runs.getLength(); i++) {
+    fclose(this->runs[i]);
+  }
+  this->runs.truncate(0);
+}
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SbBSPTree.h>
+#include <Inventor/SbString.h>
+#include "hardcopy/VectorizeExternalSort.h"
+#include "hardcopy/VectorizeItems.h"
+
+namespace {
+
+const int NUM_RUNS = 5;
+const int NUM_ITEMS = 20000;
+const unsigned char externalsort_pixels[16] = { 0 };
+
+// Item m has depth m, and coordinates and data that tell which item
+// it is. The kind of item changes with m.
+SoVectorizeItem *
+externalsort_make_item(const int m, SbBSPTree & bsp)
+{
+  const float x = float(m);
+  SoVectorizeItem * item = NULL;
+  switch (m % 5) {
+  case 0:
+    {
+      SoVectorizeTriangle * tri = new SoVectorizeTriangle;
+      for (int i = 0; i < 3; i++) {
+        tri->vidx[i] = bsp.addPoint(SbVec3f(x, float(i), 0.0f));
+        tri->col[i] = m + i;
+        tri->z[i] = x;
+      }
+      item = tri;
+    }
+    break;
+  case 1:
+    {
+      SoVectorizeLine * line = new SoVectorizeLine;
+      for (int i = 0; i < 2; i++) {
+        line->vidx[i] = bsp.addPoint(SbVec3f(x, float(i), 1.0f));
+        line->col[i] = m + i;
+        line->z[i] = x;
+      }
+      line->pattern = uint16_t(m);
+      item = line;
+    }
+    break;
+  case 2:
+    {
+      SoVectorizePoint * point = new SoVectorizePoint;
+      point->vidx = bsp.addPoint(SbVec3f(x, 0.0f, 2.0f));
+      point->col = m;
+      point->z = x;
+      item = point;
+    }
+    break;
+  case 3:
+    {
+      SoVectorizeText * text = new SoVectorizeText;
+      text->fontname = "Helvetica";
+      text->fontsize = x;
+      text->string.sprintf("%d", m);
+      text->pos = SbVec2f(x, 0.0f);
+      text->col = m;
+      text->justification = SoVectorizeText::CENTER;
+      item = text;
+    }
+    break;
+  default:
+    {
+      SoVectorizeImage * image = new SoVectorizeImage;
+      image->pos = SbVec2f(x, 0.0f);
+      image->size = SbVec2f(1.0f, 1.0f);
+      image->image.data = externalsort_pixels + m % 16;
+      image->image.size = SbVec2s(4, 4);
+      image->image.nc = 1;
+      item = image;
+    }
+    break;
+  }
+  item->depth = x;
+  return item;
+}
+
+void
+externalsort_free_item(SoVectorizeItem * item)
+{
+  switch (item->type) {
+  case SoVectorizeItem::POINT: delete (SoVectorizePoint*) item; break;
+  case SoVectorizeItem::LINE: delete (SoVectorizeLine*) item; break;
+  case SoVectorizeItem::TRIANGLE: delete (SoVectorizeTriangle*) item; break;
+  case SoVectorizeItem::TEXT: delete (SoVectorizeText*) item; break;
+  default: delete (SoVectorizeImage*) item; break;
+  }
+}
+
+// Checks that an item is the same as the one externalsort_make_item()
+// made for m.
+SbBool
+externalsort_check_item(const SoVectorizeItem * item, const int m,
+                        const SbBSPTree & bsp)
+{
+  const float x = float(m);
+  if (item->depth != x) return FALSE;
+  switch (m % 5) {
+  case 0:
+    {
+      if (item->type != SoVectorizeItem::TRIANGLE) return FALSE;
+      const SoVectorizeTriangle * tri = (const SoVectorizeTriangle*) item;
+      for (int i = 0; i < 3; i++) {
+        if (bsp.getPoint(tri->vidx[i]) != SbVec3f(x, float(i), 0.0f) ||
+            tri->col[i] != uint32_t(m + i) || tri->z[i] != x) return FALSE;
+      }
+    }
+    return TRUE;
+  case 1:
+    {
+      if (item->type != SoVectorizeItem::LINE) return FALSE;
+      const SoVectorizeLine * line = (const SoVectorizeLine*) item;
+      for (int i = 0; i < 2; i++) {
+        if (bsp.getPoint(line->vidx[i]) != SbVec3f(x, float(i), 1.0f) ||
+            line->col[i] != uint32_t(m + i) || line->z[i] != x) return FALSE;
+      }
+      return line->pattern == uint16_t(m) && line->width == 1.0f;
+    }
+  case 2:
+    {
+      if (item->type != SoVectorizeItem::POINT) return FALSE;
+      const SoVectorizePoint * point = (const SoVectorizePoint*) item;
+      return bsp.getPoint(point->vidx) == SbVec3f(x, 0.0f, 2.0f) &&
+        point->col == uint32_t(m) && point->z == x && point->size == 1.0f;
+    }
+  case 3:
+    {
+      if (item->type != SoVectorizeItem::TEXT) return FALSE;
+      const SoVectorizeText * text = (const SoVectorizeText*) item;
+      SbString str;
+      str.sprintf("%d", m);
+      return text->fontname == "Helvetica" && text->fontsize == x &&
+        text->string == str && text->pos == SbVec2f(x, 0.0f) &&
+        text->col == uint32_t(m) &&
+        text->justification == SoVectorizeText::CENTER;
+    }
+  default:
+    {
+      if (item->type != SoVectorizeItem::IMAGE) return FALSE;
+      const SoVectorizeImage * image = (const SoVectorizeImage*) item;
+      return image->pos == SbVec2f(x, 0.0f) &&
+        image->size == SbVec2f(1.0f, 1.0f) &&
+        image->image.data == externalsort_pixels + m % 16 &&
+        image->image.size == SbVec2s(4, 4) && image->image.nc == 1;
+    }
+  }
+}
+
+struct externalsort_merged {
+  const SbBSPTree * bsp;
+  int numitems;
+  int numwrong;
+};
+
+void
+externalsort_merged_cb(void * closure, const SoVectorizeItem * item)
+{
+  externalsort_merged * merged = static_cast<externalsort_merged *>(closure);
+  if (!externalsort_check_item(item, merged->numitems, *merged->bsp)) {
+    merged->numwrong++;
+  }
+  merged->numitems++;
+}
+
+} // namespace
+
+// Spreads items of all kinds unevenly over a number of runs, and
+// checks that merging the runs gives back every item, with the same
+// coordinates and data, in depth order. There are more coordinates
+// than the BSP tree keeps while merging.
+BOOST_AUTO_TEST_CASE(mergeRuns)
+{
+  SbBSPTree bsp;
+  SbList <SoVectorizeItem *> runitems[NUM_RUNS];
+  int i, m;
+  for (m = 0; m < NUM_ITEMS; m++) {
+    runitems[(m * 7919 + m / 3) % NUM_RUNS].append(externalsort_make_item(m, bsp));
+  }
+
+  SoVectorizeExternalSort sort;
+  SbBool written = TRUE;
+  for (i = 0; i < NUM_RUNS; i++) {
+    if (!sort.addRun(runitems[i].getArrayPtr(), runitems[i].getLength(), bsp)) {
+      written = FALSE;
+    }
+    for (int j = 0; j < runitems[i].getLength(); j++) {
+      externalsort_free_item(runitems[i][j]);
+    }
+  }
+  if (!written) {
+    BOOST_TEST_MESSAGE("no temporary files, skipping mergeRuns test");
+    return;
+  }
+  BOOST_CHECK_EQUAL(sort.getNumRuns(), NUM_RUNS);
+
+  // the runs can be merged more than once
+  for (int pass = 0; pass < 2; pass++) {
+    SbBSPTree mergebsp;
+    externalsort_merged merged;
+    merged.bsp = &mergebsp;
+    merged.numitems = 0;
+    merged.numwrong = 0;
+    sort.merge(mergebsp, externalsort_merged_cb, &merged);
+    BOOST_CHECK_EQUAL(merged.numitems, NUM_ITEMS);
+    BOOST_CHECK_MESSAGE(merged.numwrong == 0, merged.numwrong <<
+                        " items are out of order or changed");
+    BOOST_CHECK_EQUAL(mergebsp.numPoints(), 0);
+  }
+
+  sort.clear();
+  BOOST_CHECK_EQUAL(sort.getNumRuns(), 0);
+}
+
+#endif // COIN_TEST_SUITE
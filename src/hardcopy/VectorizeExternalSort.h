@@ -0,0 +1,76 @@
+#ifndef COIN_SOVECTORIZEEXTERNALSORT_H
+#define COIN_SOVECTORIZEEXTERNALSORT_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <cstdio>
+
+#include <Inventor/SbVec3f.h>
+#include <Inventor/lists/SbList.h>
+
+class SbBSPTree;
+class SoVectorizeItem;
+
+// Depth sorts more items than fit in memory for SoVectorizeAction.
+// Items are written in sorted runs to temporary files, with their
+// coordinates, and merged back in depth order when printed.
+class SoVectorizeExternalSort {
+public:
+  typedef void print_cb(void * closure, const SoVectorizeItem * item);
+
+  SoVectorizeExternalSort(void);
+  ~SoVectorizeExternalSort();
+
+  // Writes items, which must already be sorted on depth, as a new
+  // run. The coordinates are looked up in bsp. Returns FALSE if the
+  // run could not be written, in which case the items should be kept
+  // in memory.
+  SbBool addRun(SoVectorizeItem * const * items, const int numitems,
+                const SbBSPTree & bsp);
+  int getNumRuns(void) const { return this->runs.getLength(); }
+
+  // Reads back all runs, and calls cb for each item in depth
+  // order. The coordinates of the item are added to bsp before cb is
+  // called, and bsp is cleared every now and then to keep it small.
+  void merge(SbBSPTree & bsp, print_cb * cb, void * closure);
+  void clear(void);
+
+private:
+  SbList <FILE *> runs;
+};
+
+#endif // !COIN_SOVECTORIZEEXTERNALSORT_H
@@ -0,0 +1,611 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+// Hidden line removal for SoVectorizeAction.
+//
+// The parts of a line that are hidden are found by clipping the line
+// against each triangle that might overlap it on screen: first to the
+// part that is inside the triangle, then to the part that is behind
+// the plane of the triangle. What is left after removing these parts
+// from the line is visible. The triangles are sorted into a grid of
+// cells, so that only the triangles in the cells that the line
+// crosses are tested.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include "hardcopy/VectorizeHiddenLines.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cmath>
+
+#include <Inventor/SbBasic.h>
+#include <Inventor/SbBSPTree.h>
+
+#include "base/SbParallel.h"
+#include "coindefs.h"
+#include "hardcopy/VectorizeItems.h"
+
+// Parts of a line are only hidden when they are this much further
+// away than the triangle, so that lines are not hidden by the faces
+// they are the edges of.
+static const float HIDDENLINES_DEPTH_EPSILON = 1.0e-5f;
+// Visible parts shorter than this (in normalized coordinates) are
+// dropped.
+static const float HIDDENLINES_MIN_PART = 1.0e-5f;
+// Triangles with a smaller projected area are not used to hide
+// anything.
+static const float HIDDENLINES_MIN_AREA = 1.0e-12f;
+static const int HIDDENLINES_MAX_GRIDSIZE = 256;
+// Don't bother starting threads for fewer items than this.
+static const int HIDDENLINES_MIN_PARALLEL = 1024;
+
+SoVectorizeHiddenLines::SoVectorizeHiddenLines(void)
+  : gridsize(0), cellstart(NULL), celloccluders(NULL)
+{
+}
+
+SoVectorizeHiddenLines::~SoVectorizeHiddenLines()
+{
+  this->clear();
+}
+
+void
+SoVectorizeHiddenLines::clear(void)
+{
+  this->occluders.truncate(0);
+  delete[] this->cellstart;
+  delete[] this->celloccluders;
+  this->cellstart = NULL;
+  this->celloccluders = NULL;
+  this->gridsize = 0;
+}
+
+void
+SoVectorizeHiddenLines::addOccluder(const SbVec3f & v0,
+                                    const SbVec3f & v1,
+                                    const SbVec3f & v2)
+{
+  const float e0x = v1[0] - v0[0];
+  const float e0y = v1[1] - v0[1];
+  const float e1x = v2[0] - v0[0];
+  const float e1y = v2[1] - v0[1];
+  const float area = e0x * e1y - e0y * e1x;
+  if (float(fabs(area)) < HIDDENLINES_MIN_AREA) return;
+
+  Occluder occ;
+  occ.v[0] = v0;
+  occ.v[1] = v1;
+  occ.v[2] = v2;
+  occ.orientation = (area > 0.0f) ? 1.0f : -1.0f;
+
+  // solve for the plane through the three vertices
+  const float dz0 = v1[2] - v0[2];
+  const float dz1 = v2[2] - v0[2];
+  occ.a = (dz0 * e1y - dz1 * e0y) / area;
+  occ.b = (e0x * dz1 - e1x * dz0) / area;
+  occ.c = v0[2] - occ.a * v0[0] - occ.b * v0[1];
+  this->occluders.append(occ);
+}
+
+// finds the range of cells overlapped by the box from (x0, y0) to (x1, y1)
+void
+SoVectorizeHiddenLines::getCells(const float x0, const float y0,
+                                 const float x1, const float y1,
+                                 int & cx0, int & cy0, int & cx1, int & cy1) const
+{
+  const float g = float(this->gridsize);
+  cx0 = SbClamp(int(SbMin(x0, x1) * g), 0, this->gridsize - 1);
+  cx1 = SbClamp(int(SbMax(x0, x1) * g), 0, this->gridsize - 1);
+  cy0 = SbClamp(int(SbMin(y0, y1) * g), 0, this->gridsize - 1);
+  cy1 = SbClamp(int(SbMax(y0, y1) * g), 0, this->gridsize - 1);
+}
+
+void
+SoVectorizeHiddenLines::build(void)
+{
+  delete[] this->cellstart;
+  delete[] this->celloccluders;
+
+  const int n = this->occluders.getLength();
+  this->gridsize = 1;
+  while (this->gridsize < HIDDENLINES_MAX_GRIDSIZE &&
+         this->gridsize * this->gridsize * 2 < n) {
+    this->gridsize *= 2;
+  }
+  const int numcells = this->gridsize * this->gridsize;
+  this->cellstart = new int[numcells + 1];
+  int i;
+  for (i = 0; i <= numcells; i++) this->cellstart[i] = 0;
+
+  for (i = 0; i < n; i++) {
+    Occluder & occ = this->occluders[i];
+    const SbVec3f * v = occ.v;
+    this->getCells(SbMin(v[0][0], SbMin(v[1][0], v[2][0])),
+                   SbMin(v[0][1], SbMin(v[1][1], v[2][1])),
+                   SbMax(v[0][0], SbMax(v[1][0], v[2][0])),
+                   SbMax(v[0][1], SbMax(v[1][1], v[2][1])),
+                   occ.cx0, occ.cy0, occ.cx1, occ.cy1);
+  }
+
+  for (int pass = 0; pass < 2; pass++) {
+    for (i = 0; i < n; i++) {
+      const Occluder & occ = this->occluders[i];
+      for (int cy = occ.cy0; cy <= occ.cy1; cy++) {
+        for (int cx = occ.cx0; cx <= occ.cx1; cx++) {
+          const int cell = cy * this->gridsize + cx;
+          if (pass == 0) this->cellstart[cell + 1]++;
+          else this->celloccluders[this->cellstart[cell + 1]++] = i;
+        }
+      }
+    }
+    if (pass == 0) {
+      for (i = 0; i < numcells; i++) this->cellstart[i + 1] += this->cellstart[i];
+      this->celloccluders = new int[this->cellstart[numcells]];
+      // the second pass counts the occluders again, from the start of each cell
+      for (i = numcells; i > 0; i--) this->cellstart[i] = this->cellstart[i - 1];
+    }
+  }
+}
+
+// finds the triangles in the cells crossed by the line from v0 to v1
+void
+SoVectorizeHiddenLines::getCandidates(const SbVec3f & v0, const SbVec3f & v1,
+                                      SbList <int> & candidates) const
+{
+  candidates.truncate(0);
+  if (this->gridsize == 0) return;
+
+  int cx0, cy0, cx1, cy1;
+  this->getCells(v0[0], v0[1], v1[0], v1[1], cx0, cy0, cx1, cy1);
+
+  const float dx = v1[0] - v0[0];
+  const float dy = v1[1] - v0[1];
+  const float cellsize = 1.0f / float(this->gridsize);
+  int prevrx0 = 0, prevrx1 = -1;
+  for (int cy = cy0; cy <= cy1; cy++) {
+    // the part of the line inside this row of cells
+    int rx0 = cx0, rx1 = cx1;
+    if (cy0 != cy1 && dy != 0.0f) {
+      float ta = (float(cy) * cellsize - v0[1]) / dy;
+      float tb = (float(cy + 1) * cellsize - v0[1]) / dy;
+      ta = SbClamp(ta, 0.0f, 1.0f);
+      tb = SbClamp(tb, 0.0f, 1.0f);
+      int dummy0, dummy1;
+      this->getCells(v0[0] + ta * dx, 0.0f, v0[0] + tb * dx, 0.0f,
+                     rx0, dummy0, rx1, dummy1);
+    }
+    for (int cx = rx0; cx <= rx1; cx++) {
+      const int cell = cy * this->gridsize + cx;
+      for (int i = this->cellstart[cell]; i < this->cellstart[cell + 1]; i++) {
+        const int idx = this->celloccluders[i];
+        const Occluder & occ = this->occluders[idx];
+        // A triangle is in all the cells overlapped by its bounding
+        // box, so it has been found before if the box overlaps the
+        // cell to the left in this row, or the cells in the row below.
+        if (occ.cx0 < cx && cx > rx0) continue;
+        if (occ.cy0 < cy && cy > cy0 &&
+            SbMax(occ.cx0, prevrx0) <= SbMin(occ.cx1, prevrx1)) continue;
+        candidates.append(idx);
+      }
+    }
+    prevrx0 = rx0;
+    prevrx1 = rx1;
+  }
+}
+
+// clips [t0, t1] of the line from v0 to v1 to the part where
+// f0 + t * (f1 - f0) >= 0. Returns FALSE if nothing is left.
+static inline SbBool
+hiddenlines_clip(const float f0, const float f1, float & t0, float & t1)
+{
+  if (f0 < 0.0f && f1 < 0.0f) return FALSE;
+  if (f0 < 0.0f) t0 = SbMax(t0, f0 / (f0 - f1));
+  else if (f1 < 0.0f) t1 = SbMin(t1, f0 / (f0 - f1));
+  return t0 < t1;
+}
+
+// finds the part of the line from v0 to v1 that is hidden by occ.
+// Returns FALSE if no part is hidden.
+SbBool
+SoVectorizeHiddenLines::clipHidden(const Occluder & occ,
+                                   const SbVec3f & v0, const SbVec3f & v1,
+                                   float & t0, float & t1)
+{
+  t0 = 0.0f;
+  t1 = 1.0f;
+  for (int i = 0; i < 3; i++) {
+    const SbVec3f & p = occ.v[i];
+    const SbVec3f & q = occ.v[(i + 1) % 3];
+    const float ex = q[0] - p[0];
+    const float ey = q[1] - p[1];
+    const float f0 = occ.orientation * (ex * (v0[1] - p[1]) - ey * (v0[0] - p[0]));
+    const float f1 = occ.orientation * (ex * (v1[1] - p[1]) - ey * (v1[0] - p[0]));
+    if (!hiddenlines_clip(f0, f1, t0, t1)) return FALSE;
+  }
+  const float d0 = v0[2] - (occ.a * v0[0] + occ.b * v0[1] + occ.c) - HIDDENLINES_DEPTH_EPSILON;
+  const float d1 = v1[2] - (occ.a * v1[0] + occ.b * v1[1] + occ.c) - HIDDENLINES_DEPTH_EPSILON;
+  return hiddenlines_clip(d0, d1, t0, t1);
+}
+
+void
+SoVectorizeHiddenLines::getVisibleParts(const SbVec3f & v0, const SbVec3f & v1,
+                                        SbList <float> & visible) const
+{
+  const float length = float(sqrt((v1[0] - v0[0]) * (v1[0] - v0[0]) +
+                                  (v1[1] - v0[1]) * (v1[1] - v0[1])));
+  if (length < HIDDENLINES_MIN_PART) {
+    if (!this->isHidden(v0)) {
+      visible.append(0.0f);
+      visible.append(1.0f);
+    }
+    return;
+  }
+
+  SbList <int> candidates;
+  this->getCandidates(v0, v1, candidates);
+
+  // the hidden parts, sorted on the start parameter
+  SbList <float> hidden;
+  for (int i = 0; i < candidates.getLength(); i++) {
+    float t0, t1;
+    if (!clipHidden(this->occluders[candidates[i]], v0, v1, t0, t1)) continue;
+    if (t0 <= 0.0f && t1 >= 1.0f) return; // completely hidden
+    int j = hidden.getLength();
+    hidden.append(t0);
+    hidden.append(t1);
+    while (j > 0 && hidden[j - 2] > t0) {
+      hidden[j] = hidden[j - 2];
+      hidden[j + 1] = hidden[j - 1];
+      j -= 2;
+    }
+    hidden[j] = t0;
+    hidden[j + 1] = t1;
+
+    // stop when the hidden parts cover all of the line
+    if (hidden[0] <= 0.0f) {
+      float end = hidden[1];
+      for (j = 2; j < hidden.getLength() && hidden[j] <= end; j += 2) {
+        end = SbMax(end, hidden[j + 1]);
+      }
+      if (end >= 1.0f) return;
+    }
+  }
+
+  const float minpart = HIDDENLINES_MIN_PART / length;
+  float start = 0.0f;
+  for (int i = 0; i < hidden.getLength(); i += 2) {
+    if (hidden[i] - start > minpart) {
+      visible.append(start);
+      visible.append(hidden[i]);
+    }
+    start = SbMax(start, hidden[i + 1]);
+  }
+  if (1.0f - start > minpart) {
+    visible.append(start);
+    visible.append(1.0f);
+  }
+}
+
+// returns TRUE if v is inside occ on screen, and behind it
+SbBool
+SoVectorizeHiddenLines::hides(const Occluder & occ, const SbVec3f & v)
+{
+  for (int j = 0; j < 3; j++) {
+    const SbVec3f & p = occ.v[j];
+    const SbVec3f & q = occ.v[(j + 1) % 3];
+    const float f = occ.orientation *
+      ((q[0] - p[0]) * (v[1] - p[1]) - (q[1] - p[1]) * (v[0] - p[0]));
+    if (f < 0.0f) return FALSE;
+  }
+  return v[2] - (occ.a * v[0] + occ.b * v[1] + occ.c) > HIDDENLINES_DEPTH_EPSILON;
+}
+
+SbBool
+SoVectorizeHiddenLines::isHidden(const SbVec3f & v) const
+{
+  if (this->gridsize == 0) return FALSE;
+  int cx, cy, dummy0, dummy1;
+  this->getCells(v[0], v[1], v[0], v[1], cx, cy, dummy0, dummy1);
+  const int cell = cy * this->gridsize + cx;
+  for (int i = this->cellstart[cell]; i < this->cellstart[cell + 1]; i++) {
+    if (hides(this->occluders[this->celloccluders[i]], v)) return TRUE;
+  }
+  return FALSE;
+}
+
+// Since the triangles are convex and the depth is linear over them, a
+// triangle is covered by an occluder and behind it if its vertices
+// are. Triangles that are only hidden by several occluders together
+// are kept, since that can't be decided from the edges and a few
+// sample points.
+SbBool
+SoVectorizeHiddenLines::isTriangleHidden(const SbVec3f & v0, const SbVec3f & v1,
+                                         const SbVec3f & v2) const
+{
+  if (this->gridsize == 0) return FALSE;
+  // an occluder covering v0 is in its cell
+  int cx, cy, dummy0, dummy1;
+  this->getCells(v0[0], v0[1], v0[0], v0[1], cx, cy, dummy0, dummy1);
+  const int cell = cy * this->gridsize + cx;
+  for (int i = this->cellstart[cell]; i < this->cellstart[cell + 1]; i++) {
+    const Occluder & occ = this->occluders[this->celloccluders[i]];
+    if (hides(occ, v0) && hides(occ, v1) && hides(occ, v2)) return TRUE;
+  }
+  return FALSE;
+}
+
+// *************************************************************************
+
+// Returns the number of threads to use, which can be overridden with
+// the environment variable COIN_VECTORIZE_NUM_THREADS.
+static int
+hiddenlines_num_threads(void)
+{
+  static int num = -1;
+  if (num < 0) num = SbParallel::getNumThreads("COIN_VECTORIZE_NUM_THREADS");
+  return num;
+}
+
+struct hiddenlines_task {
+  const SoVectorizeHiddenLines * hiddenlines;
+  const SbBSPTree * bsp;
+  SoVectorizeItem * const * items;
+  int begin, end;
+  SbList <float> parts;
+  int * first;
+  int * count;
+};
+
+static void
+hiddenlines_run_task(hiddenlines_task * task)
+{
+  const SbBSPTree & bsp = *task->bsp;
+  SbList <float> & parts = task->parts;
+  for (int i = task->begin; i < task->end; i++) {
+    const SoVectorizeItem * item = task->items[i];
+    const int start = parts.getLength();
+    switch (item->type) {
+    case SoVectorizeItem::LINE:
+      {
+        const SoVectorizeLine * line = (const SoVectorizeLine *) item;
+        SbVec3f v0 = bsp.getPoint(line->vidx[0]);
+        SbVec3f v1 = bsp.getPoint(line->vidx[1]);
+        v0[2] = line->z[0];
+        v1[2] = line->z[1];
+        task->hiddenlines->getVisibleParts(v0, v1, parts);
+      }
+      break;
+    case SoVectorizeItem::POINT:
+      {
+        const SoVectorizePoint * point = (const SoVectorizePoint *) item;
+        SbVec3f v = bsp.getPoint(point->vidx);
+        v[2] = point->z;
+        if (!task->hiddenlines->isHidden(v)) {
+          parts.append(0.0f);
+          parts.append(1.0f);
+        }
+      }
+      break;
+    case SoVectorizeItem::TRIANGLE:
+      {
+        const SoVectorizeTriangle * tri = (const SoVectorizeTriangle *) item;
+        SbVec3f v[3];
+        for (int j = 0; j < 3; j++) {
+          v[j] = bsp.getPoint(tri->vidx[j]);
+          v[j][2] = tri->z[j];
+        }
+        if (!task->hiddenlines->isTriangleHidden(v[0], v[1], v[2])) {
+          parts.append(0.0f);
+          parts.append(1.0f);
+        }
+      }
+      break;
+    default:
+      assert(0 && "unexpected item type");
+      break;
+    }
+    task->first[i] = start / 2;
+    task->count[i] = (parts.getLength() - start) / 2;
+  }
+}
+
+static void
+hiddenlines_task_entry(void * closure, int task, int COIN_UNUSED_ARG(numtasks))
+{
+  hiddenlines_run_task(static_cast<hiddenlines_task *>(closure) + task);
+}
+
+void
+SoVectorizeHiddenLines::findVisibleParts(const SbBSPTree & bsp,
+                                         SoVectorizeItem * const * items,
+                                         const int numitems,
+                                         SbList <float> & parts,
+                                         int * first, int * count) const
+{
+  int numtasks = 1;
+  if (numitems >= HIDDENLINES_MIN_PARALLEL) {
+    numtasks = SbMin(hiddenlines_num_threads(), numitems);
+  }
+
+  hiddenlines_task * tasks = new hiddenlines_task[numtasks];
+  int i;
+  for (i = 0; i < numtasks; i++) {
+    tasks[i].hiddenlines = this;
+    tasks[i].bsp = &bsp;
+    tasks[i].items = items;
+    SbParallel::getRange(numitems, i, numtasks, tasks[i].begin, tasks[i].end);
+    tasks[i].first = first;
+    tasks[i].count = count;
+  }
+  SbParallel::run(hiddenlines_task_entry, tasks, numtasks);
+
+  // gather the parts from all the tasks in one list
+  parts.truncate(0);
+  for (i = 0; i < numtasks; i++) {
+    const int offset = parts.getLength() / 2;
+    for (int j = tasks[i].begin; j < tasks[i].end; j++) first[j] += offset;
+    for (int k = 0; k < tasks[i].parts.getLength(); k++) {
+      parts.append(tasks[i].parts[k]);
+    }
+  }
+  delete[] tasks;
+}
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SbBSPTree.h>
+#include "hardcopy/VectorizeHiddenLines.h"
+#include "hardcopy/VectorizeItems.h"
+
+namespace {
+
+// the number of copies of the items, enough to make
+// findVisibleParts() split them between threads
+const int HIDDENLINES_TEST_COPIES = 300;
+
+SoVectorizeItem *
+hiddenlines_line(SbBSPTree & bsp, const float x0, const float y0,
+                 const float x1, const float y1, const float z)
+{
+  SoVectorizeLine * line = new SoVectorizeLine;
+  line->vidx[0] = bsp.addPoint(SbVec3f(x0, y0, 0.0f));
+  line->vidx[1] = bsp.addPoint(SbVec3f(x1, y1, 0.0f));
+  line->z[0] = line->z[1] = z;
+  return line;
+}
+
+SoVectorizeItem *
+hiddenlines_point(SbBSPTree & bsp, const float x, const float y, const float z)
+{
+  SoVectorizePoint * point = new SoVectorizePoint;
+  point->vidx = bsp.addPoint(SbVec3f(x, y, 0.0f));
+  point->z = z;
+  return point;
+}
+
+SoVectorizeItem *
+hiddenlines_triangle(SbBSPTree & bsp, const SbVec2f & v0, const SbVec2f & v1,
+                     const SbVec2f & v2, const float z)
+{
+  SoVectorizeTriangle * tri = new SoVectorizeTriangle;
+  tri->vidx[0] = bsp.addPoint(SbVec3f(v0[0], v0[1], 0.0f));
+  tri->vidx[1] = bsp.addPoint(SbVec3f(v1[0], v1[1], 0.0f));
+  tri->vidx[2] = bsp.addPoint(SbVec3f(v2[0], v2[1], 0.0f));
+  tri->z[0] = tri->z[1] = tri->z[2] = z;
+  return tri;
+}
+
+} // namespace
+
+// A square of two triangles at depth 0.5 covers the middle of the
+// screen. Lines, points and triangles behind it must lose the parts it
+// covers, and the ones in front of it must stay whole.
+BOOST_AUTO_TEST_CASE(occludedItems)
+{
+  SoVectorizeHiddenLines hiddenlines;
+  hiddenlines.addOccluder(SbVec3f(0.25f, 0.25f, 0.5f), SbVec3f(0.75f, 0.25f, 0.5f),
+                          SbVec3f(0.25f, 0.75f, 0.5f));
+  hiddenlines.addOccluder(SbVec3f(0.75f, 0.25f, 0.5f), SbVec3f(0.75f, 0.75f, 0.5f),
+                          SbVec3f(0.25f, 0.75f, 0.5f));
+  hiddenlines.build();
+  BOOST_CHECK_EQUAL(hiddenlines.getNumOccluders(), 2);
+
+  SbBSPTree bsp;
+  SbList <SoVectorizeItem *> items;
+  // the visible parts expected for each item, ended by -1
+  static const float expected[] = {
+    0.0f, 0.1875f, 0.8125f, 1.0f, -1.0f, // line through the square, behind
+    0.0f, 1.0f, -1.0f,                   // the same line in front
+    0.0f, 1.0f, -1.0f,                   // line beside the square, behind
+    -1.0f,                               // point behind the square
+    0.0f, 1.0f, -1.0f,                   // point in front of the square
+    0.0f, 1.0f, -1.0f,                   // point beside the square
+    -1.0f,                               // triangle behind one occluder
+    0.0f, 1.0f, -1.0f,                   // the same triangle in front
+    0.0f, 1.0f, -1.0f                    // triangle behind both occluders
+  };
+  const SbVec2f small[3] = {
+    SbVec2f(0.3f, 0.3f), SbVec2f(0.4f, 0.3f), SbVec2f(0.3f, 0.4f)
+  };
+  for (int copy = 0; copy < HIDDENLINES_TEST_COPIES; copy++) {
+    items.append(hiddenlines_line(bsp, 0.1f, 0.5f, 0.9f, 0.5f, 0.8f));
+    items.append(hiddenlines_line(bsp, 0.1f, 0.5f, 0.9f, 0.5f, 0.2f));
+    items.append(hiddenlines_line(bsp, 0.1f, 0.9f, 0.9f, 0.9f, 0.8f));
+    items.append(hiddenlines_point(bsp, 0.5f, 0.5f, 0.8f));
+    items.append(hiddenlines_point(bsp, 0.5f, 0.5f, 0.2f));
+    items.append(hiddenlines_point(bsp, 0.9f, 0.1f, 0.8f));
+    items.append(hiddenlines_triangle(bsp, small[0], small[1], small[2], 0.8f));
+    items.append(hiddenlines_triangle(bsp, small[0], small[1], small[2], 0.2f));
+    items.append(hiddenlines_triangle(bsp, SbVec2f(0.4f, 0.4f), SbVec2f(0.6f, 0.4f),
+                                      SbVec2f(0.5f, 0.6f), 0.8f));
+  }
+  const int numitems = items.getLength();
+  const int itemspercopy = numitems / HIDDENLINES_TEST_COPIES;
+
+  SbList <float> parts;
+  int * first = new int[numitems];
+  int * count = new int[numitems];
+  hiddenlines.findVisibleParts(bsp, items.getArrayPtr(), numitems, parts, first, count);
+
+  int numwrong = 0;
+  for (int i = 0; i < numitems; i++) {
+    // find the expected parts of the item
+    const float * e = expected;
+    for (int j = 0; j < i % itemspercopy; j++) {
+      while (*e >= 0.0f) e++;
+      e++;
+    }
+    int n = 0;
+    while (e[n] >= 0.0f) n++;
+    SbBool ok = (count[i] * 2 == n);
+    for (int k = 0; ok && k < n; k++) {
+      ok = fabs(parts[first[i] * 2 + k] - e[k]) < 1.0e-4f;
+    }
+    if (!ok) {
+      if (numwrong == 0) {
+        BOOST_ERROR("item " << i << " has " << count[i] << " visible parts, " <<
+                    "expected " << n / 2);
+      }
+      numwrong++;
+    }
+  }
+  BOOST_CHECK_MESSAGE(numwrong == 0, numwrong << " items have the wrong visible parts");
+
+  delete[] first;
+  delete[] count;
+  for (int i = 0; i < numitems; i++) delete items[i];
+}
+
+#endif // COIN_TEST_SUITE
@@ -0,0 +1,111 @@
+#ifndef COIN_SOVECTORIZEHIDDENLINES_H
+#define COIN_SOVECTORIZEHIDDENLINES_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/SbVec3f.h>
+#include <Inventor/lists/SbList.h>
+
+class SbBSPTree;
+class SoVectorizeItem;
+
+// Finds the parts of lines and points that are hidden by triangles,
+// for the hidden line and surface removal modes of
+// SoVectorizeAction. All coordinates are in the [0,1] normalized
+// device coordinates used by SoVectorizeActionP, with the projected
+// depth in z.
+//
+// The triangles are sorted into a screen space grid when build() is
+// called. After that, the const methods only read the grid, and can
+// be called from several threads at the same time.
+class SoVectorizeHiddenLines {
+public:
+  SoVectorizeHiddenLines(void);
+  ~SoVectorizeHiddenLines();
+
+  void addOccluder(const SbVec3f & v0, const SbVec3f & v1, const SbVec3f & v2);
+  void build(void);
+  void clear(void);
+
+  int getNumOccluders(void) const { return this->occluders.getLength(); }
+
+  // Appends the start and end parameter (from 0 at v0 to 1 at v1) of
+  // each visible part of the line from v0 to v1 to visible.
+  void getVisibleParts(const SbVec3f & v0, const SbVec3f & v1,
+                       SbList <float> & visible) const;
+  SbBool isHidden(const SbVec3f & v) const;
+  // Returns TRUE if one triangle covers all of the triangle from v0,
+  // v1 and v2 on screen, and is in front of it.
+  SbBool isTriangleHidden(const SbVec3f & v0, const SbVec3f & v1,
+                          const SbVec3f & v2) const;
+
+  // Finds the visible parts of each line, point and triangle in
+  // items, with the coordinates in bsp, in parallel when there are
+  // many items. The visible parts of item i are the count[i] pairs of
+  // start and end parameters from parts[first[i] * 2]. Points and
+  // triangles have one part if they are visible, and none if they are
+  // hidden. Triangles are only hidden when isTriangleHidden() is TRUE.
+  void findVisibleParts(const SbBSPTree & bsp,
+                        SoVectorizeItem * const * items, const int numitems,
+                        SbList <float> & parts, int * first, int * count) const;
+
+private:
+  struct Occluder {
+    SbVec3f v[3];
+    float orientation; // 1 for counterclockwise, -1 for clockwise
+    // the depth at (x, y) is a * x + b * y + c
+    float a, b, c;
+    // the cells overlapped by the bounding box
+    int cx0, cy0, cx1, cy1;
+  };
+
+  void getCells(const float x0, const float y0, const float x1, const float y1,
+                int & cx0, int & cy0, int & cx1, int & cy1) const;
+  void getCandidates(const SbVec3f & v0, const SbVec3f & v1,
+                     SbList <int> & candidates) const;
+  static SbBool clipHidden(const Occluder & occ,
+                           const SbVec3f & v0, const SbVec3f & v1,
+                           float & t0, float & t1);
+  static SbBool hides(const Occluder & occ, const SbVec3f & v);
+
+  SbList <Occluder> occluders;
+  int gridsize;
+  int * cellstart; // index of the first occluder of each cell in celloccluders
+  int * celloccluders;
+};
+
+#endif // !COIN_SOVECTORIZEHIDDENLINES_H
@@ -69,6 +69,7 @@ public:
   int vidx;       // index to BSPtree coordinate
   float size;     // Coin size (pixels)
   uint32_t col;
+  float z;        // projected depth, for hidden line removal
 };
 
 class SoVectorizeTriangle : public SoVectorizeItem {
@@ -78,6 +79,7 @@ public:
   }
   int vidx[3];      // indices to BSPtree coordinates
   uint32_t col[3];
+  float z[3];       // projected depth, for hidden line removal
 };
 
 class SoVectorizeLine : public SoVectorizeItem {
@@ -91,6 +93,7 @@ public:
   uint32_t col[2];
   uint16_t pattern;  // Coin line pattern
   float width;       // Coin line width (pixels)
+  float z[2];        // projected depth, for hidden line removal
 };
 
 class SoVectorizeText : public SoVectorizeItem {
@@ -35,4 +35,6 @@
 #include "VectorOutput.cpp"
 #include "VectorizeAction.cpp"
 #include "VectorizeActionP.cpp"
+#include "VectorizeExternalSort.cpp"
+#include "VectorizeHiddenLines.cpp"
 #include "VectorizePSAction.cpp"
@@ -0,0 +1,807 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoChunkedFile SoChunkedFile.h Inventor/SoChunkedFile.h
+  \brief The SoChunkedFile class writes and reads chunked binary scene files.
+
+  \ingroup coin_general
+
+  A chunked file is a binary Inventor file where large, self-contained
+  subgraphs are stored as separate chunks after the main scene
+  graph. The main scene graph (the "skeleton") holds an
+  SoLazySeparator node with the chunk index and the bounding box of
+  the subgraph in place of each chunk. A table of contents at the end
+  of the file makes it possible to read any chunk without parsing the
+  rest of the file.
+
+  Chunked files are read with the usual SoInput / SoDB::readAll()
+  calls. Only the skeleton is read up front; the chunks are read when
+  the SoLazySeparator nodes are first rendered inside the view
+  volume, picked, or otherwise traversed. This makes the time until
+  the first frame is rendered proportional to the visible part of the
+  model instead of its total size.
+
+  Chunked files start with the header returned from
+  getHeaderString(), which is registered with SoDB::registerHeader().
+
+  \sa SoLazySeparator
+  \COIN_CLASS_EXTENSION
+*/
+
+// *************************************************************************
+
+#include <Inventor/SoChunkedFile.h>
+#include "io/SoChunkedFileP.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoFullPath.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoOutput.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/errors/SoDebugError.h>
+#include <Inventor/fields/SoMField.h>
+#include <Inventor/lists/SoFieldList.h>
+#include <Inventor/misc/SoChildList.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoLazySeparator.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodekits/SoBaseKit.h>
+
+#include "tidbitsp.h"
+#include "io/gzmemio.h"
+#include "misc/SbHash.h"
+#include "threads/threadsutilp.h"
+
+// *************************************************************************
+
+const char SoChunkedFileP::HEADER[] = "#Coin3D V1.0 chunked binary";
+const char SoChunkedFileP::MAGIC[] = "COINCHNK";
+const uint32_t SoChunkedFileP::FORMATVERSION = 1;
+const int SoChunkedFileP::TRAILERSIZE = 16;
+
+typedef SbHash<SbString, SoChunkedFileP::TableOfContents *> SoChunkedFileTocMap;
+
+static SoChunkedFileTocMap * chunkedfile_tocmap = NULL;
+static void * chunkedfile_mutex = NULL;
+
+static void
+chunkedfile_put_uint32(unsigned char * ptr, uint32_t val)
+{
+  for (int i = 3; i >= 0; i--) { ptr[i] = (unsigned char) (val & 0xff); val >>= 8; }
+}
+
+static void
+chunkedfile_put_uint64(unsigned char * ptr, uint64_t val)
+{
+  for (int i = 7; i >= 0; i--) { ptr[i] = (unsigned char) (val & 0xff); val >>= 8; }
+}
+
+static uint32_t
+chunkedfile_get_uint32(const unsigned char * ptr)
+{
+  uint32_t val = 0;
+  for (int i = 0; i < 4; i++) { val = (val << 8) | ptr[i]; }
+  return val;
+}
+
+static uint64_t
+chunkedfile_get_uint64(const unsigned char * ptr)
+{
+  uint64_t val = 0;
+  for (int i = 0; i < 8; i++) { val = (val << 8) | ptr[i]; }
+  return val;
+}
+
+static void
+chunkedfile_cleanup(void)
+{
+  if (chunkedfile_tocmap) {
+    for (SoChunkedFileTocMap::const_iterator it = chunkedfile_tocmap->const_begin();
+         it != chunkedfile_tocmap->const_end(); ++it) {
+      delete it->obj;
+    }
+    delete chunkedfile_tocmap;
+    chunkedfile_tocmap = NULL;
+  }
+  CC_MUTEX_DESTRUCT(chunkedfile_mutex);
+}
+
+// *************************************************************************
+
+void
+SoChunkedFileP::initClass(void)
+{
+  CC_MUTEX_CONSTRUCT(chunkedfile_mutex);
+  chunkedfile_tocmap = new SoChunkedFileTocMap;
+  coin_atexit((coin_atexit_f *) chunkedfile_cleanup, CC_ATEXIT_NORMAL);
+
+  SoDB::registerHeader(SbString(SoChunkedFileP::HEADER), TRUE, 2.1f,
+                       NULL, NULL, NULL);
+}
+
+// fseek() and ftell() use a long for the file position, which is 32
+// bits wide on Windows and on 32-bit systems, so use the 64-bit
+// variants where available.
+int
+SoChunkedFileP::seek(FILE * fp, int64_t offset, int whence)
+{
+#if defined(_WIN32)
+  return _fseeki64(fp, (__int64) offset, whence);
+#elif defined(HAVE_FSEEKO)
+  return fseeko(fp, (off_t) offset, whence);
+#else // !HAVE_FSEEKO
+  return fseek(fp, (long) offset, whence);
+#endif // !HAVE_FSEEKO
+}
+
+uint64_t
+SoChunkedFileP::tell(FILE * fp)
+{
+#if defined(_WIN32)
+  return (uint64_t) _ftelli64(fp);
+#elif defined(HAVE_FSEEKO)
+  return (uint64_t) ftello(fp);
+#else // !HAVE_FSEEKO
+  return (uint64_t) ftell(fp);
+#endif // !HAVE_FSEEKO
+}
+
+// Checks for the chunked file header at the current position of fp,
+// leaving the file position unchanged.
+SbBool
+SoChunkedFileP::hasHeader(FILE * fp)
+{
+  const size_t len = strlen(SoChunkedFileP::HEADER);
+  char buf[sizeof(SoChunkedFileP::HEADER)];
+  const uint64_t pos = SoChunkedFileP::tell(fp);
+  const SbBool ok = (fread(buf, 1, len, fp) == len) &&
+    (memcmp(buf, SoChunkedFileP::HEADER, len) == 0);
+  (void) SoChunkedFileP::seek(fp, pos, SEEK_SET);
+  return ok;
+}
+
+// Reads the table of contents from the end of the file, leaving the
+// file position unchanged.
+SbBool
+SoChunkedFileP::readTableOfContents(FILE * fp, TableOfContents & toc)
+{
+  const uint64_t pos = SoChunkedFileP::tell(fp);
+  SbBool ok = FALSE;
+  unsigned char trailer[16];
+  unsigned char * buf = NULL;
+
+  toc.skeletonsize = 0;
+  toc.chunks.truncate(0);
+
+  if (SoChunkedFileP::seek(fp, -SoChunkedFileP::TRAILERSIZE, SEEK_END) == 0 &&
+      fread(trailer, 1, SoChunkedFileP::TRAILERSIZE, fp) == (size_t) SoChunkedFileP::TRAILERSIZE &&
+      memcmp(trailer + 8, SoChunkedFileP::MAGIC, 8) == 0 &&
+      SoChunkedFileP::seek(fp, chunkedfile_get_uint64(trailer), SEEK_SET) == 0) {
+    unsigned char head[16];
+    if (fread(head, 1, 16, fp) == 16 &&
+        chunkedfile_get_uint32(head) == SoChunkedFileP::FORMATVERSION) {
+      const uint32_t numchunks = chunkedfile_get_uint32(head + 4);
+      toc.skeletonsize = chunkedfile_get_uint64(head + 8);
+      const size_t size = (size_t) numchunks * 20;
+      buf = (unsigned char *) malloc(size > 0 ? size : 1);
+      if (buf && fread(buf, 1, size, fp) == size) {
+        for (uint32_t i = 0; i < numchunks; i++) {
+          Chunk c;
+          c.offset = chunkedfile_get_uint64(buf + i * 20);
+          c.size = chunkedfile_get_uint64(buf + i * 20 + 8);
+          c.flags = chunkedfile_get_uint32(buf + i * 20 + 16);
+          toc.chunks.append(c);
+        }
+        ok = TRUE;
+      }
+    }
+  }
+  free(buf);
+  (void) SoChunkedFileP::seek(fp, pos, SEEK_SET);
+  return ok;
+}
+
+// Returns the cached table of contents for filename, reading it from
+// the file if necessary. Must be called with the mutex locked.
+static const SoChunkedFileP::TableOfContents *
+chunkedfile_get_toc(const SbString & filename)
+{
+  SoChunkedFileP::TableOfContents * toc = NULL;
+  if (chunkedfile_tocmap->get(filename, toc)) return toc;
+
+  FILE * fp = fopen(filename.getString(), "rb");
+  if (fp == NULL) return NULL;
+
+  toc = new SoChunkedFileP::TableOfContents;
+  if (!SoChunkedFileP::hasHeader(fp) ||
+      !SoChunkedFileP::readTableOfContents(fp, *toc)) {
+    delete toc;
+    toc = NULL;
+  }
+  fclose(fp);
+  if (toc) chunkedfile_tocmap->put(filename, toc);
+  return toc;
+}
+
+SbBool
+SoChunkedFileP::getChunk(const SbString & filename, int idx, Chunk & chunk)
+{
+  SbBool ok = FALSE;
+  CC_MUTEX_LOCK(chunkedfile_mutex);
+  const TableOfContents * toc = chunkedfile_get_toc(filename);
+  if (toc && idx >= 0 && idx < toc->chunks.getLength()) {
+    chunk = toc->chunks[idx];
+    ok = TRUE;
+  }
+  CC_MUTEX_UNLOCK(chunkedfile_mutex);
+  return ok;
+}
+
+int
+SoChunkedFileP::getNumChunks(const SbString & filename)
+{
+  CC_MUTEX_LOCK(chunkedfile_mutex);
+  const TableOfContents * toc = chunkedfile_get_toc(filename);
+  const int num = toc ? toc->chunks.getLength() : -1;
+  CC_MUTEX_UNLOCK(chunkedfile_mutex);
+  return num;
+}
+
+void
+SoChunkedFileP::invalidate(const SbString & filename)
+{
+  CC_MUTEX_LOCK(chunkedfile_mutex);
+  TableOfContents * toc = NULL;
+  if (chunkedfile_tocmap->get(filename, toc)) {
+    delete toc;
+    (void) chunkedfile_tocmap->erase(filename);
+  }
+  CC_MUTEX_UNLOCK(chunkedfile_mutex);
+}
+
+// Reads the raw (possibly compressed) data of chunk idx into a buffer
+// allocated with malloc(). Does not touch any scene graph data, and
+// can be called from any thread.
+void *
+SoChunkedFileP::readChunkData(const SbString & filename, int idx, size_t & size)
+{
+  SoChunkedFileP::Chunk info;
+  if (!SoChunkedFileP::getChunk(filename, idx, info)) return NULL;
+
+  FILE * fp = fopen(filename.getString(), "rb");
+  if (fp == NULL) return NULL;
+
+  size = (size_t) info.size;
+  void * buffer = malloc(size > 0 ? size : 1);
+  const SbBool ok = buffer &&
+    SoChunkedFileP::seek(fp, info.offset, SEEK_SET) == 0 &&
+    fread(buffer, 1, size, fp) == size;
+  fclose(fp);
+
+  if (!ok) {
+    free(buffer);
+    return NULL;
+  }
+  return buffer;
+}
+
+// *************************************************************************
+
+namespace {
+
+struct ChunkedFileChunk {
+  SoNode * node;
+  SoFullPath * path;
+};
+
+struct ChunkedFileWriter {
+  ChunkedFileWriter(int chunksizearg) : chunksize(chunksizearg) { }
+
+  int chunksize;
+  SbHash<const SoNode *, int> parentcount;
+  SbHash<const SoNode *, SbBool> visited;
+  SbList<ChunkedFileChunk> chunks;
+
+  void countParents(SoNode * node);
+  SbBool isSelfContained(SoNode * node, int & weight) const;
+  SbBool findChunks(SoFullPath * path);
+};
+
+} // anonymous namespace
+
+// Only plain separators can be replaced by an SoLazySeparator.
+// Subclasses and VRML grouping nodes have fields and traversal
+// behaviour an SoLazySeparator doesn't have.
+static SbBool
+chunkedfile_is_candidate(const SoNode * node)
+{
+  return node->getTypeId() == SoSeparator::getClassTypeId();
+}
+
+// Only traverse into groups. Node kits and other nodes with hidden
+// children must be written as a whole.
+static SbBool
+chunkedfile_traverse_children(const SoNode * node)
+{
+  return node->isOfType(SoGroup::getClassTypeId()) &&
+    !node->isOfType(SoBaseKit::getClassTypeId());
+}
+
+void
+ChunkedFileWriter::countParents(SoNode * node)
+{
+  SoChildList * children = node->getChildren();
+  if (children == NULL) return;
+
+  for (int i = 0; i < children->getLength(); i++) {
+    SoNode * child = (*children)[i];
+    int count = 0;
+    const SbBool seen = this->parentcount.get(child, count);
+    this->parentcount.put(child, count + 1);
+    if (!seen) this->countParents(child);
+  }
+}
+
+// Returns TRUE if no node below node is referenced from outside of
+// the subgraph, and no fields in the subgraph are connected. The
+// weight (number of nodes and multiple-value field values) of the
+// subgraph is returned in weight.
+SbBool
+ChunkedFileWriter::isSelfContained(SoNode * node, int & weight) const
+{
+  SbHash<const SoNode *, int> localcount;
+  SbList<SoNode *> stack;
+  SoFieldList fields;
+  SoFieldList connections;
+
+  weight = 0;
+  stack.append(node);
+  while (stack.getLength()) {
+    SoNode * n = stack.pop();
+    weight++;
+
+    fields.truncate(0);
+    const int numfields = n->getFields(fields);
+    for (int i = 0; i < numfields; i++) {
+      SoField * f = fields[i];
+      if (f->isConnected()) return FALSE;
+      connections.truncate(0);
+      if (f->getForwardConnections(connections) > 0) return FALSE;
+      if (f->isOfType(SoMField::getClassTypeId())) {
+        weight += ((SoMField *) f)->getNum();
+      }
+    }
+
+    SoChildList * children = n->getChildren();
+    if (children == NULL) continue;
+    for (int i = 0; i < children->getLength(); i++) {
+      SoNode * child = (*children)[i];
+      int count = 0;
+      const SbBool seen = localcount.get(child, count);
+      localcount.put(child, count + 1);
+      if (!seen) stack.append(child);
+    }
+  }
+
+  for (SbHash<const SoNode *, int>::const_iterator it = localcount.const_begin();
+       it != localcount.const_end(); ++it) {
+    int count = 0;
+    (void) this->parentcount.get(it->key, count);
+    if (count != it->obj) return FALSE;
+  }
+  return TRUE;
+}
+
+// Finds the subgraphs to store as chunks. A candidate is made a chunk
+// if it is small enough, or if none of its children could be made a
+// chunk. Returns TRUE if at least one chunk was found in the subgraph.
+SbBool
+ChunkedFileWriter::findChunks(SoFullPath * path)
+{
+  SoNode * node = path->getTail();
+  SbBool found = FALSE;
+  if (this->visited.get(node, found)) return found;
+
+  SbBool candidate = FALSE;
+  int weight = 0;
+  if (path->getLength() > 1 &&
+      chunkedfile_is_candidate(node) &&
+      path->getNodeFromTail(1)->isOfType(SoGroup::getClassTypeId())) {
+    int count = 0;
+    (void) this->parentcount.get(node, count);
+    candidate = (count == 1) && this->isSelfContained(node, weight);
+  }
+
+  if (!candidate || weight > this->chunksize) {
+    if (node->isOfType(SoLazySeparator::getClassTypeId()) &&
+        !((SoLazySeparator *) node)->isLoaded()) {
+      // chunks of a file being converted again
+      if (((SoLazySeparator *) node)->load()) this->countParents(node);
+    }
+    if (chunkedfile_traverse_children(node)) {
+      SoChildList * children = node->getChildren();
+      for (int i = 0; i < children->getLength(); i++) {
+        path->append(i);
+        if (this->findChunks(path)) found = TRUE;
+        path->pop();
+      }
+    }
+  }
+
+  if (candidate && !found) {
+    ChunkedFileChunk c;
+    c.node = node;
+    c.path = (SoFullPath *) path->copy();
+    c.path->ref();
+    this->chunks.append(c);
+    found = TRUE;
+  }
+  this->visited.put(node, found);
+  return found;
+}
+
+// Writes node as a binary Inventor stream to a newly allocated memory
+// buffer.
+static SbBool
+chunkedfile_write_buffer(SoNode * node, const char * header,
+                         void *& buffer, size_t & size)
+{
+  SoOutput out;
+  out.setBinary(TRUE);
+  if (header) out.setHeaderString(header);
+  out.setBuffer(malloc(65536), 65536, realloc);
+
+  SoWriteAction wa(&out);
+  wa.apply(node);
+
+  if (!out.getBuffer(buffer, size)) {
+    free(buffer);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static SbBool
+chunkedfile_fwrite(FILE * fp, const void * buffer, size_t size)
+{
+  return fwrite(buffer, 1, size, fp) == size;
+}
+
+// *************************************************************************
+
+/*!
+  Writes the scene graph \a root to \a filename as a chunked file.
+
+  SoSeparator nodes (but not nodes of its subclasses or VRML grouping
+  nodes) whose subgraphs are self-contained (no nodes inside are
+  referenced from outside the subgraph, and no fields inside are
+  connected) are stored as separate chunks. The \a chunksize argument
+  is the approximate maximum number of nodes and multiple-value field
+  values stored in a chunk; larger subgraphs are split at their
+  child separators if possible.
+
+  If \a compress is \c TRUE and zlib is available, each chunk is
+  stored gzip compressed.
+
+  The scene graph is temporarily modified while it is written, so it
+  must not be traversed from other threads during the call.
+
+  Returns \c FALSE if the file could not be written.
+*/
+SbBool
+SoChunkedFile::write(SoNode * root, const char * filename,
+                     SbBool compress, int chunksize)
+{
+  if (root == NULL || filename == NULL) return FALSE;
+
+  FILE * fp = fopen(filename, "wb");
+  if (fp == NULL) {
+    SoDebugError::postWarning("SoChunkedFile::write",
+                              "Couldn't open file '%s' for writing.",
+                              filename);
+    return FALSE;
+  }
+
+  root->ref();
+
+  ChunkedFileWriter writer(chunksize);
+  writer.countParents(root);
+  SoFullPath * path = (SoFullPath *) new SoPath(root);
+  path->ref();
+  (void) writer.findChunks(path);
+  path->unref();
+
+  const int numchunks = writer.chunks.getLength();
+  SbList<SoLazySeparator *> lazylist;
+
+  // replace the chunks with lazy separators holding their bounding
+  // boxes
+  SoGetBoundingBoxAction bba(SbViewportRegion(640, 480));
+  for (int i = 0; i < numchunks; i++) {
+    ChunkedFileChunk & c = writer.chunks[i];
+    bba.setResetPath(c.path, TRUE, SoGetBoundingBoxAction::ALL);
+    bba.apply(c.path);
+
+    SoLazySeparator * lazy = new SoLazySeparator;
+    lazy->ref();
+    lazy->chunk = i;
+    lazy->boundingBox = bba.getBoundingBox();
+    lazylist.append(lazy);
+  }
+  for (int i = 0; i < numchunks; i++) {
+    ChunkedFileChunk & c = writer.chunks[i];
+    c.node->ref();
+    SoGroup * parent = (SoGroup *) c.path->getNodeFromTail(1);
+    parent->replaceChild(c.path->getIndexFromTail(0), lazylist[i]);
+  }
+
+  SbBool ok = TRUE;
+  void * buffer = NULL;
+  size_t size = 0;
+
+  ok = chunkedfile_write_buffer(root, SoChunkedFileP::HEADER, buffer, size) &&
+    chunkedfile_fwrite(fp, buffer, size);
+  const uint64_t skeletonsize = size;
+  free(buffer);
+
+  // restore the scene graph
+  for (int i = numchunks - 1; i >= 0; i--) {
+    ChunkedFileChunk & c = writer.chunks[i];
+    SoGroup * parent = (SoGroup *) c.path->getNodeFromTail(1);
+    parent->replaceChild(c.path->getIndexFromTail(0), c.node);
+    c.node->unrefNoDelete();
+    lazylist[i]->unref();
+  }
+
+  SbList<SoChunkedFileP::Chunk> toc;
+  for (int i = 0; ok && i < numchunks; i++) {
+    ChunkedFileChunk & c = writer.chunks[i];
+    SoChunkedFileP::Chunk entry;
+    entry.offset = SoChunkedFileP::tell(fp);
+    entry.flags = 0;
+
+    ok = chunkedfile_write_buffer(c.node, NULL, buffer, size);
+    if (!ok) break;
+
+    uint8_t * compressed = NULL;
+    uint32_t compressedsize = 0;
+    if (compress && size < 0xffffffff &&
+        cc_gzm_compress((const uint8_t *) buffer, (uint32_t) size, -1,
+                        &compressed, &compressedsize) == 0 &&
+        compressedsize < size) {
+      entry.flags |= SoChunkedFileP::GZIP;
+      entry.size = compressedsize;
+      ok = chunkedfile_fwrite(fp, compressed, compressedsize);
+    }
+    else {
+      entry.size = size;
+      ok = chunkedfile_fwrite(fp, buffer, size);
+    }
+    free(compressed);
+    free(buffer);
+    toc.append(entry);
+  }
+
+  for (int i = 0; i < numchunks; i++) {
+    writer.chunks[i].path->unref();
+  }
+  root->unrefNoDelete();
+
+  if (ok) {
+    const uint64_t tocoffset = SoChunkedFileP::tell(fp);
+    unsigned char head[16];
+    chunkedfile_put_uint32(head, SoChunkedFileP::FORMATVERSION);
+    chunkedfile_put_uint32(head + 4, (uint32_t) numchunks);
+    chunkedfile_put_uint64(head + 8, skeletonsize);
+    ok = chunkedfile_fwrite(fp, head, 16);
+
+    for (int i = 0; ok && i < numchunks; i++) {
+      unsigned char entry[20];
+      chunkedfile_put_uint64(entry, toc[i].offset);
+      chunkedfile_put_uint64(entry + 8, toc[i].size);
+      chunkedfile_put_uint32(entry + 16, toc[i].flags);
+      ok = chunkedfile_fwrite(fp, entry, 20);
+    }
+
+    unsigned char trailer[16];
+    chunkedfile_put_uint64(trailer, tocoffset);
+    memcpy(trailer + 8, SoChunkedFileP::MAGIC, 8);
+    ok = ok && chunkedfile_fwrite(fp, trailer, 16);
+  }
+
+  if (fclose(fp) != 0) ok = FALSE;
+  SoChunkedFileP::invalidate(SbString(filename));
+
+  if (!ok) {
+    SoDebugError::postWarning("SoChunkedFile::write",
+                              "Error while writing '%s'.", filename);
+  }
+  return ok;
+}
+
+/*!
+  Returns \c TRUE if \a filename is a chunked file.
+*/
+SbBool
+SoChunkedFile::isChunkedFile(const char * filename)
+{
+  return SoChunkedFile::getNumChunks(filename) >= 0;
+}
+
+/*!
+  Returns the number of chunks in \a filename, or -1 if \a filename
+  is not a chunked file.
+*/
+int
+SoChunkedFile::getNumChunks(const char * filename)
+{
+  return SoChunkedFileP::getNumChunks(SbString(filename));
+}
+
+/*!
+  Reads chunk number \a chunk from \a filename. The returned node has
+  a reference count of zero. Returns \c NULL on errors.
+
+  This function is used by SoLazySeparator to load its children, and
+  only needs to be called directly by applications doing their own
+  paging of chunks.
+*/
+SoNode *
+SoChunkedFile::readChunk(const char * filename, int chunk)
+{
+  size_t size;
+  void * buffer = SoChunkedFileP::readChunkData(SbString(filename), chunk, size);
+  if (buffer == NULL) return NULL;
+
+  // gzip compressed chunks are detected and decompressed by SoInput
+  SoNode * node = NULL;
+  SoInput in;
+  in.setBuffer(buffer, size);
+  if (!SoDB::read(&in, node)) node = NULL;
+  free(buffer);
+  return node;
+}
+
+/*!
+  Returns the file header string of chunked files.
+*/
+const char *
+SoChunkedFile::getHeaderString(void)
+{
+  return SoChunkedFileP::HEADER;
+}
+
+#ifdef COIN_TEST_SUITE
+
+#include <cstdio>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoChunkedFile.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/VRMLnodes/SoVRMLGroup.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoLazySeparator.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+BOOST_AUTO_TEST_CASE(writeAndReadLazily)
+{
+  static const char filename[] = "SoChunkedFile_test.iv";
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoSeparator * sep = new SoSeparator;
+  sep->addChild(new SoCube);
+  root->addChild(sep);
+  sep = new SoSeparator;
+  SoTranslation * translation = new SoTranslation;
+  translation->translation = SbVec3f(10.0f, 0.0f, 0.0f);
+  sep->addChild(translation);
+  sep->addChild(new SoSphere);
+  root->addChild(sep);
+
+  SoGetBoundingBoxAction bba(SbViewportRegion(100, 100));
+  bba.apply(root);
+  const SbBox3f box = bba.getBoundingBox();
+
+  BOOST_REQUIRE(SoChunkedFile::write(root, filename, TRUE, 1));
+  BOOST_CHECK_MESSAGE(root->getNumChildren() == 2 &&
+                      root->getChild(1) == sep,
+                      "scene graph not restored after writing");
+  root->unref();
+
+  BOOST_CHECK_EQUAL(SoChunkedFile::getNumChunks(filename), 2);
+
+  SoInput in;
+  BOOST_REQUIRE(in.openFile(filename));
+  SoSeparator * result = SoDB::readAll(&in);
+  BOOST_REQUIRE(result != NULL);
+  result->ref();
+  in.closeFile();
+
+  SoSearchAction sa;
+  sa.setType(SoLazySeparator::getClassTypeId());
+  sa.setInterest(SoSearchAction::ALL);
+  sa.apply(result);
+  BOOST_CHECK_EQUAL(sa.getPaths().getLength(), 2);
+
+  bba.apply(result);
+  BOOST_CHECK_MESSAGE(bba.getBoundingBox().getMin().equals(box.getMin(), 1e-5f) &&
+                      bba.getBoundingBox().getMax().equals(box.getMax(), 1e-5f),
+                      "stored bounding boxes do not match the scene");
+
+  for (int i = 0; i < sa.getPaths().getLength(); i++) {
+    SoLazySeparator * lazy = (SoLazySeparator *) sa.getPaths()[i]->getTail();
+    BOOST_CHECK(!lazy->isLoaded());
+    BOOST_CHECK(lazy->load());
+    BOOST_REQUIRE_EQUAL(lazy->getNumChildren(), 1);
+    BOOST_CHECK(lazy->getChild(0)->isOfType(SoSeparator::getClassTypeId()));
+  }
+  sa.reset();
+
+  result->unref();
+  (void) remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(onlySeparatorsAreChunks)
+{
+  static const char filename[] = "SoChunkedFile_test.iv";
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoVRMLGroup * group = new SoVRMLGroup;
+  group->addChild(new SoCube);
+  root->addChild(group);
+  SoSeparator * sep = new SoSeparator;
+  sep->addChild(new SoSphere);
+  root->addChild(sep);
+
+  BOOST_REQUIRE(SoChunkedFile::write(root, filename, FALSE, 1));
+  root->unref();
+  BOOST_CHECK_EQUAL(SoChunkedFile::getNumChunks(filename), 1);
+  (void) remove(filename);
+}
+
+#endif // COIN_TEST_SUITE
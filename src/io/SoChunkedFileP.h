@@ -0,0 +1,104 @@
+#ifndef COIN_SOCHUNKEDFILEP_H
+#define COIN_SOCHUNKEDFILEP_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+// *************************************************************************
+
+#include <cstdio>
+
+#include <Inventor/SbString.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/system/inttypes.h>
+
+// *************************************************************************
+
+// Layout of a chunked file (all integers are stored in network byte
+// order):
+//
+//   skeleton   binary Inventor stream starting with HEADER, where each
+//              chunked subgraph is replaced by an SoLazySeparator
+//   chunks     one binary Inventor stream per chunk, optionally gzip
+//              compressed
+//   toc        uint32 version, uint32 numchunks, uint64 skeletonsize,
+//              and for each chunk: uint64 offset, uint64 size,
+//              uint32 flags
+//   trailer    uint64 toc offset, followed by the 8 byte MAGIC string
+//
+// The skeleton is first in the file so that the registered header is
+// found by SoInput. The reader created in SoInput_Reader::createReader()
+// stops at the end of the skeleton.
+
+class SoChunkedFileP {
+public:
+  enum ChunkFlags {
+    GZIP = 0x1
+  };
+
+  struct Chunk {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t flags;
+  };
+
+  struct TableOfContents {
+    uint64_t skeletonsize;
+    SbList<Chunk> chunks;
+  };
+
+  static const char HEADER[];
+  static const char MAGIC[];
+  static const uint32_t FORMATVERSION;
+  static const int TRAILERSIZE;
+
+  static void initClass(void);
+
+  static SbBool hasHeader(FILE * fp);
+  static SbBool readTableOfContents(FILE * fp, TableOfContents & toc);
+
+  static SbBool getChunk(const SbString & filename, int idx, Chunk & chunk);
+  static int getNumChunks(const SbString & filename);
+  static void invalidate(const SbString & filename);
+  static void * readChunkData(const SbString & filename, int idx, size_t & size);
+
+  static int seek(FILE * fp, int64_t offset, int whence);
+  static uint64_t tell(FILE * fp);
+};
+
+// *************************************************************************
+
+#endif // !COIN_SOCHUNKEDFILEP_H
@@ -53,6 +53,7 @@
 #include <Inventor/errors/SoDebugError.h>
 
 #include "io/gzmemio.h"
+#include "io/SoChunkedFileP.h"
 #include "glue/zlib.h"
 #include "glue/bzip2.h"
 
@@ -142,6 +143,17 @@ SoInput_Reader::createReader(FILE * fp, const SbString & fullname)
         }
       }
     }
+    if ((reader == NULL) && valid_header && (header[0] == '#') &&
+        SoChunkedFileP::hasHeader(fp)) {
+      SoChunkedFileP::TableOfContents toc;
+      if (SoChunkedFileP::readTableOfContents(fp, toc)) {
+        const uint64_t start = SoChunkedFileP::tell(fp);
+        if (toc.skeletonsize >= start) {
+          reader = new SoInput_ChunkedFileReader(fullname.getString(), fp,
+                                                 (size_t) (toc.skeletonsize - start));
+        }
+      }
+    }
     if ((reader == NULL) && valid_header &&
         (header[0] == 0x1f) &&
         (header[1] == 0x8b)) {
@@ -236,6 +248,36 @@ SoInput_FileReader::getFilePointer(void)
   return this->fp;
 }
 
+//
+// chunked file class
+//
+
+SoInput_ChunkedFileReader::SoInput_ChunkedFileReader(const char * const filenamearg,
+                                                     FILE * filepointer,
+                                                     size_t skeletonsize)
+  : SoInput_FileReader(filenamearg, filepointer)
+{
+  this->remaining = skeletonsize;
+}
+
+SoInput_Reader::ReaderType
+SoInput_ChunkedFileReader::getType(void) const
+{
+  return CHUNKEDFILE;
+}
+
+size_t
+SoInput_ChunkedFileReader::readBuffer(char * buf, const size_t readlen)
+{
+  // the chunks and the table of contents after the skeleton are read
+  // by SoChunkedFile::readChunk()
+  const size_t len = readlen < this->remaining ? readlen : this->remaining;
+  if (len == 0) return 0;
+  const size_t num = fread(buf, 1, len, this->fp);
+  this->remaining -= num;
+  return num;
+}
+
 //
 // standard membuffer class
 //
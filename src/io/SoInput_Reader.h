@@ -55,7 +55,8 @@ public:
     MEMBUFFER,
     GZFILE,
     BZ2FILE,
-    GZMEMBUFFER
+    GZMEMBUFFER,
+    CHUNKEDFILE
   };
 
   // must be overloaded to return type
@@ -96,6 +97,18 @@ public:
 
 };
 
+// Reads only the skeleton part of a chunked file (see SoChunkedFile).
+class SoInput_ChunkedFileReader : public SoInput_FileReader {
+public:
+  SoInput_ChunkedFileReader(const char * const filename, FILE * filepointer,
+                            size_t skeletonsize);
+
+  virtual ReaderType getType(void) const;
+  virtual size_t readBuffer(char * buf, const size_t readlen);
+
+  size_t remaining;
+};
+
 class SoInput_MemBufferReader : public SoInput_Reader {
 public:
   SoInput_MemBufferReader(const void * bufPointer, size_t bufSize);
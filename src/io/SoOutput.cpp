@@ -87,6 +87,7 @@
 
 #include <Inventor/C/tidbits.h>
 #include <Inventor/errors/SoDebugError.h>
+#include <Inventor/SbBasic.h>
 #include <Inventor/SbName.h>
 #include <Inventor/SbString.h>
 #include <Inventor/lists/SbList.h>
@@ -177,7 +178,7 @@ public:
     this->writer = NULL;
   }
   ~SoOutputP() {
-    delete this->writer;
+    this->setWriter(NULL, "SoOutput::~SoOutput");
   }
 
   SbBool binarystream;
@@ -259,10 +260,45 @@ public:
     }
     return this->writer;
   }
-  void setWriter(SoOutput_Writer * writerptr) {
+  // caller is the SoOutput method that replaces the writer, and is
+  // used in the warning if the old writer fails
+  void setWriter(SoOutput_Writer * writerptr, const char * caller) {
+    // the threaded writers may fail on data handed over long ago,
+    // after the last write call returned
+    if (this->writer && !this->writer->flush() && !this->disabledwriting) {
+      SoDebugError::postWarning(caller, "Couldn't write to file");
+    }
     delete this->writer;
     this->writer = writerptr;
   }
+
+  // Returns TRUE if the next binary write starts on a word boundary,
+  // i.e. if SoOutput::writeBytesWithPadding() would not pad a 4- or
+  // 8-byte value.
+  SbBool isWordAligned(void) {
+    size_t writeposition = this->getWriter()->bytesInBuf();
+    if (this->getWriter()->getType() == SoOutput_Writer::MEMBUFFER) {
+      writeposition -= ((SoOutput_MemBufferWriter*)this->getWriter())->startoffset;
+    }
+    return (writeposition % HOSTWORDSIZE) == 0;
+  }
+
+  // Writes num values of valsize (4 or 8) bytes in network byte
+  // order, converting through a stack buffer so we only make one
+  // writeBinaryArray() call per chunk instead of one per value.
+  static void writeNetworkOrder(SoOutput * out, const void * values,
+                                const int num, const size_t valsize) {
+    unsigned char buf[8192];
+    const int chunk = (int)(sizeof(buf) / valsize);
+    const unsigned char * src = (const unsigned char *)values;
+    for (int i = 0; i < num; i += chunk) {
+      const int n = SbMin(chunk, num - i);
+      if (valsize == sizeof(uint32_t)) { coin_hton_uint32_array(src, buf, n); }
+      else { coin_hton_uint64_array(src, buf, n); }
+      out->writeBinaryArray(buf, (int)(n * valsize));
+      src += n * valsize;
+    }
+  }
 private:
   SoOutput_Writer * writer;
 
@@ -379,7 +415,8 @@ SoOutput::setFilePointer(FILE * newFP)
   this->reset();
   PRIVATE(this)->setWriter(SoOutput_Writer::createWriter(newFP, FALSE,
                                                          PRIVATE(this)->compmethod,
-                                                         PRIVATE(this)->complevel));
+                                                         PRIVATE(this)->complevel),
+                           "SoOutput::setFilePointer");
 }
 
 /*!
@@ -418,7 +455,8 @@ SoOutput::openFile(const char * const fileName)
   if (newfile) {
     PRIVATE(this)->setWriter(SoOutput_Writer::createWriter(newfile, TRUE,
                                                            PRIVATE(this)->compmethod,
-                                                           PRIVATE(this)->complevel));
+                                                           PRIVATE(this)->complevel),
+                             "SoOutput::openFile");
     PRIVATE(this)->usercalledopenfile = TRUE;
   }
   else {
@@ -439,7 +477,7 @@ void
 SoOutput::closeFile(void)
 {
   if (PRIVATE(this)->usercalledopenfile) {
-    PRIVATE(this)->setWriter(NULL);
+    PRIVATE(this)->setWriter(NULL, "SoOutput::closeFile");
     PRIVATE(this)->usercalledopenfile = FALSE;
   }
 }
@@ -588,7 +626,8 @@ SoOutput::setBuffer(void * bufPointer, size_t initSize,
   this->reset();
   assert(initSize > 0 && "invalid argument");
   PRIVATE(this)->setWriter(new SoOutput_MemBufferWriter(bufPointer, initSize,
-                                                        reallocFunc, offset));
+                                                        reallocFunc, offset),
+                           "SoOutput::setBuffer");
 }
 
 /*!
@@ -1051,13 +1090,19 @@ SoOutput::writeBinaryArray(const unsigned char * constc, const int length)
 void
 SoOutput::writeBinaryArray(const int32_t * const l, const int length)
 {
-  // Slooooow. We can do much better by using convertInt32Array().
+  if (PRIVATE(this)->disabledwriting) return;
 
-  char val[sizeof(int32_t)];
-  for (int i=0; i < length; i++) {
+  // Binary output is always word aligned in practice, since the
+  // header is padded. If it is not, write single values (which pads
+  // after the first one) until it is, so the output is identical to
+  // what writing the values one by one would give.
+  int i = 0;
+  for (; (i < length) && !PRIVATE(this)->isWordAligned(); i++) {
+    char val[sizeof(int32_t)];
     this->convertInt32(l[i], val);
     this->writeBytesWithPadding(val, sizeof(int32_t));
   }
+  SoOutputP::writeNetworkOrder(this, l + i, length - i, sizeof(int32_t));
 }
 
 /*!
@@ -1066,13 +1111,19 @@ SoOutput::writeBinaryArray(const int32_t * const l, const int length)
 void
 SoOutput::writeBinaryArray(const float * const f, const int length)
 {
-  // Slooooow. We can do much better by using convertFloatArray().
+  if (PRIVATE(this)->disabledwriting) return;
 
-  char val[sizeof(float)];
-  for (int i=0; i < length; i++) {
+  // Binary output is always word aligned in practice, since the
+  // header is padded. If it is not, write single values (which pads
+  // after the first one) until it is, so the output is identical to
+  // what writing the values one by one would give.
+  int i = 0;
+  for (; (i < length) && !PRIVATE(this)->isWordAligned(); i++) {
+    char val[sizeof(float)];
     this->convertFloat(f[i], val);
     this->writeBytesWithPadding(val, sizeof(float));
   }
+  SoOutputP::writeNetworkOrder(this, f + i, length - i, sizeof(float));
 }
 
 /*!
@@ -1081,13 +1132,19 @@ SoOutput::writeBinaryArray(const float * const f, const int length)
 void
 SoOutput::writeBinaryArray(const double * const d, const int length)
 {
-  // Slooooow. We can do much better by using convertDoubleArray().
+  if (PRIVATE(this)->disabledwriting) return;
 
-  char val[sizeof(double)];
-  for (int i=0; i < length; i++) {
+  // Binary output is always word aligned in practice, since the
+  // header is padded. If it is not, write single values (which pads
+  // after the first one) until it is, so the output is identical to
+  // what writing the values one by one would give.
+  int i = 0;
+  for (; (i < length) && !PRIVATE(this)->isWordAligned(); i++) {
+    char val[sizeof(double)];
     this->convertDouble(d[i], val);
     this->writeBytesWithPadding(val, sizeof(double));
   }
+  SoOutputP::writeNetworkOrder(this, d + i, length - i, sizeof(double));
 }
 
 /*!
@@ -1645,10 +1702,7 @@ SoOutput::convertShortArray(short * from, char * to, int len)
 void
 SoOutput::convertInt32Array(int32_t * from, char * to, int len)
 {
-  for (int i=0; i < len; i++) {
-    this->convertInt32(*from++, to);
-    to += sizeof(int32_t);
-  }
+  coin_hton_uint32_array(from, to, len);
 }
 
 /*!
@@ -1659,10 +1713,7 @@ SoOutput::convertInt32Array(int32_t * from, char * to, int len)
 void
 SoOutput::convertFloatArray(float * from, char * to, int len)
 {
-  for (int i=0; i < len; i++) {
-    this->convertFloat(*from++, to);
-    to += sizeof(float);
-  }
+  coin_hton_uint32_array(from, to, len);
 }
 
 /*!
@@ -1673,10 +1724,7 @@ SoOutput::convertFloatArray(float * from, char * to, int len)
 void
 SoOutput::convertDoubleArray(double * from, char * to, int len)
 {
-  for (int i=0; i < len; i++) {
-    this->convertDouble(*from++, to);
-    to += sizeof(double);
-  }
+  coin_hton_uint64_array(from, to, len);
 }
 
 /*!
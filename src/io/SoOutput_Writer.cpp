@@ -34,6 +34,7 @@
 #include "coindefs.h"
 
 #include <cstring>
+#include <cstdlib>
 #include <cassert>
 
 #ifdef HAVE_CONFIG_H
@@ -49,10 +50,15 @@
 #endif // HAVE_IO_H
 
 #include <Inventor/errors/SoDebugError.h>
+#include <Inventor/SbBasic.h>
 #include <Inventor/SbName.h>
+#include <Inventor/C/threads/thread.h>
+#include <Inventor/C/threads/fifo.h>
+#include <Inventor/C/threads/mutex.h>
 
 #include "glue/zlib.h"
 #include "glue/bzip2.h"
+#include "tidbitsp.h"
 
 // We don't want to include bzlib.h, so we just define the constants
 // we use here
@@ -83,6 +89,12 @@ SoOutput_Writer::getFilePointer(void)
   return NULL;
 }
 
+SbBool
+SoOutput_Writer::flush(void)
+{
+  return TRUE;
+}
+
 
 SoOutput_Writer * 
 SoOutput_Writer::createWriter(FILE * fp, 
@@ -92,14 +104,22 @@ SoOutput_Writer::createWriter(FILE * fp,
 {
   if (compmethod == "GZIP") {
     if (cc_zlibglue_available()) {
-      return new SoOutput_GZFileWriter(fp, shouldclose, level);
+      SoOutput_Writer * writer = new SoOutput_GZFileWriter(fp, shouldclose, level);
+      if (SoOutput_ThreadedWriter::isEnabled()) {
+        writer = new SoOutput_ThreadedWriter(writer);
+      }
+      return writer;
     }
     SoDebugError::postWarning("SoOutput_Writer::createWriter",
                               "Requested zlib compression, but zlib is not available.");
   }
   if (compmethod == "BZIP2") {
     if (cc_bzglue_available()) {
-      return new SoOutput_BZ2FileWriter(fp, shouldclose, level);
+      SoOutput_Writer * writer = new SoOutput_BZ2FileWriter(fp, shouldclose, level);
+      if (SoOutput_ThreadedWriter::isEnabled()) {
+        writer = new SoOutput_ThreadedWriter(writer);
+      }
+      return writer;
     }
     SoDebugError::postWarning("SoOutput_Writer::createWriter",
                               "Requested bzip2 compression, but libz2 is not available.");
@@ -355,5 +375,245 @@ SoOutput_BZ2FileWriter::bytesInBuf(void)
   return this->writecounter;
 }
 
+//
+// threaded writer
+//
+
+// Size of the blocks handed over to the compression thread, and the
+// number of blocks in circulation (one being filled, the rest queued
+// for or being compressed).
+static const size_t SOOUTPUT_THREADED_BLOCKSIZE = 256 * 1024;
+static const int SOOUTPUT_THREADED_NUMBLOCKS = 4;
+
+struct SoOutput_ThreadedWriter::Block {
+  char * data;
+  size_t len;
+  SbBool binary;
+};
+
+// The compression thread is used by default when Coin is built with
+// thread support. Set the environment variable
+// COIN_SOOUTPUT_COMPRESSION_THREAD to "0" to compress on the calling
+// thread instead.
+SbBool
+SoOutput_ThreadedWriter::isEnabled(void)
+{
+#ifdef HAVE_THREADS
+  static int enabled = -1;
+  if (enabled == -1) {
+    const char * env = coin_getenv("COIN_SOOUTPUT_COMPRESSION_THREAD");
+    enabled = (env && (atoi(env) == 0)) ? 0 : 1;
+  }
+  return enabled ? TRUE : FALSE;
+#else // !HAVE_THREADS
+  return FALSE;
+#endif // !HAVE_THREADS
+}
+
+SoOutput_ThreadedWriter::SoOutput_ThreadedWriter(SoOutput_Writer * writerarg)
+{
+  this->writer = writerarg;
+  this->writecounter = 0;
+  this->mutex = cc_mutex_construct();
+  this->failed = FALSE;
+  this->pending = cc_fifo_new();
+  this->available = cc_fifo_new();
+
+  for (int i = 0; i < SOOUTPUT_THREADED_NUMBLOCKS; i++) {
+    Block * block = new Block;
+    block->data = new char[SOOUTPUT_THREADED_BLOCKSIZE];
+    block->len = 0;
+    block->binary = FALSE;
+    cc_fifo_assign(this->available, block, 0);
+  }
+  void * ptr;
+  cc_fifo_retrieve(this->available, &ptr, NULL);
+  this->current = static_cast<Block *>(ptr);
+
+  this->thread = cc_thread_construct(SoOutput_ThreadedWriter::threadEntry, this);
+}
+
+SoOutput_ThreadedWriter::~SoOutput_ThreadedWriter()
+{
+  // the owner is expected to have called flush() to find out whether
+  // the last blocks were written
+  if (this->current->len) {
+    this->submit();
+  }
+  cc_fifo_assign(this->available, this->current, 0);
+  this->current = NULL;
+
+  // a NULL block tells the thread to finish up
+  cc_fifo_assign(this->pending, NULL, 0);
+  cc_thread_join(this->thread, NULL);
+  cc_thread_destruct(this->thread);
+
+  void * ptr;
+  while (cc_fifo_try_retrieve(this->available, &ptr, NULL)) {
+    Block * block = static_cast<Block *>(ptr);
+    delete[] block->data;
+    delete block;
+  }
+  cc_fifo_delete(this->pending);
+  cc_fifo_delete(this->available);
+  cc_mutex_destruct(this->mutex);
+
+  // closes the file
+  delete this->writer;
+}
+
+void *
+SoOutput_ThreadedWriter::threadEntry(void * closure)
+{
+  SoOutput_ThreadedWriter * thisp = static_cast<SoOutput_ThreadedWriter *>(closure);
+  for (;;) {
+    void * ptr;
+    cc_fifo_retrieve(thisp->pending, &ptr, NULL);
+    Block * block = static_cast<Block *>(ptr);
+    if (block == NULL) break;
+
+    // only this thread touches the wrapped writer until it is joined
+    if (!thisp->hasFailed()) {
+      const size_t wrote = thisp->writer->write(block->data, block->len, block->binary);
+      if (wrote != block->len) {
+        cc_mutex_lock(thisp->mutex);
+        thisp->failed = TRUE;
+        cc_mutex_unlock(thisp->mutex);
+      }
+    }
+    block->len = 0;
+    cc_fifo_assign(thisp->available, block, 0);
+  }
+  return NULL;
+}
+
+void
+SoOutput_ThreadedWriter::submit(void)
+{
+  cc_fifo_assign(this->pending, this->current, 0);
+  // blocks until the compression thread has finished a block
+  void * ptr;
+  cc_fifo_retrieve(this->available, &ptr, NULL);
+  this->current = static_cast<Block *>(ptr);
+}
+
+SbBool
+SoOutput_ThreadedWriter::hasFailed(void)
+{
+  cc_mutex_lock(this->mutex);
+  const SbBool ret = this->failed;
+  cc_mutex_unlock(this->mutex);
+  return ret;
+}
+
+SoOutput_Writer::WriterType
+SoOutput_ThreadedWriter::getType(void) const
+{
+  return this->writer->getType();
+}
+
+size_t
+SoOutput_ThreadedWriter::write(const char * buf, size_t numbytes, const SbBool binary)
+{
+  // a block queued by an earlier call couldn't be written
+  if (this->hasFailed()) return 0;
+
+  size_t left = numbytes;
+  while (left) {
+    if (this->current->len && (this->current->binary != binary)) {
+      this->submit();
+    }
+    const size_t n = SbMin(left, SOOUTPUT_THREADED_BLOCKSIZE - this->current->len);
+    memcpy(this->current->data + this->current->len, buf, n);
+    this->current->len += n;
+    this->current->binary = binary;
+    buf += n;
+    left -= n;
+    if (this->current->len == SOOUTPUT_THREADED_BLOCKSIZE) {
+      this->submit();
+    }
+  }
+  this->writecounter += numbytes;
+  return numbytes;
+}
+
+// Hands over the block being filled, and waits until the compression
+// thread has written all the blocks.
+SbBool
+SoOutput_ThreadedWriter::flush(void)
+{
+  if (this->current->len) {
+    this->submit();
+  }
+  void * blocks[SOOUTPUT_THREADED_NUMBLOCKS - 1];
+  for (int i = 0; i < SOOUTPUT_THREADED_NUMBLOCKS - 1; i++) {
+    cc_fifo_retrieve(this->available, &blocks[i], NULL);
+  }
+  for (int i = 0; i < SOOUTPUT_THREADED_NUMBLOCKS - 1; i++) {
+    cc_fifo_assign(this->available, blocks[i], 0);
+  }
+  return !this->hasFailed();
+}
+
+// Returns the number of (uncompressed) bytes written so far, which is
+// what both the gzip and bzip2 writers report.
+size_t
+SoOutput_ThreadedWriter::bytesInBuf(void)
+{
+  return this->writecounter;
+}
+
 #undef BZ_OK
 #undef BZ_IO_ERROR
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SoOutput.h>
+
+// /dev/full fails every write with ENOSPC, so the compressed data
+// can't be written
+BOOST_AUTO_TEST_CASE(compressedWriteFailure)
+{
+  const char * filters[] = { "SoOutput", NULL };
+  unsigned char data[64 * 1024];
+  unsigned int seed = 1;
+  for (size_t i = 0; i < sizeof(data); i++) {
+    // incompressible, so zlib writes to the file as it goes
+    seed = seed * 1103515245 + 12345;
+    data[i] = (unsigned char) (seed >> 16);
+  }
+
+  SoOutput out;
+  if (!out.setCompression("GZIP", 0.5f)) return;
+  FILE * fp = fopen("/dev/full", "wb");
+  if (!fp) return;
+  fclose(fp);
+
+  PushMessageSuppressFilters(filters);
+
+  // an error in the final blocks is reported when the file is closed
+  BOOST_REQUIRE(out.openFile("/dev/full"));
+  out.setBinary(TRUE);
+  ResetDebugWarningCount();
+  out.writeBinaryArray(data, (int) sizeof(data));
+  out.closeFile();
+  BOOST_CHECK_MESSAGE(GetDebugWarningCount() == 1,
+                      "failure to write the last block wasn't reported");
+
+  // an error in an earlier block is reported by a later write
+  BOOST_REQUIRE(out.openFile("/dev/full"));
+  out.setBinary(TRUE);
+  ResetDebugWarningCount();
+  for (int i = 0; i < 128 && GetDebugWarningCount() == 0; i++) {
+    out.writeBinaryArray(data, (int) sizeof(data));
+  }
+  BOOST_CHECK_MESSAGE(GetDebugWarningCount() == 1,
+                      "failure to write a block wasn't reported");
+  out.closeFile();
+  BOOST_CHECK_MESSAGE(GetDebugWarningCount() == 1,
+                      "the same failure was reported twice");
+
+  PopMessageSuppressFilters();
+}
+
+#endif // COIN_TEST_SUITE
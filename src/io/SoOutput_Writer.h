@@ -40,6 +40,7 @@
 // *************************************************************************
 
 #include <Inventor/SoOutput.h>
+#include <Inventor/C/threads/common.h>
 #include <stdio.h>
 
 // *************************************************************************
@@ -71,6 +72,11 @@ public:
   // return the number of bytes actually written.
   virtual size_t write(const char * buf, size_t numbytes, const SbBool binary) = 0;
 
+  // writes any data the writer holds on to. Returns FALSE if some of
+  // the data written so far couldn't be written. The default method
+  // returns TRUE.
+  virtual SbBool flush(void);
+
   static SoOutput_Writer * createWriter(FILE * fp,
                                         const SbBool shouldclose,
                                         const SbName & compmethod,
@@ -147,4 +153,38 @@ public:
   size_t writecounter;
 };
 
+// Wraps one of the compressing writers above and runs it on a
+// separate thread. Data is collected in fixed size blocks which are
+// handed over to the compression thread when full, so the caller
+// only blocks when the compressor falls more than a couple of blocks
+// behind. Errors in the compression thread are reported by the next
+// write() or flush().
+class SoOutput_ThreadedWriter : public SoOutput_Writer {
+public:
+  SoOutput_ThreadedWriter(SoOutput_Writer * writer);
+  virtual ~SoOutput_ThreadedWriter();
+
+  virtual size_t bytesInBuf(void);
+  virtual WriterType getType(void) const;
+  virtual size_t write(const char * buf, size_t numbytes, const SbBool binary);
+  virtual SbBool flush(void);
+
+  static SbBool isEnabled(void);
+
+private:
+  struct Block;
+  static void * threadEntry(void * closure);
+  void submit(void);
+  SbBool hasFailed(void);
+
+  SoOutput_Writer * writer;
+  cc_thread * thread;
+  cc_fifo * pending;
+  cc_fifo * available;
+  Block * current;
+  size_t writecounter;
+  cc_mutex * mutex; // protects failed
+  SbBool failed;
+};
+
 #endif // COIN_SOOUTPUT_WRITER_H
@@ -42,7 +42,7 @@
 
 #include "tidbitsp.h"
 #include "threads/threadsutilp.h"
-#include "misc/SbHash.h"
+#include "misc/SbFlatHash.h"
 
 // *************************************************************************
 
@@ -59,7 +59,7 @@ public:
 
 // *************************************************************************
 
-typedef SbHash<const SoBase *, SoWriterefCounterBaseData *> SoBase2SoWriterefCounterBaseDataMap;
+typedef SbFlatHash<const SoBase *, SoWriterefCounterBaseData *> SoBase2SoWriterefCounterBaseDataMap;
 
 class SoWriterefCounterOutputData {
 public:
@@ -125,8 +125,8 @@ private:
 
 // *************************************************************************
 
-typedef SbHash<SoOutput *, SoWriterefCounter *> SoOutput2SoWriterefCounterMap;
-typedef SbHash<const SoBase *, int> SoBase2Id;
+typedef SbFlatHash<SoOutput *, SoWriterefCounter *> SoOutput2SoWriterefCounterMap;
+typedef SbFlatHash<const SoBase *, int> SoBase2Id;
 
 class SoWriterefCounterP {
 public:
@@ -31,6 +31,7 @@
 \**************************************************************************/
 
 #include "SoByteStream.cpp"
+#include "SoChunkedFile.cpp"
 #include "SoInput.cpp"
 #include "SoInputP.cpp"
 #include "SoInput_FileInfo.cpp"
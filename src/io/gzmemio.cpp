@@ -55,6 +55,8 @@ typedef void   (*free_func)(void * opaque, void * address);
 #define Z_STREAM_END    1
 #define Z_NO_FLUSH      0
 #define Z_DEFLATED   8
+#define Z_FINISH        4
+#define Z_BUF_ERROR    (-5)
 #define MAX_WBITS   15 /* 32K LZ77 window */
 
 /* This zlib struct should never change */
@@ -783,6 +785,54 @@ int cc_gzm_close(void * file)
   return destroy((cc_gzm_stream*)file);
 }
 
+/* ===========================================================================
+   Compresses len bytes from buffer into a newly allocated gzip memory
+   image which can be read back with cc_gzm_open(). On success, Z_OK
+   is returned and *out (which must be released with free()) and
+   *outlen are set.
+*/
+int cc_gzm_compress(const uint8_t * buffer, uint32_t len, int level,
+                    uint8_t ** out, uint32_t * outlen)
+{
+  z_stream stream;
+  uint32_t bound;
+  int err;
+
+  *out = NULL;
+  *outlen = 0;
+  if (!cc_zlibglue_available()) return Z_STREAM_ERROR;
+
+  (void) memset(&stream, 0, sizeof(z_stream));
+  /* windowBits + 16 makes deflate() write a gzip header and trailer */
+  err = cc_zlibglue_deflateInit2(&stream, level, Z_DEFLATED,
+                                 MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY);
+  if (err != Z_OK) return err;
+
+  /* deflateBound() is not available through the glue, so use the same
+     worst case estimate, plus room for the gzip header and trailer */
+  bound = len + (len >> 12) + (len >> 14) + (len >> 25) + 13 + 18;
+  *out = (uint8_t *) Z_ALLOC(bound);
+  if (*out == NULL) {
+    (void) cc_zlibglue_deflateEnd(&stream);
+    return Z_STREAM_ERROR;
+  }
+
+  stream.next_in = (unsigned char *) buffer;
+  stream.avail_in = len;
+  stream.next_out = *out;
+  stream.avail_out = bound;
+  err = cc_zlibglue_deflate(&stream, Z_FINISH);
+  (void) cc_zlibglue_deflateEnd(&stream);
+
+  if (err != Z_STREAM_END) {
+    Z_TRYFREE(*out);
+    *out = NULL;
+    return (err == Z_OK) ? Z_BUF_ERROR : err;
+  }
+  *outlen = (uint32_t) stream.total_out;
+  return Z_OK;
+}
+
 /* stdio layer */
 
 static int
@@ -53,6 +53,8 @@ extern "C" {
   int cc_gzm_eof(void * file);
   int cc_gzm_close(void * file);
   int cc_gzm_sizeof_z_stream(void);
+  int cc_gzm_compress(const uint8_t * buffer, uint32_t len, int level,
+                      uint8_t ** out, uint32_t * outlen);
   
 
   /*
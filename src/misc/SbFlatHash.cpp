@@ -0,0 +1,231 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+// SbFlatHash is a header-only template, see SbFlatHash.h. This file
+// makes sure the header compiles on its own, and holds its tests.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include "misc/SbFlatHash.h"
+
+// *************************************************************************
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/lists/SbList.h>
+#include "misc/SbFlatHash.h"
+
+typedef SbFlatHash<int, int> FlatHashIntMap;
+
+// checks that map holds exactly the keys in [0, num) for which
+// present() is TRUE, each mapped to its key times 10
+static SbBool
+flathash_check(const FlatHashIntMap & map, const int num,
+               SbBool (*present)(int))
+{
+  unsigned int expected = 0;
+  for (int key = 0; key < num; key++) {
+    int value = -1;
+    const SbBool found = map.get(key, value);
+    if (found != present(key)) return FALSE;
+    if (found && (value != key * 10)) return FALSE;
+    if (found) expected++;
+  }
+  return map.getNumElements() == expected;
+}
+
+static SbBool flathash_all(int) { return TRUE; }
+static SbBool flathash_odd(int key) { return (key % 2) != 0; }
+static SbBool flathash_not_third(int key) { return (key % 3) != 0; }
+
+BOOST_AUTO_TEST_CASE(putGetErase)
+{
+  FlatHashIntMap map;
+  BOOST_CHECK_EQUAL(map.getNumElements(), 0u);
+
+  BOOST_CHECK(map.put(1, 10));
+  BOOST_CHECK(map.put(2, 20));
+  BOOST_CHECK_MESSAGE(!map.put(1, 11), "put() of an existing key should replace it");
+  int value = 0;
+  BOOST_CHECK(map.get(1, value) && value == 11);
+  BOOST_CHECK(map.get(2, value) && value == 20);
+  BOOST_CHECK(!map.get(3, value));
+  BOOST_CHECK_EQUAL(map.getNumElements(), 2u);
+
+  map[3] = 30;
+  BOOST_CHECK(map.get(3, value) && value == 30);
+  BOOST_CHECK(map.find(3) != map.const_end());
+  BOOST_CHECK(map.find(4) == map.const_end());
+
+  BOOST_CHECK_EQUAL(map.erase(1), (size_t) 1);
+  BOOST_CHECK_EQUAL(map.erase(1), (size_t) 0);
+  BOOST_CHECK(!map.get(1, value));
+  BOOST_CHECK(map.get(2, value) && value == 20);
+  BOOST_CHECK_EQUAL(map.getNumElements(), 2u);
+
+  map.clear();
+  BOOST_CHECK_EQUAL(map.getNumElements(), 0u);
+  BOOST_CHECK(!map.get(2, value));
+}
+
+BOOST_AUTO_TEST_CASE(reinsertOverTombstones)
+{
+  const int num = 1000;
+  FlatHashIntMap map(16);
+  int key;
+  for (key = 0; key < num; key++) map.put(key, key * 10);
+  for (key = 0; key < num; key += 2) map.erase(key);
+  BOOST_CHECK(flathash_check(map, num, flathash_odd));
+
+  // the erased keys are reinserted over the tombstones they left
+  for (key = 0; key < num; key += 2) {
+    BOOST_CHECK_MESSAGE(map.put(key, key * 10), "key " << key << " should be new");
+  }
+  BOOST_CHECK(flathash_check(map, num, flathash_all));
+
+  // a few live elements and many erased ones make the table clean out
+  // its tombstones in place, which must not lose any elements
+  FlatHashIntMap small(16);
+  for (key = 0; key < 10; key++) small.put(key, key * 10);
+  for (key = 10; key < 10000; key++) {
+    small.put(key, key * 10);
+    small.erase(key);
+  }
+  BOOST_CHECK(flathash_check(small, 10, flathash_all));
+  int value;
+  BOOST_CHECK(!small.get(9999, value));
+}
+
+BOOST_AUTO_TEST_CASE(growAndRehash)
+{
+  // grows from the smallest table many times over
+  const int num = 20000;
+  FlatHashIntMap map(1);
+  for (int key = 0; key < num; key++) {
+    BOOST_REQUIRE(map.put(key, key * 10));
+  }
+  BOOST_CHECK(flathash_check(map, num, flathash_all));
+
+  // pointer keys, which have their low bits cleared
+  static char objects[4096];
+  SbFlatHash<size_t, int> pointers(16);
+  int i;
+  for (i = 0; i < 4096; i += 8) pointers.put((size_t) &objects[i], i);
+  BOOST_CHECK_EQUAL(pointers.getNumElements(), 512u);
+  SbBool allfound = TRUE;
+  for (i = 0; i < 4096; i += 8) {
+    int value = -1;
+    if (!pointers.get((size_t) &objects[i], value) || value != i) allfound = FALSE;
+  }
+  BOOST_CHECK(allfound);
+}
+
+BOOST_AUTO_TEST_CASE(iterateAfterErase)
+{
+  const int num = 3000;
+  FlatHashIntMap map(16);
+  int key;
+  for (key = 0; key < num; key++) map.put(key, key * 10);
+  for (key = 0; key < num; key += 3) map.erase(key);
+
+  SbList<int> seen;
+  for (int i = 0; i < num; i++) seen.append(0);
+  unsigned int count = 0;
+  for (FlatHashIntMap::const_iterator it = map.const_begin(); it != map.const_end(); ++it) {
+    BOOST_REQUIRE(it->key >= 0 && it->key < num);
+    BOOST_CHECK(it->obj == it->key * 10);
+    seen[it->key]++;
+    count++;
+  }
+  BOOST_CHECK_EQUAL(count, map.getNumElements());
+  SbBool allseen = TRUE;
+  for (key = 0; key < num; key++) {
+    if (seen[key] != (flathash_not_third(key) ? 1 : 0)) allseen = FALSE;
+  }
+  BOOST_CHECK_MESSAGE(allseen, "each element should be visited once");
+
+  // erasing the element an iterator points to before advancing it
+  for (FlatHashIntMap::iterator it = map.begin(); it != map.end(); ) {
+    const int erased = it->key;
+    ++it;
+    map.erase(erased);
+  }
+  BOOST_CHECK_EQUAL(map.getNumElements(), 0u);
+  BOOST_CHECK(map.begin() == map.end());
+
+  SbList<int> keys;
+  map.put(7, 70);
+  map.makeKeyList(keys);
+  BOOST_CHECK(keys.getLength() == 1 && keys[0] == 7);
+}
+
+BOOST_AUTO_TEST_CASE(copyAndMove)
+{
+  const int num = 500;
+  FlatHashIntMap map(16);
+  int key;
+  for (key = 0; key < num; key++) map.put(key, key * 10);
+  for (key = 0; key < num; key += 2) map.erase(key);
+
+  FlatHashIntMap copy(map);
+  BOOST_CHECK(flathash_check(copy, num, flathash_odd));
+  FlatHashIntMap assigned;
+  assigned.put(-1, -10);
+  assigned = map;
+  BOOST_CHECK(flathash_check(assigned, num, flathash_odd));
+
+  // the copies don't share entries with the original
+  copy.put(0, 0);
+  assigned.erase(1);
+  BOOST_CHECK(flathash_check(map, num, flathash_odd));
+
+#if COIN_SBFLATHASH_HAVE_MOVE
+  FlatHashIntMap moved(static_cast<FlatHashIntMap &&>(map));
+  BOOST_CHECK(flathash_check(moved, num, flathash_odd));
+  BOOST_CHECK_EQUAL(map.getNumElements(), 0u);
+
+  // the source is left empty, and still usable
+  map.put(1, 10);
+  int value = 0;
+  BOOST_CHECK(map.get(1, value) && value == 10);
+
+  FlatHashIntMap moveassigned;
+  moveassigned.put(-1, -10);
+  moveassigned = static_cast<FlatHashIntMap &&>(moved);
+  BOOST_CHECK(flathash_check(moveassigned, num, flathash_odd));
+  BOOST_CHECK_EQUAL(moved.getNumElements(), 0u);
+#endif // COIN_SBFLATHASH_HAVE_MOVE
+}
+
+#endif // COIN_TEST_SUITE
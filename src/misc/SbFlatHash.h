@@ -0,0 +1,597 @@
+#ifndef COIN_SBFLATHASH_H
+#define COIN_SBFLATHASH_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+// *************************************************************************
+// This class (SbFlatHash<Key, Type>) is internal and must not be exposed
+// in the Coin API.
+
+/*
+  SbFlatHash is an open addressing variant of SbHash with the same
+  interface. Entries are stored in one flat array, next to an array
+  of one-byte control codes (one per slot) which holds either the
+  empty / deleted markers or 7 bits of the hash value of the key
+  stored in the slot. Lookups compare a whole group of 16 control
+  bytes at a time (with SSE2 when available) and only touch the
+  entries whose control byte matches, so a lookup is usually one or
+  two cache misses instead of one per chained bucket entry.
+
+  Differences from SbHash worth knowing about:
+
+  - inserting may move entries, so pointers into the table (and
+    iterators) are only valid until the next put() / operator[]
+  - erase() does not move other entries, so erasing the element an
+    iterator points to and then advancing the iterator is safe
+*/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* ! COIN_INTERNAL */
+
+// *************************************************************************
+
+#include <assert.h>
+#include <stddef.h> // NULL
+#include <string.h> // memset()
+#include <new> // placement new
+
+#include <Inventor/lists/SbList.h>
+
+#include "misc/SbHash.h" // SbHashFunc()
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define COIN_SBFLATHASH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if (__cplusplus >= 201103L) || (defined(_MSC_VER) && (_MSC_VER >= 1600))
+#define COIN_SBFLATHASH_HAVE_MOVE 1
+#else
+#define COIN_SBFLATHASH_HAVE_MOVE 0
+#endif
+
+// *************************************************************************
+
+namespace SbFlatHashP {
+
+  enum {
+    GROUPWIDTH = 16,
+    EMPTY = 0x80,
+    DELETED = 0xfe
+  };
+
+  // Spread the bits of the (often identity) SbHashFunc() result, since
+  // pointer keys have their low bits cleared and we use the low bits
+  // to select slots (MurmurHash3 finalizer).
+  inline unsigned int mix(unsigned int h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+  }
+
+  inline int lowestBit(unsigned int mask) {
+    assert(mask != 0);
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#elif defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return static_cast<int>(idx);
+#else
+    int idx = 0;
+    while (!(mask & 1)) { mask >>= 1; idx++; }
+    return idx;
+#endif
+  }
+
+  // Returns a bitmask with bit i set if group[i] == val.
+  inline unsigned int matchByte(const unsigned char * group, unsigned char val) {
+#ifdef COIN_SBFLATHASH_SSE2
+    const __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+    const __m128i cmp = _mm_cmpeq_epi8(ctrl, _mm_set1_epi8(static_cast<char>(val)));
+    return static_cast<unsigned int>(_mm_movemask_epi8(cmp));
+#else
+    unsigned int mask = 0;
+    for (int i = 0; i < GROUPWIDTH; i++) {
+      if (group[i] == val) mask |= (1u << i);
+    }
+    return mask;
+#endif
+  }
+
+  // Returns a bitmask with bit i set if group[i] is empty or deleted.
+  inline unsigned int matchFree(const unsigned char * group) {
+#ifdef COIN_SBFLATHASH_SSE2
+    // both EMPTY and DELETED have the high bit set
+    const __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+    return static_cast<unsigned int>(_mm_movemask_epi8(ctrl));
+#else
+    unsigned int mask = 0;
+    for (int i = 0; i < GROUPWIDTH; i++) {
+      if (group[i] & 0x80) mask |= (1u << i);
+    }
+    return mask;
+#endif
+  }
+
+} // namespace SbFlatHashP
+
+// *************************************************************************
+
+template <class Key, class Type>
+class SbFlatHash {
+ public:
+
+  class SbHashEntry {
+  public:
+    SbHashEntry(const Key & key, const Type & obj) : key(key), obj(obj) {}
+#if COIN_SBFLATHASH_HAVE_MOVE
+    SbHashEntry(const Key & key, Type && obj) : key(key), obj(static_cast<Type &&>(obj)) {}
+#endif // COIN_SBFLATHASH_HAVE_MOVE
+
+    Key key;
+    Type obj;
+  };
+
+  class iterator {
+  public:
+    iterator(const iterator & iter) {
+      this->master = iter.master;
+      this->index  = iter.index;
+      this->elem  = iter.elem;
+    }
+    SbHashEntry & operator*() {
+      return *this->elem;
+    }
+    SbHashEntry * operator->() {
+      return this->elem;
+    }
+    bool operator==(const iterator & rhs) const {
+      return rhs.elem == this->elem;
+    }
+    bool operator!=(const iterator & rhs) const {
+      return !((*this)==rhs);
+    }
+    iterator & operator++() {
+      ++this->index;
+      this->setNextUsedSlot();
+      return *this;
+    }
+  private:
+    iterator(const SbFlatHash<Key, Type> * master_in, unsigned int index_in) {
+      this->master = const_cast<SbFlatHash<Key, Type> *>(master_in);
+      this->index = index_in;
+      this->setNextUsedSlot();
+    }
+    iterator() {
+      this->master = NULL;
+      this->index = 0;
+      this->elem = NULL;
+    }
+
+    void setNextUsedSlot(void) {
+      this->elem = NULL;
+      for (; this->index < this->master->capacity; ++this->index) {
+        if (SbFlatHash<Key, Type>::isFull(this->master->ctrl[this->index])) {
+          this->elem = &this->master->slots[this->index];
+          return;
+        }
+      }
+    }
+
+    SbFlatHash<Key, Type> * master;
+    unsigned int index;
+    SbHashEntry * elem;
+    friend class SbFlatHash<Key, Type>;
+  };
+
+  class const_iterator {
+  public:
+    const_iterator(const iterator & iter) {
+      this->master = iter.master;
+      this->index  = iter.index;
+      this->elem  = iter.elem;
+    }
+    const_iterator(const const_iterator & iter) {
+      this->master = iter.master;
+      this->index  = iter.index;
+      this->elem  = iter.elem;
+    }
+    const SbHashEntry & operator*() {
+      return *this->elem;
+    }
+    const SbHashEntry * operator->() {
+      return this->elem;
+    }
+    bool operator==(const const_iterator & rhs) const {
+      return rhs.elem == this->elem;
+    }
+    bool operator!=(const const_iterator & rhs) const {
+      return !((*this)==rhs);
+    }
+    const_iterator & operator++() {
+      ++this->index;
+      this->setNextUsedSlot();
+      return *this;
+    }
+  private:
+    const_iterator(const SbFlatHash<Key, Type> * master_in, unsigned int index_in) {
+      this->master = master_in;
+      this->index = index_in;
+      this->setNextUsedSlot();
+    }
+    const_iterator() {
+      this->master = NULL;
+      this->index = 0;
+      this->elem = NULL;
+    }
+
+    void setNextUsedSlot(void) {
+      this->elem = NULL;
+      for (; this->index < this->master->capacity; ++this->index) {
+        if (SbFlatHash<Key, Type>::isFull(this->master->ctrl[this->index])) {
+          this->elem = &this->master->slots[this->index];
+          return;
+        }
+      }
+    }
+
+    const SbFlatHash<Key, Type> * master;
+    unsigned int index;
+    const SbHashEntry * elem;
+    friend class SbFlatHash<Key, Type>;
+  };
+
+  SbFlatHash(unsigned int sizearg = 256, float loadfactorarg = 0.0f)
+  {
+    this->commonConstructor(sizearg, loadfactorarg);
+  }
+
+  SbFlatHash(const SbFlatHash & from)
+  {
+    this->commonConstructor(from.elements, from.loadfactor);
+    this->operator=(from);
+  }
+
+  SbFlatHash & operator=(const SbFlatHash & from)
+  {
+    if (&from == this) return *this;
+    this->clear();
+    for (unsigned int i = 0; i < from.capacity; ++i) {
+      if (isFull(from.ctrl[i])) {
+        this->put(from.slots[i].key, from.slots[i].obj);
+      }
+    }
+    return *this;
+  }
+
+#if COIN_SBFLATHASH_HAVE_MOVE
+  SbFlatHash(SbFlatHash && from)
+  {
+    this->stealFrom(from);
+  }
+
+  SbFlatHash & operator=(SbFlatHash && from)
+  {
+    if (&from == this) return *this;
+    this->destroyAll();
+    this->stealFrom(from);
+    return *this;
+  }
+#endif // COIN_SBFLATHASH_HAVE_MOVE
+
+  ~SbFlatHash()
+  {
+    this->destroyAll();
+  }
+
+  void clear(void)
+  {
+    for (unsigned int i = 0; i < this->capacity; i++) {
+      if (isFull(this->ctrl[i])) { this->slots[i].~SbHashEntry(); }
+    }
+    memset(this->ctrl, SbFlatHashP::EMPTY, this->capacity + SbFlatHashP::GROUPWIDTH);
+    this->elements = 0;
+    this->deleted = 0;
+  }
+
+  iterator begin() const {
+    return iterator(this, 0);
+  }
+
+  iterator end() const {
+    return iterator();
+  }
+
+  const_iterator const_begin() const {
+    return const_iterator(this, 0);
+  }
+
+  const_iterator const_end() const {
+    return const_iterator();
+  }
+
+  Type & operator[](const Key & key) {
+    const unsigned int hash = hashKey(key);
+    int idx = this->findIndex(key, hash);
+    if (idx < 0) {
+      idx = this->insertNew(key, Type(), hash);
+    }
+    return this->slots[idx].obj;
+  }
+
+  size_t erase(const Key & key)
+  {
+    const int idx = this->findIndex(key, hashKey(key));
+    if (idx < 0) return 0;
+    this->slots[idx].~SbHashEntry();
+    this->setCtrl(idx, SbFlatHashP::DELETED);
+    this->elements--;
+    this->deleted++;
+    return 1;
+  }
+
+  void makeKeyList(SbList<Key> & l) const
+  {
+    for (unsigned int i = 0; i < this->capacity; ++i) {
+      if (isFull(this->ctrl[i])) { l.append(this->slots[i].key); }
+    }
+  }
+
+  unsigned int getNumElements(void) const { return this->elements; }
+
+  const_iterator find(const Key & key) const
+  {
+    const int idx = this->findIndex(key, hashKey(key));
+    if (idx < 0) return const_end();
+    return const_iterator(this, static_cast<unsigned int>(idx));
+  }
+
+  SbBool put(const Key & key, const Type & obj)
+  {
+    const unsigned int hash = hashKey(key);
+    const int idx = this->findIndex(key, hash);
+    if (idx >= 0) {
+      /* Replace the old value */
+      this->slots[idx].obj = obj;
+      return FALSE;
+    }
+    (void) this->insertNew(key, obj, hash);
+    return TRUE;
+  }
+
+#if COIN_SBFLATHASH_HAVE_MOVE
+  SbBool put(const Key & key, Type && obj)
+  {
+    const unsigned int hash = hashKey(key);
+    const int idx = this->findIndex(key, hash);
+    if (idx >= 0) {
+      this->slots[idx].obj = static_cast<Type &&>(obj);
+      return FALSE;
+    }
+    (void) this->insertNew(key, static_cast<Type &&>(obj), hash);
+    return TRUE;
+  }
+#endif // COIN_SBFLATHASH_HAVE_MOVE
+
+  SbBool get(const Key & key, Type & obj) const
+  {
+    const int idx = this->findIndex(key, hashKey(key));
+    if (idx < 0) return FALSE;
+    obj = this->slots[idx].obj;
+    return TRUE;
+  }
+
+ private:
+  static bool isFull(unsigned char c) { return (c & 0x80) == 0; }
+
+  static unsigned int hashKey(const Key & key) {
+    return SbFlatHashP::mix(SbHashFunc(key));
+  }
+
+  static unsigned char h2(unsigned int hash) {
+    return static_cast<unsigned char>(hash & 0x7f);
+  }
+
+  // Sets a control byte, and keeps the cloned bytes after the end of
+  // the array in sync, so a group can always be loaded with one
+  // unaligned read without wrapping around.
+  void setCtrl(unsigned int idx, unsigned char val) {
+    this->ctrl[idx] = val;
+    if (idx < SbFlatHashP::GROUPWIDTH) {
+      this->ctrl[this->capacity + idx] = val;
+    }
+  }
+
+  int findIndex(const Key & key, unsigned int hash) const {
+    const unsigned int mask = this->capacity - 1;
+    const unsigned char tag = h2(hash);
+    unsigned int pos = (hash >> 7) & mask;
+    unsigned int step = 0;
+    for (;;) {
+      const unsigned char * group = this->ctrl + pos;
+      unsigned int match = SbFlatHashP::matchByte(group, tag);
+      while (match) {
+        const int bit = SbFlatHashP::lowestBit(match);
+        const unsigned int idx = (pos + bit) & mask;
+        if (this->slots[idx].key == key) return static_cast<int>(idx);
+        match &= match - 1;
+      }
+      if (SbFlatHashP::matchByte(group, SbFlatHashP::EMPTY)) return -1;
+      // triangular probing over groups visits every group once
+      step += SbFlatHashP::GROUPWIDTH;
+      pos = (pos + step) & mask;
+    }
+  }
+
+  unsigned int findFreeSlot(unsigned int hash) const {
+    const unsigned int mask = this->capacity - 1;
+    unsigned int pos = (hash >> 7) & mask;
+    unsigned int step = 0;
+    for (;;) {
+      const unsigned int freemask = SbFlatHashP::matchFree(this->ctrl + pos);
+      if (freemask) {
+        return (pos + SbFlatHashP::lowestBit(freemask)) & mask;
+      }
+      step += SbFlatHashP::GROUPWIDTH;
+      pos = (pos + step) & mask;
+    }
+  }
+
+  unsigned int insertNew(const Key & key, const Type & obj, unsigned int hash) {
+    this->reserveOne();
+    const unsigned int idx = this->findFreeSlot(hash);
+    if (this->ctrl[idx] == SbFlatHashP::DELETED) { this->deleted--; }
+    new (&this->slots[idx]) SbHashEntry(key, obj);
+    this->setCtrl(idx, h2(hash));
+    this->elements++;
+    return idx;
+  }
+
+#if COIN_SBFLATHASH_HAVE_MOVE
+  unsigned int insertNew(const Key & key, Type && obj, unsigned int hash) {
+    this->reserveOne();
+    const unsigned int idx = this->findFreeSlot(hash);
+    if (this->ctrl[idx] == SbFlatHashP::DELETED) { this->deleted--; }
+    new (&this->slots[idx]) SbHashEntry(key, static_cast<Type &&>(obj));
+    this->setCtrl(idx, h2(hash));
+    this->elements++;
+    return idx;
+  }
+#endif // COIN_SBFLATHASH_HAVE_MOVE
+
+  // Makes sure there is room for one more element. Tombstones left
+  // by erase() count against the load factor, and are cleaned out by
+  // rehashing in place when they make up most of the used slots.
+  void reserveOne(void) {
+    if (this->elements + this->deleted + 1 <= this->threshold) return;
+    if (this->elements * 2 < this->threshold) {
+      this->rehash(this->capacity);
+    }
+    else {
+      this->rehash(this->capacity * 2);
+    }
+  }
+
+  void rehash(unsigned int newcapacity) {
+    unsigned char * oldctrl = this->ctrl;
+    SbHashEntry * oldslots = this->slots;
+    const unsigned int oldcapacity = this->capacity;
+
+    this->allocate(newcapacity);
+    for (unsigned int i = 0; i < oldcapacity; i++) {
+      if (isFull(oldctrl[i])) {
+        SbHashEntry & entry = oldslots[i];
+        const unsigned int hash = hashKey(entry.key);
+        const unsigned int idx = this->findFreeSlot(hash);
+#if COIN_SBFLATHASH_HAVE_MOVE
+        new (&this->slots[idx]) SbHashEntry(entry.key, static_cast<Type &&>(entry.obj));
+#else
+        new (&this->slots[idx]) SbHashEntry(entry.key, entry.obj);
+#endif
+        this->setCtrl(idx, h2(hash));
+        this->elements++;
+        entry.~SbHashEntry();
+      }
+    }
+    delete [] oldctrl;
+    ::operator delete(oldslots);
+  }
+
+  void allocate(unsigned int newcapacity) {
+    assert(newcapacity >= SbFlatHashP::GROUPWIDTH);
+    assert((newcapacity & (newcapacity - 1)) == 0);
+    this->capacity = newcapacity;
+    this->elements = 0;
+    this->deleted = 0;
+    this->threshold = static_cast<unsigned int>(newcapacity * this->loadfactor);
+    // always keep at least one empty slot, so probing terminates
+    if (this->threshold >= newcapacity) { this->threshold = newcapacity - 1; }
+    this->ctrl = new unsigned char[newcapacity + SbFlatHashP::GROUPWIDTH];
+    memset(this->ctrl, SbFlatHashP::EMPTY, newcapacity + SbFlatHashP::GROUPWIDTH);
+    this->slots = static_cast<SbHashEntry *>(::operator new(newcapacity * sizeof(SbHashEntry)));
+  }
+
+  void destroyAll(void) {
+    if (this->ctrl == NULL) return;
+    this->clear();
+    delete [] this->ctrl;
+    ::operator delete(this->slots);
+    this->ctrl = NULL;
+    this->slots = NULL;
+    this->capacity = 0;
+  }
+
+#if COIN_SBFLATHASH_HAVE_MOVE
+  void stealFrom(SbFlatHash & from) {
+    this->loadfactor = from.loadfactor;
+    this->capacity = from.capacity;
+    this->elements = from.elements;
+    this->deleted = from.deleted;
+    this->threshold = from.threshold;
+    this->ctrl = from.ctrl;
+    this->slots = from.slots;
+    // leave the source as a valid, empty table
+    from.commonConstructor(SbFlatHashP::GROUPWIDTH, from.loadfactor);
+  }
+#endif // COIN_SBFLATHASH_HAVE_MOVE
+
+  void commonConstructor(unsigned int sizearg, float loadfactorarg)
+  {
+    // high load factors work well with group probing
+    if (loadfactorarg <= 0.0f) { loadfactorarg = 0.875f; }
+    this->loadfactor = loadfactorarg;
+    unsigned int s = SbFlatHashP::GROUPWIDTH;
+    while (s < sizearg) { s <<= 1; }
+    this->allocate(s);
+  }
+
+  float loadfactor;
+  unsigned int capacity;
+  unsigned int elements;
+  unsigned int deleted;
+  unsigned int threshold;
+
+  unsigned char * ctrl;
+  SbHashEntry * slots;
+};
+
+#endif // !COIN_SBFLATHASH_H
@@ -368,8 +368,8 @@ SoBase::initClass(void)
 
   SoBase::classTypeId = SoType::createType(SoType::badType(), "Base");
 
-  SoBase::PImpl::name2obj = new SbHash<const char *, SbPList *>;
-  SoBase::PImpl::obj2name = new SbHash<const SoBase *, const char *>();
+  SoBase::PImpl::name2obj = new SbFlatHash<const char *, SbPList *>;
+  SoBase::PImpl::obj2name = new SbFlatHash<const SoBase *, const char *>();
   SoBase::PImpl::refwriteprefix = new SbString("+");
   SoBase::PImpl::allbaseobj = new SoBaseSet;
 
@@ -397,7 +397,7 @@ SoBase::cleanClass(void)
 
   // Delete the SbPLists in the dictionaries.
   for(
-      SbHash<const char *, SbPList *>::const_iterator iter =
+      SbFlatHash<const char *, SbPList *>::const_iterator iter =
        SoBase::PImpl::name2obj->const_begin();
       iter!=SoBase::PImpl::name2obj->const_end();
       ++iter
@@ -657,7 +657,7 @@ SoBase::getName(void) const
 
   //const char * value = NULL;
   CC_MUTEX_LOCK(SoBase::PImpl::obj2name_mutex);
-  SbHash<const SoBase *, const char *>::const_iterator tmp = SoBase::PImpl::obj2name->find(this);
+  SbFlatHash<const SoBase *, const char *>::const_iterator tmp = SoBase::PImpl::obj2name->find(this);
   SbBool found = (tmp != SoBase::PImpl::obj2name->const_end());
   CC_MUTEX_UNLOCK(SoBase::PImpl::obj2name_mutex);
   return SbName(found ? tmp->obj : "");
@@ -751,7 +751,7 @@ SoBase::addName(SoBase * const b, const char * const name)
 
   SbPList * l;
   CC_MUTEX_LOCK(SoBase::PImpl::name2obj_mutex);
-  SbHash<const char*, SbPList*>::const_iterator tmp = SoBase::PImpl::name2obj->find(name);
+  SbFlatHash<const char*, SbPList*>::const_iterator tmp = SoBase::PImpl::name2obj->find(name);
   if (tmp==SoBase::PImpl::name2obj->const_end()) {
     // name not used before, create new list
     l = new SbPList;
@@ -766,7 +766,7 @@ SoBase::addName(SoBase * const b, const char * const name)
   CC_MUTEX_UNLOCK(SoBase::PImpl::name2obj_mutex);
 
   CC_MUTEX_LOCK(SoBase::PImpl::obj2name_mutex);
-  // set name of object. SbHash::put() will overwrite old name
+  // set name of object. SbFlatHash::put() will overwrite old name
   (*SoBase::PImpl::obj2name)[b] = name;
   CC_MUTEX_UNLOCK(SoBase::PImpl::obj2name_mutex);
 }
@@ -871,12 +871,12 @@ SoBase::getAuditors(void) const
   CC_MUTEX_LOCK(SoBase::PImpl::auditor_mutex);
 
   if (SoBase::PImpl::auditordict == NULL) {
-    SoBase::PImpl::auditordict = new SbHash<const SoBase *, SoAuditorList *>();
+    SoBase::PImpl::auditordict = new SbFlatHash<const SoBase *, SoAuditorList *>();
     coin_atexit((coin_atexit_f*)SoBase::PImpl::cleanup_auditordict, CC_ATEXIT_NORMAL);
   }
 
   SoAuditorList * l = NULL;
-  SbHash<const SoBase *, SoAuditorList *>::const_iterator iter
+  SbFlatHash<const SoBase *, SoAuditorList *>::const_iterator iter
     = 
     SoBase::PImpl::auditordict->find(this);
   if (iter!=SoBase::PImpl::auditordict->const_end()) {
@@ -974,7 +974,7 @@ SoBase *
 SoBase::getNamedBase(const SbName & name, SoType type)
 {
   CC_MUTEX_LOCK(SoBase::PImpl::name2obj_mutex);
-  SbHash<const char*, SbPList*>::const_iterator iter = 
+  SbFlatHash<const char*, SbPList*>::const_iterator iter = 
     SoBase::PImpl::name2obj->find((const char *)name);
   if (iter!=SoBase::PImpl::name2obj->const_end()) {
     SbPList * l = iter->obj;
@@ -1003,7 +1003,7 @@ SoBase::getNamedBases(const SbName & name, SoBaseList & baselist, SoType type)
 
   int matches = 0;
 
-  SbHash<const char*, SbPList*>::const_iterator iter = 
+  SbFlatHash<const char*, SbPList*>::const_iterator iter = 
     SoBase::PImpl::name2obj->find((const char *)name);
   if (iter!=SoBase::PImpl::name2obj->const_end()) {
     SbPList * l = iter->obj;
@@ -112,6 +112,7 @@
 #include "shaders/SoShader.h"
 #include "tidbitsp.h"
 #include "fields/SoGlobalField.h"
+#include "io/SoChunkedFileP.h"
 #include "misc/CoinStaticObjectInDLL.h"
 #include "misc/systemsanity.icc"
 #include "misc/SoDBP.h"
@@ -140,6 +141,7 @@
 #include <Inventor/annex/Profiler/SoProfiler.h>
 #include <Inventor/annex/Profiler/elements/SoProfilerElement.h>
 #include "profiler/SoProfilerP.h"
+#include "profiler/SoProfilerCountersP.h"
 
 // *************************************************************************
 
@@ -148,6 +150,8 @@
 #ifndef DOXYGEN_SKIP_THIS
 const char * SoDBP::EnvVars::COIN_PROFILER = "COIN_PROFILER";
 const char * SoDBP::EnvVars::COIN_PROFILER_OVERLAY = "COIN_PROFILER_OVERLAY";
+const char * SoDBP::EnvVars::COIN_PROFILER_EXPORT = "COIN_PROFILER_EXPORT";
+const char * SoDBP::EnvVars::COIN_PROFILER_COUNTERS = "COIN_PROFILER_COUNTERS";
 #endif // DOXYGEN_SKIP_THIS
 
 // *************************************************************************
@@ -408,6 +412,9 @@ SoDB::init(void)
   SoDB::registerHeader(SbString("#VRML V1.0 ascii   "), FALSE, 2.1f,
                        NULL, NULL, NULL);
 
+  // Coin's chunked binary format, see SoChunkedFile.
+  SoChunkedFileP::initClass();
+
 
   // FIXME: should be more robust and accept a set of headers that
   // /almost/ match the exact specifications above. I have for
@@ -463,6 +470,9 @@ SoDB::init(void)
   // before after initialization is done, but subsystems invoked from
   // these methods needs to know that Coin is already initialized.
   SoProfilerP::parseCoinProfilerVariable();
+  SoProfilerP::parseCoinProfilerExportVariable();
+  SoProfilerCountersP::init();
+  SoProfilerCountersP::parseCoinProfilerCountersVariable();
   if (SoProfiler::isEnabled()) {
     SoProfiler::init();
   }
@@ -44,7 +44,7 @@
 #include <Inventor/SoDB.h>
 #include <Inventor/SbString.h>
 
-#include "misc/SbHash.h"
+#include "misc/SbFlatHash.h"
 
 class SoSensor;
 class SbRWMutex;
@@ -66,7 +66,7 @@ public:
   void * userdata;
 };
 
-typedef SbHash<uint32_t, int16_t> UInt32ToInt16Map;
+typedef SbFlatHash<uint32_t, int16_t> UInt32ToInt16Map;
 
 // *************************************************************************
 
@@ -75,6 +75,8 @@ public:
   struct EnvVars {
     static const char * COIN_PROFILER;
     static const char * COIN_PROFILER_OVERLAY;
+    static const char * COIN_PROFILER_EXPORT;
+    static const char * COIN_PROFILER_COUNTERS;
   };
 
   static void variableArgsSanityCheck(void);
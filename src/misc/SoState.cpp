@@ -95,6 +95,7 @@
 #endif // HAVE_CONFIG_H
 
 #include "rendering/SoGL.h"
+#include "profiler/SoProfilerCountersP.h"
 
 // *************************************************************************
 
@@ -282,6 +283,7 @@ SoState::push(void)
   PRIVATE(this)->pushstore = PRIVATE(this)->pushstore->next;
   PRIVATE(this)->pushstore->elements.truncate(0);
   PRIVATE(this)->depth++;
+  SoProfilerCountersP::count(SoProfilerCounters::STATE_PUSHES);
 }
 
 /*!
@@ -50,6 +50,7 @@
 #include "AudioTools.cpp"
 #include "CoinResources.cpp"
 #include "CoinStaticObjectInDLL.cpp"
+#include "SbFlatHash.cpp"
 #include "SoAudioDevice.cpp"
 #include "SoBaseP.cpp"
 #include "SoChildList.cpp"
@@ -279,6 +279,9 @@ public:
   void handleEventRectangle(SoHandleEventAction * action);
   void handleEventLasso(SoHandleEventAction * action);
 
+  void setupOffscreenShape(SoCallbackAction * action);
+  void setOffscreenColor(SbBool renderAsBlack);
+
   void addTriangleToOffscreenBuffer(SoCallbackAction * action,
                                     const SoPrimitiveVertex * v1,
                                     const SoPrimitiveVertex * v2,
@@ -319,6 +322,12 @@ public:
 
   SoCallbackAction::Response testShape(SoCallbackAction * action, const SoShape * shape);
 
+  SbBool projectShapeBBox(SoCallbackAction * action,
+                          const SbMatrix & projmatrix,
+                          const SoShape * shape,
+                          SbVec2s * projpts,
+                          SbBox2s & shapebbox);
+
   SoCallbackAction::Response testBBox(SoCallbackAction * action,
                                       const SbMatrix & projmatrix,
                                       const SoShape * shape,
@@ -393,6 +402,44 @@ public:
     }
   } runningselection;
 
+  // A screen space index of the lasso polygon, built when a selection
+  // is performed. isInside() looks points up in a mask with the
+  // result of point_in_poly() for each pixel in the bounding box of
+  // the lasso, and the intersection tests only test the lasso edges
+  // in the grid cells that the primitive overlaps.
+  class LassoIndex {
+  public:
+    LassoIndex(void);
+    ~LassoIndex();
+
+    void build(const SbList <SbVec2s> & coords, const SbBool accelerate);
+    void clear(void);
+
+    SbBool isInside(const SbVec2s & p) const;
+    SbBool lineIntersect(const SbVec2s & p0, const SbVec2s & p1,
+                         const SbBool checkcontained) const;
+    SbBool triangleIntersect(const SbVec2s & v0, const SbVec2s & v1,
+                             const SbVec2s & v2) const;
+    SbBool boxInside(const SbBox2s & box) const;
+
+  private:
+    SbBool getCells(const SbBox2s & box, int & cx0, int & cy0,
+                    int & cx1, int & cy1) const;
+
+    const SbVec2s * coords;
+    int numcoords;
+    int minx, miny, maxx, maxy;
+    unsigned char * mask;
+    int cellsize;
+    int numcellsx, numcellsy;
+    int * cellstart; // index of the first edge of each cell in celledges
+    int * celledges; // edge i goes from coords[i-1] to coords[i]
+  } lassoindex;
+  // FALSE when the lasso index and the shape bounding box tests are
+  // disabled with COIN_SOEXTSELECTION_LASSO_INDEX=0, for comparing
+  // against the plain polygon tests
+  SbBool useindex;
+
   // Note: Microsoft Visual C++ 6.0 needs to have a type definition
   // and an explicit variable declaration, just using
   //     struct { ... } structname;
@@ -410,6 +457,7 @@ public:
     SbBool onlyrect;
     SbBool allshapes;
     SbBool hasgeometry;
+    SbBool offscreensetup;
   } primcbdata_t;
   primcbdata_t primcbdata;
 
@@ -580,32 +628,53 @@ line_line_intersect(const SbVec2s &p00, const SbVec2s & p01,
 // The following code is by Randolph Franklin,
 // it returns 1 for interior points and 0 for exterior points.
 // http://astronomy.swin.edu.au/pbourke/geometry/insidepoly/
+//
+// The test is split in two, so that SoExtSelectionP::LassoIndex can
+// find the same crossings for a whole row of pixels at a time.
+
+// returns TRUE if the edge from pi to pj crosses the horizontal line at y
+static inline SbBool
+lasso_edge_spans(const SbVec2s & pi, const SbVec2s & pj, const float y)
+{
+  const float piy = (float) pi[1];
+  const float pjy = (float) pj[1];
+  return ((piy <= y) && (y < pjy)) || ((pjy <= y) && (y < piy));
+}
+
+// returns the x coordinate where the edge from pi to pj crosses the
+// horizontal line at y
+static inline float
+lasso_edge_crossing(const SbVec2s & pi, const SbVec2s & pj, const float y)
+{
+  const float pix = (float) pi[0];
+  const float piy = (float) pi[1];
+  const float pjx = (float) pj[0];
+  const float pjy = (float) pj[1];
+  return (pjx - pix) * (y - piy) / (pjy - piy) + pix;
+}
 
 static SbBool
-point_in_poly(const SbList <SbVec2s> & coords, const SbVec2s & point)
+point_in_poly(const SbVec2s * coords, const int npol, const SbVec2s & point)
 {
   int i, j;
   SbBool c = FALSE;
-  int npol = coords.getLength();
   float x = (float) point[0];
   float y = (float) point[1];
-  SbVec2f pi, pj;
 
   for (i = 0, j = npol-1; i < npol; j = i++) {
-
-    pi[0] = (float) coords[i][0];
-    pi[1] = (float) coords[i][1];
-    pj[0] = (float) coords[j][0];
-    pj[1] = (float) coords[j][1];
-
-    if ((((pi[1] <= y) && (y < pj[1])) ||
-         ((pj[1] <= y) && (y < pi[1]))) &&
-        (x < (pj[0] - pi[0]) * (y - pi[1]) / (pj[1] - pi[1]) + pi[0]))
+    if (lasso_edge_spans(coords[i], coords[j], y) &&
+        (x < lasso_edge_crossing(coords[i], coords[j], y)))
       c = !c;
   }
   return c;
 }
 
+static SbBool
+point_in_poly(const SbList <SbVec2s> & coords, const SbVec2s & point)
+{
+  return point_in_poly(coords.getArrayPtr(), coords.getLength(), point);
+}
+
 // do a bounding box rejection test before calling this method. It's not fast,
 // but testing will usually (always) be done on polygon vs triangle in
 // which case it should be pretty fast.
@@ -646,38 +715,6 @@ poly_poly_intersect(const SbList <SbVec2s> & poly1,
   return FALSE;
 }
 
-static SbBool
-poly_line_intersect(const SbList <SbVec2s> & poly,
-                    const SbVec2s & p0,
-                    const SbVec2s & p1,
-                    const SbBool checkcontained = TRUE)
-{
-  if (checkcontained && point_in_poly(poly, p0)) return TRUE;
-  if (checkcontained && point_in_poly(poly, p1)) return TRUE;
-
-  int n = poly.getLength();
-  SbVec2s prev = poly[n-1];
-  for (int i = 0; i < n; i++) {
-    if (line_line_intersect(prev, poly[i], p0, p1)) return TRUE;
-    prev = poly[i];
-  }
-  return FALSE;
-}
-
-// do a bounding box rejection test before calling this method
-static SbBool
-poly_tri_intersect(const SbList <SbVec2s> & poly,
-                   const SbVec2s & v0,
-                   const SbVec2s & v1,
-                   const SbVec2s & v2)
-{
-  SbList <SbVec2s> poly2;
-  poly2.append(v0);
-  poly2.append(v1);
-  poly2.append(v2);
-  return poly_poly_intersect(poly, poly2);
-}
-
 // only used by polyprojboxintersect()
 static SbBool
 test_quad_intersect(const SbList <SbVec2s> & poly,
@@ -725,6 +762,249 @@ poly_projbox_intersect(const SbList <SbVec2s> & poly,
 
 // *************************************************************************
 
+// The mask is only made for lassos covering up to this many pixels,
+// larger lassos use point_in_poly() directly.
+#define LASSOINDEX_MAXMASKSIZE (16 * 1024 * 1024)
+// The grid has cells of at least this size, and no more than 64 cells
+// in each direction.
+#define LASSOINDEX_MINCELLSIZE 16
+#define LASSOINDEX_MAXCELLS 64
+
+SoExtSelectionP::LassoIndex::LassoIndex(void)
+  : coords(NULL), numcoords(0), mask(NULL), cellstart(NULL), celledges(NULL)
+{
+}
+
+SoExtSelectionP::LassoIndex::~LassoIndex()
+{
+  this->clear();
+}
+
+void
+SoExtSelectionP::LassoIndex::clear(void)
+{
+  delete[] this->mask;
+  delete[] this->cellstart;
+  delete[] this->celledges;
+  this->mask = NULL;
+  this->cellstart = NULL;
+  this->celledges = NULL;
+  this->coords = NULL;
+  this->numcoords = 0;
+}
+
+// Without accelerate, there is no mask and all the edges are in one
+// cell, so the tests are the same as the plain polygon tests.
+void
+SoExtSelectionP::LassoIndex::build(const SbList <SbVec2s> & coordlist,
+                                   const SbBool accelerate)
+{
+  this->clear();
+  this->coords = coordlist.getArrayPtr();
+  this->numcoords = coordlist.getLength();
+  const int n = this->numcoords;
+  if (n == 0) return;
+
+  int i, j;
+  this->minx = this->maxx = this->coords[0][0];
+  this->miny = this->maxy = this->coords[0][1];
+  for (i = 1; i < n; i++) {
+    this->minx = SbMin(this->minx, (int) this->coords[i][0]);
+    this->maxx = SbMax(this->maxx, (int) this->coords[i][0]);
+    this->miny = SbMin(this->miny, (int) this->coords[i][1]);
+    this->maxy = SbMax(this->maxy, (int) this->coords[i][1]);
+  }
+  const int width = this->maxx - this->minx + 1;
+  const int height = this->maxy - this->miny + 1;
+
+  // Find where the lasso edges cross each row of pixels, and mark the
+  // pixels with an odd number of crossings to the right of them.
+  if (accelerate && double(width) * double(height) <= LASSOINDEX_MAXMASKSIZE) {
+    this->mask = new unsigned char[width * height];
+    SbList <float> crossings;
+    for (int y = this->miny; y <= this->maxy; y++) {
+      const float fy = (float) y;
+      crossings.truncate(0);
+      for (i = 0, j = n-1; i < n; j = i++) {
+        if (lasso_edge_spans(this->coords[i], this->coords[j], fy)) {
+          const float x = lasso_edge_crossing(this->coords[i], this->coords[j], fy);
+          int k = crossings.getLength();
+          crossings.append(x);
+          while (k > 0 && crossings[k-1] > x) {
+            crossings[k] = crossings[k-1];
+            k--;
+          }
+          crossings[k] = x;
+        }
+      }
+      const int numcrossings = crossings.getLength();
+      unsigned char * row = this->mask + (y - this->miny) * width;
+      int k = 0;
+      for (int x = this->minx; x <= this->maxx; x++) {
+        const float fx = (float) x;
+        while (k < numcrossings && !(fx < crossings[k])) k++;
+        row[x - this->minx] = (unsigned char) ((numcrossings - k) & 1);
+      }
+    }
+  }
+
+  // Sort the edges into grid cells, from their bounding boxes.
+  this->cellsize = LASSOINDEX_MINCELLSIZE;
+  while (width > this->cellsize * LASSOINDEX_MAXCELLS ||
+         height > this->cellsize * LASSOINDEX_MAXCELLS) {
+    this->cellsize *= 2;
+  }
+  if (!accelerate) this->cellsize = SbMax(width, height);
+  this->numcellsx = (width + this->cellsize - 1) / this->cellsize;
+  this->numcellsy = (height + this->cellsize - 1) / this->cellsize;
+  const int numcells = this->numcellsx * this->numcellsy;
+  this->cellstart = new int[numcells + 1];
+  for (i = 0; i <= numcells; i++) this->cellstart[i] = 0;
+
+  int pass, cx, cy, cx0, cy0, cx1, cy1;
+  for (pass = 0; pass < 2; pass++) {
+    for (i = 0, j = n-1; i < n; j = i++) {
+      SbBox2s edgebox;
+      edgebox.extendBy(this->coords[j]);
+      edgebox.extendBy(this->coords[i]);
+      (void) this->getCells(edgebox, cx0, cy0, cx1, cy1);
+      for (cy = cy0; cy <= cy1; cy++) {
+        for (cx = cx0; cx <= cx1; cx++) {
+          const int cell = cy * this->numcellsx + cx;
+          if (pass == 0) this->cellstart[cell + 1]++;
+          else this->celledges[this->cellstart[cell + 1]++] = i;
+        }
+      }
+    }
+    if (pass == 0) {
+      for (i = 0; i < numcells; i++) this->cellstart[i + 1] += this->cellstart[i];
+      this->celledges = new int[this->cellstart[numcells]];
+      // the second pass counts the edges again, from the start of each cell
+      for (i = numcells; i > 0; i--) this->cellstart[i] = this->cellstart[i - 1];
+    }
+  }
+}
+
+// finds the range of grid cells overlapped by box, returns FALSE if
+// box is outside the lasso bounding box
+SbBool
+SoExtSelectionP::LassoIndex::getCells(const SbBox2s & box, int & cx0, int & cy0,
+                                      int & cx1, int & cy1) const
+{
+  const SbVec2s & bmin = box.getMin();
+  const SbVec2s & bmax = box.getMax();
+  if (bmax[0] < this->minx || bmin[0] > this->maxx ||
+      bmax[1] < this->miny || bmin[1] > this->maxy) return FALSE;
+
+  cx0 = (SbMax((int) bmin[0], this->minx) - this->minx) / this->cellsize;
+  cy0 = (SbMax((int) bmin[1], this->miny) - this->miny) / this->cellsize;
+  cx1 = (SbMin((int) bmax[0], this->maxx) - this->minx) / this->cellsize;
+  cy1 = (SbMin((int) bmax[1], this->maxy) - this->miny) / this->cellsize;
+  return TRUE;
+}
+
+// same result as point_in_poly() for the lasso
+SbBool
+SoExtSelectionP::LassoIndex::isInside(const SbVec2s & p) const
+{
+  if (p[0] < this->minx || p[0] > this->maxx ||
+      p[1] < this->miny || p[1] > this->maxy) return FALSE;
+  if (this->mask == NULL) return point_in_poly(this->coords, this->numcoords, p);
+  const int width = this->maxx - this->minx + 1;
+  return this->mask[(p[1] - this->miny) * width + (p[0] - this->minx)];
+}
+
+// returns TRUE if the line from p0 to p1 crosses the lasso, or if
+// checkcontained is TRUE and either end point is inside the lasso
+SbBool
+SoExtSelectionP::LassoIndex::lineIntersect(const SbVec2s & p0, const SbVec2s & p1,
+                                           const SbBool checkcontained) const
+{
+  if (checkcontained && this->isInside(p0)) return TRUE;
+  if (checkcontained && this->isInside(p1)) return TRUE;
+
+  SbBox2s linebox;
+  linebox.extendBy(p0);
+  linebox.extendBy(p1);
+  int cx0, cy0, cx1, cy1;
+  if (!this->getCells(linebox, cx0, cy0, cx1, cy1)) return FALSE;
+
+  const int n = this->numcoords;
+  for (int cy = cy0; cy <= cy1; cy++) {
+    for (int cx = cx0; cx <= cx1; cx++) {
+      const int cell = cy * this->numcellsx + cx;
+      for (int e = this->cellstart[cell]; e < this->cellstart[cell + 1]; e++) {
+        const int i = this->celledges[e];
+        const SbVec2s & prev = this->coords[(i + n - 1) % n];
+        if (line_line_intersect(prev, this->coords[i], p0, p1)) return TRUE;
+      }
+    }
+  }
+  return FALSE;
+}
+
+// same result as poly_poly_intersect() for the lasso and the triangle
+SbBool
+SoExtSelectionP::LassoIndex::triangleIntersect(const SbVec2s & v0,
+                                               const SbVec2s & v1,
+                                               const SbVec2s & v2) const
+{
+  if (this->isInside(v0) || this->isInside(v1) || this->isInside(v2)) return TRUE;
+
+  SbBox2s tribox;
+  tribox.extendBy(v0);
+  tribox.extendBy(v1);
+  tribox.extendBy(v2);
+  int cx0, cy0, cx1, cy1;
+  if (!this->getCells(tribox, cx0, cy0, cx1, cy1)) return FALSE;
+
+  // lasso vertices inside the triangle, and edges crossing it, are
+  // all found in the cells overlapped by the triangle
+  const SbVec2s tri[3] = { v0, v1, v2 };
+  const int n = this->numcoords;
+  for (int cy = cy0; cy <= cy1; cy++) {
+    for (int cx = cx0; cx <= cx1; cx++) {
+      const int cell = cy * this->numcellsx + cx;
+      for (int e = this->cellstart[cell]; e < this->cellstart[cell + 1]; e++) {
+        const int i = this->celledges[e];
+        const SbVec2s & p = this->coords[i];
+        const SbVec2s & prev = this->coords[(i + n - 1) % n];
+        if (point_in_poly(tri, 3, p)) return TRUE;
+        if (line_line_intersect(prev, p, v2, v0)) return TRUE;
+        if (line_line_intersect(prev, p, v0, v1)) return TRUE;
+        if (line_line_intersect(prev, p, v1, v2)) return TRUE;
+      }
+    }
+  }
+  return FALSE;
+}
+
+// returns TRUE if all of the box is inside the lasso: the corners are
+// inside, and no lasso edge touches the sides
+SbBool
+SoExtSelectionP::LassoIndex::boxInside(const SbBox2s & box) const
+{
+  const SbVec2s & bmin = box.getMin();
+  const SbVec2s & bmax = box.getMax();
+  const SbVec2s corners[4] = {
+    bmin, SbVec2s(bmax[0], bmin[1]), bmax, SbVec2s(bmin[0], bmax[1])
+  };
+  int i;
+  for (i = 0; i < 4; i++) {
+    if (!this->isInside(corners[i])) return FALSE;
+  }
+  for (i = 0; i < 4; i++) {
+    if (this->lineIntersect(corners[i], corners[(i + 1) % 4], FALSE)) return FALSE;
+  }
+  return TRUE;
+}
+
+#undef LASSOINDEX_MAXMASKSIZE
+#undef LASSOINDEX_MINCELLSIZE
+#undef LASSOINDEX_MAXCELLS
+
+// *************************************************************************
+
 SO_NODE_SOURCE(SoExtSelection);
 
 // *************************************************************************
@@ -1569,13 +1849,15 @@ project_pt(const SbMatrix & projmatrix, const SbVec3f & v,
                  (short) SbClamp(normpt[1], -32768.0f, 32767.0f));
 }
 
-// test for intersection between bounding box and lasso/rectangle
-SoCallbackAction::Response
-SoExtSelectionP::testBBox(SoCallbackAction * action,
-                          const SbMatrix & projmatrix,
-                          const SoShape * shape,
-                          const SbBox2s & lassorect,
-                          const SbBool full)
+// project the corners of the shape bounding box to screen. Returns
+// FALSE if the bounding box is empty, or if some corner is behind the
+// camera, so that the projected box can't be trusted.
+SbBool
+SoExtSelectionP::projectShapeBBox(SoCallbackAction * action,
+                                  const SbMatrix & projmatrix,
+                                  const SoShape * shape,
+                                  SbVec2s * projpts,
+                                  SbBox2s & shapebbox)
 {
   SbBox3f bbox;
   SbVec3f center;
@@ -1591,23 +1873,36 @@ SoExtSelectionP::testBBox(SoCallbackAction * action,
   SbVec3f mincorner = bbox.getMin();
   SbVec3f maxcorner = bbox.getMax();
 
-  SbBox2s shapebbox;
-
-  SbVec2s vppt;
-  SbVec3f normpt;
   SbVec2s vpo = this->curvp.getViewportOriginPixels();
   SbVec2s vps = this->curvp.getViewportSizePixels();
 
-  SbVec2s projpts[8];
-
+  SbBool valid = !bbox.isEmpty();
   for (int i = 0; i < 8; i++) {
     SbVec3f corner(i & 1 ? maxcorner[0] : mincorner[0],
                    i & 2 ? maxcorner[1] : mincorner[1],
                    i & 4 ? maxcorner[2] : mincorner[2]);
-    vppt = project_pt(projmatrix, corner, vpo, vps);
-    projpts[i] = vppt;
-    shapebbox.extendBy(vppt);
+    const float w =
+      corner[0] * projmatrix[0][3] + corner[1] * projmatrix[1][3] +
+      corner[2] * projmatrix[2][3] + projmatrix[3][3];
+    if (!(w > 0.0f)) valid = FALSE;
+    projpts[i] = project_pt(projmatrix, corner, vpo, vps);
+    shapebbox.extendBy(projpts[i]);
   }
+  return valid;
+}
+
+// test for intersection between bounding box and lasso/rectangle
+SoCallbackAction::Response
+SoExtSelectionP::testBBox(SoCallbackAction * action,
+                          const SbMatrix & projmatrix,
+                          const SoShape * shape,
+                          const SbBox2s & lassorect,
+                          const SbBool full)
+{
+  SbBox2s shapebbox;
+  SbVec2s projpts[8];
+  (void) this->projectShapeBBox(action, projmatrix, shape, projpts, shapebbox);
+
   if (lassorect.intersect(shapebbox)) { // quick reject
     int i;
     int hit = 0;
@@ -1652,20 +1947,10 @@ SoExtSelectionP::testBBox(SoCallbackAction * action,
 SoCallbackAction::Response
 SoExtSelectionP::testPrimitives(SoCallbackAction * action,
                                 const SbMatrix & projmatrix,
-                                const SoShape * /* shape */,
+                                const SoShape * shape,
                                 const SbBox2s & lassorect,
                                 const SbBool full)
 {
-  // FIXME: consider quick reject based on bounding box for now we
-  // just initialize some variables, and trust that the user has a
-  // sensible scene graph so that shapes are culled in the separators.
-  // ????-??-?? pederb.
-  //
-  // FIXME: I believe what pederb mention above would be a _very_
-  // important optimization -- especially when using VISIBLE_SHAPES
-  // with a small rectangle/polygon selection in a huge scene.
-  // 20050309 mortene.
-
   this->primcbdata.fulltest = full;
   this->primcbdata.projmatrix = projmatrix;
   this->primcbdata.lassorect = lassorect;
@@ -1676,6 +1961,41 @@ SoExtSelectionP::testPrimitives(SoCallbackAction * action,
   this->primcbdata.abort = FALSE;
   this->primcbdata.onlyrect = (this->runningselection.mode == SelectionState::LASSO);
   this->primcbdata.hasgeometry = FALSE;
+  this->primcbdata.offscreensetup = FALSE;
+
+  // Use the screen space bounding box to skip generating primitives
+  // when the result is known from the box alone.
+  SbBox2s shapebbox;
+  SbVec2s projpts[8];
+  if (this->useindex &&
+      this->projectShapeBBox(action, projmatrix, shape, projpts, shapebbox)) {
+    // Nothing in the shape can be inside the lasso. Leave a margin
+    // for point sizes and for the rounding of projected vertices.
+    const short margin = (short)
+      (2.0f + SbMax(action->getPointSize(), action->getLineWidth()));
+    SbBox2s grownbbox(shapebbox.getMin() - SbVec2s(margin, margin),
+                      shapebbox.getMax() + SbVec2s(margin, margin));
+    if (!lassorect.intersect(grownbbox)) {
+      this->primcbdata.hit = FALSE;
+      this->primcbdata.allhit = FALSE;
+      return SoCallbackAction::PRUNE;
+    }
+    // All of the shape is inside the lasso. This can only be used
+    // when the primitives don't need to be rendered or passed on to
+    // the filter callbacks.
+    if (this->primcbdata.allshapes &&
+        !this->triangleFilterCB &&
+        !this->lineFilterCB &&
+        !this->pointFilterCB &&
+        shape->isOfType(SoVertexShape::getClassTypeId()) &&
+        this->lassoindex.boxInside(shapebbox)) {
+      this->primcbdata.hit = TRUE;
+      this->primcbdata.allhit = TRUE;
+      this->primcbdata.hasgeometry = TRUE;
+      return SoCallbackAction::PRUNE;
+    }
+  }
+
   // signal to callback action that we want to generate primitives for
   // this shape
   return SoCallbackAction::CONTINUE;
@@ -1769,36 +2089,36 @@ SoExtSelectionP::triangleCB(void * userData,
   if(thisp->primcbdata.fulltest) { // entire triangle must be inside lasso
 
     if(thisp->runningselection.mode == SelectionState::RECTANGLE){ // Rectangle check only
-      if (!thisp->primcbdata.lassorect.intersect(p0) || (!point_in_poly(thisp->runningselection.coords, p0))) {
+      if (!thisp->primcbdata.lassorect.intersect(p0) || (!thisp->lassoindex.isInside(p0))) {
         thisp->primcbdata.allhit = FALSE;
         return;
       }
-      if (!thisp->primcbdata.lassorect.intersect(p1) || (!point_in_poly(thisp->runningselection.coords, p1))) {
+      if (!thisp->primcbdata.lassorect.intersect(p1) || (!thisp->lassoindex.isInside(p1))) {
         thisp->primcbdata.allhit = FALSE;
         return;
       }
-      if (!thisp->primcbdata.lassorect.intersect(p2) || (!point_in_poly(thisp->runningselection.coords, p2))) {
+      if (!thisp->primcbdata.lassorect.intersect(p2) || (!thisp->lassoindex.isInside(p2))) {
         thisp->primcbdata.allhit = FALSE;
         return;
       }
     }
 
-    if(poly_line_intersect(thisp->runningselection.coords, p0, p1, FALSE) || !point_in_poly(thisp->runningselection.coords, p0)) {
+    if(thisp->lassoindex.lineIntersect(p0, p1, FALSE) || !thisp->lassoindex.isInside(p0)) {
       thisp->primcbdata.allhit = FALSE;
       return;
     }
-    if(poly_line_intersect(thisp->runningselection.coords, p1, p2, FALSE) || !point_in_poly(thisp->runningselection.coords, p1)) {
+    if(thisp->lassoindex.lineIntersect(p1, p2, FALSE) || !thisp->lassoindex.isInside(p1)) {
       thisp->primcbdata.allhit = FALSE;
       return;
     }
-    if(poly_line_intersect(thisp->runningselection.coords, p2, p0, FALSE) || !point_in_poly(thisp->runningselection.coords, p2)) {
+    if(thisp->lassoindex.lineIntersect(p2, p0, FALSE) || !thisp->lassoindex.isInside(p2)) {
       thisp->primcbdata.allhit = FALSE;
       return;
     }
 
 
   } else { // some part of the triangle must be inside lasso
-    if (!poly_tri_intersect(thisp->runningselection.coords, p0, p1, p2)) {
+    if (!thisp->lassoindex.triangleIntersect(p0, p1, p2)) {
       thisp->primcbdata.allhit = FALSE;
       return;
     }
@@ -1854,23 +2174,15 @@ SoExtSelectionP::triangleCB(void * userData,
 
 
 
+// set up the offscreen rendering state for the current shape. This
+// is done for the first primitive of each shape, as shapes can change
+// the state (e.g. shape hints for VRML geometry) before generating
+// primitives.
 void
-SoExtSelectionP::addTriangleToOffscreenBuffer(SoCallbackAction * action,
-                                              const SoPrimitiveVertex * v1,
-                                              const SoPrimitiveVertex * v2,
-                                              const SoPrimitiveVertex * v3,
-                                              SbBool renderAsBlack)
+SoExtSelectionP::setupOffscreenShape(SoCallbackAction * action)
 {
-  // FIXME: there is a likely major optimization that can be done when
-  // rendering: use the NVidia occlusion culling extension, if
-  // available. That most likely needs to be done on a shape basis (or
-  // if possible: per separator) for it to have a positive effect,
-  // though. 20030824 mortene.
-
-  assert(!this->applyonlyonselectedtriangles);
-
-  if(primcbdata.allshapes)
-    return;
+  if (this->primcbdata.offscreensetup) return;
+  this->primcbdata.offscreensetup = TRUE;
 
   SoState * state = action->getState();
   SbMatrix proj, affine;
@@ -1884,6 +2196,7 @@ SoExtSelectionP::addTriangleToOffscreenBuffer(SoCallbackAction * action,
   glLoadMatrixf((float *)affine);
 
   glDepthFunc(GL_LEQUAL);
+  glPointSize(SoPointSizeElement::get(state));
 
   // Check vertex ordrering
   SoShapeHintsElement::VertexOrdering vertexorder;
@@ -1891,7 +2204,6 @@ SoExtSelectionP::addTriangleToOffscreenBuffer(SoCallbackAction * action,
   SoShapeHintsElement::FaceType facetype; //Unused.
   SoShapeHintsElement::get(state, vertexorder, shapetype, facetype);
 
-
   if(shapetype == SoShapeHintsElement::SOLID){
     if(vertexorder == SoShapeHintsElement::CLOCKWISE){
       glFrontFace(GL_CW);
@@ -1905,9 +2217,13 @@ SoExtSelectionP::addTriangleToOffscreenBuffer(SoCallbackAction * action,
   } else {
     glDisable(GL_CULL_FACE);
   }
+}
 
-  glBegin(GL_TRIANGLES);
-
+// set the color for the next primitive to its id, or to black for
+// primitives that only hide others
+void
+SoExtSelectionP::setOffscreenColor(SbBool renderAsBlack)
+{
   if(!renderAsBlack){
     glColor3ub((unsigned char) (this->offscreencolorcounter>>(8+8)),
                (unsigned char) (this->offscreencolorcounter>>(8)),
@@ -1916,7 +2232,30 @@ SoExtSelectionP::addTriangleToOffscreenBuffer(SoCallbackAction * action,
   } else {
     glColor3f(0,0,0);
   }
+}
+
+void
+SoExtSelectionP::addTriangleToOffscreenBuffer(SoCallbackAction * action,
+                                              const SoPrimitiveVertex * v1,
+                                              const SoPrimitiveVertex * v2,
+                                              const SoPrimitiveVertex * v3,
+                                              SbBool renderAsBlack)
+{
+  // FIXME: there is a likely major optimization that can be done when
+  // rendering: use the NVidia occlusion culling extension, if
+  // available. That most likely needs to be done on a shape basis (or
+  // if possible: per separator) for it to have a positive effect,
+  // though. 20030824 mortene.
+
+  assert(!this->applyonlyonselectedtriangles);
+
+  if(primcbdata.allshapes)
+    return;
 
+  this->setupOffscreenShape(action);
+
+  glBegin(GL_TRIANGLES);
+  this->setOffscreenColor(renderAsBlack);
   glVertex3fv(v1->getPoint().getValue());
   glVertex3fv(v2->getPoint().getValue());
   glVertex3fv(v3->getPoint().getValue());
@@ -1981,24 +2320,24 @@ SoExtSelectionP::lineSegmentCB(void *userData,
 
 
     if (thisp->runningselection.mode == SelectionState::RECTANGLE){ // Rectangle check only
-      if (!thisp->primcbdata.lassorect.intersect(p0) || (!point_in_poly(thisp->runningselection.coords, p0))) {
+      if (!thisp->primcbdata.lassorect.intersect(p0) || (!thisp->lassoindex.isInside(p0))) {
         thisp->primcbdata.allhit = FALSE;
         return;
       }
 
-      if (!thisp->primcbdata.lassorect.intersect(p1) || (!point_in_poly(thisp->runningselection.coords, p1))) {
+      if (!thisp->primcbdata.lassorect.intersect(p1) || (!thisp->lassoindex.isInside(p1))) {
         thisp->primcbdata.allhit = FALSE;
         return;
       }
     }
 
-    if (poly_line_intersect(thisp->runningselection.coords, p0, p1, FALSE) || !point_in_poly(thisp->runningselection.coords, p0)) {
+    if (thisp->lassoindex.lineIntersect(p0, p1, FALSE) || !thisp->lassoindex.isInside(p0)) {
       thisp->primcbdata.allhit = FALSE;
       return;
     }
   }
   else {
-    if (!poly_line_intersect(thisp->runningselection.coords, p0, p1, TRUE)) {
+    if (!thisp->lassoindex.lineIntersect(p0, p1, TRUE)) {
       thisp->primcbdata.allhit = FALSE;
       return;
     }
@@ -2059,31 +2398,10 @@ SoExtSelectionP::addLineToOffscreenBuffer(SoCallbackAction * action,
   if(primcbdata.allshapes)
     return;
 
-  SoState * state = action->getState();
-  SbMatrix proj, affine;
-  const SbMatrix & mm = SoModelMatrixElement::get(state);
-  offscreenviewvolume.getMatrices(affine, proj);
-  affine.multLeft(mm);
-
-  glMatrixMode(GL_PROJECTION);
-  glLoadMatrixf((float *)proj);
-  glMatrixMode(GL_MODELVIEW);
-  glLoadMatrixf((float *)affine);
-
-  glDepthFunc(GL_LEQUAL);
-
+  this->setupOffscreenShape(action);
 
   glBegin(GL_LINES);
-
-  if(!renderAsBlack){
-    glColor3ub((unsigned char) (this->offscreencolorcounter>>(8+8)),
-               (unsigned char) (this->offscreencolorcounter>>(8)),
-               (unsigned char) (this->offscreencolorcounter));
-    ++offscreencolorcounter;
-  } else {
-    glColor3f(0,0,0);
-  }
-
+  this->setOffscreenColor(renderAsBlack);
   glVertex3fv(v1->getPoint().getValue());
   glVertex3fv(v2->getPoint().getValue());
   glEnd();
@@ -2146,12 +2464,12 @@ SoExtSelectionP::pointCB(void *userData,
   if (thisp->runningselection.mode == SelectionState::RECTANGLE){ // Rectangle check only
 
     SbBool onlyrect = thisp->primcbdata.onlyrect;
-    if (!thisp->primcbdata.lassorect.intersect(p) || (onlyrect || !point_in_poly(thisp->runningselection.coords, p))) {
+    if (!thisp->primcbdata.lassorect.intersect(p) || (onlyrect || !thisp->lassoindex.isInside(p))) {
       thisp->primcbdata.allhit = FALSE;
       return;
     }
 
-  } else if(!point_in_poly(thisp->runningselection.coords, p)) {
+  } else if(!thisp->lassoindex.isInside(p)) {
     thisp->primcbdata.allhit = FALSE;
     return;
   }
@@ -2209,32 +2527,10 @@ SoExtSelectionP::addPointToOffscreenBuffer(SoCallbackAction * action,
   if(primcbdata.allshapes)
     return;
 
-  SoState * state = action->getState();
-  SbMatrix proj, affine;
-  const SbMatrix & mm = SoModelMatrixElement::get(state);
-  offscreenviewvolume.getMatrices(affine, proj);
-  affine.multLeft(mm);
-
-  glMatrixMode(GL_PROJECTION);
-  glLoadMatrixf((float *)proj);
-  glMatrixMode(GL_MODELVIEW);
-  glLoadMatrixf((float *)affine);
-
-  glDepthFunc(GL_LEQUAL);
-  glPointSize(SoPointSizeElement::get(action->getState()));
-
+  this->setupOffscreenShape(action);
 
   glBegin(GL_POINTS);
-
-  if(!renderAsBlack){
-    glColor3ub((unsigned char) (this->offscreencolorcounter>>(8+8)),
-               (unsigned char) (this->offscreencolorcounter>>(8)),
-               (unsigned char) (this->offscreencolorcounter));
-    ++offscreencolorcounter;
-  } else {
-    glColor3f(0,0,0);
-  }
-
+  this->setOffscreenColor(renderAsBlack);
   glVertex3fv(v1->getPoint().getValue());
   glEnd();
 
@@ -2453,13 +2749,14 @@ SoExtSelectionP::checkOffscreenRendererCapabilities()
   const double maxcols = pow(2.0, double(COLORBITS));
 #endif
 
-  // We do not want to use too many bits, as we later need to allocate
-  // an array which is (maximumcolorcounter / 8) bytes large, using 1
-  // bit for each primitive in the scene to detect whether visible or
-  // not. So we set a limit at ~4 million, which should be enough to
-  // do even really heavy scenes in a single pass, while this will
-  // allocate a buffer of not more than ~0.5 MB.
-  const unsigned int threshold = (unsigned int)(1 << 22);
+  // The offscreen buffer is read back with 8 bits for each of the
+  // RGB components, so we can't use more than 24 bits. We later need
+  // to allocate an array which is (maximumcolorcounter / 8) bytes
+  // large, using 1 bit for each primitive in the scene to detect
+  // whether visible or not. With the limit at ~16 million, heavy
+  // scenes are done in a single pass, while this will allocate a
+  // buffer of not more than 2 MB.
+  const unsigned int threshold = (unsigned int)((1 << 24) - 1);
 
   this->maximumcolorcounter =
     (maxcols > threshold) ? threshold : (unsigned int)maxcols;
@@ -2547,6 +2844,7 @@ void
 SoExtSelectionP::selectAndReset(SoHandleEventAction * action)
 {
   this->performSelection(action);
+  this->lassoindex.clear();
   this->runningselection.reset();
 }
 
@@ -2575,6 +2873,10 @@ SoExtSelectionP::performSelection(SoHandleEventAction * action)
     this->runningselection.coords.append(SbVec2s(p0[0], p1[1]));
   }
 
+  const char * env = coin_getenv("COIN_SOEXTSELECTION_LASSO_INDEX");
+  this->useindex = !env || atoi(env) > 0;
+  this->lassoindex.build(this->runningselection.coords, this->useindex);
+
   //Send signal to client that tris are coming up,
   PUBLIC(this)->startCBList->invokeCallbacks(PUBLIC(this));
 
@@ -2777,3 +3079,158 @@ SoExtSelectionP::validateViewportBBox(SbBox2s & bbox,
 
 #undef PRIVATE
 #undef PUBLIC
+
+#ifdef COIN_TEST_SUITE
+
+#include <cmath>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/actions/SoHandleEventAction.h>
+#include <Inventor/events/SoLocation2Event.h>
+#include <Inventor/events/SoMouseButtonEvent.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoExtSelection.h>
+#include <Inventor/nodes/SoFaceSet.h>
+#include <Inventor/nodes/SoLineSet.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoPointSet.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+static void
+extselection_send(SoHandleEventAction & action, SoNode * root, SoEvent * event,
+                  const SbVec2s & pos)
+{
+  event->setPosition(pos);
+  action.setEvent(event);
+  action.apply(root);
+}
+
+static void
+extselection_press(SoHandleEventAction & action, SoNode * root,
+                   SoMouseButtonEvent::Button button, const SbVec2s & pos,
+                   SoButtonEvent::State state = SoButtonEvent::DOWN)
+{
+  SoMouseButtonEvent event;
+  event.setButton(button);
+  event.setState(state);
+  extselection_send(action, root, &event, pos);
+}
+
+// selects with a star shaped lasso or a rectangle, and returns the
+// selected shapes, sorted
+static SbList <SoNode *>
+extselection_select(SoExtSelection * root, SoHandleEventAction & action)
+{
+  root->deselectAll();
+  if (root->lassoType.getValue() == SoExtSelection::LASSO) {
+    for (int i = 0; i < 14; i++) {
+      const double a = i * M_PI / 7.0;
+      const double r = (i & 1) ? 70.0 : 150.0;
+      extselection_press(action, root, SoMouseButtonEvent::BUTTON1,
+                         SbVec2s(short(200 + r * cos(a)), short(200 + r * sin(a))));
+    }
+    extselection_press(action, root, SoMouseButtonEvent::BUTTON2, SbVec2s(350, 200));
+  }
+  else {
+    extselection_press(action, root, SoMouseButtonEvent::BUTTON1, SbVec2s(90, 120));
+    SoLocation2Event move;
+    extselection_send(action, root, &move, SbVec2s(290, 310));
+    extselection_press(action, root, SoMouseButtonEvent::BUTTON1, SbVec2s(290, 310),
+                       SoButtonEvent::UP);
+  }
+  SbList <SoNode *> selected;
+  for (int i = 0; i < root->getNumSelected(); i++) {
+    SoNode * tail = root->getPath(i)->getTail();
+    int j = selected.getLength();
+    selected.append(tail);
+    while (j > 0 && selected[j-1] > tail) {
+      selected[j] = selected[j-1];
+      j--;
+    }
+    selected[j] = tail;
+  }
+  return selected;
+}
+
+BOOST_AUTO_TEST_CASE(lassoIndexMatchesPolygonTests)
+{
+  SoExtSelection * root = new SoExtSelection;
+  root->ref();
+  root->lassoMode = SoExtSelection::ALL_SHAPES;
+  root->policy = SoSelection::SHIFT;
+
+  SoOrthographicCamera * camera = new SoOrthographicCamera;
+  camera->position.setValue(10.0f, 10.0f, 10.0f);
+  camera->height = 20.0f;
+  root->addChild(camera);
+
+  // shapes of different kinds and sizes, scattered over the view,
+  // many of them crossing the lasso
+  uint32_t seed = 1;
+  for (int i = 0; i < 300; i++) {
+    float v[9];
+    for (int k = 0; k < 9; k++) {
+      seed = seed * 1664525u + 1013904223u;
+      v[k] = float(seed >> 8) / float(1 << 24);
+    }
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * translation = new SoTranslation;
+    translation->translation.setValue(20.0f * v[0], 20.0f * v[1], 0.0f);
+    sep->addChild(translation);
+    const float size = 0.2f + 3.0f * v[2] * v[2];
+    SoCoordinate3 * coords = new SoCoordinate3;
+    coords->point.set1Value(0, 0.0f, 0.0f, 0.0f);
+    coords->point.set1Value(1, size * v[3], size * (v[4] - 0.5f), 0.0f);
+    coords->point.set1Value(2, size * (v[5] - 0.5f), size * v[6], 0.0f);
+    coords->point.set1Value(3, -size * v[7], -size * v[8], 0.0f);
+    sep->addChild(coords);
+    switch (i % 4) {
+    case 0: sep->addChild(new SoFaceSet); break;
+    case 1: sep->addChild(new SoLineSet); break;
+    case 2: sep->addChild(new SoPointSet); break;
+    default: {
+      SoCube * cube = new SoCube;
+      cube->width = cube->height = cube->depth = size;
+      sep->addChild(cube);
+      break;
+    }
+    }
+    root->addChild(sep);
+  }
+
+  SoHandleEventAction action(SbViewportRegion(400, 400));
+  const SoExtSelection::LassoType types[] = {
+    SoExtSelection::LASSO, SoExtSelection::RECTANGLE
+  };
+  const SoExtSelection::LassoPolicy policies[] = {
+    SoExtSelection::PART, SoExtSelection::FULL,
+    SoExtSelection::PART_BBOX, SoExtSelection::FULL_BBOX
+  };
+  for (int t = 0; t < 2; t++) {
+    for (int p = 0; p < 4; p++) {
+      root->lassoType = types[t];
+      root->lassoPolicy = policies[p];
+      coin_setenv("COIN_SOEXTSELECTION_LASSO_INDEX", "0", TRUE);
+      const SbList <SoNode *> reference = extselection_select(root, action);
+      coin_unsetenv("COIN_SOEXTSELECTION_LASSO_INDEX");
+      const SbList <SoNode *> selected = extselection_select(root, action);
+
+      BOOST_CHECK_MESSAGE(reference.getLength() > 0 &&
+                          reference.getLength() < 300,
+                          "lasso type " << t << ", policy " << p <<
+                          " selects " << reference.getLength() << " shapes");
+      BOOST_CHECK_EQUAL(selected.getLength(), reference.getLength());
+      SbBool same = selected.getLength() == reference.getLength();
+      for (int i = 0; same && i < selected.getLength(); i++) {
+        same = selected[i] == reference[i];
+      }
+      BOOST_CHECK_MESSAGE(same, "lasso type " << t << ", policy " << p <<
+                          " selects the same shapes with and without the index");
+    }
+  }
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -595,6 +595,7 @@ SoGroup::getBoundingBox(SoGetBoundingBoxAction * action)
 void
 SoGroupP::childGLRender(SoGroup * COIN_UNUSED_ARG(thisp), SoNode * child, SoGLRenderAction * action)
 {
+  SoProfilerCountersP::count(SoProfilerCounters::NODES_TRAVERSED);
   child->GLRender(action);
 }
 
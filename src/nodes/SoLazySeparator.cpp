@@ -0,0 +1,378 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoLazySeparator SoLazySeparator.h Inventor/nodes/SoLazySeparator.h
+  \brief The SoLazySeparator class is a separator which loads its children on demand.
+
+  \ingroup coin_nodes
+
+  SoLazySeparator nodes are written by SoChunkedFile::write() in place
+  of the subgraphs that are stored as separate chunks in a chunked
+  file. When such a file is read, only the lazy separators are
+  created, and a chunk is not read from disk until the lazy separator
+  holding it is rendered inside the view volume, picked, or traversed
+  by an action which needs all the geometry (e.g. SoCallbackAction or
+  SoWriteAction).
+
+  The SoLazySeparator::boundingBox field holds the bounding box of the
+  chunk, which is used for view frustum culling, pick culling and
+  SoGetBoundingBoxAction before the chunk has been loaded. Once
+  loaded, the chunk is the single child of the lazy separator, and
+  the node behaves like a plain SoSeparator.
+
+  When rendered, the chunk is not added while the scene graph is being
+  traversed. Loading is deferred until the render traversal is done,
+  and the node is empty until then. Adding the chunk triggers a
+  redraw, so the chunk shows up in the next frame.
+
+  SoSearchAction and SoHandleEventAction do not trigger loading. Use
+  load() to force the chunk to be read, e.g. before searching the
+  subgraph.
+
+  <b>FILE FORMAT/DEFAULTS:</b>
+  \code
+    LazySeparator {
+        renderCaching AUTO
+        boundingBoxCaching AUTO
+        renderCulling AUTO
+        pickCulling AUTO
+        chunk -1
+        boundingBox <empty box>
+    }
+  \endcode
+
+  \sa SoChunkedFile
+  \COIN_CLASS_EXTENSION
+*/
+
+// *************************************************************************
+
+#include <Inventor/nodes/SoLazySeparator.h>
+
+#include <Inventor/SoChunkedFile.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoGetPrimitiveCountAction.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/elements/SoCullElement.h>
+#include <Inventor/errors/SoDebugError.h>
+#include <Inventor/misc/SoState.h>
+#include <Inventor/sensors/SoOneShotSensor.h>
+
+#include "nodes/SoSubNodeP.h"
+#include "coindefs.h"
+
+// *************************************************************************
+
+class SoLazySeparatorP {
+public:
+  SoLazySeparatorP(void) : loaded(FALSE), loadsensor(NULL) { }
+  ~SoLazySeparatorP() { delete this->loadsensor; }
+
+  SbString containername;
+  SbBool loaded;
+  // loads the chunk after a render traversal that needed it
+  SoOneShotSensor * loadsensor;
+
+  static void loadCB(void * closure, SoSensor * sensor);
+};
+
+#define PRIVATE(obj) ((obj)->pimpl)
+
+void
+SoLazySeparatorP::loadCB(void * closure, SoSensor * COIN_UNUSED_ARG(sensor))
+{
+  (void) static_cast<SoLazySeparator *>(closure)->load();
+}
+
+// *************************************************************************
+
+/*!
+  \var SoSFInt32 SoLazySeparator::chunk
+
+  Index of the chunk in the container file holding the children of
+  this node. Default value is -1, which means there is nothing to
+  load.
+*/
+
+/*!
+  \var SoSFBox3f SoLazySeparator::boundingBox
+
+  Bounding box of the chunk, in the local coordinate system of the
+  node. Used for culling and bounding box calculations until the
+  chunk is loaded. An empty box disables culling.
+*/
+
+// *************************************************************************
+
+SO_NODE_SOURCE(SoLazySeparator);
+
+// *************************************************************************
+
+/*!
+  Constructor.
+*/
+SoLazySeparator::SoLazySeparator(void)
+{
+  SO_NODE_INTERNAL_CONSTRUCTOR(SoLazySeparator);
+
+  SO_NODE_ADD_FIELD(chunk, (-1));
+  SO_NODE_ADD_FIELD(boundingBox, (SbBox3f()));
+
+  PRIVATE(this) = new SoLazySeparatorP;
+}
+
+/*!
+  Destructor.
+*/
+SoLazySeparator::~SoLazySeparator()
+{
+  delete PRIVATE(this);
+}
+
+/*!
+  \copybrief SoBase::initClass(void)
+*/
+void
+SoLazySeparator::initClass(void)
+{
+  SO_NODE_INTERNAL_INIT_CLASS(SoLazySeparator, SO_FROM_COIN_4_0);
+}
+
+// *************************************************************************
+
+/*!
+  Sets the name of the chunked file to load the chunk from. This is
+  done automatically when the node is read from a file.
+*/
+void
+SoLazySeparator::setContainerName(const SbString & filename)
+{
+  PRIVATE(this)->containername = filename;
+}
+
+/*!
+  Returns the name of the chunked file the chunk will be loaded from.
+*/
+const SbString &
+SoLazySeparator::getContainerName(void) const
+{
+  return PRIVATE(this)->containername;
+}
+
+/*!
+  Returns \c TRUE if the children of this node are resident.
+*/
+SbBool
+SoLazySeparator::isLoaded(void) const
+{
+  return PRIVATE(this)->loaded;
+}
+
+/*!
+  Reads the chunk from the container file and adds it as a child of
+  this node. Returns \c TRUE if the chunk is loaded when the function
+  returns.
+*/
+SbBool
+SoLazySeparator::load(void)
+{
+  if (PRIVATE(this)->loaded) return TRUE;
+  if (PRIVATE(this)->containername.getLength() == 0 || this->chunk.getValue() < 0) {
+    return FALSE;
+  }
+
+  SoNode * node = SoChunkedFile::readChunk(PRIVATE(this)->containername.getString(),
+                                           this->chunk.getValue());
+  if (node == NULL) {
+    SoDebugError::postWarning("SoLazySeparator::load",
+                              "Unable to read chunk %d from '%s'.",
+                              this->chunk.getValue(),
+                              PRIVATE(this)->containername.getString());
+    // don't retry on every traversal
+    PRIVATE(this)->containername.makeEmpty();
+    return FALSE;
+  }
+  PRIVATE(this)->loaded = TRUE;
+  this->addChild(node);
+  return TRUE;
+}
+
+/*!
+  Removes the children of this node, to be reloaded from the container
+  file when needed again. Nothing is done if the chunk cannot be
+  reloaded.
+*/
+void
+SoLazySeparator::unload(void)
+{
+  if (!PRIVATE(this)->loaded || PRIVATE(this)->containername.getLength() == 0 ||
+      this->chunk.getValue() < 0) return;
+
+  PRIVATE(this)->loaded = FALSE;
+  this->removeAllChildren();
+}
+
+// *************************************************************************
+
+// Doc from superclass.
+void
+SoLazySeparator::doAction(SoAction * action)
+{
+  (void) this->load();
+  inherited::doAction(action);
+}
+
+// Doc from superclass.
+void
+SoLazySeparator::callback(SoCallbackAction * action)
+{
+  (void) this->load();
+  inherited::callback(action);
+}
+
+// Doc from superclass.
+void
+SoLazySeparator::getPrimitiveCount(SoGetPrimitiveCountAction * action)
+{
+  (void) this->load();
+  inherited::getPrimitiveCount(action);
+}
+
+/*!
+  The chunk is scheduled to be loaded after the traversal if the
+  stored bounding box is (partly) inside the view volume.
+*/
+void
+SoLazySeparator::GLRenderBelowPath(SoGLRenderAction * action)
+{
+  if (!PRIVATE(this)->loaded) {
+    const SbBox3f & box = this->boundingBox.getValue();
+    SoState * state = action->getState();
+    if (!box.isEmpty() &&
+        this->renderCulling.getValue() != SoSeparator::OFF &&
+        !SoCullElement::completelyInside(state) &&
+        SoCullElement::cullTest(state, box, TRUE)) {
+      return;
+    }
+    // adding children here would invalidate the caches of the
+    // separators being traversed, so leave it until the traversal
+    // is done
+    if (PRIVATE(this)->containername.getLength() && this->chunk.getValue() >= 0) {
+      if (PRIVATE(this)->loadsensor == NULL) {
+        PRIVATE(this)->loadsensor =
+          new SoOneShotSensor(SoLazySeparatorP::loadCB, this);
+      }
+      if (!PRIVATE(this)->loadsensor->isScheduled()) {
+        PRIVATE(this)->loadsensor->schedule();
+      }
+    }
+    return;
+  }
+  inherited::GLRenderBelowPath(action);
+}
+
+/*!
+  Uses the stored bounding box until the chunk has been loaded.
+*/
+void
+SoLazySeparator::getBoundingBox(SoGetBoundingBoxAction * action)
+{
+  if (!PRIVATE(this)->loaded && this->chunk.getValue() >= 0) {
+    const SbBox3f & box = this->boundingBox.getValue();
+    if (action->getCurPathCode() != SoAction::OFF_PATH && !box.isEmpty()) {
+      action->extendBy(box);
+      action->setCenter(box.getCenter(), TRUE);
+    }
+    return;
+  }
+  inherited::getBoundingBox(action);
+}
+
+/*!
+  The chunk is loaded if the pick ray intersects the stored bounding
+  box.
+*/
+void
+SoLazySeparator::rayPick(SoRayPickAction * action)
+{
+  if (!PRIVATE(this)->loaded) {
+    const SbBox3f & box = this->boundingBox.getValue();
+    if (!box.isEmpty() &&
+        this->pickCulling.getValue() != SoSeparator::OFF &&
+        action->hasWorldSpaceRay()) {
+      action->setObjectSpace();
+      if (!action->intersect(box, TRUE)) return;
+    }
+    if (!this->load()) return;
+  }
+  inherited::rayPick(action);
+}
+
+/*!
+  The chunk is loaded before writing, so that the complete scene is
+  written.
+*/
+void
+SoLazySeparator::write(SoWriteAction * action)
+{
+  (void) this->load();
+  inherited::write(action);
+}
+
+// Doc from superclass.
+void
+SoLazySeparator::copyContents(const SoFieldContainer * from,
+                              SbBool copyconnections)
+{
+  inherited::copyContents(from, copyconnections);
+
+  const SoLazySeparator * node = (const SoLazySeparator *)from;
+  PRIVATE(this)->containername = PRIVATE(node)->containername;
+  PRIVATE(this)->loaded = PRIVATE(node)->loaded;
+}
+
+// Doc from superclass.
+SbBool
+SoLazySeparator::readInstance(SoInput * in, unsigned short flags)
+{
+  if (!inherited::readInstance(in, flags)) return FALSE;
+
+  const char * filename = in->getCurFileName();
+  PRIVATE(this)->containername = filename ? filename : "";
+  PRIVATE(this)->loaded = this->getNumChildren() > 0;
+  return TRUE;
+}
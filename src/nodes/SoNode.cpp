@@ -219,6 +219,7 @@ SbUniqueId is not really a class, just a \c typedef.
 #include "rendering/SoGL.h"
 #include "nodes/SoSubNodeP.h"
 #include "nodes/SoUnknownNode.h"
+#include "profiler/SoProfilerCountersP.h"
 #include "threads/threadsutilp.h"
 #include "glue/glp.h"
 #include "misc/SoDBP.h" // for global envvar COIN_PROFILER
@@ -517,6 +518,7 @@ SoNode::notify(SoNotList * l)
   // The time stamp is set in the SoNotList constructor.
   if (l->getTimeStamp() > this->uniqueId) {
     SET_UNIQUE_NODE_ID(this);
+    SoProfilerCountersP::count(SoProfilerCounters::NOTIFICATIONS);
     inherited::notify(l);
   }
 }
@@ -738,6 +740,8 @@ SoNode::initClasses(void)
 
   SoDepthBuffer::initClass();
   SoAlphaTest::initClass();
+  SoLazySeparator::initClass();
+  SoPagedGroup::initClass();
 }
 
 /*!
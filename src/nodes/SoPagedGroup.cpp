@@ -0,0 +1,1178 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoPagedGroup SoPagedGroup.h Inventor/nodes/SoPagedGroup.h
+  \brief The SoPagedGroup class keeps its children on disk until they are needed for rendering.
+
+  \ingroup coin_nodes
+
+  SoPagedGroup is intended for scenes that are too large to be kept
+  in memory. Instead of real children, the node holds a list of
+  references to subgraphs on disk, called items. Each item is either
+  a complete Inventor file, or a single chunk of a chunked file
+  written by SoChunkedFile::write().
+
+  During SoGLRenderAction traversal, each item with a bounding box
+  inside the view volume, and with a projected size on screen of at
+  least SoPagedGroup::screenSizeThreshold pixels, is either rendered
+  (if it is resident) or scheduled for loading. The file data is read
+  by a worker thread when Coin is built with thread support, so
+  rendering never waits for disk I/O. Items appear in the following
+  frames as they are loaded.
+
+  The total size of all resident items, in all SoPagedGroup nodes, is
+  kept within a memory budget (see setMemoryBudget()) by evicting the
+  least recently rendered items. Items rendered during the last
+  second are never evicted, so the budget is exceeded rather than
+  causing items in view to be reloaded every frame. The size of an
+  item is estimated from the number of nodes and field values in the
+  subgraph.
+
+  Other actions only traverse the resident items, except
+  SoGetBoundingBoxAction, which uses the bounding boxes stored in the
+  node for items that have one. Use load() to force an item to be
+  loaded.
+
+  The resident items are available through getChildren(), in the
+  order they were loaded. Each item is made a separator when loaded,
+  so items do not affect each other's traversal state.
+
+  <b>FILE FORMAT/DEFAULTS:</b>
+  \code
+    PagedGroup {
+        fileName [ ]
+        chunk [ ]
+        bboxCenter [ ]
+        bboxSize [ ]
+        screenSizeThreshold 8
+    }
+  \endcode
+
+  The default memory budget can be set in megabytes with the
+  environment variable COIN_PAGEDGROUP_MEMORY_BUDGET.
+
+  \sa SoChunkedFile, SoLazySeparator
+  \COIN_CLASS_EXTENSION
+*/
+
+// *************************************************************************
+
+#include <Inventor/nodes/SoPagedGroup.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <cfloat>
+#include <cstdio>
+#include <cstdlib>
+
+#include <Inventor/C/tidbits.h>
+#include <Inventor/C/threads/common.h>
+#include <Inventor/C/threads/sched.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/SbViewVolume.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/elements/SoCacheElement.h>
+#include <Inventor/elements/SoCullElement.h>
+#include <Inventor/elements/SoModelMatrixElement.h>
+#include <Inventor/elements/SoViewVolumeElement.h>
+#include <Inventor/elements/SoViewportRegionElement.h>
+#include <Inventor/errors/SoDebugError.h>
+#include <Inventor/fields/SoMFColor.h>
+#include <Inventor/fields/SoMFDouble.h>
+#include <Inventor/fields/SoMFMatrix.h>
+#include <Inventor/fields/SoMFNode.h>
+#include <Inventor/fields/SoMFPlane.h>
+#include <Inventor/fields/SoMFRotation.h>
+#include <Inventor/fields/SoMFShort.h>
+#include <Inventor/fields/SoMFUShort.h>
+#include <Inventor/fields/SoMFVec2f.h>
+#include <Inventor/fields/SoMFVec4f.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/lists/SbStringList.h>
+#include <Inventor/lists/SoFieldList.h>
+#include <Inventor/misc/SoChildList.h>
+#include <Inventor/misc/SoNotification.h>
+#include <Inventor/misc/SoState.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/sensors/SoTimerSensor.h>
+
+#include "coindefs.h"
+#include "io/SoChunkedFileP.h"
+#include "nodes/SoSubNodeP.h"
+#include "threads/threadsutilp.h"
+#include "tidbitsp.h"
+
+// *************************************************************************
+
+/*!
+  \var SoMFString SoPagedGroup::fileName
+
+  The files holding the items, one value per item. Relative file
+  names are searched for in the directory of the file the node was
+  read from, and in the SoInput search directories.
+*/
+
+/*!
+  \var SoMFInt32 SoPagedGroup::chunk
+
+  Chunk index for each item. If the index is -1, or there is no value
+  for the item, the complete file is read with SoDB::readAll().
+  Otherwise, the given chunk is read from a file written by
+  SoChunkedFile::write().
+*/
+
+/*!
+  \var SoMFVec3f SoPagedGroup::bboxCenter
+
+  Center of the bounding box of each item, in the local coordinate
+  system of the node.
+*/
+
+/*!
+  \var SoMFVec3f SoPagedGroup::bboxSize
+
+  Size of the bounding box of each item. Items without a bounding box
+  (no value, or a negative size) are never culled, and are loaded the
+  first time the node is rendered.
+*/
+
+/*!
+  \var SoSFFloat SoPagedGroup::screenSizeThreshold
+
+  Items with a bounding box which projects to fewer pixels than this
+  on screen (measured along the larger of the two screen axes) are
+  neither rendered nor loaded. Default value is 8.
+*/
+
+// *************************************************************************
+
+#define PRIVATE(obj) ((obj)->pimpl)
+
+// Max number of items read per sensor pass when there are no worker
+// threads.
+static const int PAGEDGROUP_MAX_SYNC_LOADS = 2;
+
+// Items rendered during this many seconds are never evicted.
+static const double PAGEDGROUP_KEEP_TIME = 1.0;
+
+// Default memory budget in megabytes.
+static const int PAGEDGROUP_DEFAULT_BUDGET = 512;
+
+// A request to load an item. The data is read from disk by a worker
+// thread (if available). The scene graph is built in the main thread,
+// since building nodes is only safe from other threads when Coin is
+// built thread safe.
+class SoPagedGroupRequest {
+public:
+  SoPagedGroupP * owner; // NULL if the request has been cancelled
+  int item;
+  SbString filename;
+  int chunk;
+  void * buffer;
+  size_t size;
+  uint32_t schedid;
+  SbBool done;
+};
+
+class SoPagedGroupP {
+public:
+  struct Item {
+    SbString filename;
+    int chunk;
+    SbBox3f box;
+    SoNode * root;
+    size_t bytes;
+    double lastrendered;
+    int childindex;
+    SbBool failed;
+    SoPagedGroupRequest * request;
+  };
+
+  SoPagedGroupP(SoPagedGroup * master) : master(master) { }
+
+  SoPagedGroup * master;
+  SoChildList * children;
+  SbList<Item> items;
+  SbString basedir;
+  SbBool itemsdirty;
+
+  void updateItems(void);
+  void request(const int idx, const float priority);
+  void cancel(const int idx);
+  void attach(const int idx, SoNode * node);
+  void detach(const int idx);
+
+  static float projectedSize(SoState * state, const SbBox3f & box);
+  static size_t estimateBytes(SoNode * node);
+
+  static void readData(SoPagedGroupRequest * req);
+  static SoNode * buildSceneGraph(SoPagedGroupRequest * req);
+  static void finishRequest(SoPagedGroupRequest * req);
+  static void evict(const double keepafter, const Item * keep);
+
+  static void readThread(void * closure);
+  static void sensorCB(void * closure, SoSensor * sensor);
+  static void cleanup(void);
+
+  static SbList<SoPagedGroupP *> * instances;
+  static SbList<SoPagedGroupRequest *> * requests;
+  static SoTimerSensor * sensor;
+  static cc_sched * scheduler;
+  static void * mutex;
+
+  static size_t budget;
+  static size_t residentbytes;
+  static int numevictions;
+  static SbTime ratestart;
+  static float evictionrate;
+};
+
+SbList<SoPagedGroupP *> * SoPagedGroupP::instances = NULL;
+SbList<SoPagedGroupRequest *> * SoPagedGroupP::requests = NULL;
+SoTimerSensor * SoPagedGroupP::sensor = NULL;
+cc_sched * SoPagedGroupP::scheduler = NULL;
+void * SoPagedGroupP::mutex = NULL;
+size_t SoPagedGroupP::budget = 0;
+size_t SoPagedGroupP::residentbytes = 0;
+int SoPagedGroupP::numevictions = 0;
+SbTime SoPagedGroupP::ratestart;
+float SoPagedGroupP::evictionrate = 0.0f;
+
+// *************************************************************************
+
+SO_NODE_SOURCE(SoPagedGroup);
+
+// *************************************************************************
+
+/*!
+  Constructor.
+*/
+SoPagedGroup::SoPagedGroup(void)
+{
+  PRIVATE(this) = new SoPagedGroupP(this);
+
+  SO_NODE_INTERNAL_CONSTRUCTOR(SoPagedGroup);
+
+  SO_NODE_ADD_EMPTY_MFIELD(fileName);
+  SO_NODE_ADD_EMPTY_MFIELD(chunk);
+  SO_NODE_ADD_EMPTY_MFIELD(bboxCenter);
+  SO_NODE_ADD_EMPTY_MFIELD(bboxSize);
+  SO_NODE_ADD_FIELD(screenSizeThreshold, (8.0f));
+
+  PRIVATE(this)->children = new SoChildList(this);
+  PRIVATE(this)->itemsdirty = TRUE;
+  SoPagedGroupP::instances->append(PRIVATE(this));
+}
+
+/*!
+  Destructor.
+*/
+SoPagedGroup::~SoPagedGroup()
+{
+  for (int i = 0; i < PRIVATE(this)->items.getLength(); i++) {
+    PRIVATE(this)->cancel(i);
+    if (PRIVATE(this)->items[i].root) PRIVATE(this)->detach(i);
+  }
+  if (SoPagedGroupP::instances) {
+    SoPagedGroupP::instances->removeItem(PRIVATE(this));
+  }
+  delete PRIVATE(this)->children;
+  delete PRIVATE(this);
+}
+
+/*!
+  \copybrief SoBase::initClass(void)
+*/
+void
+SoPagedGroup::initClass(void)
+{
+  SO_NODE_INTERNAL_INIT_CLASS(SoPagedGroup, SO_FROM_COIN_4_0);
+
+  SoPagedGroupP::instances = new SbList<SoPagedGroupP *>;
+  SoPagedGroupP::requests = new SbList<SoPagedGroupRequest *>;
+  CC_MUTEX_CONSTRUCT(SoPagedGroupP::mutex);
+
+#ifdef HAVE_THREADS
+  if (cc_thread_implementation() != CC_NO_THREADS) {
+    SoPagedGroupP::scheduler = cc_sched_construct(1);
+  }
+#endif // HAVE_THREADS
+
+  int megabytes = PAGEDGROUP_DEFAULT_BUDGET;
+  const char * env = coin_getenv("COIN_PAGEDGROUP_MEMORY_BUDGET");
+  if (env && atoi(env) > 0) megabytes = atoi(env);
+  SoPagedGroupP::budget = size_t(megabytes) * 1024 * 1024;
+  SoPagedGroupP::residentbytes = 0;
+  SoPagedGroupP::numevictions = 0;
+  SoPagedGroupP::evictionrate = 0.0f;
+  SoPagedGroupP::ratestart = SbTime::getTimeOfDay();
+
+  coin_atexit((coin_atexit_f *)SoPagedGroupP::cleanup, CC_ATEXIT_NORMAL);
+}
+
+// *************************************************************************
+
+/*!
+  Returns the number of items, i.e. the number of values in the
+  SoPagedGroup::fileName field.
+*/
+int
+SoPagedGroup::getNumItems(void) const
+{
+  PRIVATE(this)->updateItems();
+  return PRIVATE(this)->items.getLength();
+}
+
+/*!
+  Returns \c TRUE if \a item is loaded.
+*/
+SbBool
+SoPagedGroup::isResident(int item) const
+{
+  PRIVATE(this)->updateItems();
+  if (item < 0 || item >= PRIVATE(this)->items.getLength()) return FALSE;
+  return PRIVATE(this)->items[item].root != NULL;
+}
+
+/*!
+  Loads \a item immediately, in the calling thread, if it is not
+  already resident. Other items may be evicted to keep within the
+  memory budget. Returns \c TRUE if the item is resident when the
+  function returns.
+*/
+SbBool
+SoPagedGroup::load(int item)
+{
+  PRIVATE(this)->updateItems();
+  if (item < 0 || item >= PRIVATE(this)->items.getLength()) return FALSE;
+
+  SoPagedGroupP::Item & it = PRIVATE(this)->items[item];
+  if (it.root == NULL) {
+    PRIVATE(this)->cancel(item);
+
+    SoPagedGroupRequest req;
+    req.owner = PRIVATE(this);
+    req.item = item;
+    req.filename = it.filename;
+    req.chunk = it.chunk;
+    req.buffer = NULL;
+    req.size = 0;
+    req.done = FALSE;
+    SoPagedGroupP::readData(&req);
+    SoNode * node = SoPagedGroupP::buildSceneGraph(&req);
+    free(req.buffer);
+
+    it.failed = (node == NULL);
+    if (node == NULL) return FALSE;
+    PRIVATE(this)->attach(item, node);
+  }
+  PRIVATE(this)->items[item].lastrendered = SbTime::getTimeOfDay().getValue();
+  SoPagedGroupP::evict(DBL_MAX, &PRIVATE(this)->items[item]);
+  return TRUE;
+}
+
+/*!
+  Removes \a item from memory. It will be loaded again when needed.
+*/
+void
+SoPagedGroup::unload(int item)
+{
+  PRIVATE(this)->updateItems();
+  if (item < 0 || item >= PRIVATE(this)->items.getLength()) return;
+  PRIVATE(this)->cancel(item);
+  if (PRIVATE(this)->items[item].root) PRIVATE(this)->detach(item);
+}
+
+// *************************************************************************
+
+/*!
+  Sets the maximum total size in bytes of the items resident in all
+  SoPagedGroup nodes.
+*/
+void
+SoPagedGroup::setMemoryBudget(size_t bytes)
+{
+  SoPagedGroupP::budget = bytes;
+  if (SoPagedGroupP::residentbytes > bytes && SoPagedGroupP::sensor &&
+      !SoPagedGroupP::sensor->isScheduled()) {
+    SoPagedGroupP::sensor->schedule();
+  }
+}
+
+/*!
+  Returns the memory budget.
+
+  \sa setMemoryBudget()
+*/
+size_t
+SoPagedGroup::getMemoryBudget(void)
+{
+  return SoPagedGroupP::budget;
+}
+
+/*!
+  Returns the estimated number of bytes used by resident items in all
+  SoPagedGroup nodes.
+*/
+size_t
+SoPagedGroup::getResidentBytes(void)
+{
+  return SoPagedGroupP::residentbytes;
+}
+
+/*!
+  Returns the number of items which have been scheduled for loading
+  but are not yet resident.
+*/
+int
+SoPagedGroup::getNumPendingLoads(void)
+{
+  return SoPagedGroupP::requests ? SoPagedGroupP::requests->getLength() : 0;
+}
+
+/*!
+  Returns the number of items evicted per second to stay within the
+  memory budget. The rate is measured over intervals of at least one
+  second.
+*/
+float
+SoPagedGroup::getEvictionsPerSecond(void)
+{
+  const SbTime now = SbTime::getTimeOfDay();
+  const double elapsed = (now - SoPagedGroupP::ratestart).getValue();
+  if (elapsed >= 1.0) {
+    SoPagedGroupP::evictionrate = float(SoPagedGroupP::numevictions / elapsed);
+    SoPagedGroupP::numevictions = 0;
+    SoPagedGroupP::ratestart = now;
+  }
+  return SoPagedGroupP::evictionrate;
+}
+
+// *************************************************************************
+
+// Doc from superclass.
+SoChildList *
+SoPagedGroup::getChildren(void) const
+{
+  return PRIVATE(this)->children;
+}
+
+// Doc from superclass.
+void
+SoPagedGroup::doAction(SoAction * action)
+{
+  int numindices;
+  const int * indices;
+  if (action->getPathCode(numindices, indices) == SoAction::IN_PATH) {
+    PRIVATE(this)->children->traverseInPath(action, numindices, indices);
+  }
+  else {
+    PRIVATE(this)->children->traverse(action);
+  }
+}
+
+/*!
+  Renders the resident items in view, and schedules loading of items
+  in view which are not resident.
+*/
+void
+SoPagedGroup::GLRender(SoGLRenderAction * action)
+{
+  int numindices;
+  const int * indices;
+  if (action->getPathCode(numindices, indices) == SoAction::IN_PATH) {
+    PRIVATE(this)->children->traverseInPath(action, numindices, indices);
+    return;
+  }
+
+  SoState * state = action->getState();
+  PRIVATE(this)->updateItems();
+
+  // As for SoSeparator, nothing is culled while a render cache is
+  // being built, so the cache holds all the resident items. The cache
+  // is only invalidated while there are items left to load; loading
+  // or evicting an item changes the children, which invalidates the
+  // caches above anyway.
+  const SbBool cacheopen = state->isCacheOpen();
+  const SbBool inside = SoCullElement::completelyInside(state);
+  const float threshold = this->screenSizeThreshold.getValue();
+  const double now = SbTime::getTimeOfDay().getValue();
+  SbBool incomplete = FALSE;
+
+  for (int i = 0; i < PRIVATE(this)->items.getLength(); i++) {
+    if (action->hasTerminated()) break;
+    SoPagedGroupP::Item & item = PRIVATE(this)->items[i];
+    if (!item.root && !item.failed) incomplete = TRUE;
+
+    float size = 0.0f; // load priority
+    SbBool visible = TRUE;
+    if (!item.box.isEmpty()) {
+      if (!inside && SoCullElement::cullTest(state, item.box, TRUE)) {
+        visible = FALSE;
+      }
+      else if (threshold > 0.0f) {
+        size = SoPagedGroupP::projectedSize(state, item.box);
+        if (size < threshold) visible = FALSE;
+      }
+    }
+    if (item.root) {
+      if (!visible && !cacheopen) continue;
+      item.lastrendered = now;
+      PRIVATE(this)->children->traverse(action, item.childindex);
+    }
+    else if (!item.failed && visible) {
+      PRIVATE(this)->request(i, size);
+    }
+  }
+  if (incomplete) {
+    SoCacheElement::invalidate(state);
+  }
+}
+
+/*!
+  Uses the bounding boxes stored in the node where available, and the
+  resident items without a stored bounding box.
+*/
+void
+SoPagedGroup::getBoundingBox(SoGetBoundingBoxAction * action)
+{
+  int numindices;
+  const int * indices;
+  if (action->getPathCode(numindices, indices) == SoAction::IN_PATH) {
+    PRIVATE(this)->children->traverseInPath(action, numindices, indices);
+    return;
+  }
+
+  PRIVATE(this)->updateItems();
+
+  SbVec3f acccenter(0.0f, 0.0f, 0.0f);
+  int numcenters = 0;
+  SbBox3f box;
+
+  for (int i = 0; i < PRIVATE(this)->items.getLength(); i++) {
+    const SoPagedGroupP::Item & item = PRIVATE(this)->items[i];
+    if (!item.box.isEmpty()) {
+      box.extendBy(item.box);
+    }
+    else if (item.root) {
+      PRIVATE(this)->children->traverse(action, item.childindex);
+      if (action->isCenterSet()) {
+        acccenter += action->getCenter();
+        numcenters++;
+        action->resetCenter();
+      }
+    }
+  }
+  if (!box.isEmpty()) {
+    action->extendBy(box);
+    action->setCenter(box.getCenter(), TRUE);
+    acccenter += action->getCenter();
+    numcenters++;
+    action->resetCenter();
+  }
+  if (numcenters != 0) {
+    action->setCenter(acccenter / float(numcenters), FALSE);
+  }
+}
+
+// Doc from superclass.
+void
+SoPagedGroup::callback(SoCallbackAction * action)
+{
+  SoPagedGroup::doAction((SoAction *)action);
+}
+
+// Doc from superclass.
+void
+SoPagedGroup::getMatrix(SoGetMatrixAction * action)
+{
+  SoPagedGroup::doAction((SoAction *)action);
+}
+
+// Doc from superclass.
+void
+SoPagedGroup::handleEvent(SoHandleEventAction * action)
+{
+  SoPagedGroup::doAction((SoAction *)action);
+}
+
+// Doc from superclass.
+void
+SoPagedGroup::pick(SoPickAction * action)
+{
+  SoPagedGroup::doAction((SoAction *)action);
+}
+
+// Doc from superclass.
+void
+SoPagedGroup::getPrimitiveCount(SoGetPrimitiveCountAction * action)
+{
+  SoPagedGroup::doAction((SoAction *)action);
+}
+
+// Doc from superclass.
+void
+SoPagedGroup::audioRender(SoAudioRenderAction * action)
+{
+  SoPagedGroup::doAction((SoAction *)action);
+}
+
+// Doc from superclass.
+void
+SoPagedGroup::search(SoSearchAction * action)
+{
+  SoNode::search(action);
+  if (action->isFound()) return;
+  SoPagedGroup::doAction((SoAction *)action);
+}
+
+// Doc from superclass.
+void
+SoPagedGroup::copyContents(const SoFieldContainer * from,
+                           SbBool copyconnections)
+{
+  inherited::copyContents(from, copyconnections);
+
+  const SoPagedGroup * node = (const SoPagedGroup *)from;
+  PRIVATE(this)->basedir = PRIVATE(node)->basedir;
+  PRIVATE(this)->itemsdirty = TRUE;
+}
+
+// Doc from superclass.
+SbBool
+SoPagedGroup::readInstance(SoInput * in, unsigned short flags)
+{
+  if (!inherited::readInstance(in, flags)) return FALSE;
+
+  // relative file names are searched for relative to this file
+  const char * filename = in->getCurFileName();
+  PRIVATE(this)->basedir = filename ? SoInput::getPathname(filename) : SbString("");
+  PRIVATE(this)->itemsdirty = TRUE;
+  return TRUE;
+}
+
+// Doc from superclass.
+void
+SoPagedGroup::notify(SoNotList * nl)
+{
+  SoNotRec * rec = nl->getFirstRec();
+  if (rec && rec->getBase() == this) {
+    const SoField * f = nl->getLastField();
+    if (f == &this->fileName || f == &this->chunk ||
+        f == &this->bboxCenter || f == &this->bboxSize) {
+      PRIVATE(this)->itemsdirty = TRUE;
+    }
+  }
+  inherited::notify(nl);
+}
+
+// *************************************************************************
+
+// Rebuilds the item list from the fields, if they have changed.
+void
+SoPagedGroupP::updateItems(void)
+{
+  if (!this->itemsdirty) return;
+  this->itemsdirty = FALSE;
+
+  int i;
+  for (i = 0; i < this->items.getLength(); i++) {
+    this->cancel(i);
+    if (this->items[i].root) this->detach(i);
+  }
+  this->items.truncate(0);
+
+  SbStringList dirs;
+  if (this->basedir.getLength()) dirs.append(&this->basedir);
+  const SbStringList & searchdirs = SoInput::getDirectories();
+  for (i = 0; i < searchdirs.getLength(); i++) dirs.append(searchdirs[i]);
+
+  const SoPagedGroup * m = this->master;
+  for (i = 0; i < m->fileName.getNum(); i++) {
+    Item item;
+    item.filename = SoInput::searchForFile(m->fileName[i], dirs, SbStringList());
+    if (item.filename.getLength() == 0) item.filename = m->fileName[i];
+    item.chunk = i < m->chunk.getNum() ? m->chunk[i] : -1;
+    if (i < m->bboxCenter.getNum() && i < m->bboxSize.getNum()) {
+      const SbVec3f & size = m->bboxSize[i];
+      if (size[0] >= 0.0f && size[1] >= 0.0f && size[2] >= 0.0f) {
+        const SbVec3f & center = m->bboxCenter[i];
+        item.box.setBounds(center - size * 0.5f, center + size * 0.5f);
+      }
+    }
+    item.root = NULL;
+    item.bytes = 0;
+    item.lastrendered = 0.0;
+    item.childindex = -1;
+    item.failed = FALSE;
+    item.request = NULL;
+    this->items.append(item);
+  }
+}
+
+// Schedules item idx for loading, unless a request is pending.
+void
+SoPagedGroupP::request(const int idx, const float priority)
+{
+  Item & item = this->items[idx];
+  if (item.request) return;
+
+  SoPagedGroupRequest * req = new SoPagedGroupRequest;
+  req->owner = this;
+  req->item = idx;
+  req->filename = item.filename;
+  req->chunk = item.chunk;
+  req->buffer = NULL;
+  req->size = 0;
+  req->schedid = 0;
+  req->done = FALSE;
+  item.request = req;
+  SoPagedGroupP::requests->append(req);
+
+  if (SoPagedGroupP::scheduler) {
+    req->schedid = cc_sched_schedule(SoPagedGroupP::scheduler,
+                                     SoPagedGroupP::readThread, req, priority);
+  }
+  if (SoPagedGroupP::sensor == NULL) {
+    SoPagedGroupP::sensor = new SoTimerSensor(SoPagedGroupP::sensorCB, NULL);
+    SoPagedGroupP::sensor->setInterval(SbTime(0.05));
+  }
+  if (!SoPagedGroupP::sensor->isScheduled()) SoPagedGroupP::sensor->schedule();
+}
+
+// Cancels the pending request for item idx, if any. A request which
+// is being processed by a worker thread is thrown away when finished.
+void
+SoPagedGroupP::cancel(const int idx)
+{
+  SoPagedGroupRequest * req = this->items[idx].request;
+  if (req == NULL) return;
+  this->items[idx].request = NULL;
+
+  if (SoPagedGroupP::scheduler &&
+      !cc_sched_unschedule(SoPagedGroupP::scheduler, req->schedid)) {
+    // already started, thrown away by sensorCB() when finished
+    req->owner = NULL;
+    return;
+  }
+  SoPagedGroupP::requests->removeItem(req);
+  delete req;
+}
+
+// Makes node the resident scene graph of item idx.
+void
+SoPagedGroupP::attach(const int idx, SoNode * node)
+{
+  node->ref();
+  if (!node->isOfType(SoSeparator::getClassTypeId())) {
+    SoSeparator * sep = new SoSeparator;
+    sep->ref();
+    sep->addChild(node);
+    node->unref();
+    node = sep;
+  }
+
+  Item & item = this->items[idx];
+  item.root = node;
+  item.bytes = SoPagedGroupP::estimateBytes(node);
+  item.childindex = this->children->getLength();
+  item.failed = FALSE;
+  this->children->append(node);
+  node->unref();
+
+  SoPagedGroupP::residentbytes += item.bytes;
+}
+
+// Removes the resident scene graph of item idx.
+void
+SoPagedGroupP::detach(const int idx)
+{
+  Item & item = this->items[idx];
+  assert(item.root);
+  const int childindex = item.childindex;
+  this->children->remove(childindex);
+  for (int i = 0; i < this->items.getLength(); i++) {
+    if (this->items[i].childindex > childindex) this->items[i].childindex--;
+  }
+  SoPagedGroupP::residentbytes -= item.bytes;
+  item.root = NULL;
+  item.bytes = 0;
+  item.childindex = -1;
+}
+
+// *************************************************************************
+
+// Returns the size in pixels of the screen projection of box, along
+// the larger of the two screen axes.
+float
+SoPagedGroupP::projectedSize(SoState * state, const SbBox3f & box)
+{
+  SbBox3f wbox = box;
+  wbox.transform(SoModelMatrixElement::get(state));
+  const SbViewVolume & vv = SoViewVolumeElement::get(state);
+  if (vv.getProjectionType() == SbViewVolume::PERSPECTIVE &&
+      wbox.intersect(vv.getProjectionPoint())) {
+    return FLT_MAX;
+  }
+  const SbVec2f size = vv.projectBox(wbox);
+  const SbVec2s & vpsize =
+    SoViewportRegionElement::get(state).getViewportSizePixels();
+  return SbMax(size[0] * vpsize[0], size[1] * vpsize[1]);
+}
+
+// Returns the size in bytes of one value of a multiple-value field.
+static size_t
+pagedgroup_value_size(const SoMField * field)
+{
+  const SoType type = field->getTypeId();
+  if (type == SoMFVec3f::getClassTypeId() ||
+      type == SoMFColor::getClassTypeId()) return sizeof(SbVec3f);
+  if (type == SoMFVec2f::getClassTypeId()) return sizeof(SbVec2f);
+  if (type == SoMFVec4f::getClassTypeId() ||
+      type == SoMFRotation::getClassTypeId() ||
+      type == SoMFPlane::getClassTypeId()) return 4 * sizeof(float);
+  if (type == SoMFMatrix::getClassTypeId()) return sizeof(SbMatrix);
+  if (type == SoMFDouble::getClassTypeId()) return sizeof(double);
+  if (type == SoMFShort::getClassTypeId() ||
+      type == SoMFUShort::getClassTypeId()) return sizeof(short);
+  if (type == SoMFString::getClassTypeId()) return sizeof(SbString);
+  if (type.isDerivedFrom(SoMFNode::getClassTypeId())) return sizeof(void *);
+  // float, int32, uint32, enum, bitmask and other 32-bit types
+  return 4;
+}
+
+// Rough estimate of the memory used by the scene graph below node: a
+// fixed cost per node and field, plus the values of the
+// multiple-value fields. Shared nodes are counted once per instance.
+size_t
+SoPagedGroupP::estimateBytes(SoNode * node)
+{
+  size_t bytes = 128; // node instance and bookkeeping
+
+  SoFieldList fields;
+  const int numfields = node->getFields(fields);
+  for (int i = 0; i < numfields; i++) {
+    const SoField * f = fields[i];
+    bytes += 32;
+    if (f->isOfType(SoMField::getClassTypeId())) {
+      const SoMField * mf = (const SoMField *)f;
+      bytes += mf->getNum() * pagedgroup_value_size(mf);
+    }
+  }
+
+  const SoChildList * children = node->getChildren();
+  if (children) {
+    for (int i = 0; i < children->getLength(); i++) {
+      bytes += SoPagedGroupP::estimateBytes((*children)[i]);
+    }
+  }
+  return bytes;
+}
+
+// *************************************************************************
+
+// Reads the raw data of the item. Does not touch the scene graph, and
+// is called from a worker thread when threads are available.
+void
+SoPagedGroupP::readData(SoPagedGroupRequest * req)
+{
+  if (req->chunk >= 0) {
+    req->buffer = SoChunkedFileP::readChunkData(req->filename, req->chunk, req->size);
+    return;
+  }
+
+  FILE * fp = fopen(req->filename.getString(), "rb");
+  if (fp == NULL) return;
+
+  void * buffer = NULL;
+  size_t size = 0;
+  if (fseek(fp, 0, SEEK_END) == 0) {
+    const long end = ftell(fp);
+    if (end > 0 && fseek(fp, 0, SEEK_SET) == 0) {
+      size = (size_t) end;
+      buffer = malloc(size);
+      if (buffer && fread(buffer, 1, size, fp) != size) {
+        free(buffer);
+        buffer = NULL;
+      }
+    }
+  }
+  fclose(fp);
+
+  req->buffer = buffer;
+  req->size = buffer ? size : 0;
+}
+
+// Builds the scene graph of the item from the data read by
+// readData(). Returns NULL on failure.
+SoNode *
+SoPagedGroupP::buildSceneGraph(SoPagedGroupRequest * req)
+{
+  if (req->buffer == NULL) return NULL;
+
+  SoInput in;
+  in.setBuffer(req->buffer, req->size);
+  if (req->chunk >= 0) {
+    SoNode * node = NULL;
+    if (!SoDB::read(&in, node)) return NULL;
+    return node;
+  }
+
+  // resolve references to other files relative to the file, as
+  // SoInput::openFile() does
+  const SbString dir = SoInput::getPathname(req->filename);
+  if (dir.getLength()) SoInput::addDirectoryFirst(dir.getString());
+  SoSeparator * root = SoDB::readAll(&in);
+  if (dir.getLength()) SoInput::removeDirectory(dir.getString());
+  return root;
+}
+
+void
+SoPagedGroupP::readThread(void * closure)
+{
+  SoPagedGroupRequest * req = (SoPagedGroupRequest *) closure;
+  SoPagedGroupP::readData(req);
+  CC_MUTEX_LOCK(SoPagedGroupP::mutex);
+  req->done = TRUE;
+  CC_MUTEX_UNLOCK(SoPagedGroupP::mutex);
+}
+
+// Called in the main thread when the data of a request has been read.
+void
+SoPagedGroupP::finishRequest(SoPagedGroupRequest * req)
+{
+  SoPagedGroupP * owner = req->owner;
+  if (owner) {
+    SoNode * node = SoPagedGroupP::buildSceneGraph(req);
+    Item & item = owner->items[req->item];
+    item.request = NULL;
+    if (node) {
+      owner->attach(req->item, node);
+      item.lastrendered = SbTime::getTimeOfDay().getValue();
+    }
+    else {
+      SoDebugError::postWarning("SoPagedGroup::GLRender",
+                                "Unable to read '%s' (chunk %d).",
+                                req->filename.getString(), req->chunk);
+      // don't retry on every traversal
+      item.failed = TRUE;
+    }
+  }
+  free(req->buffer);
+  delete req;
+}
+
+// Evicts the least recently rendered items until the resident items
+// fit in the memory budget. Items rendered at or after keepafter, and
+// keep, are not evicted.
+void
+SoPagedGroupP::evict(const double keepafter, const Item * keep)
+{
+  if (SoPagedGroupP::residentbytes <= SoPagedGroupP::budget) return;
+
+  struct Candidate {
+    SoPagedGroupP * owner;
+    int idx;
+    double lastrendered;
+  };
+  SbList<Candidate> candidates;
+  int i;
+  for (i = 0; i < SoPagedGroupP::instances->getLength(); i++) {
+    SoPagedGroupP * pg = (*SoPagedGroupP::instances)[i];
+    for (int j = 0; j < pg->items.getLength(); j++) {
+      const Item & item = pg->items[j];
+      if (item.root && &item != keep && item.lastrendered < keepafter) {
+        Candidate c = { pg, j, item.lastrendered };
+        candidates.append(c);
+      }
+    }
+  }
+  if (candidates.getLength() == 0) return;
+
+  struct Compare {
+    static int cmp(const void * a, const void * b) {
+      const double ta = ((const Candidate *)a)->lastrendered;
+      const double tb = ((const Candidate *)b)->lastrendered;
+      return ta < tb ? -1 : (ta > tb ? 1 : 0);
+    }
+  };
+  qsort((void *)candidates.getArrayPtr(), candidates.getLength(),
+        sizeof(Candidate), Compare::cmp);
+
+  for (i = 0; i < candidates.getLength(); i++) {
+    if (SoPagedGroupP::residentbytes <= SoPagedGroupP::budget) break;
+    candidates[i].owner->detach(candidates[i].idx);
+    SoPagedGroupP::numevictions++;
+  }
+}
+
+// Picks up finished requests, reads pending ones when there are no
+// worker threads, and keeps within the memory budget.
+void
+SoPagedGroupP::sensorCB(void * COIN_UNUSED_ARG(closure), SoSensor * sensor)
+{
+  SbList<SoPagedGroupRequest *> & requests = *SoPagedGroupP::requests;
+  int numsync = 0;
+  int i = 0;
+  while (i < requests.getLength()) {
+    SoPagedGroupRequest * req = requests[i];
+    SbBool done;
+    if (SoPagedGroupP::scheduler) {
+      CC_MUTEX_LOCK(SoPagedGroupP::mutex);
+      done = req->done;
+      CC_MUTEX_UNLOCK(SoPagedGroupP::mutex);
+    }
+    else {
+      done = numsync++ < PAGEDGROUP_MAX_SYNC_LOADS;
+      if (done) SoPagedGroupP::readData(req);
+    }
+    if (done) {
+      requests.remove(i);
+      SoPagedGroupP::finishRequest(req);
+    }
+    else {
+      i++;
+    }
+  }
+
+  SoPagedGroupP::evict(SbTime::getTimeOfDay().getValue() - PAGEDGROUP_KEEP_TIME, NULL);
+
+  // keep polling while loads are pending, or there are items which
+  // can't be evicted yet
+  if (requests.getLength() == 0 &&
+      SoPagedGroupP::residentbytes <= SoPagedGroupP::budget) {
+    sensor->unschedule();
+  }
+}
+
+void
+SoPagedGroupP::cleanup(void)
+{
+  if (SoPagedGroupP::scheduler) {
+    cc_sched_wait_all(SoPagedGroupP::scheduler);
+    cc_sched_destruct(SoPagedGroupP::scheduler);
+    SoPagedGroupP::scheduler = NULL;
+  }
+  delete SoPagedGroupP::sensor;
+  SoPagedGroupP::sensor = NULL;
+
+  for (int i = 0; i < SoPagedGroupP::requests->getLength(); i++) {
+    SoPagedGroupRequest * req = (*SoPagedGroupP::requests)[i];
+    if (req->owner) req->owner->items[req->item].request = NULL;
+    free(req->buffer);
+    delete req;
+  }
+  delete SoPagedGroupP::requests;
+  SoPagedGroupP::requests = NULL;
+  delete SoPagedGroupP::instances;
+  SoPagedGroupP::instances = NULL;
+
+  CC_MUTEX_DESTRUCT(SoPagedGroupP::mutex);
+}
+
+#undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <cstdio>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoOutput.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/misc/SoChildList.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoPagedGroup.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+BOOST_AUTO_TEST_CASE(loadAndEvict)
+{
+  static const char filename[] = "SoPagedGroup_test.iv";
+
+  SoSeparator * sep = new SoSeparator;
+  sep->ref();
+  sep->addChild(new SoCube);
+  SoOutput out;
+  BOOST_REQUIRE(out.openFile(filename));
+  SoWriteAction wa(&out);
+  wa.apply(sep);
+  out.closeFile();
+  sep->unref();
+
+  const size_t oldbudget = SoPagedGroup::getMemoryBudget();
+  const size_t oldresident = SoPagedGroup::getResidentBytes();
+
+  SoPagedGroup * pg = new SoPagedGroup;
+  pg->ref();
+  pg->fileName.set1Value(0, filename);
+  pg->fileName.set1Value(1, filename);
+  pg->bboxCenter.set1Value(0, SbVec3f(0.0f, 0.0f, 0.0f));
+  pg->bboxSize.set1Value(0, SbVec3f(2.0f, 2.0f, 2.0f));
+  BOOST_CHECK_EQUAL(pg->getNumItems(), 2);
+
+  // the bounding box is known before anything is loaded
+  SoGetBoundingBoxAction bba(SbViewportRegion(100, 100));
+  bba.apply(pg);
+  BOOST_CHECK(bba.getBoundingBox().getMax() == SbVec3f(1.0f, 1.0f, 1.0f));
+  BOOST_CHECK(!pg->isResident(0));
+
+  BOOST_CHECK(pg->load(0));
+  BOOST_CHECK(pg->isResident(0));
+  BOOST_CHECK_EQUAL(pg->getChildren()->getLength(), 1);
+  const size_t itemsize = SoPagedGroup::getResidentBytes() - oldresident;
+  BOOST_CHECK(itemsize > 0);
+
+  // with room for a single item, loading the second evicts the first
+  SoPagedGroup::setMemoryBudget(oldresident + itemsize);
+  BOOST_CHECK(pg->load(1));
+  BOOST_CHECK(pg->isResident(1));
+  BOOST_CHECK(!pg->isResident(0));
+  BOOST_CHECK_EQUAL(SoPagedGroup::getResidentBytes(), oldresident + itemsize);
+
+  pg->unload(1);
+  BOOST_CHECK_EQUAL(pg->getChildren()->getLength(), 0);
+  BOOST_CHECK_EQUAL(SoPagedGroup::getResidentBytes(), oldresident);
+
+  SoPagedGroup::setMemoryBudget(oldbudget);
+  pg->unref();
+  remove(filename);
+}
+
+#endif // COIN_TEST_SUITE
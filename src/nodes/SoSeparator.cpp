@@ -100,6 +100,7 @@
 
 #include <Inventor/annex/Profiler/SoProfiler.h>
 #include "profiler/SoNodeProfiling.h"
+#include "profiler/SoProfilerCountersP.h"
 
 // *************************************************************************
 
@@ -995,6 +996,7 @@ SoSeparatorP::doCull(SoSeparatorP * thisp, SoState * state,
       outside = (*cullfunc)(state, bbox, TRUE);
     }
   }
+  if (outside) SoProfilerCountersP::count(SoProfilerCounters::SEPARATORS_CULLED);
 
 #if 0
 // temporarily disabled. setNodeFlag() needs current path, which is
@@ -176,6 +176,13 @@
   $ ./test < input.iv
   \endverbatim
 
+  The filename can also be a tile file written by
+  SoGLBigImage::writeTileFile(). The image is then not loaded into the
+  image field, but streamed by SoGLBigImage while rendering, which
+  reads only the parts of the image that are visible, at the
+  resolution they are drawn with. This makes it possible to use
+  images too large to keep in memory.
+
   <b>FILE FORMAT/DEFAULTS:</b>
   \code
     Texture2 {
@@ -381,6 +388,7 @@ public:
   static SbMutex * mutex;
   int readstatus;
   SbBool glimagevalid;
+  SbString tilefile; // the full path when filename is a tile file
 
   static void cleanup(void) {
     delete SoTexture2P::mutex;
@@ -525,7 +533,10 @@ SoTexture2::GLRender(SoGLRenderAction * action)
   const cc_glglue * glue = cc_glglue_instance(SoGLCacheContextElement::get(state));
   SoTextureScalePolicyElement::Policy scalepolicy =
     SoTextureScalePolicyElement::get(state);
-  SbBool needbig = (scalepolicy == SoTextureScalePolicyElement::FRACTURE);
+  // tile files are always streamed by SoGLBigImage
+  const SbBool usetilefile = PRIVATE(this)->tilefile.getLength() > 0;
+  SbBool needbig = usetilefile ||
+    (scalepolicy == SoTextureScalePolicyElement::FRACTURE);
   SoType glimagetype = PRIVATE(this)->glimage ? PRIVATE(this)->glimage->getTypeId() : SoType::badType();
     
   LOCK_GLIMAGE(this);
@@ -558,7 +569,15 @@ SoTexture2::GLRender(SoGLRenderAction * action)
       PRIVATE(this)->glimage->setFlags(PRIVATE(this)->glimage->getFlags()|SoGLImage::SCALE_DOWN);
     }
 
-    if (bytes && size != SbVec2s(0,0)) {
+    if (usetilefile) {
+      PRIVATE(this)->glimagevalid =
+        ((SoGLBigImage *) PRIVATE(this)->glimage)->
+        setTileFile(PRIVATE(this)->tilefile.getString(),
+                    translateWrap((Wrap)this->wrapS.getValue()),
+                    translateWrap((Wrap)this->wrapT.getValue()),
+                    quality);
+    }
+    else if (bytes && size != SbVec2s(0,0)) {
       PRIVATE(this)->glimage->setData(bytes, size, nc,
                              translateWrap((Wrap)this->wrapS.getValue()),
                              translateWrap((Wrap)this->wrapT.getValue()),
@@ -708,6 +727,7 @@ SoTexture2::notify(SoNotList * l)
   SoField * f = l->getLastField();
   if (f == &this->image) {
     PRIVATE(this)->glimagevalid = FALSE;
+    PRIVATE(this)->tilefile.makeEmpty();
 
     // write image, not filename
     this->filename.setDefault(TRUE);
@@ -727,11 +747,25 @@ SbBool
 SoTexture2::loadFilename(void)
 {
   SbBool retval = FALSE;
+  PRIVATE(this)->tilefile.makeEmpty();
   if (this->filename.getValue().getLength()) {
     SbImage tmpimage;
     const SbStringList & sl = SoInput::getDirectories();
-    if (tmpimage.readFile(this->filename.getValue(),
-                          sl.getArrayPtr(), sl.getLength())) {
+    const SbString fullname =
+      SbImage::searchForFile(this->filename.getValue(),
+                             sl.getArrayPtr(), sl.getLength());
+    if (fullname.getLength() &&
+        SoGLBigImage::isTileFile(fullname.getString())) {
+      // streamed by SoGLBigImage, so the image is not loaded
+      SbBool oldnotify = this->image.enableNotify(FALSE);
+      this->image.setValue(SbVec2s(0,0), 0, NULL);
+      this->image.enableNotify(oldnotify);
+      PRIVATE(this)->tilefile = fullname;
+      PRIVATE(this)->glimagevalid = FALSE;
+      retval = TRUE;
+    }
+    else if (tmpimage.readFile(this->filename.getValue(),
+                               sl.getArrayPtr(), sl.getLength())) {
       int nc;
       SbVec2s size;
       unsigned char * bytes = tmpimage.getValue(size, nc);
@@ -61,6 +61,7 @@
 #include "SoInfo.cpp"
 #include "SoLOD.cpp"
 #include "SoLabel.cpp"
+#include "SoLazySeparator.cpp"
 #include "SoLevelOfDetail.cpp"
 #include "SoLight.cpp"
 #include "SoLightModel.cpp"
@@ -77,6 +78,7 @@
 #include "SoNurbsProfile.cpp"
 #include "SoOrthographicCamera.cpp"
 #include "SoPackedColor.cpp"
+#include "SoPagedGroup.cpp"
 #include "SoPathSwitch.cpp"
 #include "SoPendulum.cpp"
 #include "SoPerspectiveCamera.cpp"
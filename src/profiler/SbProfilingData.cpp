@@ -77,6 +77,13 @@
   Type definition for the key node name.
 */
 
+/*!
+  \typedef const char * SbProfilingCounterKey
+
+  Type definition for the key of a counter. This is the string of
+  the SbName the counter was added with.
+*/
+
 // *************************************************************************
 
 // SbNodeProfilingData - internal structure containing profiling data
@@ -122,6 +129,15 @@ struct SbNameProfilingData {
 
 }; // SbNameProfilingData
 
+struct SbCounterProfilingData {
+  SbTime totaltime;
+  SbTime maximumtime;
+  uint32_t count;
+
+  inline SbCounterProfilingData(void);
+
+}; // SbCounterProfilingData
+
 // inlined methods
 
 SbNodeProfilingData::SbNodeProfilingData(void)
@@ -153,6 +169,11 @@ SbNameProfilingData::SbNameProfilingData(void)
 {
 }
 
+SbCounterProfilingData::SbCounterProfilingData(void)
+: totaltime(0.0), maximumtime(0.0), count(0)
+{
+}
+
 // *************************************************************************
 
 class SbProfilingDataP {
@@ -163,6 +184,7 @@ public:
 
   std::map<SbProfilingNodeTypeKey, SbTypeProfilingData> nodeTypeData;
   std::map<SbProfilingNodeNameKey, SbNameProfilingData> nodeNameData;
+  std::map<SbProfilingCounterKey, SbCounterProfilingData> counterData;
 
 }; // SbProfilingDataP
 
@@ -216,6 +238,7 @@ SbProfilingData::reset(void)
   PRIVATE(this)->nodeData.clear();
   PRIVATE(this)->nodeTypeData.clear();
   PRIVATE(this)->nodeNameData.clear();
+  PRIVATE(this)->counterData.clear();
   assert(PRIVATE(this)->nodeData.size() == 0);
   assert(PRIVATE(this)->nodeTypeData.size() == 0);
   assert(PRIVATE(this)->nodeNameData.size() == 0);
@@ -235,6 +258,7 @@ SbProfilingData::operator = (const SbProfilingData & rhs)
   PRIVATE(this)->nodeData = PRIVATE(&rhs)->nodeData;
   PRIVATE(this)->nodeTypeData = PRIVATE(&rhs)->nodeTypeData;
   PRIVATE(this)->nodeNameData = PRIVATE(&rhs)->nodeNameData;
+  PRIVATE(this)->counterData = PRIVATE(&rhs)->counterData;
   assert(PRIVATE(this)->nodeData.size() == PRIVATE(&rhs)->nodeData.size());
   return *this;
 }
@@ -397,6 +421,20 @@ SbProfilingData::operator += (const SbProfilingData & rhs)
     }
   }
 
+  { // counterData
+    typedef std::map<SbProfilingCounterKey, SbCounterProfilingData> maptype;
+    maptype::const_iterator srcit = PRIVATE(&rhs)->counterData.begin();
+    while (srcit != PRIVATE(&rhs)->counterData.end()) {
+      SbCounterProfilingData & dst = PRIVATE(this)->counterData[srcit->first];
+      dst.totaltime += srcit->second.totaltime;
+      dst.count += srcit->second.count;
+      if (srcit->second.maximumtime > dst.maximumtime) {
+        dst.maximumtime = srcit->second.maximumtime;
+      }
+      ++srcit;
+    }
+  }
+
   assert(PRIVATE(this)->nodeData.size() >= PRIVATE(&rhs)->nodeData.size());
   assert(PRIVATE(this)->nodeTypeData.size() >= PRIVATE(&rhs)->nodeTypeData.size());
   assert(PRIVATE(this)->nodeNameData.size() >= PRIVATE(&rhs)->nodeNameData.size());
@@ -1158,7 +1196,10 @@ SbProfilingData::getProfilingDataSize(void) const
     PRIVATE(this)->nodeTypeData.size() * sizeof(SbTypeProfilingData);
   size_t namestatsize =
     PRIVATE(this)->nodeNameData.size() * sizeof(SbNameProfilingData);
-  return nodestatsize + typestatsize + namestatsize + sizeof(SbProfilingDataP);
+  size_t counterstatsize =
+    PRIVATE(this)->counterData.size() * sizeof(SbCounterProfilingData);
+  return nodestatsize + typestatsize + namestatsize + counterstatsize +
+    sizeof(SbProfilingDataP);
 }
 
 /*!
@@ -1228,6 +1269,67 @@ SbProfilingData::getStatsForName(SbProfilingNodeNameKey name,
 
 // *************************************************************************
 
+/*!
+  Adds \a time and \a count to the counter named \a counter. Counters
+  are used for profiling work that is not tied to a single node, such
+  as rendering shadow maps, and are accumulated for the whole
+  traversal. The maximum time recorded for a counter is the largest
+  \a time added in one call.
+
+  \since Coin 4.0
+*/
+
+void
+SbProfilingData::addCounter(const SbName & counter, SbTime time, uint32_t count)
+{
+  SbCounterProfilingData & data = PRIVATE(this)->counterData[counter.getString()];
+  data.totaltime += time;
+  data.count += count;
+  if (time > data.maximumtime) {
+    data.maximumtime = time;
+  }
+}
+
+/*!
+  Returns the keys of all counters added with addCounter().
+
+  \since Coin 4.0
+*/
+
+void
+SbProfilingData::getCountersKeyList(SbList<SbProfilingCounterKey> & keys_out) const
+{
+  keys_out.truncate(0);
+  std::map<SbProfilingCounterKey, SbCounterProfilingData>::const_iterator it =
+    PRIVATE(this)->counterData.begin();
+  while (it != PRIVATE(this)->counterData.end()) {
+    keys_out.append(it->first);
+    ++it;
+  }
+}
+
+/*!
+  Returns the accumulated time, the maximum time and the count of the
+  counter \a counter.
+
+  \since Coin 4.0
+*/
+
+void
+SbProfilingData::getCounter(SbProfilingCounterKey counter,
+                            SbTime & totaltime, SbTime & maxtime,
+                            uint32_t & count) const
+{
+  std::map<SbProfilingCounterKey, SbCounterProfilingData>::const_iterator it =
+    PRIVATE(this)->counterData.find(counter);
+  assert(it != PRIVATE(this)->counterData.end());
+  totaltime = it->second.totaltime;
+  maxtime = it->second.maximumtime;
+  count = it->second.count;
+}
+
+// *************************************************************************
+
 int
 SbProfilingData::operator == (const SbProfilingData & rhs) const
 {
@@ -1244,7 +1346,18 @@ SbProfilingData::operator == (const SbProfilingData & rhs) const
 
   // NOTE: the type and name info maps are not checked, because they
   // are just aggregates of the nodedata records and would be equal if
-  // the node data is.
+  // the node data is. The counters are not, and are checked.
+  typedef std::map<SbProfilingCounterKey, SbCounterProfilingData> maptype;
+  const maptype & counters = PRIVATE(this)->counterData;
+  const maptype & rhscounters = PRIVATE(&rhs)->counterData;
+  if (counters.size() != rhscounters.size()) return FALSE;
+  maptype::const_iterator it = counters.begin(), rhsit = rhscounters.begin();
+  for (; it != counters.end(); ++it, ++rhsit) {
+    if (it->first != rhsit->first ||
+        it->second.totaltime != rhsit->second.totaltime ||
+        it->second.maximumtime != rhsit->second.maximumtime ||
+        it->second.count != rhsit->second.count) return FALSE;
+  }
 
   return TRUE;
 }
@@ -42,6 +42,7 @@
 
 #include "misc/SoDBP.h" // for global envvar COIN_PROFILER
 #include "profiler/SoProfilerP.h"
+#include "profiler/SoProfilerCountersP.h"
 
 /*
   The SoNodeProfiling class contains instrumentation code for scene
@@ -57,6 +58,10 @@
   If you combine doing both, then you get a lot of double-booking of
   timings and negative timing offsets, which causes mayhem in the
   statistics, and was a mess to figure out.
+
+  preTraversal() is also where the traversed nodes are counted for
+  SoProfilerCounters, since it is called at all the places nodes are
+  traversed from.
 */
 
 class SoNodeProfiling {
@@ -68,6 +73,7 @@ public:
 
   void preTraversal(SoAction * action)
   {
+    SoProfilerCountersP::count(SoProfilerCounters::NODES_TRAVERSED);
     if (!SoNodeProfiling::isActive(action)) return;
 
     SoState * state = action->getState();
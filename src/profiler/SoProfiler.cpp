@@ -72,10 +72,13 @@
 #include <Inventor/annex/Profiler/SoProfiler.h>
 #include "profiler/SoProfilerP.h"
 
+#include <cstdio>
+#include <map>
 #include <string>
 #include <vector>
 
 #include <Inventor/errors/SoDebugError.h>
+#include <Inventor/SbString.h>
 #include <Inventor/SoType.h>
 #include <Inventor/actions/SoActions.h>
 #include <Inventor/nodekits/SoNodeKit.h>
@@ -94,6 +97,7 @@
 
 #include "tidbitsp.h"
 #include "misc/SoDBP.h"
+#include "threads/threadsutilp.h"
 
 // *************************************************************************
 
@@ -132,6 +136,42 @@ namespace {
       static SbBool onstderr = FALSE;
     };
 
+    namespace exporter {
+      // the data of one traversal, copied out of SbProfilingData so
+      // the files can be written after the types and names are gone
+      struct Node {
+        int parent;
+        std::string type;
+        std::string name;
+        double self; // microseconds
+        SbBool cached;
+        SbBool culled;
+      };
+      struct Counter {
+        std::string name;
+        double total; // microseconds
+        double max;
+        uint32_t count;
+      };
+      struct Frame {
+        int number;
+        std::string action;
+        double start; // microseconds
+        double duration;
+        std::vector<Node> nodes;
+        std::vector<Counter> counters;
+      };
+
+      static int numframes = 0;
+      static int numrecorded = 0;
+      static std::vector<Frame> * frames = NULL; // ring buffer
+      static SoType actiontype = SoType::badType();
+      static std::string tracefile;
+      static std::string stacksfile;
+      static SbBool atexitregistered = FALSE;
+      static void * mutex = NULL;
+    };
+
   };
 
   void
@@ -151,6 +191,132 @@ namespace {
     }
   }
 
+  SbBool
+  enable_profiler_element(SoType actiontype)
+  {
+#define IF_ACTION(actionname)                                   \
+  if (actiontype.isDerivedFrom(actionname::getClassTypeId())) { \
+    SO_ENABLE(actionname, SoProfilerElement);                   \
+    return TRUE;                                                \
+  }
+
+    IF_ACTION(SoGLRenderAction)
+    else IF_ACTION(SoPickAction)
+    else IF_ACTION(SoCallbackAction)
+    else IF_ACTION(SoGetBoundingBoxAction)
+    else IF_ACTION(SoGetMatrixAction)
+    else IF_ACTION(SoGetPrimitiveCountAction)
+    else IF_ACTION(SoHandleEventAction)
+    else IF_ACTION(SoToVRMLAction)
+    else IF_ACTION(SoAudioRenderAction)
+    else IF_ACTION(SoSimplifyAction)
+#undef IF_ACTION
+    return FALSE;
+  }
+
+  void
+  export_atexit(void)
+  {
+    using namespace profiler::exporter;
+    if (!tracefile.empty()) {
+      SoProfiler::writeChromeTrace(tracefile.c_str());
+    }
+    if (!stacksfile.empty()) {
+      SoProfiler::writeCollapsedStacks(stacksfile.c_str());
+    }
+    delete frames;
+    frames = NULL;
+    numframes = 0;
+    CC_MUTEX_DESTRUCT(mutex);
+  }
+
+  void
+  export_set_num_frames(int num)
+  {
+    using namespace profiler::exporter;
+    CC_MUTEX_CONSTRUCT(mutex);
+    CC_MUTEX_LOCK(mutex);
+    numframes = SbMax(num, 0);
+    numrecorded = 0;
+    delete frames;
+    frames = numframes ? new std::vector<Frame>(numframes) : NULL;
+    CC_MUTEX_UNLOCK(mutex);
+
+    if (!atexitregistered) {
+      coin_atexit((coin_atexit_f *)export_atexit, CC_ATEXIT_NORMAL);
+      atexitregistered = TRUE;
+    }
+
+    if (numframes > 0) {
+      if (actiontype == SoType::badType()) {
+        actiontype = SoGLRenderAction::getClassTypeId();
+      }
+      if (!enable_profiler_element(actiontype)) {
+        SoDebugError::postInfo("SoProfiler::setNumExportFrames",
+                               "profiling action of type '%s' is not supported",
+                               actiontype.getName().getString());
+      }
+    }
+  }
+
+  FILE *
+  export_open(const char * source, const char * filename)
+  {
+    if (profiler::exporter::numrecorded == 0) {
+      SoDebugError::postWarning(source,
+                                "no profiling data recorded for '%s'", filename);
+      return NULL;
+    }
+    FILE * fp = fopen(filename, "w");
+    if (!fp) {
+      SoDebugError::postWarning(source,
+                                "couldn't open '%s' for writing", filename);
+    }
+    return fp;
+  }
+
+  // the recorded frames, oldest first
+  void
+  export_get_frames(std::vector<const profiler::exporter::Frame *> & list)
+  {
+    using namespace profiler::exporter;
+    const int first = SbMax(numrecorded - numframes, 0);
+    for (int i = first; i < numrecorded; i++) {
+      list.push_back(&(*frames)[i % numframes]);
+    }
+  }
+
+  // the time of each node including its children, which is what is
+  // shown in traces and flame graphs
+  void
+  export_get_inclusive(const profiler::exporter::Frame & frame,
+                       std::vector<double> & inclusive)
+  {
+    const int numnodes = static_cast<int>(frame.nodes.size());
+    inclusive.resize(numnodes);
+    for (int i = 0; i < numnodes; i++) {
+      inclusive[i] = frame.nodes[i].self;
+    }
+    // parents always come before their children
+    for (int i = numnodes - 1; i >= 0; i--) {
+      const int parent = frame.nodes[i].parent;
+      if (parent >= 0) inclusive[parent] += inclusive[i];
+    }
+  }
+
+  void
+  export_write_string(FILE * fp, const std::string & str)
+  {
+    fputc('"', fp);
+    for (std::string::size_type i = 0; i < str.size(); i++) {
+      const unsigned char c = static_cast<unsigned char>(str[i]);
+      if (c == '"' || c == '\\') fprintf(fp, "\\%c", c);
+      else if (c < 0x20) fprintf(fp, "\\u%04x", c);
+      else fputc(c, fp);
+    }
+    fputc('"', fp);
+  }
+
 } // namespace
 
 
@@ -261,28 +427,14 @@ SoProfilerP::shouldOutputHeaderOnConsole(void)
 void
 SoProfilerP::setActionType(SoType actiontype)
 {
-#define IF_ACTION(actionname)                                   \
-  if (actiontype.isDerivedFrom(actionname::getClassTypeId())) { \
-    SO_ENABLE(actionname, SoProfilerElement);                   \
-    profiler::console::actiontype = actiontype;                 \
-  }
-
-  IF_ACTION(SoGLRenderAction)
-  else IF_ACTION(SoPickAction)
-  else IF_ACTION(SoCallbackAction)
-  else IF_ACTION(SoGetBoundingBoxAction)
-  else IF_ACTION(SoGetMatrixAction)
-  else IF_ACTION(SoGetPrimitiveCountAction)
-  else IF_ACTION(SoHandleEventAction)
-  else IF_ACTION(SoToVRMLAction)
-  else IF_ACTION(SoAudioRenderAction)
-  else IF_ACTION(SoSimplifyAction)
+  if (enable_profiler_element(actiontype)) {
+    profiler::console::actiontype = actiontype;
+  }
   else {
     SoDebugError::postInfo("SoProfilerP::setActionType",
                            "profiling action of type '%s' is not supported",
                            actiontype.getName().getString());
   }
-#undef IF_ACTION
 }
 
 SoType
@@ -538,6 +690,64 @@ SoProfilerP::parseCoinProfilerOverlayVariable(void)
   }
 }
 
+void
+SoProfilerP::parseCoinProfilerExportVariable(void)
+{
+  // variable COIN_PROFILER_EXPORT
+  // - trace=<file>
+  // - stacks=<file>
+  // - frames=<int> - defaults to 100
+  // - action=<actionclass> - defaults to SoGLRenderAction
+  // implies COIN_PROFILER=on
+
+  const char * env = coin_getenv(SoDBP::EnvVars::COIN_PROFILER_EXPORT);
+  if (env == NULL || env[0] == '\0') return;
+  std::vector<std::string> parameters;
+  tokenize(env, ":", parameters);
+
+  int numframes = 100;
+  for (std::vector<std::string>::iterator it = parameters.begin(); it != parameters.end(); ++it) {
+    std::vector<std::string> param;
+    tokenize(*it, "=", param, 2);
+    if (param.size() < 2 || param[1].empty()) {
+      SoDebugError::postWarning("SoProfilerP::parseCoinProfilerExportVariable",
+                                "'%s' takes an argument.", param[0].data());
+    }
+    else if (param[0].compare("trace") == 0) {
+      profiler::exporter::tracefile = param[1];
+    }
+    else if (param[0].compare("stacks") == 0) {
+      profiler::exporter::stacksfile = param[1];
+    }
+    else if (param[0].compare("frames") == 0) {
+      numframes = atoi(param[1].data());
+      if (numframes < 1) {
+        SoDebugError::postWarning("SoProfilerP::parseCoinProfilerExportVariable",
+                                  "Number of frames out of range. Setting 100.");
+        numframes = 100;
+      }
+    }
+    else if (param[0].compare("action") == 0) {
+      SoType actiontype = SoType::fromName(param[1].data());
+      if (actiontype.isDerivedFrom(SoAction::getClassTypeId())) {
+        profiler::exporter::actiontype = actiontype;
+      } else {
+        SoDebugError::postWarning("SoProfilerP::parseCoinProfilerExportVariable",
+                                  "Classname '%s' does not specify an action type.",
+                                  param[1].data());
+      }
+    }
+    else {
+      SoDebugError::postWarning("SoProfilerP::parseCoinProfilerExportVariable",
+                                "Unknown COIN_PROFILER_EXPORT parameter '%s'.",
+                                param[0].data());
+    }
+  }
+
+  profiler::enabled = TRUE;
+  export_set_num_frames(numframes);
+}
+
 /*
   Default implementation for dumping on console instead of overlaying
   statistics over the 3D graphics.
@@ -588,4 +798,468 @@ SoProfilerP::dumpToConsole(const SbProfilingData & data)
 
   SoProfilingReportGenerator::freeCriteria(sortsettings);
   SoProfilingReportGenerator::freeCriteria(printsettings);
+
+  // the traversal time and the counters, for the work that isn't
+  // tied to one node
+  SbString line;
+  line.sprintf("%-40s %10.3f ms", "Traversal",
+               data.getActionDuration().getValue() * 1000.0);
+  callback(NULL, -1, line.getString());
+
+  SbList<SbProfilingCounterKey> counters;
+  data.getCountersKeyList(counters);
+  for (int i = 0; i < counters.getLength(); i++) {
+    SbTime total, max;
+    uint32_t count;
+    data.getCounter(counters[i], total, max, count);
+    line.sprintf("%-40s %10.3f ms %10.3f ms max %6u times",
+                 counters[i], total.getValue() * 1000.0,
+                 max.getValue() * 1000.0, count);
+    callback(NULL, -1, line.getString());
+  }
+}
+
+/*!
+  Sets the number of traversals to keep the profiling data from, for
+  writeChromeTrace() and writeCollapsedStacks().  When more traversals
+  are made, the data from the oldest ones is dropped.
+
+  Only traversals by the action set with the \c action option of \ref
+  COIN_PROFILER_EXPORT are kept, which is SoGLRenderAction by default,
+  so each traversal is normally one rendered frame.  Setting this to 0
+  stops recording and frees the recorded data.  It is 0 by default,
+  unless \ref COIN_PROFILER_EXPORT is set.
+
+  \since Coin 4.0
+*/
+void
+SoProfiler::setNumExportFrames(int numframes)
+{
+  if (!profiler::initialized) {
+    assert(!"SoProfiler module not initialized");
+    SoDebugError::post("SoProfiler::setNumExportFrames", "module not initialized");
+    return;
+  }
+  export_set_num_frames(numframes);
 }
+
+/*!
+  Returns the number of traversals to keep the profiling data from.
+
+  \since Coin 4.0
+*/
+int
+SoProfiler::getNumExportFrames(void)
+{
+  return profiler::exporter::numframes;
+}
+
+/*!
+  Writes the profiling data from the recorded traversals to \a
+  filename in the Chrome trace event format.  The file can be viewed
+  in chrome://tracing or with Perfetto.
+
+  Each traversal is an event named after the action type, with the
+  time used for each node type, and the counters (like the time used to
+  render shadow maps) as arguments.  The nodes are events nested
+  inside it, which last for the time used by the node and its
+  children.  Only the time used for each node is recorded, not when it
+  was traversed, so the events of the children are laid out after each
+  other from the start of the parent's event.  With the \c syncgl
+  option of \ref COIN_PROFILER, the node times include waiting for
+  the OpenGL rendering to finish.
+
+  Returns \c FALSE if nothing has been recorded or the file couldn't
+  be written.
+
+  \since Coin 4.0
+  \sa setNumExportFrames(), writeCollapsedStacks()
+*/
+SbBool
+SoProfiler::writeChromeTrace(const char * filename)
+{
+  using namespace profiler::exporter;
+  CC_MUTEX_CONSTRUCT(mutex);
+  CC_MUTEX_LOCK(mutex);
+  FILE * fp = export_open("SoProfiler::writeChromeTrace", filename);
+  if (!fp) {
+    CC_MUTEX_UNLOCK(mutex);
+    return FALSE;
+  }
+  std::vector<const Frame *> list;
+  export_get_frames(list);
+
+  fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+          "\"args\":{\"name\":\"Coin\"}}");
+
+  // one track for each action type, and times relative to the oldest
+  // traversal
+  std::map<std::string, int> tracks;
+  const double base = list[0]->start;
+  std::vector<double> inclusive, cursor;
+  for (size_t f = 0; f < list.size(); f++) {
+    const Frame & frame = *list[f];
+    int & tid = tracks[frame.action];
+    if (tid == 0) {
+      tid = static_cast<int>(tracks.size());
+      fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+              "\"args\":{\"name\":", tid);
+      export_write_string(fp, frame.action);
+      fprintf(fp, "}}");
+    }
+
+    fprintf(fp, ",\n{\"name\":");
+    export_write_string(fp, frame.action);
+    fprintf(fp, ",\"cat\":\"action\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+            "\"pid\":1,\"tid\":%d,\"args\":{\"frame\":%d,\"syncgl\":%s,\"types\":{",
+            frame.start - base, frame.duration, tid, frame.number,
+            profiler::rendering::syncgl ? "true" : "false");
+    std::map<std::string, std::pair<double, int> > types;
+    for (size_t i = 0; i < frame.nodes.size(); i++) {
+      std::pair<double, int> & type = types[frame.nodes[i].type];
+      type.first += frame.nodes[i].self;
+      type.second++;
+    }
+    for (std::map<std::string, std::pair<double, int> >::iterator it = types.begin();
+         it != types.end(); ++it) {
+      if (it != types.begin()) fputc(',', fp);
+      export_write_string(fp, it->first);
+      fprintf(fp, ":{\"self\":%.3f,\"count\":%d}", it->second.first, it->second.second);
+    }
+    fprintf(fp, "},\"counters\":{");
+    for (size_t i = 0; i < frame.counters.size(); i++) {
+      const Counter & counter = frame.counters[i];
+      if (i > 0) fputc(',', fp);
+      export_write_string(fp, counter.name);
+      fprintf(fp, ":{\"total\":%.3f,\"max\":%.3f,\"count\":%u}",
+              counter.total, counter.max, counter.count);
+    }
+    fprintf(fp, "}}}");
+
+    export_get_inclusive(frame, inclusive);
+    const int numnodes = static_cast<int>(frame.nodes.size());
+    cursor.resize(numnodes);
+    double rootcursor = frame.start - base;
+    for (int i = 0; i < numnodes; i++) {
+      const Node & node = frame.nodes[i];
+      double & parentcursor =
+        (node.parent >= 0 && node.parent < i) ? cursor[node.parent] : rootcursor;
+      cursor[i] = parentcursor;
+      parentcursor += inclusive[i];
+
+      fprintf(fp, ",\n{\"name\":");
+      export_write_string(fp, node.type);
+      fprintf(fp, ",\"cat\":\"node\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+              "\"pid\":1,\"tid\":%d,\"args\":{",
+              cursor[i], inclusive[i], tid);
+      if (!node.name.empty()) {
+        fprintf(fp, "\"name\":");
+        export_write_string(fp, node.name);
+        fputc(',', fp);
+      }
+      fprintf(fp, "\"self\":%.3f", node.self);
+      if (node.cached) fprintf(fp, ",\"cached\":true");
+      if (node.culled) fprintf(fp, ",\"culled\":true");
+      fprintf(fp, "}}");
+    }
+  }
+  fprintf(fp, "\n]}\n");
+  CC_MUTEX_UNLOCK(mutex);
+
+  SbBool ok = !ferror(fp);
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok) {
+    SoDebugError::postWarning("SoProfiler::writeChromeTrace",
+                              "couldn't write '%s'", filename);
+  }
+  return ok;
+}
+
+/*!
+  Writes the profiling data from the recorded traversals to \a
+  filename in the collapsed stack format, for making flame graphs with
+  tools like flamegraph.pl or speedscope.
+
+  There is one line for each path from the action down to a node, with
+  the types (and names) of the nodes separated by ';', and the time
+  used by the last node in the path itself, summed over all the
+  recorded traversals, in microseconds.  The time used by the action
+  outside of the nodes is on a line with just the action type.
+
+  Returns \c FALSE if nothing has been recorded or the file couldn't
+  be written.
+
+  \since Coin 4.0
+  \sa setNumExportFrames(), writeChromeTrace()
+*/
+SbBool
+SoProfiler::writeCollapsedStacks(const char * filename)
+{
+  using namespace profiler::exporter;
+  CC_MUTEX_CONSTRUCT(mutex);
+  CC_MUTEX_LOCK(mutex);
+  FILE * fp = export_open("SoProfiler::writeCollapsedStacks", filename);
+  if (!fp) {
+    CC_MUTEX_UNLOCK(mutex);
+    return FALSE;
+  }
+  std::vector<const Frame *> list;
+  export_get_frames(list);
+
+  std::map<std::string, double> stacks;
+  std::vector<double> inclusive;
+  std::vector<std::string> paths;
+  for (size_t f = 0; f < list.size(); f++) {
+    const Frame & frame = *list[f];
+    export_get_inclusive(frame, inclusive);
+    const int numnodes = static_cast<int>(frame.nodes.size());
+    paths.resize(numnodes);
+    double roottime = 0.0;
+    for (int i = 0; i < numnodes; i++) {
+      const Node & node = frame.nodes[i];
+      if (node.parent >= 0 && node.parent < i) {
+        paths[i] = paths[node.parent];
+      }
+      else {
+        paths[i] = frame.action;
+        roottime += inclusive[i];
+      }
+      paths[i] += ';';
+      paths[i] += node.type;
+      if (!node.name.empty()) {
+        paths[i] += '(';
+        paths[i] += node.name;
+        paths[i] += ')';
+      }
+      stacks[paths[i]] += node.self;
+    }
+    if (frame.duration > roottime) {
+      stacks[frame.action] += frame.duration - roottime;
+    }
+  }
+  CC_MUTEX_UNLOCK(mutex);
+
+  for (std::map<std::string, double>::iterator it = stacks.begin(); it != stacks.end(); ++it) {
+    const long microseconds = static_cast<long>(it->second + 0.5);
+    if (microseconds > 0) {
+      fprintf(fp, "%s %ld\n", it->first.c_str(), microseconds);
+    }
+  }
+
+  SbBool ok = !ferror(fp);
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok) {
+    SoDebugError::postWarning("SoProfiler::writeCollapsedStacks",
+                              "couldn't write '%s'", filename);
+  }
+  return ok;
+}
+
+SbBool
+SoProfilerP::isExportActive(void)
+{
+  return profiler::exporter::numframes > 0;
+}
+
+/*
+  Copies the profiling data from a traversal into the ring buffer of
+  recorded traversals.
+*/
+void
+SoProfilerP::recordExportFrame(const SbProfilingData & data)
+{
+  using namespace profiler::exporter;
+  if (!data.getActionType().isDerivedFrom(actiontype)) return;
+
+  CC_MUTEX_LOCK(mutex);
+  if (frames) {
+    Frame & frame = (*frames)[numrecorded % numframes];
+    frame.number = numrecorded++;
+    frame.action = data.getActionType().getName().getString();
+    frame.start = data.getActionStartTime().getValue() * 1000000.0;
+    frame.duration = data.getActionDuration().getValue() * 1000000.0;
+
+    const int numnodes = data.getNumNodeEntries();
+    frame.nodes.resize(numnodes);
+    for (int i = 0; i < numnodes; i++) {
+      Node & node = frame.nodes[i];
+      node.parent = data.getParentIndex(i);
+      node.type = data.getNodeType(i).getName().getString();
+      node.name = data.getNodeName(i).getString();
+      node.self = data.getNodeTiming(i).getValue() * 1000000.0;
+      node.cached = data.getNodeFlag(i, SbProfilingData::GL_CACHED_FLAG);
+      node.culled = data.getNodeFlag(i, SbProfilingData::CULLED_FLAG);
+    }
+
+    SbList<SbProfilingCounterKey> keys;
+    data.getCountersKeyList(keys);
+    frame.counters.resize(keys.getLength());
+    for (int i = 0; i < keys.getLength(); i++) {
+      Counter & counter = frame.counters[i];
+      SbTime total, max;
+      data.getCounter(keys[i], total, max, counter.count);
+      counter.name = keys[i];
+      counter.total = total.getValue() * 1000000.0;
+      counter.max = max.getValue() * 1000000.0;
+    }
+  }
+  CC_MUTEX_UNLOCK(mutex);
+}
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SoPath.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/annex/Profiler/SbProfilingData.h>
+#include <cstring>
+#include "profiler/SoProfilerP.h"
+
+namespace {
+
+// the profiling data of a traversal of a separator "a" holding a group
+// "b" holding a cube "c", where the nodes took 100, 200 and frame * 100
+// microseconds themselves and the traversal took 1000 microseconds
+void
+export_record_frame(SoSeparator * a, int frame)
+{
+  SbProfilingData data;
+  data.setActionType(SoGLRenderAction::getClassTypeId());
+  data.setActionStartTime(SbTime(double(frame)));
+  data.setActionStopTime(SbTime(double(frame) + 0.001));
+
+  SoPath * path = new SoPath(a);
+  path->ref();
+  data.setNodeTiming(data.getIndex(path, TRUE), SbTime(0.0001));
+  path->append(0);
+  data.setNodeTiming(data.getIndex(path, TRUE), SbTime(0.0002));
+  path->append(0);
+  data.setNodeTiming(data.getIndex(path, TRUE), SbTime(frame * 0.0001));
+  path->unref();
+
+  SoProfilerP::recordExportFrame(data);
+}
+
+std::string
+export_read_file(const char * filename)
+{
+  std::string contents;
+  FILE * fp = fopen(filename, "r");
+  if (fp) {
+    char buf[1024];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) contents.append(buf, n);
+    fclose(fp);
+  }
+  remove(filename);
+  return contents;
+}
+
+} // namespace
+
+// records more traversals than the ring buffer holds, and checks that
+// both export formats only hold the last ones
+BOOST_AUTO_TEST_CASE(exportFrames)
+{
+  const SbBool wasenabled = SoProfiler::isEnabled();
+  SoProfiler::init();
+  // only the traversals recorded below should be exported
+  SoProfiler::enable(FALSE);
+
+  SoSeparator * a = new SoSeparator;
+  a->ref();
+  a->setName("a");
+  SoGroup * b = new SoGroup;
+  b->setName("b");
+  a->addChild(b);
+  SoCube * c = new SoCube;
+  c->setName("c");
+  b->addChild(c);
+
+  const char * tracefile = "SoProfiler_export_test.json";
+  const char * stacksfile = "SoProfiler_export_test.txt";
+
+  SoProfiler::setNumExportFrames(3);
+  BOOST_CHECK_EQUAL(SoProfiler::getNumExportFrames(), 3);
+  for (int frame = 1; frame <= 5; frame++) {
+    export_record_frame(a, frame);
+  }
+
+  BOOST_CHECK(SoProfiler::writeChromeTrace(tracefile));
+  const std::string trace = export_read_file(tracefile);
+  BOOST_CHECK_MESSAGE(trace.compare(0, 18, "{\"displayTimeUnit\"") == 0 &&
+                      trace.find("\"traceEvents\":[") != std::string::npos,
+                      "no trace events in the Chrome trace");
+  int depth = 0, numactions = 0, numnodes = 0, firstframe = -1;
+  std::string::size_type pos = 0;
+  for (; pos < trace.size(); pos++) {
+    const char ch = trace[pos];
+    if (ch == '{' || ch == '[') depth++;
+    else if (ch == '}' || ch == ']') depth--;
+    BOOST_REQUIRE_MESSAGE(depth >= 0, "unbalanced Chrome trace");
+  }
+  BOOST_CHECK_MESSAGE(depth == 0, "unbalanced Chrome trace");
+
+  // one event per line after the first, and the metadata events have
+  // no times
+  pos = trace.find('\n');
+  while (pos != std::string::npos && pos + 1 < trace.size()) {
+    const std::string::size_type end = trace.find('\n', pos + 1);
+    const std::string event = trace.substr(pos + 1, end - pos - 1);
+    pos = end;
+    if (event.find("\"ph\":\"X\"") == std::string::npos) continue;
+    double ts = -1.0, dur = -1.0;
+    const std::string::size_type tspos = event.find("\"ts\":");
+    const std::string::size_type durpos = event.find("\"dur\":");
+    BOOST_REQUIRE_MESSAGE(tspos != std::string::npos && durpos != std::string::npos,
+                          "event without times: " << event);
+    sscanf(event.c_str() + tspos + 5, "%lf", &ts);
+    sscanf(event.c_str() + durpos + 6, "%lf", &dur);
+    BOOST_CHECK_MESSAGE(ts >= 0.0 && dur > 0.0,
+                        "bad times in event: " << event);
+    if (event.find("\"cat\":\"action\"") != std::string::npos) {
+      numactions++;
+      BOOST_CHECK_MESSAGE(dur > 999.0 && dur < 1001.0,
+                          "traversal lasted " << dur << " us, not 1000");
+      int frame = -1;
+      const std::string::size_type framepos = event.find("\"frame\":");
+      if (framepos != std::string::npos) {
+        sscanf(event.c_str() + framepos + 8, "%d", &frame);
+      }
+      if (firstframe < 0) firstframe = frame;
+    }
+    else if (event.find("\"cat\":\"node\"") != std::string::npos) {
+      numnodes++;
+    }
+  }
+  // frames are numbered from 0, so the last three are 2, 3 and 4
+  BOOST_CHECK_EQUAL(numactions, 3);
+  BOOST_CHECK_EQUAL(numnodes, 9);
+  BOOST_CHECK_EQUAL(firstframe, 2);
+
+  BOOST_CHECK(SoProfiler::writeCollapsedStacks(stacksfile));
+  const std::string stacks = export_read_file(stacksfile);
+  // self times summed over frames 3, 4 and 5 of export_record_frame(),
+  // and the rest of the traversal time for the action itself
+  const char * expected =
+    "SoGLRenderAction 900\n"
+    "SoGLRenderAction;Separator(a) 300\n"
+    "SoGLRenderAction;Separator(a);Group(b) 600\n"
+    "SoGLRenderAction;Separator(a);Group(b);Cube(c) 1200\n";
+  BOOST_CHECK_MESSAGE(stacks == expected,
+                      "collapsed stacks were:\n" << stacks);
+
+  SoProfiler::setNumExportFrames(0);
+  BOOST_CHECK_EQUAL(SoProfiler::getNumExportFrames(), 0);
+  export_record_frame(a, 6);
+  BOOST_CHECK(!SoProfiler::writeCollapsedStacks(stacksfile));
+  export_read_file(stacksfile);
+
+  a->unref();
+  SoProfiler::enable(wasenabled);
+}
+
+#endif // COIN_TEST_SUITE
@@ -0,0 +1,479 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoProfilerCounters SoProfilerCounters.h Inventor/annex/Profiler/SoProfilerCounters.h
+  \brief Cheap counters for the work done by the scene graph traversals.
+
+  \ingroup coin_profiler
+
+  The profiling enabled with SoProfiler reads the time before and
+  after traversing every node, which slows down the traversals too
+  much to leave it on in an application that is in use.  These
+  counters just count how many times things are done, which is cheap
+  enough to be enabled all the time:
+
+  - SoProfilerCounters::FRAMES - SoGLRenderAction traversals
+  - SoProfilerCounters::NODES_TRAVERSED - nodes traversed by any action
+  - SoProfilerCounters::SEPARATORS_CULLED - separators culled because
+    they were outside the view volume
+  - SoProfilerCounters::CACHE_HITS - render caches used
+  - SoProfilerCounters::CACHE_MISSES - separators that didn't have a
+    valid render cache
+  - SoProfilerCounters::VBO_UPLOADS - vertex buffer objects sent to
+    OpenGL
+  - SoProfilerCounters::TEXTURE_UPLOADS - textures sent to OpenGL
+  - SoProfilerCounters::STATE_PUSHES - SoState::push() calls
+  - SoProfilerCounters::NOTIFICATIONS - nodes notified about changes
+
+  When the counters are disabled, which is the default, each place
+  that counts something only tests a flag.  When they are enabled,
+  each thread increments its own counters, which it finds through a
+  thread-local pointer, so counting takes no locks and the threads
+  don't share any counters.  get() adds up the counters from all the
+  threads.
+
+  The counters can be enabled with enable() or the \ref
+  COIN_PROFILER_COUNTERS environment variable, which can also make
+  Coin print the counters every few seconds.
+
+  \since Coin 4.0
+*/
+
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <Inventor/annex/Profiler/SoProfilerCounters.h>
+#include "profiler/SoProfilerCountersP.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include <Inventor/C/threads/storage.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/errors/SoDebugError.h>
+
+#include "tidbitsp.h"
+#include "misc/SoDBP.h"
+#include "threads/threadsutilp.h"
+
+// *************************************************************************
+
+namespace {
+
+  // the counters of one thread. They are only written by the thread
+  // itself, so relaxed loads and stores are enough to let the other
+  // threads read them while the thread is counting. The sums may lag
+  // a little behind.
+  struct ThreadCounters {
+    std::atomic<uint64_t> counts[SoProfilerCounters::NUM_COUNTERS];
+  };
+
+  // the counters of the calling thread, looked up in the storage the
+  // first time the thread counts something. The generation tells if
+  // the storage has been reconstructed since.
+  struct ThreadCache {
+    ThreadCounters * counters;
+    unsigned int generation;
+  };
+  static thread_local ThreadCache threadcache = { NULL, 0 };
+
+  namespace counters {
+    // the counters of each thread. The counters of a thread are kept
+    // after the thread exits, so its counts are still included.
+    static cc_storage * storage = NULL;
+    // incremented each time the storage is constructed
+    static unsigned int generation = 0;
+    // protects the members below
+    static void * mutex = NULL;
+    // the counts when reset() and dump() were last called
+    static uint64_t base[SoProfilerCounters::NUM_COUNTERS];
+    static uint64_t dumped[SoProfilerCounters::NUM_COUNTERS];
+    static double dumpinterval = 0.0;
+    static SbTime lastdump;
+
+    static const char * names[SoProfilerCounters::NUM_COUNTERS] = {
+      "frames",
+      "nodes traversed",
+      "separators culled",
+      "cache hits",
+      "cache misses",
+      "VBO uploads",
+      "texture uploads",
+      "state pushes",
+      "notifications"
+    };
+  };
+
+  void
+  counters_construct(void * closure)
+  {
+    ThreadCounters * tc = new (closure) ThreadCounters;
+    for (int i = 0; i < SoProfilerCounters::NUM_COUNTERS; i++) {
+      tc->counts[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void
+  counters_add(void * closure, void * data)
+  {
+    const ThreadCounters * tc = static_cast<const ThreadCounters *>(closure);
+    uint64_t * values = static_cast<uint64_t *>(data);
+    for (int i = 0; i < SoProfilerCounters::NUM_COUNTERS; i++) {
+      values[i] += tc->counts[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  void
+  counters_cleanup(void)
+  {
+    SoProfilerCountersP::enabled = FALSE;
+    cc_storage_destruct(counters::storage);
+    counters::storage = NULL;
+    CC_MUTEX_DESTRUCT(counters::mutex);
+  }
+
+  // the counts of all the threads, must be called with the mutex
+  // locked
+  void
+  counters_sum(uint64_t values[SoProfilerCounters::NUM_COUNTERS])
+  {
+    for (int i = 0; i < SoProfilerCounters::NUM_COUNTERS; i++) {
+      values[i] = 0;
+    }
+    if (counters::storage) {
+      cc_storage_apply_to_all(counters::storage, counters_add, values);
+    }
+  }
+
+  void
+  counters_dump(const SbTime & now, const SbBool ifdue)
+  {
+    CC_MUTEX_LOCK(counters::mutex);
+    const double seconds = (now - counters::lastdump).getValue();
+    // another thread may have dumped the counters in the meantime
+    if (ifdue && seconds < counters::dumpinterval) {
+      CC_MUTEX_UNLOCK(counters::mutex);
+      return;
+    }
+
+    uint64_t values[SoProfilerCounters::NUM_COUNTERS];
+    counters_sum(values);
+    const uint64_t frames =
+      values[SoProfilerCounters::FRAMES] - counters::dumped[SoProfilerCounters::FRAMES];
+
+    FILE * fp = coin_get_stderr();
+    fprintf(fp, "SoProfilerCounters: %llu frames in %.2f seconds\n",
+            (unsigned long long) frames, seconds);
+    for (int i = SoProfilerCounters::FRAMES + 1; i < SoProfilerCounters::NUM_COUNTERS; i++) {
+      const uint64_t count = values[i] - counters::dumped[i];
+      fprintf(fp, "  %-20s %12llu", counters::names[i], (unsigned long long) count);
+      if (frames > 0) {
+        fprintf(fp, " %12.1f per frame", double(count) / double(frames));
+      }
+      fputc('\n', fp);
+    }
+    fflush(fp);
+
+    memcpy(counters::dumped, values, sizeof(values));
+    counters::lastdump = now;
+    CC_MUTEX_UNLOCK(counters::mutex);
+  }
+
+} // namespace
+
+// *************************************************************************
+
+SbBool SoProfilerCountersP::enabled = FALSE;
+
+/*
+  Called from SoDB::init().
+*/
+void
+SoProfilerCountersP::init(void)
+{
+  CC_MUTEX_CONSTRUCT(counters::mutex);
+  counters::storage =
+    cc_storage_construct_etc(sizeof(ThreadCounters), counters_construct, NULL);
+  counters::generation++;
+  coin_atexit((coin_atexit_f *) counters_cleanup, CC_ATEXIT_NORMAL);
+}
+
+/*
+  Increments a counter of the calling thread.  The first time a thread
+  counts something, its counters are allocated by the storage, which
+  takes the storage's lock.  After that the thread uses its cached
+  pointer and doesn't lock anything.
+*/
+void
+SoProfilerCountersP::increment(SoProfilerCounters::Counter counter)
+{
+  ThreadCache & cache = threadcache;
+  if (cache.generation != counters::generation) {
+    cache.counters =
+      static_cast<ThreadCounters *>(cc_storage_get(counters::storage));
+    cache.generation = counters::generation;
+  }
+  std::atomic<uint64_t> & count = cache.counters->counts[counter];
+  count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/*
+  Called after each SoGLRenderAction traversal when the counters are
+  enabled.
+*/
+void
+SoProfilerCountersP::endFrame(void)
+{
+  SoProfilerCountersP::increment(SoProfilerCounters::FRAMES);
+  if (counters::dumpinterval > 0.0) {
+    const SbTime now = SbTime::getTimeOfDay();
+    if ((now - counters::lastdump).getValue() >= counters::dumpinterval) {
+      counters_dump(now, TRUE);
+    }
+  }
+}
+
+void
+SoProfilerCountersP::parseCoinProfilerCountersVariable(void)
+{
+  // variable COIN_PROFILER_COUNTERS
+  // - on
+  // - off
+  // - dump=<seconds> - implies on
+
+  const char * env = coin_getenv(SoDBP::EnvVars::COIN_PROFILER_COUNTERS);
+  if (env == NULL) return;
+  const std::string parameters(env);
+  std::string::size_type start = 0;
+  while (start < parameters.size()) {
+    std::string::size_type end = parameters.find(':', start);
+    if (end == std::string::npos) end = parameters.size();
+    const std::string param = parameters.substr(start, end - start);
+    start = end + 1;
+
+    if (param.compare("on") == 0) {
+      SoProfilerCounters::enable(TRUE);
+    }
+    else if (param.compare("off") == 0) {
+      SoProfilerCounters::enable(FALSE);
+    }
+    else if (param.compare(0, 5, "dump=") == 0) {
+      const double seconds = atof(param.substr(5).c_str());
+      if (seconds > 0.0) {
+        SoProfilerCounters::enable(TRUE);
+        SoProfilerCounters::setDumpInterval(seconds);
+      }
+      else {
+        SoDebugError::postWarning("SoProfilerCountersP::parseCoinProfilerCountersVariable",
+                                  "'dump' takes a positive number of seconds.");
+      }
+    }
+    else if (!param.empty()) {
+      SoDebugError::postWarning("SoProfilerCountersP::parseCoinProfilerCountersVariable",
+                                "Unknown COIN_PROFILER_COUNTERS parameter '%s'.",
+                                param.c_str());
+    }
+  }
+}
+
+// *************************************************************************
+
+/*!
+  Enables or disables counting.  Disabling the counters doesn't reset
+  them.
+
+  \sa reset()
+*/
+void
+SoProfilerCounters::enable(SbBool enable)
+{
+  if (enable && !SoProfilerCountersP::enabled) {
+    CC_MUTEX_LOCK(counters::mutex);
+    counters::lastdump = SbTime::getTimeOfDay();
+    CC_MUTEX_UNLOCK(counters::mutex);
+  }
+  SoProfilerCountersP::enabled = enable;
+}
+
+/*!
+  Returns whether the counters are enabled.
+*/
+SbBool
+SoProfilerCounters::isEnabled(void)
+{
+  return SoProfilerCountersP::enabled;
+}
+
+/*!
+  Returns the value of \a counter, summed over all the threads, since
+  the counters were last reset.
+*/
+uint64_t
+SoProfilerCounters::get(Counter counter)
+{
+  CC_MUTEX_LOCK(counters::mutex);
+  uint64_t values[NUM_COUNTERS];
+  counters_sum(values);
+  const uint64_t value = values[counter] - counters::base[counter];
+  CC_MUTEX_UNLOCK(counters::mutex);
+  return value;
+}
+
+/*!
+  Returns a name for \a counter that can be shown to the user.
+*/
+const char *
+SoProfilerCounters::getName(Counter counter)
+{
+  return counters::names[counter];
+}
+
+/*!
+  Sets all the counters to 0.
+*/
+void
+SoProfilerCounters::reset(void)
+{
+  CC_MUTEX_LOCK(counters::mutex);
+  counters_sum(counters::base);
+  memcpy(counters::dumped, counters::base, sizeof(counters::base));
+  counters::lastdump = SbTime::getTimeOfDay();
+  CC_MUTEX_UNLOCK(counters::mutex);
+}
+
+/*!
+  Makes Coin print the counters with dump() every \a seconds seconds,
+  after the SoGLRenderAction traversal that ends the period.  0, which
+  is the default, turns this off.
+
+  \sa COIN_PROFILER_COUNTERS
+*/
+void
+SoProfilerCounters::setDumpInterval(double seconds)
+{
+  CC_MUTEX_LOCK(counters::mutex);
+  counters::dumpinterval = SbMax(seconds, 0.0);
+  counters::lastdump = SbTime::getTimeOfDay();
+  CC_MUTEX_UNLOCK(counters::mutex);
+}
+
+/*!
+  Returns the number of seconds between each time the counters are
+  printed, or 0 if they aren't printed.
+*/
+double
+SoProfilerCounters::getDumpInterval(void)
+{
+  return counters::dumpinterval;
+}
+
+/*!
+  Prints how much each counter has increased since the last dump or
+  reset to stderr, both in total and per frame.
+*/
+void
+SoProfilerCounters::dump(void)
+{
+  counters_dump(SbTime::getTimeOfDay(), FALSE);
+}
+
+// *************************************************************************
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/C/threads/thread.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+static void *
+counters_traverse(void * closure)
+{
+  SoGetBoundingBoxAction action(SbViewportRegion(100, 100));
+  action.apply(static_cast<SoNode *>(closure));
+  return NULL;
+}
+
+BOOST_AUTO_TEST_CASE(counting)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCube * cube = new SoCube;
+  root->addChild(cube);
+
+  const SbBool wasenabled = SoProfilerCounters::isEnabled();
+  SoProfilerCounters::enable(TRUE);
+  SoProfilerCounters::reset();
+
+  counters_traverse(root);
+  BOOST_CHECK_MESSAGE(SoProfilerCounters::get(SoProfilerCounters::NODES_TRAVERSED) == 2,
+                      "Should count the separator and the cube");
+  BOOST_CHECK_MESSAGE(SoProfilerCounters::get(SoProfilerCounters::STATE_PUSHES) > 0,
+                      "Should count the separator's state push");
+
+  cube->width = 3.0f;
+  BOOST_CHECK_MESSAGE(SoProfilerCounters::get(SoProfilerCounters::NOTIFICATIONS) == 2,
+                      "Should count the notification of the cube and the separator");
+
+  uint64_t traversed = SoProfilerCounters::get(SoProfilerCounters::NODES_TRAVERSED);
+  if (cc_thread_implementation() != CC_NO_THREADS) {
+    cc_thread * thread = cc_thread_construct(counters_traverse, root);
+    (void)cc_thread_join(thread, NULL);
+    cc_thread_destruct(thread);
+    BOOST_CHECK_MESSAGE(SoProfilerCounters::get(SoProfilerCounters::NODES_TRAVERSED) > traversed,
+                        "Should keep the counts of threads that have exited");
+  }
+
+  SoProfilerCounters::enable(FALSE);
+  traversed = SoProfilerCounters::get(SoProfilerCounters::NODES_TRAVERSED);
+  counters_traverse(root);
+  BOOST_CHECK_MESSAGE(SoProfilerCounters::get(SoProfilerCounters::NODES_TRAVERSED) == traversed,
+                      "Should not count when disabled");
+
+  SoProfilerCounters::reset();
+  BOOST_CHECK_MESSAGE(SoProfilerCounters::get(SoProfilerCounters::NODES_TRAVERSED) == 0,
+                      "Should be 0 after reset");
+
+  SoProfilerCounters::enable(wasenabled);
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -49,11 +49,15 @@ public:
 
   static void parseCoinProfilerVariable(void);
   static void parseCoinProfilerOverlayVariable(void);
+  static void parseCoinProfilerExportVariable(void);
 
   static void setActionType(SoType actiontype);
   static SoType getActionType(void);
 
   static void dumpToConsole(const SbProfilingData & data);
+
+  static SbBool isExportActive(void);
+  static void recordExportFrame(const SbProfilingData & data);
 };
 
 #endif // !COIN_SOPROFILERP_H
@@ -35,6 +35,7 @@
 #endif // HAVE_CONFIG_H
 
 #include "SoProfiler.cpp"
+#include "SoProfilerCounters.cpp"
 #include "SbProfilingData.cpp"
 #include "SoProfilingReportGenerator.cpp"
 #include "SoProfilerElement.cpp"
@@ -35,6 +35,7 @@
 #include <climits>
 
 #include <Inventor/C/glue/gl.h>
+#include <Inventor/C/tidbits.h>
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/misc/SoContextHandler.h>
 #include <Inventor/elements/SoGLCacheContextElement.h>
@@ -46,6 +47,10 @@
 #include "glue/gl_wgl.h"
 #endif /* HAVE_CONFIG_H */
 
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif // GL_PIXEL_PACK_BUFFER
+
 // *************************************************************************
 
 unsigned int CoinOffscreenGLCanvas::tilesizeroof = UINT_MAX;
@@ -57,6 +62,7 @@ CoinOffscreenGLCanvas::CoinOffscreenGLCanvas(void)
   this->size = SbVec2s(0, 0);
   this->context = NULL;
   this->current_hdc = NULL;
+  this->pbo[0] = this->pbo[1] = 0;
 }
 
 CoinOffscreenGLCanvas::~CoinOffscreenGLCanvas()
@@ -291,6 +297,10 @@ CoinOffscreenGLCanvas::destructContext(void)
   assert(this->context);
 
   if (cc_glglue_context_make_current(this->context)) {
+    if (this->pbo[0]) {
+      const cc_glglue * glw = cc_glglue_instance(this->renderid);
+      cc_glglue_glDeleteBuffers(glw, 2, this->pbo);
+    }
     SoContextHandler::destructingContext(this->renderid);
     this->deactivateGLContext();
   }
@@ -307,6 +317,7 @@ CoinOffscreenGLCanvas::destructContext(void)
   this->context = NULL;
   this->renderid = 0;
   this->current_hdc = NULL;
+  this->pbo[0] = this->pbo[1] = 0;
 }
 
 // *************************************************************************
@@ -324,22 +335,15 @@ cc_glglue_win32_updateHDCBitmap(this->context);
 }
 // *************************************************************************
 
-// Pushes the rendered pixels into the internal memory array.
+// Resets all settings that can influence the result of a
+// glReadPixels() call, to make sure we get the actual contents of the
+// buffer, unmodified.
+//
+// The values set up below matches the default settings of an OpenGL
+// driver.
 void
-CoinOffscreenGLCanvas::readPixels(uint8_t * dst,
-                                  const SbVec2s & vpdims,
-                                  unsigned int dstrowsize,
-                                  unsigned int nrcomponents) const
+CoinOffscreenGLCanvas::setupReadPixels(unsigned int dstrowsize)
 {
-  glPushAttrib(GL_ALL_ATTRIB_BITS);
-
-  // First reset all settings that can influence the result of a
-  // glReadPixels() call, to make sure we get the actual contents of
-  // the buffer, unmodified.
-  //
-  // The values set up below matches the default settings of an
-  // OpenGL driver.
-
   glPixelStorei(GL_PACK_SWAP_BYTES, 0);
   glPixelStorei(GL_PACK_LSB_FIRST, 0);
   glPixelStorei(GL_PACK_ROW_LENGTH, (GLint)dstrowsize);
@@ -378,6 +382,17 @@ CoinOffscreenGLCanvas::readPixels(uint8_t * dst,
   glPixelMapfv(GL_PIXEL_MAP_G_TO_G, 1, &f);
   glPixelMapfv(GL_PIXEL_MAP_B_TO_B, 1, &f);
   glPixelMapfv(GL_PIXEL_MAP_A_TO_A, 1, &f);
+}
+
+// Pushes the rendered pixels into the internal memory array.
+void
+CoinOffscreenGLCanvas::readPixels(uint8_t * dst,
+                                  const SbVec2s & vpdims,
+                                  unsigned int dstrowsize,
+                                  unsigned int nrcomponents) const
+{
+  glPushAttrib(GL_ALL_ATTRIB_BITS);
+  CoinOffscreenGLCanvas::setupReadPixels(dstrowsize);
 
   // The flushing of the OpenGL pipeline before and after the
   // glReadPixels() call is done as a work-around for a reported
@@ -432,6 +447,91 @@ CoinOffscreenGLCanvas::readPixels(uint8_t * dst,
   glPopAttrib();
 }
 
+// Pixel buffer objects are used for readback with beginReadPixels()
+// when the driver supports them. Set the environment variable
+// COIN_OFFSCREENRENDERER_PBO to "0" to always read the pixels
+// synchronously.
+SbBool
+CoinOffscreenGLCanvas::usePixelBuffers(void)
+{
+  static int flag = -1; // -1 means "not initialized" in this context
+  if (flag == -1) {
+    const char * env = coin_getenv("COIN_OFFSCREENRENDERER_PBO");
+    flag = (env && (atoi(env) == 0)) ? 0 : 1;
+  }
+  return flag;
+}
+
+// Starts reading the rendered pixels into one of two pixel buffer
+// objects, without waiting for the rendering to finish, so the
+// caller can go on rendering into the canvas while the pixels are
+// transferred. The pixels are fetched later with mapPixels(), tightly
+// packed, and nrcomponents must be 3 or 4.
+//
+// Returns FALSE if pixel buffer objects can't be used, and
+// readPixels() must be used instead.
+SbBool
+CoinOffscreenGLCanvas::beginReadPixels(const int slot, const SbVec2s & vpdims,
+                                       unsigned int nrcomponents)
+{
+  assert((slot >= 0) && (slot < 2));
+  assert((nrcomponents == 3) || (nrcomponents == 4));
+  if (!CoinOffscreenGLCanvas::usePixelBuffers()) { return FALSE; }
+
+  const cc_glglue * glw = cc_glglue_instance(this->renderid);
+  if (this->pbo[0] == 0) {
+    if (!cc_glglue_has_vertex_buffer_object(glw) ||
+        !(cc_glglue_glversion_matches_at_least(glw, 2, 1, 0) ||
+          cc_glglue_glext_supported(glw, "GL_ARB_pixel_buffer_object"))) {
+      return FALSE;
+    }
+    cc_glglue_glGenBuffers(glw, 2, this->pbo);
+  }
+
+  glPushAttrib(GL_ALL_ATTRIB_BITS);
+  CoinOffscreenGLCanvas::setupReadPixels(0);
+
+  cc_glglue_glBindBuffer(glw, GL_PIXEL_PACK_BUFFER, this->pbo[slot]);
+  // allocate new storage, so the driver doesn't have to wait for the
+  // previous contents to be mapped and released
+  cc_glglue_glBufferData(glw, GL_PIXEL_PACK_BUFFER,
+                         intptr_t(vpdims[0]) * intptr_t(vpdims[1]) * nrcomponents,
+                         NULL, GL_STREAM_READ);
+  glReadPixels(0, 0, vpdims[0], vpdims[1],
+               nrcomponents == 3 ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  cc_glglue_glBindBuffer(glw, GL_PIXEL_PACK_BUFFER, 0);
+
+  glPopAttrib();
+  return TRUE;
+}
+
+// Waits for the pixels read by beginReadPixels() into the slot, and
+// returns a pointer to them. Must be followed by unmapPixels() if not
+// NULL.
+const uint8_t *
+CoinOffscreenGLCanvas::mapPixels(const int slot)
+{
+  assert((slot >= 0) && (slot < 2) && this->pbo[slot]);
+
+  const cc_glglue * glw = cc_glglue_instance(this->renderid);
+  cc_glglue_glBindBuffer(glw, GL_PIXEL_PACK_BUFFER, this->pbo[slot]);
+  const void * ptr = cc_glglue_glMapBuffer(glw, GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+  if (ptr == NULL) {
+    cc_glglue_glBindBuffer(glw, GL_PIXEL_PACK_BUFFER, 0);
+  }
+  return (const uint8_t *) ptr;
+}
+
+void
+CoinOffscreenGLCanvas::unmapPixels(const int slot)
+{
+  assert((slot >= 0) && (slot < 2) && this->pbo[slot]);
+
+  const cc_glglue * glw = cc_glglue_instance(this->renderid);
+  (void)cc_glglue_glUnmapBuffer(glw, GL_PIXEL_PACK_BUFFER);
+  cc_glglue_glBindBuffer(glw, GL_PIXEL_PACK_BUFFER, 0);
+}
+
 // *************************************************************************
 
 static SbBool tilesize_cached = FALSE;
@@ -444,29 +544,31 @@ static void tilesize_cleanup(void)
 }
 
 // Return largest size of offscreen canvas system can handle. Will
-// cache result, so only the first look-up is expensive.
+// cache the driver's limits, so only the first look-up is expensive.
 SbVec2s
 CoinOffscreenGLCanvas::getMaxTileSize(void)
 {
   // cache the values in static variables so that a new context is not
   // created every time render() is called in SoOffscreenRenderer
-  if (tilesize_cached) return SbVec2s((short)maxtile[0], (short)maxtile[1]);
-
-  tilesize_cached = TRUE; // Flip on first run.
+  if (!tilesize_cached) {
+    tilesize_cached = TRUE; // Flip on first run.
 
-  coin_atexit((coin_atexit_f*) tilesize_cleanup, CC_ATEXIT_NORMAL);
+    coin_atexit((coin_atexit_f*) tilesize_cleanup, CC_ATEXIT_NORMAL);
 
-  unsigned int width, height;
-  cc_glglue_context_max_dimensions(&width, &height);
+    cc_glglue_context_max_dimensions(&maxtile[0], &maxtile[1]);
 
-  if (CoinOffscreenGLCanvas::debug()) {
-    SoDebugError::postInfo("CoinOffscreenGLCanvas::getMaxTileSize",
-                           "cc_glglue_context_max_dimensions()==[%u, %u]",
-                           width, height);
+    if (CoinOffscreenGLCanvas::debug()) {
+      SoDebugError::postInfo("CoinOffscreenGLCanvas::getMaxTileSize",
+                             "cc_glglue_context_max_dimensions()==[%u, %u]",
+                             maxtile[0], maxtile[1]);
+    }
   }
+  unsigned int width = maxtile[0];
+  unsigned int height = maxtile[1];
 
   // Makes it possible to override the default tilesizes. Should prove
-  // useful for debugging problems on remote sites.
+  // useful for debugging problems on remote sites. These are checked
+  // on every call, so that they can be changed between renderings.
   const char * env = coin_getenv("COIN_OFFSCREENRENDERER_TILEWIDTH");
   const unsigned int forcedtilewidth = env ? atoi(env) : 0;
   env = coin_getenv("COIN_OFFSCREENRENDERER_TILEHEIGHT");
@@ -483,12 +585,11 @@ CoinOffscreenGLCanvas::getMaxTileSize(void)
     height = SbMin(height, maxtilesize);
   }
 
-  // cache result for later calls, and clamp to fit within a short
-  // integer type
-  maxtile[0] = SbMin(width, (unsigned int)SHRT_MAX);
-  maxtile[1] = SbMin(height, (unsigned int)SHRT_MAX);
+  // clamp to fit within a short integer type
+  width = SbMin(width, (unsigned int)SHRT_MAX);
+  height = SbMin(height, (unsigned int)SHRT_MAX);
 
-  return SbVec2s((short)maxtile[0], (short)maxtile[1]);
+  return SbVec2s((short)width, (short)height);
 }
 
 // *************************************************************************
@@ -58,6 +58,11 @@ public:
                   unsigned int dstrowsize,
                   unsigned int nrcomponents) const;
 
+  SbBool beginReadPixels(const int slot, const SbVec2s & vpdims,
+                         unsigned int nrcomponents);
+  const uint8_t * mapPixels(const int slot);
+  void unmapPixels(const int slot);
+
   static SbBool debug(void);
 
   static SbBool allowResourcehog(void);
@@ -69,6 +74,8 @@ private:
   static void clampToPixelSizeRoof(SbVec2s & s);
   static SbVec2s getMaxTileSize(void);
   static unsigned int tilesizeroof;
+  static void setupReadPixels(unsigned int dstrowsize);
+  static SbBool usePixelBuffers(void);
   uint32_t tryActivateGLContext(void);
   void destructContext(void);
   
@@ -77,6 +84,8 @@ private:
   void * context;
   uint32_t renderid;
   const void * current_hdc;
+  // pixel buffer objects for readback with beginReadPixels()
+  unsigned int pbo[2];
 };
 
 // *************************************************************************
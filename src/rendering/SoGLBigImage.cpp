@@ -56,6 +56,25 @@
   is doubled, and creating the texture object is much slower, so we
   avoid this for SoGLBigImage.
 
+  Images too large to keep in memory can be streamed from a tile file
+  instead, see setTileFile(). Such a file stores a mipmap pyramid of
+  the image as fixed size tiles, and only the tiles needed for the
+  visible subtextures, at the resolution they are drawn with, are
+  read. The file is memory mapped where possible, tiles are read by
+  worker threads, and the tiles read are kept in a cache shared by
+  all SoGLBigImage instances. While tiles are being read, the
+  subtextures are drawn with the resolution they already have, or a
+  coarse version of the image, and exceededChangeLimit() returns TRUE
+  so that a new frame is scheduled.
+
+  The following environment variables control the tile streaming:
+
+  COIN_BIGIMAGE_TILE_CACHE_SIZE sets the size of the tile cache in
+  megabytes. The default is 256.
+
+  COIN_BIGIMAGE_NUM_THREADS sets the number of threads used to read
+  tiles. The default is the number of processors.
+
   \COIN_CLASS_EXTENSION
 
   \since Coin 2.0
@@ -70,6 +89,7 @@
 #include <cstdio>
 #include <cstring>
 #include <cassert>
+#include <climits> // INT_MAX
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -88,6 +108,7 @@
 
 #include "tidbitsp.h"
 #include "rendering/SoGL.h"
+#include "rendering/SoGLBigImageTiles.h"
 
 // *************************************************************************
 
@@ -114,6 +135,8 @@ typedef struct {
   int * glimagediv;
   uint32_t * glimageage;
   int changecnt;
+  int pending; // subtextures waiting for tiles or upload budget
+  int uploadbytes; // bytes of tiles set this frame
   unsigned int * averagebuf;
 } SoGLBigImageTls;
 
@@ -132,6 +155,11 @@ public:
   SbVec2s * cachesize;
   int numcachelevels;
 
+  // when streaming from a tile file, the image is a 1x1 pixel version
+  // of the tile file image
+  SoGLBigImageTileFile * tilefile;
+  SbImage tileimage;
+
   // inline for speed
   inline SoGLBigImageTls * getTls(void) {
     return (SoGLBigImageTls*) cc_storage_get(this->storage);
@@ -168,6 +196,8 @@ public:
   static void reset(SoGLBigImageTls * tls, SoState * state = NULL);
   static void unrefOldDL(SoGLBigImageTls * tls, SoState * state, const uint32_t maxage);
   void createCache(const unsigned char * bytes, const SbVec2s & size, const int nc);
+  int readTileRegion(SoGLBigImageTls * tls, const int idx, int level,
+                     const SbBool havetexture, SbVec2s & regionsize);
 };
 
 SoType SoGLBigImageP::classTypeId STATIC_SOTYPE_INIT;
@@ -188,6 +218,9 @@ soglbigimagetls_construct(void * closure)
   storage->currentdim.setValue(0, 0);
   storage->tmpbuf = NULL;
   storage->tmpbufsize = 0;
+  storage->changecnt = 0;
+  storage->pending = 0;
+  storage->uploadbytes = 0;
   storage->glimagearray = NULL;
   storage->imagearray = NULL;
   storage->glimagediv = NULL;
@@ -300,6 +333,91 @@ SoGLBigImage::setData(const SbImage * image,
   inherited::setData(image, wraps, wrapt, wrapr, quality, border, NULL);
 }
 
+/*!
+  Makes the image stream its data from the tile file \a filename,
+  written by writeTileFile(), instead of using an image in
+  memory. Returns \c FALSE if the file could not be opened.
+
+  \sa isTileFile()
+  \since Coin 4.0
+*/
+SbBool
+SoGLBigImage::setTileFile(const char * filename,
+                          const Wrap wraps,
+                          const Wrap wrapt,
+                          const float quality)
+{
+  SoGLBigImageTileFile * file = SoGLBigImageTileFile::open(SbString(filename));
+  if (file == NULL) return FALSE;
+
+  delete PRIVATE(this);
+  PRIVATE(this) = new SoGLBigImageP;
+  PRIVATE(this)->tilefile = file;
+
+  // the top level of the pyramid is the 1x1 pixel average of the
+  // image, which is used for the transparency test in SoGLImage
+  const int nc = file->getNumComponents();
+  unsigned char * pixel = new unsigned char[file->getTileBytes()];
+  (void) file->readTile(file->getNumLevels() - 1, 0, 0, pixel);
+  PRIVATE(this)->tileimage.setValue(SbVec2s(1, 1), nc, pixel);
+  delete[] pixel;
+
+  // call the three-wrap version directly, as the other one would end
+  // up in our setData(), which resets the private data
+  inherited::setData(&PRIVATE(this)->tileimage, wraps, wrapt, this->getWrapR(),
+                     quality, 0, NULL);
+  return TRUE;
+}
+
+/*!
+  Returns \c TRUE if \a filename is a tile file written by
+  writeTileFile().
+
+  \since Coin 4.0
+*/
+SbBool
+SoGLBigImage::isTileFile(const char * filename)
+{
+  return SoGLBigImageTileFile::isTileFile(filename);
+}
+
+/*!
+  Writes \a image to a tile file for setTileFile(), as a mipmap
+  pyramid of \a tilesize x \a tilesize tiles. \a tilesize must be a
+  power of two. Returns \c FALSE if the file could not be written.
+
+  Only a few tiles are held in memory while writing, but the image
+  itself must fit in memory. Larger images can be written by tools
+  using the format described in src/rendering/SoGLBigImageTiles.h.
+
+  \since Coin 4.0
+*/
+SbBool
+SoGLBigImage::writeTileFile(const char * filename, const SbImage & image,
+                            const int tilesize)
+{
+  SbVec2s size;
+  int nc;
+  const unsigned char * bytes = image.getValue(size, nc);
+  if (bytes == NULL) return FALSE;
+  return SoGLBigImageTileFile::write(filename, bytes, size[0], size[1], nc,
+                                     tilesize);
+}
+
+/*!
+  Sets the size in megabytes of the cache of tiles read from tile
+  files, shared by all SoGLBigImage instances. Returns the old size.
+
+  \since Coin 4.0
+*/
+int
+SoGLBigImage::setTileCacheSize(const int megabytes)
+{
+  const int old = int(SoGLBigImageTileCache::getMaxSize() / (1024 * 1024));
+  SoGLBigImageTileCache::setMaxSize(size_t(SbMax(megabytes, 1)) * 1024 * 1024);
+  return old;
+}
+
 
 SoGLDisplayList *
 SoGLBigImage::getGLDisplayList(SoState * COIN_UNUSED_ARG(state))
@@ -313,6 +431,8 @@ SoGLBigImage::initSubImages(const SbVec2s & subimagesize) const
   SoGLBigImageTls * tls = PRIVATE(this)->getTls();
 
   tls->changecnt = 0;
+  tls->pending = 0;
+  tls->uploadbytes = 0;
   if (subimagesize == tls->imagesize &&
       tls->dim[0] > 0) return tls->dim[0] * tls->dim[1];
 
@@ -359,11 +479,18 @@ SoGLBigImage::initSubImages(const SbVec2s & subimagesize) const
     if (ratio < 0.3) tls->glimagesize[1] >>= 1;
   }
 
-  SbVec2s size(0,0);
-  int nc = 0;
-
-  if (this->getImage() != NULL)
-    (void)(this->getImage()->getValue(size, nc));
+  int size[2] = { 0, 0 };
+  if (PRIVATE(this)->tilefile) {
+    size[0] = PRIVATE(this)->tilefile->getWidth();
+    size[1] = PRIVATE(this)->tilefile->getHeight();
+  }
+  else if (this->getImage() != NULL) {
+    SbVec2s imagesize;
+    int nc;
+    (void)(this->getImage()->getValue(imagesize, nc));
+    size[0] = imagesize[0];
+    size[1] = imagesize[1];
+  }
 
   tls->dim[0] = size[0] / subimagesize[0];
   tls->dim[1] = size[1] / subimagesize[1];
@@ -427,16 +554,19 @@ SoGLBigImage::applySubImage(SoState * state, const int idx,
       tls->glimageage[i] = 0;
     }
 
-    int numbytes = tls->imagesize[0] * tls->imagesize[1] * numcomponents;
-    tls->averagebuf =
-      new unsigned int[numbytes ? numbytes : 1];
+    // tile files have their own mipmap levels
+    if (PRIVATE(this)->tilefile == NULL) {
+      int numbytes = tls->imagesize[0] * tls->imagesize[1] * numcomponents;
+      tls->averagebuf =
+        new unsigned int[numbytes ? numbytes : 1];
 
-    // lock before testing/creating cache to avoid race conditions
-    PRIVATE(this)->lock();
-    if (PRIVATE(this)->cache == NULL) {
-      PRIVATE(this)->createCache(bytes, size, numcomponents);
+      // lock before testing/creating cache to avoid race conditions
+      PRIVATE(this)->lock();
+      if (PRIVATE(this)->cache == NULL) {
+        PRIVATE(this)->createCache(bytes, size, numcomponents);
+      }
+      PRIVATE(this)->unlock();
     }
-    PRIVATE(this)->unlock();
   }
 
   int level = 0;
@@ -448,8 +578,22 @@ SoGLBigImage::applySubImage(SoState * state, const int idx,
   }
   div >>= 1;
 
-  if (tls->glimagearray[idx] == NULL ||
-      (tls->glimagediv[idx] != div && tls->changecnt < CHANGELIMIT)) {
+  // tile files are limited by the upload budget instead of the
+  // change limit, in readTileRegion()
+  SbBool update = tls->glimagearray[idx] == NULL ||
+    (tls->glimagediv[idx] != div &&
+     (PRIVATE(this)->tilefile || tls->changecnt < CHANGELIMIT));
+
+  SbVec2s regionsize(0, 0);
+  if (update && PRIVATE(this)->tilefile) {
+    const int readlevel =
+      PRIVATE(this)->readTileRegion(tls, idx, level,
+                                    tls->glimagearray[idx] != NULL, regionsize);
+    if (readlevel < 0) update = FALSE; // keep the current subtexture
+    else div = 1 << readlevel;
+  }
+
+  if (update) {
 
     if (tls->glimagearray[idx] == NULL) {
       tls->glimagearray[idx] = new SoGLImage();
@@ -457,7 +601,7 @@ SoGLBigImage::applySubImage(SoState * state, const int idx,
         tls->imagearray[idx] = new SbImage;
       }
     }
-    else {
+    else if (PRIVATE(this)->tilefile == NULL) {
       tls->changecnt++;
     }
     tls->glimagediv[idx] = div;
@@ -473,9 +617,16 @@ SoGLBigImage::applySubImage(SoState * state, const int idx,
     }
     tls->glimagearray[idx]->setFlags(flags);
 
-    SbVec2s actualsize(tls->glimagesize[0]/div,
-                       tls->glimagesize[1]/div);
-    if (bytes) {
+    SbVec2s actualsize(SbMax(tls->glimagesize[0]/div, 1),
+                       SbMax(tls->glimagesize[1]/div, 1));
+    if (PRIVATE(this)->tilefile) {
+      tls->imagearray[idx]->setValue(regionsize, numcomponents, tls->tmpbuf);
+      if (regionsize != actualsize) {
+        tls->imagearray[idx]->resize(actualsize, SbImage::BOX);
+      }
+      tls->uploadbytes += actualsize[0] * actualsize[1] * numcomponents;
+    }
+    else if (bytes) {
       int numbytes = actualsize[0]*actualsize[1]*numcomponents;
       if (numbytes > tls->tmpbufsize) {
         delete[] tls->tmpbuf;
@@ -526,12 +677,16 @@ SoGLBigImage::applySubImage(SoState * state, const int idx,
   number of subtextures that can be changed each frame. If this limit
   is exceeded, this function will return TRUE, otherwise FALSE.
 
+  When streaming from a tile file, TRUE is also returned while
+  subtextures wait for tiles to be read.
+
   \sa setChangeLimit()
 */
 SbBool
 SoGLBigImage::exceededChangeLimit(void)
 {
-  return PRIVATE(this)->getTls()->changecnt >= CHANGELIMIT;
+  SoGLBigImageTls * tls = PRIVATE(this)->getTls();
+  return tls->changecnt >= CHANGELIMIT || tls->pending > 0;
 }
 
 /*!
@@ -583,7 +738,8 @@ SoGLBigImage::unrefOldDL(SoState * state, const uint32_t maxage)
 SoGLBigImageP::SoGLBigImageP(void) :
   cache(NULL),
   cachesize(NULL),
-  numcachelevels(0)
+  numcachelevels(0),
+  tilefile(NULL)
 {
   this->storage = cc_storage_construct_etc(sizeof(SoGLBigImageTls),
                                            soglbigimagetls_construct,
@@ -594,6 +750,60 @@ SoGLBigImageP::~SoGLBigImageP()
 {
   this->resetCache();
   cc_storage_destruct(this->storage);
+  if (this->tilefile) this->tilefile->unref();
+}
+
+// Reads the region of the tile file used by subtexture idx into
+// tls->tmpbuf, from the pyramid level closest to level. Returns the
+// level read, or -1 if the subtexture should be kept as it is, since
+// the tiles are not read yet or the upload budget for the frame is
+// spent. Without a subtexture, a coarse level is read instead of
+// waiting.
+int
+SoGLBigImageP::readTileRegion(SoGLBigImageTls * tls, const int idx, int level,
+                              const SbBool havetexture, SbVec2s & regionsize)
+{
+  SoGLBigImageTileFile * file = this->tilefile;
+  // SoOffscreenRenderer disables the change limit to get the full
+  // resolution in a single frame, so we wait for the tiles then
+  const SbBool wait = CHANGELIMIT == INT_MAX;
+
+  if (!wait && havetexture &&
+      tls->uploadbytes >= (int) SoGLImage::getUploadBudget()) {
+    tls->pending++;
+    return -1;
+  }
+
+  const SbVec2s pos(idx % tls->dim[0], idx / tls->dim[0]);
+  SbBool coarse = FALSE;
+  for (;;) {
+    const int tlevel = SbMin(level, file->getNumLevels() - 1);
+    const int x = (pos[0] * tls->imagesize[0]) >> tlevel;
+    const int y = (pos[1] * tls->imagesize[1]) >> tlevel;
+    const int w = SbMax(tls->imagesize[0] >> tlevel, 1);
+    const int h = SbMax(tls->imagesize[1] >> tlevel, 1);
+
+    const int numbytes = w * h * file->getNumComponents();
+    if (numbytes > tls->tmpbufsize) {
+      delete[] tls->tmpbuf;
+      tls->tmpbuf = new unsigned char[numbytes];
+      tls->tmpbufsize = numbytes;
+    }
+    if (SoGLBigImageTileCache::copyRegion(file, tlevel, x, y, w, h,
+                                          tls->tmpbuf, wait || coarse)) {
+      regionsize.setValue((short) w, (short) h);
+      return level;
+    }
+    tls->pending++;
+    if (havetexture) return -1;
+
+    // use a coarse level, which is small enough to read right away,
+    // until the tiles needed are read
+    coarse = TRUE;
+    while ((tls->imagesize[0] >> level) > 16 || (tls->imagesize[1] >> level) > 16) {
+      level++;
+    }
+  }
 }
 
 //  The method copySubImage() handles the downsampling. It averages
@@ -986,3 +1196,74 @@ SoGLBigImageP::resetAllTls(SoState * state)
 #endif // DOXYGEN_SKIP_THIS
 
 #undef LINEAR_LIMIT
+
+#ifdef COIN_TEST_SUITE
+
+#include <cstdio>
+#include <cstring>
+#include <Inventor/SbImage.h>
+#include <Inventor/misc/SoGLBigImage.h>
+
+BOOST_AUTO_TEST_CASE(tileFileRoundTrip)
+{
+  static const char filename[] = "SoGLBigImage_test.tiles";
+  const int width = 100, height = 60, nc = 3, tilesize = 16;
+  const unsigned char color[3] = { 10, 200, 77 };
+
+  unsigned char * bytes = new unsigned char[width * height * nc];
+  for (int i = 0; i < width * height; i++) memcpy(bytes + i * nc, color, nc);
+  SbImage image(bytes, SbVec2s(width, height), nc);
+  delete[] bytes;
+
+  BOOST_CHECK(!SoGLBigImage::writeTileFile(filename, image, 24));
+  BOOST_CHECK(!SoGLBigImage::writeTileFile(filename, image, 8192));
+  BOOST_REQUIRE(SoGLBigImage::writeTileFile(filename, image, tilesize));
+  BOOST_CHECK(SoGLBigImage::isTileFile(filename));
+
+  // the file holds the header and every level of the pyramid
+  long expected = 32;
+  int numlevels = 0;
+  for (int w = width, h = height; ; w = (w + 1) >> 1, h = (h + 1) >> 1) {
+    expected += long((w + tilesize - 1) / tilesize) *
+      long((h + tilesize - 1) / tilesize) * tilesize * tilesize * nc;
+    numlevels++;
+    if (w == 1 && h == 1) break;
+  }
+  FILE * fp = fopen(filename, "rb");
+  BOOST_REQUIRE(fp != NULL);
+  unsigned char header[32];
+  BOOST_REQUIRE_EQUAL(fread(header, 1, 32, fp), (size_t) 32);
+  BOOST_CHECK(memcmp(header, "COINTILE", 8) == 0);
+  BOOST_CHECK_EQUAL(int(header[12] | (header[13] << 8)), width);
+  BOOST_CHECK_EQUAL(int(header[16] | (header[17] << 8)), height);
+  BOOST_CHECK_EQUAL(int(header[20]), nc);
+  BOOST_CHECK_EQUAL(int(header[24]), tilesize);
+  BOOST_CHECK_EQUAL(int(header[28]), numlevels);
+  fseek(fp, 0, SEEK_END);
+  BOOST_CHECK_EQUAL(ftell(fp), expected);
+  fclose(fp);
+
+  // the top level, read back by setTileFile(), is the average color
+  SoGLBigImage * glimage = new SoGLBigImage;
+  BOOST_REQUIRE(glimage->setTileFile(filename));
+  SbVec2s size;
+  int numcomponents;
+  const unsigned char * pixel = glimage->getImage()->getValue(size, numcomponents);
+  BOOST_CHECK(size == SbVec2s(1, 1));
+  BOOST_REQUIRE_EQUAL(numcomponents, nc);
+  BOOST_CHECK(memcmp(pixel, color, nc) == 0);
+  glimage->unref();
+
+  // a tile size the reader doesn't accept makes it an invalid file
+  fp = fopen(filename, "r+b");
+  BOOST_REQUIRE(fp != NULL);
+  const unsigned char hugetilesize[4] = { 0, 0, 0, 1 };
+  fseek(fp, 24, SEEK_SET);
+  BOOST_CHECK_EQUAL(fwrite(hugetilesize, 1, 4, fp), (size_t) 4);
+  fclose(fp);
+  BOOST_CHECK(!SoGLBigImage::isTileFile(filename));
+
+  (void) remove(filename);
+}
+
+#endif // COIN_TEST_SUITE
@@ -0,0 +1,803 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+// The tile pyramid files and the shared tile cache used by
+// SoGLBigImage when streaming from a tile file. See
+// SoGLBigImageTiles.h for the file format.
+
+#include "rendering/SoGLBigImageTiles.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <cassert>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif // HAVE_UNISTD_H
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif // HAVE_SYS_MMAN_H
+
+#include <Inventor/C/tidbits.h>
+#include <Inventor/C/threads/common.h>
+#include <Inventor/C/threads/sched.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/errors/SoDebugError.h>
+
+#include "tidbitsp.h"
+#include "base/SbImageResize.h"
+#include "base/SbParallel.h"
+#include "misc/SbFlatHash.h"
+#include "threads/threadsutilp.h"
+
+// *************************************************************************
+
+static const char tilefile_magic[8] = { 'C', 'O', 'I', 'N', 'T', 'I', 'L', 'E' };
+#define TILEFILE_VERSION 1
+#define TILEFILE_HEADERSIZE 32
+// limits for the header fields, which keep the tile and file sizes
+// well within 64 bits
+#define TILEFILE_MAX_SIZE (1 << 24)
+#define TILEFILE_MAX_TILESIZE 4096
+
+// the registry of open files and the tile cache share one mutex,
+// which is needed even without COIN_THREADSAFE since tiles are read
+// by worker threads. It may be gone when images are deleted after the
+// atexit cleanup.
+static void * tiles_mutex = NULL;
+#define LOCK_TILES if (tiles_mutex) CC_MUTEX_LOCK(tiles_mutex)
+#define UNLOCK_TILES if (tiles_mutex) CC_MUTEX_UNLOCK(tiles_mutex)
+
+static SbList <SoGLBigImageTileFile *> * tilefile_list = NULL;
+static int tilefile_nextid = 1;
+
+class tilecache_entry {
+public:
+  tilecache_entry(void) : data(NULL), stamp(0), pins(0), used(FALSE) { }
+  ~tilecache_entry() { delete[] this->data; }
+  unsigned char * data; // NULL while the tile is being read
+  uint32_t stamp; // for LRU eviction
+  int pins; // the number of copyRegion() calls using the tile
+  size_t size;
+  SbBool used; // FALSE until copied by copyRegion()
+};
+
+typedef SbFlatHash<uint64_t, tilecache_entry *> tilecache_map;
+
+static tilecache_map * tilecache = NULL;
+static size_t tilecache_size = 0;
+static size_t tilecache_maxsize = 0;
+static uint32_t tilecache_clock = 0;
+static cc_sched * tilecache_sched = NULL;
+// set when tiles are evicted before they are used, which means that
+// the visible tiles don't fit in the cache
+static SbBool tilecache_thrashing = FALSE;
+
+static void
+tiles_cleanup(void)
+{
+  if (tilecache_sched) {
+    cc_sched_wait_all(tilecache_sched);
+    cc_sched_destruct(tilecache_sched);
+    tilecache_sched = NULL;
+  }
+  if (tilecache) {
+    for (tilecache_map::const_iterator it = tilecache->const_begin();
+         it != tilecache->const_end(); ++it) {
+      delete it->obj;
+    }
+    delete tilecache;
+    tilecache = NULL;
+  }
+  tilecache_size = 0;
+  tilecache_maxsize = 0;
+  tilecache_thrashing = FALSE;
+  // files still open are owned by their SoGLBigImage instances
+  delete tilefile_list;
+  tilefile_list = NULL;
+  if (tiles_mutex) {
+    CC_MUTEX_DESTRUCT(tiles_mutex);
+  }
+}
+
+// Called with the mutex held, or before any threads use the tiles.
+static void
+tiles_init(void)
+{
+  if (tilefile_list) return;
+  tilefile_list = new SbList <SoGLBigImageTileFile *>;
+  tilecache = new tilecache_map;
+  if (tilecache_maxsize == 0) {
+    const char * env = coin_getenv("COIN_BIGIMAGE_TILE_CACHE_SIZE");
+    const int mb = env ? atoi(env) : 0;
+    tilecache_maxsize = size_t(mb > 0 ? mb : 256) * 1024 * 1024;
+  }
+  coin_atexit((coin_atexit_f *) tiles_cleanup, CC_ATEXIT_NORMAL);
+}
+
+static void
+tiles_create_mutex(void)
+{
+  CC_MUTEX_CONSTRUCT(tiles_mutex);
+}
+
+static uint32_t
+tilefile_read_uint32(const unsigned char * ptr)
+{
+  return uint32_t(ptr[0]) | (uint32_t(ptr[1]) << 8) |
+    (uint32_t(ptr[2]) << 16) | (uint32_t(ptr[3]) << 24);
+}
+
+static void
+tilefile_write_uint32(unsigned char * ptr, const uint32_t val)
+{
+  ptr[0] = (unsigned char) (val & 0xff);
+  ptr[1] = (unsigned char) ((val >> 8) & 0xff);
+  ptr[2] = (unsigned char) ((val >> 16) & 0xff);
+  ptr[3] = (unsigned char) ((val >> 24) & 0xff);
+}
+
+static int
+tilefile_seek(FILE * fp, const uint64_t offset)
+{
+#if defined(_WIN32)
+  return _fseeki64(fp, (__int64) offset, SEEK_SET);
+#elif defined(HAVE_FSEEKO)
+  return fseeko(fp, (off_t) offset, SEEK_SET);
+#else // !HAVE_FSEEKO
+  if (offset > (uint64_t) LONG_MAX) return -1;
+  return fseek(fp, (long) offset, SEEK_SET);
+#endif // !HAVE_FSEEKO
+}
+
+// Reads and checks the header. Returns the number of levels, or 0 if
+// this is not a valid tile file.
+static int
+tilefile_read_header(FILE * fp, int & width, int & height, int & nc, int & tilesize)
+{
+  unsigned char header[TILEFILE_HEADERSIZE];
+  if (fread(header, 1, TILEFILE_HEADERSIZE, fp) != TILEFILE_HEADERSIZE) return 0;
+  if (memcmp(header, tilefile_magic, 8) != 0) return 0;
+  if (tilefile_read_uint32(header + 8) != TILEFILE_VERSION) return 0;
+  const uint32_t w = tilefile_read_uint32(header + 12);
+  const uint32_t h = tilefile_read_uint32(header + 16);
+  const uint32_t n = tilefile_read_uint32(header + 20);
+  const uint32_t t = tilefile_read_uint32(header + 24);
+  const uint32_t numlevels = tilefile_read_uint32(header + 28);
+  if (w < 1 || w > TILEFILE_MAX_SIZE || h < 1 || h > TILEFILE_MAX_SIZE ||
+      n < 1 || n > 4 || t < 2 || t > TILEFILE_MAX_TILESIZE || (t & (t - 1)) ||
+      numlevels < 1 || numlevels > 32) {
+    return 0;
+  }
+  width = (int) w;
+  height = (int) h;
+  nc = (int) n;
+  tilesize = (int) t;
+  return (int) numlevels;
+}
+
+static int
+tilefile_num_levels(int width, int height)
+{
+  int levels = 1;
+  while (width > 1 || height > 1) {
+    width = (width + 1) >> 1;
+    height = (height + 1) >> 1;
+    levels++;
+  }
+  return levels;
+}
+
+// *************************************************************************
+
+SoGLBigImageTileFile::SoGLBigImageTileFile(void)
+  : refcount(0), id(0), width(0), height(0), nc(0), tilesize(0),
+    numlevels(0), leveloffsets(NULL), data(NULL), size(0), fp(NULL),
+    fpmutex(NULL)
+{
+  CC_MUTEX_CONSTRUCT(this->fpmutex);
+}
+
+SoGLBigImageTileFile::~SoGLBigImageTileFile()
+{
+#ifdef HAVE_SYS_MMAN_H
+  if (this->data) munmap((void *) this->data, this->size);
+#endif // HAVE_SYS_MMAN_H
+  if (this->fp) fclose(this->fp);
+  delete[] this->leveloffsets;
+  CC_MUTEX_DESTRUCT(this->fpmutex);
+}
+
+/*
+  Returns the shared instance for \a filename, with an extra
+  reference, or NULL if the file couldn't be opened.
+*/
+SoGLBigImageTileFile *
+SoGLBigImageTileFile::open(const SbString & filename)
+{
+  tiles_create_mutex();
+  LOCK_TILES;
+  tiles_init();
+  SoGLBigImageTileFile * file = NULL;
+  for (int i = 0; i < tilefile_list->getLength(); i++) {
+    if ((*tilefile_list)[i]->filename == filename) {
+      file = (*tilefile_list)[i];
+      break;
+    }
+  }
+  if (file == NULL) {
+    file = new SoGLBigImageTileFile;
+    if (file->map(filename.getString())) {
+      file->filename = filename;
+      file->id = tilefile_nextid++;
+      tilefile_list->append(file);
+    }
+    else {
+      delete file;
+      file = NULL;
+    }
+  }
+  if (file) file->refcount++;
+  UNLOCK_TILES;
+  return file;
+}
+
+void
+SoGLBigImageTileFile::ref(void)
+{
+  LOCK_TILES;
+  this->refcount++;
+  UNLOCK_TILES;
+}
+
+void
+SoGLBigImageTileFile::unref(void)
+{
+  LOCK_TILES;
+  const SbBool last = --this->refcount == 0;
+  if (last && tilefile_list) {
+    tilefile_list->removeItem(this);
+  }
+  UNLOCK_TILES;
+  if (last) {
+    SoGLBigImageTileCache::purge(this->id);
+    delete this;
+  }
+}
+
+SbBool
+SoGLBigImageTileFile::isTileFile(const char * filename)
+{
+  FILE * fp = fopen(filename, "rb");
+  if (fp == NULL) return FALSE;
+  int w, h, nc, tilesize;
+  const SbBool ok = tilefile_read_header(fp, w, h, nc, tilesize) > 0;
+  fclose(fp);
+  return ok;
+}
+
+SbBool
+SoGLBigImageTileFile::map(const char * filename)
+{
+  this->fp = fopen(filename, "rb");
+  if (this->fp == NULL) return FALSE;
+  this->numlevels = tilefile_read_header(this->fp, this->width, this->height,
+                                         this->nc, this->tilesize);
+  if (this->numlevels == 0 ||
+      this->numlevels != tilefile_num_levels(this->width, this->height)) {
+    SoDebugError::postWarning("SoGLBigImageTileFile::map",
+                              "'%s' is not a valid tile file.", filename);
+    return FALSE;
+  }
+  this->leveloffsets = new uint64_t[this->numlevels + 1];
+  this->leveloffsets[0] = TILEFILE_HEADERSIZE;
+  for (int l = 0; l < this->numlevels; l++) {
+    this->leveloffsets[l+1] = this->leveloffsets[l] +
+      uint64_t(this->getNumTilesX(l)) * uint64_t(this->getNumTilesY(l)) *
+      uint64_t(this->getTileBytes());
+  }
+  const uint64_t filesize = this->leveloffsets[this->numlevels];
+
+#ifdef HAVE_SYS_MMAN_H
+  if (filesize == (uint64_t) (size_t) filesize) {
+    const int fd = ::open(filename, O_RDONLY);
+    if (fd >= 0) {
+      struct stat st;
+      if (fstat(fd, &st) == 0 && (uint64_t) st.st_size >= filesize) {
+        void * ptr = mmap(NULL, (size_t) filesize, PROT_READ, MAP_SHARED, fd, 0);
+        if (ptr != MAP_FAILED) {
+          this->data = (const unsigned char *) ptr;
+          this->size = (size_t) filesize;
+        }
+      }
+      ::close(fd);
+    }
+  }
+  if (this->data) {
+    fclose(this->fp);
+    this->fp = NULL;
+  }
+#endif // HAVE_SYS_MMAN_H
+  return TRUE;
+}
+
+int
+SoGLBigImageTileFile::getLevelWidth(const int level) const
+{
+  int w = this->width;
+  for (int l = 0; l < level; l++) w = (w + 1) >> 1;
+  return w;
+}
+
+int
+SoGLBigImageTileFile::getLevelHeight(const int level) const
+{
+  int h = this->height;
+  for (int l = 0; l < level; l++) h = (h + 1) >> 1;
+  return h;
+}
+
+int
+SoGLBigImageTileFile::getNumTilesX(const int level) const
+{
+  return (this->getLevelWidth(level) + this->tilesize - 1) / this->tilesize;
+}
+
+int
+SoGLBigImageTileFile::getNumTilesY(const int level) const
+{
+  return (this->getLevelHeight(level) + this->tilesize - 1) / this->tilesize;
+}
+
+SbBool
+SoGLBigImageTileFile::readTile(const int level, const int tx, const int ty,
+                               unsigned char * dst)
+{
+  const size_t numbytes = this->getTileBytes();
+  const uint64_t offset = this->leveloffsets[level] +
+    (uint64_t(ty) * uint64_t(this->getNumTilesX(level)) + uint64_t(tx)) *
+    uint64_t(numbytes);
+
+  SbBool ok = FALSE;
+  if (this->data) {
+    // the pages are read from disk by this copy
+    memcpy(dst, this->data + offset, numbytes);
+    ok = TRUE;
+  }
+  else {
+    CC_MUTEX_LOCK(this->fpmutex);
+    ok = (tilefile_seek(this->fp, offset) == 0) &&
+      (fread(dst, 1, numbytes, this->fp) == numbytes);
+    CC_MUTEX_UNLOCK(this->fpmutex);
+  }
+  if (!ok) memset(dst, 0, numbytes);
+  return ok;
+}
+
+// Copies a tile from an image, repeating the edge pixels outside it.
+static void
+tilefile_copy_tile(const unsigned char * bytes, const int width, const int height,
+                   const int nc, const int x0, const int y0, const int tilesize,
+                   unsigned char * dst)
+{
+  for (int y = 0; y < tilesize; y++) {
+    const unsigned char * row = bytes + size_t(SbMin(y0 + y, height - 1)) * width * nc;
+    for (int x = 0; x < tilesize; x++) {
+      memcpy(dst, row + SbMin(x0 + x, width - 1) * nc, nc);
+      dst += nc;
+    }
+  }
+}
+
+// Repeats the edge pixels in the part of a tile that is outside the
+// image, after w x h valid pixels.
+static void
+tilefile_pad_tile(unsigned char * tile, const int tilesize, const int nc,
+                  const int w, const int h)
+{
+  for (int y = 0; y < h; y++) {
+    unsigned char * row = tile + y * tilesize * nc;
+    for (int x = w; x < tilesize; x++) memcpy(row + x * nc, row + (w - 1) * nc, nc);
+  }
+  for (int y = h; y < tilesize; y++) {
+    memcpy(tile + y * tilesize * nc, tile + (h - 1) * tilesize * nc, tilesize * nc);
+  }
+}
+
+/*
+  Writes a tile file for an image. Only four tiles are kept in memory
+  at a time, since each level is made from the level before it as it
+  is read back from the file.
+*/
+SbBool
+SoGLBigImageTileFile::write(const char * filename,
+                            const unsigned char * bytes,
+                            const int width, const int height, const int nc,
+                            const int tilesize)
+{
+  if (width < 1 || height < 1 || nc < 1 || nc > 4 ||
+      tilesize < 2 || tilesize > TILEFILE_MAX_TILESIZE ||
+      (tilesize & (tilesize - 1))) return FALSE;
+
+  FILE * fp = fopen(filename, "w+b");
+  if (fp == NULL) return FALSE;
+
+  const int numlevels = tilefile_num_levels(width, height);
+  unsigned char header[TILEFILE_HEADERSIZE];
+  memcpy(header, tilefile_magic, 8);
+  tilefile_write_uint32(header + 8, TILEFILE_VERSION);
+  tilefile_write_uint32(header + 12, (uint32_t) width);
+  tilefile_write_uint32(header + 16, (uint32_t) height);
+  tilefile_write_uint32(header + 20, (uint32_t) nc);
+  tilefile_write_uint32(header + 24, (uint32_t) tilesize);
+  tilefile_write_uint32(header + 28, (uint32_t) numlevels);
+  SbBool ok = fwrite(header, 1, TILEFILE_HEADERSIZE, fp) == TILEFILE_HEADERSIZE;
+
+  const int tilebytes = tilesize * tilesize * nc;
+  unsigned char * tile = new unsigned char[tilebytes];
+  unsigned char * block = new unsigned char[tilebytes * 4];
+
+  // level 0 is copied from the image
+  int tilesx = (width + tilesize - 1) / tilesize;
+  int tilesy = (height + tilesize - 1) / tilesize;
+  for (int ty = 0; ok && ty < tilesy; ty++) {
+    for (int tx = 0; ok && tx < tilesx; tx++) {
+      tilefile_copy_tile(bytes, width, height, nc, tx * tilesize, ty * tilesize,
+                         tilesize, tile);
+      ok = fwrite(tile, 1, tilebytes, fp) == (size_t) tilebytes;
+    }
+  }
+
+  // the other levels are made by halving 2x2 tiles from the level below
+  uint64_t prevoffset = TILEFILE_HEADERSIZE;
+  uint64_t offset = prevoffset + uint64_t(tilesx) * uint64_t(tilesy) * uint64_t(tilebytes);
+  int prevw = width, prevh = height;
+  int prevtilesx = tilesx, prevtilesy = tilesy;
+  for (int l = 1; ok && l < numlevels; l++) {
+    const int w = (prevw + 1) >> 1;
+    const int h = (prevh + 1) >> 1;
+    tilesx = (w + tilesize - 1) / tilesize;
+    tilesy = (h + tilesize - 1) / tilesize;
+    for (int ty = 0; ok && ty < tilesy; ty++) {
+      for (int tx = 0; ok && tx < tilesx; tx++) {
+        memset(block, 0, tilebytes * 4);
+        for (int j = 0; ok && j < 2; j++) {
+          for (int i = 0; ok && i < 2; i++) {
+            const int sx = tx * 2 + i;
+            const int sy = ty * 2 + j;
+            if (sx >= prevtilesx || sy >= prevtilesy) continue;
+            const uint64_t srcoffset = prevoffset +
+              (uint64_t(sy) * uint64_t(prevtilesx) + uint64_t(sx)) * uint64_t(tilebytes);
+            ok = (tilefile_seek(fp, srcoffset) == 0) &&
+              (fread(tile, 1, tilebytes, fp) == (size_t) tilebytes);
+            for (int y = 0; ok && y < tilesize; y++) {
+              memcpy(block + ((j * tilesize + y) * tilesize * 2 + i * tilesize) * nc,
+                     tile + y * tilesize * nc, tilesize * nc);
+            }
+          }
+        }
+        SbImageResize::halve(block, tilesize * 2, tilesize * 2, 0, nc, tile);
+        tilefile_pad_tile(tile, tilesize, nc,
+                          SbMin(tilesize, w - tx * tilesize),
+                          SbMin(tilesize, h - ty * tilesize));
+        const uint64_t dstoffset = offset +
+          (uint64_t(ty) * uint64_t(tilesx) + uint64_t(tx)) * uint64_t(tilebytes);
+        ok = ok && (tilefile_seek(fp, dstoffset) == 0) &&
+          (fwrite(tile, 1, tilebytes, fp) == (size_t) tilebytes);
+      }
+    }
+    prevoffset = offset;
+    offset += uint64_t(tilesx) * uint64_t(tilesy) * uint64_t(tilebytes);
+    prevw = w;
+    prevh = h;
+    prevtilesx = tilesx;
+    prevtilesy = tilesy;
+  }
+  delete[] tile;
+  delete[] block;
+  if (fclose(fp) != 0) ok = FALSE;
+  return ok;
+}
+
+// *************************************************************************
+
+static uint64_t
+tilecache_key(const int fileid, const int level, const int tx, const int ty)
+{
+  return (uint64_t(fileid) << 48) | (uint64_t(level) << 42) |
+    (uint64_t(ty) << 21) | uint64_t(tx);
+}
+
+// Frees the least recently used tiles until the cache is within its
+// size. Called with the mutex held.
+static void
+tilecache_evict(void)
+{
+  while (tilecache_size > tilecache_maxsize) {
+    uint64_t oldestkey = 0;
+    tilecache_entry * oldest = NULL;
+    for (tilecache_map::const_iterator it = tilecache->const_begin();
+         it != tilecache->const_end(); ++it) {
+      tilecache_entry * entry = it->obj;
+      if (entry->data && entry->pins == 0 &&
+          (oldest == NULL || int32_t(entry->stamp - oldest->stamp) < 0)) {
+        oldest = entry;
+        oldestkey = it->key;
+      }
+    }
+    if (oldest == NULL) break; // everything is in use
+    if (!oldest->used && !tilecache_thrashing) {
+      tilecache_thrashing = TRUE;
+      SoDebugError::postWarning("SoGLBigImageTileCache",
+                                "The tile cache is too small for the visible "
+                                "tiles, so they will be read without worker "
+                                "threads. Use COIN_BIGIMAGE_TILE_CACHE_SIZE "
+                                "or SoGLBigImage::setTileCacheSize() to make "
+                                "it larger.");
+    }
+    tilecache_size -= oldest->size;
+    tilecache->erase(oldestkey);
+    delete oldest;
+  }
+}
+
+// Stores a tile that has been read. Called with the mutex held.
+// Returns the entry, or NULL if the file has been closed.
+static tilecache_entry *
+tilecache_insert(const uint64_t key, unsigned char * data, const size_t size,
+                 const SbBool create)
+{
+  tilecache_entry * entry = NULL;
+  if (!tilecache->get(key, entry)) {
+    if (!create) {
+      delete[] data;
+      return NULL;
+    }
+    entry = new tilecache_entry;
+    tilecache->put(key, entry);
+  }
+  if (entry->data) {
+    delete[] data; // read by someone else in the meantime
+  }
+  else {
+    entry->data = data;
+    entry->size = size;
+    entry->stamp = ++tilecache_clock;
+    tilecache_size += size;
+  }
+  return entry;
+}
+
+class tilecache_job {
+public:
+  SoGLBigImageTileFile * file;
+  int level, tx, ty;
+};
+
+static void
+tilecache_worker(void * closure)
+{
+  tilecache_job * job = (tilecache_job *) closure;
+  SoGLBigImageTileFile * file = job->file;
+  unsigned char * data = new unsigned char[file->getTileBytes()];
+  (void) file->readTile(job->level, job->tx, job->ty, data);
+
+  LOCK_TILES;
+  (void) tilecache_insert(tilecache_key(file->getId(), job->level, job->tx, job->ty),
+                          data, file->getTileBytes(), FALSE);
+  tilecache_evict();
+  UNLOCK_TILES;
+
+  file->unref();
+  delete job;
+}
+
+SbBool
+SoGLBigImageTileCache::copyRegion(SoGLBigImageTileFile * file, const int level,
+                                  const int x, const int y, const int w, const int h,
+                                  unsigned char * dst, const SbBool wait)
+{
+  const int tilesize = file->getTileSize();
+  const int nc = file->getNumComponents();
+  const int lw = file->getLevelWidth(level);
+  const int lh = file->getLevelHeight(level);
+  const int tx0 = SbClamp(x, 0, lw - 1) / tilesize;
+  const int tx1 = SbClamp(x + w - 1, 0, lw - 1) / tilesize;
+  const int ty0 = SbClamp(y, 0, lh - 1) / tilesize;
+  const int ty1 = SbClamp(y + h - 1, 0, lh - 1) / tilesize;
+  const int ntx = tx1 - tx0 + 1;
+  const int nty = ty1 - ty0 + 1;
+
+  SbList <tilecache_entry *> entries(ntx * nty);
+  SbList <int> missing;
+
+  LOCK_TILES;
+  if (tilecache_sched == NULL && !wait) {
+#ifdef HAVE_THREADS
+    if (cc_thread_implementation() != CC_NO_THREADS) {
+      tilecache_sched =
+        cc_sched_construct(SbParallel::getNumThreads("COIN_BIGIMAGE_NUM_THREADS"));
+    }
+#endif // HAVE_THREADS
+  }
+  for (int ty = ty0; ty <= ty1; ty++) {
+    for (int tx = tx0; tx <= tx1; tx++) {
+      tilecache_entry * entry = NULL;
+      if (!tilecache->get(tilecache_key(file->getId(), level, tx, ty), entry)) {
+        entry = NULL;
+      }
+      if (entry && entry->data) {
+        entry->pins++;
+        entry->used = TRUE;
+        entry->stamp = ++tilecache_clock;
+      }
+      else {
+        entry = NULL;
+        missing.append((ty - ty0) * ntx + (tx - tx0));
+      }
+      entries.append(entry);
+    }
+  }
+  // if the cache can't hold the visible tiles, they would be evicted
+  // before they are used, so then we read them here instead
+  const SbBool readhere = wait || tilecache_sched == NULL || tilecache_thrashing;
+  if (!readhere) {
+    for (int i = 0; i < missing.getLength(); i++) {
+      const int tx = tx0 + missing[i] % ntx;
+      const int ty = ty0 + missing[i] / ntx;
+      const uint64_t key = tilecache_key(file->getId(), level, tx, ty);
+      tilecache_entry * entry = NULL;
+      if (tilecache->get(key, entry)) continue; // already being read
+      entry = new tilecache_entry;
+      tilecache->put(key, entry);
+      tilecache_job * job = new tilecache_job;
+      job->file = file;
+      job->level = level;
+      job->tx = tx;
+      job->ty = ty;
+      file->refcount++;
+      cc_sched_schedule(tilecache_sched, tilecache_worker, job, 0);
+    }
+  }
+  UNLOCK_TILES;
+
+  if (readhere) {
+    // read the tiles in this thread
+    for (int i = 0; i < missing.getLength(); i++) {
+      const int tx = tx0 + missing[i] % ntx;
+      const int ty = ty0 + missing[i] / ntx;
+      unsigned char * data = new unsigned char[file->getTileBytes()];
+      (void) file->readTile(level, tx, ty, data);
+      LOCK_TILES;
+      tilecache_entry * entry =
+        tilecache_insert(tilecache_key(file->getId(), level, tx, ty),
+                         data, file->getTileBytes(), TRUE);
+      entry->pins++;
+      entry->used = TRUE;
+      entries[missing[i]] = entry;
+      UNLOCK_TILES;
+    }
+    missing.truncate(0);
+  }
+
+  if (missing.getLength() == 0) {
+    for (int row = 0; row < h; row++) {
+      const int ly = SbClamp(y + row, 0, lh - 1);
+      const int ty = ly / tilesize - ty0;
+      const int iy = ly % tilesize;
+      unsigned char * dstrow = dst + size_t(row) * w * nc;
+      int col = 0;
+      while (col < w) {
+        const int lx = SbClamp(x + col, 0, lw - 1);
+        const int tx = lx / tilesize - tx0;
+        const int ix = lx % tilesize;
+        const unsigned char * src =
+          entries[ty * ntx + tx]->data + (iy * tilesize + ix) * nc;
+        int run = 1;
+        if (x + col == lx) { // not clamped
+          run = SbMin(SbMin(w - col, tilesize - ix), lw - lx);
+        }
+        memcpy(dstrow + col * nc, src, run * nc);
+        col += run;
+      }
+    }
+  }
+
+  LOCK_TILES;
+  for (int i = 0; i < entries.getLength(); i++) {
+    if (entries[i] && entries[i]->data) entries[i]->pins--;
+  }
+  tilecache_evict();
+  UNLOCK_TILES;
+  return missing.getLength() == 0;
+}
+
+void
+SoGLBigImageTileCache::purge(const int fileid)
+{
+  LOCK_TILES;
+  if (tilecache == NULL) {
+    UNLOCK_TILES;
+    return;
+  }
+  SbList <uint64_t> keys;
+  for (tilecache_map::const_iterator it = tilecache->const_begin();
+       it != tilecache->const_end(); ++it) {
+    if (int(it->key >> 48) == fileid) keys.append(it->key);
+  }
+  for (int i = 0; i < keys.getLength(); i++) {
+    tilecache_entry * entry = NULL;
+    (void) tilecache->get(keys[i], entry);
+    if (entry->data) tilecache_size -= entry->size;
+    tilecache->erase(keys[i]);
+    delete entry;
+  }
+  UNLOCK_TILES;
+}
+
+void
+SoGLBigImageTileCache::setMaxSize(const size_t bytes)
+{
+  tiles_create_mutex();
+  LOCK_TILES;
+  tiles_init();
+  tilecache_maxsize = bytes;
+  tilecache_thrashing = FALSE;
+  tilecache_evict();
+  UNLOCK_TILES;
+}
+
+size_t
+SoGLBigImageTileCache::getMaxSize(void)
+{
+  tiles_create_mutex();
+  LOCK_TILES;
+  tiles_init();
+  const size_t size = tilecache_maxsize;
+  UNLOCK_TILES;
+  return size;
+}
+
+#undef LOCK_TILES
+#undef UNLOCK_TILES
+#undef TILEFILE_VERSION
+#undef TILEFILE_HEADERSIZE
+#undef TILEFILE_MAX_SIZE
+#undef TILEFILE_MAX_TILESIZE
@@ -0,0 +1,138 @@
+#ifndef COIN_SOGLBIGIMAGETILES_H
+#define COIN_SOGLBIGIMAGETILES_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+// *************************************************************************
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <cstdio>
+
+#include <Inventor/SbBasic.h>
+#include <Inventor/SbString.h>
+
+// A tiled mipmap pyramid, stored in a file written by
+// SoGLBigImageTileFile::write(). Each level is half the size of the
+// one before it (rounded up), down to 1x1 pixels, and is split into
+// tilesize x tilesize tiles. Tiles on the right and top edges are
+// padded by repeating the edge pixels.
+//
+// The file is a 32 byte header followed by the tiles, level by level
+// and row by row within each level, with no compression so that a
+// tile can be read directly from a memory mapping of the file:
+//
+//   "COINTILE", then version (1), width, height, number of
+//   components, tile size and number of levels, as little endian
+//   32-bit unsigned integers.
+//
+// Files are shared, so open() returns the same instance for the same
+// file name.
+class SoGLBigImageTileFile {
+public:
+  static SoGLBigImageTileFile * open(const SbString & filename);
+  void ref(void);
+  void unref(void);
+
+  static SbBool isTileFile(const char * filename);
+  static SbBool write(const char * filename,
+                      const unsigned char * bytes,
+                      const int width, const int height, const int nc,
+                      const int tilesize);
+
+  int getId(void) const { return this->id; }
+  int getWidth(void) const { return this->width; }
+  int getHeight(void) const { return this->height; }
+  int getNumComponents(void) const { return this->nc; }
+  int getTileSize(void) const { return this->tilesize; }
+  int getNumLevels(void) const { return this->numlevels; }
+  int getLevelWidth(const int level) const;
+  int getLevelHeight(const int level) const;
+  int getNumTilesX(const int level) const;
+  int getNumTilesY(const int level) const;
+  size_t getTileBytes(void) const {
+    return size_t(this->tilesize) * size_t(this->tilesize) * size_t(this->nc);
+  }
+
+  // Copies a tile into dst. Returns FALSE if it couldn't be read.
+  SbBool readTile(const int level, const int tx, const int ty,
+                  unsigned char * dst);
+
+private:
+  friend class SoGLBigImageTileCache;
+  SoGLBigImageTileFile(void);
+  ~SoGLBigImageTileFile();
+  SbBool map(const char * filename);
+
+  SbString filename;
+  int refcount;
+  int id;
+  int width, height, nc, tilesize, numlevels;
+  uint64_t * leveloffsets;
+
+  const unsigned char * data; // when the file is memory mapped
+  size_t size;
+  FILE * fp; // when it isn't
+  void * fpmutex; // a cc_mutex serializing reads from fp
+};
+
+// An LRU cache of tiles from tile files, shared by all SoGLBigImage
+// instances. Tiles that aren't in the cache are read by worker
+// threads.
+class SoGLBigImageTileCache {
+public:
+  // Copies a w x h region of a level into dst. Coordinates outside
+  // the level are clamped to the edges. If some of the tiles are not
+  // in the cache, they are queued for loading and FALSE is returned,
+  // unless wait is TRUE, in which case they are read before
+  // returning.
+  static SbBool copyRegion(SoGLBigImageTileFile * file, const int level,
+                           const int x, const int y, const int w, const int h,
+                           unsigned char * dst, const SbBool wait);
+
+  // Removes the tiles of a file that is closed.
+  static void purge(const int fileid);
+
+  static void setMaxSize(const size_t bytes);
+  static size_t getMaxSize(void);
+};
+
+// *************************************************************************
+
+#endif // !COIN_SOGLBIGIMAGETILES_H
@@ -0,0 +1,579 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+// The pages are kept in memory as 8-bit alpha images, with mono
+// glyphs expanded to 0 or 255, and are packed with shelves like
+// SoGLTextureAtlas. There is a one pixel empty border around each
+// glyph, so that glyphs don't bleed into each other if the texture
+// is sampled off texel centers. Each page remembers the rectangles
+// added to it, and each context uploads the ones it hasn't seen yet
+// when the page is bound. A page that is cleared gets a new
+// generation, which makes each context upload all of it again.
+
+#include "rendering/SoGLGlyphAtlas.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include <Inventor/elements/SoGLCacheContextElement.h>
+#include <Inventor/elements/SoGLDisplayList.h>
+#include <Inventor/elements/SoCacheElement.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/misc/SoContextHandler.h>
+#include <Inventor/misc/SoState.h>
+#include <Inventor/system/gl.h>
+
+#ifdef COIN_THREADSAFE
+#include <Inventor/threads/SbMutex.h>
+#endif // COIN_THREADSAFE
+
+#include "coindefs.h"
+#include "misc/SbFlatHash.h"
+#include "tidbitsp.h"
+
+// *************************************************************************
+
+#define GLYPHATLAS_PAGE_SIZE 1024
+// glyphs larger than this are rendered without the atlas
+#define GLYPHATLAS_MAX_GLYPH_SIZE 256
+#define GLYPHATLAS_SHELF_SLACK 4
+#define GLYPHATLAS_DEFAULT_MAX_PAGES 8
+
+inline unsigned int SbHashFunc(const cc_glyph2d * key)
+{
+  return SbHashFunc(reinterpret_cast<size_t>(key));
+}
+
+#ifdef COIN_THREADSAFE
+static SbMutex * glyphatlas_mutex = NULL;
+#define LOCK_GLYPHATLAS if (glyphatlas_mutex) glyphatlas_mutex->lock()
+#define UNLOCK_GLYPHATLAS if (glyphatlas_mutex) glyphatlas_mutex->unlock()
+#else // COIN_THREADSAFE
+#define LOCK_GLYPHATLAS
+#define UNLOCK_GLYPHATLAS
+#endif // !COIN_THREADSAFE
+
+class glyphatlas_rect {
+public:
+  int x, y, w, h;
+};
+
+class glyphatlas_shelf {
+public:
+  int y, height;
+  int x; // where the next glyph goes
+};
+
+class glyphatlas_page {
+public:
+  unsigned char * pixels;
+  SbList <glyphatlas_shelf> shelves;
+  int shelftop; // where the next shelf goes
+  // the glyphs in the order they were added, for uploading
+  SbList <glyphatlas_rect> rects;
+  int refcount; // the number of glyph caches using the page
+  uint32_t stamp; // for LRU reuse
+  int generation; // incremented when the page is cleared
+};
+
+class glyphatlas_glyph {
+public:
+  int page, x, y;
+};
+
+// the texture of a page in a context
+class glyphatlas_texture {
+public:
+  SoGLDisplayList * dl;
+  int numuploaded; // the number of rects of the page in the texture
+  int generation; // of the page when it was uploaded
+};
+
+class glyphatlas_context {
+public:
+  SbList <glyphatlas_texture> textures;
+};
+
+typedef SbFlatHash<const cc_glyph2d *, glyphatlas_glyph> glyphatlas_glyph_map;
+typedef SbFlatHash<uint32_t, glyphatlas_context *> glyphatlas_context_map;
+
+static SbList <glyphatlas_page *> * glyphatlas_pages = NULL;
+static glyphatlas_glyph_map * glyphatlas_glyphs = NULL;
+static glyphatlas_context_map * glyphatlas_contexts = NULL;
+static int glyphatlas_enabled = -1;
+static int glyphatlas_maxpages = 0;
+static uint32_t glyphatlas_clock = 0;
+
+static SbBool
+glyphatlas_place(glyphatlas_page * page, const int w, const int h,
+                 glyphatlas_rect & rect)
+{
+  for (int i = 0; i < page->shelves.getLength(); i++) {
+    glyphatlas_shelf & shelf = page->shelves[i];
+    if (h <= shelf.height && shelf.height - h <= GLYPHATLAS_SHELF_SLACK &&
+        shelf.x + w <= GLYPHATLAS_PAGE_SIZE) {
+      rect.x = shelf.x;
+      rect.y = shelf.y;
+      rect.w = w;
+      rect.h = h;
+      shelf.x += w;
+      return TRUE;
+    }
+  }
+  if (page->shelftop + h <= GLYPHATLAS_PAGE_SIZE) {
+    glyphatlas_shelf shelf;
+    shelf.y = page->shelftop;
+    shelf.height = h;
+    shelf.x = w;
+    page->shelves.append(shelf);
+    page->shelftop += h;
+    rect.x = 0;
+    rect.y = shelf.y;
+    rect.w = w;
+    rect.h = h;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+// Removes all glyphs from a page that no glyph cache uses. Called
+// with the mutex held.
+static void
+glyphatlas_clear_page(const int idx)
+{
+  glyphatlas_page * page = (*glyphatlas_pages)[idx];
+  assert(page->refcount == 0);
+  SbList <const cc_glyph2d *> glyphs;
+  for (glyphatlas_glyph_map::const_iterator it = glyphatlas_glyphs->const_begin();
+       it != glyphatlas_glyphs->const_end(); ++it) {
+    if (it->obj.page == idx) glyphs.append(it->key);
+  }
+  for (int i = 0; i < glyphs.getLength(); i++) {
+    glyphatlas_glyphs->erase(glyphs[i]);
+    cc_glyph2d_unref(const_cast<cc_glyph2d *>(glyphs[i]));
+  }
+  memset(page->pixels, 0, GLYPHATLAS_PAGE_SIZE * GLYPHATLAS_PAGE_SIZE);
+  page->shelves.truncate(0);
+  page->rects.truncate(0);
+  page->shelftop = 0;
+  page->generation++;
+}
+
+// Returns a page with room for a w x h rectangle, and places it
+// there. Called with the mutex held. Returns -1 if all the pages are
+// full and in use.
+static int
+glyphatlas_find_page(const int w, const int h, glyphatlas_rect & rect)
+{
+  const int numpages = glyphatlas_pages->getLength();
+  for (int i = 0; i < numpages; i++) {
+    if (glyphatlas_place((*glyphatlas_pages)[i], w, h, rect)) return i;
+  }
+  if (numpages < glyphatlas_maxpages) {
+    glyphatlas_page * newpage = new glyphatlas_page;
+    newpage->pixels = new unsigned char[GLYPHATLAS_PAGE_SIZE * GLYPHATLAS_PAGE_SIZE];
+    memset(newpage->pixels, 0, GLYPHATLAS_PAGE_SIZE * GLYPHATLAS_PAGE_SIZE);
+    newpage->shelftop = 0;
+    newpage->refcount = 0;
+    newpage->stamp = 0;
+    newpage->generation = 0;
+    glyphatlas_pages->append(newpage);
+    (void) glyphatlas_place(newpage, w, h, rect);
+    return numpages;
+  }
+  int lru = -1;
+  for (int i = 0; i < numpages; i++) {
+    const glyphatlas_page * page = (*glyphatlas_pages)[i];
+    if (page->refcount == 0 &&
+        (lru < 0 || page->stamp < (*glyphatlas_pages)[lru]->stamp)) {
+      lru = i;
+    }
+  }
+  if (lru < 0) return -1;
+  glyphatlas_clear_page(lru);
+  (void) glyphatlas_place((*glyphatlas_pages)[lru], w, h, rect);
+  return lru;
+}
+
+static void
+glyphatlas_context_cleanup(uint32_t context, void * COIN_UNUSED_ARG(closure))
+{
+  LOCK_GLYPHATLAS;
+  glyphatlas_context * ctx = NULL;
+  if (glyphatlas_contexts && glyphatlas_contexts->get(context, ctx)) {
+    glyphatlas_contexts->erase(context);
+    for (int i = 0; i < ctx->textures.getLength(); i++) {
+      if (ctx->textures[i].dl) ctx->textures[i].dl->unref(NULL);
+    }
+    delete ctx;
+  }
+  UNLOCK_GLYPHATLAS;
+}
+
+static void
+glyphatlas_cleanup(void)
+{
+  SoContextHandler::removeContextDestructionCallback(glyphatlas_context_cleanup, NULL);
+  // the contexts are gone, so just free the memory
+  for (glyphatlas_context_map::const_iterator it = glyphatlas_contexts->const_begin();
+       it != glyphatlas_contexts->const_end(); ++it) {
+    delete it->obj;
+  }
+  for (glyphatlas_glyph_map::const_iterator it = glyphatlas_glyphs->const_begin();
+       it != glyphatlas_glyphs->const_end(); ++it) {
+    cc_glyph2d_unref(const_cast<cc_glyph2d *>(it->key));
+  }
+  for (int i = 0; i < glyphatlas_pages->getLength(); i++) {
+    delete[] (*glyphatlas_pages)[i]->pixels;
+    delete (*glyphatlas_pages)[i];
+  }
+  delete glyphatlas_pages;
+  glyphatlas_pages = NULL;
+  delete glyphatlas_glyphs;
+  glyphatlas_glyphs = NULL;
+  delete glyphatlas_contexts;
+  glyphatlas_contexts = NULL;
+  glyphatlas_enabled = -1;
+  glyphatlas_maxpages = 0;
+  glyphatlas_clock = 0;
+#ifdef COIN_THREADSAFE
+  delete glyphatlas_mutex;
+  glyphatlas_mutex = NULL;
+#endif // COIN_THREADSAFE
+}
+
+// *************************************************************************
+
+void
+SoGLGlyphAtlas::initClass(void)
+{
+#ifdef COIN_THREADSAFE
+  glyphatlas_mutex = new SbMutex;
+#endif // COIN_THREADSAFE
+  glyphatlas_pages = new SbList <glyphatlas_page *>;
+  glyphatlas_glyphs = new glyphatlas_glyph_map;
+  glyphatlas_contexts = new glyphatlas_context_map;
+  const char * env = coin_getenv("COIN_TEXT2_GLYPH_ATLAS_PAGES");
+  glyphatlas_maxpages = env ? atoi(env) : GLYPHATLAS_DEFAULT_MAX_PAGES;
+  if (glyphatlas_maxpages < 1) glyphatlas_maxpages = 1;
+  SoContextHandler::addContextDestructionCallback(glyphatlas_context_cleanup, NULL);
+  // before the font subsystem, since the atlas holds references to
+  // glyphs
+  coin_atexit((coin_atexit_f*) glyphatlas_cleanup, CC_ATEXIT_NORMAL);
+}
+
+/*
+  Returns FALSE if the COIN_TEXT2_GLYPH_ATLAS environment variable is
+  set to 0.
+*/
+SbBool
+SoGLGlyphAtlas::isEnabled(void)
+{
+  if (glyphatlas_enabled < 0) {
+    const char * env = coin_getenv("COIN_TEXT2_GLYPH_ATLAS");
+    glyphatlas_enabled = (env && atoi(env) == 0) ? 0 : 1;
+  }
+  return glyphatlas_enabled == 1;
+}
+
+int
+SoGLGlyphAtlas::getPageSize(void)
+{
+  return GLYPHATLAS_PAGE_SIZE;
+}
+
+const unsigned char *
+SoGLGlyphAtlas::getPagePixels(const int page)
+{
+  LOCK_GLYPHATLAS;
+  const unsigned char * pixels = (*glyphatlas_pages)[page]->pixels;
+  UNLOCK_GLYPHATLAS;
+  return pixels;
+}
+
+SbBool
+SoGLGlyphAtlas::addGlyph(cc_glyph2d * glyph, const uint32_t character,
+                         const cc_font_specification * spec,
+                         int & page, int & x, int & y)
+{
+  LOCK_GLYPHATLAS;
+  glyphatlas_glyph entry;
+  if (glyphatlas_glyphs->get(glyph, entry)) {
+    glyphatlas_page * p = (*glyphatlas_pages)[entry.page];
+    p->refcount++;
+    p->stamp = ++glyphatlas_clock;
+    UNLOCK_GLYPHATLAS;
+    page = entry.page;
+    x = entry.x;
+    y = entry.y;
+    return TRUE;
+  }
+
+  int size[2], offset[2];
+  const unsigned char * bitmap = cc_glyph2d_getbitmap(glyph, size, offset);
+  const SbBool mono = cc_glyph2d_getmono(glyph);
+  if (size[0] > GLYPHATLAS_MAX_GLYPH_SIZE || size[1] > GLYPHATLAS_MAX_GLYPH_SIZE) {
+    UNLOCK_GLYPHATLAS;
+    return FALSE;
+  }
+
+  // the rectangle includes the border
+  glyphatlas_rect rect;
+  const int i = glyphatlas_find_page(size[0] + 2, size[1] + 2, rect);
+  if (i < 0) {
+    UNLOCK_GLYPHATLAS;
+    return FALSE;
+  }
+
+  glyphatlas_page * p = (*glyphatlas_pages)[i];
+  p->refcount++;
+  p->stamp = ++glyphatlas_clock;
+  if (bitmap) {
+    unsigned char * dst = p->pixels + (rect.y + 1) * GLYPHATLAS_PAGE_SIZE + rect.x + 1;
+    // mono bitmaps have one bit per pixel, and rows padded to whole
+    // bytes, which makes size[0] a multiple of 8
+    const int rowbytes = mono ? size[0] / 8 : size[0];
+    for (int row = 0; row < size[1]; row++) {
+      const unsigned char * src = bitmap + row * rowbytes;
+      if (mono) {
+        for (int col = 0; col < size[0]; col++) {
+          dst[col] = (src[col >> 3] & (0x80 >> (col & 7))) ? 255 : 0;
+        }
+      }
+      else {
+        memcpy(dst, src, size[0]);
+      }
+      dst += GLYPHATLAS_PAGE_SIZE;
+    }
+  }
+  p->rects.append(rect);
+
+  // keep the glyph alive, so that the pointer isn't reused by another
+  // glyph
+  cc_glyph2d * ref = cc_glyph2d_ref(character, spec, 0.0f);
+  assert(ref == glyph);
+  (void) ref;
+  entry.page = i;
+  entry.x = rect.x + 1;
+  entry.y = rect.y + 1;
+  glyphatlas_glyphs->put(glyph, entry);
+  UNLOCK_GLYPHATLAS;
+
+  page = entry.page;
+  x = entry.x;
+  y = entry.y;
+  return TRUE;
+}
+
+/*
+  Releases a page reference returned by addGlyph().
+*/
+void
+SoGLGlyphAtlas::unrefPage(const int page)
+{
+  LOCK_GLYPHATLAS;
+  // glyph caches may be deleted after the atexit cleanup
+  if (glyphatlas_pages) {
+    glyphatlas_page * p = (*glyphatlas_pages)[page];
+    assert(p->refcount > 0);
+    p->refcount--;
+  }
+  UNLOCK_GLYPHATLAS;
+}
+
+void
+SoGLGlyphAtlas::bindPage(SoState * state, const int page)
+{
+  const uint32_t context = SoGLCacheContextElement::get(state);
+
+  LOCK_GLYPHATLAS;
+  glyphatlas_context * ctx = NULL;
+  if (!glyphatlas_contexts->get(context, ctx)) {
+    ctx = new glyphatlas_context;
+    glyphatlas_contexts->put(context, ctx);
+  }
+  while (ctx->textures.getLength() <= page) {
+    glyphatlas_texture texture;
+    texture.dl = NULL;
+    texture.numuploaded = 0;
+    texture.generation = 0;
+    ctx->textures.append(texture);
+  }
+
+  glyphatlas_texture & texture = ctx->textures[page];
+  glyphatlas_page * p = (*glyphatlas_pages)[page];
+  p->stamp = ++glyphatlas_clock;
+  if (texture.dl == NULL || texture.generation != p->generation ||
+      texture.numuploaded < p->rects.getLength()) {
+    // texture updates must not end up in render caches, since the
+    // page would be reset to an older state when the cache is
+    // called
+    if (state->isCacheOpen()) SoCacheElement::invalidate(state);
+
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, GLYPHATLAS_PAGE_SIZE);
+    if (texture.dl == NULL) {
+      texture.dl = new SoGLDisplayList(state, SoGLDisplayList::TEXTURE_OBJECT, 1, FALSE);
+      texture.dl->ref();
+      texture.dl->setTextureTarget((int) GL_TEXTURE_2D);
+      texture.dl->open(state);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, GLYPHATLAS_PAGE_SIZE,
+                   GLYPHATLAS_PAGE_SIZE, 0, GL_ALPHA, GL_UNSIGNED_BYTE, p->pixels);
+    }
+    else if (texture.generation != p->generation) {
+      // the page has been cleared and reused
+      texture.dl->open(state);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, GLYPHATLAS_PAGE_SIZE, GLYPHATLAS_PAGE_SIZE,
+                      GL_ALPHA, GL_UNSIGNED_BYTE, p->pixels);
+    }
+    else {
+      texture.dl->open(state);
+      for (int i = texture.numuploaded; i < p->rects.getLength(); i++) {
+        const glyphatlas_rect & r = p->rects[i];
+        glTexSubImage2D(GL_TEXTURE_2D, 0, r.x, r.y, r.w, r.h, GL_ALPHA, GL_UNSIGNED_BYTE,
+                        p->pixels + r.y * GLYPHATLAS_PAGE_SIZE + r.x);
+      }
+    }
+    texture.dl->close(state);
+    glPopClientAttrib();
+    texture.numuploaded = p->rects.getLength();
+    texture.generation = p->generation;
+  }
+  SoGLDisplayList * dl = texture.dl;
+  UNLOCK_GLYPHATLAS;
+
+  dl->call(state);
+}
+
+#undef LOCK_GLYPHATLAS
+#undef UNLOCK_GLYPHATLAS
+
+#ifdef COIN_TEST_SUITE
+
+#include "fonts/fontspec.h"
+#include "fonts/glyph2d.h"
+#include "rendering/SoGLGlyphAtlas.h"
+
+// Adds some glyphs and checks that the same glyph is found in the
+// same place again, that glyphs don't share texels, and that the
+// texels a glyph's texture coordinates address hold its bitmap, with
+// an empty border around it.
+BOOST_AUTO_TEST_CASE(glyphLookup)
+{
+  const char characters[] = "AgW.#@";
+  const int numglyphs = sizeof(characters) - 1;
+  const int pagesize = SoGLGlyphAtlas::getPageSize();
+  cc_font_specification spec;
+  cc_fontspec_construct(&spec, "defaultFont", 12.0f, 0.0f);
+
+  cc_glyph2d * glyphs[numglyphs];
+  int page[numglyphs], x[numglyphs], y[numglyphs], size[numglyphs][2];
+  int i;
+  for (i = 0; i < numglyphs; i++) {
+    glyphs[i] = cc_glyph2d_ref(characters[i], &spec, 0.0f);
+    BOOST_REQUIRE(glyphs[i] != NULL);
+    BOOST_REQUIRE_MESSAGE(SoGLGlyphAtlas::addGlyph(glyphs[i], characters[i], &spec,
+                                                   page[i], x[i], y[i]),
+                          "couldn't add '" << characters[i] << "' to the atlas");
+  }
+
+  for (i = 0; i < numglyphs; i++) {
+    int samepage, samex, samey;
+    BOOST_CHECK(SoGLGlyphAtlas::addGlyph(glyphs[i], characters[i], &spec,
+                                         samepage, samex, samey));
+    BOOST_CHECK_MESSAGE(samepage == page[i] && samex == x[i] && samey == y[i],
+                        "'" << characters[i] << "' moved in the atlas");
+    SoGLGlyphAtlas::unrefPage(samepage);
+
+    int offset[2];
+    const unsigned char * bitmap = cc_glyph2d_getbitmap(glyphs[i], size[i], offset);
+    const SbBool mono = cc_glyph2d_getmono(glyphs[i]);
+    const int rowbytes = mono ? size[i][0] / 8 : size[i][0];
+    // the texture coordinates of the corners of the glyph's quad
+    const float s0 = float(x[i]) / float(pagesize);
+    const float t0 = float(y[i]) / float(pagesize);
+    const float s1 = float(x[i] + size[i][0]) / float(pagesize);
+    const float t1 = float(y[i] + size[i][1]) / float(pagesize);
+    BOOST_CHECK(s0 > 0.0f && t0 > 0.0f && s1 < 1.0f && t1 < 1.0f);
+
+    const unsigned char * pixels = SoGLGlyphAtlas::getPagePixels(page[i]);
+    int numwrong = 0, numink = 0;
+    for (int row = -1; row <= size[i][1]; row++) {
+      for (int col = -1; col <= size[i][0]; col++) {
+        // the texel at the center of this pixel of the quad
+        const float s = s0 + (s1 - s0) * (col + 0.5f) / size[i][0];
+        const float t = t0 + (t1 - t0) * (row + 0.5f) / size[i][1];
+        const unsigned char texel =
+          pixels[int(t * pagesize) * pagesize + int(s * pagesize)];
+        unsigned char expected = 0;
+        if (bitmap && row >= 0 && row < size[i][1] && col >= 0 && col < size[i][0]) {
+          const unsigned char * src = bitmap + row * rowbytes;
+          expected = mono ? ((src[col >> 3] & (0x80 >> (col & 7))) ? 255 : 0) : src[col];
+        }
+        if (texel != expected) numwrong++;
+        if (expected != 0) numink++;
+      }
+    }
+    BOOST_CHECK_MESSAGE(numink > 0, "'" << characters[i] << "' has no visible pixels");
+    BOOST_CHECK_MESSAGE(numwrong == 0, numwrong << " texels of '" << characters[i] <<
+                        "' and its border are wrong");
+  }
+
+  // with the border, the rectangles of the glyphs don't overlap
+  for (i = 0; i < numglyphs; i++) {
+    for (int j = 0; j < i; j++) {
+      const SbBool overlap = page[i] == page[j] &&
+        x[i] - 1 < x[j] + size[j][0] + 1 && x[j] - 1 < x[i] + size[i][0] + 1 &&
+        y[i] - 1 < y[j] + size[j][1] + 1 && y[j] - 1 < y[i] + size[i][1] + 1;
+      BOOST_CHECK_MESSAGE(!overlap, "'" << characters[i] << "' overlaps '" <<
+                          characters[j] << "' in the atlas");
+    }
+  }
+
+  for (i = 0; i < numglyphs; i++) {
+    SoGLGlyphAtlas::unrefPage(page[i]);
+    cc_glyph2d_unref(glyphs[i]);
+  }
+  cc_fontspec_clean(&spec);
+}
+
+#endif // COIN_TEST_SUITE
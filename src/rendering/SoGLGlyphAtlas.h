@@ -0,0 +1,85 @@
+#ifndef COIN_SOGLGLYPHATLAS_H
+#define COIN_SOGLGLYPHATLAS_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+// *************************************************************************
+
+#include <Inventor/SbBasic.h>
+
+#include "fonts/glyph2d.h"
+#include "fonts/fontspec.h"
+
+class SoState;
+
+// Alpha textures with the bitmaps of 2D glyphs, shared by all
+// SoText2 nodes and fonts. Glyphs are packed into pages of
+// getPageSize() x getPageSize() pixels in memory, and the pages are
+// uploaded to each context when they are bound, so the position of a
+// glyph is the same in all contexts.
+//
+// Pages are referenced by the glyph caches that render from them.
+// When the maximum number of pages is reached, the least recently
+// used page that isn't referenced is cleared and reused.
+class SoGLGlyphAtlas {
+public:
+  // Finds or adds a glyph, and returns the page it is stored in and
+  // the position of its lower left corner in the page, with a
+  // reference to the page that must be released with unrefPage().
+  // Returns FALSE if the glyph is too large for the atlas, or if all
+  // the pages are in use.
+  static SbBool addGlyph(cc_glyph2d * glyph, const uint32_t character,
+                         const cc_font_specification * spec,
+                         int & page, int & x, int & y);
+  static void unrefPage(const int page);
+  static int getPageSize(void);
+  // The alpha values of a page, row by row from the bottom, which
+  // change when glyphs are added to the page.
+  static const unsigned char * getPagePixels(const int page);
+
+  // Binds the texture for a page in the current context, and uploads
+  // the glyphs that have been added since it was last bound.
+  static void bindPage(SoState * state, const int page);
+
+  static SbBool isEnabled(void);
+
+  static void initClass(void);
+};
+
+// *************************************************************************
+
+#endif // !COIN_SOGLGLYPHATLAS_H
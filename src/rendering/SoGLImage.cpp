@@ -102,6 +102,21 @@
   GL_SGIS_generate_mipmap is not enabled by default since we suspect some
   ATi drivers have problems with this extension.
 
+  \li COIN_TEX2_USE_INTERNAL_RESIZE: When set to 1, textures that must
+  be resized are resized with the internal box and Lanczos filters
+  (see SbImage::resize()) instead of simage or GLU. The internal
+  filters use several threads for large textures. This is not enabled
+  by default yet, since it changes the look of resized textures.
+
+  \li COIN_TEX2_STREAMING: When set to 1, large 2D textures are
+  uploaded over several frames. See setTextureStreaming().
+
+  \li COIN_TEX2_UPLOAD_BUDGET: The number of bytes of streamed
+  textures to upload per frame. Default value is 4194304 (4 MB).
+
+  \li COIN_TEXTURE_ATLAS: When set to 1, small 2D textures are packed
+  into shared atlas textures. See setTextureAtlas().
+
   \li COIN_ENABLE_CONFORMANT_GL_CLAMP: When set, GL_CLAMP will be used
   when SoGLImage::CLAMP is specified as the texture wrap mode. By
   default GL_CLAMP_TO_EDGE is used, since this is usually what people
@@ -197,6 +212,8 @@
 #endif // HAVE_CONFIG_H
 
 #include <Inventor/C/glue/gl.h>
+#include <Inventor/C/threads/common.h>
+#include <Inventor/C/threads/sched.h>
 #include <Inventor/C/tidbits.h>
 #include <Inventor/SbImage.h>
 #include <Inventor/actions/SoGLRenderAction.h>
@@ -218,12 +235,15 @@
 #endif // COIN_THREADSAFE
 
 #include "tidbitsp.h"
+#include "base/SbImageResize.h"
 #include "rendering/SoGL.h"
+#include "rendering/SoGLTextureAtlas.h"
 #include "elements/SoTextureScaleQualityElement.h"
 #include "glue/GLUWrapper.h"
 #include "glue/glp.h"
 #include "glue/simage_wrapper.h"
 #include "threads/threadsutilp.h"
+#include "profiler/SoProfilerCountersP.h"
 #include "coindefs.h"
 
 #if BOOST_WORKAROUND(COIN_MSVC, <= COIN_MSVC_6_0_VERSION)
@@ -246,6 +266,7 @@ static float COIN_TEX2_SCALEUP_LIMIT = -1.0f;
 static float COIN_TEX2_ANISOTROPIC_LIMIT = -1.0f;
 static int COIN_TEX2_USE_GLTEXSUBIMAGE = -1;
 static int COIN_TEX2_USE_SGIS_GENERATE_MIPMAP = -1;
+static int COIN_TEX2_USE_INTERNAL_RESIZE = -1;
 static int COIN_ENABLE_CONFORMANT_GL_CLAMP = -1;
 
 // *************************************************************************
@@ -334,115 +355,6 @@ compute_log(int value)
   return i;
 }
 
-//FIXME: Use as a special case of 3D image to reduce codelines ? (kintel 20011115)
-static void
-halve_image(const int width, const int height, const int nc,
-            const unsigned char *datain, unsigned char *dataout)
-{
-  assert(width > 1 || height > 1);
-
-  int nextrow = width *nc;
-  int newwidth = width >> 1;
-  int newheight = height >> 1;
-  unsigned char *dst = dataout;
-  const unsigned char *src = datain;
-
-  // check for 1D images
-  if (width == 1 || height == 1) {
-    int n = SbMax(newwidth, newheight);
-    for (int i = 0; i < n; i++) {
-      for (int j = 0; j < nc; j++) {
-        *dst = (src[0] + src[nc]) >> 1;
-        dst++; src++;
-      }
-      src += nc; // skip to next pixel
-    }
-  }
-  else {
-    for (int i = 0; i < newheight; i++) {
-      for (int j = 0; j < newwidth; j++) {
-        for (int c = 0; c < nc; c++) {
-          *dst = (src[0] + src[nc] + src[nextrow] + src[nextrow+nc] + 2) >> 2;
-          dst++; src++;
-        }
-        src += nc; // skip to next pixel
-      }
-      src += nextrow;
-    }
-  }
-}
-
-static void
-halve_image(const int width, const int height, const int depth, const int nc,
-            const unsigned char *datain, unsigned char *dataout)
-{
-  assert(width > 1 || height > 1 || depth > 1);
-
-  int rowsize = width * nc;
-  int imagesize = width * height * nc;
-  int newwidth = width >> 1;
-  int newheight = height >> 1;
-  int newdepth = depth >> 1;
-  unsigned char *dst = dataout;
-  const unsigned char *src = datain;
-
-  int numdims = (width>=1?1:0)+(height>=1?1:0)+(depth>=1?1:0);
-  // check for 1D images.
-  if (numdims == 1) {
-    int n = SbMax(SbMax(newwidth, newheight), newdepth);
-    for (int i = 0; i < n; i++) {
-      for (int j = 0; j < nc; j++) {
-        *dst = (src[0] + src[nc]) >> 1;
-        dst++; src++;
-      }
-      src += nc; // skip to next pixel/row/image
-    }
-  }
-  // check for 2D images
-  else if (numdims == 2) {
-    int s1,s2,blocksize;
-    if (width==1) {
-      s1 = newheight;
-      blocksize = height * nc;
-    }
-    else {
-      s1 = newwidth;
-      blocksize = width * nc;
-    }
-    s2 = depth==1?newheight:newdepth;
-    for (int j = 0; j < s2; j++) {
-      for (int i = 0; i < s1; i++) {
-        for (int k = 0; k < nc; k++) {
-          *dst = (src[0] + src[nc] + src[blocksize] + src[blocksize+nc] + 2) >> 2;
-          dst++; src++;
-        }
-        src += nc; // skip to next pixel (x or y direction)
-      }
-      src += blocksize; // Skip to next row/image
-    }
-  }
-  else { // 3D image
-    for (int k = 0; k < newdepth; k++) {
-      for (int j = 0; j < newheight; j++) {
-        for (int i = 0; i < newwidth; i++) {
-          for (int c = 0; c < nc; c++) {
-            *dst = (src[0] + src[nc] +
-                    src[rowsize] + src[rowsize+nc] +
-                    src[imagesize] + src[imagesize+nc] +
-                    src[imagesize+rowsize] + src[imagesize+rowsize+nc] +
-                    4) >> 3;
-            dst++; src++;
-          }
-          src += nc; // skip one pixel
-        }
-        src += rowsize; // skip one row
-      }
-      src += imagesize; // skip one image
-    }
-  }
-}
-
-
 // fast mipmap creation. no repeated memory allocations.
 static void
 fast_mipmap(SoState * state, int width, int height, int nc,
@@ -472,7 +384,7 @@ fast_mipmap(SoState * state, int width, int height, int nc,
   }
   unsigned char *src = (unsigned char *) data;
   for (level = 1; level <= levels; level++) {
-    halve_image(width, height, nc, src, mipmap_buffer);
+    SbImageResize::halve(src, width, height, 0, nc, mipmap_buffer);
     if (width > 1) width >>= 1;
     if (height > 1) height >>= 1;
     src = mipmap_buffer;
@@ -521,7 +433,7 @@ fast_mipmap(SoState * state, int width, int height, int depth,
   }
   unsigned char *src = (unsigned char *) data;
   for (int level = 1; level <= levels; level++) {
-    halve_image(width, height, depth, nc, src, mipmap_buffer);
+    SbImageResize::halve(src, width, height, depth, nc, mipmap_buffer);
     if (width > 1) width >>= 1;
     if (height > 1) height >>= 1;
     if (depth > 1) depth >>= 1;
@@ -543,6 +455,65 @@ fast_mipmap(SoState * state, int width, int height, int depth,
   }
 }
 
+// Resizes with simage or GLU. Returns FALSE if neither is available.
+static SbBool
+glimage_external_resize(const cc_glglue * glw, const unsigned char * bytes,
+                        const int xsize, const int ysize, const int zsize,
+                        const int numcomponents, unsigned char * dst,
+                        const int newx, const int newy, const int newz)
+{
+  const int numbytes = newx * newy * ((newz==0)?1:newz) * numcomponents;
+
+  if (zsize == 0) { // 2D image
+    // simage version 1.1.1 has a pretty high quality resize
+    // function. We prefer to use that to avoid using GLU, since
+    // there are lots of buggy GLU libraries out there.
+    if (simage_wrapper()->available &&
+        simage_wrapper()->versionMatchesAtLeast(1,1,1) &&
+        simage_wrapper()->simage_resize) {
+      unsigned char *result =
+        simage_wrapper()->simage_resize((unsigned char*) bytes,
+                                        xsize, ysize, numcomponents,
+                                        newx, newy);
+      (void)memcpy(dst, result, numbytes);
+      simage_wrapper()->simage_free_image(result);
+      return TRUE;
+    }
+    if (GLUWrapper()->available) {
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+      glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+      glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+      glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+      glPixelStorei(GL_PACK_SKIP_PIXELS, 0);
+      glPixelStorei(GL_PACK_SKIP_ROWS, 0);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+      glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+      // FIXME: ignoring the error code. Silly. 20000929 mortene.
+      (void)GLUWrapper()->gluScaleImage(coin_glglue_get_texture_format(glw, numcomponents),
+                                        xsize, ysize,
+                                        GL_UNSIGNED_BYTE, bytes,
+                                        newx, newy, GL_UNSIGNED_BYTE,
+                                        dst);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+      glPixelStorei(GL_PACK_ALIGNMENT, 4);
+      return TRUE;
+    }
+  }
+  else if (simage_wrapper()->available &&
+           simage_wrapper()->versionMatchesAtLeast(1,3,0) &&
+           simage_wrapper()->simage_resize3d) {
+    unsigned char *result =
+      simage_wrapper()->simage_resize3d((unsigned char*) bytes,
+                                        xsize, ysize, numcomponents, zsize,
+                                        newx, newy, newz);
+    (void)memcpy(dst, result, numbytes);
+    simage_wrapper()->simage_free_image(result);
+    return TRUE;
+  }
+  return FALSE;
+}
+
 // A low quality resize function. It is only used when neither simage
 // nor GLU is available.
 static void
@@ -617,6 +588,36 @@ fast_image_resize3d(const unsigned char * src,
 
 // *************************************************************************
 
+// A texture being streamed, see SoGLImageP::processUploads().
+class glimage_upload {
+public:
+  glimage_upload(void)
+    : owner(NULL), placeholder(NULL), dl(NULL), context(0),
+      contextalive(TRUE), prepared(FALSE), src(NULL), levels(NULL),
+      level(0), row(0), pbo(0) { }
+  ~glimage_upload() {
+    delete[] this->src;
+    delete[] this->levels;
+  }
+  SoGLImageP * owner; // NULL when the upload has been cancelled
+  SoGLDisplayList * placeholder;
+  SoGLDisplayList * dl;
+  int context;
+  SbBool contextalive;
+  SbBool prepared; // set when the levels are ready for upload
+
+  unsigned char * src;
+  int srcwidth, srcheight;
+  int width, height, nc;
+  SbBool mipmap;
+  SbImageResize::Filter filter;
+
+  unsigned char * levels;
+  SbList <int> offsets; // the offset of each mipmap level in levels
+  int level, row; // the next row to upload
+  GLuint pbo;
+};
+
 class SoGLImageP {
 public:
 #ifdef COIN_THREADSAFE
@@ -638,9 +639,12 @@ public:
                            const SbBool mipmap,
                            const int border);
   void reallyBindPBuffer(SoState *state);
+  void getTextureSize(SoState * state,
+                      uint32_t &xsize, uint32_t &ysize, uint32_t &zsize);
   void resizeImage(SoState * state, unsigned char *&imageptr,
                    uint32_t &xsize, uint32_t &ysize, uint32_t &zsize);
   SbBool shouldCreateMipmap(void);
+  void getFilters(const SbBool ismipmap, GLenum & magfilter, GLenum & minfilter);
   void applyFilter(const SbBool ismipmap);
 
   void * pbuffer;
@@ -689,14 +693,43 @@ public:
 
   static SoGLImage::SoGLImageResizeCB * resizecb;
   static void * resizeclosure;
+
+  // texture streaming
+  SoGLDisplayList * createStreamedGLDisplayList(SoState * state,
+                                                const SbBool resize,
+                                                const SbBool mipmap);
+  SbBool isUploading(const SoGLDisplayList * dl);
+  void cancelUploads(const int context);
+  static void processUploads(SoState * state);
+  static void uploadContextCleanup(uint32_t context, void * closure);
+
+  static SbList <glimage_upload *> * uploads;
+  static int numuploads;
+  static cc_sched * uploadsched;
+  static SbBool streaming;
+  static uint32_t uploadbudget;
+  static uint32_t uploadbytes;
+#ifdef COIN_THREADSAFE
+  static SbMutex * uploadmutex;
+#endif // COIN_THREADSAFE
+
+  static SbBool atlas;
 };
 
 SoType SoGLImageP::classTypeId STATIC_SOTYPE_INIT;
 uint32_t SoGLImageP::current_glimageid = 1;
 SoGLImage::SoGLImageResizeCB * SoGLImageP::resizecb = NULL;
 void * SoGLImageP::resizeclosure = NULL;
+SbList <glimage_upload *> * SoGLImageP::uploads = NULL;
+int SoGLImageP::numuploads = 0;
+cc_sched * SoGLImageP::uploadsched = NULL;
+SbBool SoGLImageP::streaming = FALSE;
+uint32_t SoGLImageP::uploadbudget = 4 * 1024 * 1024;
+uint32_t SoGLImageP::uploadbytes = 0;
+SbBool SoGLImageP::atlas = FALSE;
 #ifdef COIN_THREADSAFE
 SbMutex * SoGLImageP::mutex;
+SbMutex * SoGLImageP::uploadmutex;
 #endif // COIN_THREADSAFE
 
 #undef PRIVATE
@@ -727,6 +760,17 @@ SbMutex * SoGLImageP::mutex;
 #define UNLOCK_GLIMAGE
 #endif // !COIN_THREADSAFE
 
+// The upload queue has its own mutex, since textures are created
+// both with and without the mutex above held. When both are needed,
+// LOCK_GLIMAGE must be done first.
+#ifdef COIN_THREADSAFE
+#define LOCK_UPLOADS SoGLImageP::uploadmutex->lock()
+#define UNLOCK_UPLOADS SoGLImageP::uploadmutex->unlock()
+#else // COIN_THREADSAFE
+#define LOCK_UPLOADS
+#define UNLOCK_UPLOADS
+#endif // !COIN_THREADSAFE
+
 // *************************************************************************
 
 /*!
@@ -786,6 +830,14 @@ SoGLImage::SoGLImage(void)
     else COIN_TEX2_USE_SGIS_GENERATE_MIPMAP = 0;
   }
 
+  if (COIN_TEX2_USE_INTERNAL_RESIZE < 0) {
+    const char *env = coin_getenv("COIN_TEX2_USE_INTERNAL_RESIZE");
+    if (env && atoi(env) == 1) {
+      COIN_TEX2_USE_INTERNAL_RESIZE = 1;
+    }
+    else COIN_TEX2_USE_INTERNAL_RESIZE = 0;
+  }
+
   if (COIN_ENABLE_CONFORMANT_GL_CLAMP < 0) {
     const char * env = coin_getenv("COIN_ENABLE_CONFORMANT_GL_CLAMP");
     if (env && atoi(env) == 1) {
@@ -812,10 +864,24 @@ SoGLImage::initClass(void)
                                                SbName("GLImage"));
 #ifdef COIN_THREADSAFE
   SoGLImageP::mutex = new SbMutex;
+  SoGLImageP::uploadmutex = new SbMutex;
+  if (cc_thread_implementation() != CC_NO_THREADS) {
+    SoGLImageP::uploadsched = cc_sched_construct(1);
+  }
 #endif // COIN_THREADSAFE
   glimage_bufferstorage = new SbStorage(sizeof(soglimage_buffer),
                                         glimage_buffer_construct, glimage_buffer_destruct);
 
+  const char * env = coin_getenv("COIN_TEX2_STREAMING");
+  SoGLImageP::streaming = env && (atoi(env) > 0);
+  env = coin_getenv("COIN_TEX2_UPLOAD_BUDGET");
+  if (env && (atoi(env) > 0)) SoGLImageP::uploadbudget = (uint32_t) atoi(env);
+  SoContextHandler::addContextDestructionCallback(SoGLImageP::uploadContextCleanup, NULL);
+
+  env = coin_getenv("COIN_TEXTURE_ATLAS");
+  SoGLImageP::atlas = env && (atoi(env) > 0);
+  SoGLTextureAtlas::initClass();
+
   coin_atexit((coin_atexit_f*)SoGLImage::cleanupClass, CC_ATEXIT_NORMAL);
 
   SoGLCubeMapImage::initClass();
@@ -827,11 +893,35 @@ SoGLImage::initClass(void)
 void
 SoGLImage::cleanupClass(void)
 {
+  SoContextHandler::removeContextDestructionCallback(SoGLImageP::uploadContextCleanup, NULL);
+  if (SoGLImageP::uploadsched) {
+    cc_sched_wait_all(SoGLImageP::uploadsched);
+    cc_sched_destruct(SoGLImageP::uploadsched);
+    SoGLImageP::uploadsched = NULL;
+  }
+  if (SoGLImageP::uploads) {
+    // the contexts are gone, so just free the memory
+    for (int i = 0; i < SoGLImageP::uploads->getLength(); i++) {
+      delete (*SoGLImageP::uploads)[i];
+    }
+    delete SoGLImageP::uploads;
+    SoGLImageP::uploads = NULL;
+  }
+  SoGLImageP::numuploads = 0;
+  SoGLImageP::streaming = FALSE;
+  SoGLImageP::uploadbudget = 4 * 1024 * 1024;
+  SoGLImageP::uploadbytes = 0;
+
+  SoGLTextureAtlas::cleanupClass();
+  SoGLImageP::atlas = FALSE;
+
   delete glimage_bufferstorage;
   glimage_bufferstorage = NULL;
 #ifdef COIN_THREADSAFE
   delete SoGLImageP::mutex;
   SoGLImageP::mutex = NULL;
+  delete SoGLImageP::uploadmutex;
+  SoGLImageP::uploadmutex = NULL;
 #endif // COIN_THREADSAFE
   SoGLImageP::classTypeId STATIC_SOTYPE_INIT;
 
@@ -1078,6 +1168,7 @@ SoGLImage::setData(const SbImage *image,
       PRIVATE(this)->dlists.append(SoGLImageP::dldata(dl));
       PRIVATE(this)->image = NULL; // data is temporary, and only for current context
       dl->call(createinstate);
+      SoProfilerCountersP::count(SoProfilerCounters::TEXTURE_UPLOADS);
 
       SbBool compress =
         (PRIVATE(this)->flags & COMPRESSED) &&
@@ -1186,6 +1277,7 @@ SoGLImage::~SoGLImage()
   SoContextHandler::removeContextDestructionCallback(SoGLImageP::contextCleanup, PRIVATE(this));
   if (PRIVATE(this)->isregistered) SoGLImage::unregisterImage(this);
   PRIVATE(this)->unrefDLists(NULL);
+  if (SoGLTextureAtlas::isInUse()) SoGLTextureAtlas::remove(this);
   delete PRIVATE(this);
 }
 
@@ -1273,9 +1365,76 @@ SoGLImage::getGLDisplayList(SoState *state)
     }
     else PRIVATE(this)->quality = oldquality;
   }
+  if (dl && SoGLImageP::numuploads && PRIVATE(this)->isUploading(dl)) {
+    // the texture is a placeholder, and must not be kept in any
+    // render caches
+    SoCacheElement::setInvalid(TRUE);
+    if (state->isCacheOpen()) {
+      SoCacheElement::invalidate(state);
+    }
+  }
   return dl;
 }
 
+/*!
+  Returns the texture atlas the image is stored in, when texture
+  atlases are enabled and the image is small enough, and sets \a
+  transform to the texture matrix that maps texture coordinates into
+  the image's part of the atlas. Returns NULL if the image isn't
+  stored in an atlas. In that case, getGLDisplayList() should be used
+  instead.
+
+  \sa setTextureAtlas()
+  \since Coin 4.0
+*/
+SoGLDisplayList *
+SoGLImage::getAtlasGLDisplayList(SoState * state, SbMatrix & transform)
+{
+  // subclasses manage their own textures
+  if (!SoGLImageP::atlas || this->getTypeId() != SoGLImage::getClassTypeId()) {
+    return NULL;
+  }
+  if (PRIVATE(this)->pbuffer || !PRIVATE(this)->image || PRIVATE(this)->border ||
+      (PRIVATE(this)->flags & (RECTANGLE|COMPRESSED))) {
+    return NULL;
+  }
+  // the texture matrix can't make a cell repeat, and the gutter
+  // around it has the edge color, not the border color
+  if ((PRIVATE(this)->wraps != CLAMP && PRIVATE(this)->wraps != CLAMP_TO_EDGE) ||
+      (PRIVATE(this)->wrapt != CLAMP && PRIVATE(this)->wrapt != CLAMP_TO_EDGE)) {
+    return NULL;
+  }
+  SbVec3s size;
+  int nc;
+  const unsigned char * bytes = PRIVATE(this)->image->getValue(size, nc);
+  if (!bytes || size[2] != 0 ||
+      size[0] > SoGLTextureAtlas::MAX_IMAGE_SIZE ||
+      size[1] > SoGLTextureAtlas::MAX_IMAGE_SIZE) {
+    return NULL;
+  }
+  const cc_glglue * glw = sogl_glue_instance(state);
+  if (!SoGLDriverDatabase::isSupported(glw, SO_GL_TEXTURE_OBJECT) ||
+      !cc_glglue_glversion_matches_at_least(glw, 1, 2, 0)) {
+    return NULL;
+  }
+
+  // use the current quality, like getGLDisplayList() does
+  const float quality = SoTextureQualityElement::get(state);
+  // anisotropic filtering would read from the neighbouring images
+  if ((quality > COIN_TEX2_ANISOTROPIC_LIMIT) &&
+      SoGLDriverDatabase::isSupported(glw, SO_GL_ANISOTROPIC_FILTERING)) {
+    return NULL;
+  }
+  const float oldquality = PRIVATE(this)->quality;
+  PRIVATE(this)->quality = quality;
+  GLenum magfilter, minfilter;
+  PRIVATE(this)->getFilters(PRIVATE(this)->shouldCreateMipmap(), magfilter, minfilter);
+  PRIVATE(this)->quality = oldquality;
+
+  return SoGLTextureAtlas::find(state, this, PRIVATE(this)->glimageid, bytes,
+                                size[0], size[1], nc, (int) magfilter, (int) minfilter, transform);
+}
+
 
 /*!
   Returns \e TRUE if this texture has some pixels with alpha value != 255
@@ -1395,20 +1554,20 @@ SoGLImageP::init(void)
 }
 
 //
-// resize image if necessary. Returns pointer to temporary
-// buffer if that happens, and the new size in xsize, ysize.
+// Find the size the image must be resized to before it can be used
+// as a texture. The image size is passed in xsize, ysize, zsize.
 //
 void
-SoGLImageP::resizeImage(SoState * state, unsigned char *& imageptr,
-                        uint32_t & xsize, uint32_t & ysize, uint32_t & zsize)
+SoGLImageP::getTextureSize(SoState * state, uint32_t & newx,
+                           uint32_t & newy, uint32_t & newz)
 {
   SbVec3s size;
   int numcomponents;
-  unsigned char *bytes = this->image->getValue(size, numcomponents);
+  (void) this->image->getValue(size, numcomponents);
 
-  uint32_t newx = xsize;
-  uint32_t newy = ysize;
-  uint32_t newz = zsize;
+  const uint32_t xsize = newx;
+  const uint32_t ysize = newy;
+  const uint32_t zsize = newz;
 
   uint32_t maxrectsize = 0;
 
@@ -1477,7 +1636,7 @@ SoGLImageP::resizeImage(SoState * state, unsigned char *& imageptr,
     }
 
     if (newy == 0) { // Avoid endless loop in a buggy driver environment.
-      SoDebugError::post("SoGLImageP::resizeImage",
+      SoDebugError::post("SoGLImageP::getTextureSize",
                          "There is something seriously wrong with OpenGL on "
                          "this system -- can't find *any* valid texture "
                          "size! Expect further problems.");
@@ -1488,7 +1647,7 @@ SoGLImageP::resizeImage(SoState * state, unsigned char *& imageptr,
 #if COIN_DEBUG
   if (orgsize[0] != newx || orgsize[1] != newy || orgsize[2] != newz) {
     if (orgsize[2] != 0) {
-      SoDebugError::postWarning("SoGLImageP::resizeImage",
+      SoDebugError::postWarning("SoGLImageP::getTextureSize",
                                 "Original 3D texture too large for "
                                 "your graphics hardware and / or OpenGL "
                                 "driver. Rescaled from (%d x %d x %d) "
@@ -1497,7 +1656,7 @@ SoGLImageP::resizeImage(SoState * state, unsigned char *& imageptr,
                                 newx, newy, newz);
     }
     else {
-      SoDebugError::postWarning("SoGLImageP::resizeImage",
+      SoDebugError::postWarning("SoGLImageP::getTextureSize",
                                 "Original 2D texture too large for "
                                 "your graphics hardware and / or OpenGL "
                                 "driver. Rescaled from (%d x %d) "
@@ -1510,7 +1669,26 @@ SoGLImageP::resizeImage(SoState * state, unsigned char *& imageptr,
   newx += 2 * this->border;
   newy += 2 * this->border;
   newz = (zsize==0)?0:newz + (2 * this->border);
+}
 
+//
+// resize image if necessary. Returns pointer to temporary
+// buffer if that happens, and the new size in xsize, ysize.
+//
+void
+SoGLImageP::resizeImage(SoState * state, unsigned char *& imageptr,
+                        uint32_t & xsize, uint32_t & ysize, uint32_t & zsize)
+{
+  SbVec3s size;
+  int numcomponents;
+  unsigned char *bytes = this->image->getValue(size, numcomponents);
+
+  uint32_t newx = xsize;
+  uint32_t newy = ysize;
+  uint32_t newz = zsize;
+  this->getTextureSize(state, newx, newy, newz);
+
+  const cc_glglue * glw = sogl_glue_instance(state);
   if ((newx != xsize) || (newy != ysize) || (newz != zsize)) {
     // We need to resize.
 
@@ -1529,66 +1707,24 @@ SoGLImageP::resizeImage(SoState * state, unsigned char *& imageptr,
     }
 
     if (!customresizedone) {
-      // simage version 1.1.1 has a pretty high quality resize
-      // function. We prefer to use that to avoid using GLU, since
-      // there are lots of buggy GLU libraries out there.
-      if (zsize == 0) { // 2D image
-        // simage_resize and gluScaleImage can be pretty slow. Use
-        // fast_image_resize() if high quality isn't needed
-        if (SoTextureScaleQualityElement::get(state) < 0.5f) {
-          fast_image_resize(bytes, glimage_tmpimagebuffer,
-                            xsize, ysize, numcomponents,
-                            newx, newy);
-        }
-        else if (simage_wrapper()->available &&
-                 simage_wrapper()->versionMatchesAtLeast(1,1,1) &&
-                 simage_wrapper()->simage_resize) {
-
-          unsigned char *result =
-            simage_wrapper()->simage_resize((unsigned char*) bytes,
-                                            xsize, ysize, numcomponents,
-                                            newx, newy);
-          (void)memcpy(glimage_tmpimagebuffer, result, numbytes);
-          simage_wrapper()->simage_free_image(result);
-        }
-        else if (GLUWrapper()->available) {
-          glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-          glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
-          glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
-          glPixelStorei(GL_PACK_ROW_LENGTH, 0);
-          glPixelStorei(GL_PACK_SKIP_PIXELS, 0);
-          glPixelStorei(GL_PACK_SKIP_ROWS, 0);
-          glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-          glPixelStorei(GL_PACK_ALIGNMENT, 1);
-
-          // FIXME: ignoring the error code. Silly. 20000929 mortene.
-          (void)GLUWrapper()->gluScaleImage(coin_glglue_get_texture_format(glw, numcomponents),
-                                            xsize, ysize,
-                                            GL_UNSIGNED_BYTE, bytes,
-                                            newx, newy, GL_UNSIGNED_BYTE,
-                                            glimage_tmpimagebuffer);
-          glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-          glPixelStorei(GL_PACK_ALIGNMENT, 4);
-        }
-        else { // fall back to the internal low-quality resize function
+      const SbBool highquality = SoTextureScaleQualityElement::get(state) >= 0.5f;
+      if (COIN_TEX2_USE_INTERNAL_RESIZE) {
+        // A box filter is good enough if high quality isn't needed.
+        SbImageResize::resize(bytes, xsize, ysize, zsize, numcomponents,
+                              glimage_tmpimagebuffer, newx, newy, newz,
+                              highquality ? SbImageResize::LANCZOS : SbImageResize::BOX);
+      }
+      // simage_resize and gluScaleImage can be pretty slow. Use
+      // fast_image_resize() if high quality isn't needed
+      else if ((zsize == 0 && !highquality) ||
+               !glimage_external_resize(glw, bytes, xsize, ysize, zsize, numcomponents,
+                                        glimage_tmpimagebuffer, newx, newy, newz)) {
+        if (zsize == 0) {
           fast_image_resize(bytes, glimage_tmpimagebuffer,
                             xsize, ysize, numcomponents,
                             newx, newy);
         }
-      }
-      else { // (zsize > 0) => 3D image
-        if (simage_wrapper()->available &&
-            simage_wrapper()->versionMatchesAtLeast(1,3,0) &&
-            simage_wrapper()->simage_resize3d) {
-          unsigned char *result =
-            simage_wrapper()->simage_resize3d((unsigned char*) bytes,
-                                              xsize, ysize, numcomponents, zsize,
-                                              newx, newy, newz);
-          (void)memcpy(glimage_tmpimagebuffer, result, numbytes);
-          simage_wrapper()->simage_free_image(result);
-        }
         else {
-          // fall back to the internal low-quality resize function
           fast_image_resize3d(bytes, glimage_tmpimagebuffer,
                               xsize, ysize, numcomponents, zsize,
                               newx, newy, newz);
@@ -1629,11 +1765,21 @@ SoGLImageP::createGLDisplayList(SoState *state)
   const cc_glglue * glw = sogl_glue_instance(state);
   SbBool mipmap = this->shouldCreateMipmap();
 
+  // a texture still being uploaded for this context is replaced
+  if (SoGLImageP::numuploads) {
+    this->cancelUploads(SoGLCacheContextElement::get(state));
+  }
+
   if (imageptr) {
-    if (is3D ||
-        (!SoGLDriverDatabase::isSupported(glw, SO_GL_NON_POWER_OF_TWO_TEXTURES) ||
-         (mipmap && (!SoGLDriverDatabase::isSupported(glw, SO_GL_GENERATE_MIPMAP) &&
-                     !SoGLDriverDatabase::isSupported(glw, "GL_SGIS_generate_mipmap"))))) {
+    const SbBool resize = is3D ||
+      (!SoGLDriverDatabase::isSupported(glw, SO_GL_NON_POWER_OF_TWO_TEXTURES) ||
+       (mipmap && (!SoGLDriverDatabase::isSupported(glw, SO_GL_GENERATE_MIPMAP) &&
+                   !SoGLDriverDatabase::isSupported(glw, "GL_SGIS_generate_mipmap"))));
+    if (SoGLImageP::streaming && !is3D) {
+      SoGLDisplayList * dl = this->createStreamedGLDisplayList(state, resize, mipmap);
+      if (dl) return dl;
+    }
+    if (resize) {
       this->resizeImage(state, imageptr, xsize, ysize, zsize);
     }
   }
@@ -1773,6 +1919,7 @@ SoGLImageP::reallyCreateTexture(SoState *state,
   const cc_glglue * glw = sogl_glue_instance(state);
   this->glsize = SbVec3s((short) w, (short) h, (short) d);
   this->glcomp = numComponents;
+  SoProfilerCountersP::count(SoProfilerCounters::TEXTURE_UPLOADS);
 
   SbBool compress =
     (this->flags & SoGLImage::COMPRESSED) &&
@@ -1898,6 +2045,7 @@ SoGLImageP::reallyCreateTexture(SoState *state,
 void
 SoGLImageP::unrefDLists(SoState *state)
 {
+  if (SoGLImageP::numuploads) this->cancelUploads(-1);
   int n = this->dlists.getLength();
   for (int i = 0; i < n; i++) {
     this->dlists[i].dlist->unref(state);
@@ -1960,6 +2108,7 @@ SoGLImageP::unrefOldDL(SoState *state, const uint32_t maxage)
                              "DL killed because of old age: %p",
                              this->owner);
 #endif // debug
+      if (SoGLImageP::numuploads) this->cancelUploads(data.dlist->getContext());
       data.dlist->unref(state);
       this->dlists.removeFast(i);
       n--; // one less in list now
@@ -1984,53 +2133,38 @@ SoGLImageP::shouldCreateMipmap(void)
 }
 
 //
-// Actually apply the texture filters using OpenGL calls.
+// Finds the texture filters to use.
 //
 void
-SoGLImageP::applyFilter(const SbBool ismipmap)
+SoGLImageP::getFilters(const SbBool ismipmap, GLenum & magfilter, GLenum & minfilter)
 {
-  GLenum target;
-
-  // Casting away const
-  const SbVec3s size = this->image ? this->image->getSize() : this->glsize;
-
-  if (size[2] >= 1) target = GL_TEXTURE_3D;
-  else {
-    target = this->flags & SoGLImage::RECTANGLE ?
-      GL_TEXTURE_RECTANGLE_EXT : GL_TEXTURE_2D;
-  }
   if (this->flags & SoGLImage::USE_QUALITY_VALUE) {
     if (this->quality < COIN_TEX2_LINEAR_LIMIT) {
-      glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-      glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      magfilter = GL_NEAREST;
+      minfilter = GL_NEAREST;
     }
     else if ((this->quality < COIN_TEX2_MIPMAP_LIMIT) || !ismipmap) {
-      glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-      glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      magfilter = GL_LINEAR;
+      minfilter = GL_LINEAR;
     }
     else if (this->quality < COIN_TEX2_LINEAR_MIPMAP_LIMIT) {
-      glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-      glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+      magfilter = GL_LINEAR;
+      minfilter = GL_NEAREST_MIPMAP_LINEAR;
     }
     else { // max quality
-      glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-      glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+      magfilter = GL_LINEAR;
+      minfilter = GL_LINEAR_MIPMAP_LINEAR;
     }
   }
   else {
+    magfilter = (this->flags & SoGLImage::LINEAR_MAG_FILTER) ?
+      GL_LINEAR : GL_NEAREST;
     if ((this->flags & SoGLImage::NO_MIPMAP) || !ismipmap) {
-      glTexParameteri(target, GL_TEXTURE_MAG_FILTER,
-                      (this->flags & SoGLImage::LINEAR_MAG_FILTER) ?
-                      GL_LINEAR : GL_NEAREST);
-      glTexParameteri(target, GL_TEXTURE_MIN_FILTER,
-                      (this->flags & SoGLImage::LINEAR_MIN_FILTER) ?
-                      GL_LINEAR : GL_NEAREST);
+      minfilter = (this->flags & SoGLImage::LINEAR_MIN_FILTER) ?
+        GL_LINEAR : GL_NEAREST;
     }
     else {
-      glTexParameteri(target, GL_TEXTURE_MAG_FILTER,
-                      (this->flags & SoGLImage::LINEAR_MAG_FILTER) ?
-                      GL_LINEAR : GL_NEAREST);
-      GLenum minfilter = GL_NEAREST_MIPMAP_NEAREST;
+      minfilter = GL_NEAREST_MIPMAP_NEAREST;
       if (this->flags & SoGLImage::LINEAR_MIPMAP_FILTER) {
         if (this->flags & SoGLImage::LINEAR_MIN_FILTER)
           minfilter = GL_LINEAR_MIPMAP_LINEAR;
@@ -2039,13 +2173,32 @@ SoGLImageP::applyFilter(const SbBool ismipmap)
       }
       else if (this->flags & SoGLImage::LINEAR_MIN_FILTER)
         minfilter = GL_NEAREST_MIPMAP_LINEAR;
-
-      glTexParameteri(target, GL_TEXTURE_MIN_FILTER,
-                      minfilter);
     }
   }
 }
 
+//
+// Actually apply the texture filters using OpenGL calls.
+//
+void
+SoGLImageP::applyFilter(const SbBool ismipmap)
+{
+  GLenum target;
+
+  // Casting away const
+  const SbVec3s size = this->image ? this->image->getSize() : this->glsize;
+
+  if (size[2] >= 1) target = GL_TEXTURE_3D;
+  else {
+    target = this->flags & SoGLImage::RECTANGLE ?
+      GL_TEXTURE_RECTANGLE_EXT : GL_TEXTURE_2D;
+  }
+  GLenum magfilter, minfilter;
+  this->getFilters(ismipmap, magfilter, minfilter);
+  glTexParameteri(target, GL_TEXTURE_MAG_FILTER, magfilter);
+  glTexParameteri(target, GL_TEXTURE_MIN_FILTER, minfilter);
+}
+
 // returns an unique uint32_t id for gl images
 uint32_t
 SoGLImageP::getNextGLImageId(void)
@@ -2078,12 +2231,17 @@ regimage_cleanup(void)
   rendering the scene, typically in the viewer's actualRedraw().
   \a state should be your SoGLRenderAction state.
 
+  This is also where textures are uploaded when texture streaming is
+  enabled. SoGLRenderAction calls this method before rendering.
+
   \sa endFrame(), tagImage(), setDisplayListMaxAge()
 */
 void
-SoGLImage::beginFrame(SoState * /* state */)
+SoGLImage::beginFrame(SoState * state)
 {
-  // nothing is done for now
+  // continue uploading textures that are streamed
+  if (state) SoGLImageP::processUploads(state);
+  SoGLTextureAtlas::beginFrame();
 }
 
 /*!
@@ -2254,6 +2412,657 @@ SoGLImageP::contextCleanup(uint32_t context, void * closure)
 
 // *************************************************************************
 
+//
+// Texture streaming.
+//
+// Large 2D textures are resized and mipmapped by a worker thread, and
+// the levels are then uploaded a few rows at a time in
+// SoGLImage::beginFrame(), within a budget of bytes per frame. The
+// rows go through a pixel buffer object when the driver supports
+// them, so the copy into texture memory can run asynchronously. A
+// small point sampled version of the image is used as the texture
+// until the upload is finished.
+//
+
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif // GL_PIXEL_UNPACK_BUFFER
+
+#define GLIMAGE_PLACEHOLDER_SIZE 32
+
+// Resizes the image and creates the mipmap levels. Runs in the worker
+// thread, and doesn't touch anything but the job itself.
+static void
+glimage_upload_prepare(glimage_upload * job)
+{
+  int w = job->width;
+  int h = job->height;
+  int total = 0;
+  for (;;) {
+    job->offsets.append(total);
+    total += w * h * job->nc;
+    if (!job->mipmap || (w == 1 && h == 1)) break;
+    w = SbMax(w >> 1, 1);
+    h = SbMax(h >> 1, 1);
+  }
+  job->levels = new unsigned char[total];
+
+  if (job->srcwidth == job->width && job->srcheight == job->height) {
+    memcpy(job->levels, job->src, job->width * job->height * job->nc);
+  }
+  else {
+    SbImageResize::resize(job->src, job->srcwidth, job->srcheight, 0, job->nc,
+                          job->levels, job->width, job->height, 0, job->filter);
+  }
+  delete[] job->src;
+  job->src = NULL;
+
+  w = job->width;
+  h = job->height;
+  for (int i = 1; i < job->offsets.getLength(); i++) {
+    SbImageResize::halve(job->levels + job->offsets[i-1], w, h, 0, job->nc,
+                         job->levels + job->offsets[i]);
+    w = SbMax(w >> 1, 1);
+    h = SbMax(h >> 1, 1);
+  }
+}
+
+static void
+glimage_upload_worker(void * closure)
+{
+  glimage_upload * job = (glimage_upload *) closure;
+
+  LOCK_UPLOADS;
+  const SbBool cancelled = job->owner == NULL;
+  UNLOCK_UPLOADS;
+
+  if (!cancelled) glimage_upload_prepare(job);
+
+  LOCK_UPLOADS;
+  job->prepared = TRUE;
+  UNLOCK_UPLOADS;
+}
+
+// Creates the texture object, with storage for all levels.
+static void
+glimage_upload_begin(SoState * state, glimage_upload * job)
+{
+  const cc_glglue * glw = sogl_glue_instance(state);
+  SoGLImageP * owner = job->owner;
+
+  job->dl = new SoGLDisplayList(state, SoGLDisplayList::TEXTURE_OBJECT,
+                                1, job->mipmap);
+  job->dl->ref();
+  SoProfilerCountersP::count(SoProfilerCounters::TEXTURE_UPLOADS);
+  job->dl->setTextureTarget((int) GL_TEXTURE_2D);
+  job->dl->open(state);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
+                  translate_wrap(state, owner->wraps));
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
+                  translate_wrap(state, owner->wrapt));
+  if ((owner->quality > COIN_TEX2_ANISOTROPIC_LIMIT) &&
+      SoGLDriverDatabase::isSupported(glw, SO_GL_ANISOTROPIC_FILTERING)) {
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT,
+                    cc_glglue_get_max_anisotropy(glw));
+  }
+  owner->applyFilter(job->mipmap);
+
+  GLint internalformat = coin_glglue_get_internal_texture_format(glw, job->nc, FALSE);
+  GLenum format = coin_glglue_get_texture_format(glw, job->nc);
+  int w = job->width;
+  int h = job->height;
+  for (int i = 0; i < job->offsets.getLength(); i++) {
+    glTexImage2D(GL_TEXTURE_2D, i, internalformat, w, h, 0,
+                 format, GL_UNSIGNED_BYTE, NULL);
+    w = SbMax(w >> 1, 1);
+    h = SbMax(h >> 1, 1);
+  }
+  job->dl->close(state);
+
+  if (cc_glglue_has_vertex_buffer_object(glw) &&
+      (cc_glglue_glversion_matches_at_least(glw, 2, 1, 0) ||
+       cc_glglue_glext_supported(glw, "GL_ARB_pixel_buffer_object"))) {
+    cc_glglue_glGenBuffers(glw, 1, &job->pbo);
+  }
+}
+
+// Uploads rows of the levels until budget bytes have been uploaded,
+// and returns the number of bytes uploaded.
+static uint32_t
+glimage_upload_rows(SoState * state, glimage_upload * job, const uint32_t budget)
+{
+  const cc_glglue * glw = sogl_glue_instance(state);
+  const GLenum format = coin_glglue_get_texture_format(glw, job->nc);
+  uint32_t bytes = 0;
+
+  job->dl->open(state);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  while (job->level < job->offsets.getLength() && bytes < budget) {
+    const int w = SbMax(job->width >> job->level, 1);
+    const int h = SbMax(job->height >> job->level, 1);
+    const int rowbytes = w * job->nc;
+    int rows = SbMax((int) ((budget - bytes) / rowbytes), 1);
+    rows = SbMin(rows, h - job->row);
+    const int size = rows * rowbytes;
+    const unsigned char * data =
+      job->levels + job->offsets[job->level] + job->row * rowbytes;
+
+    SbBool mapped = FALSE;
+    if (job->pbo) {
+      cc_glglue_glBindBuffer(glw, GL_PIXEL_UNPACK_BUFFER, job->pbo);
+      // allocate new storage, so the driver doesn't have to wait for
+      // the previous rows to be copied before the buffer is mapped
+      cc_glglue_glBufferData(glw, GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+      void * ptr = cc_glglue_glMapBuffer(glw, GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+      if (ptr) {
+        memcpy(ptr, data, size);
+        mapped = cc_glglue_glUnmapBuffer(glw, GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+      }
+      if (!mapped) cc_glglue_glBindBuffer(glw, GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    glTexSubImage2D(GL_TEXTURE_2D, job->level, 0, job->row, w, rows,
+                    format, GL_UNSIGNED_BYTE, mapped ? NULL : data);
+    if (mapped) cc_glglue_glBindBuffer(glw, GL_PIXEL_UNPACK_BUFFER, 0);
+
+    bytes += size;
+    job->row += rows;
+    if (job->row == h) {
+      job->level++;
+      job->row = 0;
+    }
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  job->dl->close(state);
+  return bytes;
+}
+
+// Frees the GL resources of a job. The job's context must be current.
+static void
+glimage_upload_free(SoState * state, glimage_upload * job)
+{
+  if (job->pbo) {
+    cc_glglue_glDeleteBuffers(sogl_glue_instance(state), 1, &job->pbo);
+    job->pbo = 0;
+  }
+  if (job->dl) {
+    job->dl->unref(state);
+    job->dl = NULL;
+  }
+}
+
+//
+// Creates a placeholder texture and queues the image for streaming.
+// Returns NULL if the image should be uploaded in one go.
+//
+SoGLDisplayList *
+SoGLImageP::createStreamedGLDisplayList(SoState * state,
+                                        const SbBool resize,
+                                        const SbBool mipmap)
+{
+  const cc_glglue * glw = sogl_glue_instance(state);
+  if (this->border ||
+      (this->flags & (SoGLImage::RECTANGLE|SoGLImage::COMPRESSED)) ||
+      SoGLImageP::resizecb || !cc_glglue_has_texture_objects(glw)) {
+    return NULL;
+  }
+
+  SbVec3s size;
+  int nc;
+  const unsigned char * bytes = this->image->getValue(size, nc);
+  uint32_t w = size[0];
+  uint32_t h = size[1];
+  uint32_t d = 0;
+  if (resize) this->getTextureSize(state, w, h, d);
+  if (w * h * nc <= SoGLImageP::uploadbudget) return NULL;
+
+  const int pw = SbMin((int) w, GLIMAGE_PLACEHOLDER_SIZE);
+  const int ph = SbMin((int) h, GLIMAGE_PLACEHOLDER_SIZE);
+  unsigned char placeholder[GLIMAGE_PLACEHOLDER_SIZE * GLIMAGE_PLACEHOLDER_SIZE * 4];
+  for (int y = 0; y < ph; y++) {
+    const unsigned char * srcrow = bytes + ((y * size[1]) / ph) * size[0] * nc;
+    for (int x = 0; x < pw; x++) {
+      memcpy(placeholder + (y * pw + x) * nc, srcrow + ((x * size[0]) / pw) * nc, nc);
+    }
+  }
+
+  SoCacheElement::setInvalid(TRUE);
+  if (state->isCacheOpen()) {
+    SoCacheElement::invalidate(state);
+  }
+  SoGLDisplayList * dl = new SoGLDisplayList(state,
+                                             SoGLDisplayList::TEXTURE_OBJECT,
+                                             1, mipmap);
+  dl->ref();
+  dl->setTextureTarget((int) GL_TEXTURE_2D);
+  dl->open(state);
+  this->reallyCreateTexture(state, placeholder, nc, pw, ph, 0, FALSE, mipmap, 0);
+  dl->close(state);
+
+  glimage_upload * job = new glimage_upload;
+  job->owner = this;
+  job->placeholder = dl;
+  job->context = dl->getContext();
+  job->src = new unsigned char[size[0] * size[1] * nc];
+  memcpy(job->src, bytes, size[0] * size[1] * nc);
+  job->srcwidth = size[0];
+  job->srcheight = size[1];
+  job->width = (int) w;
+  job->height = (int) h;
+  job->nc = nc;
+  job->mipmap = mipmap;
+  job->filter = (SoTextureScaleQualityElement::get(state) >= 0.5f) ?
+    SbImageResize::LANCZOS : SbImageResize::BOX;
+
+  LOCK_UPLOADS;
+  if (SoGLImageP::uploads == NULL) {
+    SoGLImageP::uploads = new SbList <glimage_upload *>;
+  }
+  SoGLImageP::uploads->append(job);
+  SoGLImageP::numuploads++;
+  UNLOCK_UPLOADS;
+
+  if (SoGLImageP::uploadsched) {
+    cc_sched_schedule(SoGLImageP::uploadsched, glimage_upload_worker, job, 0);
+  }
+  return dl;
+}
+
+// Returns TRUE if dl is a placeholder for a texture being uploaded.
+SbBool
+SoGLImageP::isUploading(const SoGLDisplayList * dl)
+{
+  SbBool found = FALSE;
+  LOCK_UPLOADS;
+  for (int i = 0; !found && i < SoGLImageP::uploads->getLength(); i++) {
+    const glimage_upload * job = (*SoGLImageP::uploads)[i];
+    found = (job->owner == this) && (job->placeholder == dl);
+  }
+  UNLOCK_UPLOADS;
+  return found;
+}
+
+// Cancels the uploads for a context, or for all contexts if context
+// is -1. The resources are freed the next time the context is used.
+void
+SoGLImageP::cancelUploads(const int context)
+{
+  LOCK_UPLOADS;
+  for (int i = 0; i < SoGLImageP::uploads->getLength(); i++) {
+    glimage_upload * job = (*SoGLImageP::uploads)[i];
+    if ((job->owner == this) && ((context < 0) || (job->context == context))) {
+      job->owner = NULL;
+      SoGLImageP::numuploads--;
+    }
+  }
+  UNLOCK_UPLOADS;
+}
+
+void
+SoGLImageP::processUploads(SoState * state)
+{
+  SoGLImageP::uploadbytes = 0;
+  if (SoGLImageP::uploads == NULL) return;
+
+  const int context = SoGLCacheContextElement::get(state);
+  uint32_t budget = SoGLImageP::uploadbudget;
+
+  LOCK_GLIMAGE;
+  LOCK_UPLOADS;
+  int i = 0;
+  while (i < SoGLImageP::uploads->getLength()) {
+    glimage_upload * job = (*SoGLImageP::uploads)[i];
+    if (!job->prepared && !SoGLImageP::uploadsched) {
+      // no worker thread, so the levels are made here
+      if (job->owner) glimage_upload_prepare(job);
+      job->prepared = TRUE;
+    }
+    SbBool done = FALSE;
+    if (!job->prepared) {
+      // the worker thread isn't finished with it yet
+    }
+    else if (!job->contextalive) {
+      done = TRUE;
+    }
+    else if (job->context != context) {
+      // wait for the context to be current
+    }
+    else if (job->owner == NULL) {
+      glimage_upload_free(state, job);
+      done = TRUE;
+    }
+    else if (budget > 0) {
+      if (job->dl == NULL) glimage_upload_begin(state, job);
+      const uint32_t bytes = glimage_upload_rows(state, job, budget);
+      SoGLImageP::uploadbytes += bytes;
+      budget = (bytes < budget) ? budget - bytes : 0;
+
+      if (job->level == job->offsets.getLength()) {
+        // replace the placeholder with the finished texture
+        SoGLImageP * owner = job->owner;
+        for (int j = 0; j < owner->dlists.getLength(); j++) {
+          if (owner->dlists[j].dlist == job->placeholder) {
+            owner->dlists[j].dlist = job->dl;
+            owner->glsize = SbVec3s((short) job->width, (short) job->height, 0);
+            owner->glcomp = job->nc;
+            job->placeholder->unref(state);
+            job->dl = NULL;
+            break;
+          }
+        }
+        glimage_upload_free(state, job);
+        SoGLImageP::numuploads--;
+        done = TRUE;
+      }
+    }
+    if (done) {
+      delete job;
+      SoGLImageP::uploads->remove(i);
+    }
+    else i++;
+  }
+  UNLOCK_UPLOADS;
+  UNLOCK_GLIMAGE;
+}
+
+//
+// Callback from SoContextHandler. The GL resources of the uploads in
+// the context are gone with the context.
+//
+void
+SoGLImageP::uploadContextCleanup(uint32_t context, void * COIN_UNUSED_ARG(closure))
+{
+  if (SoGLImageP::uploads == NULL) return;
+
+  LOCK_UPLOADS;
+  for (int i = 0; i < SoGLImageP::uploads->getLength(); i++) {
+    glimage_upload * job = (*SoGLImageP::uploads)[i];
+    if (job->context == (int) context) {
+      if (job->dl) job->dl->unref(NULL);
+      job->dl = NULL;
+      job->pbo = 0;
+      job->contextalive = FALSE;
+      if (job->owner) SoGLImageP::numuploads--;
+      job->owner = NULL;
+    }
+  }
+  UNLOCK_UPLOADS;
+}
+
+/*!
+  Enables or disables texture streaming. When enabled, 2D textures
+  that are larger than the upload budget are resized and mipmapped in
+  a separate thread, and uploaded over several frames, with at most
+  the budget uploaded per frame. A small version of the image is used
+  as the texture until the upload is finished, and
+  SoGLRenderAction will schedule redraws until all the textures of
+  its cache context are uploaded.
+
+  Streaming is disabled by default, since the first frames don't show
+  the full textures. It can also be enabled with the environment
+  variable COIN_TEX2_STREAMING.
+
+  \sa setUploadBudget(), getUploadQueueLength()
+  \since Coin 4.0
+*/
+void
+SoGLImage::setTextureStreaming(const SbBool onoff)
+{
+  SoGLImageP::streaming = onoff;
+}
+
+/*!
+  Returns whether texture streaming is enabled.
+
+  \sa setTextureStreaming()
+  \since Coin 4.0
+*/
+SbBool
+SoGLImage::isTextureStreaming(void)
+{
+  return SoGLImageP::streaming;
+}
+
+/*!
+  Sets the maximum number of bytes of streamed textures to upload per
+  frame. The default is 4 MB, and can also be set with the
+  environment variable COIN_TEX2_UPLOAD_BUDGET.
+
+  \sa setTextureStreaming()
+  \since Coin 4.0
+*/
+void
+SoGLImage::setUploadBudget(const uint32_t bytesperframe)
+{
+  SoGLImageP::uploadbudget = bytesperframe;
+}
+
+/*!
+  Returns the number of bytes of streamed textures uploaded per frame.
+
+  \sa setUploadBudget()
+  \since Coin 4.0
+*/
+uint32_t
+SoGLImage::getUploadBudget(void)
+{
+  return SoGLImageP::uploadbudget;
+}
+
+/*!
+  Returns the number of bytes of streamed textures uploaded in the
+  last call to beginFrame().
+
+  \since Coin 4.0
+*/
+uint32_t
+SoGLImage::getNumUploadBytes(void)
+{
+  return SoGLImageP::uploadbytes;
+}
+
+/*!
+  Returns the number of streamed textures that are not completely
+  uploaded yet.
+
+  \since Coin 4.0
+*/
+int
+SoGLImage::getUploadQueueLength(void)
+{
+  return SoGLImageP::numuploads;
+}
+
+/*!
+  Returns the number of streamed textures that are not completely
+  uploaded yet in the cache context \a contextid.
+
+  \sa SoGLRenderAction::getCacheContext()
+  \since Coin 4.0
+*/
+int
+SoGLImage::getUploadQueueLength(const uint32_t contextid)
+{
+  if (SoGLImageP::numuploads == 0) return 0;
+
+  int num = 0;
+  LOCK_UPLOADS;
+  for (int i = 0; i < SoGLImageP::uploads->getLength(); i++) {
+    const glimage_upload * job = (*SoGLImageP::uploads)[i];
+    if (job->owner && (job->context == (int) contextid)) num++;
+  }
+  UNLOCK_UPLOADS;
+  return num;
+}
+
+/*!
+  Enables or disables texture atlases. When enabled, 2D textures of
+  up to 128x128 pixels are packed into a few large atlas textures,
+  and the texture matrix is used to map texture coordinates into each
+  image's part of the atlas. This saves texture binds when a scene
+  has many small textures, since shapes that use textures in the same
+  atlas don't need to rebind it.
+
+  Only images with the CLAMP or CLAMP_TO_EDGE wrap mode in both
+  directions are stored in atlases, and texture coordinates must be
+  within [0, 1] for the textures to look the same as when they aren't
+  in an atlas, since coordinates outside the image would address the
+  neighbouring images. Only two mipmap levels are made below the base
+  level. Texture atlases are therefore disabled by default. They can
+  also be enabled with the environment variable COIN_TEXTURE_ATLAS.
+
+  \sa getNumAtlasBindsSaved()
+  \since Coin 4.0
+*/
+void
+SoGLImage::setTextureAtlas(const SbBool onoff)
+{
+  SoGLImageP::atlas = onoff;
+}
+
+/*!
+  Returns whether texture atlases are enabled.
+
+  \sa setTextureAtlas()
+  \since Coin 4.0
+*/
+SbBool
+SoGLImage::isTextureAtlas(void)
+{
+  return SoGLImageP::atlas;
+}
+
+/*!
+  Returns the number of texture binds skipped since the last call to
+  beginFrame(), because the atlas texture was already bound.
+
+  \sa setTextureAtlas()
+  \since Coin 4.0
+*/
+uint32_t
+SoGLImage::getNumAtlasBindsSaved(void)
+{
+  return SoGLTextureAtlas::getNumBindsSaved();
+}
+
+// *************************************************************************
+
 #undef PRIVATE
 #undef LOCK_GLIMAGE
 #undef UNLOCK_GLIMAGE
+#undef LOCK_UPLOADS
+#undef UNLOCK_UPLOADS
+
+// *************************************************************************
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/elements/SoGLCacheContextElement.h>
+#include <Inventor/nodes/SoCallback.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTexture2.h>
+#include <Inventor/sensors/SoNodeSensor.h>
+
+// stores the cache context the scene is rendered in
+static void
+glimage_get_context(void * closure, SoAction * action)
+{
+  if (action->isOfType(SoGLRenderAction::getClassTypeId())) {
+    *static_cast<uint32_t *>(closure) =
+      SoGLCacheContextElement::get(action->getState());
+  }
+}
+
+// A streamed texture is uploaded over several frames with at most the
+// budget uploaded per frame, and only the action rendering in the
+// texture's cache context schedules redraws until it is uploaded.
+BOOST_AUTO_TEST_CASE(streamedUploads)
+{
+  const int size = 256;
+  const uint32_t budget = 16 * size * 4;
+
+  const SbBool wasstreaming = SoGLImage::isTextureStreaming();
+  const uint32_t oldbudget = SoGLImage::getUploadBudget();
+  SoGLImage::setTextureStreaming(TRUE);
+  SoGLImage::setUploadBudget(budget);
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoOrthographicCamera * camera = new SoOrthographicCamera;
+  root->addChild(camera);
+  uint32_t context = 0;
+  SoCallback * callback = new SoCallback;
+  callback->setCallback(glimage_get_context, &context);
+  root->addChild(callback);
+  SoTexture2 * texture = new SoTexture2;
+  unsigned char * pixels = new unsigned char[size * size * 4];
+  for (int i = 0; i < size * size * 4; i++) pixels[i] = (unsigned char) i;
+  texture->image.setValue(SbVec2s(size, size), 4, pixels);
+  delete[] pixels;
+  root->addChild(texture);
+  root->addChild(new SoCube);
+  camera->viewAll(root, SbViewportRegion(64, 64));
+
+  SoSeparator * other = new SoSeparator;
+  other->ref();
+  uint32_t othercontext = 0;
+  callback = new SoCallback;
+  callback->setCallback(glimage_get_context, &othercontext);
+  other->addChild(callback);
+  other->addChild(new SoCube);
+
+  SoOffscreenRenderer renderer(SbViewportRegion(64, 64));
+  SoOffscreenRenderer otherrenderer(SbViewportRegion(64, 64));
+  if (!renderer.render(root)) {
+    BOOST_TEST_MESSAGE("no offscreen context, skipping streamedUploads test");
+  }
+  else {
+    BOOST_CHECK_EQUAL(SoGLImage::getUploadQueueLength(), 1);
+    BOOST_CHECK_EQUAL(SoGLImage::getUploadQueueLength(context), 1);
+
+    // the other context has nothing to upload, so it doesn't redraw
+    SoNodeSensor othersensor;
+    othersensor.attach(other);
+    BOOST_CHECK(otherrenderer.render(other));
+    BOOST_REQUIRE(context != othercontext);
+    BOOST_CHECK_EQUAL(SoGLImage::getUploadQueueLength(othercontext), 0);
+    BOOST_CHECK_MESSAGE(!othersensor.isScheduled(),
+                        "Should not redraw a context without uploads");
+
+    SoNodeSensor sensor;
+    sensor.attach(root);
+    uint32_t uploaded = 0;
+    int frames = 0;
+    while ((SoGLImage::getUploadQueueLength(context) > 0) && (frames < 1000)) {
+      BOOST_REQUIRE(renderer.render(root));
+      BOOST_CHECK(SoGLImage::getNumUploadBytes() <= budget);
+      uploaded += SoGLImage::getNumUploadBytes();
+      if (SoGLImage::getUploadQueueLength(context) > 0) {
+        BOOST_CHECK_MESSAGE(sensor.isScheduled(),
+                            "Should redraw while textures are being uploaded");
+      }
+      sensor.unschedule();
+      frames++;
+    }
+    BOOST_CHECK_EQUAL(SoGLImage::getUploadQueueLength(), 0);
+    BOOST_CHECK(uploaded >= (uint32_t) (size * size * 4));
+    BOOST_CHECK_MESSAGE(frames > 1, "Should upload over several frames");
+
+    BOOST_REQUIRE(renderer.render(root));
+    BOOST_CHECK_EQUAL(SoGLImage::getNumUploadBytes(), 0u);
+    BOOST_CHECK_MESSAGE(!sensor.isScheduled(),
+                        "Should stop redrawing when the uploads are done");
+  }
+
+  other->unref();
+  root->unref();
+  SoGLImage::setUploadBudget(oldbudget);
+  SoGLImage::setTextureStreaming(wasstreaming);
+}
+
+#endif // COIN_TEST_SUITE
@@ -0,0 +1,677 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+// Texture atlases for small SoGLImage textures. See
+// SoGLTextureAtlas.h.
+//
+// Each atlas is packed with shelves: rows of cells of about the same
+// height, filled left to right. Cells of deleted images are reused
+// by images of the same size, and an atlas is repacked from scratch
+// when it becomes empty. Cells are aligned to multiples of four
+// pixels, so that they stay aligned in the two mipmap levels below
+// the base level.
+
+#include "rendering/SoGLTextureAtlas.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+
+#include <Inventor/SbMatrix.h>
+#include <Inventor/C/glue/gl.h>
+#include <Inventor/elements/SoGLCacheContextElement.h>
+#include <Inventor/elements/SoGLDisplayList.h>
+#include <Inventor/elements/SoCacheElement.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/misc/SoContextHandler.h>
+#include <Inventor/misc/SoGLImage.h>
+#include <Inventor/misc/SoState.h>
+#include <Inventor/system/gl.h>
+
+#ifdef COIN_THREADSAFE
+#include <Inventor/threads/SbMutex.h>
+#endif // COIN_THREADSAFE
+
+#include "base/SbImageResize.h"
+#include "coindefs.h"
+#include "glue/glp.h"
+#include "misc/SbFlatHash.h"
+#include "rendering/SoGL.h"
+
+// *************************************************************************
+
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif // GL_TEXTURE_MAX_LEVEL
+
+#define ATLAS_SIZE 1024
+#define ATLAS_GUTTER SoGLTextureAtlasPacker::GUTTER
+#define ATLAS_NUM_LEVELS 3
+// shelves are reused for cells up to this many pixels lower
+#define ATLAS_SHELF_SLACK 16
+
+inline unsigned int SbHashFunc(const SoGLImage * key)
+{
+  return SbHashFunc(reinterpret_cast<size_t>(key));
+}
+
+#ifdef COIN_THREADSAFE
+static SbMutex * atlas_mutex = NULL;
+#define LOCK_ATLAS if (atlas_mutex) atlas_mutex->lock()
+#define UNLOCK_ATLAS if (atlas_mutex) atlas_mutex->unlock()
+#else // COIN_THREADSAFE
+#define LOCK_ATLAS
+#define UNLOCK_ATLAS
+#endif // !COIN_THREADSAFE
+
+class atlas_page {
+public:
+  atlas_page(const int size) : packer(size) { }
+  uint32_t context;
+  int nc, magfilter, minfilter, numlevels;
+  GLenum format;
+  SoGLDisplayList * dl;
+  SoGLTextureAtlasPacker packer;
+};
+
+class atlas_cell {
+public:
+  atlas_page * page;
+  SoGLTextureAtlasPacker::Cell rect; // including the gutter
+  uint32_t imageid;
+  int width, height;
+  SbMatrix transform;
+  atlas_cell * next; // the same image in other contexts
+};
+
+typedef SbFlatHash<const SoGLImage *, atlas_cell *> atlas_cell_map;
+typedef SbFlatHash<uint32_t, SbMatrix> atlas_unit_map;
+
+static SbList <atlas_page *> * atlas_pages = NULL;
+static atlas_cell_map * atlas_cells = NULL;
+// the atlas transforms of the textures bound to each texture unit,
+// keyed on context and unit
+static atlas_unit_map * atlas_units = NULL;
+static SbBool atlas_inuse = FALSE;
+static uint32_t atlas_numbindssaved = 0;
+
+static uint32_t
+atlas_unit_key(const uint32_t context, const int unit)
+{
+  return (context << 5) | uint32_t(unit & 31);
+}
+
+static int
+atlas_clamp(const int v, const int size)
+{
+  return (v < 0) ? 0 : ((v >= size) ? size - 1 : v);
+}
+
+// Unlinks a cell from the list of cells of its image, and gives its
+// space back to the atlas.
+static void
+atlas_free_cell(const SoGLImage * image, atlas_cell * cell)
+{
+  atlas_cell * head = NULL;
+  (void) atlas_cells->get(image, head);
+  if (head == cell) {
+    if (cell->next) atlas_cells->put(image, cell->next);
+    else atlas_cells->erase(image);
+  }
+  else {
+    atlas_cell * prev = head;
+    while (prev && prev->next != cell) prev = prev->next;
+    assert(prev);
+    if (prev) prev->next = cell->next;
+  }
+
+  cell->page->packer.remove(cell->rect);
+  delete cell;
+}
+
+static atlas_page *
+atlas_create_page(SoState * state, const uint32_t context, const int nc,
+                  const int magfilter, const int minfilter)
+{
+  const cc_glglue * glw = sogl_glue_instance(state);
+  GLint maxsize = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxsize);
+
+  atlas_page * page = new atlas_page(SbMin(int(maxsize), ATLAS_SIZE));
+  page->context = context;
+  page->nc = nc;
+  page->magfilter = magfilter;
+  page->minfilter = minfilter;
+  page->numlevels = (minfilter == GL_NEAREST || minfilter == GL_LINEAR) ? 1 : ATLAS_NUM_LEVELS;
+  page->format = coin_glglue_get_texture_format(glw, nc);
+  page->dl = new SoGLDisplayList(state, SoGLDisplayList::TEXTURE_OBJECT, 1,
+                                 page->numlevels > 1);
+  page->dl->ref();
+  page->dl->setTextureTarget((int) GL_TEXTURE_2D);
+
+  page->dl->open(state);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magfilter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minfilter);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, page->numlevels - 1);
+  const GLint internalformat = coin_glglue_get_internal_texture_format(glw, nc, FALSE);
+  for (int level = 0; level < page->numlevels; level++) {
+    glTexImage2D(GL_TEXTURE_2D, level, internalformat,
+                 page->packer.getSize() >> level,
+                 page->packer.getSize() >> level, 0,
+                 page->format, GL_UNSIGNED_BYTE, NULL);
+  }
+  page->dl->close(state);
+  atlas_pages->append(page);
+  return page;
+}
+
+// Copies the image into its cell, with the gutter, and makes the
+// mipmap levels of the cell.
+static void
+atlas_upload(SoState * state, atlas_cell * cell, const unsigned char * bytes)
+{
+  const atlas_page * page = cell->page;
+  const int nc = page->nc;
+  const int w = cell->rect.w;
+  const int h = cell->rect.h;
+  unsigned char * buf = new unsigned char[w * h * nc];
+  unsigned char * dst = buf;
+  for (int y = 0; y < h; y++) {
+    const int sy = atlas_clamp(y - ATLAS_GUTTER, cell->height);
+    const unsigned char * row = bytes + sy * cell->width * nc;
+    for (int x = 0; x < w; x++) {
+      const int sx = atlas_clamp(x - ATLAS_GUTTER, cell->width);
+      for (int c = 0; c < nc; c++) *dst++ = row[sx * nc + c];
+    }
+  }
+
+  page->dl->open(state);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (int level = 0; level < page->numlevels; level++) {
+    if (level > 0) {
+      SbImageResize::halve(buf, w >> (level - 1), h >> (level - 1), 0, nc, buf);
+    }
+    glTexSubImage2D(GL_TEXTURE_2D, level,
+                    cell->rect.x >> level, cell->rect.y >> level,
+                    w >> level, h >> level,
+                    page->format, GL_UNSIGNED_BYTE, buf);
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  page->dl->close(state);
+  delete[] buf;
+
+  // the texture is changed outside any render cache
+  SoCacheElement::setInvalid(TRUE);
+  if (state->isCacheOpen()) {
+    SoCacheElement::invalidate(state);
+  }
+}
+
+static atlas_cell *
+atlas_create_cell(SoState * state, const uint32_t context,
+                  const int width, const int height, const int nc,
+                  const int magfilter, const int minfilter)
+{
+  SoGLTextureAtlasPacker::Cell rect;
+  atlas_page * page = NULL;
+  for (int i = 0; i < atlas_pages->getLength(); i++) {
+    atlas_page * p = (*atlas_pages)[i];
+    if (p->context == context && p->nc == nc && p->magfilter == magfilter &&
+        p->minfilter == minfilter && p->packer.add(width, height, rect)) {
+      page = p;
+      break;
+    }
+  }
+  if (page == NULL) {
+    page = atlas_create_page(state, context, nc, magfilter, minfilter);
+    if (!page->packer.add(width, height, rect)) return NULL;
+  }
+
+  atlas_cell * cell = new atlas_cell;
+  cell->page = page;
+  cell->rect = rect;
+  cell->imageid = 0;
+  cell->width = width;
+  cell->height = height;
+  cell->next = NULL;
+
+  const float size = float(page->packer.getSize());
+  cell->transform = SbMatrix::identity();
+  cell->transform[0][0] = float(width) / size;
+  cell->transform[1][1] = float(height) / size;
+  cell->transform[3][0] = float(rect.x + ATLAS_GUTTER) / size;
+  cell->transform[3][1] = float(rect.y + ATLAS_GUTTER) / size;
+  return cell;
+}
+
+// Callback from SoContextHandler. The atlas textures are deleted with
+// the context.
+static void
+atlas_context_cleanup(uint32_t context, void * COIN_UNUSED_ARG(closure))
+{
+  LOCK_ATLAS;
+  if (atlas_pages) {
+    SbList <const SoGLImage *> images;
+    for (atlas_cell_map::const_iterator it = atlas_cells->const_begin();
+         it != atlas_cells->const_end(); ++it) {
+      images.append(it->key);
+    }
+    for (int i = 0; i < images.getLength(); i++) {
+      atlas_cell * cell = NULL;
+      (void) atlas_cells->get(images[i], cell);
+      while (cell) {
+        atlas_cell * next = cell->next;
+        if (cell->page->context == context) atlas_free_cell(images[i], cell);
+        cell = next;
+      }
+    }
+    int i = 0;
+    while (i < atlas_pages->getLength()) {
+      atlas_page * page = (*atlas_pages)[i];
+      if (page->context == context) {
+        page->dl->unref(NULL);
+        delete page;
+        atlas_pages->removeFast(i);
+      }
+      else i++;
+    }
+    for (int unit = 0; unit < 32; unit++) {
+      atlas_units->erase(atlas_unit_key(context, unit));
+    }
+  }
+  UNLOCK_ATLAS;
+}
+
+// *************************************************************************
+
+SoGLTextureAtlasPacker::SoGLTextureAtlasPacker(const int sizearg)
+  : size(sizearg), shelftop(0), numcells(0)
+{
+}
+
+SbBool
+SoGLTextureAtlasPacker::add(const int width, const int height, Cell & cell)
+{
+  if (width > SoGLTextureAtlas::MAX_IMAGE_SIZE ||
+      height > SoGLTextureAtlas::MAX_IMAGE_SIZE) {
+    return FALSE;
+  }
+  // round up to keep the cells aligned in the mipmap levels
+  const int w = (width + 2 * GUTTER + 3) & ~3;
+  const int h = (height + 2 * GUTTER + 3) & ~3;
+
+  int i;
+  for (i = 0; i < this->freecells.getLength(); i++) {
+    if (this->freecells[i].w == w && this->freecells[i].h == h) {
+      cell = this->freecells[i];
+      this->freecells.removeFast(i);
+      this->numcells++;
+      return TRUE;
+    }
+  }
+  for (i = 0; i < this->shelves.getLength(); i++) {
+    Shelf & shelf = this->shelves[i];
+    if (h <= shelf.height && shelf.height - h <= ATLAS_SHELF_SLACK &&
+        shelf.x + w <= this->size) {
+      cell.x = shelf.x;
+      cell.y = shelf.y;
+      cell.w = w;
+      cell.h = h;
+      shelf.x += w;
+      this->numcells++;
+      return TRUE;
+    }
+  }
+  if (this->shelftop + h <= this->size && w <= this->size) {
+    Shelf shelf;
+    shelf.y = this->shelftop;
+    shelf.height = h;
+    shelf.x = w;
+    this->shelves.append(shelf);
+    this->shelftop += h;
+    cell.x = 0;
+    cell.y = shelf.y;
+    cell.w = w;
+    cell.h = h;
+    this->numcells++;
+    return TRUE;
+  }
+  return FALSE;
+}
+
+void
+SoGLTextureAtlasPacker::remove(const Cell & cell)
+{
+  assert(this->numcells > 0);
+  if (--this->numcells == 0) {
+    this->shelves.truncate(0);
+    this->freecells.truncate(0);
+    this->shelftop = 0;
+  }
+  else this->freecells.append(cell);
+}
+
+// *************************************************************************
+
+void
+SoGLTextureAtlas::initClass(void)
+{
+#ifdef COIN_THREADSAFE
+  atlas_mutex = new SbMutex;
+#endif // COIN_THREADSAFE
+  atlas_pages = new SbList <atlas_page *>;
+  atlas_cells = new atlas_cell_map;
+  atlas_units = new atlas_unit_map;
+  SoContextHandler::addContextDestructionCallback(atlas_context_cleanup, NULL);
+}
+
+void
+SoGLTextureAtlas::cleanupClass(void)
+{
+  SoContextHandler::removeContextDestructionCallback(atlas_context_cleanup, NULL);
+  // the contexts are gone, so just free the memory
+  for (atlas_cell_map::const_iterator it = atlas_cells->const_begin();
+       it != atlas_cells->const_end(); ++it) {
+    atlas_cell * cell = it->obj;
+    while (cell) {
+      atlas_cell * next = cell->next;
+      delete cell;
+      cell = next;
+    }
+  }
+  for (int i = 0; i < atlas_pages->getLength(); i++) {
+    delete (*atlas_pages)[i];
+  }
+  delete atlas_pages;
+  atlas_pages = NULL;
+  delete atlas_cells;
+  atlas_cells = NULL;
+  delete atlas_units;
+  atlas_units = NULL;
+  atlas_inuse = FALSE;
+  atlas_numbindssaved = 0;
+#ifdef COIN_THREADSAFE
+  delete atlas_mutex;
+  atlas_mutex = NULL;
+#endif // COIN_THREADSAFE
+}
+
+SoGLDisplayList *
+SoGLTextureAtlas::find(SoState * state, const SoGLImage * image,
+                       const uint32_t imageid,
+                       const unsigned char * bytes,
+                       const int width, const int height, const int nc,
+                       const int magfilter, const int minfilter,
+                       SbMatrix & transform)
+{
+  if (atlas_pages == NULL) return NULL;
+  const uint32_t context = SoGLCacheContextElement::get(state);
+  SoGLDisplayList * dl = NULL;
+
+  LOCK_ATLAS;
+  atlas_cell * cell = NULL;
+  (void) atlas_cells->get(image, cell);
+  while (cell && cell->page->context != context) cell = cell->next;
+
+  if (cell) {
+    const atlas_page * page = cell->page;
+    if (page->nc != nc || page->magfilter != magfilter ||
+        page->minfilter != minfilter ||
+        cell->width != width || cell->height != height) {
+      atlas_free_cell(image, cell);
+      cell = NULL;
+    }
+    else if (cell->imageid != imageid) {
+      cell->imageid = imageid;
+      atlas_upload(state, cell, bytes);
+    }
+  }
+  if (cell == NULL) {
+    cell = atlas_create_cell(state, context, width, height, nc, magfilter, minfilter);
+    if (cell) {
+      cell->imageid = imageid;
+      atlas_upload(state, cell, bytes);
+      atlas_cell * head = NULL;
+      (void) atlas_cells->get(image, head);
+      cell->next = head;
+      atlas_cells->put(image, cell);
+      atlas_inuse = TRUE;
+    }
+  }
+  if (cell) {
+    transform = cell->transform;
+    dl = cell->page->dl;
+  }
+  UNLOCK_ATLAS;
+  return dl;
+}
+
+void
+SoGLTextureAtlas::remove(const SoGLImage * image)
+{
+  LOCK_ATLAS;
+  if (atlas_cells) {
+    atlas_cell * cell = NULL;
+    (void) atlas_cells->get(image, cell);
+    while (cell) {
+      atlas_cell * next = cell->next;
+      atlas_free_cell(image, cell);
+      cell = next;
+    }
+  }
+  UNLOCK_ATLAS;
+}
+
+SbBool
+SoGLTextureAtlas::isInUse(void)
+{
+  return atlas_inuse;
+}
+
+void
+SoGLTextureAtlas::bind(SoState * state, SoGLDisplayList * dl)
+{
+  // the binding can't be checked while a display list is recorded
+  if (!state->isCacheOpen()) {
+    GLint bound = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+    if (bound != 0 && (unsigned int) bound == dl->getFirstIndex()) {
+      atlas_numbindssaved++;
+      return;
+    }
+  }
+  dl->call(state);
+}
+
+void
+SoGLTextureAtlas::loadTextureMatrix(const uint32_t context, const int unit,
+                                    const SbMatrix & matrix,
+                                    const SbMatrix * transform)
+{
+  glMatrixMode(GL_TEXTURE);
+  if (transform) {
+    SbMatrix m = matrix;
+    m.multRight(*transform);
+    glLoadMatrixf(m[0]);
+  }
+  else {
+    glLoadMatrixf(matrix[0]);
+  }
+  glMatrixMode(GL_MODELVIEW);
+
+  LOCK_ATLAS;
+  if (atlas_units) {
+    if (transform) atlas_units->put(atlas_unit_key(context, unit), *transform);
+    else atlas_units->erase(atlas_unit_key(context, unit));
+  }
+  UNLOCK_ATLAS;
+}
+
+SbBool
+SoGLTextureAtlas::getUnitTransform(const uint32_t context, const int unit,
+                                   SbMatrix & transform)
+{
+  if (!atlas_inuse) return FALSE;
+  LOCK_ATLAS;
+  const SbBool found = atlas_units &&
+    atlas_units->get(atlas_unit_key(context, unit), transform);
+  UNLOCK_ATLAS;
+  return found;
+}
+
+void
+SoGLTextureAtlas::beginFrame(void)
+{
+  atlas_numbindssaved = 0;
+}
+
+uint32_t
+SoGLTextureAtlas::getNumBindsSaved(void)
+{
+  return atlas_numbindssaved;
+}
+
+#undef LOCK_ATLAS
+#undef UNLOCK_ATLAS
+#undef ATLAS_SIZE
+#undef ATLAS_GUTTER
+#undef ATLAS_NUM_LEVELS
+#undef ATLAS_SHELF_SLACK
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SbVec2s.h>
+#include "rendering/SoGLTextureAtlas.h"
+
+namespace {
+
+SbBool
+atlas_overlaps(const SoGLTextureAtlasPacker::Cell & a,
+               const SoGLTextureAtlasPacker::Cell & b)
+{
+  return a.x < b.x + b.w && b.x < a.x + a.w &&
+    a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(packWithoutOverlap)
+{
+  SoGLTextureAtlasPacker packer(1024);
+  SbList <SoGLTextureAtlasPacker::Cell> cells;
+  SbList <SbVec2s> sizes;
+  for (int i = 0; i < 200; i++) {
+    const int width = 1 + (i * 37) % 128;
+    const int height = 1 + (i * 61) % 128;
+    SoGLTextureAtlasPacker::Cell cell;
+    if (packer.add(width, height, cell)) {
+      cells.append(cell);
+      sizes.append(SbVec2s(short(width), short(height)));
+    }
+  }
+  BOOST_CHECK_EQUAL(packer.getNumCells(), cells.getLength());
+  BOOST_CHECK_MESSAGE(cells.getLength() > 50,
+                      "only " << cells.getLength() << " images fit");
+
+  int numoverlaps = 0;
+  for (int i = 0; i < cells.getLength(); i++) {
+    const SoGLTextureAtlasPacker::Cell & cell = cells[i];
+    BOOST_CHECK_MESSAGE(cell.x >= 0 && cell.y >= 0 &&
+                        cell.x + cell.w <= 1024 && cell.y + cell.h <= 1024,
+                        "cell " << i << " is outside the atlas");
+    BOOST_CHECK_MESSAGE(cell.w >= sizes[i][0] + 2 * SoGLTextureAtlasPacker::GUTTER &&
+                        cell.h >= sizes[i][1] + 2 * SoGLTextureAtlasPacker::GUTTER,
+                        "cell " << i << " has no room for the gutter");
+    BOOST_CHECK_MESSAGE(((cell.x | cell.y | cell.w | cell.h) & 3) == 0,
+                        "cell " << i << " is not aligned for the mipmap levels");
+    for (int j = 0; j < i; j++) {
+      if (atlas_overlaps(cell, cells[j])) numoverlaps++;
+    }
+  }
+  BOOST_CHECK_MESSAGE(numoverlaps == 0, numoverlaps << " pairs of cells overlap");
+}
+
+// 24x24 images take 32x32 cells with the gutter, so 64 of them fill a
+// 256x256 atlas
+BOOST_AUTO_TEST_CASE(fullAtlas)
+{
+  SoGLTextureAtlasPacker packer(256);
+  SoGLTextureAtlasPacker::Cell cells[64], cell;
+  for (int i = 0; i < 64; i++) {
+    BOOST_REQUIRE_MESSAGE(packer.add(24, 24, cells[i]),
+                          "image " << i << " didn't fit");
+  }
+  BOOST_CHECK(!packer.add(24, 24, cell));
+  BOOST_CHECK(!packer.add(1, 1, cell));
+  BOOST_CHECK_EQUAL(packer.getNumCells(), 64);
+
+  // a freed cell is reused by an image of the same size only
+  packer.remove(cells[10]);
+  BOOST_CHECK(!packer.add(8, 8, cell));
+  BOOST_CHECK(packer.add(21, 22, cell));
+  BOOST_CHECK(cell.x == cells[10].x && cell.y == cells[10].y);
+  BOOST_CHECK(!packer.add(24, 24, cell));
+
+  // the atlas is repacked from scratch when it is empty
+  packer.remove(cell);
+  for (int i = 0; i < 64; i++) {
+    if (i != 10) packer.remove(cells[i]);
+  }
+  BOOST_CHECK_EQUAL(packer.getNumCells(), 0);
+  BOOST_CHECK(packer.add(120, 120, cell));
+  BOOST_CHECK(cell.x == 0 && cell.y == 0 && cell.w == 128 && cell.h == 128);
+}
+
+BOOST_AUTO_TEST_CASE(oversizedImages)
+{
+  const int maxsize = SoGLTextureAtlas::MAX_IMAGE_SIZE;
+  SoGLTextureAtlasPacker packer(1024);
+  SoGLTextureAtlasPacker::Cell cell;
+  BOOST_CHECK(!packer.add(maxsize + 1, 1, cell));
+  BOOST_CHECK(!packer.add(1, maxsize + 1, cell));
+  BOOST_CHECK_EQUAL(packer.getNumCells(), 0);
+  BOOST_CHECK(packer.add(maxsize, maxsize, cell));
+  BOOST_CHECK_EQUAL(packer.getNumCells(), 1);
+
+  // images that can be in an atlas, but not one this small
+  SoGLTextureAtlasPacker small(64);
+  BOOST_CHECK(!small.add(60, 10, cell));
+  BOOST_CHECK(small.add(56, 10, cell));
+}
+
+#endif // COIN_TEST_SUITE
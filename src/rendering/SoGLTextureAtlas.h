@@ -0,0 +1,153 @@
+#ifndef COIN_SOGLTEXTUREATLAS_H
+#define COIN_SOGLTEXTUREATLAS_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+// *************************************************************************
+
+#include <Inventor/SbBasic.h>
+#include <Inventor/lists/SbList.h>
+
+class SbMatrix;
+class SoGLDisplayList;
+class SoGLImage;
+class SoState;
+
+// Packs small 2D textures into shared atlas textures, so that shapes
+// using different textures can be rendered without rebinding. Each
+// image is stored in a cell of an atlas in each context it is used
+// in, with a gutter around it that repeats the edge pixels, so that
+// filtering doesn't pick up the neighbouring cells. Texture
+// coordinates are mapped into the cell through the texture matrix,
+// which means they must be within [0, 1] for the texture to look the
+// same as when it is not in an atlas, and only clamped textures can
+// be stored in atlases.
+//
+// Atlases are created per context, and per number of components and
+// texture filters, and have at most two mipmap levels below the base
+// level.
+class SoGLTextureAtlas {
+public:
+  enum {
+    // the largest width and height of images stored in atlases
+    MAX_IMAGE_SIZE = 128
+  };
+
+  // Returns the atlas texture image is stored in for the current
+  // context, adding or updating it when needed, and sets transform
+  // to the matrix that maps texture coordinates into its cell.
+  // Returns NULL if the image doesn't fit in an atlas.
+  static SoGLDisplayList * find(SoState * state, const SoGLImage * image,
+                                const uint32_t imageid,
+                                const unsigned char * bytes,
+                                const int width, const int height, const int nc,
+                                const int magfilter, const int minfilter,
+                                SbMatrix & transform);
+
+  // Frees the cells of an image that is deleted.
+  static void remove(const SoGLImage * image);
+
+  // Returns TRUE if any image has been stored in an atlas.
+  static SbBool isInUse(void);
+
+  // Binds the atlas texture, unless it is already bound to the
+  // active texture unit.
+  static void bind(SoState * state, SoGLDisplayList * dl);
+
+  // Loads matrix into the GL texture matrix of the active texture
+  // unit, multiplied by the atlas transform if the texture of the
+  // unit is in an atlas (transform != NULL). The atlas transform is
+  // remembered, so that getUnitTransform() can be used when the
+  // texture matrix changes.
+  static void loadTextureMatrix(const uint32_t context, const int unit,
+                                const SbMatrix & matrix,
+                                const SbMatrix * transform);
+  static SbBool getUnitTransform(const uint32_t context, const int unit,
+                                 SbMatrix & transform);
+
+  static void beginFrame(void);
+  static uint32_t getNumBindsSaved(void);
+
+  static void initClass(void);
+  static void cleanupClass(void);
+};
+
+// Places the cells of the images in one atlas of size x size pixels.
+// A cell holds an image and the gutter around it, rounded up to a
+// multiple of four pixels. Doesn't touch OpenGL.
+class SoGLTextureAtlasPacker {
+public:
+  enum {
+    // the width of the gutter around each image
+    GUTTER = 4
+  };
+
+  class Cell {
+  public:
+    int x, y, w, h;
+  };
+
+  SoGLTextureAtlasPacker(const int size);
+
+  // Finds room for an image of width x height pixels. Returns FALSE if
+  // the image is larger than SoGLTextureAtlas::MAX_IMAGE_SIZE, or
+  // there is no room left for it.
+  SbBool add(const int width, const int height, Cell & cell);
+  // Gives the space of a cell back, to be reused by cells of the same
+  // size. The atlas is repacked from scratch when it becomes empty.
+  void remove(const Cell & cell);
+
+  int getSize(void) const { return this->size; }
+  int getNumCells(void) const { return this->numcells; }
+
+private:
+  class Shelf {
+  public:
+    int y, height;
+    int x; // where the next cell goes
+  };
+
+  int size;
+  SbList <Shelf> shelves;
+  SbList <Cell> freecells;
+  int shelftop; // where the next shelf goes
+  int numcells;
+};
+
+// *************************************************************************
+
+#endif // !COIN_SOGLTEXTUREATLAS_H
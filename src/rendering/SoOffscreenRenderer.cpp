@@ -138,6 +138,17 @@
   destructing a new instance e.g. for each frame when generating
   pictures for video.
 
+  Images larger than the largest offscreen OpenGL context the system
+  can provide are rendered as a set of tiles. For very large images,
+  renderToRGB() writes the tiles straight to a file instead of keeping
+  the full image in memory, and setNumRenderThreads() makes the tiles
+  render in parallel, with one offscreen context per thread.
+
+  When writing many frames to files, scheduleWriteToRGB(),
+  scheduleWriteToPostScript() and scheduleWriteToFile() write the
+  files in background threads, so the next frame can be rendered while
+  the previous ones are written.
+
   Offscreen rendering is internally done through either a GLX
   offscreen context (i.e. OpenGL on X11), WGL (i.e. OpenGL on
   Win32), AGL (old-style OpenGL on the Mac OS X) or CGL (new-style Mac OS X).
@@ -316,6 +327,7 @@
 #include <cstring> // memset(), memcpy()
 #include <cmath> // for ceil()
 #include <climits> // SHRT_MAX
+#include <cstdarg>
 
 #include <Inventor/C/glue/gl.h>
 #include <Inventor/C/tidbits.h>
@@ -337,9 +349,18 @@
 #include <Inventor/nodes/SoCallback.h>
 #include <Inventor/nodes/SoCamera.h>
 #include <Inventor/nodes/SoNode.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/lists/SoNodeList.h>
 #include <Inventor/system/gl.h>
 #include <Inventor/SbTime.h>
 
+#ifdef HAVE_THREADS
+#include <Inventor/C/threads/condvar.h>
+#include <Inventor/C/threads/mutex.h>
+#include <Inventor/C/threads/sched.h>
+#include <Inventor/C/threads/thread.h>
+#endif // HAVE_THREADS
+
 #include "glue/simage_wrapper.h"
 #include "tidbitsp.h"
 #include "coindefs.h" // COIN_STUB()
@@ -374,6 +395,85 @@
 
 // *************************************************************************
 
+class SoOffscreenRendererP;
+
+// The state for rendering tiles with one GL context. Tiled rendering
+// uses one worker per render thread. The first worker renders with
+// the SoOffscreenRenderer's own GL canvas and render action, the
+// others have their own, which are kept between renderings so their
+// GL resources and caches can be reused.
+class SoOffscreenTileWorker {
+public:
+  SoOffscreenTileWorker(SoOffscreenRendererP * ownerarg,
+                        CoinOffscreenGLCanvas * canvas,
+                        SoGLRenderAction * action,
+                        SbBool ownsresources);
+  ~SoOffscreenTileWorker();
+
+  enum Buffer { READBUFFER, PLANEBUFFER };
+  unsigned char * getBuffer(const Buffer which, const size_t size);
+
+  SoOffscreenRendererP * owner;
+  CoinOffscreenGLCanvas * glcanvas;
+  SoGLRenderAction * renderaction;
+  SbBool ownsresources;
+  // FALSE if the GL context couldn't be set up for this rendering
+  SbBool active;
+
+  // The subscreen size of the current tile. (Less than max if it is a
+  // right- or bottom-border tile.)
+  unsigned int subsize[2];
+  // Keeps track of the current tile to be rendered.
+  SbVec2s currenttile;
+
+  SbBool lastnodewasacamera;
+  SoCamera * visitedcamera;
+
+private:
+  unsigned char * buffers[2];
+  size_t buffersizes[2];
+};
+
+// An image file write scheduled with one of the
+// SoOffscreenRenderer::scheduleWriteTo*() methods. The job owns the
+// image buffer until the file has been written.
+class SoOffscreenWriteJob {
+public:
+  enum Format { RGB, POSTSCRIPT, SIMAGE };
+
+  SoOffscreenWriteJob(SoOffscreenRendererP * ownerarg)
+    : owner(ownerarg), compress(FALSE), buffer(NULL), buffersize(0), ok(FALSE) { }
+  SbBool write(void) const;
+
+  SoOffscreenRendererP * owner;
+  Format format;
+  SbString filename;
+  // the file type extension for simage
+  SbString filetype;
+  // the PostScript header, which is made when the job is scheduled
+  SbString header;
+  unsigned int size[2];
+  unsigned int nrcomponents;
+  SbBool compress;
+  unsigned char * buffer;
+  size_t buffersize;
+  SbBool ok;
+};
+
+// One of the threads of SoOffscreenRenderer::renderBatch(). The first
+// worker renders with the SoOffscreenRenderer itself, the others have
+// their own renderers, which are kept between batches so their GL
+// contexts and caches can be reused.
+class SoOffscreenBatchWorker {
+public:
+  SoOffscreenRendererP * owner;
+  SoOffscreenRenderer * renderer;
+  // the camera of the current view, followed by the scene
+  SoSeparator * root;
+};
+
+// *************************************************************************
+
 class SoOffscreenRendererP {
 public:
   SoOffscreenRendererP(SoOffscreenRenderer * masterptr,
@@ -382,12 +482,33 @@ public:
   {
     this->master = masterptr;
     this->didreadbuffer = TRUE;
+    this->canreadbuffer = FALSE;
 
     this->backgroundcolor.setValue(0,0,0);
     this->components = SoOffscreenRenderer::RGB;
     this->buffer = NULL;
     this->bufferbytesize = 0;
-    this->lastnodewasacamera = FALSE;
+    this->outputfile = NULL;
+    this->numrenderthreads = SoOffscreenRendererP::defaultNumRenderThreads();
+    this->rgbcompression = FALSE;
+    this->numwritethreads = SoOffscreenRendererP::defaultNumWriteThreads();
+    this->maxscheduledwrites = 4;
+    this->numscheduledwrites = 0;
+    this->minglsize.setValue(0, 0);
+    this->batchcameras = NULL;
+    this->batchregions = NULL;
+    this->batchcallback = NULL;
+    this->batchuserdata = NULL;
+#ifdef HAVE_THREADS
+    this->batchmutex = cc_mutex_construct();
+    this->contextmutex = NULL;
+    this->tilemutex = cc_mutex_construct();
+    this->traversalmutex = cc_mutex_construct();
+    this->writemutex = cc_mutex_construct();
+    this->writecond = cc_condvar_construct();
+    this->writesched = NULL;
+    this->writesequence = 0;
+#endif // HAVE_THREADS
 	
     if (glrenderaction) {
       this->renderaction = glrenderaction;
@@ -405,6 +526,22 @@ public:
 
   ~SoOffscreenRendererP()
   {
+    for (int j = 0; j < this->batchrenderers.getLength(); j++) {
+      delete this->batchrenderers[j];
+    }
+    (void)this->waitForScheduledWrites();
+    for (int i = 0; i < this->freebuffers.getLength(); i++) {
+      delete[] this->freebuffers[i];
+    }
+    this->deleteWorkers(0);
+#ifdef HAVE_THREADS
+    if (this->writesched) { cc_sched_destruct(this->writesched); }
+    cc_condvar_destruct(this->writecond);
+    cc_mutex_destruct(this->writemutex);
+    cc_mutex_destruct(this->batchmutex);
+    cc_mutex_destruct(this->tilemutex);
+    cc_mutex_destruct(this->traversalmutex);
+#endif // HAVE_THREADS
     if (this->didallocation) { delete this->renderaction; }
   }
 
@@ -412,13 +549,52 @@ public:
 
   static const char * debugTileOutputPrefix(void);
 
+  static int defaultNumRenderThreads(void);
+  static int defaultNumWriteThreads(void);
+
   static SoGLRenderAction::AbortCode GLRenderAbortCallback(void *userData);
   SbBool renderFromBase(SoBase * base);
-
-  void setCameraViewvolForTile(SoCamera * cam);
+  SbBool renderToRGB(SoBase * base, const char * filename);
+  void setupGLContext(void);
+
+  SbBool renderTiles(SoBase * base);
+  void renderTiles(SoOffscreenTileWorker * worker);
+  SbBool nextTile(SoOffscreenTileWorker * worker);
+  void storeTile(SoOffscreenTileWorker * worker,
+                 const SbVec2s & tile, const SbVec2s & size,
+                 const uint8_t * pixels, unsigned int pixelcomponents);
+  void deleteWorkers(const int first);
+#ifdef HAVE_THREADS
+  static void * tileThreadEntry(void * closure);
+#endif // HAVE_THREADS
+
+  void setCameraViewvolForTile(SoOffscreenTileWorker * worker, SoCamera * cam);
 
   static SbBool writeToRGB(FILE * fp, unsigned int w, unsigned int h,
-                           unsigned int nrcomponents, const uint8_t * imgbuf);
+                           unsigned int nrcomponents, const uint8_t * imgbuf,
+                           const SbBool compress);
+  static SbBool writeRGBHeader(FILE * fp, unsigned int w, unsigned int h,
+                               unsigned int nrcomponents, const SbBool compress);
+  static SbString postScriptHeader(const SbVec2s & size, const unsigned int nc,
+                                   const SbVec2f & printsize);
+  static SbBool writePostScriptData(FILE * fp, unsigned int w, unsigned int h,
+                                    unsigned int nc, const uint8_t * src);
+
+  SbBool renderBatch(SoNode * scene, const SoNodeList & cameras,
+                     const SbList <SbViewportRegion> & regions,
+                     SoOffscreenBatchCB * callback, void * userdata);
+  void renderViews(SoOffscreenBatchWorker * worker);
+  int nextView(void);
+#ifdef HAVE_THREADS
+  static void * batchThreadEntry(void * closure);
+#endif // HAVE_THREADS
+
+  SbBool scheduleWrite(SoOffscreenWriteJob * job);
+  void finishWrite(SoOffscreenWriteJob * job);
+  SbBool waitForScheduledWrites(void);
+#ifdef HAVE_THREADS
+  static void writeJobEntry(void * closure);
+#endif // HAVE_THREADS
 
   SbViewportRegion viewport;
   SbColor backgroundcolor;
@@ -436,17 +612,67 @@ public:
   int glcanvassize[2];
 
   int numsubscreens[2];
-  // The subscreen size of the current tile. (Less than max if it is a
-  // right- or bottom-border tile.)
-  unsigned int subsize[2];
-  // Keeps track of the current tile to be rendered.
-  SbVec2s currenttile;
 
-  SbBool lastnodewasacamera;
-  SoCamera * visitedcamera;
+  // Tiled rendering. The tiles are handed out to the workers in
+  // order, and each finished tile is stored in the buffer, or written
+  // straight to outputfile by renderToRGB().
+  int numrenderthreads;
+  SbList <SoOffscreenTileWorker *> workers;
+  SoBase * tilebase;
+  int nexttile;
+  SbBool tilefailed;
+  FILE * outputfile;
+#ifdef HAVE_THREADS
+  // protects the tile queue, the output file and GL context switching
+  cc_mutex * tilemutex;
+  // serializes the scene graph traversals, see renderTiles()
+  cc_mutex * traversalmutex;
+#endif // HAVE_THREADS
+
+  // renderBatch(). The GL canvas is made at least minglsize large, so
+  // it fits all the views of the batch. The views are handed out to
+  // the workers in order.
+  SbVec2s minglsize;
+  SbList <SoOffscreenRenderer *> batchrenderers;
+  const SoNodeList * batchcameras;
+  const SbList <SbViewportRegion> * batchregions;
+  SbViewportRegion batchviewport;
+  SoOffscreenBatchCB * batchcallback;
+  void * batchuserdata;
+  int nextbatchview;
+  int numfailedviews;
+#ifdef HAVE_THREADS
+  // protects the view queue and GL context switching in renderBatch()
+  cc_mutex * batchmutex;
+  // set to the batchmutex of the renderBatch() call while rendering a
+  // batch, so the threads take turns switching GL contexts
+  cc_mutex * contextmutex;
+#endif // HAVE_THREADS
+
+  // Scheduled writes. Each job takes over the image buffer, and the
+  // buffers of finished jobs are kept in freebuffers for reuse by
+  // later renderings. Failed files are reported by
+  // waitForScheduledWrites().
+  SbBool rgbcompression;
+  int numwritethreads;
+  int maxscheduledwrites;
+  int numscheduledwrites;
+  SbList <unsigned char *> freebuffers;
+  SbList <size_t> freebuffersizes;
+  SbList <SbString> failedwrites;
+#ifdef HAVE_THREADS
+  // protects the members above, signals finished jobs
+  cc_mutex * writemutex;
+  cc_condvar * writecond;
+  cc_sched * writesched;
+  uint32_t writesequence;
+#endif // HAVE_THREADS
 
   // used for lazy readPixels()
   SbBool didreadbuffer;
+  // the image is still in the GL context, i.e. it wasn't made by
+  // tiled rendering, so getBuffer() can read it again
+  SbBool canreadbuffer;
 private:
   SoOffscreenRenderer * master;
 };
@@ -454,6 +680,41 @@ private:
 #define PRIVATE(p) (p->pimpl)
 #define PUBLIC(p) (p->master)
 
+#ifdef HAVE_THREADS
+#define LOCK_TILES(p) cc_mutex_lock((p)->tilemutex)
+#define UNLOCK_TILES(p) cc_mutex_unlock((p)->tilemutex)
+#define LOCK_WRITES(p) cc_mutex_lock((p)->writemutex)
+#define UNLOCK_WRITES(p) cc_mutex_unlock((p)->writemutex)
+#define LOCK_BATCH(p) cc_mutex_lock((p)->batchmutex)
+#define UNLOCK_BATCH(p) cc_mutex_unlock((p)->batchmutex)
+#define LOCK_CONTEXT(p) if ((p)->contextmutex) { cc_mutex_lock((p)->contextmutex); }
+#define UNLOCK_CONTEXT(p) if ((p)->contextmutex) { cc_mutex_unlock((p)->contextmutex); }
+#else // HAVE_THREADS
+#define LOCK_TILES(p)
+#define UNLOCK_TILES(p)
+#define LOCK_WRITES(p)
+#define UNLOCK_WRITES(p)
+#define LOCK_BATCH(p)
+#define UNLOCK_BATCH(p)
+#define LOCK_CONTEXT(p)
+#define UNLOCK_CONTEXT(p)
+#endif // !HAVE_THREADS
+
+// Without COIN_THREADSAFE the scene graph can only be traversed by
+// one thread at a time, so the render threads take turns traversing,
+// and only the GL rendering, the readback and the file output of the
+// tiles run in parallel.
+#if defined(HAVE_THREADS) && !defined(COIN_THREADSAFE)
+#define LOCK_TRAVERSAL(p) cc_mutex_lock((p)->traversalmutex)
+#define UNLOCK_TRAVERSAL(p) cc_mutex_unlock((p)->traversalmutex)
+#else // HAVE_THREADS && !COIN_THREADSAFE
+#define LOCK_TRAVERSAL(p)
+#define UNLOCK_TRAVERSAL(p)
+#endif // !HAVE_THREADS || COIN_THREADSAFE
+
+// The size of the SGI RGB file header.
+#define RGB_HEADERSIZE 512
+
 // *************************************************************************
 
 // Set the environment variable below to get the individual tiles
@@ -469,6 +730,27 @@ SoOffscreenRendererP::debugTileOutputPrefix(void)
   return coin_getenv("COIN_DEBUG_SOOFFSCREENRENDERER_TILEPREFIX");
 }
 
+// The number of render threads can be set with the environment
+// variable below, for applications which don't call
+// SoOffscreenRenderer::setNumRenderThreads().
+int
+SoOffscreenRendererP::defaultNumRenderThreads(void)
+{
+  const char * env = coin_getenv("COIN_OFFSCREENRENDERER_NUM_THREADS");
+  const int num = env ? atoi(env) : 1;
+  return (num > 1) ? num : 1;
+}
+
+// The number of threads used for scheduled writes, see
+// SoOffscreenRenderer::setNumWriteThreads().
+int
+SoOffscreenRendererP::defaultNumWriteThreads(void)
+{
+  const char * env = coin_getenv("COIN_OFFSCREENRENDERER_WRITE_THREADS");
+  const int num = env ? atoi(env) : 1;
+  return (num > 1) ? num : 1;
+}
+
 // *************************************************************************
 
 /*!
@@ -662,19 +944,19 @@ pre_render_cb(void * COIN_UNUSED_ARG(userdata), SoGLRenderAction * action)
 SoGLRenderAction::AbortCode
 SoOffscreenRendererP::GLRenderAbortCallback(void *userData)
 {
-  SoOffscreenRendererP * thisp = (SoOffscreenRendererP *) userData;
-  const SoFullPath * path = (const SoFullPath*) thisp->renderaction->getCurPath();
+  SoOffscreenTileWorker * worker = (SoOffscreenTileWorker *) userData;
+  const SoFullPath * path = (const SoFullPath*) worker->renderaction->getCurPath();
   SoNode * node = path->getTail();
   assert(node);
 
-  if (thisp->lastnodewasacamera) {
-    thisp->setCameraViewvolForTile(thisp->visitedcamera);
-    thisp->lastnodewasacamera = FALSE;
+  if (worker->lastnodewasacamera) {
+    worker->owner->setCameraViewvolForTile(worker, worker->visitedcamera);
+    worker->lastnodewasacamera = FALSE;
   }
 
   if (node->isOfType(SoCamera::getClassTypeId())) {
-    thisp->visitedcamera = (SoCamera *) node;
-    thisp->lastnodewasacamera = TRUE;
+    worker->visitedcamera = (SoCamera *) node;
+    worker->lastnodewasacamera = TRUE;
 
     // FIXME: this is not really entirely sufficient. If a camera is
     // already within a cached list upon the first invocation of a
@@ -691,7 +973,7 @@ SoOffscreenRendererP::GLRenderAbortCallback(void *userData)
     // #121 in Coin/BUGS.txt. (The tile number should be in an
     // element, which the SoCamera would query (and thereby also make
     // the cache dependent on)).
-    SoCacheElement::invalidate(thisp->renderaction->getState());
+    SoCacheElement::invalidate(worker->renderaction->getState());
   }
 
   return SoGLRenderAction::CONTINUE;
@@ -713,12 +995,15 @@ SoOffscreenRendererP::renderFromBase(SoBase * base)
   }
 
   const SbVec2s fullsize = this->viewport.getViewportSizePixels();
-  this->glcanvas.setWantedSize(fullsize);
+  this->glcanvas.setWantedSize(SbVec2s(SbMax(fullsize[0], this->minglsize[0]),
+                                       SbMax(fullsize[1], this->minglsize[1])));
 
   // check if no possible canvas size was found
   if (this->glcanvas.getActualSize() == SbVec2s(0, 0)) { return FALSE; }
 
+  LOCK_CONTEXT(this);
   const uint32_t newcontext = this->glcanvas.activateGLContext();
+  UNLOCK_CONTEXT(this);
   if (newcontext == 0) {
     SoDebugError::postWarning("SoOffscreenRenderer::renderFromBase",
                               "Could not set up an offscreen OpenGL context.");
@@ -759,11 +1044,7 @@ SoOffscreenRendererP::renderFromBase(SoBase * base)
                            colbits[0], colbits[1], colbits[2], colbits[3]);
   }
 
-  glEnable(GL_DEPTH_TEST);
-  glClearColor(this->backgroundcolor[0],
-               this->backgroundcolor[1],
-               this->backgroundcolor[2],
-               0.0f);
+  this->setupGLContext();
 
   // Make this large to get best possible quality on any "big-image"
   // textures (from using SoTextureScalePolicy).
@@ -779,7 +1060,8 @@ SoOffscreenRendererP::renderFromBase(SoBase * base)
   // control from the offscreenrenderer.
   const int bigimagechangelimit = SoGLBigImage::setChangeLimit(INT_MAX);
 
-  // Deallocate old and allocate new target buffer, if necessary.
+  // Deallocate old and allocate new target buffer, if necessary. No
+  // buffer is needed when the image is written straight to a file.
   //
   // If we need more space:
   const size_t bufsize =
@@ -789,13 +1071,13 @@ SoOffscreenRendererP::renderFromBase(SoBase * base)
   // to smaller size:
   alloc = alloc || (bufsize <= (this->bufferbytesize / 8));
 
-  if (alloc) {
+  if (alloc && !this->outputfile) {
     delete[] this->buffer;
     this->buffer = new unsigned char[bufsize];
     this->bufferbytesize = bufsize;
   }
 
-  if (SoOffscreenRendererP::debugTileOutputPrefix()) {
+  if (SoOffscreenRendererP::debugTileOutputPrefix() && !this->outputfile) {
     (void)memset(this->buffer, 0x00, bufsize);
   }
 
@@ -827,99 +1109,30 @@ SoOffscreenRendererP::renderFromBase(SoBase * base)
   // SoExtSelection, rather than adding some kind of "semi-private"
   // API to let SoExtSelection find out whether or not tiled rendering
   // is used). 20041028 mortene.
-  const SbBool tiledrendering =
-    forcetiled || (fullsize[0] > glsize[0]) || (fullsize[1] > glsize[1]);
+  //
+  // renderToRGB() always uses the tiled rendering code, as it writes
+  // the tiles straight to the file.
+  const SbBool tiledrendering = forcetiled || this->outputfile ||
+    (fullsize[0] > glsize[0]) || (fullsize[1] > glsize[1]);
 
   // Shall we use subscreen rendering or regular one-screen renderer?
+  SbBool ok = TRUE;
   if (tiledrendering) {
     // we need to copy from GL to system memory if we're doing tiled rendering
     this->didreadbuffer = TRUE;
+    this->canreadbuffer = FALSE;
 
     for (int i=0; i < 2; i++) {
       this->numsubscreens[i] = (fullsize[i] + (glsize[i] - 1)) / glsize[i];
     }
 
-    // We have to grab cameras using this callback during rendering
-    this->visitedcamera = NULL;
-    this->renderaction->setAbortCallback(SoOffscreenRendererP::GLRenderAbortCallback, this);
-
-    // Render entire scene graph for each subscreen.
-    for (int y=0; y < this->numsubscreens[1]; y++) {
-      for (int x=0; x < this->numsubscreens[0]; x++) {
-        this->currenttile = SbVec2s(x, y);
-
-        // Find current "active" tilesize.
-        this->subsize[0] = glsize[0];
-        this->subsize[1] = glsize[1];
-        if (x == (this->numsubscreens[0] - 1)) {
-          this->subsize[0] = fullsize[0] % glsize[0];
-          if (this->subsize[0] == 0) { this->subsize[0] = glsize[0]; }
-        }
-        if (y == (this->numsubscreens[1] - 1)) {
-          this->subsize[1] = fullsize[1] % glsize[1];
-          if (this->subsize[1] == 0) { this->subsize[1] = glsize[1]; }
-        }
-
-        SbViewportRegion subviewport = SbViewportRegion(SbVec2s(this->subsize[0], this->subsize[1]));
-        this->renderaction->setViewportRegion(subviewport);
-
-        if (base->isOfType(SoNode::getClassTypeId()))
-          this->renderaction->apply((SoNode *)base);
-        else if (base->isOfType(SoPath::getClassTypeId()))
-          this->renderaction->apply((SoPath *)base);
-        else {
-          assert(FALSE && "Cannot apply to anything else than an SoNode or an SoPath");
-        }
-
-        const unsigned int nrcomp = PUBLIC(this)->getComponents();
-
-        const int MAINBUF_OFFSET =
-          (glsize[1] * y * fullsize[0] + glsize[0] * x) * nrcomp;
-
-        const SbVec2s vpsize = subviewport.getViewportSizePixels();
-        this->glcanvas.readPixels(this->buffer + MAINBUF_OFFSET,
-                                  vpsize, fullsize[0], nrcomp);
-
-        // Debug option to dump the (full) buffer after each
-        // iteration.
-        if (SoOffscreenRendererP::debugTileOutputPrefix()) {
-          SbString s;
-          s.sprintf("%s_%03d_%03d.rgb",
-                    SoOffscreenRendererP::debugTileOutputPrefix(), x, y);
-
-          FILE * f = fopen(s.getString(), "wb");
-		  if (f) {
-            SbBool w = SoOffscreenRendererP::writeToRGB(f, fullsize[0], fullsize[1],
-                                                        nrcomp, this->buffer);
-            assert(w);
-            const int r = fclose(f);
-            assert(r == 0);
-		  }
-
-          // This is sometimes useful to enable during debugging to
-          // see the exact order and position of the tiles. Not
-          // enabled by default because it makes the final buffer
-          // completely blank.
-#if 0 // debug
-          (void)memset(this->buffer, 0x00, bufsize);
-#endif // debug
-        }
-      }
-    }
-
-    this->renderaction->setAbortCallback(NULL, this);
-
-    if (!this->visitedcamera) {
-      SoDebugError::postWarning("SoOffscreenRenderer::renderFromBase",
-                                "No camera node found in scene graph while rendering offscreen image. "
-                                "The result will most likely be incorrect.");
-    }
-
+    ok = this->renderTiles(base);
   }
   // Regular, non-tiled rendering.
   else {
     // do lazy buffer read (GL context is read in getBuffer())
     this->didreadbuffer = FALSE;
+    this->canreadbuffer = TRUE;
 	
 	SbViewportRegion region;
 
@@ -956,15 +1169,420 @@ SoOffscreenRendererP::renderFromBase(SoBase * base)
   // Restore old value.
   (void)SoGLBigImage::setChangeLimit(bigimagechangelimit);
 
+  LOCK_CONTEXT(this);
   this->glcanvas.deactivateGLContext();
+  UNLOCK_CONTEXT(this);
   this->renderaction->setCacheContext(oldcontext); // restore old
 
   if(this->useDC)
 	this->updateDCBitmap();
 
+  return ok;
+}
+
+// *************************************************************************
+
+SoOffscreenTileWorker::SoOffscreenTileWorker(SoOffscreenRendererP * ownerarg,
+                                             CoinOffscreenGLCanvas * canvas,
+                                             SoGLRenderAction * action,
+                                             SbBool ownsresourcesarg)
+{
+  this->owner = ownerarg;
+  this->glcanvas = canvas;
+  this->renderaction = action;
+  this->ownsresources = ownsresourcesarg;
+  this->active = FALSE;
+  this->lastnodewasacamera = FALSE;
+  this->visitedcamera = NULL;
+  for (int i = 0; i < 2; i++) {
+    this->buffers[i] = NULL;
+    this->buffersizes[i] = 0;
+  }
+}
+
+SoOffscreenTileWorker::~SoOffscreenTileWorker()
+{
+  if (this->ownsresources) {
+    delete this->renderaction;
+    delete this->glcanvas;
+  }
+  for (int i = 0; i < 2; i++) { delete[] this->buffers[i]; }
+}
+
+// Returns a buffer of at least the given size, which is kept until
+// the worker is deleted.
+unsigned char *
+SoOffscreenTileWorker::getBuffer(const Buffer which, const size_t size)
+{
+  if (size > this->buffersizes[which]) {
+    delete[] this->buffers[which];
+    this->buffers[which] = new unsigned char[size];
+    this->buffersizes[which] = size;
+  }
+  return this->buffers[which];
+}
+
+// Copies a row of pixels, converting to grayscale the same way as
+// CoinOffscreenGLCanvas::readPixels() if the source has 3 or 4
+// components and the destination 1 or 2.
+static void
+offscreen_convert_row(const uint8_t * src, const unsigned int srccomp,
+                      uint8_t * dst, const unsigned int dstcomp,
+                      const unsigned int width)
+{
+  if (srccomp == dstcomp) {
+    (void)memcpy(dst, src, width * dstcomp);
+    return;
+  }
+  for (unsigned int x = 0; x < width; x++) {
+    double v = src[0] * 0.3 + src[1] * 0.59 + src[2] * 0.11;
+    *dst++ = (unsigned char) v;
+    if (dstcomp == 2) {
+      *dst++ = src[3];
+    }
+    src += srccomp;
+  }
+}
+
+static int
+offscreen_seek(FILE * fp, const uint64_t offset)
+{
+#ifdef _WIN32
+  return _fseeki64(fp, (__int64) offset, SEEK_SET);
+#else // _WIN32
+  return fseek(fp, (long) offset, SEEK_SET);
+#endif // !_WIN32
+}
+
+static void
+offscreen_copy_settings(const SoGLRenderAction * src, SoGLRenderAction * dst)
+{
+  dst->setTransparencyType(src->getTransparencyType());
+  dst->setTransparentDelayedObjectRenderType(src->getTransparentDelayedObjectRenderType());
+  dst->setSmoothing(src->isSmoothing());
+  dst->setNumPasses(src->getNumPasses());
+  dst->setSortedLayersNumPasses(src->getSortedLayersNumPasses());
+  dst->setDelayedObjDepthWrite(src->getDelayedObjDepthWrite());
+}
+
+// Deletes the workers from index first and up.
+void
+SoOffscreenRendererP::deleteWorkers(const int first)
+{
+  while (this->workers.getLength() > first) {
+    delete this->workers[this->workers.getLength() - 1];
+    this->workers.pop();
+  }
+}
+
+// Renders all the tiles, with one worker per render thread. The
+// calling thread is used as the first render thread, with the GL
+// context which is already current. Returns FALSE if a tile couldn't
+// be read back or written.
+SbBool
+SoOffscreenRendererP::renderTiles(SoBase * base)
+{
+  const int numtiles = this->numsubscreens[0] * this->numsubscreens[1];
+  int numworkers = 1;
+#ifdef HAVE_THREADS
+  numworkers = SbMin(this->numrenderthreads, numtiles);
+#endif // HAVE_THREADS
+
+  if (this->workers.getLength() == 0) {
+    this->workers.append(new SoOffscreenTileWorker(this, &this->glcanvas,
+                                                   this->renderaction, FALSE));
+  }
+  // (the render action may have been replaced by setGLRenderAction())
+  this->workers[0]->renderaction = this->renderaction;
+  this->workers[0]->active = TRUE;
+
+  while (this->workers.getLength() < numworkers) {
+    SoGLRenderAction * action = new SoGLRenderAction(this->viewport);
+    action->addPreRenderCallback(pre_render_cb, NULL);
+    this->workers.append(new SoOffscreenTileWorker(this, new CoinOffscreenGLCanvas,
+                                                   action, TRUE));
+  }
+
+  // The GL contexts of the other workers are set up here, so any
+  // context (re)construction is done in this thread. They must be at
+  // least as large as our own context, as all tiles have the same
+  // size.
+  const SbVec2s glsize(this->glcanvassize[0], this->glcanvassize[1]);
+  int i;
+  for (i = 1; i < numworkers; i++) {
+    SoOffscreenTileWorker * worker = this->workers[i];
+    worker->glcanvas->setWantedSize(glsize);
+    const uint32_t context = worker->glcanvas->activateGLContext();
+    const SbVec2s & size = worker->glcanvas->getActualSize();
+    worker->active = (context != 0) && (size[0] >= glsize[0]) && (size[1] >= glsize[1]);
+    if (context != 0) { worker->glcanvas->deactivateGLContext(); }
+
+    if (worker->active) {
+      worker->renderaction->setCacheContext(context);
+      offscreen_copy_settings(this->renderaction, worker->renderaction);
+    }
+    else if (CoinOffscreenGLCanvas::debug()) {
+      SoDebugError::postInfo("SoOffscreenRendererP::renderTiles",
+                             "Could not set up the GL context for render "
+                             "thread %d.", i);
+    }
+  }
+
+  this->tilebase = base;
+  this->nexttile = 0;
+  this->tilefailed = FALSE;
+  for (i = 0; i < numworkers; i++) {
+    SoOffscreenTileWorker * worker = this->workers[i];
+    worker->visitedcamera = NULL;
+    worker->lastnodewasacamera = FALSE;
+    // We have to grab cameras using this callback during rendering
+    worker->renderaction->setAbortCallback(SoOffscreenRendererP::GLRenderAbortCallback, worker);
+  }
+
+#ifdef HAVE_THREADS
+  cc_thread ** threads = new cc_thread*[numworkers];
+  for (i = 1; i < numworkers; i++) {
+    threads[i] = NULL;
+    if (this->workers[i]->active) {
+      threads[i] = cc_thread_construct(SoOffscreenRendererP::tileThreadEntry,
+                                       this->workers[i]);
+    }
+  }
+#endif // HAVE_THREADS
+
+  this->renderTiles(this->workers[0]);
+
+#ifdef HAVE_THREADS
+  for (i = 1; i < numworkers; i++) {
+    if (threads[i] == NULL) continue;
+    (void) cc_thread_join(threads[i], NULL);
+    cc_thread_destruct(threads[i]);
+  }
+  delete[] threads;
+#endif // HAVE_THREADS
+
+  SbBool visitedcamera = FALSE;
+  for (i = 0; i < numworkers; i++) {
+    SoOffscreenTileWorker * worker = this->workers[i];
+    worker->renderaction->setAbortCallback(NULL, worker);
+    if (worker->visitedcamera) { visitedcamera = TRUE; }
+  }
+  this->tilebase = NULL;
+
+  if (!visitedcamera) {
+    SoDebugError::postWarning("SoOffscreenRenderer::renderFromBase",
+                              "No camera node found in scene graph while rendering offscreen image. "
+                              "The result will most likely be incorrect.");
+  }
+  if (this->tilefailed) {
+    SoDebugError::postWarning("SoOffscreenRenderer::renderFromBase",
+                              this->outputfile ?
+                              "error when writing RGB file" :
+                              "Could not read back the rendered tiles.");
+  }
+  return !this->tilefailed;
+}
+
+#ifdef HAVE_THREADS
+void *
+SoOffscreenRendererP::tileThreadEntry(void * closure)
+{
+  SoOffscreenTileWorker * worker = (SoOffscreenTileWorker *) closure;
+  SoOffscreenRendererP * thisp = worker->owner;
+
+  // the window-system bindings aren't necessarily thread safe, so
+  // the threads take turns switching GL contexts
+  LOCK_TILES(thisp);
+  const uint32_t context = worker->glcanvas->activateGLContext();
+  UNLOCK_TILES(thisp);
+
+  if (context == 0) { return NULL; }
+  thisp->setupGLContext();
+  thisp->renderTiles(worker);
+
+  LOCK_TILES(thisp);
+  worker->glcanvas->deactivateGLContext();
+  UNLOCK_TILES(thisp);
+  return NULL;
+}
+#endif // HAVE_THREADS
+
+// Renders tiles with the worker's GL context until there are no more
+// tiles left. The pixels of each tile are read back asynchronously
+// when the driver supports pixel buffer objects, and are picked up
+// after the worker's next tile has been sent to GL, so the readback
+// overlaps the traversal.
+void
+SoOffscreenRendererP::renderTiles(SoOffscreenTileWorker * worker)
+{
+  const unsigned int nrcomp = this->components;
+  // luminance images are converted from RGB(A) when stored
+  const unsigned int readcomp = (nrcomp < 3) ? nrcomp + 2 : nrcomp;
+
+  int pending = -1; // the pixel buffer slot of the previous tile
+  SbVec2s pendingtile, pendingsize;
+  for (;;) {
+    const SbBool more = this->nextTile(worker);
+    const SbVec2s size((short) worker->subsize[0], (short) worker->subsize[1]);
+    int slot = -1;
+
+    if (more) {
+      worker->renderaction->setViewportRegion(SbViewportRegion(size));
+
+      LOCK_TRAVERSAL(this);
+      if (this->tilebase->isOfType(SoNode::getClassTypeId()))
+        worker->renderaction->apply((SoNode *)this->tilebase);
+      else if (this->tilebase->isOfType(SoPath::getClassTypeId()))
+        worker->renderaction->apply((SoPath *)this->tilebase);
+      else {
+        assert(FALSE && "Cannot apply to anything else than an SoNode or an SoPath");
+      }
+      UNLOCK_TRAVERSAL(this);
+
+      slot = (pending == 0) ? 1 : 0;
+      if (!worker->glcanvas->beginReadPixels(slot, size, readcomp)) {
+        slot = -1;
+        uint8_t * pixels =
+          worker->getBuffer(SoOffscreenTileWorker::READBUFFER,
+                            size_t(size[0]) * size_t(size[1]) * readcomp);
+        worker->glcanvas->readPixels(pixels, size, size[0], readcomp);
+        this->storeTile(worker, worker->currenttile, size, pixels, readcomp);
+      }
+    }
+
+    if (pending >= 0) {
+      const uint8_t * pixels = worker->glcanvas->mapPixels(pending);
+      if (pixels) {
+        this->storeTile(worker, pendingtile, pendingsize, pixels, readcomp);
+        worker->glcanvas->unmapPixels(pending);
+      }
+      else {
+        LOCK_TILES(this);
+        this->tilefailed = TRUE;
+        UNLOCK_TILES(this);
+      }
+    }
+
+    if (!more) break;
+    pending = slot;
+    pendingtile = worker->currenttile;
+    pendingsize = size;
+  }
+}
+
+// Hands out the next tile to the worker. Returns FALSE when all tiles
+// have been handed out, or if storing a tile failed.
+SbBool
+SoOffscreenRendererP::nextTile(SoOffscreenTileWorker * worker)
+{
+  const int numtiles = this->numsubscreens[0] * this->numsubscreens[1];
+  LOCK_TILES(this);
+  const int tile =
+    ((this->nexttile < numtiles) && !this->tilefailed) ? this->nexttile++ : -1;
+  UNLOCK_TILES(this);
+  if (tile < 0) { return FALSE; }
+
+  const int x = tile % this->numsubscreens[0];
+  const int y = tile / this->numsubscreens[0];
+  worker->currenttile = SbVec2s(x, y);
+
+  // Find current "active" tilesize.
+  const SbVec2s fullsize = this->viewport.getViewportSizePixels();
+  for (int i = 0; i < 2; i++) {
+    worker->subsize[i] = this->glcanvassize[i];
+    if (worker->currenttile[i] == (this->numsubscreens[i] - 1)) {
+      worker->subsize[i] = fullsize[i] % this->glcanvassize[i];
+      if (worker->subsize[i] == 0) { worker->subsize[i] = this->glcanvassize[i]; }
+    }
+  }
   return TRUE;
 }
 
+// Stores the pixels of a tile in the buffer, or writes them to the
+// output file. The pixels are tightly packed rows, from the bottom up.
+void
+SoOffscreenRendererP::storeTile(SoOffscreenTileWorker * worker,
+                                const SbVec2s & tile, const SbVec2s & size,
+                                const uint8_t * pixels,
+                                unsigned int pixelcomponents)
+{
+  const unsigned int nrcomp = this->components;
+  const SbVec2s fullsize = this->viewport.getViewportSizePixels();
+  const unsigned int x0 = tile[0] * this->glcanvassize[0];
+  const unsigned int y0 = tile[1] * this->glcanvassize[1];
+  const unsigned int w = size[0];
+  const unsigned int h = size[1];
+  unsigned int x, y, c;
+
+  if (!this->outputfile) {
+    // The tiles don't overlap, so the workers can store them in the
+    // buffer without locking.
+    for (y = 0; y < h; y++) {
+      const size_t offset = (size_t(y0 + y) * fullsize[0] + x0) * nrcomp;
+      offscreen_convert_row(pixels + size_t(y) * w * pixelcomponents,
+                            pixelcomponents, this->buffer + offset, nrcomp, w);
+    }
+
+    // Debug option to dump the (full) buffer after each tile.
+    if (SoOffscreenRendererP::debugTileOutputPrefix()) {
+      SbString s;
+      s.sprintf("%s_%03d_%03d.rgb",
+                SoOffscreenRendererP::debugTileOutputPrefix(), tile[0], tile[1]);
+
+      LOCK_TILES(this);
+      FILE * f = fopen(s.getString(), "wb");
+      if (f) {
+        SbBool ok = SoOffscreenRendererP::writeToRGB(f, fullsize[0], fullsize[1],
+                                                     nrcomp, this->buffer, FALSE);
+        assert(ok);
+        const int r = fclose(f);
+        assert(r == 0);
+      }
+      UNLOCK_TILES(this);
+    }
+    return;
+  }
+
+  // The SGI RGB format stores the components in separate planes,
+  // with the rows of each plane from the bottom up, so each row of
+  // each component is written at its final position in the file.
+  uint8_t * planes =
+    worker->getBuffer(SoOffscreenTileWorker::PLANEBUFFER, (w * h + w) * nrcomp);
+  uint8_t * row = planes + w * h * nrcomp;
+  for (y = 0; y < h; y++) {
+    offscreen_convert_row(pixels + size_t(y) * w * pixelcomponents,
+                          pixelcomponents, row, nrcomp, w);
+    for (c = 0; c < nrcomp; c++) {
+      uint8_t * dst = planes + (c * h + y) * w;
+      for (x = 0; x < w; x++) { dst[x] = row[x * nrcomp + c]; }
+    }
+  }
+
+  LOCK_TILES(this);
+  SbBool writeok = TRUE;
+  for (c = 0; c < nrcomp && writeok; c++) {
+    for (y = 0; y < h && writeok; y++) {
+      const uint64_t offset = RGB_HEADERSIZE +
+        (uint64_t(c) * fullsize[1] + y0 + y) * fullsize[0] + x0;
+      writeok = (offscreen_seek(this->outputfile, offset) == 0) &&
+        (fwrite(planes + (c * h + y) * w, 1, w, this->outputfile) == w);
+    }
+  }
+  if (!writeok) { this->tilefailed = TRUE; }
+  UNLOCK_TILES(this);
+}
+
+// Sets up the current GL context for rendering.
+void
+SoOffscreenRendererP::setupGLContext(void)
+{
+  glEnable(GL_DEPTH_TEST);
+  glClearColor(this->backgroundcolor[0],
+               this->backgroundcolor[1],
+               this->backgroundcolor[2],
+               0.0f);
+}
+
 /*!
   Render the scene graph rooted at \a scene into our internal pixel
   buffer.
@@ -1022,76 +1640,448 @@ SoOffscreenRenderer::render(SoPath * scene)
   return PRIVATE(this)->renderFromBase(scene);
 }
 
-// *************************************************************************
-
 /*!
-  Returns the offscreen memory buffer.
-*/
-unsigned char *
-SoOffscreenRenderer::getBuffer(void) const
-{
-  if (!PRIVATE(this)->didreadbuffer) {
-    const SbVec2s dims = this->getViewportRegion().getViewportSizePixels();
-    //fprintf(stderr,"reading pixels: %d %d\n", dims[0], dims[1]);
+  Render the scene graph rooted at \a scene, and write it straight to
+  the file \a filename in SGI RGB format, as with writeToRGB(). If the
+  file already exists, it will be overwritten (if permitted by the
+  filesystem).
 
-    PRIVATE(this)->glcanvas.activateGLContext();
-    PRIVATE(this)->glcanvas.readPixels(PRIVATE(this)->buffer, dims, dims[0],
-                                       (unsigned int) this->getComponents());
-    PRIVATE(this)->glcanvas.deactivateGLContext();
-    PRIVATE(this)->didreadbuffer = TRUE;
-  }
-  return PRIVATE(this)->buffer;
-}
+  The image is always rendered in tiles, and each tile is written to
+  the file as soon as it has been read back from OpenGL, so the full
+  image is never held in memory. This makes it possible to render
+  images which are too large for the internal buffer, like posters of
+  several hundred megapixels. The internal buffer returned by
+  getBuffer() is not updated.
 
-/*!
-  Win32 only:
+  Use setNumRenderThreads() to render the tiles in parallel.
 
-  returns a direct handle to the internal DC of the offscreen
-  context.
+  Returns \c TRUE if all went ok, otherwise \c FALSE.
 
-  Useful for efficient access to the raw image under certain special
-  circumstances. getBuffer() might be too slow, for instance due to
-  pixel format conversion (Windows DCs are usually BGRA, while the
-  32-bit buffers returned from getBuffer() are RGBA).
+  \sa render(), writeToRGB()
+  \since Coin 4.0
+*/
+SbBool
+SoOffscreenRenderer::renderToRGB(SoNode * scene, const char * filename)
+{
+  return PRIVATE(this)->renderToRGB(scene, filename);
+}
 
-  Notes:
+/*!
+  Render the \a scene path, and write it straight to the file \a
+  filename in SGI RGB format.
 
-  The return value is a reference to a HDC. The HDC typedef has been
-  unwound to a native C++ type for multiplatform compatibility
-  reasons.
+  \sa renderToRGB(SoNode *, const char *)
+  \since Coin 4.0
+*/
+SbBool
+SoOffscreenRenderer::renderToRGB(SoPath * scene, const char * filename)
+{
+  return PRIVATE(this)->renderToRGB(scene, filename);
+}
 
-  Returned reference will contain a NULL value on other platforms.
+SbBool
+SoOffscreenRendererP::renderToRGB(SoBase * base, const char * filename)
+{
+  FILE * fp = fopen(filename, "wb");
+  if (!fp) {
+    SoDebugError::postWarning("SoOffscreenRenderer::renderToRGB",
+                              "couldn't open file '%s'", filename);
+    return FALSE;
+  }
 
-  Important limitation: if the current dimensions of the
-  SoOffscreenRenderer instance are larger than what can be rendered
-  with a single offscreen buffer, tiling will be used by the
-  SoOffscreenRenderer, and the returned HDC will contain only part of
-  the full rendered image.
+  const SbVec2s fullsize = this->viewport.getViewportSizePixels();
+  SbBool ok = SoOffscreenRendererP::writeRGBHeader(fp, fullsize[0], fullsize[1],
+                                                   this->components, FALSE);
+  if (ok) {
+    this->outputfile = fp;
+    ok = this->renderFromBase(base);
+    this->outputfile = NULL;
+  }
+  ok = (fclose(fp) == 0) && ok;
+  return ok;
+}
 
-  \sa getBuffer()
-  \since Coin 3.1
+/*!
+  Sets the number of threads used to render tiled images, which is
+  the case when the viewport region is larger than the largest
+  offscreen OpenGL context, and for renderToRGB().
+
+  Each render thread has its own offscreen OpenGL context and
+  SoGLRenderAction, with its own cache context, and renders the next
+  tile which isn't taken yet until all tiles are done. The pixels of
+  each tile are read back asynchronously through pixel buffer objects
+  when the OpenGL driver supports them, while the thread renders its
+  next tile. The render actions of the additional threads get the
+  transparency type, smoothing, number of passes and other rendering
+  settings of the action returned by getGLRenderAction(), but not its
+  callbacks.
+
+  Unless Coin has been built with thread safety enabled
+  (COIN_THREADSAFE), the scene graph can only be traversed by one
+  thread at a time. The threads then take turns traversing the scene
+  graph, and only the OpenGL rendering, the readback and the file
+  output run in parallel.
+
+  The contexts and render actions are kept between renderings, so
+  their OpenGL resources and caches can be reused. Note that each
+  context needs its own copy of the scene's textures and other OpenGL
+  resources.
+
+  The same number of threads is used by renderBatch(), which renders
+  each view with one thread.
+
+  The default value is 1, or the value of the environment variable
+  COIN_OFFSCREENRENDERER_NUM_THREADS if it is set. The value is
+  ignored if Coin has been built without thread support.
+
+  \sa getNumRenderThreads(), renderToRGB(), renderBatch()
+  \since Coin 4.0
 */
-const void * const &
-SoOffscreenRenderer::getDC(void) const
+void
+SoOffscreenRenderer::setNumRenderThreads(const int num)
 {
-  if(!PRIVATE(this)->useDC)
-  {
-	PRIVATE(this)->useDC = true;
-	PRIVATE(this)->updateDCBitmap();
+  PRIVATE(this)->numrenderthreads = SbMax(num, 1);
+  // free up the contexts which won't be used any more
+  if (PRIVATE(this)->workers.getLength() > PRIVATE(this)->numrenderthreads) {
+    PRIVATE(this)->deleteWorkers(PRIVATE(this)->numrenderthreads);
   }
-  
-  return PRIVATE(this)->glcanvas.getHDC();
 }
 
-void SoOffscreenRendererP::updateDCBitmap()
+/*!
+  Returns the number of threads used to render tiled images.
+
+  \sa setNumRenderThreads()
+  \since Coin 4.0
+*/
+int
+SoOffscreenRenderer::getNumRenderThreads(void) const
 {
-  this->glcanvas.updateDCBitmap();
+  return PRIVATE(this)->numrenderthreads;
 }
-// *************************************************************************
 
-//
-// avoid endian problems (little endian sucks, right? :)
-//
+/*!
+  Renders \a scene once for each of the cameras in \a cameras, with
+  the viewport region of this renderer. This is meant for batch jobs
+  rendering many views of the same scene: the GL context is set up
+  once, large enough for all the views, and the render caches,
+  textures and other OpenGL resources are reused for all the views,
+  and by later batches.
+
+  For each view, \a callback is called with \a userdata, the renderer
+  which rendered the view, the index of the view's camera, and the
+  time used to render the view and read the image back. The image is
+  fetched from the renderer with SoOffscreenRenderer::getBuffer(), or
+  written with e.g. SoOffscreenRenderer::writeToFile() or
+  SoOffscreenRenderer::scheduleWriteToRGB(). It is only valid until
+  the callback returns.
+
+  The cameras are put in front of \a scene, so \a scene should not
+  contain a camera itself. Note that the scene graph must not be
+  changed while the views are rendered.
+
+  With setNumRenderThreads() larger than 1, the views are rendered by
+  that many threads, each with its own SoOffscreenRenderer and
+  offscreen OpenGL context. The renderers get the settings of this
+  renderer, including the transparency type, smoothing, number of
+  passes and other rendering settings of the action returned by
+  getGLRenderAction(), but not its callbacks. The callback is then
+  called from all the threads, so it must be thread safe, and views
+  may finish out of order. Unless Coin has been built with thread
+  safety enabled (COIN_THREADSAFE), the threads take turns traversing
+  the scene graph, and the readback and the callbacks run in
+  parallel.
+
+  Like all offscreen rendering, this works with any OpenGL driver
+  which can provide offscreen contexts, e.g. Mesa's software
+  rasterizers. On systems without a window system, the offscreen
+  contexts can be provided by the application through
+  cc_glglue_context_set_offscreen_cb_functions(), e.g. with EGL.
+
+  Returns \c FALSE if any of the views could not be rendered.
+
+  \sa render()
+  \since Coin 4.0
+*/
+SbBool
+SoOffscreenRenderer::renderBatch(SoNode * scene, const SoNodeList & cameras,
+                                 SoOffscreenBatchCB * callback, void * userdata)
+{
+  const SbList <SbViewportRegion> regions;
+  return PRIVATE(this)->renderBatch(scene, cameras, regions, callback, userdata);
+}
+
+/*!
+  Renders \a scene once for each of the cameras in \a cameras, with
+  the viewport region at the same index in \a regions. The regions may
+  be of different sizes.
+
+  \sa renderBatch(SoNode *, const SoNodeList &, SoOffscreenBatchCB *, void *)
+  \since Coin 4.0
+*/
+SbBool
+SoOffscreenRenderer::renderBatch(SoNode * scene, const SoNodeList & cameras,
+                                 const SbList <SbViewportRegion> & regions,
+                                 SoOffscreenBatchCB * callback, void * userdata)
+{
+  if (regions.getLength() != cameras.getLength()) {
+    SoDebugError::post("SoOffscreenRenderer::renderBatch",
+                       "Got %d cameras, but %d viewport regions.",
+                       cameras.getLength(), regions.getLength());
+    return FALSE;
+  }
+  return PRIVATE(this)->renderBatch(scene, cameras, regions, callback, userdata);
+}
+
+// An empty list of regions means that all views use the viewport of
+// this renderer.
+SbBool
+SoOffscreenRendererP::renderBatch(SoNode * scene, const SoNodeList & cameras,
+                                  const SbList <SbViewportRegion> & regions,
+                                  SoOffscreenBatchCB * callback, void * userdata)
+{
+  const int numviews = cameras.getLength();
+  int i;
+  for (i = 0; i < numviews; i++) {
+    if (!cameras[i] || !cameras[i]->isOfType(SoCamera::getClassTypeId())) {
+      SoDebugError::post("SoOffscreenRenderer::renderBatch",
+                         "Node %d in the list of cameras is not a camera.", i);
+      return FALSE;
+    }
+  }
+  if (numviews == 0) { return TRUE; }
+
+  int numworkers = 1;
+#ifdef HAVE_THREADS
+  numworkers = SbMin(this->numrenderthreads, numviews);
+#endif // HAVE_THREADS
+
+  SbVec2s maxsize = this->viewport.getViewportSizePixels();
+  if (regions.getLength() > 0) {
+    maxsize.setValue(0, 0);
+    for (i = 0; i < regions.getLength(); i++) {
+      const SbVec2s size = regions[i].getViewportSizePixels();
+      maxsize.setValue(SbMax(maxsize[0], size[0]), SbMax(maxsize[1], size[1]));
+    }
+  }
+
+  while (this->batchrenderers.getLength() < numworkers - 1) {
+    this->batchrenderers.append(new SoOffscreenRenderer(this->viewport));
+  }
+
+  // each view is rendered by one thread, so the views aren't split up
+  // for parallel tile rendering
+  const int numrenderthreads = this->numrenderthreads;
+  this->batchviewport = this->viewport;
+
+  SoOffscreenBatchWorker * workers = new SoOffscreenBatchWorker[numworkers];
+  for (i = 0; i < numworkers; i++) {
+    SoOffscreenBatchWorker * worker = &workers[i];
+    worker->owner = this;
+    worker->renderer = (i == 0) ? PUBLIC(this) : this->batchrenderers[i - 1];
+
+    SoOffscreenRendererP * thisp = PRIVATE(worker->renderer);
+    if (i > 0) {
+      thisp->components = this->components;
+      thisp->backgroundcolor = this->backgroundcolor;
+      thisp->rgbcompression = this->rgbcompression;
+      offscreen_copy_settings(this->renderaction, thisp->renderaction);
+    }
+    thisp->numrenderthreads = 1;
+    // the GL context is made large enough for all the views, so it
+    // isn't reconstructed when the size of the views change
+    thisp->minglsize = maxsize;
+#ifdef HAVE_THREADS
+    thisp->contextmutex = this->batchmutex;
+#endif // HAVE_THREADS
+
+    worker->root = new SoSeparator;
+    worker->root->ref();
+    worker->root->renderCaching = SoSeparator::OFF;
+    worker->root->addChild(cameras[0]);
+    worker->root->addChild(scene);
+  }
+
+  this->batchcameras = &cameras;
+  this->batchregions = &regions;
+  this->batchcallback = callback;
+  this->batchuserdata = userdata;
+  this->nextbatchview = 0;
+  this->numfailedviews = 0;
+
+#ifdef HAVE_THREADS
+  cc_thread ** threads = new cc_thread*[numworkers];
+  for (i = 1; i < numworkers; i++) {
+    threads[i] = cc_thread_construct(SoOffscreenRendererP::batchThreadEntry,
+                                     &workers[i]);
+  }
+#endif // HAVE_THREADS
+
+  this->renderViews(&workers[0]);
+
+#ifdef HAVE_THREADS
+  for (i = 1; i < numworkers; i++) {
+    (void) cc_thread_join(threads[i], NULL);
+    cc_thread_destruct(threads[i]);
+  }
+  delete[] threads;
+#endif // HAVE_THREADS
+
+  for (i = 0; i < numworkers; i++) {
+    SoOffscreenRendererP * thisp = PRIVATE(workers[i].renderer);
+    thisp->minglsize.setValue(0, 0);
+#ifdef HAVE_THREADS
+    thisp->contextmutex = NULL;
+#endif // HAVE_THREADS
+    workers[i].root->unref();
+  }
+  delete[] workers;
+
+  this->numrenderthreads = numrenderthreads;
+  this->viewport = this->batchviewport;
+  this->batchcameras = NULL;
+  this->batchregions = NULL;
+  this->batchcallback = NULL;
+  this->batchuserdata = NULL;
+
+  if (this->numfailedviews > 0) {
+    SoDebugError::postWarning("SoOffscreenRenderer::renderBatch",
+                              "Could not render %d of the %d views.",
+                              this->numfailedviews, numviews);
+  }
+  return (this->numfailedviews == 0);
+}
+
+#ifdef HAVE_THREADS
+void *
+SoOffscreenRendererP::batchThreadEntry(void * closure)
+{
+  SoOffscreenBatchWorker * worker = (SoOffscreenBatchWorker *) closure;
+  worker->owner->renderViews(worker);
+  return NULL;
+}
+#endif // HAVE_THREADS
+
+// Returns the index of the next view to render, or -1 when all the
+// views are taken.
+int
+SoOffscreenRendererP::nextView(void)
+{
+  LOCK_BATCH(this);
+  const int view = (this->nextbatchview < this->batchcameras->getLength()) ?
+    this->nextbatchview++ : -1;
+  UNLOCK_BATCH(this);
+  return view;
+}
+
+// Renders views with the worker's renderer until there are no more
+// views left.
+void
+SoOffscreenRendererP::renderViews(SoOffscreenBatchWorker * worker)
+{
+  SoOffscreenRenderer * renderer = worker->renderer;
+  int view;
+  while ((view = this->nextView()) >= 0) {
+    LOCK_TRAVERSAL(this);
+    const SbTime start = SbTime::getTimeOfDay();
+    worker->root->replaceChild(0, (*this->batchcameras)[view]);
+    renderer->setViewportRegion((this->batchregions->getLength() > 0) ?
+                                (*this->batchregions)[view] :
+                                this->batchviewport);
+    SbBool ok = renderer->render(worker->root);
+    SbTime rendertime = SbTime::getTimeOfDay() - start;
+    UNLOCK_TRAVERSAL(this);
+
+    // the image is read back outside the traversal lock, so the
+    // readback overlaps with the rendering of the other threads
+    const SbTime readstart = SbTime::getTimeOfDay();
+    ok = ok && (renderer->getBuffer() != NULL);
+    rendertime += SbTime::getTimeOfDay() - readstart;
+
+    if (!ok) {
+      LOCK_BATCH(this);
+      this->numfailedviews++;
+      UNLOCK_BATCH(this);
+    }
+    else if (this->batchcallback) {
+      this->batchcallback(this->batchuserdata, renderer, view, rendertime);
+    }
+  }
+}
+
+// *************************************************************************
+
+/*!
+  Returns the offscreen memory buffer.
+*/
+unsigned char *
+SoOffscreenRenderer::getBuffer(void) const
+{
+  if (!PRIVATE(this)->didreadbuffer) {
+    const SbVec2s dims = this->getViewportRegion().getViewportSizePixels();
+    //fprintf(stderr,"reading pixels: %d %d\n", dims[0], dims[1]);
+
+    LOCK_CONTEXT(PRIVATE(this));
+    PRIVATE(this)->glcanvas.activateGLContext();
+    UNLOCK_CONTEXT(PRIVATE(this));
+    PRIVATE(this)->glcanvas.readPixels(PRIVATE(this)->buffer, dims, dims[0],
+                                       (unsigned int) this->getComponents());
+    LOCK_CONTEXT(PRIVATE(this));
+    PRIVATE(this)->glcanvas.deactivateGLContext();
+    UNLOCK_CONTEXT(PRIVATE(this));
+    PRIVATE(this)->didreadbuffer = TRUE;
+  }
+  return PRIVATE(this)->buffer;
+}
+
+/*!
+  Win32 only:
+
+  returns a direct handle to the internal DC of the offscreen
+  context.
+
+  Useful for efficient access to the raw image under certain special
+  circumstances. getBuffer() might be too slow, for instance due to
+  pixel format conversion (Windows DCs are usually BGRA, while the
+  32-bit buffers returned from getBuffer() are RGBA).
+
+  Notes:
+
+  The return value is a reference to a HDC. The HDC typedef has been
+  unwound to a native C++ type for multiplatform compatibility
+  reasons.
+
+  Returned reference will contain a NULL value on other platforms.
+
+  Important limitation: if the current dimensions of the
+  SoOffscreenRenderer instance are larger than what can be rendered
+  with a single offscreen buffer, tiling will be used by the
+  SoOffscreenRenderer, and the returned HDC will contain only part of
+  the full rendered image.
+
+  \sa getBuffer()
+  \since Coin 3.1
+*/
+const void * const &
+SoOffscreenRenderer::getDC(void) const
+{
+  if(!PRIVATE(this)->useDC)
+  {
+	PRIVATE(this)->useDC = true;
+	PRIVATE(this)->updateDCBitmap();
+  }
+  
+  return PRIVATE(this)->glcanvas.getHDC();
+}
+
+void SoOffscreenRendererP::updateDCBitmap()
+{
+  this->glcanvas.updateDCBitmap();
+}
+// *************************************************************************
+
+//
+// avoid endian problems (little endian sucks, right? :)
+//
 static size_t
 write_short(FILE * fp, unsigned short val)
 {
@@ -1101,15 +2091,25 @@ write_short(FILE * fp, unsigned short val)
   return fwrite(&tmp, 2, 1, fp);
 }
 
-SbBool
-SoOffscreenRendererP::writeToRGB(FILE * fp, unsigned int w, unsigned int h,
-                                 unsigned int nrcomponents,
-                                 const uint8_t * imgbuf)
+static size_t
+write_int(FILE * fp, uint32_t val)
 {
-  // FIXME: add code to rle rows, pederb 2000-01-10
+  unsigned char tmp[4];
+  tmp[0] = (unsigned char)(val >> 24);
+  tmp[1] = (unsigned char)((val >> 16) & 0xff);
+  tmp[2] = (unsigned char)((val >> 8) & 0xff);
+  tmp[3] = (unsigned char)(val & 0xff);
+  return fwrite(&tmp, 4, 1, fp);
+}
 
+// Writes the RGB_HEADERSIZE bytes of the SGI RGB file header.
+SbBool
+SoOffscreenRendererP::writeRGBHeader(FILE * fp, unsigned int w, unsigned int h,
+                                     unsigned int nrcomponents,
+                                     const SbBool compress)
+{
   (void)write_short(fp, 0x01da); // imagic
-  (void)write_short(fp, 0x0001); // raw (no rle yet)
+  (void)write_short(fp, compress ? 0x0101 : 0x0001); // rle or raw
 
   if (nrcomponents == 1)
     (void)write_short(fp, 0x0002); // 2 dimensions (heightmap)
@@ -1126,23 +2126,115 @@ SoOffscreenRendererP::writeToRGB(FILE * fp, unsigned int w, unsigned int h,
   buf[7] = 255; // set maximum pixel value to 255
   strcpy((char *)buf+8, "https://github.com/coin3d/");
   const size_t wrote = fwrite(buf, 1, BUFSIZE, fp);
-  assert(wrote == BUFSIZE);
+  return (wrote == BUFSIZE);
+}
+
+// Copies channel c of row y of an interleaved image to dst.
+static void
+offscreen_get_channel_row(const uint8_t * imgbuf, unsigned int w,
+                          unsigned int nrcomponents, unsigned int y,
+                          unsigned int c, unsigned char * dst)
+{
+  const uint8_t * src = imgbuf + size_t(y) * w * nrcomponents + c;
+  for (unsigned int x = 0; x < w; x++) {
+    dst[x] = src[x * nrcomponents];
+  }
+}
+
+// Run-length encodes a row in the SGI RGB format: a count byte with
+// the high bit set followed by that many bytes, or a count byte
+// followed by one byte to repeat, and a 0 byte at the end. dst must
+// have room for w + (w + 125) / 126 + 1 bytes, which is what a row
+// without any runs needs. Returns the number of bytes used.
+static unsigned int
+offscreen_rle_row(const unsigned char * src, const unsigned int w,
+                  unsigned char * dst)
+{
+  unsigned char * out = dst;
+  unsigned int i = 0;
+  while (i < w) {
+    // copy bytes until a run of at least three equal bytes starts
+    unsigned int start = i;
+    while ((i < w) &&
+           !((i + 2 < w) && (src[i] == src[i+1]) && (src[i] == src[i+2]))) {
+      i++;
+    }
+    while (start < i) {
+      const unsigned int n = SbMin(i - start, 126u);
+      *out++ = (unsigned char)(0x80 | n);
+      (void)memcpy(out, src + start, n);
+      out += n;
+      start += n;
+    }
+    if (i == w) { break; }
+
+    const unsigned char value = src[i];
+    start = i;
+    while ((i < w) && (src[i] == value)) { i++; }
+    unsigned int count = i - start;
+    while (count > 0) {
+      const unsigned int n = SbMin(count, 126u);
+      *out++ = (unsigned char) n;
+      *out++ = value;
+      count -= n;
+    }
+  }
+  *out++ = 0;
+  return (unsigned int)(out - dst);
+}
+
+// Writes the image in SGI RGB format. The rows are converted and
+// written one at a time, so there is no need for a copy of the
+// image. Compressed rows are encoded twice, first to find their
+// lengths for the offset tables in front of the image data, and then
+// when they are written.
+SbBool
+SoOffscreenRendererP::writeToRGB(FILE * fp, unsigned int w, unsigned int h,
+                                 unsigned int nrcomponents,
+                                 const uint8_t * imgbuf,
+                                 const SbBool compress)
+{
+  SbBool writeok =
+    SoOffscreenRendererP::writeRGBHeader(fp, w, h, nrcomponents, compress);
 
   unsigned char * tmpbuf = new unsigned char[w];
 
-  SbBool writeok = TRUE;
-  for (unsigned int c = 0; c < nrcomponents; c++) {
-    for (unsigned int y = 0; y < h; y++) {
-      for (unsigned int x = 0; x < w; x++) {
-        tmpbuf[x] = imgbuf[(x + y * w) * nrcomponents + c];
+  if (!compress) {
+    for (unsigned int c = 0; c < nrcomponents; c++) {
+      for (unsigned int y = 0; y < h; y++) {
+        offscreen_get_channel_row(imgbuf, w, nrcomponents, y, c, tmpbuf);
+        writeok = writeok && (fwrite(tmpbuf, 1, w, fp) == w);
       }
-      writeok = writeok && (fwrite(tmpbuf, 1, w, fp) == w);
     }
   }
-
-  if (!writeok) {
-    SoDebugError::postWarning("SoOffscreenRendererP::writeToRGB",
-                              "error when writing RGB file");
+  else {
+    unsigned char * rlebuf = new unsigned char[w + (w + 125) / 126 + 1];
+    const unsigned int numrows = h * nrcomponents;
+    SbList <uint32_t> lengths(numrows);
+    for (unsigned int c = 0; c < nrcomponents; c++) {
+      for (unsigned int y = 0; y < h; y++) {
+        offscreen_get_channel_row(imgbuf, w, nrcomponents, y, c, tmpbuf);
+        lengths.append(offscreen_rle_row(tmpbuf, w, rlebuf));
+      }
+    }
+    // the start table and the length table are indexed by y + c * h,
+    // which is the order the rows are written in
+    uint32_t offset = RGB_HEADERSIZE + numrows * 8;
+    for (unsigned int i = 0; i < numrows; i++) {
+      writeok = writeok && (write_int(fp, offset) == 1);
+      offset += lengths[i];
+    }
+    for (unsigned int i = 0; i < numrows; i++) {
+      writeok = writeok && (write_int(fp, lengths[i]) == 1);
+    }
+    for (unsigned int c = 0; c < nrcomponents && writeok; c++) {
+      for (unsigned int y = 0; y < h && writeok; y++) {
+        offscreen_get_channel_row(imgbuf, w, nrcomponents, y, c, tmpbuf);
+        const unsigned int len = offscreen_rle_row(tmpbuf, w, rlebuf);
+        writeok = (fwrite(rlebuf, 1, len, fp) == len);
+      }
+    }
+    delete [] rlebuf;
   }
 
   delete [] tmpbuf;
@@ -1152,7 +2244,8 @@ SoOffscreenRendererP::writeToRGB(FILE * fp, unsigned int w, unsigned int h,
 
 /*!
   Writes the buffer in SGI RGB format by appending it to the already
-  open file. Returns \c FALSE if writing fails.
+  open file. Returns \c FALSE if writing fails. The image is
+  run-length encoded if setRGBCompression() has been enabled.
 
   Important note: do \e not use this method when the Coin library has
   been compiled as an Microsoft Windows DLL, as passing FILE* instances back
@@ -1166,9 +2259,16 @@ SoOffscreenRenderer::writeToRGB(FILE * fp) const
 
   SbVec2s size = PRIVATE(this)->viewport.getViewportSizePixels();
 
-  return SoOffscreenRendererP::writeToRGB(fp, size[0], size[1],
-                                          this->getComponents(),
-                                          this->getBuffer());
+  const SbBool writeok =
+    SoOffscreenRendererP::writeToRGB(fp, size[0], size[1],
+                                     this->getComponents(),
+                                     this->getBuffer(),
+                                     PRIVATE(this)->rgbcompression);
+  if (!writeok) {
+    SoDebugError::postWarning("SoOffscreenRenderer::writeToRGB",
+                              "error when writing RGB file");
+  }
+  return writeok;
 }
 
 /*!
@@ -1245,13 +2345,39 @@ SoOffscreenRenderer::writeToPostScript(FILE * fp,
   if (SoOffscreenRendererP::offscreenContextsNotSupported()) { return FALSE;}
 
   const SbVec2s size = PRIVATE(this)->viewport.getViewportSizePixels();
-  const int nc = this->getComponents();
+  const SbString header =
+    SoOffscreenRendererP::postScriptHeader(size, this->getComponents(), printsize);
+  (void)fputs(header.getString(), fp);
+  return SoOffscreenRendererP::writePostScriptData(fp, size[0], size[1],
+                                                   this->getComponents(),
+                                                   this->getBuffer());
+}
+
+static void
+offscreen_append(SbString & str, const char * formatstr, ...)
+{
+  SbString line;
+  va_list args;
+  va_start(args, formatstr);
+  line.vsprintf(formatstr, args);
+  va_end(args);
+  str += line;
+}
+
+// Returns the PostScript header for an image of the given size,
+// including the image operator. It's made separately from the image
+// data, as the locale is set for the whole process while the floating
+// point values are formatted.
+SbString
+SoOffscreenRendererP::postScriptHeader(const SbVec2s & size,
+                                       const unsigned int nc,
+                                       const SbVec2f & printsize)
+{
   const float defaultdpi = 72.0f; // we scale against this value
-  const float dpi = this->getScreenPixelsPerInch();
+  const float dpi = SoOffscreenRenderer::getScreenPixelsPerInch();
   const SbVec2s pixelsize((short)(printsize[0]*defaultdpi),
                           (short)(printsize[1]*defaultdpi));
 
-  const unsigned char * src = this->getBuffer();
   const int chan = nc <= 2 ? 1 : 3;
   const SbVec2s scaledsize((short) ceil(size[0]*defaultdpi/dpi),
                            (short) ceil(size[1]*defaultdpi/dpi));
@@ -1259,49 +2385,62 @@ SoOffscreenRenderer::writeToPostScript(FILE * fp,
   cc_string storedlocale;
   SbBool changed = coin_locale_set_portable(&storedlocale);
 
-  fprintf(fp, "%%!PS-Adobe-2.0 EPSF-1.2\n");
-  fprintf(fp, "%%%%BoundingBox: 0 %d %d %d\n",
-          pixelsize[1]-scaledsize[1],
-          scaledsize[0],
-          pixelsize[1]);
-  fprintf(fp, "%%%%Creator: Coin <https://github.com/coin3d/>\n");
-  fprintf(fp, "%%%%EndComments\n");
+  SbString s;
+  offscreen_append(s, "%%!PS-Adobe-2.0 EPSF-1.2\n");
+  offscreen_append(s, "%%%%BoundingBox: 0 %d %d %d\n",
+                   pixelsize[1]-scaledsize[1],
+                   scaledsize[0],
+                   pixelsize[1]);
+  offscreen_append(s, "%%%%Creator: Coin <https://github.com/coin3d/>\n");
+  offscreen_append(s, "%%%%EndComments\n");
+
+  offscreen_append(s, "\n");
+  offscreen_append(s, "/origstate save def\n");
+  offscreen_append(s, "\n");
+  offscreen_append(s, "%% workaround for bug in some PS interpreters\n");
+  offscreen_append(s, "%% which doesn't skip the ASCII85 EOD marker.\n");
+  offscreen_append(s, "/~ {currentfile read pop pop} def\n\n");
+  offscreen_append(s, "/image_wd %d def\n", size[0]);
+  offscreen_append(s, "/image_ht %d def\n", size[1]);
+  offscreen_append(s, "/pos_wd %d def\n", size[0]);
+  offscreen_append(s, "/pos_ht %d def\n", size[1]);
+  offscreen_append(s, "/image_dpi %g def\n", dpi);
+  offscreen_append(s, "/image_scale %g image_dpi div def\n", defaultdpi);
+  offscreen_append(s, "/image_chan %d def\n", chan);
+  offscreen_append(s, "/xpos_offset 0 image_scale mul def\n");
+  offscreen_append(s, "/ypos_offset 0 image_scale mul def\n");
+  offscreen_append(s, "/pix_buf_size %d def\n\n", size[0]*chan);
+  offscreen_append(s, "/page_ht %g %g mul def\n", printsize[1], defaultdpi);
+  offscreen_append(s, "/page_wd %g %g mul def\n", printsize[0], defaultdpi);
+  offscreen_append(s, "/image_xpos 0 def\n");
+  offscreen_append(s, "/image_ypos page_ht pos_ht image_scale mul sub def\n");
+  offscreen_append(s, "image_xpos xpos_offset add image_ypos ypos_offset add translate\n");
+  offscreen_append(s, "\n");
+  offscreen_append(s, "/pix pix_buf_size string def\n");
+  offscreen_append(s, "image_wd image_scale mul image_ht image_scale mul scale\n");
+  offscreen_append(s, "\n");
+  offscreen_append(s, "image_wd image_ht 8\n");
+  offscreen_append(s, "[image_wd 0 0 image_ht 0 0]\n");
+  offscreen_append(s, "currentfile\n");
+  offscreen_append(s, "/ASCII85Decode filter\n");
+  // offscreen_append(s, "/RunLengthDecode filter\n"); // FIXME: add later. 2003???? pederb.
+  if (chan == 3) offscreen_append(s, "false 3\ncolorimage\n");
+  else offscreen_append(s, "image\n");
 
-  fprintf(fp, "\n");
-  fprintf(fp, "/origstate save def\n");
-  fprintf(fp, "\n");
-  fprintf(fp, "%% workaround for bug in some PS interpreters\n");
-  fprintf(fp, "%% which doesn't skip the ASCII85 EOD marker.\n");
-  fprintf(fp, "/~ {currentfile read pop pop} def\n\n");
-  fprintf(fp, "/image_wd %d def\n", size[0]);
-  fprintf(fp, "/image_ht %d def\n", size[1]);
-  fprintf(fp, "/pos_wd %d def\n", size[0]);
-  fprintf(fp, "/pos_ht %d def\n", size[1]);
-  fprintf(fp, "/image_dpi %g def\n", dpi);
-  fprintf(fp, "/image_scale %g image_dpi div def\n", defaultdpi);
-  fprintf(fp, "/image_chan %d def\n", chan);
-  fprintf(fp, "/xpos_offset 0 image_scale mul def\n");
-  fprintf(fp, "/ypos_offset 0 image_scale mul def\n");
-  fprintf(fp, "/pix_buf_size %d def\n\n", size[0]*chan);
-  fprintf(fp, "/page_ht %g %g mul def\n", printsize[1], defaultdpi);
-  fprintf(fp, "/page_wd %g %g mul def\n", printsize[0], defaultdpi);
-  fprintf(fp, "/image_xpos 0 def\n");
-  fprintf(fp, "/image_ypos page_ht pos_ht image_scale mul sub def\n");
-  fprintf(fp, "image_xpos xpos_offset add image_ypos ypos_offset add translate\n");
-  fprintf(fp, "\n");
-  fprintf(fp, "/pix pix_buf_size string def\n");
-  fprintf(fp, "image_wd image_scale mul image_ht image_scale mul scale\n");
-  fprintf(fp, "\n");
-  fprintf(fp, "image_wd image_ht 8\n");
-  fprintf(fp, "[image_wd 0 0 image_ht 0 0]\n");
-  fprintf(fp, "currentfile\n");
-  fprintf(fp, "/ASCII85Decode filter\n");
-  // fprintf(fp, "/RunLengthDecode filter\n"); // FIXME: add later. 2003???? pederb.
-  if (chan == 3) fprintf(fp, "false 3\ncolorimage\n");
-  else fprintf(fp,"image\n");
+  if (changed) { coin_locale_reset(&storedlocale); }
 
+  return s;
+}
+
+// Writes the image data and the trailer which follow the header from
+// postScriptHeader(). Doesn't depend on the locale, so it can be used
+// from any thread.
+SbBool
+SoOffscreenRendererP::writePostScriptData(FILE * fp, unsigned int w, unsigned int h,
+                                          unsigned int nc, const uint8_t * src)
+{
   const int rowlen = 72;
-  int num = size[0] * size[1];
+  int num = w * h;
   unsigned char tuple[4];
   unsigned char linebuf[rowlen+5];
   int tuplecnt = 0;
@@ -1340,8 +2479,6 @@ SoOffscreenRenderer::writeToPostScript(FILE * fp,
   fprintf(fp, "\n");
   fprintf(fp, "%%%%EOF\n");
 
-  if (changed) { coin_locale_reset(&storedlocale); }
-
   return (SbBool) (ferror(fp) == 0);
 }
 
@@ -1612,6 +2749,366 @@ SoOffscreenRenderer::writeToFile(const SbString & filename, const SbName & filet
 
 // *************************************************************************
 
+/*!
+  Sets whether or not writeToRGB() and scheduleWriteToRGB() should
+  run-length encode the image data, which is the compression the SGI
+  RGB format supports. Compression is off by default.
+
+  Images written by renderToRGB() are never compressed.
+
+  \sa getRGBCompression()
+  \since Coin 4.0
+*/
+void
+SoOffscreenRenderer::setRGBCompression(const SbBool enable)
+{
+  PRIVATE(this)->rgbcompression = enable;
+}
+
+/*!
+  Returns whether or not SGI RGB files are compressed.
+
+  \sa setRGBCompression()
+  \since Coin 4.0
+*/
+SbBool
+SoOffscreenRenderer::getRGBCompression(void) const
+{
+  return PRIVATE(this)->rgbcompression;
+}
+
+/*!
+  Schedules writing the offscreen buffer in SGI RGB format to the file
+  \a filename, and returns immediately, so the next frame can be
+  rendered while the file is written. This is useful when rendering
+  frames for movies:
+
+  \code
+   for (int i=0; i < NRFRAMES; i++) {
+     // [...reposition camera here, if necessary...]
+     offscreenrend->render(root);
+
+     SbString framefile;
+     framefile.sprintf("frame%06d.rgb", i);
+     offscreenrend->scheduleWriteToRGB(framefile.getString());
+   }
+   SbBool ok = offscreenrend->waitForScheduledWrites();
+  \endcode
+
+  The scheduled write takes over the buffer holding the image, so
+  there is no need to copy the image. getBuffer() still returns the
+  image after this call, but in a different buffer, so a pointer
+  returned from getBuffer() before the call must not be used
+  afterwards.
+
+  The files are written by setNumWriteThreads() threads. If
+  setMaxScheduledWrites() writes are already waiting or being written,
+  this call blocks until one of them has finished.
+
+  Returns \c FALSE if there is no image to write. Errors when writing
+  the file are reported by waitForScheduledWrites().
+
+  \sa writeToRGB(), waitForScheduledWrites()
+  \since Coin 4.0
+*/
+SbBool
+SoOffscreenRenderer::scheduleWriteToRGB(const char * filename)
+{
+  SoOffscreenWriteJob * job = new SoOffscreenWriteJob(PRIVATE(this));
+  job->format = SoOffscreenWriteJob::RGB;
+  job->filename = filename;
+  job->compress = PRIVATE(this)->rgbcompression;
+  return PRIVATE(this)->scheduleWrite(job);
+}
+
+/*!
+  Schedules writing the offscreen buffer in PostScript format to the
+  file \a filename, with a page size of 8.5 x 11 inches.
+
+  \sa scheduleWriteToRGB(), writeToPostScript()
+  \since Coin 4.0
+*/
+SbBool
+SoOffscreenRenderer::scheduleWriteToPostScript(const char * filename)
+{
+  return this->scheduleWriteToPostScript(filename, SbVec2f(8.5f, 11.0f));
+}
+
+/*!
+  Schedules writing the offscreen buffer in PostScript format to the
+  file \a filename, with \a printsize dimensions.
+
+  \sa scheduleWriteToRGB(), writeToPostScript()
+  \since Coin 4.0
+*/
+SbBool
+SoOffscreenRenderer::scheduleWriteToPostScript(const char * filename,
+                                               const SbVec2f & printsize)
+{
+  if (SoOffscreenRendererP::offscreenContextsNotSupported()) { return FALSE; }
+
+  SoOffscreenWriteJob * job = new SoOffscreenWriteJob(PRIVATE(this));
+  job->format = SoOffscreenWriteJob::POSTSCRIPT;
+  job->filename = filename;
+  job->header =
+    SoOffscreenRendererP::postScriptHeader(PRIVATE(this)->viewport.getViewportSizePixels(),
+                                           this->getComponents(), printsize);
+  return PRIVATE(this)->scheduleWrite(job);
+}
+
+/*!
+  Schedules writing the offscreen buffer to the file \a filename, in
+  the format given by \a filetypeextension. See writeToFile() about
+  the supported formats.
+
+  \sa scheduleWriteToRGB(), writeToFile(), isWriteSupported()
+  \since Coin 4.0
+*/
+SbBool
+SoOffscreenRenderer::scheduleWriteToFile(const SbString & filename,
+                                         const SbName & filetypeextension)
+{
+  if (!simage_wrapper()->versionMatchesAtLeast(1,1,0)) {
+    // writeToFile() reports why the file can't be written
+    return this->writeToFile(filename, filetypeextension);
+  }
+
+  SoOffscreenWriteJob * job = new SoOffscreenWriteJob(PRIVATE(this));
+  job->format = SoOffscreenWriteJob::SIMAGE;
+  job->filename = filename;
+  job->filetype = filetypeextension.getString();
+  return PRIVATE(this)->scheduleWrite(job);
+}
+
+/*!
+  Waits until all the scheduled writes have finished. Returns \c FALSE
+  if any of the files couldn't be written since the last call, and
+  posts a warning for each of them.
+
+  \sa scheduleWriteToRGB()
+  \since Coin 4.0
+*/
+SbBool
+SoOffscreenRenderer::waitForScheduledWrites(void)
+{
+  return PRIVATE(this)->waitForScheduledWrites();
+}
+
+/*!
+  Sets the number of threads used to write the files of the
+  scheduleWriteTo*() methods. The default is 1, or the value of the
+  environment variable COIN_OFFSCREENRENDERER_WRITE_THREADS. More
+  threads help when encoding a frame takes longer than rendering it,
+  e.g. for compressed formats.
+
+  The files are always written by the calling thread if Coin was built
+  without thread support.
+
+  \sa setMaxScheduledWrites()
+  \since Coin 4.0
+*/
+void
+SoOffscreenRenderer::setNumWriteThreads(const int num)
+{
+  PRIVATE(this)->numwritethreads = SbMax(num, 1);
+#ifdef HAVE_THREADS
+  if (PRIVATE(this)->writesched) {
+    cc_sched_set_num_threads(PRIVATE(this)->writesched,
+                             PRIVATE(this)->numwritethreads);
+  }
+#endif // HAVE_THREADS
+}
+
+/*!
+  Returns the number of threads used for scheduled writes.
+
+  \sa setNumWriteThreads()
+  \since Coin 4.0
+*/
+int
+SoOffscreenRenderer::getNumWriteThreads(void) const
+{
+  return PRIVATE(this)->numwritethreads;
+}
+
+/*!
+  Sets the maximum number of scheduled writes which can wait or be in
+  progress at the same time. Each of them holds a full image in
+  memory. The default is 4.
+
+  \sa scheduleWriteToRGB()
+  \since Coin 4.0
+*/
+void
+SoOffscreenRenderer::setMaxScheduledWrites(const int num)
+{
+  LOCK_WRITES(PRIVATE(this));
+  PRIVATE(this)->maxscheduledwrites = SbMax(num, 1);
+  UNLOCK_WRITES(PRIVATE(this));
+}
+
+/*!
+  Returns the maximum number of scheduled writes.
+
+  \sa setMaxScheduledWrites()
+  \since Coin 4.0
+*/
+int
+SoOffscreenRenderer::getMaxScheduledWrites(void) const
+{
+  return PRIVATE(this)->maxscheduledwrites;
+}
+
+// Writes the file. Runs in one of the write threads, so it must not
+// post any messages.
+SbBool
+SoOffscreenWriteJob::write(void) const
+{
+  if (this->format == SIMAGE) {
+    const int ret =
+      simage_wrapper()->simage_save_image(this->filename.getString(),
+                                          this->buffer,
+                                          int(this->size[0]), int(this->size[1]),
+                                          int(this->nrcomponents),
+                                          this->filetype.getString());
+    return ret ? TRUE : FALSE;
+  }
+
+  FILE * fp = fopen(this->filename.getString(), "wb");
+  if (!fp) { return FALSE; }
+
+  SbBool ok;
+  if (this->format == RGB) {
+    ok = SoOffscreenRendererP::writeToRGB(fp, this->size[0], this->size[1],
+                                          this->nrcomponents, this->buffer,
+                                          this->compress);
+  }
+  else {
+    ok = (fputs(this->header.getString(), fp) >= 0) &&
+      SoOffscreenRendererP::writePostScriptData(fp, this->size[0], this->size[1],
+                                                this->nrcomponents, this->buffer);
+  }
+  return (fclose(fp) == 0) && ok;
+}
+
+// Hands the current image over to the job, and schedules it. Blocks
+// while maxscheduledwrites jobs are waiting or being written.
+SbBool
+SoOffscreenRendererP::scheduleWrite(SoOffscreenWriteJob * job)
+{
+  // getBuffer() reads the image from the GL context, if necessary
+  job->buffer = SoOffscreenRendererP::offscreenContextsNotSupported() ?
+    NULL : PUBLIC(this)->getBuffer();
+  if (job->buffer == NULL) {
+    delete job;
+    return FALSE;
+  }
+  const SbVec2s size = this->viewport.getViewportSizePixels();
+  job->size[0] = size[0];
+  job->size[1] = size[1];
+  job->nrcomponents = (unsigned int) this->components;
+  job->buffersize = this->bufferbytesize;
+  job->ok = FALSE;
+
+#ifdef HAVE_THREADS
+  LOCK_WRITES(this);
+  while (this->numscheduledwrites >= this->maxscheduledwrites) {
+    (void)cc_condvar_wait(this->writecond, this->writemutex);
+  }
+  this->numscheduledwrites++;
+  // the next rendering gets the buffer of a finished job, if any
+  this->buffer = NULL;
+  this->bufferbytesize = 0;
+  if (this->freebuffers.getLength() > 0) {
+    this->buffer = this->freebuffers.pop();
+    this->bufferbytesize = this->freebuffersizes.pop();
+  }
+  if (this->writesched == NULL) {
+    this->writesched = cc_sched_construct(this->numwritethreads);
+  }
+  // higher priorities run first, so this writes the files in order
+  const float priority = -float(this->writesequence++);
+  UNLOCK_WRITES(this);
+
+  // getBuffer() still returns the image until the next rendering. It
+  // is read from the GL context again when asked for, or copied if it
+  // was made by tiled rendering.
+  if (this->bufferbytesize < job->buffersize) {
+    delete[] this->buffer;
+    this->buffer = new unsigned char[job->buffersize];
+    this->bufferbytesize = job->buffersize;
+  }
+  if (this->canreadbuffer) {
+    this->didreadbuffer = FALSE;
+  }
+  else {
+    (void)memcpy(this->buffer, job->buffer,
+                 size_t(size[0]) * size_t(size[1]) * job->nrcomponents);
+  }
+
+  (void)cc_sched_schedule(this->writesched,
+                          SoOffscreenRendererP::writeJobEntry, job, priority);
+#else // HAVE_THREADS
+  this->numscheduledwrites++;
+  job->ok = job->write();
+  this->finishWrite(job);
+#endif // !HAVE_THREADS
+  return TRUE;
+}
+
+#ifdef HAVE_THREADS
+void
+SoOffscreenRendererP::writeJobEntry(void * closure)
+{
+  SoOffscreenWriteJob * job = (SoOffscreenWriteJob *) closure;
+  job->ok = job->write();
+  job->owner->finishWrite(job);
+}
+#endif // HAVE_THREADS
+
+// Called when a job is done. Keeps the buffer for later renderings.
+void
+SoOffscreenRendererP::finishWrite(SoOffscreenWriteJob * job)
+{
+  LOCK_WRITES(this);
+#ifdef HAVE_THREADS
+  this->freebuffers.append(job->buffer);
+  this->freebuffersizes.append(job->buffersize);
+#else // HAVE_THREADS
+  // the image buffer wasn't handed over to the job
+#endif // !HAVE_THREADS
+  if (!job->ok) { this->failedwrites.append(job->filename); }
+  this->numscheduledwrites--;
+#ifdef HAVE_THREADS
+  cc_condvar_wake_all(this->writecond);
+#endif // HAVE_THREADS
+  UNLOCK_WRITES(this);
+  delete job;
+}
+
+SbBool
+SoOffscreenRendererP::waitForScheduledWrites(void)
+{
+  LOCK_WRITES(this);
+#ifdef HAVE_THREADS
+  while (this->numscheduledwrites > 0) {
+    (void)cc_condvar_wait(this->writecond, this->writemutex);
+  }
+#endif // HAVE_THREADS
+  SbList <SbString> failed(this->failedwrites);
+  this->failedwrites.truncate(0);
+  UNLOCK_WRITES(this);
+
+  for (int i = 0; i < failed.getLength(); i++) {
+    SoDebugError::postWarning("SoOffscreenRenderer::waitForScheduledWrites",
+                              "error when writing file '%s'",
+                              failed[i].getString());
+  }
+  return (failed.getLength() == 0);
+}
+
+// *************************************************************************
+
 /*!
   Control whether or not SoOffscreenRenderer can use the "pbuffer"
   feature of OpenGL to render the scenes with hardware acceleration.
@@ -1665,9 +3162,11 @@ SoOffscreenRenderer::getPbufferEnable(void) const
 // FIXME: this should really be done by SoCamera, on the basis of data
 // from an "SoTileRenderingElement". See BUGS.txt, item #121. 20050712 mortene.
 void
-SoOffscreenRendererP::setCameraViewvolForTile(SoCamera * cam)
+SoOffscreenRendererP::setCameraViewvolForTile(SoOffscreenTileWorker * worker,
+                                              SoCamera * cam)
 {
-  SoState * state = (PUBLIC(this)->getGLRenderAction())->getState();
+  SoGLRenderAction * renderaction = worker->renderaction;
+  SoState * state = renderaction->getState();
 
   // A small trick to change the aspect ratio without changing the
   // scene graph camera.
@@ -1708,10 +3207,10 @@ SoOffscreenRendererP::setCameraViewvolForTile(SoCamera * cam)
     break;
   }
 
-  const int LEFTINTPOS = (this->currenttile[0] * this->glcanvassize[0]) - vporigin[0];
-  const int RIGHTINTPOS = LEFTINTPOS + this->subsize[0];
-  const int TOPINTPOS = (this->currenttile[1] * this->glcanvassize[1]) - vporigin[1];
-  const int BOTTOMINTPOS = TOPINTPOS + this->subsize[1];
+  const int LEFTINTPOS = (worker->currenttile[0] * this->glcanvassize[0]) - vporigin[0];
+  const int RIGHTINTPOS = LEFTINTPOS + worker->subsize[0];
+  const int TOPINTPOS = (worker->currenttile[1] * this->glcanvassize[1]) - vporigin[1];
+  const int BOTTOMINTPOS = TOPINTPOS + worker->subsize[1];
 
   const SbVec2s fullsize = this->viewport.getViewportSizePixels();
   const float left = float(LEFTINTPOS) / float(fullsize[0]);
@@ -1724,7 +3223,7 @@ SoOffscreenRendererP::setCameraViewvolForTile(SoCamera * cam)
   if (CoinOffscreenGLCanvas::debug()) {
     SoDebugError::postInfo("SoOffscreenRendererP::setCameraViewvolForTile",
                            "narrowing for tile <%d, %d>: <%f, %f> - <%f, %f>",
-                           this->currenttile[0], this->currenttile[1],
+                           worker->currenttile[0], worker->currenttile[1],
                            left, bottom, right, top);
   }
 
@@ -1777,5 +3276,286 @@ SoOffscreenRendererP::offscreenContextsNotSupported(void)
 
 // *************************************************************************
 
+#undef LOCK_TILES
+#undef UNLOCK_TILES
+#undef LOCK_WRITES
+#undef UNLOCK_WRITES
+#undef LOCK_BATCH
+#undef UNLOCK_BATCH
+#undef LOCK_CONTEXT
+#undef UNLOCK_CONTEXT
+#undef LOCK_TRAVERSAL
+#undef UNLOCK_TRAVERSAL
+#undef RGB_HEADERSIZE
 #undef PRIVATE
 #undef PUBLIC
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/C/tidbits.h>
+#include <Inventor/SbRotation.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/lists/SoNodeList.h>
+#include <Inventor/nodes/SoBaseColor.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoDirectionalLight.h>
+#include <Inventor/nodes/SoLightModel.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoTransform.h>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// reads the whole file, returns the number of bytes or -1
+long
+offscreen_read_file(const char * filename, unsigned char * bytes,
+                    const long maxsize)
+{
+  FILE * fp = fopen(filename, "rb");
+  if (!fp) return -1;
+  const long size = (long) fread(bytes, 1, maxsize, fp);
+  fclose(fp);
+  return size;
+}
+
+} // namespace
+
+// The image must still be available from getBuffer() after the
+// scheduled writes have taken over the buffer it was rendered into.
+BOOST_AUTO_TEST_CASE(scheduledWritesKeepBuffer)
+{
+  static const char * filenames[2] = {
+    "SoOffscreenRenderer_test0.rgb", "SoOffscreenRenderer_test1.rgb"
+  };
+  const int width = 64, height = 32;
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+
+  SoOffscreenRenderer renderer(SbViewportRegion(width, height));
+  renderer.setComponents(SoOffscreenRenderer::RGB);
+  renderer.setBackgroundColor(SbColor(0.2f, 0.4f, 0.6f));
+  if (!renderer.render(root)) {
+    BOOST_TEST_MESSAGE("no offscreen context, skipping scheduledWritesKeepBuffer test");
+    root->unref();
+    return;
+  }
+
+  BOOST_CHECK(renderer.scheduleWriteToRGB(filenames[0]));
+  BOOST_CHECK(renderer.scheduleWriteToRGB(filenames[1]));
+  const unsigned char * buffer = renderer.getBuffer();
+  BOOST_REQUIRE(buffer != NULL);
+  int wrong = 0;
+  for (int i = 0; i < width * height; i++) {
+    if (abs(buffer[i * 3] - 51) > 1 || abs(buffer[i * 3 + 1] - 102) > 1 ||
+        abs(buffer[i * 3 + 2] - 153) > 1) wrong++;
+  }
+  BOOST_CHECK_MESSAGE(wrong == 0,
+                      wrong << " pixels of the image from getBuffer() are wrong");
+  BOOST_CHECK(renderer.waitForScheduledWrites());
+
+  // both files hold the image
+  const long maxsize = 1024 + width * height * 3;
+  unsigned char * files[2] = {
+    new unsigned char[maxsize], new unsigned char[maxsize]
+  };
+  const long size0 = offscreen_read_file(filenames[0], files[0], maxsize);
+  const long size1 = offscreen_read_file(filenames[1], files[1], maxsize);
+  BOOST_CHECK(size0 > width * height * 3);
+  BOOST_CHECK_EQUAL(size0, size1);
+  BOOST_CHECK(size0 == size1 && memcmp(files[0], files[1], size0) == 0);
+  delete[] files[0];
+  delete[] files[1];
+  (void)remove(filenames[0]);
+  (void)remove(filenames[1]);
+
+  root->unref();
+}
+
+namespace {
+
+const int BATCH_NUMVIEWS = 6;
+
+// what the batch callback saw of each view
+struct BatchView {
+  int calls;
+  SbVec2s size;
+  int cubepixels; // red pixels
+  int otherpixels; // pixels with the background color
+};
+
+void
+batch_view_cb(void * userdata, SoOffscreenRenderer * renderer,
+              const int view, const SbTime & rendertime)
+{
+  BatchView & result = static_cast<BatchView *>(userdata)[view];
+  BOOST_CHECK(rendertime >= SbTime::zero());
+  result.calls++;
+  result.size = renderer->getViewportRegion().getViewportSizePixels();
+  const unsigned char * buffer = renderer->getBuffer();
+  result.cubepixels = result.otherpixels = 0;
+  for (int i = 0; i < result.size[0] * result.size[1]; i++) {
+    const unsigned char * pixel = buffer + i * 3;
+    if (pixel[0] == 255 && pixel[1] == 0 && pixel[2] == 0) result.cubepixels++;
+    else if (pixel[0] == 0 && pixel[1] == 0 && pixel[2] == 255) result.otherpixels++;
+  }
+}
+
+} // namespace
+
+// Renders a red cube with cameras of different sizes, of which every
+// other one looks away from the cube, and checks that each view is
+// handed to the callback once, with its own size and image, both with
+// one and with several render threads.
+BOOST_AUTO_TEST_CASE(renderBatch)
+{
+  SoSeparator * scene = new SoSeparator;
+  scene->ref();
+  SoLightModel * lightmodel = new SoLightModel;
+  lightmodel->model = SoLightModel::BASE_COLOR;
+  scene->addChild(lightmodel);
+  SoBaseColor * color = new SoBaseColor;
+  color->rgb.setValue(1.0f, 0.0f, 0.0f);
+  scene->addChild(color);
+  scene->addChild(new SoCube);
+
+  SoNodeList cameras;
+  SbList <SbViewportRegion> regions;
+  for (int i = 0; i < BATCH_NUMVIEWS; i++) {
+    SoOrthographicCamera * camera = new SoOrthographicCamera;
+    // the cube fills the middle half of the views looking at it
+    camera->height = 4.0f;
+    camera->position.setValue((i & 1) ? 100.0f : 0.0f, 0.0f, 10.0f);
+    cameras.append(camera);
+    regions.append(SbViewportRegion(32 + 16 * i, 32 + 8 * (i % 3)));
+  }
+
+  SoOffscreenRenderer renderer(SbViewportRegion(32, 32));
+  renderer.setComponents(SoOffscreenRenderer::RGB);
+  renderer.setBackgroundColor(SbColor(0.0f, 0.0f, 1.0f));
+  if (!renderer.render(scene)) {
+    BOOST_TEST_MESSAGE("no offscreen context, skipping renderBatch test");
+    scene->unref();
+    return;
+  }
+
+  for (int numthreads = 1; numthreads <= 3; numthreads += 2) {
+    renderer.setNumRenderThreads(numthreads);
+    BatchView views[BATCH_NUMVIEWS];
+    memset(views, 0, sizeof(views));
+    BOOST_CHECK(renderer.renderBatch(scene, cameras, regions, batch_view_cb, views));
+    for (int i = 0; i < BATCH_NUMVIEWS; i++) {
+      const BatchView & view = views[i];
+      BOOST_CHECK_EQUAL(view.calls, 1);
+      BOOST_CHECK_MESSAGE(view.size == regions[i].getViewportSizePixels(),
+                          "view " << i << " has the wrong size with " <<
+                          numthreads << " threads");
+      const int numpixels = view.size[0] * view.size[1];
+      // the aspect ratio decides whether the height or the width of
+      // the view spans the cube's half of the camera's view volume
+      const int minside = SbMin(view.size[0], view.size[1]);
+      const int expected = (i & 1) ? 0 : (minside / 2) * (minside / 2);
+      BOOST_CHECK_MESSAGE(abs(view.cubepixels - expected) <= 2 * minside,
+                          "view " << i << " with " << numthreads <<
+                          " threads has " << view.cubepixels <<
+                          " cube pixels, not " << expected);
+      BOOST_CHECK_MESSAGE(view.cubepixels + view.otherpixels == numpixels,
+                          "view " << i << " with " << numthreads <<
+                          " threads has pixels of other colors");
+    }
+  }
+  // the renderer's own viewport is back after the batch
+  BOOST_CHECK(renderer.getViewportRegion().getViewportSizePixels() == SbVec2s(32, 32));
+
+  scene->unref();
+}
+
+
+// Renders a lit scene in one pass, and then in tiles that don't
+// divide the image evenly, with one and with several render threads,
+// and with renderToRGB(). All the tiled images must be identical to
+// the one rendered in one pass.
+BOOST_AUTO_TEST_CASE(tiledEqualsSinglePass)
+{
+  static const char * filenames[2] = {
+    "SoOffscreenRenderer_single.rgb", "SoOffscreenRenderer_tiled.rgb"
+  };
+  const int width = 100, height = 70;
+  const SbViewportRegion region(width, height);
+
+  SoSeparator * scene = new SoSeparator;
+  scene->ref();
+  SoPerspectiveCamera * camera = new SoPerspectiveCamera;
+  scene->addChild(camera);
+  scene->addChild(new SoDirectionalLight);
+  SoMaterial * material = new SoMaterial;
+  material->diffuseColor.setValue(0.8f, 0.5f, 0.2f);
+  material->specularColor.setValue(1.0f, 1.0f, 1.0f);
+  material->shininess = 0.5f;
+  scene->addChild(material);
+  SoTransform * transform = new SoTransform;
+  transform->rotation.setValue(SbRotation(SbVec3f(1.0f, 1.0f, 0.0f), 0.6f));
+  scene->addChild(transform);
+  scene->addChild(new SoCube);
+  SoTransform * translation = new SoTransform;
+  translation->translation.setValue(2.0f, 0.0f, 0.0f);
+  scene->addChild(translation);
+  scene->addChild(new SoSphere);
+  camera->viewAll(scene, region);
+
+  SoOffscreenRenderer single(region);
+  single.setComponents(SoOffscreenRenderer::RGB);
+  if (!single.render(scene)) {
+    BOOST_TEST_MESSAGE("no offscreen context, skipping tiledEqualsSinglePass test");
+    scene->unref();
+    return;
+  }
+  const int numbytes = width * height * 3;
+  unsigned char * reference = new unsigned char[numbytes];
+  memcpy(reference, single.getBuffer(), numbytes);
+  BOOST_CHECK(single.writeToRGB(filenames[0]));
+
+  // 4x3 tiles, of which the last column and row are partial
+  (void)coin_setenv("COIN_OFFSCREENRENDERER_MAX_TILESIZE", "32", 1);
+  SoOffscreenRenderer tiled(region);
+  tiled.setComponents(SoOffscreenRenderer::RGB);
+  for (int numthreads = 1; numthreads <= 3; numthreads += 2) {
+    tiled.setNumRenderThreads(numthreads);
+    BOOST_CHECK(tiled.render(scene));
+    int numwrong = 0;
+    const unsigned char * buffer = tiled.getBuffer();
+    for (int i = 0; i < numbytes; i++) {
+      if (buffer[i] != reference[i]) numwrong++;
+    }
+    BOOST_CHECK_MESSAGE(numwrong == 0, numwrong << " bytes of the image tiled with " <<
+                        numthreads << " threads differ from the single pass image");
+
+    BOOST_CHECK(tiled.renderToRGB(scene, filenames[1]));
+    const long maxsize = 1024 + numbytes;
+    unsigned char * files[2] = {
+      new unsigned char[maxsize], new unsigned char[maxsize]
+    };
+    const long size0 = offscreen_read_file(filenames[0], files[0], maxsize);
+    const long size1 = offscreen_read_file(filenames[1], files[1], maxsize);
+    BOOST_CHECK(size0 > numbytes);
+    BOOST_CHECK_MESSAGE(size0 == size1 && memcmp(files[0], files[1], size0) == 0,
+                        "the file written in tiles with " << numthreads <<
+                        " threads differs from the single pass image");
+    delete[] files[0];
+    delete[] files[1];
+  }
+  coin_unsetenv("COIN_OFFSCREENRENDERER_MAX_TILESIZE");
+
+  (void)remove(filenames[0]);
+  (void)remove(filenames[1]);
+  delete[] reference;
+  scene->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -67,6 +67,7 @@
 #include <Inventor/elements/SoLazyElement.h>
 #include <Inventor/actions/SoGLRenderAction.h>
 #include <Inventor/actions/SoAudioRenderAction.h>
+#include <Inventor/engines/SoEngineScheduler.h>
 #include <Inventor/actions/SoGLRenderAction.h>
 #include <Inventor/sensors/SoOneShotSensor.h>
 #include <Inventor/fields/SoSFTime.h>
@@ -655,6 +656,11 @@ SoRenderManager::render(SoGLRenderAction * action,
                         const SbBool clearzbuffer)
 {
   SbBool clearwindow_tmp = clearwindow; // make sure we only clear the color buffer once
+
+  // evaluate the engines dirtied since the last frame in one pass,
+  // instead of on demand during traversal
+  if (SoEngineScheduler::isEnabled()) SoEngineScheduler::evaluateDirtyEngines();
+
   PRIVATE(this)->invokePreRenderCallbacks();
 
   if (PRIVATE(this)->superimpositions) {
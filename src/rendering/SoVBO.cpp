@@ -54,6 +54,7 @@
 #include <Inventor/errors/SoDebugError.h>
 
 #include "rendering/SoVertexArrayIndexer.h"
+#include "profiler/SoProfilerCountersP.h"
 #include "threads/threadsutilp.h"
 #include "glue/glp.h"
 #include "tidbitsp.h"
@@ -315,6 +316,7 @@ SoVBO::bindBuffer(uint32_t contextid)
                            this->data,
                            this->usage);
     this->vbohash.put(contextid, buffer);
+    SoProfilerCountersP::count(SoProfilerCounters::VBO_UPLOADS);
   }
   else {
     // buffer already exists, bind it
@@ -33,10 +33,13 @@
 #include "CoinOffscreenGLCanvas.cpp"
 #include "SoGL.cpp"
 #include "SoGLBigImage.cpp"
+#include "SoGLBigImageTiles.cpp"
 #include "SoGLCubeMapImage.cpp"
 #include "SoGLDriverDatabase.cpp"
+#include "SoGLGlyphAtlas.cpp"
 #include "SoGLImage.cpp"
 #include "SoGLNurbs.cpp"
+#include "SoGLTextureAtlas.cpp"
 #include "SoOffscreenCGData.cpp"
 #include "SoOffscreenGLXData.cpp"
 #include "SoOffscreenRenderer.cpp"
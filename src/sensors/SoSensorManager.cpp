@@ -107,7 +107,7 @@
 #include <Inventor/threads/SbMutex.h>
 #endif // COIN_THREADSAFE
 
-#include "misc/SbHash.h"
+#include "misc/SbFlatHash.h"
 #include "coindefs.h" // COIN_STUB()
 
 // *************************************************************************
@@ -156,9 +156,9 @@ public:
   // instead. 20050520 mortene.
 
   // stores sensors that has been triggered in processDelayQueue().
-  SbHash<SoDelayQueueSensor *, SoDelayQueueSensor *> triggerdict;
+  SbFlatHash<SoDelayQueueSensor *, SoDelayQueueSensor *> triggerdict;
   // temporary storage for idle sensors during processing
-  SbHash<SoDelayQueueSensor *, SoDelayQueueSensor *> reinsertdict;
+  SbFlatHash<SoDelayQueueSensor *, SoDelayQueueSensor *> reinsertdict;
 
   void (*queueChangedCB)(void *);
   void * queueChangedCBData;
@@ -624,7 +624,7 @@ SoSensorManager::processDelayQueue(SbBool isidle)
   // was an idle sensor, or because the sensor had already been
   // triggered
   for(
-      SbHash<SoDelayQueueSensor *, SoDelayQueueSensor *>::const_iterator iter =
+      SbFlatHash<SoDelayQueueSensor *, SoDelayQueueSensor *>::const_iterator iter =
        PRIVATE(this)->reinsertdict.const_begin();
       iter!=PRIVATE(this)->reinsertdict.const_end();
       ++iter
@@ -0,0 +1,67 @@
+#ifndef COIN_SOSHADOWCASCADE_H
+#define COIN_SOSHADOWCASCADE_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+// *************************************************************************
+
+#include <Inventor/SbBasic.h>
+#include <cmath>
+
+// Splits the depth range of the view volume between the cascades of
+// an SoShadowDirectionalLight.
+class SoShadowCascade {
+public:
+  // Returns the distance from the eye where cascade number split
+  // starts. The distance is a blend of a uniform and a logarithmic
+  // split of the depth range, with weight 1 giving the logarithmic
+  // split.
+  static float splitDistance(const float nearval, const float farval,
+                             const int split, const int numsplits,
+                             const float weight) {
+    const float t = float(split) / float(numsplits);
+    const float uniform = nearval + (farval - nearval) * t;
+    if (nearval <= 0.0f) return uniform;
+    const float logarithmic = nearval * float(pow(double(farval / nearval), double(t)));
+    const float w = SbClamp(weight, 0.0f, 1.0f);
+    return w * logarithmic + (1.0f - w) * uniform;
+  }
+};
+
+// *************************************************************************
+
+#endif // !COIN_SOSHADOWCASCADE_H
@@ -58,6 +58,14 @@
   the shadow map, you can set \a maxShadowDistance to some number > 0.
   This is the distance from the camera where shadows will be visible.
 
+  For large scenes, a single shadow map gets blurry when it has to
+  cover everything from the camera to the horizon. Set \a numCascades
+  to split the view volume along the view direction into several
+  parts, each with its own shadow map. The parts near the camera are
+  small, and get detailed shadows, while the parts far away cover more
+  of the scene with the same shadow map size. Each cascade uses one
+  texture unit.
+
   \code
 
   DirectionalLight {
@@ -131,6 +139,31 @@
   calculating the resulting shadow volume.
 */
 
+/*!
+  \var SoSFInt32 SoShadowDirectionalLight::numCascades
+
+  The number of shadow maps (cascades) to split the view volume
+  into. Each cascade covers a range of distances from the camera, and
+  is rendered to a separate shadow map. Values from 1 to 4 are
+  supported. Default value is 1.
+
+  \sa cascadeSplitWeight
+  \since Coin 4.0
+*/
+
+/*!
+  \var SoSFFloat SoShadowDirectionalLight::cascadeSplitWeight
+
+  Decides where the view volume is split when \a numCascades is
+  more than 1. At 0.0 the cascades are of equal depth. At 1.0 the
+  distances grow logarithmically, so that cascades near the camera
+  are much smaller than the ones far away. Values in between blend
+  the two. Default value is 0.75.
+
+  \sa numCascades
+  \since Coin 4.0
+*/
+
 // *************************************************************************
 
 #include <Inventor/annex/FXViz/nodes/SoShadowDirectionalLight.h>
@@ -155,6 +188,8 @@ SoShadowDirectionalLight::SoShadowDirectionalLight(void)
   SO_NODE_ADD_FIELD(maxShadowDistance, (-1.0f));
   SO_NODE_ADD_FIELD(bboxCenter, (0.0f, 0.0f, 0.0f));
   SO_NODE_ADD_FIELD(bboxSize, (-1.0f, -1.0f, -1.0f));
+  SO_NODE_ADD_FIELD(numCascades, (1));
+  SO_NODE_ADD_FIELD(cascadeSplitWeight, (0.75f));
 }
 
 /*!
@@ -172,7 +172,17 @@
 /*!
   \var SoSFBool SoShadowGroup::shadowCachingEnabled
 
-  Not used yet. Provided for TGS Inventor compatibility.
+  When TRUE, a shadow map is only rendered again when something that
+  affects it changes: a node in the shadow map scene graph (including
+  the light), or, for SoShadowDirectionalLight, the part of the view
+  volume it covers. Static scenes seen from a fixed viewpoint will then
+  not render any shadow maps. When FALSE, all shadow maps are rendered
+  for every frame. Default value is TRUE.
+
+  When profiling is enabled (see SoProfiler), the time spent on shadow
+  maps and the number of maps rendered and reused are recorded as the
+  profiling counters "SoShadowGroup::renderShadowMap" and
+  "SoShadowGroup::reuseShadowMap".
 */
 
 /*!
@@ -225,19 +235,24 @@
 */
 
 /*!
-  \var SoSFInt32 SoShadowGroup::smoothBorder
+  \var SoSFFloat SoShadowGroup::smoothBorder
 
-  We have some problems with this feature so it's not supported at the
-  moment.
+  Used to add shadow border smoothing. This is done as a post
+  processing step on the shadow map, which is filtered with a
+  separable Gaussian filter in two passes. The filter is applied at
+  half the resolution of the shadow map, so smoothing the shadow
+  borders is usually much cheaper than increasing
+  SoShadowGroup::precision.
 
-  Used to add shadow border smoothing. This is currently done as a
-  post processing step on the shadow map. The algorithm used is Gauss
-  Smoothing, but in the future we'll probably change this, and use a
-  summed area sampling method instead. The value should be a
-  number between 0 (no smoothing), and 1 (max smoothing).
+  The value should be a number between 0 (no smoothing), and 1 (max
+  smoothing), and selects the size of the filter kernel: values up to
+  0.25 use a 3x3 kernel, up to 0.5 a 5x5 kernel, up to 0.75 a 7x7
+  kernel, and larger values a 9x9 kernel. Larger kernels give more
+  light bleeding, which makes the shadows a bit smaller. This can be
+  reduced by increasing SoShadowGroup::threshold.
 
-  If you want to enable smoothing, choosing a low value (~0.1) works
-  best in the current implementation.
+  Smoothing is only done when variance shadow maps are used, i.e. when
+  floating point textures are supported.
 
   Default value is 0.0.
 */
@@ -332,7 +347,10 @@
 #include <Inventor/actions/SoGetBoundingBoxAction.h>
 #include <Inventor/lists/SbList.h>
 #include <Inventor/errors/SoDebugError.h>
+#include <Inventor/annex/Profiler/SoProfiler.h>
+#include <Inventor/annex/Profiler/elements/SoProfilerElement.h>
 #include <Inventor/SbMatrix.h>
+#include <Inventor/SbTime.h>
 #include <Inventor/C/glue/gl.h>
 
 #include "nodes/SoSubNodeP.h"
@@ -341,6 +359,12 @@
 #include "misc/SoShaderGenerator.h"
 #include "caches/SoShaderProgramCache.h"
 #include "rendering/SoGL.h"
+#include "profiler/SoProfilerP.h"
+#include "shadows/SoShadowCascade.h"
+
+// the maximum number of shadow maps for one SoShadowDirectionalLight
+#define MAX_CASCADES 4
+#define MAX_GAUSS_KERNEL_SIZE 9
 
 // *************************************************************************
 
@@ -383,10 +407,14 @@ public:
     const int TEXSIZE = coin_geq_power_of_two((int) (sg->precision.getValue() * SbMin(maxsize, maxtexsize)));
 
     this->lightid = -1;
+    this->cascade = 0;
+    this->numcascades = 1;
+    this->rendered = FALSE;
     this->vsm_program = NULL;
     this->vsm_farval = NULL;
     this->vsm_nearval = NULL;
     this->gaussmap = NULL;
+    this->hgaussmap = NULL;
     this->texunit = -1;
     this->bboxnode = new SoSeparator;
     this->bboxnode->ref();
@@ -406,6 +434,9 @@ public:
     this->maxshadowdistance = new SoShaderParameter1f;
     this->maxshadowdistance->ref();
 
+    this->cascadesplit = new SoShaderParameter1f;
+    this->cascadesplit->ref();
+
     this->path = path->copy();
     this->path->ref();
     assert(((SoFullPath*)path)->getTail()->isOfType(SoLight::getClassTypeId()));
@@ -478,25 +509,34 @@ public:
     this->depthmapscene->ref();
     this->matrix = SbMatrix::identity();
 
-    if (gausskernelsize > 0) {
-      this->gaussmap = new SoSceneTexture2;
-      this->gaussmap->ref();
-      this->gaussmap->transparencyFunction = SoSceneTexture2::NONE;
-      this->gaussmap->size = SbVec2s(TEXSIZE, TEXSIZE);
-      this->gaussmap->wrapS = SoSceneTexture2::CLAMP_TO_BORDER;
-      this->gaussmap->wrapT = SoSceneTexture2::CLAMP_TO_BORDER;
-
-      this->gaussmap->type = SoSceneTexture2::RGBA32F;
-      this->gaussmap->backgroundColor = SbVec4f(1.0f, 1.0f, 1.0f, 1.0f);
-
-      SoShaderProgram * shader = this->createGaussFilter(TEXSIZE, gausskernelsize, gaussstandarddeviation);
-      this->gaussmap->scene = this->createGaussSG(shader, this->depthmap);
+    // The VSM moments are smoothed with a separable Gaussian filter,
+    // a horizontal and a vertical pass, each rendered into a texture
+    // with half the resolution of the shadow map. The fragment shader
+    // will then use the last of these instead of the shadow map. The
+    // passes are only rendered again when the shadow map changes.
+    this->gausskernelsize = gausskernelsize;
+    if (gausskernelsize > 0 && this->vsm_program) {
+      const int GAUSSSIZE = SbMax(TEXSIZE / 2, 1);
+      // like the shadow map, the passes must be rendered into floating
+      // point frame buffer objects, which a delayed transparency type
+      // inherited from the render action would prevent
+      this->hgaussmap = this->createGaussMap(GAUSSSIZE, tt);
+      this->hgaussmap->scene =
+        this->createGaussSG(this->createGaussFilter(GAUSSSIZE, gausskernelsize,
+                                                    gaussstandarddeviation, TRUE),
+                            this->depthmap);
+      this->gaussmap = this->createGaussMap(GAUSSSIZE, tt);
+      this->gaussmap->scene =
+        this->createGaussSG(this->createGaussFilter(GAUSSSIZE, gausskernelsize,
+                                                    gaussstandarddeviation, FALSE),
+                            this->hgaussmap);
     }
   }
   ~SoShadowLightCache() {
     if (this->depthmapscene) this->depthmapscene->unref();
     if (this->bboxnode) this->bboxnode->unref();
     if (this->maxshadowdistance) this->maxshadowdistance->unref();
+    if (this->cascadesplit) this->cascadesplit->unref();
     if (this->vsm_program) this->vsm_program->unref();
     if (this->vsm_farval) this->vsm_farval->unref();
     if (this->vsm_nearval) this->vsm_nearval->unref();
@@ -507,6 +547,7 @@ public:
     if (this->light) this->light->unref();
     if (this->path) this->path->unref();
     if (this->gaussmap) this->gaussmap->unref();
+    if (this->hgaussmap) this->hgaussmap->unref();
     if (this->depthmap) this->depthmap->unref();
     if (this->camera) this->camera->unref();
   }
@@ -570,12 +611,29 @@ public:
     delete [] bytes;
     return 1;
   }	
+
+  // The camera fields are set with notification disabled, and the
+  // camera is only touched (making the shadow map render again) if a
+  // value actually changed.
+  void beginCameraUpdate(void) {
+    this->getCameraValues(this->cameravalues);
+    this->cameranotify = this->camera->enableNotify(FALSE);
+  }
+  void endCameraUpdate(void) {
+    this->camera->enableNotify(this->cameranotify);
+    CameraValues values;
+    this->getCameraValues(values);
+    if (!(values == this->cameravalues)) this->camera->touch();
+  }
+
   SbBox3f toCameraSpace(const SbXfBox3f & worldbox) const;
   static void shadowmap_glcallback(void * closure, SoAction * action);
   static void shadowmap_post_glcallback(void * closure, SoAction * action);
   void createVSMProgram(void);
-  SoShaderProgram * createGaussFilter(const int texsize, const int size, const float stdev);
+  SoShaderProgram * createGaussFilter(const int texsize, const int size, const float stdev,
+                                      const SbBool horizontal);
   SoSeparator * createGaussSG(SoShaderProgram * program, SoSceneTexture2 * tex);
+  SoSceneTexture2 * createGaussMap(const int texsize, SoTransparencyType * tt);
 
   SbMatrix matrix;
   SoPath * path;
@@ -583,6 +641,8 @@ public:
   SoSceneTexture2 * depthmap;
   SoNode * depthmapscene;
   SoSceneTexture2 * gaussmap;
+  SoSceneTexture2 * hgaussmap;
+  int gausskernelsize;
   SoCamera * camera;
   float farval;
   float nearval;
@@ -600,9 +660,42 @@ public:
   SoShaderGenerator vsm_vertex_generator;
   SoShaderGenerator vsm_fragment_generator;
   SoShaderParameter1f * maxshadowdistance;
+  SoShaderParameter1f * cascadesplit;
+
+  // the index of this shadow map among the cascades of the light
+  int cascade;
+  int numcascades;
+  // set when the shadow map scene is traversed, to tell rendered maps
+  // from cached ones
+  SbBool rendered;
 
   SoColorPacker colorpacker;
   SbColor color;
+
+private:
+  struct CameraValues {
+    SbVec3f position;
+    SbRotation orientation;
+    float nearval, farval, height;
+    int operator==(const CameraValues & v) const {
+      return this->position == v.position && this->orientation == v.orientation &&
+        this->nearval == v.nearval && this->farval == v.farval && this->height == v.height;
+    }
+  };
+  void getCameraValues(CameraValues & values) const {
+    values.position = this->camera->position.getValue();
+    values.orientation = this->camera->orientation.getValue();
+    values.nearval = this->camera->nearDistance.getValue();
+    values.farval = this->camera->farDistance.getValue();
+    if (this->camera->isOfType(SoOrthographicCamera::getClassTypeId())) {
+      values.height = static_cast<SoOrthographicCamera*>(this->camera)->height.getValue();
+    }
+    else {
+      values.height = static_cast<SoPerspectiveCamera*>(this->camera)->heightAngle.getValue();
+    }
+  }
+  CameraValues cameravalues;
+  SbBool cameranotify;
 };
 
 class SoShadowGroupP {
@@ -693,6 +786,19 @@ public:
       perpixelother = TRUE;
     }
   }
+  static int getNumCascades(SoLight * light) {
+    if (light->isOfType(SoShadowDirectionalLight::getClassTypeId())) {
+      const int num = static_cast<SoShadowDirectionalLight*>(light)->numCascades.getValue();
+      return SbClamp(num, 1, MAX_CASCADES);
+    }
+    return 1;
+  }
+  // 0 (no smoothing) or an odd kernel size from 3 to MAX_GAUSS_KERNEL_SIZE
+  static int getGaussKernelSize(const float smoothing) {
+    if (smoothing <= 0.0f) return 0;
+    const int radius = (int) ceil(SbMin(smoothing, 1.0f) * (MAX_GAUSS_KERNEL_SIZE / 2));
+    return 2 * radius + 1;
+  }
   void deleteShadowLights(void) {
     for (int i = 0; i < this->shadowlights.getLength(); i++) {
       delete this->shadowlights[i];
@@ -908,6 +1014,10 @@ SoShadowGroup::notify(SoNotList * nl)
       }
     }
   }
+  else if (nl->getLastField() == &this->smoothBorder) {
+    // the filter is set up when the shadow maps are created
+    PRIVATE(this)->shadowlightsvalid = FALSE;
+  }
 
   if (PRIVATE(this)->vertexshadercache) {
     PRIVATE(this)->vertexshadercache->invalidate();
@@ -949,17 +1059,8 @@ SoShadowGroupP::updateShadowLights(SoGLRenderAction * action)
 
   if (!this->shadowlightsvalid) {
     int lightidoffset = SoLightElement::getLights(state).getLength();
-    float smoothing = PUBLIC(this)->smoothBorder.getValue();
-    smoothing = 0.0f; // FIXME: temporary until we have time to fix this feature
-
-    int gaussmatrixsize = 0;
-    float gaussstandarddeviation = 0.6f;
-
-    // just hardcode some values for now
-    // FIXME: reactivate when properly implemented
-    //if (smoothing > 0.9) gaussmatrixsize = 7;
-    //else if (smoothing > 0.5) gaussmatrixsize = 5;
-    //else if (smoothing > 0.01) gaussmatrixsize = 3;
+    const int gaussmatrixsize = getGaussKernelSize(PUBLIC(this)->smoothBorder.getValue());
+    const float gaussstandarddeviation = float(gaussmatrixsize / 2) * 0.5f + 0.5f;
 
     const cc_glglue * glue = cc_glglue_instance(SoGLCacheContextElement::get(state));
 
@@ -1006,21 +1107,35 @@ SoShadowGroupP::updateShadowLights(SoGLRenderAction * action)
     }
     int maxunits = cc_glglue_max_texture_units(glue);
 
-    int maxlights = maxunits - this->numtexunitsinscene;
+    int maxmaps = maxunits - this->numtexunitsinscene;
     SbList <SoTempPath*> & pl = this->lightpaths;
 
-    int numlights = 0;
+    // find the number of shadow maps for each light, and check if the
+    // shadow light caches still match
+    SbList <int> lightcascades;
+    SbBool changed = FALSE;
+    int nummaps = 0;
     for (i = 0; i < pl.getLength(); i++) {
       SoLight * light = (SoLight*)((SoFullPath*)(pl[i]))->getTail();
-      if (light->on.getValue() && (numlights < maxlights)) numlights++;
+      int numcascades = 0;
+      if (light->on.getValue() && (nummaps < maxmaps)) {
+        numcascades = SbMin(getNumCascades(light), maxmaps - nummaps);
+        if (nummaps >= this->shadowlights.getLength() ||
+            this->shadowlights[nummaps]->light != light ||
+            this->shadowlights[nummaps]->numcascades != numcascades ||
+            this->shadowlights[nummaps]->gausskernelsize != gaussmatrixsize) {
+          changed = TRUE;
+        }
+        nummaps += numcascades;
+      }
+      lightcascades.append(numcascades);
     }
-    if (numlights != this->shadowlights.getLength()) {
-      // just delete and recreate all if the number of spot lights have changed
+    if (changed || nummaps != this->shadowlights.getLength()) {
+      // just delete and recreate all if the lights have changed
       this->deleteShadowLights();
-      int id = lightidoffset;
       for (i = 0; i < pl.getLength(); i++) {
         SoLight * light = (SoLight*)((SoFullPath*)pl[i])->getTail();
-        if (light->on.getValue() && (this->shadowlights.getLength() < maxlights)) {
+        if (lightcascades[i] > 0) {
           SoNode * scene = PUBLIC(this);
           SoNode * bboxscene = PUBLIC(this);
           if (light->isOfType(SoShadowSpotLight::getClassTypeId())) {
@@ -1035,27 +1150,31 @@ SoShadowGroupP::updateShadowLights(SoGLRenderAction * action)
               scene = sl->shadowMapScene.getValue();
             }
           }
-          SoShadowLightCache * cache = new SoShadowLightCache(state, pl[i],
-                                                              PUBLIC(this),
-                                                              scene,
-                                                              bboxscene,
-                                                              gaussmatrixsize,
-                                                              gaussstandarddeviation);
-          cache->lightid = id++;
-          this->shadowlights.append(cache);
+          for (int c = 0; c < lightcascades[i]; c++) {
+            SoShadowLightCache * cache = new SoShadowLightCache(state, pl[i],
+                                                                PUBLIC(this),
+                                                                scene,
+                                                                bboxscene,
+                                                                gaussmatrixsize,
+                                                                gaussstandarddeviation);
+            cache->cascade = c;
+            cache->numcascades = lightcascades[i];
+            this->shadowlights.append(cache);
+          }
         }
       }
     }
-    // validate if spot light paths are still valid
+    // validate if spot light paths are still valid. All the cascades
+    // of a light use the same OpenGL light id
     int i2 = 0;
     int id = lightidoffset;
     for (i = 0; i < pl.getLength(); i++) {
       SoPath * path = pl[i];
-      SoLight * light = (SoLight*) ((SoFullPath*)path)->getTail();
-      if (light->on.getValue() && (i2 < maxlights)) {
+      if (lightcascades[i] == 0) continue;
+      int lightid = id++;
+      for (int c = 0; c < lightcascades[i]; c++, i2++) {
         SoShadowLightCache * cache = this->shadowlights[i2];
         int unit = (maxunits - 1) - i2;
-        int lightid = id++;
         if (unit != cache->texunit || lightid != cache->lightid) {
           if (this->vertexshadercache) this->vertexshadercache->invalidate();
           if (this->fragmentshadercache) this->fragmentshadercache->invalidate();
@@ -1065,34 +1184,57 @@ SoShadowGroupP::updateShadowLights(SoGLRenderAction * action)
         if (*(cache->path) != *path) {
           cache->path->unref();
           cache->path = path->copy();
+          cache->path->ref();
         }
         if (cache->light->isOfType(SoSpotLight::getClassTypeId())) {
           this->matrixaction.apply(path);
           this->updateSpotCamera(state, cache, this->matrixaction.getMatrix());
         }
-        i2++;
       }
     }
     this->shadowlightsvalid = TRUE;
   }
+
+  SbProfilingData * profilingdata = NULL;
+  if (SoProfiler::isEnabled() &&
+      state->isElementEnabled(SoProfilerElement::getClassStackIndex())) {
+    profilingdata = &SoProfilerElement::get(state)->getProfilingData();
+  }
+  const SbBool caching = PUBLIC(this)->shadowCachingEnabled.getValue();
+  SbMatrix lighttransform;
+
   for (i = 0; i < this->shadowlights.getLength(); i++) {
     SoShadowLightCache * cache = this->shadowlights[i];
+    SbTime start;
+    if (profilingdata) {
+      if (SoProfilerP::shouldSyncGL()) glFinish();
+      start = SbTime::getTimeOfDay();
+    }
     if (cache->light->isOfType(SoDirectionalLight::getClassTypeId())) {
-      this->matrixaction.apply(cache->path);
-      this->updateDirectionalCamera(state, cache, this->matrixaction.getMatrix());
+      // the cascades of a light follow each other in the list
+      if (cache->cascade == 0) {
+        this->matrixaction.apply(cache->path);
+        lighttransform = this->matrixaction.getMatrix();
+      }
+      this->updateDirectionalCamera(state, cache, lighttransform);
     }
     assert(cache->texunit >= 0);
     assert(cache->lightid >= 0);
     SoTextureUnitElement::set(state, PUBLIC(this), cache->texunit);
 
-    SbMatrix mat = cache->matrix;
-
-    assert(cache->texunit >= 0);
-
     SoMultiTextureMatrixElement::set(state, PUBLIC(this), cache->texunit, cache->matrix);
+    if (!caching) cache->depthmap->scene.touch();
+    cache->rendered = FALSE;
     this->renderDepthMap(cache, action);
     SoGLMultiTextureEnabledElement::set(state, PUBLIC(this), cache->texunit,
                                         SoGLMultiTextureEnabledElement::DISABLED);
+    if (profilingdata) {
+      if (SoProfilerP::shouldSyncGL()) glFinish();
+      profilingdata->addCounter(cache->rendered ?
+                                "SoShadowGroup::renderShadowMap" :
+                                "SoShadowGroup::reuseShadowMap",
+                                SbTime::getTimeOfDay() - start);
+    }
   }
   SoTextureUnitElement::set(state, PUBLIC(this), 0);
 }
@@ -1138,6 +1280,7 @@ SoShadowGroupP::updateSpotCamera(SoState * COIN_UNUSED_ARG(state), SoShadowLight
   SoSpotLight * light = static_cast<SoSpotLight*> (cache->light);
 
   assert(cam->isOfType(SoPerspectiveCamera::getClassTypeId()));
+  cache->beginCameraUpdate();
   SbVec3f pos = light->location.getValue();
   transform.multVecMatrix(pos, pos);
 
@@ -1218,13 +1361,20 @@ SoShadowGroupP::updateSpotCamera(SoState * COIN_UNUSED_ARG(state), SoShadowLight
   if (cache->farval != cam->farDistance.getValue()) {
     cam->farDistance = cache->farval;
   }
+  cache->endCameraUpdate();
 
   float realfarval = cutoff >= 0.0f ? cache->farval / float(cos(cutoff * 2.0f)) : cache->farval;
   cache->fragment_farval->value = realfarval;
-  cache->vsm_farval->value = realfarval;
-
   cache->fragment_nearval->value = cache->nearval;
-  cache->vsm_nearval->value = cache->nearval;
+
+  // the VSM program is part of the shadow map scene, so only touch
+  // it when the values change
+  if (cache->vsm_farval->value.getValue() != realfarval) {
+    cache->vsm_farval->value = realfarval;
+  }
+  if (cache->vsm_nearval->value.getValue() != cache->nearval) {
+    cache->vsm_nearval->value = cache->nearval;
+  }
 
   SbViewVolume vv = cam->getViewVolume(1.0f);
   SbMatrix affine, proj;
@@ -1233,6 +1383,26 @@ SoShadowGroupP::updateSpotCamera(SoState * COIN_UNUSED_ARG(state), SoShadowLight
   cache->matrix = affine * proj;
 }
 
+namespace {
+  // Returns the bounding box of the part of vv between the distances
+  // d0 and d1 from the eye.
+  SbBox3f viewVolumeSliceBox(const SbViewVolume & vv, const float d0, const float d1) {
+    const SbVec3f eye = vv.getProjectionPoint();
+    const SbVec3f dir = vv.getProjectionDirection();
+    SbBox3f box;
+    for (int i = 0; i < 4; i++) {
+      SbVec3f p0, p1;
+      vv.projectPointToLine(SbVec2f(float(i & 1), float(i >> 1)), p0, p1);
+      const float z0 = (p0 - eye).dot(dir);
+      const float z1 = (p1 - eye).dot(dir);
+      if (z1 <= z0) continue;
+      box.extendBy(p0 + (p1 - p0) * ((d0 - z0) / (z1 - z0)));
+      box.extendBy(p0 + (p1 - p0) * ((d1 - z0) / (z1 - z0)));
+    }
+    return box;
+  }
+}
+
 void
 SoShadowGroupP::updateDirectionalCamera(SoState * state, SoShadowLightCache * cache, const SbMatrix & transform)
 {
@@ -1242,6 +1412,8 @@ SoShadowGroupP::updateDirectionalCamera(SoState * state, SoShadowLightCache * ca
 
   float maxdist = light->maxShadowDistance.getValue();
 
+  cache->beginCameraUpdate();
+
   SbVec3f dir = light->direction.getValue();
   dir.normalize();
   transform.multDirMatrix(dir, dir);
@@ -1251,22 +1423,51 @@ SoShadowGroupP::updateDirectionalCamera(SoState * state, SoShadowLightCache * ca
   SbViewVolume vv = SoViewVolumeElement::get(state);
   const SbXfBox3f & worldbox = this->calcBBox(cache);
   SbBool visible = TRUE;
-  if (maxdist > 0.0f) {
-    float nearv = vv.getNearDist();
-    if (maxdist < nearv) visible = FALSE;
+  SbBox3f isect;
+  if (cache->numcascades > 1) {
+    // the cascade only covers its own part of the view volume
+    const float nearv = vv.getNearDist();
+    float farv = nearv + vv.getDepth();
+    if (maxdist > 0.0f) farv = SbMin(farv, maxdist);
+    if (farv <= nearv) visible = FALSE;
     else {
-      maxdist -= nearv;
-      float depth = vv.getDepth();
-      if (maxdist > depth) maxdist = depth;
-      vv = vv.zNarrow(1.0f, 1.0f - maxdist/depth);
+      const float weight = light->cascadeSplitWeight.getValue();
+      const float d0 = SoShadowCascade::splitDistance(nearv, farv, cache->cascade, cache->numcascades, weight);
+      const float d1 = SoShadowCascade::splitDistance(nearv, farv, cache->cascade + 1, cache->numcascades, weight);
+      if (cache->cascadesplit->value.getValue() != d1) {
+        cache->cascadesplit->value = d1;
+      }
+      const SbBox3f slice = viewVolumeSliceBox(vv, d0, d1);
+      isect = vv.intersectionBox(worldbox);
+      if (!isect.isEmpty() && !slice.isEmpty()) {
+        const SbVec3f & imin = isect.getMin();
+        const SbVec3f & imax = isect.getMax();
+        const SbVec3f & smin = slice.getMin();
+        const SbVec3f & smax = slice.getMax();
+        isect.setBounds(SbMax(imin[0], smin[0]), SbMax(imin[1], smin[1]), SbMax(imin[2], smin[2]),
+                        SbMin(imax[0], smax[0]), SbMin(imax[1], smax[1]), SbMin(imax[2], smax[2]));
+      }
+      if (isect.isEmpty() || slice.isEmpty()) visible = FALSE;
     }
   }
-  SbBox3f isect;
-  if (visible) {
-    isect = vv.intersectionBox(worldbox);
-    if (isect.isEmpty()) visible = FALSE;
+  else {
+    if (maxdist > 0.0f) {
+      float nearv = vv.getNearDist();
+      if (maxdist < nearv) visible = FALSE;
+      else {
+        maxdist -= nearv;
+        float depth = vv.getDepth();
+        if (maxdist > depth) maxdist = depth;
+        vv = vv.zNarrow(1.0f, 1.0f - maxdist/depth);
+      }
+    }
+    if (visible) {
+      isect = vv.intersectionBox(worldbox);
+      if (isect.isEmpty()) visible = FALSE;
+    }
   }
   if (!visible) {
+    cache->endCameraUpdate();
     if (cache->depthmap->scene.getValue() == cache->depthmapscene) {
       cache->depthmap->scene = new SoInfo;
     }
@@ -1320,13 +1521,20 @@ SoShadowGroupP::updateDirectionalCamera(SoState * state, SoShadowLightCache * ca
   if (cache->farval != cam->farDistance.getValue()) {
     cam->farDistance = cache->farval;
   }
+  cache->endCameraUpdate();
 
   float realfarval = cache->farval * 1.1f;
   cache->fragment_farval->value = realfarval;
-  cache->vsm_farval->value = realfarval;
-
   cache->fragment_nearval->value = cache->nearval;
-  cache->vsm_nearval->value = cache->nearval;
+
+  // the VSM program is part of the shadow map scene, so only touch
+  // it when the values change
+  if (cache->vsm_farval->value.getValue() != realfarval) {
+    cache->vsm_farval->value = realfarval;
+  }
+  if (cache->vsm_nearval->value.getValue() != cache->nearval) {
+    cache->vsm_nearval->value = cache->nearval;
+  }
 
   vv = cam->getViewVolume(1.0f);
   SbMatrix affine, proj;
@@ -1385,6 +1593,21 @@ namespace {
     gen.addMainStatement(str);
   }
 
+  // starts the block of statements for one cascade of a cascaded
+  // shadow map. The block is closed by the caller.
+  void addCascadeTest(SoShaderGenerator & gen, const SoShadowLightCache * cache, int i) {
+    if (cache->numcascades == 1) return;
+    SbString str;
+    if (cache->cascade == cache->numcascades - 1) {
+      str = "else {\n";
+    }
+    else {
+      str.sprintf("%sif (-ecPosition3.z < cascadesplit%d) {\n",
+                  cache->cascade > 0 ? "else " : "", i);
+    }
+    gen.addMainStatement(str);
+  }
+
   void addPointLight(SoShaderGenerator & gen, int i) {
     initLightMaterial(gen, i);
     SbString str;
@@ -1437,7 +1660,8 @@ SoShadowGroupP::setVertexShader(SoState * state)
     str.sprintf("varying vec4 shadowCoord%d;", i);
     gen.addDeclaration(str, FALSE);
 
-    if (!perpixelspot) {
+    // the cascades of a light share the light color
+    if (!perpixelspot && this->shadowlights[i]->cascade == 0) {
       str.sprintf("varying vec3 spotVertexColor%d;", i);
       gen.addDeclaration(str, FALSE);
     }
@@ -1515,7 +1739,7 @@ SoShadowGroupP::setVertexShader(SoState * state)
     str.sprintf("shadowCoord%d = gl_TextureMatrix[%d] * pos;\n", i, cache->texunit); // in light space
     gen.addMainStatement(str);
 
-    if (!perpixelspot) {
+    if (!perpixelspot && cache->cascade == 0) {
       spotlight = TRUE;
       addSpotLight(gen, cache->lightid);
       str.sprintf("spotVertexColor%d = \n"
@@ -1637,14 +1861,19 @@ SoShadowGroupP::setFragmentShader(SoState * state)
     str.sprintf("varying vec4 shadowCoord%d;", i);
     gen.addDeclaration(str, FALSE);
 
-    if (!perpixelspot) {
+    SoShadowLightCache * cache = this->shadowlights[i];
+    if (!perpixelspot && cache->cascade == 0) {
       str.sprintf("varying vec3 spotVertexColor%d;", i);
       gen.addDeclaration(str, FALSE);
     }
-    if (this->shadowlights[i]->light->isOfType(SoDirectionalLight::getClassTypeId())) {
+    if (cache->light->isOfType(SoDirectionalLight::getClassTypeId())) {
       str.sprintf("uniform vec4 lightplane%d;", i);
       gen.addDeclaration(str, FALSE);
     }
+    if (cache->cascade < cache->numcascades - 1) {
+      str.sprintf("uniform float cascadesplit%d;", i);
+      gen.addDeclaration(str, FALSE);
+    }
   }
 
   if (numshadowlights) {
@@ -1712,19 +1941,27 @@ SoShadowGroupP::setFragmentShader(SoState * state)
         dirshadow = TRUE;
         dirlight = TRUE;
       }
-      if (dirshadow) {
-        str.sprintf("dist = dot(ecPosition3.xyz, lightplane%d.xyz) - lightplane%d.w;\n", i,i);
-        gen.addMainStatement(str);
-        addDirectionalLight(gen, cache->lightid);
-      }
-      else {
-        if (normalspot) {
-          addSpotLight(gen, cache->lightid, TRUE);
+      // the light is added once, and each cascade only does its
+      // shadow map lookup for the fragments in its part of the view
+      // volume
+      if (cache->cascade == 0) {
+        if (dirshadow) {
+          addDirectionalLight(gen, cache->lightid);
         }
         else {
-          addDirSpotLight(gen, cache->lightid, TRUE);
+          if (normalspot) {
+            addSpotLight(gen, cache->lightid, TRUE);
+          }
+          else {
+            addDirSpotLight(gen, cache->lightid, TRUE);
+          }
         }
       }
+      addCascadeTest(gen, cache, i);
+      if (dirshadow) {
+        str.sprintf("dist = dot(ecPosition3.xyz, lightplane%d.xyz) - lightplane%d.w;\n", i,i);
+        gen.addMainStatement(str);
+      }
       str.sprintf("coord = 0.5 * (shadowCoord%d.xyz / shadowCoord%d.w + vec3(1.0));\n", i , i);
       gen.addMainStatement(str);
       str.sprintf("map = texture2D(shadowMap%d, coord.xy);\n", i);
@@ -1739,6 +1976,8 @@ SoShadowGroupP::setFragmentShader(SoState * state)
                   "? VsmLookup(map, (dist - nearval%d) / (farval%d - nearval%d), EPSILON, THRESHOLD) : 1.0;\n",
                   i, insidetest.getString(),i,i,i);
       gen.addMainStatement(str);
+      if (cache->numcascades > 1) gen.addMainStatement("}\n");
+      if (cache->cascade < cache->numcascades - 1) continue;
 
       if (dirshadow) {
         SoShadowDirectionalLight * sl = static_cast<SoShadowDirectionalLight*> (light);
@@ -1789,26 +2028,34 @@ SoShadowGroupP::setFragmentShader(SoState * state)
         gen.addMainStatement("scolor += specular.rgb * gl_FrontMaterial.specular.rgb;\n");
       }
 
-      if (dirlight) gen.addNamedFunction(SbName("lights/DirectionalLight"), FALSE);
       if (pointlight) gen.addNamedFunction(SbName("lights/PointLight"), FALSE);
     }
+    if (dirlight) gen.addNamedFunction(SbName("lights/DirectionalLight"), FALSE);
     if (spotlight) gen.addNamedFunction(SbName("lights/SpotLight"), FALSE);
   }
 
   else {
     for (i = 0; i < numshadowlights; i++) {
+      SoShadowLightCache * cache = this->shadowlights[i];
       SbString insidetest = "&& coord.x >= 0.0 && coord.x <= 1.0 && coord.y >= 0.0 && coord.y <= 1.0)";
 
-      SoLight * light = this->shadowlights[i]->light;
+      SoLight * light = cache->light;
       if (light->isOfType(SoSpotLight::getClassTypeId())) {
         SoSpotLight * sl = static_cast<SoSpotLight*> (light);
         if (sl->dropOffRate.getValue() >= 0.0f) {
           insidetest = ")";
         }
       }
+      addCascadeTest(gen, cache, i);
       SbString str;
-      str.sprintf("dist = length(vec3(gl_LightSource[%d].position) - ecPosition3);\n"
-                  "coord = 0.5 * (shadowCoord%d.xyz / shadowCoord%d.w + vec3(1.0));\n"
+      if (light->isOfType(SoDirectionalLight::getClassTypeId())) {
+        str.sprintf("dist = dot(ecPosition3.xyz, lightplane%d.xyz) - lightplane%d.w;\n", i, i);
+      }
+      else {
+        str.sprintf("dist = length(vec3(gl_LightSource[%d].position) - ecPosition3);\n", cache->lightid);
+      }
+      gen.addMainStatement(str);
+      str.sprintf("coord = 0.5 * (shadowCoord%d.xyz / shadowCoord%d.w + vec3(1.0));\n"
                   "map = texture2D(shadowMap%d, coord.xy);\n"
 #ifdef USE_NEGATIVE
                   "map = (map + vec4(1.0)) * 0.5;\n"
@@ -1818,8 +2065,9 @@ SoShadowGroupP::setFragmentShader(SoState * state)
 #endif
                   "shadeFactor = (shadowCoord%d.z > -1.0%s ? VsmLookup(map, (dist - nearval%d)/(farval%d-nearval%d), EPSILON, THRESHOLD) : 1.0;\n"
                   "color += shadeFactor * spotVertexColor%d;\n",
-                  lights.getLength()+i, i , i, i, i,insidetest.getString(), i,i,i,i);
+                  i , i, i, i,insidetest.getString(), i,i,i, i - cache->cascade);
       gen.addMainStatement(str);
+      if (cache->numcascades > 1) gen.addMainStatement("}\n");
     }
   }
 
@@ -1959,7 +2207,8 @@ SoShadowGroupP::setFragmentShader(SoState * state)
     if (cache->light->isOfType(SoShadowDirectionalLight::getClassTypeId())) {
       SbString str;
       SoShadowDirectionalLight * sl = static_cast<SoShadowDirectionalLight*> (cache->light);
-      if (sl->maxShadowDistance.getValue() > 0.0f) {
+      if (sl->maxShadowDistance.getValue() > 0.0f &&
+          cache->cascade == cache->numcascades - 1) {
         SoShaderParameter1f * maxdist = cache->maxshadowdistance;
         maxdist->value.connectFrom(&sl->maxShadowDistance);
         str.sprintf("maxshadowdistance%d", i);
@@ -1979,6 +2228,15 @@ SoShadowGroupP::setFragmentShader(SoState * state)
       }
       this->fragmentshader->parameter.set1Value(this->fragmentshader->parameter.getNum(), lightplane);
     }
+    if (cache->cascade < cache->numcascades - 1) {
+      SbString str;
+      SoShaderParameter1f * cascadesplit = cache->cascadesplit;
+      str.sprintf("cascadesplit%d", i);
+      if (cascadesplit->name.getValue() != str) {
+        cascadesplit->name = str;
+      }
+      this->fragmentshader->parameter.set1Value(this->fragmentshader->parameter.getNum(), cascadesplit);
+    }
   }
 
   this->shadowlightsvalid = TRUE;
@@ -2189,8 +2447,14 @@ SoShadowGroupP::GLRender(SoGLRenderAction * action, const SbBool inpath)
   state->pop();
 }
 
+// Creates one pass of a separable Gaussian filter, which renders into
+// a texture of size texsize x texsize. The samples are taken at
+// texsize resolution also when reading from the full resolution
+// shadow map, so that linear filtering averages the 2x2 shadow map
+// texels covered by each texel.
 SoShaderProgram *
-SoShadowLightCache::createGaussFilter(const int texsize, const int size, const float gaussstandarddeviation)
+SoShadowLightCache::createGaussFilter(const int texsize, const int size, const float gaussstandarddeviation,
+                                      const SbBool horizontal)
 {
   SoVertexShader * vshader = new SoVertexShader;
   SoFragmentShader * fshader = new SoFragmentShader;
@@ -2204,15 +2468,19 @@ SoShadowLightCache::createGaussFilter(const int texsize, const int size, const f
   baseimage->name = "baseimage";
   baseimage->value = 0;
 
-  int kernelsize = size*size;
-
-  offset->value.setNum(kernelsize);
-  kernel->value.setNum(kernelsize);
+  offset->value.setNum(size);
+  kernel->value.setNum(size);
 
   SoShaderGenerator fgen;
   SbString str;
 
-  str.sprintf("const int KernelSize = %d;", kernelsize);
+  str.sprintf("const int KernelSize = %d;", size);
+  fgen.addDeclaration(str, FALSE);
+  // sample inside the texture, since the border color isn't a valid
+  // shadow map value
+  str.sprintf("const vec2 TexMin = vec2(%f);", 0.5f / float(texsize));
+  fgen.addDeclaration(str, FALSE);
+  str.sprintf("const vec2 TexMax = vec2(%f);", 1.0f - 0.5f / float(texsize));
   fgen.addDeclaration(str, FALSE);
   fgen.addDeclaration("uniform vec2 offset[KernelSize];", FALSE);
   fgen.addDeclaration("uniform float kernelvalue[KernelSize];", FALSE);
@@ -2222,8 +2490,8 @@ SoShadowLightCache::createGaussFilter(const int texsize, const int size, const f
                         "int i;\n"
                         "vec4 sum = vec4(0.0);\n"
                         "for (i = 0; i < KernelSize; i++) {\n"
-                        "  vec4 tmp = texture2D(baseimage, gl_TexCoord[0].st + offset[i]);\n"
-                        "  sum += tmp * kernelvalue[i];\n"
+                        "  vec2 coord = clamp(gl_TexCoord[0].st + offset[i], TexMin, TexMax);\n"
+                        "  sum += texture2D(baseimage, coord) * kernelvalue[i];\n"
                         "}\n"
                         "gl_FragColor = sum;\n"
                         );
@@ -2235,17 +2503,19 @@ SoShadowLightCache::createGaussFilter(const int texsize, const int size, const f
   SbVec2f * offsetptr = offset->value.startEditing();
   float * kernelptr = kernel->value.startEditing();
 
-  int c = 0;
-  for (int y = 0; y < size; y++) {
-    int dy = SbAbs(y - center);
-    for (int x = 0; x < size; x++) {
-      int dx = SbAbs(x - center);
-
-      kernelptr[c] = (float) ((1.0 /  (2.0 * M_PI * sigma * sigma)) * exp(- double(dx*dx + dy*dy) / (2.0 * sigma * sigma)));
-      offsetptr[c] = SbVec2f(float(x-center) * dt, float(y-center)*dt);
-      c++;
-
-    }
+  // the VSM moments are stored with an affine encoding, so the kernel
+  // must sum to one for the filtered values to decode correctly
+  double sum = 0.0;
+  int i;
+  for (i = 0; i < size; i++) {
+    const double d = double(i - center);
+    kernelptr[i] = (float) exp(- (d * d) / (2.0 * sigma * sigma));
+    sum += kernelptr[i];
+    const float o = float(i - center) * dt;
+    offsetptr[i] = horizontal ? SbVec2f(o, 0.0f) : SbVec2f(0.0f, o);
+  }
+  for (i = 0; i < size; i++) {
+    kernelptr[i] = (float) (kernelptr[i] / sum);
   }
   offset->value.finishEditing();
   kernel->value.finishEditing();
@@ -2270,6 +2540,22 @@ SoShadowLightCache::createGaussFilter(const int texsize, const int size, const f
   return program;
 }
 
+SoSceneTexture2 *
+SoShadowLightCache::createGaussMap(const int texsize, SoTransparencyType * tt)
+{
+  SoSceneTexture2 * map = new SoSceneTexture2;
+  map->ref();
+  map->transparencyFunction = SoSceneTexture2::NONE;
+  map->sceneTransparencyType = tt;
+  map->size = SbVec2s(texsize, texsize);
+  map->wrapS = SoSceneTexture2::CLAMP_TO_BORDER;
+  map->wrapT = SoSceneTexture2::CLAMP_TO_BORDER;
+
+  map->type = SoSceneTexture2::RGBA32F;
+  map->backgroundColor = SbVec4f(1.0f, 1.0f, 1.0f, 1.0f);
+  return map;
+}
+
 SoSeparator *
 SoShadowLightCache::createGaussSG(SoShaderProgram * program, SoSceneTexture2 * tex)
 {
@@ -2317,9 +2603,10 @@ SoShadowLightCache::createGaussSG(SoShaderProgram * program, SoSceneTexture2 * t
 }
 
 void
-SoShadowLightCache::shadowmap_glcallback(void * COIN_UNUSED_ARG(closure), SoAction * action)
+SoShadowLightCache::shadowmap_glcallback(void * closure, SoAction * action)
 {
   if (action->isOfType(SoGLRenderAction::getClassTypeId())) {
+    static_cast<SoShadowLightCache *>(closure)->rendered = TRUE;
     SoState * state = action->getState();
     SoLazyElement::setLightModel(state, SoLazyElement::BASE_COLOR);
     SoTextureQualityElement::set(state, 0.0f);
@@ -2345,6 +2632,8 @@ SoShadowLightCache::shadowmap_post_glcallback(void * COIN_UNUSED_ARG(closure), S
 }
 
 #undef PUBLIC
+#undef MAX_CASCADES
+#undef MAX_GAUSS_KERNEL_SIZE
 #undef DISTRIBUTE_FACTOR
 #undef USE_NEGATIVE
 
@@ -2360,4 +2649,362 @@ BOOST_AUTO_TEST_CASE(initialized)
   node->unref();
 }
 
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/annex/FXViz/nodes/SoShadowDirectionalLight.h>
+#include <Inventor/annex/FXViz/nodes/SoShadowStyle.h>
+#include <Inventor/nodes/SoCallback.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoFaceSet.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoTransform.h>
+#include <cstdlib>
+#include <cstring>
+#include "shadows/SoShadowCascade.h"
+
+namespace {
+
+const int SMOOTHBORDER_SIZE = 256;
+
+// pixels that differ less than this are considered equal, to allow
+// for small differences between OpenGL drivers
+const int SMOOTHBORDER_TOLERANCE = 8;
+
+SoSeparator *
+smoothborder_caster(const SbVec3f & translation, SoNode * shape)
+{
+  SoSeparator * sep = new SoSeparator;
+  SoTransform * transform = new SoTransform;
+  transform->translation = translation;
+  sep->addChild(transform);
+  sep->addChild(shape);
+  return sep;
+}
+
+// a plate and a sphere casting shadows onto a 20x20 ground plane,
+// which fills the image
+SoSeparator *
+smoothborder_scene(SoShadowGroup * group)
+{
+  SoSeparator * root = new SoSeparator;
+  SoOrthographicCamera * camera = new SoOrthographicCamera;
+  camera->position.setValue(0.0f, 0.0f, 20.0f);
+  camera->height = 20.0f;
+  camera->nearDistance = 1.0f;
+  camera->farDistance = 40.0f;
+  root->addChild(camera);
+  root->addChild(group);
+
+  group->quality = 1.0f;
+  group->precision = 0.1f;
+
+  SoShadowDirectionalLight * light = new SoShadowDirectionalLight;
+  light->direction.setValue(0.2f, 0.3f, -1.0f);
+  group->addChild(light);
+
+  SoShadowStyle * style = new SoShadowStyle;
+  style->style = SoShadowStyle::CASTS_SHADOW;
+  group->addChild(style);
+
+  SoCube * plate = new SoCube;
+  plate->width = 4.0f;
+  plate->height = 3.0f;
+  plate->depth = 0.2f;
+  group->addChild(smoothborder_caster(SbVec3f(-5.0f, -2.0f, 8.0f), plate));
+  SoSphere * sphere = new SoSphere;
+  sphere->radius = 2.0f;
+  group->addChild(smoothborder_caster(SbVec3f(4.0f, -4.0f, 4.0f), sphere));
+
+  style = new SoShadowStyle;
+  style->style = SoShadowStyle::SHADOWED;
+  group->addChild(style);
+
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->point.set1Value(0, SbVec3f(-10.0f, -10.0f, 0.0f));
+  coords->point.set1Value(1, SbVec3f(10.0f, -10.0f, 0.0f));
+  coords->point.set1Value(2, SbVec3f(10.0f, 10.0f, 0.0f));
+  coords->point.set1Value(3, SbVec3f(-10.0f, 10.0f, 0.0f));
+  group->addChild(coords);
+  SoFaceSet * ground = new SoFaceSet;
+  ground->numVertices = 4;
+  group->addChild(ground);
+  return root;
+}
+
+// returns a copy of the rendered RGB image, or NULL if no offscreen
+// context could be made
+unsigned char *
+smoothborder_render(SoOffscreenRenderer & renderer, SoNode * root)
+{
+  if (!renderer.render(root)) return NULL;
+  const size_t size = SMOOTHBORDER_SIZE * SMOOTHBORDER_SIZE * 3;
+  unsigned char * image = new unsigned char[size];
+  memcpy(image, renderer.getBuffer(), size);
+  return image;
+}
+
+// the green value of the ground at (x, y)
+int
+smoothborder_ground(const unsigned char * image, const float x, const float y)
+{
+  const int col = int((x + 10.0f) / 20.0f * SMOOTHBORDER_SIZE);
+  const int row = int((y + 10.0f) / 20.0f * SMOOTHBORDER_SIZE);
+  return image[(row * SMOOTHBORDER_SIZE + col) * 3 + 1];
+}
+
+// the number of pixels on the ground that are neither lit nor in
+// full shadow
+int
+smoothborder_count_border(const unsigned char * image, int lit, int shadow)
+{
+  int count = 0;
+  for (int i = 0; i < SMOOTHBORDER_SIZE * SMOOTHBORDER_SIZE; i++) {
+    const int g = image[i * 3 + 1];
+    if (g > shadow + SMOOTHBORDER_TOLERANCE &&
+        g < lit - SMOOTHBORDER_TOLERANCE) count++;
+  }
+  return count;
+}
+
+// the number of pixels that differ from the reference, only counting
+// the pixels where the reference has the same value in a radius
+// around the pixel if radius > 0
+int
+smoothborder_count_differences(const unsigned char * image,
+                               const unsigned char * reference,
+                               const int radius)
+{
+  const int size = SMOOTHBORDER_SIZE;
+  int count = 0;
+  for (int y = radius; y < size - radius; y++) {
+    for (int x = radius; x < size - radius; x++) {
+      const int i = (y * size + x) * 3;
+      SbBool uniform = TRUE;
+      for (int dy = -radius; dy <= radius && uniform; dy += 2) {
+        for (int dx = -radius; dx <= radius && uniform; dx += 2) {
+          const int j = ((y + dy) * size + x + dx) * 3;
+          if (abs(reference[j + 1] - reference[i + 1]) > SMOOTHBORDER_TOLERANCE) {
+            uniform = FALSE;
+          }
+        }
+      }
+      if (!uniform) continue;
+      for (int c = 0; c < 3; c++) {
+        if (abs(image[i + c] - reference[i + c]) > SMOOTHBORDER_TOLERANCE) {
+          count++;
+          break;
+        }
+      }
+    }
+  }
+  return count;
+}
+
+} // namespace
+
+// Renders the scene with smoothing off and with each of the filter
+// kernel sizes (3x3 to 9x9). The shadow borders must get wider for
+// each larger kernel, the smoothed images must match the unsmoothed
+// image away from the borders, the center of the plate shadow must
+// stay in full shadow, and setting smoothBorder back to 0 must give
+// the unsmoothed image.
+BOOST_AUTO_TEST_CASE(smoothBorder)
+{
+  const int size = SMOOTHBORDER_SIZE;
+  const int numimages = 5;
+  const float smoothing[numimages] = { 0.0f, 0.25f, 0.5f, 0.75f, 1.0f };
+
+  SoShadowGroup * group = new SoShadowGroup;
+  SoSeparator * root = smoothborder_scene(group);
+  root->ref();
+
+  SoOffscreenRenderer renderer(SbViewportRegion(size, size));
+  renderer.setComponents(SoOffscreenRenderer::RGB);
+  renderer.setBackgroundColor(SbColor(0.0f, 0.0f, 0.0f));
+
+  unsigned char * images[numimages];
+  int numrendered = 0;
+  for (; numrendered < numimages; numrendered++) {
+    group->smoothBorder = smoothing[numrendered];
+    images[numrendered] = smoothborder_render(renderer, root);
+    if (!images[numrendered]) break;
+  }
+
+  // the light moves the shadows up and to the right, so the ground
+  // in the upper left corner is lit, and the plate shadow is centered
+  // at (-3.4, 0.4)
+  const int lit = numrendered ?
+    smoothborder_ground(images[0], -9.8f, 9.8f) : 0;
+  const int shadow = numrendered ?
+    smoothborder_ground(images[0], -3.4f, 0.4f) : 0;
+
+  if (numrendered < numimages) {
+    BOOST_TEST_MESSAGE("no offscreen context, skipping smoothBorder test");
+  }
+  else if (lit - shadow <= 4 * SMOOTHBORDER_TOLERANCE) {
+    BOOST_TEST_MESSAGE("shadows not supported, skipping smoothBorder test");
+  }
+  else {
+    int prev = -1;
+    for (int i = 0; i < numimages; i++) {
+      if (i > 0) {
+        const int differ =
+          smoothborder_count_differences(images[i], images[0], size / 16);
+        BOOST_CHECK_MESSAGE(differ <= size * size / 500,
+                            "smoothBorder " << smoothing[i] << " changed " <<
+                            differ << " pixels away from the shadow borders");
+      }
+      const int center = smoothborder_ground(images[i], -3.4f, 0.4f);
+      BOOST_CHECK_MESSAGE(abs(center - shadow) <= SMOOTHBORDER_TOLERANCE,
+                          "smoothBorder " << smoothing[i] << " faded the " <<
+                          "shadow center from " << shadow << " to " << center);
+      const int border = smoothborder_count_border(images[i], lit, shadow);
+      BOOST_CHECK_MESSAGE(border > prev,
+                          "smoothBorder " << smoothing[i] << " gave " <<
+                          border << " border pixels, not more than " << prev);
+      prev = border;
+    }
+
+    group->smoothBorder = 0.0f;
+    unsigned char * image = smoothborder_render(renderer, root);
+    BOOST_CHECK_MESSAGE(image != NULL, "couldn't render the scene again");
+    if (image) {
+      const int differ = smoothborder_count_differences(image, images[0], 0);
+      BOOST_CHECK_MESSAGE(differ == 0,
+                          "smoothBorder 0 again differs in " << differ <<
+                          " pixels from the unsmoothed image");
+      delete[] image;
+    }
+  }
+
+  for (int i = 0; i < numrendered; i++) delete[] images[i];
+  root->unref();
+}
+
+// the cascades must cover the depth range from near to far without
+// gaps, with the weight blending between a uniform and a logarithmic
+// split.
+BOOST_AUTO_TEST_CASE(cascadeSplits)
+{
+  const float weights[] = { 0.0f, 0.5f, 1.0f, 2.0f, -1.0f };
+  for (int w = 0; w < 5; w++) {
+    for (int n = 1; n <= 4; n++) {
+      float prev = SoShadowCascade::splitDistance(1.0f, 1000.0f, 0, n, weights[w]);
+      BOOST_CHECK_MESSAGE(prev == 1.0f,
+                          "first cascade of " << n << " starts at " << prev);
+      for (int i = 1; i <= n; i++) {
+        const float d = SoShadowCascade::splitDistance(1.0f, 1000.0f, i, n, weights[w]);
+        BOOST_CHECK_MESSAGE(d > prev, "split " << i << " of " << n <<
+                            " at " << d << " is not beyond " << prev);
+        prev = d;
+      }
+      BOOST_CHECK_MESSAGE(fabs(prev - 1000.0f) < 0.01f,
+                          "last cascade of " << n << " ends at " << prev);
+    }
+  }
+
+  const float uniform[] = { 1.0f, 334.0f, 667.0f, 1000.0f };
+  const float logarithmic[] = { 1.0f, 10.0f, 100.0f, 1000.0f };
+  for (int i = 0; i < 4; i++) {
+    float d = SoShadowCascade::splitDistance(1.0f, 1000.0f, i, 3, 0.0f);
+    BOOST_CHECK_MESSAGE(fabs(d - uniform[i]) < 0.01f,
+                        "uniform split " << i << " at " << d);
+    d = SoShadowCascade::splitDistance(1.0f, 1000.0f, i, 3, 1.0f);
+    BOOST_CHECK_MESSAGE(fabs(d - logarithmic[i]) < 0.01f,
+                        "logarithmic split " << i << " at " << d);
+    d = SoShadowCascade::splitDistance(1.0f, 1000.0f, i, 3, 0.5f);
+    const float blend = 0.5f * (uniform[i] + logarithmic[i]);
+    BOOST_CHECK_MESSAGE(fabs(d - blend) < 0.01f,
+                        "blended split " << i << " at " << d);
+    // weights outside [0, 1] are clamped
+    BOOST_CHECK(SoShadowCascade::splitDistance(1.0f, 1000.0f, i, 3, 2.0f) ==
+                SoShadowCascade::splitDistance(1.0f, 1000.0f, i, 3, 1.0f));
+    // a logarithmic split is not possible without a positive near
+    // distance
+    d = SoShadowCascade::splitDistance(0.0f, 999.0f, i, 3, 1.0f);
+    BOOST_CHECK_MESSAGE(fabs(d - (uniform[i] - 1.0f)) < 0.01f,
+                        "split " << i << " with near 0 at " << d);
+  }
+}
+
+namespace {
+
+void
+shadowcaching_count(void * closure, SoAction * action)
+{
+  if (action->isOfType(SoGLRenderAction::getClassTypeId())) {
+    ++*static_cast<int *>(closure);
+  }
+}
+
+// renders the scene and returns the number of times the shadow
+// casters were traversed, or -1 if no offscreen context could be made
+int
+shadowcaching_render(SoOffscreenRenderer & renderer, SoNode * root, int & count)
+{
+  count = 0;
+  return renderer.render(root) ? count : -1;
+}
+
+} // namespace
+
+// the casters are traversed once for the scene and once for each
+// shadow map rendered, so the count tells whether the shadow map was
+// reused, and anything that changes the shadow map scene graph or the
+// light must render it again.
+BOOST_AUTO_TEST_CASE(shadowCaching)
+{
+  SoShadowGroup * group = new SoShadowGroup;
+  SoSeparator * root = smoothborder_scene(group);
+  root->ref();
+
+  int count = 0;
+  SoCallback * counter = new SoCallback;
+  counter->setCallback(shadowcaching_count, &count);
+  group->insertChild(counter, 2);
+  SoShadowDirectionalLight * light =
+    static_cast<SoShadowDirectionalLight *>(group->getChild(0));
+  SoTransform * transform = static_cast<SoTransform *>
+    (static_cast<SoSeparator *>(group->getChild(3))->getChild(0));
+
+  SoOffscreenRenderer renderer(SbViewportRegion(64, 64));
+  const int first = shadowcaching_render(renderer, root, count);
+  if (first < 0) {
+    BOOST_TEST_MESSAGE("no offscreen context, skipping shadowCaching test");
+  }
+  else {
+    const int reused = shadowcaching_render(renderer, root, count);
+    BOOST_CHECK_MESSAGE(reused < first,
+                        "the unchanged shadow map was rendered again (" <<
+                        first << " then " << reused << " traversals)");
+    BOOST_CHECK_EQUAL(shadowcaching_render(renderer, root, count), reused);
+
+    transform->translation.setValue(-5.0f, -1.0f, 8.0f);
+    BOOST_CHECK_MESSAGE(shadowcaching_render(renderer, root, count) == first,
+                        "moving a caster didn't render the shadow map");
+    BOOST_CHECK_EQUAL(shadowcaching_render(renderer, root, count), reused);
+
+    light->direction.setValue(0.3f, 0.2f, -1.0f);
+    BOOST_CHECK_MESSAGE(shadowcaching_render(renderer, root, count) == first,
+                        "changing the light didn't render the shadow map");
+
+    group->shadowCachingEnabled = FALSE;
+    BOOST_CHECK_EQUAL(shadowcaching_render(renderer, root, count), first);
+    BOOST_CHECK_EQUAL(shadowcaching_render(renderer, root, count), first);
+
+    // each cascade has its own shadow map
+    group->shadowCachingEnabled = TRUE;
+    light->numCascades = 3;
+    const int cascaded = shadowcaching_render(renderer, root, count);
+    BOOST_CHECK_MESSAGE(cascaded > first,
+                        "3 cascades gave " << cascaded << " traversals, " <<
+                        "1 gave " << first);
+    BOOST_CHECK_EQUAL(shadowcaching_render(renderer, root, count), reused);
+  }
+  root->unref();
+}
+
 #endif // COIN_TEST_SUITE
@@ -82,6 +82,17 @@
   two separate SoText2 nodes, one for each font, since it will have to
   recalculate glyph bitmap ids and positions for each call to \c GLrender().
 
+  The glyph bitmaps are rendered as textured quads, from a texture
+  atlas shared by all SoText2 nodes, so that the glyphs of a node
+  are drawn with one draw call per atlas page. This can be disabled
+  by setting the environment variable \c COIN_TEXT2_GLYPH_ATLAS to
+  0, in which case each glyph is drawn with glBitmap() or
+  glDrawPixels(). The atlas uses at most 8 pages of 1024x1024
+  pixels, or the number of pages given by the environment variable
+  \c COIN_TEXT2_GLYPH_ATLAS_PAGES, and pages not used by any SoText2
+  node are reused for new glyphs. Nodes whose glyphs don't fit fall
+  back to glBitmap() and glDrawPixels().
+
   SoScale nodes cannot be used to influence the dimensions of the
   rendering output of SoText2 nodes.
 
@@ -141,6 +152,7 @@
 
 #include "nodes/SoSubNodeP.h"
 #include "caches/SoGlyphCache.h"
+#include "rendering/SoGLGlyphAtlas.h"
 
 // The "lean and mean" define is a workaround for a Cygwin bug: when
 // windows.h is included _after_ one of the X11 or GLX headers above
@@ -214,7 +226,7 @@
 
 class SoText2P {
 public:
-  SoText2P(SoText2 * textnode) : maxwidth(0), master(textnode)
+  SoText2P(SoText2 * textnode) : maxwidth(0), atlasstatus(0), master(textnode)
   {
     this->bbox.makeEmpty();
   }
@@ -227,16 +239,23 @@ public:
   void dumpBuffer(unsigned char * buffer, SbVec2s size, SbVec2s pos, SbBool mono);
   void computeBBox(SoAction * action, SbBox3f & box, SbVec3f & center);
   static void setRasterPos3f(GLfloat x, GLfloat y, GLfloat z);
+  void buildAtlasQuads(void);
+  void renderAtlasQuads(SoState * state, const float textscreenoffsetx,
+                        const SbVec3f & nilpoint);
 
 
   SbList <int> stringwidth;
   int maxwidth;
   SbList< SbList<SbVec2s> > positions;
   SbBox2s bbox;
+  // 1 if the glyphs are in the glyph atlas, -1 if they couldn't be
+  // added, 0 if it hasn't been tried yet
+  int atlasstatus;
 
   SoGlyphCache * cache;
   SoFieldSensor * spacingsensor;
   SoFieldSensor * stringsensor;
+  SoFieldSensor * justificationsensor;
   unsigned char * pixel_buffer;
   int pixel_buffer_size;
 
@@ -299,6 +318,10 @@ SoText2::SoText2(void)
   PRIVATE(this)->spacingsensor = new SoFieldSensor(SoText2P::sensor_cb, PRIVATE(this));
   PRIVATE(this)->spacingsensor->attach(&this->spacing);
   PRIVATE(this)->spacingsensor->setPriority(0);
+  // the atlas quads in the glyph cache include the justification
+  PRIVATE(this)->justificationsensor = new SoFieldSensor(SoText2P::sensor_cb, PRIVATE(this));
+  PRIVATE(this)->justificationsensor->attach(&this->justification);
+  PRIVATE(this)->justificationsensor->setPriority(0);
   PRIVATE(this)->cache = NULL;
   PRIVATE(this)->pixel_buffer = NULL;
   PRIVATE(this)->pixel_buffer_size = 0;
@@ -313,6 +336,7 @@ SoText2::~SoText2()
   delete[] PRIVATE(this)->pixel_buffer;
   delete PRIVATE(this)->stringsensor;
   delete PRIVATE(this)->spacingsensor;
+  delete PRIVATE(this)->justificationsensor;
 
   PRIVATE(this)->flushGlyphCache();
   delete PRIVATE(this);
@@ -325,6 +349,7 @@ void
 SoText2::initClass(void)
 {
   SO_NODE_INTERNAL_INIT_CLASS(SoText2, SO_FROM_INVENTOR_2_1);
+  SoGLGlyphAtlas::initClass();
 }
 
 // **************************************************************************
@@ -380,6 +405,8 @@ SoText2::GLRender(SoGLRenderAction * action)
       break;
     }
 
+    if (PRIVATE(this)->atlasstatus == 0) PRIVATE(this)->buildAtlasQuads();
+
     // Set new state.
     glMatrixMode(GL_MODELVIEW);
     glPushMatrix();
@@ -419,117 +446,122 @@ SoText2::GLRender(SoGLRenderAction * action)
 
     SbBool drawPixelBuffer = FALSE;
 
-    for (int i = 0; i < nrlines; i++) {
-      SbString str = this->string[i];
-      switch (this->justification.getValue()) {
-      case SoText2::LEFT:
-        xpos = 0;
-        break;
-      case SoText2::RIGHT:
-        xpos = PRIVATE(this)->maxwidth - PRIVATE(this)->stringwidth[i];
-        break;
-      case SoText2::CENTER:
-        xpos = (PRIVATE(this)->maxwidth - PRIVATE(this)->stringwidth[i]) / 2;
-        break;
-      }
+    if (PRIVATE(this)->atlasstatus > 0) {
+      PRIVATE(this)->renderAtlasQuads(state, textscreenoffsetx, nilpoint);
+    }
+    else {
+      for (int i = 0; i < nrlines; i++) {
+        SbString str = this->string[i];
+        switch (this->justification.getValue()) {
+        case SoText2::LEFT:
+          xpos = 0;
+          break;
+        case SoText2::RIGHT:
+          xpos = PRIVATE(this)->maxwidth - PRIVATE(this)->stringwidth[i];
+          break;
+        case SoText2::CENTER:
+          xpos = (PRIVATE(this)->maxwidth - PRIVATE(this)->stringwidth[i]) / 2;
+          break;
+        }
 
-      int kerningx = 0;
-      int kerningy = 0;
-      int advancex = 0;
-      int advancey = 0;
+        int kerningx = 0;
+        int kerningy = 0;
+        int advancex = 0;
+        int advancey = 0;
 
-      const char * p = str.getString();
-      size_t length = cc_string_utf8_validate_length(p);
+        const char * p = str.getString();
+        size_t length = cc_string_utf8_validate_length(p);
 
-      for (unsigned int strcharidx = 0; strcharidx < length; strcharidx++) {
-        uint32_t glyphidx = 0;
+        for (unsigned int strcharidx = 0; strcharidx < length; strcharidx++) {
+          uint32_t glyphidx = 0;
 
-        glyphidx = cc_string_utf8_get_char(p);
-        p = cc_string_utf8_next_char(p);
+          glyphidx = cc_string_utf8_get_char(p);
+          p = cc_string_utf8_next_char(p);
 
-        cc_glyph2d * glyph = cc_glyph2d_ref(glyphidx, fontspec, 0.0f);
+          cc_glyph2d * glyph = cc_glyph2d_ref(glyphidx, fontspec, 0.0f);
 
-        buffer = cc_glyph2d_getbitmap(glyph, bitmapsize, bitmappos);
+          buffer = cc_glyph2d_getbitmap(glyph, bitmapsize, bitmappos);
 
-        ix = bitmapsize[0];
-        iy = bitmapsize[1];
+          ix = bitmapsize[0];
+          iy = bitmapsize[1];
 
-        // Advance & Kerning
-        if (strcharidx > 0)
-          cc_glyph2d_getkerning(prevglyph, glyph, &kerningx, &kerningy);
-        cc_glyph2d_getadvance(glyph, &advancex, &advancey);
+          // Advance & Kerning
+          if (strcharidx > 0)
+            cc_glyph2d_getkerning(prevglyph, glyph, &kerningx, &kerningy);
+          cc_glyph2d_getadvance(glyph, &advancex, &advancey);
 
-        rasterx = xpos + kerningx + bitmappos[0];
-        rastery = ypos + (bitmappos[1] - bitmapsize[1]);
+          rasterx = xpos + kerningx + bitmappos[0];
+          rastery = ypos + (bitmappos[1] - bitmapsize[1]);
 
-        if (buffer) {
-          if (cc_glyph2d_getmono(glyph)) {
-            SoText2P::setRasterPos3f((float)rasterx + textscreenoffsetx, (float)rastery + (int)nilpoint[1], -nilpoint[2]);
-            glBitmap(ix,iy,0,0,0,0,(const GLubyte *)buffer);
-          }
-          else {
-            if (!drawPixelBuffer) {
-              int numpixels = bbsize[0] * bbsize[1];
-              if (numpixels > PRIVATE(this)->pixel_buffer_size) {
-                delete[] PRIVATE(this)->pixel_buffer;
-                PRIVATE(this)->pixel_buffer = new unsigned char[numpixels*4];
-                PRIVATE(this)->pixel_buffer_size = numpixels;
-              }
-              memset(PRIVATE(this)->pixel_buffer, 0, numpixels * 4);
-              drawPixelBuffer = TRUE;
+          if (buffer) {
+            if (cc_glyph2d_getmono(glyph)) {
+              SoText2P::setRasterPos3f((float)rasterx + textscreenoffsetx, (float)rastery + (int)nilpoint[1], -nilpoint[2]);
+              glBitmap(ix,iy,0,0,0,0,(const GLubyte *)buffer);
             }
-
-            int memx = rasterx - bbmin[0];
-            int memy = bbsize[1] - (bbmax[1] - rastery - 1) - 1;
-
-            if (memx >= 0 && memx + bitmapsize[0] <= bbsize[0] &&
-                memy >= 0 && memy + bitmapsize[1] <= bbsize[1]) {
-
-              unsigned char * dst = PRIVATE(this)->pixel_buffer + (memy * bbsize[0] + memx) * 4;
-              const unsigned char * src = buffer;
-              int nextlineoffset = (bbsize[0] - bitmapsize[0]) * 4;
-
-              // Ouch. This must lead to pretty slow rendering
-              for (int y = 0; y < iy; y++) {
-                for (int x = 0; x < ix; x++) {
-                  *dst++ = red; *dst++ = green; *dst++ = blue;
-                  // alpha from the gray level pixel value, blended with current value (because glyph bitmaps can overlap)
-                  int srcval = *src;
-                  int oldval = *dst;
-                  *dst = ((oldval * (256 - srcval) + alpha * srcval) >> 8);
-                  src++; dst++;
+            else {
+              if (!drawPixelBuffer) {
+                int numpixels = bbsize[0] * bbsize[1];
+                if (numpixels > PRIVATE(this)->pixel_buffer_size) {
+                  delete[] PRIVATE(this)->pixel_buffer;
+                  PRIVATE(this)->pixel_buffer = new unsigned char[numpixels*4];
+                  PRIVATE(this)->pixel_buffer_size = numpixels;
                 }
-                dst += nextlineoffset;
+                memset(PRIVATE(this)->pixel_buffer, 0, numpixels * 4);
+                drawPixelBuffer = TRUE;
               }
-            } else {
-              static SbBool once = TRUE;
-              if (once) {
-                SoDebugError::post("SoText2::GLRender",
-                                   "Unable to copy glyph to memory buffer. Position [%d,%d], size [%d,%d], buffer size [%d,%d]",
-                                   memx, memy, bitmapsize[0], bitmapsize[1], bbsize[0], bbsize[1]);
-                once = FALSE;
+
+              int memx = rasterx - bbmin[0];
+              int memy = bbsize[1] - (bbmax[1] - rastery - 1) - 1;
+
+              if (memx >= 0 && memx + bitmapsize[0] <= bbsize[0] &&
+                  memy >= 0 && memy + bitmapsize[1] <= bbsize[1]) {
+
+                unsigned char * dst = PRIVATE(this)->pixel_buffer + (memy * bbsize[0] + memx) * 4;
+                const unsigned char * src = buffer;
+                int nextlineoffset = (bbsize[0] - bitmapsize[0]) * 4;
+
+                // Ouch. This must lead to pretty slow rendering
+                for (int y = 0; y < iy; y++) {
+                  for (int x = 0; x < ix; x++) {
+                    *dst++ = red; *dst++ = green; *dst++ = blue;
+                    // alpha from the gray level pixel value, blended with current value (because glyph bitmaps can overlap)
+                    int srcval = *src;
+                    int oldval = *dst;
+                    *dst = ((oldval * (256 - srcval) + alpha * srcval) >> 8);
+                    src++; dst++;
+                  }
+                  dst += nextlineoffset;
+                }
+              } else {
+                static SbBool once = TRUE;
+                if (once) {
+                  SoDebugError::post("SoText2::GLRender",
+                                     "Unable to copy glyph to memory buffer. Position [%d,%d], size [%d,%d], buffer size [%d,%d]",
+                                     memx, memy, bitmapsize[0], bitmapsize[1], bbsize[0], bbsize[1]);
+                  once = FALSE;
+                }
               }
             }
           }
-        }
 
-        xpos += (advancex + kerningx);
+          xpos += (advancex + kerningx);
 
-        if (prevglyph) {
-          // should be safe to unref here. SoGlyphCache will have a
-          // ref'ed instance
-          cc_glyph2d_unref(prevglyph);
+          if (prevglyph) {
+            // should be safe to unref here. SoGlyphCache will have a
+            // ref'ed instance
+            cc_glyph2d_unref(prevglyph);
+          }
+          prevglyph = glyph;
         }
-        prevglyph = glyph;
-      }
 
-      ypos -= (int)(((int) fontsize) * this->spacing.getValue());
-    }
+        ypos -= (int)(((int) fontsize) * this->spacing.getValue());
+      }
 
-    if (prevglyph) {
-      // should be safe to unref here. SoGlyphCache will have a ref'ed
-      // instance
-      cc_glyph2d_unref(prevglyph);
+      if (prevglyph) {
+        // should be safe to unref here. SoGlyphCache will have a ref'ed
+        // instance
+        cc_glyph2d_unref(prevglyph);
+      }
     }
 
     if (drawPixelBuffer) {
@@ -698,6 +730,7 @@ SoText2::generatePrimitives(SoAction * COIN_UNUSED_ARG(action))
 void
 SoText2P::flushGlyphCache()
 {
+  this->atlasstatus = 0;
   this->stringwidth.truncate(0);
   this->maxwidth=0;
   this->positions.truncate(0);
@@ -881,14 +914,20 @@ SoText2P::buildGlyphCache(SoState * state)
     const char * p = str.getString();
     size_t length = cc_string_utf8_validate_length(p);
 
-    // fetch all glyphs first
+    // fetch all glyphs first, with one lookup in the glyph cache
+    SbList<uint32_t> characters(int(length) + 1);
+    SbList<cc_glyph2d *> glyphs(int(length) + 1);
     for (unsigned int strcharidx = 0; strcharidx < length; strcharidx++) {
-      uint32_t glyphidx = 0;
-
-      glyphidx = cc_string_utf8_get_char(p);
+      characters.append(cc_string_utf8_get_char(p));
+      glyphs.append(NULL);
       p = cc_string_utf8_next_char(p);
+    }
+    if (length > 0) {
+      cc_glyph2d_ref_string(characters.getArrayPtr(), int(length), fontspec, 0.0f, &glyphs[0]);
+    }
 
-      cc_glyph2d * glyph = cc_glyph2d_ref(glyphidx, fontspec, 0.0f);
+    for (unsigned int strcharidx = 0; strcharidx < length; strcharidx++) {
+      cc_glyph2d * glyph = glyphs[strcharidx];
       // Should _always_ be able to get hold of a glyph -- if no
       // glyph is available for a specific character, a default
       // empty rectangle should be used.  -mortene.
@@ -984,5 +1023,107 @@ SoText2P::setRasterPos3f(GLfloat x, GLfloat y, GLfloat z)
   if (offvp) { glBitmap(0, 0, 0, 0,offsetx,offsety, NULL); }
 }
 
+// Adds the glyphs to the glyph atlas, and stores quads for rendering
+// them in the glyph cache.
+void
+SoText2P::buildAtlasQuads(void)
+{
+  this->atlasstatus = -1;
+  if (!SoGLGlyphAtlas::isEnabled()) return;
+
+  const cc_font_specification * fontspec = this->cache->getCachedFontspec();
+  const SbVec2s & bbmin = this->bbox.getMin();
+  const int nrlines = PUBLIC(this)->string.getNum();
+  for (int i = 0; i < nrlines; i++) {
+    int xoffset = 0;
+    switch (PUBLIC(this)->justification.getValue()) {
+    case SoText2::LEFT:
+      break;
+    case SoText2::RIGHT:
+      xoffset = this->maxwidth - this->stringwidth[i];
+      break;
+    case SoText2::CENTER:
+      xoffset = (this->maxwidth - this->stringwidth[i]) / 2;
+      break;
+    }
+
+    SbString str = PUBLIC(this)->string[i];
+    const char * p = str.getString();
+    size_t length = cc_string_utf8_validate_length(p);
+    for (unsigned int strcharidx = 0; strcharidx < length; strcharidx++) {
+      uint32_t glyphidx = cc_string_utf8_get_char(p);
+      p = cc_string_utf8_next_char(p);
+
+      // should be safe to unref below. SoGlyphCache will have a
+      // ref'ed instance
+      cc_glyph2d * glyph = cc_glyph2d_ref(glyphidx, fontspec, 0.0f);
+      int bitmapsize[2];
+      int bitmappos[2];
+      const unsigned char * buffer = cc_glyph2d_getbitmap(glyph, bitmapsize, bitmappos);
+      if (buffer && bitmapsize[0] > 0 && bitmapsize[1] > 0) {
+        int page, pagex, pagey;
+        if (!SoGLGlyphAtlas::addGlyph(glyph, glyphidx, fontspec, page, pagex, pagey)) {
+          cc_glyph2d_unref(glyph);
+          return;
+        }
+        const SbBool mono = cc_glyph2d_getmono(glyph);
+        const SbVec2s & pos = this->positions[i][strcharidx];
+        // gray level glyphs are positioned relative to the bounding
+        // box, like the pixel buffer they were copied into before
+        this->cache->addAtlasQuad(mono, page,
+                                  xoffset + pos[0] - (mono ? 0 : bbmin[0]), pos[1],
+                                  bitmapsize[0], bitmapsize[1], pagex, pagey);
+      }
+      cc_glyph2d_unref(glyph);
+    }
+  }
+  this->atlasstatus = 1;
+}
+
+// Renders the glyphs from the glyph atlas, at the same pixels as
+// glBitmap() and glDrawPixels() would have. Expects the GL matrices
+// to be set up for rendering in window coordinates.
+void
+SoText2P::renderAtlasQuads(SoState * state, const float textscreenoffsetx,
+                           const SbVec3f & nilpoint)
+{
+  glPushAttrib(GL_TEXTURE_BIT | GL_POLYGON_BIT);
+  glEnable(GL_TEXTURE_2D);
+  glDisable(GL_TEXTURE_GEN_S);
+  glDisable(GL_TEXTURE_GEN_T);
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+  glDisable(GL_CULL_FACE);
+  glDisable(GL_POLYGON_STIPPLE);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  glEnable(GL_ALPHA_TEST);
+  glMatrixMode(GL_TEXTURE);
+  glPushMatrix();
+  glLoadIdentity();
+  glMatrixMode(GL_MODELVIEW);
+
+  if (this->cache->hasAtlasQuads(TRUE)) {
+    glPushMatrix();
+    glTranslatef((float) floor(textscreenoffsetx), (float) ((int) nilpoint[1]), -nilpoint[2]);
+    glAlphaFunc(GL_GREATER, 0.0f);
+    this->cache->renderAtlasQuads(state, TRUE);
+    glPopMatrix();
+  }
+  if (this->cache->hasAtlasQuads(FALSE)) {
+    glPushMatrix();
+    glTranslatef((float) floor(textscreenoffsetx + 0.5f), (float) floor(nilpoint[1] + 0.5f),
+                 -nilpoint[2]);
+    glAlphaFunc(GL_GREATER, 0.3f);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    this->cache->renderAtlasQuads(state, FALSE);
+    glPopMatrix();
+  }
+
+  glMatrixMode(GL_TEXTURE);
+  glPopMatrix();
+  glMatrixMode(GL_MODELVIEW);
+  glPopAttrib();
+}
+
 #undef PRIVATE
 #undef PUBLIC
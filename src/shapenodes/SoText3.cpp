@@ -111,6 +111,12 @@
   a few characters to be placed in your scene, rather than to
   visualize complete sentences.
 
+  The triangulated geometry is shared by all SoText3 nodes rendering
+  the same strings with the same font, layout and profile, and is
+  rendered from vertex buffer objects when possible. Geometry that is
+  no longer used by any node is kept in a cache, see \ref
+  COIN_TEXT3_GEOMETRY_CACHE_SIZE.
+
   <b>FILE FORMAT/DEFAULTS:</b>
   \code
     Text3 {
@@ -173,6 +179,7 @@
 #include "nodes/SoSubNodeP.h"
 #include "fonts/glyph3d.h"
 #include "caches/SoGlyphCache.h"
+#include "caches/SoTextGeometryCache.h"
 
 // *************************************************************************
 
@@ -262,6 +269,10 @@ public:
   SoText3P(SoText3 * master) : master(master) { }
 
   void render(SoState * state, const cc_font_specification * fontspec, unsigned int part);
+  void tessellate(SoTextGeometryCache * geometry, SoState * state,
+                  const cc_font_specification * fontspec, unsigned int part,
+                  const SbBool validprofile, const int firstprofile,
+                  const float nearz, const float farz, const float creaseangle);
   void generate(SoAction * action, const cc_font_specification * fontspec, unsigned int part);
 
   SbList <float> widths;
@@ -270,6 +281,8 @@ public:
   SoNormalGenerator * normalgenerator;
 
   SoGlyphCache * cache;
+  // the shared geometry of the front, sides and back
+  SoTextGeometryCache * geometry[3];
 
   void lock(void) {
 #ifdef COIN_THREADSAFE
@@ -325,11 +338,15 @@ SoText3::SoText3(void)
   PRIVATE(this) = new SoText3P(this);
   PRIVATE(this)->normalgenerator = new SoNormalGenerator(FALSE, 0xff);
   PRIVATE(this)->cache = NULL;
+  for (int i = 0; i < 3; i++) PRIVATE(this)->geometry[i] = NULL;
 }
 
 SoText3::~SoText3()
 {
   if (PRIVATE(this)->cache) PRIVATE(this)->cache->unref();
+  for (int i = 0; i < 3; i++) {
+    if (PRIVATE(this)->geometry[i]) PRIVATE(this)->geometry[i]->unref();
+  }
   delete PRIVATE(this)->normalgenerator;
   delete PRIVATE(this);
 }
@@ -341,6 +358,7 @@ void
 SoText3::initClass(void)
 {
   SO_NODE_INTERNAL_INIT_CLASS(SoText3, SO_FROM_INVENTOR_2_1);
+  SoTextGeometryCache::initClass();
 }
 
 // doc in parent
@@ -597,8 +615,6 @@ void
 SoText3P::render(SoState * state, const cc_font_specification * fontspec,
                  unsigned int part)
 {
-  int i, n = this->widths.getLength();
-
   int firstprofile = -1;
   int32_t profnum;
   SbVec2f *profcoords;
@@ -667,6 +683,63 @@ SoText3P::render(SoState * state, const cc_font_specification * fontspec,
     farz = -1.0;
   }
 
+  // Nodes that render the same strings with the same font, layout
+  // and profile share the geometry. The sides also depend on the
+  // profile coordinates and the crease angle.
+  SbString key;
+  key.sprintf("%u|%s|%s|%.9g|%.9g|%d|%.9g|%.9g|%.9g",
+              part,
+              cc_string_get_text(&fontspec->name),
+              cc_string_get_text(&fontspec->style),
+              fontspec->size, fontspec->complexity,
+              PUBLIC(this)->justification.getValue(),
+              PUBLIC(this)->spacing.getValue(), nearz, farz);
+  if (part == SoText3::SIDES) {
+    SbString str;
+    key += str.sprintf("|%.9g", creaseangle);
+    for (int j = validprofile ? firstprofile : numprofiles; j < numprofiles; j++) {
+      SoProfile * pn = (SoProfile *) profilenodes[j];
+      pn->getVertices(state, profnum, profcoords);
+      key += "|";
+      for (int k = 0; k < profnum; k++) {
+        key += str.sprintf("%.9g,%.9g;", profcoords[k][0], profcoords[k][1]);
+      }
+    }
+  }
+  for (int i = 0; i < PUBLIC(this)->string.getNum(); i++) {
+    SbString str;
+    key += str.sprintf("|%d:", PUBLIC(this)->string[i].getLength());
+    key += PUBLIC(this)->string[i];
+  }
+
+  const int idx = (part == SoText3::FRONT) ? 0 : ((part == SoText3::SIDES) ? 1 : 2);
+  if (this->geometry[idx] == NULL || this->geometry[idx]->getKey() != key) {
+    SoTextGeometryCache * geometry = SoTextGeometryCache::find(key);
+    if (geometry == NULL) {
+      geometry = SoTextGeometryCache::create(key);
+      this->tessellate(geometry, state, fontspec, part, validprofile,
+                       firstprofile, nearz, farz, creaseangle);
+      geometry->close();
+    }
+    if (this->geometry[idx]) this->geometry[idx]->unref();
+    this->geometry[idx] = geometry;
+  }
+  this->geometry[idx]->render(state, do2Dtextures);
+}
+
+// Adds the triangles for a part of the text to geometry.
+void
+SoText3P::tessellate(SoTextGeometryCache * geometry, SoState * state,
+                     const cc_font_specification * fontspec, unsigned int part,
+                     const SbBool validprofile, const int firstprofile,
+                     const float nearz, const float farz, const float creaseangle)
+{
+  int i, n = this->widths.getLength();
+  int32_t profnum;
+  SbVec2f *profcoords;
+  const SoNodeList & profilenodes = SoProfileElement::get(state);
+  const int numprofiles = profilenodes.getLength();
+
   float ypos = 0.0f;
   for (i = 0; i < n; i++) {
 
@@ -707,41 +780,31 @@ SoText3P::render(SoState * state, const cc_font_specification * fontspec,
       prevglyph = glyph;
 
       if (part != SoText3::SIDES) {  // FRONT & BACK
+        const SbVec3f normal(0.0f, 0.0f, (part == SoText3::FRONT) ? 1.0f : -1.0f);
+        const float zval = (part == SoText3::FRONT) ? nearz : farz;
         const int * ptr = cc_glyph3d_getfaceindices(glyph);
-        glBegin(GL_TRIANGLES);
 
-        while (*ptr >= 0) {
-          SbVec2f v0, v1, v2;
-          float zval;
-          if (part == SoText3::FRONT) {
-            glNormal3f(0.0f, 0.0f, 1.0f);
-            v2 = coords[*ptr++];
-            v1 = coords[*ptr++];
-            v0 = coords[*ptr++];
-            zval = nearz;
-          }
-          else {  // BACK
-            glNormal3f(0.0f, 0.0f, -1.0f);
-            v0 = coords[*ptr++];
-            v1 = coords[*ptr++];
-            v2 = coords[*ptr++];
-            zval = farz;
-          }
-          if(do2Dtextures)
-            glTexCoord2f(v0[0] + xpos/fontspec->size,
-                         v0[1] + ypos/fontspec->size);
-          glVertex3f(v0[0] * fontspec->size + xpos, v0[1] * fontspec->size + ypos, zval);
-          if(do2Dtextures)
-            glTexCoord2f(v1[0] + xpos/fontspec->size,
-                         v1[1] + ypos/fontspec->size);
-          glVertex3f(v1[0] * fontspec->size + xpos, v1[1] * fontspec->size + ypos, zval);
-          if(do2Dtextures)
-            glTexCoord2f(v2[0] + xpos/fontspec->size,
-                         v2[1] + ypos/fontspec->size);
-          glVertex3f(v2[0] * fontspec->size + xpos, v2[1] * fontspec->size + ypos, zval);
+        // add each coordinate used by the faces once
+        int numcoords = 0;
+        for (const int * p = ptr; *p >= 0; p++) {
+          if (*p >= numcoords) numcoords = *p + 1;
+        }
+        const int first = geometry->getNumVertices();
+        for (int c = 0; c < numcoords; c++) {
+          geometry->addVertex(SbVec3f(coords[c][0] * fontspec->size + xpos,
+                                      coords[c][1] * fontspec->size + ypos, zval),
+                              normal,
+                              SbVec2f(coords[c][0] + xpos/fontspec->size,
+                                      coords[c][1] + ypos/fontspec->size));
+        }
 
+        while (*ptr >= 0) {
+          const int i0 = first + *ptr++;
+          const int i1 = first + *ptr++;
+          const int i2 = first + *ptr++;
+          if (part == SoText3::FRONT) geometry->addTriangle(i2, i1, i0);
+          else geometry->addTriangle(i0, i1, i2);
         }
-        glEnd();
       }
       else { // SIDES
 
@@ -750,8 +813,6 @@ SoText3P::render(SoState * state, const cc_font_specification * fontspec,
           SbVec2f v0, v1;
           int counter = 0;
 
-          glBegin(GL_QUADS);
-
           while (*ptr >= 0) {
             v1 = coords[*ptr++];
             v0 = coords[*ptr++];
@@ -784,57 +845,24 @@ SoText3P::render(SoState * state, const cc_font_specification * fontspec,
               flatshading = TRUE;
             }
 
-            if (!flatshading) {
-              if(do2Dtextures)
-                 glTexCoord2f(v1[0] + xpos/fontspec->size,
-                              v1[1] + ypos/fontspec->size);
-              glNormal3fv(normala.getValue());
-              glVertex3f(v1[0]*fontspec->size + xpos, v1[1]*fontspec->size + ypos, 0.0f);
-
-              if(do2Dtextures)
-                glTexCoord2f(v0[0] + xpos/fontspec->size,
-                             v0[1] + ypos/fontspec->size);
-              glNormal3fv(normalb.getValue());
-              glVertex3f(v0[0]*fontspec->size + xpos, v0[1]*fontspec->size + ypos, 0.0f);
-
-              if(do2Dtextures)
-                glTexCoord2f(v0[0] + xpos/fontspec->size,
-                             v0[1] + ypos/fontspec->size);
-              glNormal3fv(normalb.getValue());
-              glVertex3f(v0[0]*fontspec->size + xpos, v0[1]*fontspec->size + ypos, -1.0f);
-
-              if(do2Dtextures)
-                glTexCoord2f(v1[0] + xpos/fontspec->size,
-                             v1[1] + ypos/fontspec->size);
-              glNormal3fv(normala.getValue());
-              glVertex3f(v1[0]*fontspec->size + xpos, v1[1]*fontspec->size + ypos, -1.0f);
-
-            }
-            else {
-              glNormal3fv(normala.getValue());
-              if(do2Dtextures)
-                glTexCoord2f(v1[0] + xpos/fontspec->size,
-                             v1[1] + ypos/fontspec->size);
-              glVertex3f(v1[0]*fontspec->size + xpos, v1[1]*fontspec->size + ypos, 0.0f);
-
-              if(do2Dtextures)
-                glTexCoord2f(v0[0] + xpos/fontspec->size,
-                             v0[1] + ypos/fontspec->size);
-              glVertex3f(v0[0]*fontspec->size + xpos, v0[1]*fontspec->size + ypos, 0.0f);
-
-              if(do2Dtextures)
-                glTexCoord2f(v0[0] + xpos/fontspec->size,
-                             v0[1] + ypos/fontspec->size);
-              glVertex3f(v0[0]*fontspec->size + xpos, v0[1]*fontspec->size + ypos, -1.0f);
-
-              if(do2Dtextures)
-                glTexCoord2f(v1[0] + xpos/fontspec->size,
-                             v1[1] + ypos/fontspec->size);
-              glVertex3f(v1[0]*fontspec->size + xpos, v1[1]*fontspec->size + ypos, -1.0f);
-            }
+            if (flatshading) normalb = normala;
+            const SbVec2f t1(v1[0] + xpos/fontspec->size, v1[1] + ypos/fontspec->size);
+            const SbVec2f t0(v0[0] + xpos/fontspec->size, v0[1] + ypos/fontspec->size);
+            const int q0 =
+              geometry->addVertex(SbVec3f(v1[0]*fontspec->size + xpos, v1[1]*fontspec->size + ypos, 0.0f),
+                                  normala, t1);
+            const int q1 =
+              geometry->addVertex(SbVec3f(v0[0]*fontspec->size + xpos, v0[1]*fontspec->size + ypos, 0.0f),
+                                  normalb, t0);
+            const int q2 =
+              geometry->addVertex(SbVec3f(v0[0]*fontspec->size + xpos, v0[1]*fontspec->size + ypos, -1.0f),
+                                  normalb, t0);
+            const int q3 =
+              geometry->addVertex(SbVec3f(v1[0]*fontspec->size + xpos, v1[1]*fontspec->size + ypos, -1.0f),
+                                  normala, t1);
+            geometry->addTriangle(q0, q1, q2);
+            geometry->addTriangle(q0, q2, q3);
           }
-          glEnd();
-
         }
         else {  // profile
           assert(validprofile && firstprofile >= 0);
@@ -940,29 +968,19 @@ SoText3P::render(SoState * state, const cc_font_specification * fontspec,
           // compilator. (Tested on MSVC 6 and GCC 2.95.4) (20031010
           // handegar).
 
-          glBegin(GL_TRIANGLES);
-
           for (int z = 0;z < size;z += 3) {
-
-            // FIXME: Add proper texturing for profile
-            // coords. (20031010 handegar)
-
-            glNormal3fv(normals[z+2].getValue());
-            glVertex3fv(SbVec3f(vertexlist[z+2][0] + xpos,
-                                vertexlist[z+2][1] + ypos,
-                                vertexlist[z+2][2]).getValue());
-
-            glNormal3fv(normals[z+1].getValue());
-            glVertex3fv(SbVec3f(vertexlist[z+1][0] + xpos,
-                                vertexlist[z+1][1] + ypos,
-                                vertexlist[z+1][2]).getValue());
-
-            glNormal3fv(normals[z].getValue());
-            glVertex3fv(SbVec3f(vertexlist[z][0] + xpos,
-                                vertexlist[z][1] + ypos,
-                                vertexlist[z][2]).getValue());
+            int tri[3];
+            for (int k = 0; k < 3; k++) {
+              const int vi = z + 2 - k;
+              const SbVec3f v(vertexlist[vi][0] + xpos,
+                              vertexlist[vi][1] + ypos,
+                              vertexlist[vi][2]);
+              tri[k] = geometry->addVertex(v, normals[vi],
+                                           SbVec2f(v[0] / fontspec->size,
+                                                   v[1] / fontspec->size));
+            }
+            geometry->addTriangle(tri[0], tri[1], tri[2]);
           }
-          glEnd();
 
           vertexlist.truncate(0);
 
@@ -1475,13 +1493,20 @@ SoText3P::setUpGlyphs(SoState * state, SoText3 * textnode)
     size_t length = cc_string_utf8_validate_length(p);
     // No assertion as zero length is handled correctly (results in a new line)
 
+    // fetch all glyphs first, with one lookup in the glyph cache
+    SbList<uint32_t> characters(int(length) + 1);
+    SbList<cc_glyph3d *> glyphs(int(length) + 1);
     for (unsigned int strcharidx = 0; strcharidx < length; strcharidx++) {
-      uint32_t glyphidx = 0;
-
-      glyphidx = cc_string_utf8_get_char(p);
+      characters.append(cc_string_utf8_get_char(p));
+      glyphs.append(NULL);
       p = cc_string_utf8_next_char(p);
+    }
+    if (length > 0) {
+      cc_glyph3d_ref_string(characters.getArrayPtr(), int(length), fontspec, &glyphs[0]);
+    }
 
-      cc_glyph3d * glyph = cc_glyph3d_ref(glyphidx, fontspec);
+    for (unsigned int strcharidx = 0; strcharidx < length; strcharidx++) {
+      cc_glyph3d * glyph = glyphs[strcharidx];
       this->cache->addGlyph(glyph);
       assert(glyph);
 
@@ -1517,3 +1542,66 @@ SoText3P::setUpGlyphs(SoState * state, SoText3 * textnode)
 
 #undef PRIVATE
 #undef PUBLIC
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTranslation.h>
+#include "caches/SoTextGeometryCache.h"
+
+// Two nodes with the same strings, font and parts must share the
+// geometry of each part, and a node must get new geometry when a
+// field that changes it is set.
+BOOST_AUTO_TEST_CASE(sharedGeometry)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoOrthographicCamera * camera = new SoOrthographicCamera;
+  camera->position.setValue(0.0f, 0.0f, 50.0f);
+  camera->height = 100.0f;
+  root->addChild(camera);
+  SoText3 * first = new SoText3;
+  first->string = "shared SoText3 geometry";
+  first->parts = SoText3::ALL;
+  root->addChild(first);
+
+  SoOffscreenRenderer renderer(SbViewportRegion(64, 64));
+  const int numentries = SoTextGeometryCache::getNumEntries();
+  if (!renderer.render(root)) {
+    BOOST_TEST_MESSAGE("no offscreen context, skipping sharedGeometry test");
+    root->unref();
+    return;
+  }
+  // one for each of the front, the sides and the back
+  BOOST_CHECK_EQUAL(SoTextGeometryCache::getNumEntries(), numentries + 3);
+  const size_t memory = SoTextGeometryCache::getMemoryUsage();
+
+  SoText3 * second = new SoText3;
+  second->string = first->string;
+  second->parts = SoText3::ALL;
+  root->addChild(new SoTranslation);
+  root->addChild(second);
+  BOOST_REQUIRE(renderer.render(root));
+  BOOST_CHECK_EQUAL(SoTextGeometryCache::getNumEntries(), numentries + 3);
+  BOOST_CHECK_EQUAL(SoTextGeometryCache::getMemoryUsage(), memory);
+
+  second->string = "another SoText3 string";
+  BOOST_REQUIRE(renderer.render(root));
+  BOOST_CHECK_EQUAL(SoTextGeometryCache::getNumEntries(), numentries + 6);
+  BOOST_CHECK(SoTextGeometryCache::getMemoryUsage() > memory);
+
+  // the geometry of the first string is still there to be reused
+  second->string = first->string;
+  BOOST_REQUIRE(renderer.render(root));
+  BOOST_CHECK_EQUAL(SoTextGeometryCache::getNumEntries(), numentries + 6);
+
+  second->justification = SoText3::RIGHT;
+  BOOST_REQUIRE(renderer.render(root));
+  BOOST_CHECK_EQUAL(SoTextGeometryCache::getNumEntries(), numentries + 9);
+
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
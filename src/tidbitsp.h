@@ -203,6 +203,19 @@ double coin_atof(const char * ptr);
 
 /* ********************************************************************** */
 
+/*
+  Convert arrays of 32-bit and 64-bit values between host and network
+  byte order. \a from and \a to may be the same array, and neither
+  needs to be aligned. On big-endian hosts this is a plain copy.
+*/
+void coin_hton_uint32_array(const void * from, void * to, size_t num);
+void coin_hton_uint64_array(const void * from, void * to, size_t num);
+
+#define coin_ntoh_uint32_array coin_hton_uint32_array
+#define coin_ntoh_uint64_array coin_hton_uint64_array
+
+/* ********************************************************************** */
+
 /*
   Functions to output ascii85 encoded data. Used for instance for PostScript
   image rendering.
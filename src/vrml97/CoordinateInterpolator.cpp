@@ -65,15 +65,15 @@
 #include <Inventor/VRMLnodes/SoVRMLCoordinateInterpolator.h>
 
 #include <Inventor/VRMLnodes/SoVRMLMacros.h>
-#include <Inventor/lists/SbList.h>
 
 #include "engines/SoSubNodeEngineP.h"
+#include "vrml97/SoVRMLInterpolatorP.h"
 
 #ifndef DOXYGEN_SKIP_THIS
 
 class SoVRMLCoordinateInterpolatorP {
 public:
-  SbList <SbVec3f> tmplist;
+  SoVRMLInterpolatorBuffer<SbVec3f> tmpbuffer;
 };
 
 #endif // DOXYGEN_SKIP_THIS
@@ -113,10 +113,9 @@ SoVRMLCoordinateInterpolator::evaluate(void)
   if (!this->value_changed.isEnabled()) return;
 
   float interp;
-  int i, idx = this->getKeyValueIndex(interp, this->keyValue.getNum());
+  int idx = this->getKeyValueIndex(interp, this->keyValue.getNum());
   if (idx < 0) return;
 
-  PRIVATE(this)->tmplist.truncate(0);
   const int numkeys = this->key.getNum();
   const int numcoords = this->keyValue.getNum() / numkeys;
 
@@ -124,11 +123,11 @@ SoVRMLCoordinateInterpolator::evaluate(void)
   const SbVec3f * c1 = c0;
   if (interp > 0.0f) c1 = this->keyValue.getValues((idx+1)*numcoords);
 
-  for (i = 0; i < numcoords; i++) {
-    PRIVATE(this)->tmplist.append(c0[i] + (c1[i]-c0[i]) * interp);
-  }
-
-  const SbVec3f * coords = PRIVATE(this)->tmplist.getArrayPtr();
+  SbVec3f * coords = PRIVATE(this)->tmpbuffer.get(numcoords);
+  sovrml_lerp_floats(reinterpret_cast<float *>(coords),
+                     reinterpret_cast<const float *>(c0),
+                     reinterpret_cast<const float *>(c1),
+                     interp, numcoords * 3);
 
   SO_ENGINE_OUTPUT(value_changed, SoMFVec3f, setNum(numcoords));
   SO_ENGINE_OUTPUT(value_changed, SoMFVec3f, setValues(0, numcoords, coords));
@@ -137,3 +136,63 @@ SoVRMLCoordinateInterpolator::evaluate(void)
 #undef PRIVATE
 
 #endif // HAVE_VRML97
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/VRMLnodes/SoVRMLCoordinateInterpolator.h>
+#include <Inventor/fields/SoMFVec3f.h>
+
+BOOST_AUTO_TEST_CASE(keySegmentLookup)
+{
+  SoVRMLCoordinateInterpolator * interp = new SoVRMLCoordinateInterpolator;
+  interp->ref();
+
+  // two coordinates per key, and a repeated key at 2
+  const float keys[] = { 0.0f, 1.0f, 2.0f, 2.0f, 4.0f, 8.0f };
+  const int numkeys = sizeof(keys) / sizeof(keys[0]);
+  interp->key.setValues(0, numkeys, keys);
+  interp->keyValue.setNum(numkeys * 2);
+  for (int i = 0; i < numkeys * 2; i++) {
+    interp->keyValue.set1Value(i, SbVec3f(float(i), float(i * i), -float(i)));
+  }
+
+  SoMFVec3f out;
+  out.connectFrom(&interp->value_changed);
+
+  // forward, backward and random access should all give the segment
+  // a linear scan of the keys finds
+  const float fractions[] = {
+    -1.0f, 0.0f, 0.25f, 0.5f, 1.0f, 1.5f, 2.0f, 3.0f, 5.0f, 7.5f, 8.0f, 9.0f,
+    6.0f, 2.5f, 0.75f, -0.5f, 4.0f, 1.999f
+  };
+  for (unsigned int f = 0; f < sizeof(fractions) / sizeof(fractions[0]); f++) {
+    const float fraction = fractions[f];
+    int k = 0;
+    while (k < numkeys && !(fraction < keys[k])) k++;
+    int idx = (k == numkeys) ? numkeys - 1 : SbMax(k - 1, 0);
+    float t = 0.0f;
+    if (k > 0 && k < numkeys && keys[k] > keys[k-1]) {
+      t = (fraction - keys[k-1]) / (keys[k] - keys[k-1]);
+    }
+
+    interp->set_fraction = fraction;
+    BOOST_REQUIRE_EQUAL(out.getNum(), 2);
+    for (int c = 0; c < 2; c++) {
+      const SbVec3f & c0 = interp->keyValue[idx * 2 + c];
+      const SbVec3f & c1 = (t > 0.0f) ? interp->keyValue[(idx + 1) * 2 + c] : c0;
+      BOOST_CHECK_MESSAGE(out[c] == c0 + (c1 - c0) * t,
+                          "wrong value for set_fraction " << fraction);
+    }
+  }
+
+  // changing the keys must not reuse the previous lookup state
+  interp->key.set1Value(1, 0.5f);
+  interp->set_fraction = 0.75f;
+  const float t = (0.75f - 0.5f) / (2.0f - 0.5f);
+  const SbVec3f expected = interp->keyValue[2] + (interp->keyValue[4] - interp->keyValue[2]) * t;
+  BOOST_CHECK(out[0] == expected);
+
+  interp->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -82,8 +82,43 @@
 
 #include <Inventor/VRMLnodes/SoVRMLMacros.h>
 
+#include <atomic>
+
 #include "engines/SoSubNodeEngineP.h"
 
+#ifndef DOXYGEN_SKIP_THIS
+
+namespace {
+
+// Key lookup state. When the keys are non-decreasing (as they should
+// be), getKeyValueIndex() first tries the segment found by the
+// previous lookup and the one after it, which is where set_fraction
+// usually ends up when driven by a time sensor, and does a binary
+// search otherwise.
+//
+// The public class layout is left as is, so the state is kept in a
+// small table per thread, indexed by the interpolator's address. An
+// entry is used only if it was made for the same interpolator with
+// the same key array and number of keys. The generation is bumped
+// when an interpolator is destructed, so a new interpolator at the
+// same address doesn't pick up its state.
+struct InterpolatorKeyState {
+  const SoVRMLInterpolator * interp;
+  const float * keys;
+  int numkeys;
+  unsigned int generation;
+  SbBool monotonic;
+  int upper; // index of the first key above the last fraction
+};
+
+const int INTERPOLATOR_NUM_STATES = 64;
+thread_local InterpolatorKeyState interpolator_states[INTERPOLATOR_NUM_STATES];
+std::atomic<unsigned int> interpolator_generation(1);
+
+} // anonymous namespace
+
+#endif // DOXYGEN_SKIP_THIS
+
 SO_NODEENGINE_ABSTRACT_SOURCE(SoVRMLInterpolator);
 
 /*!
@@ -114,37 +149,84 @@ SoVRMLInterpolator::SoVRMLInterpolator(void) // protected
 
 SoVRMLInterpolator::~SoVRMLInterpolator() // virtual, protected
 {
+  interpolator_generation.fetch_add(1, std::memory_order_relaxed);
 }
 
 /*!
   \COININTERNAL
+
+  Returns the index of the key segment containing set_fraction, and
+  the position within that segment in \a interp.
 */
-int 
+int
 SoVRMLInterpolator::getKeyValueIndex(float & interp, int numvalues)
 {
   float fraction = this->set_fraction.getValue();
   const int n = this->key.getNum();
   if (n == 0 || numvalues == 0) return -1;
 
-  const float * t = this->key.getValues(0); 
-  for (int i = 0; i < SbMin(n, numvalues); i++) {
-    if (fraction < t[i]) {
-      if (i == 0) {
-        interp = 0.0f;
-        return 0;
+  const float * t = this->key.getValues(0);
+  const int num = SbMin(n, numvalues);
+  const unsigned int generation =
+    interpolator_generation.load(std::memory_order_relaxed);
+  InterpolatorKeyState * p = &interpolator_states[
+    (reinterpret_cast<uintptr_t>(this) >> 4) % INTERPOLATOR_NUM_STATES];
+
+  if (p->interp != this || p->keys != t || p->numkeys != n ||
+      p->generation != generation) {
+    p->interp = this;
+    p->keys = t;
+    p->numkeys = n;
+    p->generation = generation;
+    p->upper = 0;
+    p->monotonic = TRUE;
+    for (int i = 1; i < n; i++) {
+      // written so that NaN keys also take the linear scan below
+      if (!(t[i] >= t[i-1])) { p->monotonic = FALSE; break; }
+    }
+  }
+
+  int i;
+  if (p->monotonic) {
+    // find the first key above fraction, i.e. what the linear scan
+    // below stops at, or num if there is none
+    i = SbMin(p->upper, num);
+    if (!((i == 0 || !(fraction < t[i-1])) && (i == num || fraction < t[i]))) {
+      if (i < num && !(fraction < t[i]) && (i+1 == num || fraction < t[i+1])) {
+        i++;
       }
       else {
-        float delta = t[i] - t[i-1];
-        if (delta > 0.0f) {
-          interp = (fraction - t[i-1]) / delta;
+        int lo = 0, hi = num;
+        while (lo < hi) {
+          const int mid = lo + (hi - lo) / 2;
+          if (fraction < t[mid]) hi = mid;
+          else lo = mid + 1;
         }
-        else interp = 0.0f;
+        i = lo;
       }
-      return i-1;
     }
+    p->upper = i;
+  }
+  else {
+    for (i = 0; i < num; i++) {
+      if (fraction < t[i]) break;
+    }
+  }
+
+  if (i == num) {
+    interp = 0.0f;
+    return num-1;
+  }
+  if (i == 0) {
+    interp = 0.0f;
+    return 0;
+  }
+  float delta = t[i] - t[i-1];
+  if (delta > 0.0f) {
+    interp = (fraction - t[i-1]) / delta;
   }
-  interp = 0.0f;
-  return SbMin(numvalues,n)-1;
+  else interp = 0.0f;
+  return i-1;
 }
 
 #endif // HAVE_VRML97
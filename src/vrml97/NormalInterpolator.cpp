@@ -87,12 +87,13 @@
 #include <Inventor/VRMLnodes/SoVRMLMacros.h>
 
 #include "engines/SoSubNodeEngineP.h"
+#include "vrml97/SoVRMLInterpolatorP.h"
 
 #ifndef DOXYGEN_SKIP_THIS
 
 class SoVRMLNormalInterpolatorP {
 public:
-  SbList <SbVec3f> tmplist;
+  SoVRMLInterpolatorBuffer<SbVec3f> tmpbuffer;
 };
 
 #endif // DOXYGEN_SKIP_THIS
@@ -138,10 +139,9 @@ SoVRMLNormalInterpolator::evaluate(void)
   if (!this->value_changed.isEnabled()) return;
 
   float interp;
-  int i, idx = this->getKeyValueIndex(interp, this->keyValue.getNum());
+  int idx = this->getKeyValueIndex(interp, this->keyValue.getNum());
   if (idx < 0) return;
 
-  PRIVATE(this)->tmplist.truncate(0);
   const int numkeys = this->key.getNum();
   const int numcoords = this->keyValue.getNum() / numkeys;
 
@@ -149,11 +149,11 @@ SoVRMLNormalInterpolator::evaluate(void)
   const SbVec3f * c1 = c0;
   if (interp > 0.0f) c1 = this->keyValue.getValues((idx+1)*numcoords);
 
-  for (i = 0; i < numcoords; i++) {
-    PRIVATE(this)->tmplist.append(c0[i] + (c1[i]-c0[i]) * interp);
-  }
-
-  const SbVec3f * coords = PRIVATE(this)->tmplist.getArrayPtr();
+  SbVec3f * coords = PRIVATE(this)->tmpbuffer.get(numcoords);
+  sovrml_lerp_floats(reinterpret_cast<float *>(coords),
+                     reinterpret_cast<const float *>(c0),
+                     reinterpret_cast<const float *>(c1),
+                     interp, numcoords * 3);
 
   SO_ENGINE_OUTPUT(value_changed, SoMFVec3f, setNum(numcoords));
   SO_ENGINE_OUTPUT(value_changed, SoMFVec3f, setValues(0, numcoords, coords));
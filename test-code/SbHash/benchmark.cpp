@@ -0,0 +1,97 @@
+/************************************************************************
+ *
+ * Compare lookup / insert / erase speed of the chained SbHash and the
+ * open addressing SbFlatHash, for the key types used by Coin
+ * internally: SbName strings (as in the SoBase name dictionaries),
+ * SoBase pointers (reference and auditor maps) and uint32_t (the
+ * SoDB converter map).
+ *
+ * Both templates are internal, so this must be built against the
+ * Coin source tree, e.g.:
+ *
+ *   c++ -O2 -DCOIN_INTERNAL -I<src> -I<src>/src -I<build>/include \
+ *       -I<build>/src benchmark.cpp -L<build> -lCoin -o benchmark
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Inventor/SoDB.h>
+#include <Inventor/SbName.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/SbString.h>
+#include <Inventor/nodes/SoCube.h>
+
+#include "misc/SbHash.h"
+#include "misc/SbFlatHash.h"
+
+static int checksum = 0;
+
+template <class Map, class Key>
+static void
+run(const char * mapname, const char * keyname, const Key * keys, int num, int rounds)
+{
+  Map map;
+  SbTime start = SbTime::getTimeOfDay();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < num; i++) { (void) map.put(keys[i], i); }
+    for (int i = 0; i < num; i += 2) { (void) map.erase(keys[i]); }
+  }
+  const double insert = (SbTime::getTimeOfDay() - start).getValue();
+
+  start = SbTime::getTimeOfDay();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < num; i++) {
+      int val;
+      if (map.get(keys[i], val)) checksum += val;
+    }
+  }
+  const double lookup = (SbTime::getTimeOfDay() - start).getValue();
+
+  const double ops = double(num) * rounds;
+  (void)fprintf(stdout, "%-10s %-8s insert+erase: %7.2f Mops/s  lookup: %7.2f Mops/s\n",
+                mapname, keyname, ops * 1.5 / insert / 1e6, ops / lookup / 1e6);
+}
+
+template <class Key>
+static void
+runboth(const char * keyname, const Key * keys, int num, int rounds)
+{
+  run<SbHash<Key, int>, Key>("SbHash", keyname, keys, num, rounds);
+  run<SbFlatHash<Key, int>, Key>("SbFlatHash", keyname, keys, num, rounds);
+}
+
+int
+main(int argc, char ** argv)
+{
+  const int num = (argc > 1) ? atoi(argv[1]) : 100000;
+  const int rounds = (argc > 2) ? atoi(argv[2]) : 10;
+
+  SoDB::init();
+  srand(19720408);
+
+  const char ** names = new const char *[num];
+  SoBase ** bases = new SoBase *[num];
+  uint32_t * ints = new uint32_t[num];
+  for (int i = 0; i < num; i++) {
+    SbString s;
+    s.sprintf("name_%d", i);
+    names[i] = SbName(s).getString();
+    bases[i] = new SoCube;
+    bases[i]->ref();
+    ints[i] = (uint32_t(rand()) << 16) ^ uint32_t(rand());
+  }
+
+  runboth<const char *>("SbName", names, num, rounds);
+  runboth<const SoBase *>("SoBase*", const_cast<const SoBase **>(bases), num, rounds);
+  runboth<uint32_t>("uint32_t", ints, num, rounds);
+
+  for (int i = 0; i < num; i++) { bases[i]->unref(); }
+  delete[] bases;
+  delete[] names;
+  delete[] ints;
+
+  (void)fprintf(stderr, "(checksum %d)\n", checksum);
+  return 0;
+}
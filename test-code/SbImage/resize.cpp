@@ -0,0 +1,167 @@
+/************************************************************************
+ *
+ * Compares SbImage::resize() with the scalar functions SoGLImage used
+ * before it had its own filters (copied here), in time and quality.
+ * The source image is a zone plate, and the quality is the PSNR
+ * against the same pattern sampled directly at the target size. Set
+ * COIN_IMAGE_RESIZE_NUM_THREADS to compare with a single thread.
+ *
+ *   c++ -O2 resize.cpp `coin-config --cppflags --ldflags --libs` \
+ *       -o resize
+ *   ./resize [size] [numcomponents]
+ *
+ ************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Inventor/SbImage.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/SoDB.h>
+
+// The nearest neighbour resize SoGLImage used without simage and GLU.
+static void
+old_resize(const unsigned char * src, unsigned char * dest,
+           int width, int height, int num_comp, int newwidth, int newheight)
+{
+  float dx = ((float)width)/((float)newwidth);
+  float dy = ((float)height)/((float)newheight);
+  int src_bpr = width * num_comp;
+  int dest_bpr = newwidth * num_comp;
+  float sy = 0.0f;
+  for (int y = 0; y < newheight * dest_bpr; y += dest_bpr) {
+    float sx = 0.0f;
+    for (int x = 0; x < newwidth * num_comp; x += num_comp) {
+      int offset = ((int)sy)*src_bpr + ((int)sx)*num_comp;
+      for (int i = 0; i < num_comp; i++) dest[x+y+i] = src[offset+i];
+      sx += dx;
+    }
+    sy += dy;
+  }
+}
+
+// The 2D mipmap step SoGLImage used.
+static void
+old_halve(const int width, const int height, const int nc,
+          const unsigned char * src, unsigned char * dst)
+{
+  int nextrow = width * nc;
+  for (int i = 0; i < height / 2; i++) {
+    for (int j = 0; j < width / 2; j++) {
+      for (int c = 0; c < nc; c++) {
+        *dst++ = (src[0] + src[nc] + src[nextrow] + src[nextrow+nc] + 2) >> 2;
+        src++;
+      }
+      src += nc;
+    }
+    src += nextrow;
+  }
+}
+
+// A zone plate, with frequencies increasing towards the edges, so
+// aliasing shows up as false rings.
+static float
+pattern(float x, float y, int size)
+{
+  const float cx = x / size - 0.5f, cy = y / size - 0.5f;
+  return 127.5f + 127.5f * cosf(float(M_PI) * 0.25f * size * (cx * cx + cy * cy));
+}
+
+// Samples the pattern for a size x size image into a smaller image,
+// averaging supersample x supersample samples per pixel.
+static unsigned char *
+make_image(int fullsize, int size, int nc, int supersample)
+{
+  const float factor = float(fullsize) / float(size);
+  unsigned char * bytes = new unsigned char[size * size * nc];
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      float sum = 0.0f;
+      for (int sy = 0; sy < supersample; sy++) {
+        for (int sx = 0; sx < supersample; sx++) {
+          sum += pattern((x + (sx + 0.5f) / supersample) * factor,
+                         (y + (sy + 0.5f) / supersample) * factor, fullsize);
+        }
+      }
+      const unsigned char v = (unsigned char) (sum / (supersample * supersample) + 0.5f);
+      for (int c = 0; c < nc; c++) bytes[(y * size + x) * nc + c] = v;
+    }
+  }
+  return bytes;
+}
+
+static double
+psnr(const unsigned char * a, const unsigned char * b, int num)
+{
+  double sum = 0.0;
+  for (int i = 0; i < num; i++) sum += double(a[i] - b[i]) * double(a[i] - b[i]);
+  if (sum == 0.0) return 99.0;
+  return 10.0 * log10(255.0 * 255.0 / (sum / num));
+}
+
+int
+main(int argc, char ** argv)
+{
+  SoDB::init();
+
+  const int size = (argc > 1) ? atoi(argv[1]) : 2048;
+  const int nc = (argc > 2) ? atoi(argv[2]) : 4;
+  const int newsize = size * 3 / 8; // a non power of two factor
+  const int repeat = 5;
+
+  unsigned char * src = make_image(size, size, nc, 1);
+  unsigned char * reference = make_image(size, newsize, nc, 8);
+  unsigned char * result = new unsigned char[size * size * nc];
+
+  SbTime start = SbTime::getTimeOfDay();
+  for (int i = 0; i < repeat; i++) old_resize(src, result, size, size, nc, newsize, newsize);
+  double t = (SbTime::getTimeOfDay() - start).getValue() / repeat;
+  fprintf(stdout, "%dx%d -> %dx%d, %d components\n", size, size, newsize, newsize, nc);
+  fprintf(stdout, "nearest (old)  %8.3f ms  PSNR %5.2f dB\n", t * 1000.0,
+          psnr(result, reference, newsize * newsize * nc));
+
+  const SbImage::ResizeFilter filters[] = { SbImage::BOX, SbImage::LANCZOS };
+  const char * names[] = { "box", "lanczos" };
+  for (int f = 0; f < 2; f++) {
+    SbImage image;
+    t = 0.0;
+    for (int i = 0; i < repeat; i++) {
+      image.setValue(SbVec2s(size, size), nc, src);
+      start = SbTime::getTimeOfDay();
+      image.resize(SbVec2s(newsize, newsize), filters[f]);
+      t += (SbTime::getTimeOfDay() - start).getValue();
+    }
+    SbVec2s s;
+    int n;
+    fprintf(stdout, "%-14s %8.3f ms  PSNR %5.2f dB\n", names[f], t * 1000.0 / repeat,
+            psnr(image.getValue(s, n), reference, newsize * newsize * nc));
+  }
+
+  // a full mipmap chain
+  start = SbTime::getTimeOfDay();
+  for (int i = 0; i < repeat; i++) {
+    const unsigned char * level = src;
+    for (int w = size; w > 1; w >>= 1) {
+      old_halve(w, w, nc, level, result);
+      level = result;
+    }
+  }
+  t = (SbTime::getTimeOfDay() - start).getValue() / repeat;
+  fprintf(stdout, "mipmaps (old)  %8.3f ms\n", t * 1000.0);
+
+  t = 0.0;
+  for (int i = 0; i < repeat; i++) {
+    SbImage image(src, SbVec2s(size, size), nc);
+    start = SbTime::getTimeOfDay();
+    for (int w = size; w > 1; w >>= 1) image.resize(SbVec2s(w / 2, w / 2), SbImage::BOX);
+    t += (SbTime::getTimeOfDay() - start).getValue();
+  }
+  fprintf(stdout, "mipmaps        %8.3f ms\n", t * 1000.0 / repeat);
+
+  delete[] src;
+  delete[] reference;
+  delete[] result;
+  return 0;
+}
@@ -0,0 +1,90 @@
+/************************************************************************
+ *
+ * Measures SoCalculator evaluation time for large multi-field inputs,
+ * using expressions from the SoCalculator documentation. Run it with
+ * COIN_CALCULATOR_INTERPRET=1 to compare with the expression tree
+ * interpreter, and with COIN_CALCULATOR_NUM_THREADS=n to split the
+ * evaluation across threads.
+ *
+ *   c++ -O2 benchmark.cpp `coin-config --cppflags --ldflags --libs` \
+ *       -o benchmark
+ *   ./benchmark [numvalues] [numframes]
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Inventor/SbTime.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/engines/SoCalculator.h>
+#include <Inventor/fields/SoMFFloat.h>
+#include <Inventor/fields/SoMFVec3f.h>
+
+static const char * expressions[][3] = {
+  { "oa = a * (0.5 + b) / c", NULL, NULL },
+  { "oA = A + vec3f(1.0, 0.0, 0.0) * b", NULL, NULL },
+  { "oa = (a > b) ? (a * 0.5) : (b * c)", NULL, NULL },
+  { "ta = a * b; tb = c + d; tc = a - d",
+    "tA = vec3f(ta, tb, tc) + A",
+    "oA = tA * b" },
+  { "oA = normalize(cross(A, B)) * length(A); ob = sin(a) * cos(b)", NULL, NULL }
+};
+
+int
+main(int argc, char ** argv)
+{
+  SoDB::init();
+
+  const int num = (argc > 1) ? atoi(argv[1]) : 100000;
+  const int frames = (argc > 2) ? atoi(argv[2]) : 50;
+
+  for (unsigned int e = 0; e < sizeof(expressions) / sizeof(expressions[0]); e++) {
+    SoCalculator * calc = new SoCalculator;
+    calc->ref();
+
+    calc->a.setNum(num);
+    calc->A.setNum(num);
+    calc->B.setNum(num);
+    float * a = calc->a.startEditing();
+    SbVec3f * A = calc->A.startEditing();
+    SbVec3f * B = calc->B.startEditing();
+    for (int i = 0; i < num; i++) {
+      a[i] = float(i) / num;
+      A[i].setValue(float(i % 7), float(i % 11), 1.0f);
+      B[i].setValue(1.0f, float(i % 3), float(i % 5));
+    }
+    calc->a.finishEditing();
+    calc->A.finishEditing();
+    calc->B.finishEditing();
+    calc->b = 0.25f;
+    calc->c = 2.0f;
+    calc->d = 3.0f;
+    for (int i = 0; i < 3 && expressions[e][i]; i++) {
+      calc->expression.set1Value(i, expressions[e][i]);
+    }
+
+    SoMFFloat oa, ob;
+    SoMFVec3f oA;
+    oa.connectFrom(&calc->oa);
+    ob.connectFrom(&calc->ob);
+    oA.connectFrom(&calc->oA);
+
+    SbTime start = SbTime::getTimeOfDay();
+    for (int frame = 0; frame < frames; frame++) {
+      calc->b = 0.25f + frame * 0.001f; // an input change per frame
+      (void) oa.getNum();
+      (void) ob.getNum();
+      (void) oA.getNum();
+    }
+    const double t = (SbTime::getTimeOfDay() - start).getValue();
+    fprintf(stdout, "%8.3f ms/frame %10.1f Mvalues/s  %s%s%s%s%s\n",
+            t * 1000.0 / frames, double(num) * frames / t / 1e6,
+            expressions[e][0],
+            expressions[e][1] ? "; " : "", expressions[e][1] ? expressions[e][1] : "",
+            expressions[e][2] ? "; " : "", expressions[e][2] ? expressions[e][2] : "");
+
+    calc->unref();
+  }
+  return 0;
+}
@@ -0,0 +1,105 @@
+/************************************************************************
+ *
+ * Measures time-to-first-frame for a model stored as a plain Inventor
+ * file and as a chunked file (see examples/misc/ivchunk.cpp): the time
+ * to read the file and render one offscreen frame with the camera
+ * looking at the full model, and with a camera zoomed in on a part of
+ * the model (where the chunked file only loads the visible chunks).
+ * The chunks needed by the first frame are loaded after it has been
+ * rendered, so a second frame is rendered with them.
+ *
+ *   c++ -O2 firstframe.cpp `coin-config --cppflags --ldflags --libs` \
+ *       -o firstframe
+ *   ./firstframe model.iv model-chunked.iv
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+
+#include <Inventor/SbTime.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/sensors/SoSensorManager.h>
+#include <Inventor/actions/SoSearchAction.h>
+#include <Inventor/nodes/SoDirectionalLight.h>
+#include <Inventor/nodes/SoLazySeparator.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+static int
+count_loaded(SoNode * root, int & total)
+{
+  SoSearchAction sa;
+  sa.setType(SoLazySeparator::getClassTypeId());
+  sa.setInterest(SoSearchAction::ALL);
+  sa.apply(root);
+  int loaded = 0;
+  total = sa.getPaths().getLength();
+  for (int i = 0; i < total; i++) {
+    if (((SoLazySeparator *) sa.getPaths()[i]->getTail())->isLoaded()) loaded++;
+  }
+  return loaded;
+}
+
+static void
+firstframe(const char * filename, float zoom)
+{
+  SbTime start = SbTime::getTimeOfDay();
+
+  SoInput in;
+  if (!in.openFile(filename)) {
+    fprintf(stderr, "could not open '%s'\n", filename);
+    return;
+  }
+  SoSeparator * model = SoDB::readAll(&in);
+  in.closeFile();
+  if (!model) {
+    fprintf(stderr, "could not read '%s'\n", filename);
+    return;
+  }
+  const double readtime = (SbTime::getTimeOfDay() - start).getValue();
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoPerspectiveCamera * camera = new SoPerspectiveCamera;
+  root->addChild(camera);
+  root->addChild(new SoDirectionalLight);
+  root->addChild(model);
+
+  SbViewportRegion vp(512, 512);
+  camera->viewAll(root, vp);
+  camera->heightAngle = camera->heightAngle.getValue() / zoom;
+
+  SoOffscreenRenderer renderer(vp);
+  (void) renderer.render(root);
+  // load the chunks scheduled by the first frame and render them
+  SoDB::getSensorManager()->processDelayQueue(FALSE);
+  (void) renderer.render(root);
+  const double frametime = (SbTime::getTimeOfDay() - start).getValue();
+
+  int total = 0;
+  const int loaded = count_loaded(root, total);
+  fprintf(stdout, "%-40s zoom %4.1f  read %8.3f s  first frame %8.3f s  chunks %d/%d\n",
+          filename, zoom, readtime, frametime, loaded, total);
+
+  root->unref();
+}
+
+int
+main(int argc, char ** argv)
+{
+  SoDB::init();
+
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s file [file ...]\n", argv[0]);
+    return 1;
+  }
+
+  for (int i = 1; i < argc; i++) {
+    firstframe(argv[i], 1.0f);
+    firstframe(argv[i], 8.0f);
+  }
+  return 0;
+}
@@ -0,0 +1,111 @@
+/************************************************************************
+ *
+ * Measures evaluation of a layered network of SoCalculator engines
+ * (10 x 1000 engines by default), where each engine reads the outputs
+ * of two engines in the layer above and feeds two engines in the layer
+ * below. Each frame changes the input of the first layer and reads
+ * all the outputs of the last layer, either on demand without the
+ * scheduler or after SoEngineScheduler::evaluateDirtyEngines().
+ *
+ * Without the scheduler, each engine is notified once for every path
+ * from the input, which doubles with each layer, so keep the number
+ * of layers small when comparing.
+ *
+ *   c++ -O2 network.cpp `coin-config --cppflags --ldflags --libs` \
+ *       -o network
+ *   ./network [layers] [width] [numframes] [numthreads]
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Inventor/SbTime.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/engines/SoCalculator.h>
+#include <Inventor/engines/SoEngineScheduler.h>
+#include <Inventor/fields/SoMFFloat.h>
+#include <Inventor/lists/SbList.h>
+
+static double
+run(SoCalculator * input, SbList<SoMFFloat *> & outputs, int frames,
+    SbBool scheduled, int & evaluations, int & levels, int & parallel)
+{
+  evaluations = levels = parallel = 0;
+  SbTime start = SbTime::getTimeOfDay();
+  for (int frame = 0; frame < frames; frame++) {
+    input->a = float(frame);
+    if (scheduled) {
+      SoEngineScheduler::evaluateDirtyEngines();
+      evaluations = SoEngineScheduler::getNumEvaluations();
+      levels = SoEngineScheduler::getNumLevels();
+      parallel = SoEngineScheduler::getNumParallelEvaluations();
+    }
+    for (int i = 0; i < outputs.getLength(); i++) (void) (*outputs[i])[0];
+  }
+  return (SbTime::getTimeOfDay() - start).getValue() * 1000.0 / frames;
+}
+
+int
+main(int argc, char ** argv)
+{
+  SoDB::init();
+
+  const int layers = (argc > 1) ? atoi(argv[1]) : 10;
+  const int width = (argc > 2) ? atoi(argv[2]) : 1000;
+  const int frames = (argc > 3) ? atoi(argv[3]) : 50;
+  const int threads = (argc > 4) ? atoi(argv[4]) : 4;
+
+  SoCalculator * input = new SoCalculator;
+  input->ref();
+  input->expression = "oa = a";
+
+  SbList<SoCalculator *> engines;
+  for (int l = 0; l < layers; l++) {
+    for (int i = 0; i < width; i++) {
+      SoCalculator * calc = new SoCalculator;
+      calc->ref();
+      calc->expression = "oa = a * 0.5 + b * 0.25 + 1";
+      if (l == 0) {
+        calc->a.connectFrom(&input->oa);
+        calc->b.connectFrom(&input->oa);
+      }
+      else {
+        calc->a.connectFrom(&engines[(l - 1) * width + i]->oa);
+        calc->b.connectFrom(&engines[(l - 1) * width + (i + 1) % width]->oa);
+      }
+      engines.append(calc);
+    }
+  }
+
+  SbList<SoMFFloat *> outputs;
+  for (int i = 0; i < width; i++) {
+    SoMFFloat * f = new SoMFFloat;
+    f->connectFrom(&engines[(layers - 1) * width + i]->oa);
+    outputs.append(f);
+  }
+  fprintf(stdout, "%d engines in %d layers\n", engines.getLength() + 1, layers);
+
+  int evaluations, levels, parallel;
+  run(input, outputs, 1, FALSE, evaluations, levels, parallel); // warm up
+
+  double t = run(input, outputs, frames, FALSE, evaluations, levels, parallel);
+  fprintf(stdout, "on demand          %8.3f ms/frame\n", t);
+
+  SoEngineScheduler::setEnabled(TRUE);
+  SoEngineScheduler::setNumThreads(1);
+  run(input, outputs, 1, TRUE, evaluations, levels, parallel);
+  t = run(input, outputs, frames, TRUE, evaluations, levels, parallel);
+  fprintf(stdout, "scheduled          %8.3f ms/frame  %d evaluations, %d levels\n",
+          t, evaluations, levels);
+
+  SoEngineScheduler::setNumThreads(threads);
+  t = run(input, outputs, frames, TRUE, evaluations, levels, parallel);
+  fprintf(stdout, "scheduled, %d thr  %8.3f ms/frame  %d evaluations, %d in parallel\n",
+          threads, t, evaluations, parallel);
+
+  for (int i = 0; i < outputs.getLength(); i++) delete outputs[i];
+  for (int i = 0; i < engines.getLength(); i++) engines[i]->unref();
+  input->unref();
+  return 0;
+}
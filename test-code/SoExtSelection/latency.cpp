@@ -0,0 +1,165 @@
+/************************************************************************
+ *
+ * Measures the latency of rectangle and lasso selection with
+ * SoExtSelection on a large model: a grid of SoIndexedFaceSet
+ * shapes with about numtriangles triangles in total (1M by
+ * default). The selection is made by sending mouse events through
+ * an SoHandleEventAction, like a viewer would.
+ *
+ * Prints the time for each selection, the number of selected shapes
+ * and, with the "filter" option, the number of triangles accepted by
+ * a triangle filter callback.
+ *
+ * VISIBLE_SHAPES selection needs an OpenGL context for
+ * SoOffscreenRenderer.
+ *
+ *   c++ -O2 latency.cpp `coin-config --cppflags --ldflags --libs` \
+ *       -o latency
+ *   ./latency [numtriangles] [rectangle|lasso] [part|full] [all|visible] [filter]
+ *
+ ************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Inventor/SbTime.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/actions/SoHandleEventAction.h>
+#include <Inventor/events/SoLocation2Event.h>
+#include <Inventor/events/SoMouseButtonEvent.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoExtSelection.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+static int numfiltered = 0;
+
+static SbBool
+triangle_filter(void *, SoCallbackAction *, const SoPrimitiveVertex *,
+                const SoPrimitiveVertex *, const SoPrimitiveVertex *)
+{
+  numfiltered++;
+  return TRUE;
+}
+
+static void
+send(SoHandleEventAction & action, SoNode * root, SoEvent * event,
+     const SbVec2s & pos)
+{
+  event->setPosition(pos);
+  action.setEvent(event);
+  action.apply(root);
+}
+
+static void
+press(SoHandleEventAction & action, SoNode * root,
+      SoMouseButtonEvent::Button button, const SbVec2s & pos,
+      SoButtonEvent::State state = SoButtonEvent::DOWN)
+{
+  SoMouseButtonEvent event;
+  event.setButton(button);
+  event.setState(state);
+  send(action, root, &event, pos);
+}
+
+int
+main(int argc, char ** argv)
+{
+  SoDB::init();
+
+  const int numtriangles = (argc > 1) ? atoi(argv[1]) : 1000000;
+  const SbBool lasso = (argc > 2) && !strcmp(argv[2], "lasso");
+  const SbBool full = (argc > 3) && !strcmp(argv[3], "full");
+  const SbBool visible = (argc > 4) && !strcmp(argv[4], "visible");
+  const SbBool filter = (argc > 5) && !strcmp(argv[5], "filter");
+
+  // 32x32 shapes, each a grid of quads split into triangles
+  const int shapes = 32;
+  int quads = 1;
+  while (2 * quads * quads * shapes * shapes < numtriangles) quads++;
+
+  SoExtSelection * root = new SoExtSelection;
+  root->ref();
+  root->lassoType = lasso ? SoExtSelection::LASSO : SoExtSelection::RECTANGLE;
+  root->lassoPolicy = full ? SoExtSelection::FULL : SoExtSelection::PART;
+  root->lassoMode = visible ? SoExtSelection::VISIBLE_SHAPES : SoExtSelection::ALL_SHAPES;
+  root->policy = SoSelection::SHIFT;
+  if (filter) root->setTriangleFilterCallback(triangle_filter, NULL);
+
+  SoOrthographicCamera * camera = new SoOrthographicCamera;
+  camera->position.setValue(shapes / 2.0f, shapes / 2.0f, 10.0f);
+  camera->height = float(shapes);
+  root->addChild(camera);
+
+  SoCoordinate3 * coords = new SoCoordinate3;
+  for (int y = 0; y <= quads; y++) {
+    for (int x = 0; x <= quads; x++) {
+      coords->point.set1Value(y * (quads + 1) + x,
+                              0.9f * x / quads, 0.9f * y / quads, 0.0f);
+    }
+  }
+  SbList<int32_t> indices;
+  for (int y = 0; y < quads; y++) {
+    for (int x = 0; x < quads; x++) {
+      const int32_t i = y * (quads + 1) + x;
+      const int32_t tri[8] = { i, i + 1, i + quads + 2, -1,
+                               i, i + quads + 2, i + quads + 1, -1 };
+      for (int k = 0; k < 8; k++) indices.append(tri[k]);
+    }
+  }
+  for (int j = 0; j < shapes * shapes; j++) {
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * translation = new SoTranslation;
+    translation->translation.setValue(float(j % shapes), float(j / shapes), 0.0f);
+    sep->addChild(translation);
+    sep->addChild(coords);
+    SoIndexedFaceSet * faceset = new SoIndexedFaceSet;
+    faceset->coordIndex.setValues(0, indices.getLength(), indices.getArrayPtr());
+    sep->addChild(faceset);
+    root->addChild(sep);
+  }
+
+  const SbViewportRegion vp(1024, 1024);
+  SoHandleEventAction action(vp);
+
+  // a small, a medium and a large selection around the center
+  const short sizes[] = { 40, 200, 900 };
+  for (int s = 0; s < 3; s++) {
+    const short c = 512, r = sizes[s] / 2;
+    root->deselectAll();
+    numfiltered = 0;
+    const SbTime start = SbTime::getTimeOfDay();
+    if (lasso) {
+      // a twelve-pointed star
+      for (int i = 0; i < 24; i++) {
+        const double a = i * M_PI / 12.0;
+        const double rr = (i & 1) ? r * 0.6 : r;
+        press(action, root, SoMouseButtonEvent::BUTTON1,
+              SbVec2s(short(c + rr * cos(a)), short(c + rr * sin(a))));
+      }
+      press(action, root, SoMouseButtonEvent::BUTTON2, SbVec2s(c + r, c));
+    }
+    else {
+      press(action, root, SoMouseButtonEvent::BUTTON1, SbVec2s(c - r, c - r));
+      SoLocation2Event move;
+      send(action, root, &move, SbVec2s(c + r, c + r));
+      press(action, root, SoMouseButtonEvent::BUTTON1, SbVec2s(c + r, c + r),
+            SoButtonEvent::UP);
+    }
+    const double ms = (SbTime::getTimeOfDay() - start).getValue() * 1000.0;
+    printf("%d triangles, %s %d px: %.1f ms, %d shapes selected",
+           2 * quads * quads * shapes * shapes, lasso ? "lasso" : "rectangle",
+           sizes[s], ms, root->getNumSelected());
+    if (filter) printf(", %d triangles filtered", numfiltered);
+    printf("\n");
+  }
+
+  root->unref();
+  return 0;
+}
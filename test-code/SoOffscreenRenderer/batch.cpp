@@ -0,0 +1,349 @@
+/************************************************************************
+ *
+ * Regression test and benchmark for SoOffscreenRenderer::renderBatch().
+ * A grid of spheres and cones is rendered from a number of cameras
+ * circling the scene:
+ *
+ *  - with a new SoOffscreenRenderer for each view, which sets up a new
+ *    GL context and new caches for each view, as the reference,
+ *  - with renderBatch() and one render thread,
+ *  - with renderBatch() and <threads> render threads,
+ *  - with renderBatch() and one render thread, with every other view
+ *    at half the size, to check that views of different sizes work.
+ *
+ * The images must be identical to the reference images. The number of
+ * views per second, and the shortest, average and longest time per
+ * view reported by renderBatch(), are printed for each case.
+ *
+ *   c++ -O2 batch.cpp `coin-config --cppflags --ldflags --libs` \
+ *       -o batch
+ *   ./batch [width height [views [threads]]]
+ *
+ * To run without a window system, e.g. with Mesa's software
+ * rasterizer on a machine without X11 and GPU, compile with
+ * -DWITH_EGL and link with -lEGL. The offscreen contexts are then made
+ * with EGL pbuffers, and the program is run with:
+ *
+ *   EGL_PLATFORM=surfaceless ./batch
+ *
+ * Returns 0 if all checks pass.
+ *
+ ************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Inventor/C/glue/gl.h>
+#include <Inventor/C/threads/mutex.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/lists/SoNodeList.h>
+#include <Inventor/nodes/SoComplexity.h>
+#include <Inventor/nodes/SoCone.h>
+#include <Inventor/nodes/SoDirectionalLight.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+#ifdef WITH_EGL
+#include <EGL/egl.h>
+
+// offscreen GL contexts made with EGL pbuffers
+
+struct egl_context {
+  EGLSurface surface;
+  EGLContext context;
+  EGLContext prevcontext;
+  EGLSurface prevdraw, prevread;
+};
+
+static EGLDisplay egl_display = EGL_NO_DISPLAY;
+static EGLConfig egl_config;
+
+static void *
+egl_create(unsigned int width, unsigned int height)
+{
+  if (egl_display == EGL_NO_DISPLAY) {
+    egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major, minor, num;
+    const EGLint attribs[] = {
+      EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8,
+      EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8, EGL_DEPTH_SIZE, 24,
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE
+    };
+    if (!eglInitialize(egl_display, &major, &minor) ||
+        !eglChooseConfig(egl_display, attribs, &egl_config, 1, &num) || num == 0) {
+      return NULL;
+    }
+  }
+  eglBindAPI(EGL_OPENGL_API);
+  const EGLint attribs[] = { EGL_WIDTH, (EGLint) width, EGL_HEIGHT, (EGLint) height, EGL_NONE };
+  egl_context * ctx = new egl_context;
+  ctx->surface = eglCreatePbufferSurface(egl_display, egl_config, attribs);
+  ctx->context = eglCreateContext(egl_display, egl_config, EGL_NO_CONTEXT, NULL);
+  if (ctx->surface == EGL_NO_SURFACE || ctx->context == EGL_NO_CONTEXT) {
+    delete ctx;
+    return NULL;
+  }
+  return ctx;
+}
+
+static SbBool
+egl_make_current(void * context)
+{
+  egl_context * ctx = (egl_context *) context;
+  eglBindAPI(EGL_OPENGL_API);
+  ctx->prevcontext = eglGetCurrentContext();
+  ctx->prevdraw = eglGetCurrentSurface(EGL_DRAW);
+  ctx->prevread = eglGetCurrentSurface(EGL_READ);
+  return eglMakeCurrent(egl_display, ctx->surface, ctx->surface, ctx->context);
+}
+
+static void
+egl_reinstate_previous(void * context)
+{
+  egl_context * ctx = (egl_context *) context;
+  if (ctx->prevcontext != EGL_NO_CONTEXT) {
+    eglMakeCurrent(egl_display, ctx->prevdraw, ctx->prevread, ctx->prevcontext);
+  }
+  else {
+    eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  }
+}
+
+static void
+egl_destruct(void * context)
+{
+  egl_context * ctx = (egl_context *) context;
+  eglDestroyContext(egl_display, ctx->context);
+  eglDestroySurface(egl_display, ctx->surface);
+  delete ctx;
+}
+
+static cc_glglue_offscreen_cb_functions egl_functions = {
+  egl_create, egl_make_current, egl_reinstate_previous, egl_destruct
+};
+#endif // WITH_EGL
+
+static const int GRIDSIZE = 12;
+
+static SoSeparator *
+make_scene(void)
+{
+  SoSeparator * root = new SoSeparator;
+  root->addChild(new SoDirectionalLight);
+  SoComplexity * complexity = new SoComplexity;
+  complexity->value = 0.6f;
+  root->addChild(complexity);
+
+  for (int i = 0; i < GRIDSIZE * GRIDSIZE; i++) {
+    const int x = i % GRIDSIZE;
+    const int y = i / GRIDSIZE;
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * translation = new SoTranslation;
+    translation->translation.setValue((x - GRIDSIZE / 2) * 2.5f,
+                                      (y - GRIDSIZE / 2) * 2.5f, 0.0f);
+    sep->addChild(translation);
+    SoMaterial * material = new SoMaterial;
+    material->diffuseColor.setValue(float(x) / GRIDSIZE, float(y) / GRIDSIZE, 0.5f);
+    sep->addChild(material);
+    if ((x + y) % 2) sep->addChild(new SoSphere);
+    else sep->addChild(new SoCone);
+    root->addChild(sep);
+  }
+  return root;
+}
+
+// cameras circling the scene
+static void
+make_cameras(SoNodeList & cameras, const int views)
+{
+  for (int i = 0; i < views; i++) {
+    const float angle = float(i) * 2.0f * float(M_PI) / views;
+    SoPerspectiveCamera * camera = new SoPerspectiveCamera;
+    camera->position.setValue(40.0f * cosf(angle), 40.0f * sinf(angle), 25.0f);
+    camera->pointAt(SbVec3f(0.0f, 0.0f, 0.0f), SbVec3f(0.0f, 0.0f, 1.0f));
+    camera->nearDistance = 10.0f;
+    camera->farDistance = 100.0f;
+    cameras.append(camera);
+  }
+}
+
+struct batch_result {
+  cc_mutex * mutex;
+  unsigned char ** images;
+  int numcomponents;
+  double mintime, maxtime, sumtime;
+  int numviews;
+};
+
+static void
+batch_cb(void * userdata, SoOffscreenRenderer * renderer, const int view,
+         const SbTime & rendertime)
+{
+  batch_result * result = (batch_result *) userdata;
+  const SbVec2s size = renderer->getViewportRegion().getViewportSizePixels();
+  const size_t bytes = size_t(size[0]) * size[1] * result->numcomponents;
+  result->images[view] = new unsigned char[bytes];
+  memcpy(result->images[view], renderer->getBuffer(), bytes);
+
+  // the callback is called from all the render threads
+  const double ms = rendertime.getValue() * 1000.0;
+  cc_mutex_lock(result->mutex);
+  if (ms < result->mintime) result->mintime = ms;
+  if (ms > result->maxtime) result->maxtime = ms;
+  result->sumtime += ms;
+  result->numviews++;
+  cc_mutex_unlock(result->mutex);
+}
+
+static int
+check(const char * what, unsigned char ** images, unsigned char ** reference,
+      const int views, const size_t bytes, const double seconds,
+      const batch_result * result)
+{
+  int differ = 0;
+  for (int i = 0; i < views; i++) {
+    if (!images[i] || memcmp(images[i], reference[i], bytes) != 0) differ++;
+  }
+  printf("%-28s %7.1f views/s", what, views / seconds);
+  if (result) {
+    printf(", %6.2f / %6.2f / %6.2f ms per view",
+           result->mintime, result->sumtime / result->numviews, result->maxtime);
+  }
+  printf("\n");
+  if (differ) {
+    printf("  FAILED: %d of the images differ from the reference images\n", differ);
+    return 1;
+  }
+  return 0;
+}
+
+static SbBool
+render_batch(SoOffscreenRenderer & renderer, SoNode * scene,
+             const SoNodeList & cameras, const SbList <SbViewportRegion> * regions,
+             batch_result & result, double & seconds)
+{
+  const int views = cameras.getLength();
+  result.images = new unsigned char*[views];
+  for (int i = 0; i < views; i++) result.images[i] = NULL;
+  result.numcomponents = renderer.getComponents();
+  result.mintime = 1e9;
+  result.maxtime = result.sumtime = 0.0;
+  result.numviews = 0;
+
+  const SbTime start = SbTime::getTimeOfDay();
+  const SbBool ok = regions ?
+    renderer.renderBatch(scene, cameras, *regions, batch_cb, &result) :
+    renderer.renderBatch(scene, cameras, batch_cb, &result);
+  seconds = (SbTime::getTimeOfDay() - start).getValue();
+  return ok;
+}
+
+static void
+free_images(unsigned char ** images, const int views)
+{
+  for (int i = 0; i < views; i++) delete[] images[i];
+  delete[] images;
+}
+
+int
+main(int argc, char ** argv)
+{
+  const int w = (argc > 2) ? atoi(argv[1]) : 640;
+  const int h = (argc > 2) ? atoi(argv[2]) : 480;
+  const int views = (argc > 3) ? atoi(argv[3]) : 32;
+  const int threads = (argc > 4) ? atoi(argv[4]) : 4;
+  if (argc == 2 || w <= 1 || h <= 1 || views < 2 || threads < 1) {
+    fprintf(stderr, "usage: %s [width height [views [threads]]]\n", argv[0]);
+    return 1;
+  }
+
+#ifdef WITH_EGL
+  cc_glglue_context_set_offscreen_cb_functions(&egl_functions);
+#endif // WITH_EGL
+  SoDB::init();
+
+  SoSeparator * scene = make_scene();
+  scene->ref();
+  SoNodeList cameras;
+  make_cameras(cameras, views);
+
+  const SbViewportRegion vp(w, h);
+  const size_t bytes = size_t(w) * h * 3;
+
+  // the reference images, with a new renderer for each view
+  unsigned char ** reference = new unsigned char*[views];
+  SbTime start = SbTime::getTimeOfDay();
+  for (int i = 0; i < views; i++) {
+    SoSeparator * root = new SoSeparator;
+    root->ref();
+    root->addChild(cameras[i]);
+    root->addChild(scene);
+    SoOffscreenRenderer renderer(vp);
+    renderer.setBackgroundColor(SbColor(0.2f, 0.2f, 0.3f));
+    reference[i] = NULL;
+    if (renderer.render(root)) {
+      reference[i] = new unsigned char[bytes];
+      memcpy(reference[i], renderer.getBuffer(), bytes);
+    }
+    root->unref();
+    if (!reference[i]) {
+      fprintf(stderr, "couldn't render the scene\n");
+      return 1;
+    }
+  }
+  double seconds = (SbTime::getTimeOfDay() - start).getValue();
+  printf("%dx%d pixels, %d views\n", w, h, views);
+  printf("%-28s %7.1f views/s\n", "new renderer per view", views / seconds);
+
+  int failed = 0;
+  SoOffscreenRenderer renderer(vp);
+  renderer.setBackgroundColor(SbColor(0.2f, 0.2f, 0.3f));
+  batch_result result;
+  result.mutex = cc_mutex_construct();
+  char what[64];
+  for (int pass = 0; pass < 2; pass++) {
+    const int numthreads = pass ? threads : 1;
+    renderer.setNumRenderThreads(numthreads);
+    // the first batch sets up the GL contexts and caches
+    if (!render_batch(renderer, scene, cameras, NULL, result, seconds)) failed++;
+    free_images(result.images, views);
+    if (!render_batch(renderer, scene, cameras, NULL, result, seconds)) failed++;
+    sprintf(what, "renderBatch(), %d thread%s", numthreads, numthreads > 1 ? "s" : "");
+    failed += check(what, result.images, reference, views, bytes, seconds, &result);
+    free_images(result.images, views);
+  }
+
+  // every other view at half the size, which must give the reference
+  // image for the full size views
+  SbList <SbViewportRegion> regions;
+  for (int i = 0; i < views; i++) {
+    regions.append((i % 2) ? SbViewportRegion(w / 2, h / 2) : vp);
+  }
+  renderer.setNumRenderThreads(1);
+  if (!render_batch(renderer, scene, cameras, &regions, result, seconds)) failed++;
+  int differ = 0;
+  for (int i = 0; i < views; i += 2) {
+    if (!result.images[i] || memcmp(result.images[i], reference[i], bytes) != 0) differ++;
+  }
+  printf("%-28s %7.1f views/s\n", "renderBatch(), mixed sizes", views / seconds);
+  if (differ || result.numviews != views) {
+    printf("  FAILED: %d of the full size images differ from the reference images\n", differ);
+    failed++;
+  }
+  free_images(result.images, views);
+
+  free_images(reference, views);
+  cc_mutex_destruct(result.mutex);
+  scene->unref();
+
+  printf("%s\n", failed ? "FAILED" : "OK");
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,204 @@
+/************************************************************************
+ *
+ * Regression test and benchmark for tiled rendering with
+ * SoOffscreenRenderer. A grid of spheres and cones is rendered as a
+ * large image, split into tiles of at most 512x512 pixels (unless
+ * COIN_OFFSCREENRENDERER_MAX_TILESIZE is set to something else):
+ *
+ *  - with render() and one render thread, which is the reference,
+ *  - with render() and <threads> render threads,
+ *  - with renderToRGB() and one and <threads> render threads, which
+ *    write the tiles straight to tiles-<threads>.rgb.
+ *
+ * All the images must be identical to the reference image. The time
+ * used for each rendering is printed. The components argument is 1
+ * (LUMINANCE), 2 (LUMINANCE_TRANSPARENCY), 3 (RGB, the default) or 4
+ * (RGB_TRANSPARENCY).
+ *
+ *   c++ -O2 tiles.cpp `coin-config --cppflags --ldflags --libs` \
+ *       -o tiles
+ *   ./tiles [width height [threads [components]]]
+ *
+ * Set COIN_OFFSCREENRENDERER_PBO=0 to read the tiles back without
+ * pixel buffer objects. Returns 0 if all checks pass.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Inventor/C/tidbits.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/nodes/SoComplexity.h>
+#include <Inventor/nodes/SoCone.h>
+#include <Inventor/nodes/SoDirectionalLight.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+static const int GRIDSIZE = 24;
+
+static SoSeparator *
+make_scene(const SbViewportRegion & vp)
+{
+  SoSeparator * root = new SoSeparator;
+  SoPerspectiveCamera * camera = new SoPerspectiveCamera;
+  root->addChild(camera);
+  root->addChild(new SoDirectionalLight);
+  SoComplexity * complexity = new SoComplexity;
+  complexity->value = 0.8f;
+  root->addChild(complexity);
+
+  for (int i = 0; i < GRIDSIZE * GRIDSIZE; i++) {
+    const int x = i % GRIDSIZE;
+    const int y = i / GRIDSIZE;
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * translation = new SoTranslation;
+    translation->translation.setValue(float(x) * 2.5f, float(y) * 2.5f, 0.0f);
+    sep->addChild(translation);
+    SoMaterial * material = new SoMaterial;
+    material->diffuseColor.setValue(float(x) / GRIDSIZE, float(y) / GRIDSIZE, 0.5f);
+    sep->addChild(material);
+    if ((x + y) % 2) sep->addChild(new SoSphere);
+    else sep->addChild(new SoCone);
+    root->addChild(sep);
+  }
+
+  camera->orientation.setValue(SbVec3f(1.0f, 0.2f, 0.0f), 0.4f);
+  camera->viewAll(root, vp);
+  return root;
+}
+
+static unsigned char *
+render(SoOffscreenRenderer & renderer, SoNode * root, const int threads,
+       const size_t size, double & ms)
+{
+  renderer.setNumRenderThreads(threads);
+  SbTime start = SbTime::getTimeOfDay();
+  if (!renderer.render(root)) return NULL;
+  unsigned char * image = new unsigned char[size];
+  memcpy(image, renderer.getBuffer(), size);
+  ms = (SbTime::getTimeOfDay() - start).getValue() * 1000.0;
+  return image;
+}
+
+// renders to file, and reads the planar SGI RGB file back into an
+// interleaved image
+static unsigned char *
+render_to_file(SoOffscreenRenderer & renderer, SoNode * root, const int threads,
+               const int w, const int h, const int nc, double & ms)
+{
+  char filename[256];
+  sprintf(filename, "tiles-%d.rgb", threads);
+  renderer.setNumRenderThreads(threads);
+  SbTime start = SbTime::getTimeOfDay();
+  if (!renderer.renderToRGB(root, filename)) return NULL;
+  ms = (SbTime::getTimeOfDay() - start).getValue() * 1000.0;
+
+  FILE * fp = fopen(filename, "rb");
+  if (!fp) return NULL;
+  const size_t size = size_t(w) * h * nc;
+  unsigned char * planes = new unsigned char[size];
+  const SbBool ok = (fseek(fp, 512, SEEK_SET) == 0) &&
+    (fread(planes, 1, size, fp) == size) && (fgetc(fp) == EOF);
+  fclose(fp);
+  if (!ok) {
+    delete[] planes;
+    return NULL;
+  }
+
+  unsigned char * image = new unsigned char[size];
+  for (int c = 0; c < nc; c++) {
+    for (size_t i = 0; i < size_t(w) * h; i++) {
+      image[i * nc + c] = planes[c * size_t(w) * h + i];
+    }
+  }
+  delete[] planes;
+  return image;
+}
+
+static int
+check(const char * what, const unsigned char * image,
+      const unsigned char * reference, const size_t size, const double ms)
+{
+  if (!image) {
+    printf("%-24s FAILED: couldn't render\n", what);
+    return 1;
+  }
+  size_t differ = 0;
+  for (size_t i = 0; i < size; i++) {
+    if (image[i] != reference[i]) differ++;
+  }
+  printf("%-24s %9.1f ms, %lu bytes differ\n", what, ms, (unsigned long) differ);
+  if (differ) {
+    printf("  FAILED: the image differs from the reference\n");
+    return 1;
+  }
+  return 0;
+}
+
+int
+main(int argc, char ** argv)
+{
+  const int w = (argc > 2) ? atoi(argv[1]) : 4096;
+  const int h = (argc > 2) ? atoi(argv[2]) : 3072;
+  const int threads = (argc > 3) ? atoi(argv[3]) : 4;
+  const int nc = (argc > 4) ? atoi(argv[4]) : 3;
+  if (argc == 2 || w <= 0 || h <= 0 || threads < 1 || nc < 1 || nc > 4) {
+    fprintf(stderr, "usage: %s [width height [threads [components]]]\n", argv[0]);
+    return 1;
+  }
+
+  (void) coin_setenv("COIN_OFFSCREENRENDERER_MAX_TILESIZE", "512", 0);
+  SoDB::init();
+
+  const SbViewportRegion vp(w, h);
+  SoSeparator * root = make_scene(vp);
+  root->ref();
+
+  SoOffscreenRenderer renderer(vp);
+  renderer.setComponents((SoOffscreenRenderer::Components) nc);
+  renderer.setBackgroundColor(SbColor(0.2f, 0.2f, 0.3f));
+
+  const size_t size = size_t(w) * h * nc;
+  double ms;
+  // the first rendering sets up the GL contexts, so render twice
+  delete[] render(renderer, root, 1, size, ms);
+  unsigned char * reference = render(renderer, root, 1, size, ms);
+  if (!reference) {
+    fprintf(stderr, "couldn't render the scene\n");
+    return 1;
+  }
+  printf("%dx%d pixels, %d components\n", w, h, nc);
+  printf("%-24s %9.1f ms\n", "render(), 1 thread", ms);
+
+  int failed = 0;
+  char what[64];
+  unsigned char * image;
+  delete[] render(renderer, root, threads, size, ms);
+  image = render(renderer, root, threads, size, ms);
+  sprintf(what, "render(), %d threads", threads);
+  failed += check(what, image, reference, size, ms);
+  delete[] image;
+
+  image = render_to_file(renderer, root, 1, w, h, nc, ms);
+  failed += check("renderToRGB(), 1 thread", image, reference, size, ms);
+  delete[] image;
+
+  image = render_to_file(renderer, root, threads, w, h, nc, ms);
+  sprintf(what, "renderToRGB(), %d threads", threads);
+  failed += check(what, image, reference, size, ms);
+  delete[] image;
+
+  delete[] reference;
+  root->unref();
+
+  printf("%s\n", failed ? "FAILED" : "OK");
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,293 @@
+/************************************************************************
+ *
+ * Regression test and benchmark for the scheduled writes of
+ * SoOffscreenRenderer. A sequence of frames of a rotating grid of
+ * spheres and cones is rendered and written to files, for each format:
+ *
+ *  - with writeToRGB(), writeToPostScript() or writeToFile(), which
+ *    write the file before the next frame is rendered,
+ *  - with scheduleWriteToRGB(), scheduleWriteToPostScript() or
+ *    scheduleWriteToFile() and <threads> write threads, which write
+ *    the files while the next frames are rendered.
+ *
+ * The formats are uncompressed SGI RGB, run-length encoded SGI RGB,
+ * PostScript, and PNG if simage is available. The files written the
+ * two ways must be identical, and the run-length encoded files must
+ * decode to the same image as the uncompressed ones. The number of
+ * frames per second is printed for each case.
+ *
+ *   c++ -O2 writer.cpp `coin-config --cppflags --ldflags --libs` \
+ *       -o writer
+ *   ./writer [width height [frames [threads]]]
+ *
+ * The files are written to the current directory, and removed when
+ * they have been checked. Returns 0 if all checks pass.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Inventor/SbTime.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/nodes/SoComplexity.h>
+#include <Inventor/nodes/SoCone.h>
+#include <Inventor/nodes/SoDirectionalLight.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoRotationXYZ.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+static const int GRIDSIZE = 8;
+
+enum Format { RGB, RLE, POSTSCRIPT, PNG, NUMFORMATS };
+static const char * formatnames[NUMFORMATS] = { "rgb", "rle", "ps", "png" };
+
+static SoSeparator *
+make_scene(const SbViewportRegion & vp, SoRotationXYZ * rotation)
+{
+  SoSeparator * root = new SoSeparator;
+  SoPerspectiveCamera * camera = new SoPerspectiveCamera;
+  root->addChild(camera);
+  root->addChild(new SoDirectionalLight);
+  SoComplexity * complexity = new SoComplexity;
+  complexity->value = 0.5f;
+  root->addChild(complexity);
+  rotation->axis = SoRotationXYZ::Z;
+  root->addChild(rotation);
+
+  for (int i = 0; i < GRIDSIZE * GRIDSIZE; i++) {
+    const int x = i % GRIDSIZE;
+    const int y = i / GRIDSIZE;
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * translation = new SoTranslation;
+    translation->translation.setValue((x - GRIDSIZE / 2) * 2.5f,
+                                      (y - GRIDSIZE / 2) * 2.5f, 0.0f);
+    sep->addChild(translation);
+    SoMaterial * material = new SoMaterial;
+    material->diffuseColor.setValue(float(x) / GRIDSIZE, float(y) / GRIDSIZE, 0.5f);
+    sep->addChild(material);
+    if ((x + y) % 2) sep->addChild(new SoSphere);
+    else sep->addChild(new SoCone);
+    root->addChild(sep);
+  }
+
+  camera->viewAll(root, vp);
+  return root;
+}
+
+static void
+make_filename(char * filename, const char * mode, const int format, const int frame)
+{
+  sprintf(filename, "writer-%s-%s-%03d.%s", mode, formatnames[format], frame,
+          format == RLE ? "rgb" : formatnames[format]);
+}
+
+static SbBool
+write_frame(SoOffscreenRenderer & renderer, const int format,
+            const char * filename, const SbBool scheduled)
+{
+  switch (format) {
+  case RGB:
+  case RLE:
+    renderer.setRGBCompression(format == RLE);
+    return scheduled ?
+      renderer.scheduleWriteToRGB(filename) : renderer.writeToRGB(filename);
+  case POSTSCRIPT:
+    return scheduled ?
+      renderer.scheduleWriteToPostScript(filename) : renderer.writeToPostScript(filename);
+  default:
+    return scheduled ?
+      renderer.scheduleWriteToFile(filename, "png") : renderer.writeToFile(filename, "png");
+  }
+}
+
+// renders and writes all the frames, and returns the number of
+// frames per second
+static double
+render_frames(SoOffscreenRenderer & renderer, SoNode * root,
+              SoRotationXYZ * rotation, const int frames, const int format,
+              const SbBool scheduled)
+{
+  SbTime start = SbTime::getTimeOfDay();
+  SbBool ok = TRUE;
+  for (int i = 0; i < frames && ok; i++) {
+    rotation->angle = float(i) * 0.05f;
+    char filename[256];
+    make_filename(filename, scheduled ? "scheduled" : "direct", format, i);
+    ok = renderer.render(root) && write_frame(renderer, format, filename, scheduled);
+  }
+  if (scheduled) ok = renderer.waitForScheduledWrites() && ok;
+  if (!ok) return 0.0;
+  return frames / (SbTime::getTimeOfDay() - start).getValue();
+}
+
+static unsigned char *
+read_file(const char * filename, size_t & size)
+{
+  FILE * fp = fopen(filename, "rb");
+  if (!fp) return NULL;
+  fseek(fp, 0, SEEK_END);
+  size = (size_t) ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  unsigned char * data = new unsigned char[size];
+  const SbBool ok = fread(data, 1, size, fp) == size;
+  fclose(fp);
+  if (!ok) {
+    delete[] data;
+    return NULL;
+  }
+  return data;
+}
+
+static unsigned int
+get_int(const unsigned char * p)
+{
+  return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+// decodes a run-length encoded SGI RGB file into the planar image
+// data of an uncompressed file
+static unsigned char *
+decode_rle(const unsigned char * data, const size_t size, const int w,
+           const int h, const int nc)
+{
+  if (size < 512 || data[2] != 1) return NULL;
+  const int numrows = h * nc;
+  unsigned char * image = new unsigned char[size_t(w) * numrows];
+  for (int row = 0; row < numrows; row++) {
+    const unsigned int start = get_int(data + 512 + row * 4);
+    const unsigned int length = get_int(data + 512 + (numrows + row) * 4);
+    if (start + length > size) {
+      delete[] image;
+      return NULL;
+    }
+    const unsigned char * src = data + start;
+    const unsigned char * end = src + length;
+    unsigned char * dst = image + size_t(row) * w;
+    unsigned char * dstend = dst + w;
+    while (src < end && *src) {
+      const int count = *src & 0x7f;
+      if (dst + count > dstend) break;
+      if (*src++ & 0x80) {
+        memcpy(dst, src, count);
+        src += count;
+      }
+      else {
+        memset(dst, *src++, count);
+      }
+      dst += count;
+    }
+    if (dst != dstend) {
+      delete[] image;
+      return NULL;
+    }
+  }
+  return image;
+}
+
+// checks and removes the files of all the frames
+static int
+check_files(const int frames, const int format, const int w, const int h,
+            const int nc)
+{
+  int failed = 0;
+  for (int i = 0; i < frames; i++) {
+    char direct[256], scheduled[256], reference[256];
+    make_filename(direct, "direct", format, i);
+    make_filename(scheduled, "scheduled", format, i);
+    make_filename(reference, "direct", RGB, i);
+    size_t size1, size2;
+    unsigned char * data1 = read_file(direct, size1);
+    unsigned char * data2 = read_file(scheduled, size2);
+    if (!data1 || !data2 || size1 != size2 || memcmp(data1, data2, size1) != 0) {
+      printf("  FAILED: %s and %s differ\n", direct, scheduled);
+      failed++;
+    }
+    else if (format == RLE) {
+      size_t refsize;
+      unsigned char * refdata = read_file(reference, refsize);
+      unsigned char * image = decode_rle(data1, size1, w, h, nc);
+      if (!refdata || !image || refsize != 512 + size_t(w) * h * nc ||
+          memcmp(image, refdata + 512, refsize - 512) != 0) {
+        printf("  FAILED: %s doesn't decode to %s\n", direct, reference);
+        failed++;
+      }
+      delete[] refdata;
+      delete[] image;
+    }
+    delete[] data1;
+    delete[] data2;
+  }
+  for (int i = 0; i < frames; i++) {
+    char filename[256];
+    make_filename(filename, "scheduled", format, i);
+    remove(filename);
+    // the uncompressed files are needed to check the compressed ones
+    if (format != RGB) {
+      make_filename(filename, "direct", format, i);
+      remove(filename);
+    }
+  }
+  return failed;
+}
+
+int
+main(int argc, char ** argv)
+{
+  const int w = (argc > 2) ? atoi(argv[1]) : 1920;
+  const int h = (argc > 2) ? atoi(argv[2]) : 1080;
+  const int frames = (argc > 3) ? atoi(argv[3]) : 24;
+  const int threads = (argc > 4) ? atoi(argv[4]) : 2;
+  if (argc == 2 || w <= 0 || h <= 0 || frames < 1 || threads < 1) {
+    fprintf(stderr, "usage: %s [width height [frames [threads]]]\n", argv[0]);
+    return 1;
+  }
+
+  SoDB::init();
+
+  const SbViewportRegion vp(w, h);
+  SoRotationXYZ * rotation = new SoRotationXYZ;
+  SoSeparator * root = make_scene(vp, rotation);
+  root->ref();
+
+  SoOffscreenRenderer renderer(vp);
+  renderer.setComponents(SoOffscreenRenderer::RGB);
+  renderer.setBackgroundColor(SbColor(0.2f, 0.2f, 0.3f));
+  renderer.setNumWriteThreads(threads);
+  // set up the GL context before timing anything
+  if (!renderer.render(root)) {
+    fprintf(stderr, "couldn't render the scene\n");
+    return 1;
+  }
+
+  printf("%dx%d pixels, %d frames, %d write threads\n", w, h, frames, threads);
+  int failed = 0;
+  const int numformats = renderer.isWriteSupported("png") ? NUMFORMATS : PNG;
+  for (int format = 0; format < numformats; format++) {
+    const double direct = render_frames(renderer, root, rotation, frames, format, FALSE);
+    const double scheduled = render_frames(renderer, root, rotation, frames, format, TRUE);
+    printf("%-4s %8.2f frames/s direct, %8.2f frames/s scheduled\n",
+           formatnames[format], direct, scheduled);
+    if (direct == 0.0 || scheduled == 0.0) {
+      printf("  FAILED: couldn't render or write the frames\n");
+      failed++;
+    }
+    failed += check_files(frames, format, w, h, 3);
+  }
+  for (int i = 0; i < frames; i++) {
+    char filename[256];
+    make_filename(filename, "direct", RGB, i);
+    remove(filename);
+  }
+
+  root->unref();
+
+  printf("%s\n", failed ? "FAILED" : "OK");
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,116 @@
+/************************************************************************
+ *
+ * Benchmark for the overhead of SoProfilerCounters. A scene graph with
+ * a grid of separators with transforms, materials and shapes is
+ * traversed with SoCallbackAction, which visits every node, with the
+ * counters disabled and enabled, in turns so that both get the same
+ * conditions. The time used for each traversal is printed, and the
+ * counters from the enabled traversals, which must have counted every
+ * node.
+ *
+ *   c++ -O2 overhead.cpp `coin-config --cppflags --ldflags --libs` \
+ *       -o overhead
+ *   ./overhead [gridsize [traversals]]
+ *
+ * Set COIN_PROFILER=on to compare with the overhead of the profiler,
+ * which is what the counters are meant to replace when the
+ * application is in use. Returns 0 if the counts are right.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Inventor/SbTime.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/annex/Profiler/SoProfilerCounters.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+static SoSeparator *
+make_scene(const int gridsize, int & numnodes)
+{
+  SoSeparator * root = new SoSeparator;
+  numnodes = 1;
+  for (int i = 0; i < gridsize * gridsize; i++) {
+    const int x = i % gridsize;
+    const int y = i / gridsize;
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * translation = new SoTranslation;
+    translation->translation.setValue(x * 2.5f, y * 2.5f, 0.0f);
+    sep->addChild(translation);
+    SoMaterial * material = new SoMaterial;
+    material->diffuseColor.setValue(float(x) / gridsize, float(y) / gridsize, 0.5f);
+    sep->addChild(material);
+    if ((x + y) % 2) sep->addChild(new SoSphere);
+    else sep->addChild(new SoCube);
+    root->addChild(sep);
+    numnodes += 4;
+  }
+  return root;
+}
+
+// returns the time used for each traversal, in milliseconds
+static double
+traverse(SoNode * root, const int traversals)
+{
+  SoCallbackAction action;
+  const SbTime start = SbTime::getTimeOfDay();
+  for (int i = 0; i < traversals; i++) action.apply(root);
+  return (SbTime::getTimeOfDay() - start).getValue() * 1000.0 / traversals;
+}
+
+int
+main(int argc, char ** argv)
+{
+  const int gridsize = (argc > 1) ? atoi(argv[1]) : 100;
+  const int traversals = (argc > 2) ? atoi(argv[2]) : 20;
+  if (gridsize < 1 || traversals < 1) {
+    fprintf(stderr, "usage: %s [gridsize [traversals]]\n", argv[0]);
+    return 1;
+  }
+
+  SoDB::init();
+
+  int numnodes;
+  SoSeparator * root = make_scene(gridsize, numnodes);
+  root->ref();
+  printf("%d nodes, %d traversals\n", numnodes, traversals);
+
+  // warm up
+  traverse(root, 1);
+
+  double disabled = 0.0, enabled = 0.0;
+  SoProfilerCounters::reset();
+  for (int i = 0; i < 5; i++) {
+    SoProfilerCounters::enable(FALSE);
+    disabled += traverse(root, traversals) / 5.0;
+    SoProfilerCounters::enable(TRUE);
+    enabled += traverse(root, traversals) / 5.0;
+  }
+  SoProfilerCounters::enable(FALSE);
+
+  printf("counters disabled: %8.3f ms per traversal\n", disabled);
+  printf("counters enabled:  %8.3f ms per traversal (%+.1f%%)\n",
+         enabled, (enabled / disabled - 1.0) * 100.0);
+  for (int c = 0; c < SoProfilerCounters::NUM_COUNTERS; c++) {
+    const SoProfilerCounters::Counter counter = (SoProfilerCounters::Counter) c;
+    printf("  %-20s %12llu\n", SoProfilerCounters::getName(counter),
+           (unsigned long long) SoProfilerCounters::get(counter));
+  }
+
+  const unsigned long long expected = (unsigned long long) numnodes * traversals * 5;
+  const SbBool ok =
+    SoProfilerCounters::get(SoProfilerCounters::NODES_TRAVERSED) == expected;
+  if (!ok) {
+    printf("FAILED: expected %llu nodes traversed\n", expected);
+  }
+  root->unref();
+
+  printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+/************************************************************************
+ *
+ * Measures STL import and export throughput, in triangles per second.
+ * A regular grid mesh of (about) the given number of triangles is
+ * written with SoSTLFileKit::writeScene() as a binary and as an ASCII
+ * STL file, which are then read back with SoSTLFileKit::readFile().
+ * Set COIN_STL_NUM_THREADS to compare with a single thread.
+ *
+ *   c++ -O2 throughput.cpp `coin-config --cppflags --ldflags --libs` \
+ *       -o throughput
+ *   ./throughput [numtriangles]
+ *
+ ************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Inventor/SbTime.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/annex/ForeignFiles/SoSTLFileKit.h>
+#include <Inventor/nodekits/SoNodeKit.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+static SoSeparator *
+make_grid(int numtriangles)
+{
+  const int size = (int) sqrt(numtriangles / 2.0) + 1;
+
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->point.setNum(size * size);
+  SbVec3f * points = coords->point.startEditing();
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      points[y * size + x].setValue(float(x), float(y),
+                                    sinf(x * 0.1f) * cosf(y * 0.1f));
+    }
+  }
+  coords->point.finishEditing();
+
+  SoIndexedFaceSet * faceset = new SoIndexedFaceSet;
+  faceset->coordIndex.setNum((size - 1) * (size - 1) * 8);
+  int32_t * idx = faceset->coordIndex.startEditing();
+  for (int y = 0; y < size - 1; y++) {
+    for (int x = 0; x < size - 1; x++) {
+      const int i = y * size + x;
+      *idx++ = i; *idx++ = i + 1; *idx++ = i + size + 1; *idx++ = -1;
+      *idx++ = i; *idx++ = i + size + 1; *idx++ = i + size; *idx++ = -1;
+    }
+  }
+  faceset->coordIndex.finishEditing();
+
+  SoSeparator * root = new SoSeparator;
+  root->addChild(coords);
+  root->addChild(faceset);
+  return root;
+}
+
+static void
+measure(SoSeparator * scene, int numtriangles, SbBool binary)
+{
+  const char * filename = binary ? "throughput-binary.stl" : "throughput-ascii.stl";
+
+  SoSTLFileKit * writer = new SoSTLFileKit;
+  writer->ref();
+  writer->binary = binary;
+  SbTime start = SbTime::getTimeOfDay();
+  if (!writer->writeScene(scene, filename)) {
+    fprintf(stderr, "could not write '%s'\n", filename);
+    exit(1);
+  }
+  const double writetime = (SbTime::getTimeOfDay() - start).getValue();
+  writer->unref();
+
+  SoSTLFileKit * reader = new SoSTLFileKit;
+  reader->ref();
+  start = SbTime::getTimeOfDay();
+  if (!reader->readFile(filename)) {
+    fprintf(stderr, "could not read '%s'\n", filename);
+    exit(1);
+  }
+  const double readtime = (SbTime::getTimeOfDay() - start).getValue();
+  reader->unref();
+  (void) remove(filename);
+
+  fprintf(stdout, "%-6s  write %8.3f s %12.0f tris/s   read %8.3f s %12.0f tris/s\n",
+          binary ? "binary" : "ascii",
+          writetime, numtriangles / writetime,
+          readtime, numtriangles / readtime);
+}
+
+int
+main(int argc, char ** argv)
+{
+  SoDB::init();
+  SoNodeKit::init();
+
+  const int requested = (argc > 1) ? atoi(argv[1]) : 2000000;
+  SoSeparator * scene = make_grid(requested);
+  scene->ref();
+  const SoIndexedFaceSet * faceset = (SoIndexedFaceSet *) scene->getChild(1);
+  const int numtriangles = faceset->coordIndex.getNum() / 4;
+  fprintf(stdout, "%d triangles\n", numtriangles);
+
+  measure(scene, numtriangles, TRUE);
+  measure(scene, numtriangles, FALSE);
+
+  scene->unref();
+  return 0;
+}
@@ -0,0 +1,92 @@
+/************************************************************************
+ *
+ * Measures rendering of many SoText2 labels (1000 by default) with
+ * SoOffscreenRenderer. The labels are spread over a grid, each under
+ * its own SoSeparator with a translation and a color, and use a few
+ * different font sizes.
+ *
+ * The glyphs are rendered from the SoText2 glyph atlas by default.
+ * Run with COIN_TEXT2_GLYPH_ATLAS=0 in the environment to compare
+ * with rendering each glyph with glBitmap() or glDrawPixels().
+ *
+ *   c++ -O2 labels.cpp `coin-config --cppflags --ldflags --libs` \
+ *       -o labels
+ *   ./labels [numlabels] [numframes] [fontname]
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Inventor/SbTime.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/nodes/SoBaseColor.h>
+#include <Inventor/nodes/SoFont.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoText2.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+int
+main(int argc, char ** argv)
+{
+  SoDB::init();
+
+  const int numlabels = (argc > 1) ? atoi(argv[1]) : 1000;
+  const int frames = (argc > 2) ? atoi(argv[2]) : 20;
+  const char * fontname = (argc > 3) ? argv[3] : NULL;
+
+  int columns = 1;
+  while (columns * columns < numlabels) columns++;
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoOrthographicCamera * camera = new SoOrthographicCamera;
+  camera->height = float(columns);
+  camera->position.setValue(columns / 2.0f, columns / 2.0f, 5.0f);
+  root->addChild(camera);
+
+  for (int i = 0; i < numlabels; i++) {
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * translation = new SoTranslation;
+    translation->translation.setValue(float(i % columns), float(i / columns), 0.0f);
+    sep->addChild(translation);
+    SoBaseColor * color = new SoBaseColor;
+    color->rgb.setValue(float(i % 7) / 6.0f, float(i % 5) / 4.0f, 1.0f);
+    sep->addChild(color);
+    SoFont * font = new SoFont;
+    if (fontname) font->name = fontname;
+    font->size = 10.0f + float(i % 3) * 2.0f;
+    sep->addChild(font);
+    SoText2 * text = new SoText2;
+    char label[64];
+    sprintf(label, "Label %d", i);
+    text->string = label;
+    sep->addChild(text);
+    root->addChild(sep);
+  }
+
+  SoOffscreenRenderer renderer(SbViewportRegion(1024, 1024));
+  SbTime start = SbTime::getTimeOfDay();
+  if (!renderer.render(root)) {
+    fprintf(stderr, "couldn't render offscreen\n");
+    root->unref();
+    return 1;
+  }
+  const double first = (SbTime::getTimeOfDay() - start).getValue() * 1000.0;
+
+  start = SbTime::getTimeOfDay();
+  for (int frame = 0; frame < frames; frame++) {
+    (void) renderer.render(root);
+  }
+  const double ms = (SbTime::getTimeOfDay() - start).getValue() * 1000.0 / frames;
+
+  const char * env = getenv("COIN_TEXT2_GLYPH_ATLAS");
+  printf("%d labels, glyph atlas %s: first frame %.2f ms, %.2f ms per frame\n",
+         numlabels, (env && atoi(env) == 0) ? "off" : "on", first, ms);
+
+  root->unref();
+  return 0;
+}
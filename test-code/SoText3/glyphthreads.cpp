@@ -0,0 +1,116 @@
+/************************************************************************
+ *
+ * Measures how well threads share the 3D glyph cache. Each thread
+ * has its own scene graph with SoText3 nodes, and repeatedly changes
+ * their strings and applies an SoGetBoundingBoxAction, so that the
+ * nodes ref the glyphs for the new strings and unref the old ones.
+ *
+ * Runs with 1, 2, 4, ... up to the given number of threads, and
+ * prints the number of glyphs looked up per second in total. By
+ * default all threads use the same font. Give "fonts" as the last
+ * argument to have each thread use its own font (the builtin font
+ * with different complexities), so that they use different shards
+ * of the glyph cache.
+ *
+ * Coin must be built with thread safety enabled.
+ *
+ *   c++ -O2 glyphthreads.cpp `coin-config --cppflags --ldflags --libs` \
+ *       -o glyphthreads
+ *   ./glyphthreads [maxthreads] [iterations] [fonts]
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Inventor/SbTime.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/nodes/SoComplexity.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoText3.h>
+#include <Inventor/threads/SbThread.h>
+
+static const int NUMNODES = 20;
+static const char * strings[] = {
+  "The quick brown fox", "jumps over the lazy dog",
+  "Pack my box with", "five dozen liquor jugs"
+};
+
+struct thread_data {
+  SoSeparator * root;
+  SoText3 * text[NUMNODES];
+  int iterations;
+};
+
+static void *
+thread_callback(void * closure)
+{
+  thread_data * data = (thread_data *) closure;
+  SoGetBoundingBoxAction action(SbViewportRegion(256, 256));
+  for (int i = 0; i < data->iterations; i++) {
+    for (int n = 0; n < NUMNODES; n++) {
+      data->text[n]->string = strings[(i + n) % 4];
+    }
+    action.apply(data->root);
+  }
+  return NULL;
+}
+
+int
+main(int argc, char ** argv)
+{
+  SoDB::init();
+
+  const int maxthreads = (argc > 1) ? atoi(argv[1]) : 8;
+  const int iterations = (argc > 2) ? atoi(argv[2]) : 200;
+  const SbBool ownfonts = (argc > 3) && !strcmp(argv[3], "fonts");
+
+  SbList<thread_data *> data;
+  for (int t = 0; t < maxthreads; t++) {
+    thread_data * d = new thread_data;
+    d->root = new SoSeparator;
+    d->root->ref();
+    d->iterations = iterations;
+    SoComplexity * complexity = new SoComplexity;
+    complexity->value = ownfonts ? float(t % 10) / 10.0f + 0.05f : 0.5f;
+    d->root->addChild(complexity);
+    for (int n = 0; n < NUMNODES; n++) {
+      d->text[n] = new SoText3;
+      d->root->addChild(d->text[n]);
+    }
+    data.append(d);
+  }
+
+  int glyphs = 0;
+  for (int i = 0; i < iterations; i++) {
+    for (int n = 0; n < NUMNODES; n++) {
+      glyphs += (int) strlen(strings[(i + n) % 4]);
+    }
+  }
+
+  for (int numthreads = 1; numthreads <= maxthreads; numthreads *= 2) {
+    SbList<SbThread *> threads;
+    const SbTime start = SbTime::getTimeOfDay();
+    for (int t = 0; t < numthreads; t++) {
+      threads.append(SbThread::create(thread_callback, data[t]));
+    }
+    for (int t = 0; t < numthreads; t++) {
+      threads[t]->join();
+      SbThread::destroy(threads[t]);
+    }
+    const double seconds = (SbTime::getTimeOfDay() - start).getValue();
+    printf("%2d threads, %s: %.0f glyph lookups per second\n",
+           numthreads, ownfonts ? "one font each" : "same font",
+           double(glyphs) * numthreads / seconds);
+  }
+
+  for (int t = 0; t < maxthreads; t++) {
+    data[t]->root->unref();
+    delete data[t];
+  }
+  return 0;
+}
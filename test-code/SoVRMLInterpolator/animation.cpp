@@ -0,0 +1,121 @@
+/************************************************************************
+ *
+ * Measures VRML interpolator evaluation for an animation with many
+ * SoVRMLCoordinateInterpolator and SoVRMLOrientationInterpolator
+ * nodes with long key lists, driven from an SoTimerSensor. Each frame
+ * advances set_fraction a little, like a timer sensor driving a
+ * TimeSensor -> interpolator route would, and then reads the
+ * outputs.
+ *
+ *   c++ -O2 animation.cpp `coin-config --cppflags --ldflags --libs` \
+ *       -o animation
+ *   ./animation [numinterpolators] [numkeys] [numcoords] [numframes]
+ *
+ ************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Inventor/SbTime.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/VRMLnodes/SoVRMLCoordinateInterpolator.h>
+#include <Inventor/VRMLnodes/SoVRMLOrientationInterpolator.h>
+#include <Inventor/fields/SoMFVec3f.h>
+#include <Inventor/fields/SoSFRotation.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/sensors/SoSensorManager.h>
+#include <Inventor/sensors/SoTimerSensor.h>
+
+struct Animation {
+  SbList<SoVRMLInterpolator *> interpolators;
+  SbList<SoField *> outputs;
+  int frame;
+  int numframes;
+};
+
+static void
+tick_cb(void * closure, SoSensor * sensor)
+{
+  Animation * anim = (Animation *) closure;
+  const float fraction = float(anim->frame) / float(anim->numframes);
+  for (int i = 0; i < anim->interpolators.getLength(); i++) {
+    anim->interpolators[i]->set_fraction = fraction;
+  }
+  for (int i = 0; i < anim->outputs.getLength(); i++) {
+    anim->outputs[i]->evaluate();
+  }
+  if (++anim->frame >= anim->numframes) sensor->unschedule();
+}
+
+int
+main(int argc, char ** argv)
+{
+  SoDB::init();
+
+  const int numinterpolators = (argc > 1) ? atoi(argv[1]) : 100;
+  const int numkeys = (argc > 2) ? atoi(argv[2]) : 1000;
+  const int numcoords = (argc > 3) ? atoi(argv[3]) : 100;
+  const int numframes = (argc > 4) ? atoi(argv[4]) : 500;
+
+  SbList<float> keys;
+  for (int k = 0; k < numkeys; k++) keys.append(float(k) / (numkeys - 1));
+
+  Animation anim;
+  anim.frame = 0;
+  anim.numframes = numframes;
+
+  for (int i = 0; i < numinterpolators; i++) {
+    SoVRMLCoordinateInterpolator * coord = new SoVRMLCoordinateInterpolator;
+    coord->ref();
+    coord->key.setValues(0, numkeys, keys.getArrayPtr());
+    coord->keyValue.setNum(numkeys * numcoords);
+    SbVec3f * values = coord->keyValue.startEditing();
+    for (int k = 0; k < numkeys * numcoords; k++) {
+      values[k].setValue(sinf(k * 0.01f), cosf(k * 0.02f), float(k % 17));
+    }
+    coord->keyValue.finishEditing();
+    SoMFVec3f * out = new SoMFVec3f;
+    out->connectFrom(&coord->value_changed);
+    anim.interpolators.append(coord);
+    anim.outputs.append(out);
+
+    SoVRMLOrientationInterpolator * orient = new SoVRMLOrientationInterpolator;
+    orient->ref();
+    orient->key.setValues(0, numkeys, keys.getArrayPtr());
+    orient->keyValue.setNum(numkeys);
+    SbRotation * rotations = orient->keyValue.startEditing();
+    for (int k = 0; k < numkeys; k++) {
+      rotations[k].setValue(SbVec3f(0.0f, 1.0f, 0.0f), k * 0.1f);
+    }
+    orient->keyValue.finishEditing();
+    SoSFRotation * rot = new SoSFRotation;
+    rot->connectFrom(&orient->value_changed);
+    anim.interpolators.append(orient);
+    anim.outputs.append(rot);
+  }
+
+  SoTimerSensor * sensor = new SoTimerSensor(tick_cb, &anim);
+  sensor->setInterval(SbTime::zero());
+  sensor->schedule();
+
+  SbTime start = SbTime::getTimeOfDay();
+  while (anim.frame < anim.numframes) {
+    SoDB::getSensorManager()->processTimerQueue();
+    SoDB::getSensorManager()->processDelayQueue(FALSE);
+  }
+  const double t = (SbTime::getTimeOfDay() - start).getValue();
+
+  fprintf(stdout, "%d interpolators, %d keys, %d coordinates: "
+          "%8.3f ms/frame %10.1f Mcoords/s\n",
+          numinterpolators * 2, numkeys, numcoords,
+          t * 1000.0 / numframes,
+          double(numinterpolators) * numcoords * numframes / t / 1e6);
+
+  delete sensor;
+  for (int i = 0; i < anim.outputs.getLength(); i++) delete anim.outputs[i];
+  for (int i = 0; i < anim.interpolators.getLength(); i++) {
+    anim.interpolators[i]->unref();
+  }
+  return 0;
+}
@@ -0,0 +1,139 @@
+/************************************************************************
+ *
+ * Measures PostScript export with SoVectorizePSAction for each of the
+ * hidden line and surface removal modes. The scene is read from the
+ * file given on the command line, or is a block of n x n x n rotated
+ * cubes and cylinders (n = 8 by default) looked at from the side,
+ * like a dense CAD model where most edges are hidden.
+ *
+ * Prints the time used and the size of the PostScript file written
+ * for each mode. The files are written to hiddenlines-<mode>.ps.
+ *
+ *   c++ -O2 hiddenlines.cpp `coin-config --cppflags --ldflags --libs` \
+ *       -o hiddenlines
+ *   ./hiddenlines [file.iv | n]
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Inventor/SbTime.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/annex/HardCopy/SoHardCopy.h>
+#include <Inventor/annex/HardCopy/SoVectorizePSAction.h>
+#include <Inventor/annex/HardCopy/SoVectorOutput.h>
+#include <Inventor/nodes/SoComplexity.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoCylinder.h>
+#include <Inventor/nodes/SoDirectionalLight.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoRotation.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoShapeHints.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+static SoSeparator *
+make_blocks(const int n)
+{
+  SoSeparator * root = new SoSeparator;
+  SoShapeHints * hints = new SoShapeHints;
+  hints->vertexOrdering = SoShapeHints::COUNTERCLOCKWISE;
+  hints->shapeType = SoShapeHints::SOLID;
+  root->addChild(hints);
+  SoComplexity * complexity = new SoComplexity;
+  complexity->value = 0.3f;
+  root->addChild(complexity);
+
+  for (int i = 0; i < n * n * n; i++) {
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * translation = new SoTranslation;
+    translation->translation.setValue(float(i % n) * 3.0f,
+                                      float((i / n) % n) * 3.0f,
+                                      float(i / (n * n)) * -3.0f);
+    sep->addChild(translation);
+    SoRotation * rotation = new SoRotation;
+    rotation->rotation.setValue(SbVec3f(1.0f, float(i % 3), float(i % 5)),
+                                float(i % 7) * 0.3f);
+    sep->addChild(rotation);
+    if (i % 2) sep->addChild(new SoCube);
+    else sep->addChild(new SoCylinder);
+    root->addChild(sep);
+  }
+  return root;
+}
+
+int
+main(int argc, char ** argv)
+{
+  SoDB::init();
+  SoHardCopy::init();
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoPerspectiveCamera * camera = new SoPerspectiveCamera;
+  root->addChild(camera);
+  root->addChild(new SoDirectionalLight);
+
+  if (argc > 1 && atoi(argv[1]) == 0) {
+    SoInput in;
+    if (!in.openFile(argv[1])) return 1;
+    SoSeparator * scene = SoDB::readAll(&in);
+    if (!scene) return 1;
+    root->addChild(scene);
+  }
+  else {
+    root->addChild(make_blocks((argc > 1) ? atoi(argv[1]) : 8));
+  }
+
+  const SbViewportRegion vp(1024, 768);
+  camera->orientation.setValue(SbVec3f(-0.3f, 1.0f, 0.0f), 0.5f);
+  camera->viewAll(root, vp);
+
+  static const SoVectorizeAction::HLHSRMode modes[] = {
+    SoVectorizeAction::NO_HLHSR,
+    SoVectorizeAction::HLHSR_PAINTER,
+    SoVectorizeAction::HLHSR_PAINTER_SURFACE_REMOVAL,
+    SoVectorizeAction::HIDDEN_LINES_REMOVAL
+  };
+  static const char * names[] = {
+    "none", "painter", "surfaceremoval", "hiddenlines"
+  };
+
+  for (int i = 0; i < 4; i++) {
+    char filename[256];
+    sprintf(filename, "hiddenlines-%s.ps", names[i]);
+
+    SoVectorizePSAction * ps = new SoVectorizePSAction;
+    SoVectorOutput * out = ps->getOutput();
+    if (!out->openFile(filename)) {
+      fprintf(stderr, "couldn't open %s\n", filename);
+      return 1;
+    }
+    ps->setHLHSRMode(modes[i]);
+    ps->setBackgroundColor(TRUE, SbColor(1.0f, 1.0f, 1.0f));
+
+    SbTime start = SbTime::getTimeOfDay();
+    ps->beginStandardPage(SoVectorizeAction::A4, 10.0f);
+    ps->calibrate(vp);
+    ps->apply(root);
+    ps->endPage();
+    const double ms = (SbTime::getTimeOfDay() - start).getValue() * 1000.0;
+    out->closeFile();
+    delete ps;
+
+    FILE * fp = fopen(filename, "rb");
+    long size = 0;
+    if (fp) {
+      fseek(fp, 0, SEEK_END);
+      size = ftell(fp);
+      fclose(fp);
+    }
+    printf("%-16s %9.1f ms %10ld bytes\n", names[i], ms, size);
+  }
+
+  root->unref();
+  return 0;
+}
@@ -0,0 +1,128 @@
+/************************************************************************
+ *
+ * Measures the peak memory use of PostScript export with
+ * SoVectorizePSAction. The scene is a grid of n x n x n finely
+ * tessellated spheres (n = 16 by default), which gives about
+ * 2400 * n^3 triangles.
+ *
+ * Only one mode is measured per run, since the peak memory use of a
+ * process never goes down. Prints the time used, the size of the
+ * PostScript file and the peak resident set size. The file is written
+ * to memory-<mode>.ps.
+ *
+ *   c++ -O2 memory.cpp `coin-config --cppflags --ldflags --libs` \
+ *       -o memory
+ *   ./memory none|painter [n]
+ *
+ * Set COIN_VECTORIZE_SORT_CHUNK_SIZE to change how many items the
+ * painter mode sorts in memory before writing them to disk.
+ *
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include <Inventor/SbTime.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/annex/HardCopy/SoHardCopy.h>
+#include <Inventor/annex/HardCopy/SoVectorizePSAction.h>
+#include <Inventor/annex/HardCopy/SoVectorOutput.h>
+#include <Inventor/nodes/SoComplexity.h>
+#include <Inventor/nodes/SoDirectionalLight.h>
+#include <Inventor/nodes/SoPerspectiveCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoSphere.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+static SoSeparator *
+make_spheres(const int n)
+{
+  SoSeparator * root = new SoSeparator;
+  SoComplexity * complexity = new SoComplexity;
+  complexity->value = 1.0f;
+  root->addChild(complexity);
+
+  for (int i = 0; i < n * n * n; i++) {
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * translation = new SoTranslation;
+    translation->translation.setValue(float(i % n) * 2.5f,
+                                      float((i / n) % n) * 2.5f,
+                                      float(i / (n * n)) * -2.5f);
+    sep->addChild(translation);
+    sep->addChild(new SoSphere);
+    root->addChild(sep);
+  }
+  return root;
+}
+
+static long
+peak_rss_kb(void)
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss; // in kilobytes on Linux
+}
+
+int
+main(int argc, char ** argv)
+{
+  if (argc < 2 ||
+      (strcmp(argv[1], "none") != 0 && strcmp(argv[1], "painter") != 0)) {
+    fprintf(stderr, "usage: %s none|painter [n]\n", argv[0]);
+    return 1;
+  }
+  const SbBool painter = strcmp(argv[1], "painter") == 0;
+
+  SoDB::init();
+  SoHardCopy::init();
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoPerspectiveCamera * camera = new SoPerspectiveCamera;
+  root->addChild(camera);
+  root->addChild(new SoDirectionalLight);
+  root->addChild(make_spheres((argc > 2) ? atoi(argv[2]) : 16));
+
+  const SbViewportRegion vp(1024, 768);
+  camera->orientation.setValue(SbVec3f(-0.3f, 1.0f, 0.0f), 0.5f);
+  camera->viewAll(root, vp);
+
+  const long startrss = peak_rss_kb();
+
+  char filename[256];
+  sprintf(filename, "memory-%s.ps", argv[1]);
+  SoVectorizePSAction * ps = new SoVectorizePSAction;
+  SoVectorOutput * out = ps->getOutput();
+  if (!out->openFile(filename)) {
+    fprintf(stderr, "couldn't open %s\n", filename);
+    return 1;
+  }
+  ps->setHLHSRMode(painter ?
+                   SoVectorizeAction::HLHSR_PAINTER :
+                   SoVectorizeAction::NO_HLHSR);
+
+  SbTime start = SbTime::getTimeOfDay();
+  ps->beginStandardPage(SoVectorizeAction::A4, 10.0f);
+  ps->calibrate(vp);
+  ps->apply(root);
+  ps->endPage();
+  const double ms = (SbTime::getTimeOfDay() - start).getValue() * 1000.0;
+  out->closeFile();
+  delete ps;
+
+  FILE * fp = fopen(filename, "rb");
+  long size = 0;
+  if (fp) {
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fclose(fp);
+  }
+  printf("%-8s %9.1f ms %11ld bytes %8ld KB peak (%ld KB before export)\n",
+         argv[1], ms, size, peak_rss_kb(), startrss);
+
+  root->unref();
+  return 0;
+}